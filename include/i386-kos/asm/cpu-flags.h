@@ -102,6 +102,7 @@
 
 #define IA32_TIME_STAMP_COUNTER 0x00000010
 #define IA32_MISC_ENABLE        0x000001a0
+#define IA32_PAT                0x00000277
 
 #define IA32_SYSENTER_CS        0x00000174
 #define IA32_SYSENTER_ESP       0x00000175
@@ -119,6 +120,15 @@
 #define IA32_EFER_TCE           0x00008000  /* Translation Cache Extension */
 #endif /* __x86_64__ */
 
+/* Memory types that may be stored in the 8 byte-sized slots of `IA32_PAT' */
+#define IA32_PAT_UC             0x00        /* Uncacheable */
+#define IA32_PAT_WC             0x01        /* Write combining */
+#define IA32_PAT_WT             0x04        /* Write through */
+#define IA32_PAT_WP             0x05        /* Write protected */
+#define IA32_PAT_WB             0x06        /* Write back */
+#define IA32_PAT_UCMINUS        0x07        /* Uncached (can be overwritten by MTRRs) */
+#define IA32_PAT_ENTRY(i,type)  ((__UINT64_TYPE__)(type) << ((i)*8))
+
 
 /* (Derived from linux) MISC_ENABLE bits: architectural */
 #define IA32_MISC_ENABLE_FAST_STRING         (__UINT64_C(1) << 0)
@@ -223,7 +233,7 @@
 /*      CPUID_7D_                0x00000002 /* [bit(1)] RESERVED. */
 #define CPUID_7D_AVX512_4VNNIW   0x00000004 /* [bit(2)] AVX-512 4-register Neural Network Instructions. */
 #define CPUID_7D_AVX512_4FMAPS   0x00000008 /* [bit(3)] AVX-512 4-register Multiply Accumulation Single precision. */
-/*      CPUID_7D_                0x00000010 /* [bit(4)] RESERVED. */
+#define CPUID_7D_FSRM            0x00000010 /* [bit(4)] Fast short REP MOVSB. */
 /*      CPUID_7D_                0x00000020 /* [bit(5)] RESERVED. */
 /*      CPUID_7D_                0x00000040 /* [bit(6)] RESERVED. */
 /*      CPUID_7D_                0x00000080 /* [bit(7)] RESERVED. */
@@ -379,4 +389,6 @@
 #define CPUID_80000001D_3DNOWEXT      0x40000000 /* [bit(30)] Extended 3DNow. */
 #define CPUID_80000001D_3DNOW         0x80000000 /* [bit(31)] 3DNow!. */
 
+#define CPUID_80000007D_INVARIANT_TSC 0x00000100 /* [bit(8)] Invariant TSC (Runs at a constant rate in all ACPI P-, C- and T-states). */
+
 #endif /* !_X86_KOS_ASM_CPU_FLAGS_H */
@@ -71,6 +71,9 @@ for (local line: fp) {
 #define SYS_pwrite64 __NR_pwrite64
 #define SYS_pselect6 __NR_pselect6
 #define SYS_ppoll __NR_ppoll
+#define SYS_vmsplice __NR_vmsplice
+#define SYS_splice __NR_splice
+#define SYS_tee __NR_tee
 #define SYS_readlinkat __NR_readlinkat
 #define SYS_fstatat64 __NR_fstatat64
 #define SYS_fstat64 __NR_fstat64
@@ -85,6 +88,8 @@ for (local line: fp) {
 #define SYS_unshare __NR_unshare
 #define SYS_futex __NR_futex
 #define SYS_nanosleep __NR_nanosleep
+#define SYS_clock_gettime __NR_clock_gettime
+#define SYS_clock_getres __NR_clock_getres
 #define SYS_sched_yield __NR_sched_yield
 #define SYS_kill __NR_kill
 #define SYS_tkill __NR_tkill
@@ -98,12 +103,14 @@ for (local line: fp) {
 #define SYS_rt_sigqueueinfo __NR_rt_sigqueueinfo
 #define SYS_sigreturn __NR_sigreturn
 #define SYS_rt_sigreturn __NR_rt_sigreturn
+#define SYS_times __NR_times
 #define SYS_setpgid __NR_setpgid
 #define SYS_getpgid __NR_getpgid
 #define SYS_getsid __NR_getsid
 #define SYS_setsid __NR_setsid
 #define SYS_sethostname __NR_sethostname
 #define SYS_setdomainname __NR_setdomainname
+#define SYS_getrusage __NR_getrusage
 #define SYS_umask __NR_umask
 #define SYS_getcpu __NR_getcpu
 #define SYS_gettimeofday __NR_gettimeofday
@@ -134,6 +141,7 @@ for (local line: fp) {
 #define SYS_swapon __NR_swapon
 #define SYS_swapoff __NR_swapoff
 #define SYS_mprotect __NR_mprotect
+#define SYS_madvise __NR_madvise
 #define SYS_rt_tgsigqueueinfo __NR_rt_tgsigqueueinfo
 #define SYS_accept4 __NR_accept4
 #define SYS_wait4 __NR_wait4
@@ -145,6 +153,7 @@ for (local line: fp) {
 #define SYS_recv __NR_recv
 #define SYS_send __NR_send
 #define SYS_fork __NR_fork
+#define SYS_vfork __NR_vfork
 #define SYS_xsyslog __NR_xsyslog
 #define SYS_xmmap __NR_xmmap
 #define SYS_xmunmap __NR_xmunmap
@@ -187,6 +196,9 @@ for (local line: fp) {
 #define SYS_xqueue_job __NR_xqueue_job
 #define SYS_xserve_job __NR_xserve_job
 #define SYS_xnosignal __NR_xnosignal
+#define SYS_xioring_setup __NR_xioring_setup
+#define SYS_xioring_enter __NR_xioring_enter
+#define SYS_xioring_register __NR_xioring_register
 #define SYS_xfdlopenat __NR_xfdlopenat
 #define SYS_xdlclose __NR_xdlclose
 #define SYS_xdlsym __NR_xdlsym
@@ -557,6 +557,9 @@ struct __ATTR_PACKED exception_data_filesystem_error {
 #define ERROR_NET_CONNECTION_REFUSED     0x000f /* [ERRNO(ECONNREFUSED)]    Failed to connect to an address with no one listen(2)-ing on the other end. */
 #define ERROR_NET_ADDRESS_IN_USE         0x0010 /* [ERRNO(EADDRINUSE)]      Local address is already in use (mainly by `bind()'). */
 #define ERROR_NET_PACKET_TOO_LARGE       0x0011 /* [ERRNO(EMSGSIZE)]        A packet is too large for the associated protocol. */
+#define ERROR_NET_ADDRESS_NOT_AVAILABLE  0x0012 /* [ERRNO(EADDRNOTAVAIL)]   The local address passed to `bind()' isn't assigned to any interface. */
+#define ERROR_NET_NETWORK_UNREACHABLE    0x0013 /* [ERRNO(ENETUNREACH)]     No route exists to reach the address passed to `connect()' or `sendto()'. */
+#define ERROR_NET_BROKEN_PIPE            0x0014 /* [ERRNO(EPIPE)]           Cannot `write(2)' or `send(2)' after the other end of the connection was closed. */
 #endif /* !ERROR_NET_NOERROR */
 #ifndef __exception_data_net_error_defined
 #define __exception_data_net_error_defined 1
@@ -0,0 +1,204 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef _KOS_IORING_H
+#define _KOS_IORING_H 1
+
+#include <__stdinc.h>
+#include <features.h>
+#include <bits/types.h>
+
+__DECL_BEGIN
+
+/* Asynchronous I/O rings.
+ * An I/O ring is a pair of queues living in user-space memory:
+ *   - The submission queue (SQ), to which user-space appends
+ *     descriptors of I/O operations (`struct ioring_sqe').
+ *   - The completion queue (CQ), to which the kernel appends
+ *     the results of those operations (`struct ioring_cqe').
+ * Both queues are single-producer/single-consumer ring buffers
+ * indexed by free-running 32-bit counters that are masked with
+ * `*_mask' in order to get the index of the associated entry.
+ * >> struct ioring_params p;
+ * >> p.ip_sq_entries = 64;
+ * >> p.ip_cq_entries = 128;
+ * >> p.ip_flags      = 0;
+ * >> p.ip_workers    = 0;
+ * >> p.ip_sq = (struct ioring_sq *)malloc(IORING_SQ_SIZEOF(64));
+ * >> p.ip_cq = (struct ioring_cq *)malloc(IORING_CQ_SIZEOF(128));
+ * >> ring = ioring_setup(&p,O_CLOEXEC);
+ * >> ...
+ * >> sqe = &p.ip_sq->sq_entries[p.ip_sq->sq_tail & p.ip_sq->sq_mask];
+ * >> sqe->sqe_opcode = IORING_OP_READ;
+ * >> ...
+ * >> __atomic_store_n(&p.ip_sq->sq_tail,p.ip_sq->sq_tail+1,__ATOMIC_RELEASE);
+ * >> ioring_enter(ring,1,1,IORING_ENTER_FGETEVENTS);
+ * >> while (p.ip_cq->cq_head != __atomic_load_n(&p.ip_cq->cq_tail,__ATOMIC_ACQUIRE)) {
+ * >>     cqe = &p.ip_cq->cq_entries[p.ip_cq->cq_head & p.ip_cq->cq_mask];
+ * >>     ...
+ * >>     ++p.ip_cq->cq_head;
+ * >> }
+ * Operations that can be completed immediately (e.g.: reads from
+ * a socket with pending data, or from a file) are executed while
+ * submitting them, and their completion is available once
+ * `ioring_enter()' returns.
+ * All other operations are handed to worker threads of the ring,
+ * such that one thread can keep many blocking operations in flight.
+ * NOTE: The ring's memory is only accessed from within `ioring_enter()',
+ *       meaning that it is only ever updated at well-defined points.
+ * NOTE: Only the VM that created the ring may enter it. */
+
+#define IORING_OP_NOP        0x00 /* Do nothing (`cqe_result' is 0) */
+#define IORING_OP_READ       0x01 /* pread(sqe_fd,sqe_addr,sqe_len,sqe_off)  (`read()' if `sqe_off == IORING_OFF_CURRENT') */
+#define IORING_OP_WRITE      0x02 /* pwrite(sqe_fd,sqe_addr,sqe_len,sqe_off) (`write()' if `sqe_off == IORING_OFF_CURRENT') */
+#define IORING_OP_FSYNC      0x03 /* fsync(sqe_fd) */
+#define IORING_OP_FDATASYNC  0x04 /* fdatasync(sqe_fd) */
+#define IORING_OP_POLL_ADD   0x05 /* Wait for any of `sqe_opflags' (Set of `POLL*') to become signaled.
+                                   * `cqe_result' is set to the mask of signaled events. */
+#define IORING_OP_ACCEPT     0x06 /* accept4(sqe_fd,NULL,NULL,sqe_opflags) (`cqe_result' is the new fd) */
+#define IORING_OP_RECV       0x07 /* recv(sqe_fd,sqe_addr,sqe_len,sqe_opflags) */
+#define IORING_OP_SEND       0x08 /* send(sqe_fd,sqe_addr,sqe_len,sqe_opflags) */
+#define IORING_OP_COUNT      0x09 /* Amount of known operations. */
+
+#define IORING_OFF_CURRENT  ((__uint64_t)-1) /* Use (and update) the file's current position. */
+
+#ifdef __CC__
+struct ioring_sqe {
+    /* Submission queue entry. */
+    __uint8_t            sqe_opcode;    /* The operation to perform (One of `IORING_OP_*') */
+#define IORING_SQE_FNORMAL      0x00    /* Normal flags. */
+#define IORING_SQE_FFIXED_FILE  0x01    /* `sqe_fd' is an index into the registered file vector (`IORING_REGISTER_FILES') */
+#define IORING_SQE_FFIXED_BUFFER 0x02   /* `sqe_addr...+=sqe_len' lies within the registered buffer `sqe_buf_index' (`IORING_REGISTER_BUFFERS') */
+#define IORING_SQE_FASYNC       0x04    /* Always execute the operation on a worker thread. */
+    __uint8_t            sqe_flags;     /* Set of `IORING_SQE_F*' */
+    __uint16_t           sqe_buf_index; /* [valid_if(IORING_SQE_FFIXED_BUFFER)] Index of a registered buffer. */
+    __int32_t            sqe_fd;        /* File descriptor (or registered file index) to operate on. */
+    __uint64_t           sqe_off;       /* [IORING_OP_READ|IORING_OP_WRITE] File offset, or `IORING_OFF_CURRENT' */
+    __uint64_t           sqe_addr;      /* [IORING_OP_READ|IORING_OP_WRITE|IORING_OP_RECV|IORING_OP_SEND] Buffer address. */
+    __uint32_t           sqe_len;       /* [IORING_OP_READ|IORING_OP_WRITE|IORING_OP_RECV|IORING_OP_SEND] Buffer size. */
+    __uint32_t           sqe_opflags;   /* Operation-specific flags (`POLL*', `SOCK_*' or `MSG_*') */
+    __uint64_t           sqe_data;      /* User-defined data, copied into `cqe_data' */
+};
+
+struct ioring_cqe {
+    /* Completion queue entry. */
+    __uint64_t           cqe_data;      /* The `sqe_data' field of the associated submission. */
+    __int64_t            cqe_result;    /* [valid_if(cqe_error == E_OK)] Operation result (Usually the number of transferred bytes) */
+    __uint16_t           cqe_error;     /* `E_OK' on success, or the `except_t' code of the exception that caused the operation to fail. */
+    __uint16_t           cqe_flags;     /* Set of `IORING_CQE_F*' */
+#define IORING_CQE_FNORMAL      0x0000  /* Normal flags. */
+#define IORING_CQE_FASYNC       0x0001  /* The operation was executed by a worker thread. */
+    __uint32_t         __cqe_pad;       /* ... */
+};
+
+struct ioring_sq {
+    __uint32_t           sq_head;       /* [lock(WRITE(KERNEL))] Index of the next entry that will be consumed by the kernel. */
+    __uint32_t           sq_tail;       /* [lock(WRITE(USER))] Index past the last entry submitted by user-space. */
+    __uint32_t           sq_mask;       /* [const] Index mask (`ip_sq_entries-1') */
+    __uint32_t         __sq_pad;        /* ... */
+    struct ioring_sqe    sq_entries[1]; /* [ip_sq_entries] Submission queue entries. */
+};
+#define IORING_SQ_SIZEOF(entries) \
+   (__builtin_offsetof(struct ioring_sq,sq_entries)+(entries)*sizeof(struct ioring_sqe))
+
+struct ioring_cq {
+    __uint32_t           cq_head;       /* [lock(WRITE(USER))] Index of the next entry that will be consumed by user-space. */
+    __uint32_t           cq_tail;       /* [lock(WRITE(KERNEL))] Index past the last completion written by the kernel. */
+    __uint32_t           cq_mask;       /* [const] Index mask (`ip_cq_entries-1') */
+    __uint32_t           cq_overflow;   /* [lock(WRITE(KERNEL))] Number of completions currently held back by the kernel,
+                                         * because the completion queue was full. They will be written by the next call to
+                                         * `ioring_enter()' that finds the queue with free space. */
+    struct ioring_cqe    cq_entries[1]; /* [ip_cq_entries] Completion queue entries. */
+};
+#define IORING_CQ_SIZEOF(entries) \
+   (__builtin_offsetof(struct ioring_cq,cq_entries)+(entries)*sizeof(struct ioring_cqe))
+
+struct ioring_params {
+    __uint32_t           ip_sq_entries; /* [in] Number of submission queue entries (power of 2; 1...IORING_MAX_ENTRIES) */
+    __uint32_t           ip_cq_entries; /* [in] Number of completion queue entries (power of 2; >= ip_sq_entries, or 0 for `2*ip_sq_entries') */
+#define IORING_SETUP_FNORMAL 0x0000     /* Normal flags. */
+#define IORING_SETUP_FINLINE 0x0001     /* Never hand operations to worker threads and execute everything while
+                                         * submitting, blocking if necessary (`IORING_SQE_FASYNC' is ignored) */
+    __uint32_t           ip_flags;      /* [in] Set of `IORING_SETUP_F*' */
+    __uint32_t           ip_workers;    /* [in] Max number of worker threads (1...IORING_MAX_WORKERS; 0 for `IORING_DEFAULT_WORKERS') */
+    struct ioring_sq    *ip_sq;         /* [1..1][in] Submission queue memory (`IORING_SQ_SIZEOF(ip_sq_entries)' bytes) */
+    struct ioring_cq    *ip_cq;         /* [1..1][in] Completion queue memory (`IORING_CQ_SIZEOF(ip_cq_entries)' bytes) */
+};
+#endif /* __CC__ */
+
+#define IORING_MAX_ENTRIES     4096
+#define IORING_MAX_WORKERS     64
+#define IORING_DEFAULT_WORKERS 4
+#define IORING_MAX_REGISTER    1024 /* Max number of registered buffers/files. */
+
+/* Flags for `ioring_enter()' */
+#define IORING_ENTER_FNORMAL    0x0000 /* Normal flags. */
+#define IORING_ENTER_FGETEVENTS 0x0001 /* Wait until `min_complete' completions are available in the CQ. */
+
+/* Opcodes for `ioring_register()' */
+#define IORING_REGISTER_BUFFERS   0x0000 /* Register `nr_args' buffers from `(struct iovec *)arg' */
+#define IORING_UNREGISTER_BUFFERS 0x0001 /* Unregister all buffers (`arg' and `nr_args' are ignored) */
+#define IORING_REGISTER_FILES     0x0002 /* Register `nr_args' file descriptors from `(fd_t *)arg' */
+#define IORING_UNREGISTER_FILES   0x0003 /* Unregister all files (`arg' and `nr_args' are ignored) */
+
+
+#ifdef __CC__
+#if !defined(__KERNEL__) && defined(__CRT_KOS)
+/* Create a new I/O ring, using memory described by `PARAMS'.
+ * Upon success, the SQ and CQ control words are initialized.
+ * @param: FLAGS: Set of `O_CLOEXEC|O_CLOFORK'
+ * @return: * : A file descriptor for the new ring.
+ * @throw: E_INVALID_ARGUMENT: Invalid entry counts, or flags.
+ * @throw: E_SEGFAULT:         The parameter block, or the ring memory is faulty. */
+__REDIRECT_EXCEPT(__LIBC,__WUNUSED,__fd_t,__LIBCCALL,ioring_setup,
+                 (struct ioring_params const *__params, __oflag_t __flags),
+                 (__params,__flags))
+
+/* Submit up to `TO_SUBMIT' entries from the SQ, copy available
+ * completions into the CQ and (when `IORING_ENTER_FGETEVENTS' is
+ * set) wait until at least `MIN_COMPLETE' of them are available.
+ * @param: FLAGS: Set of `IORING_ENTER_F*'
+ * @return: * : The number of submitted entries.
+ * @throw: E_ILLEGAL_OPERATION: The calling VM isn't the one that created the ring. */
+__REDIRECT_EXCEPT(__LIBC,,__EXCEPT_SELECT(unsigned int,int),__LIBCCALL,ioring_enter,
+                 (__fd_t __ring, unsigned int __to_submit, unsigned int __min_complete, unsigned int __flags),
+                 (__ring,__to_submit,__min_complete,__flags))
+
+/* Register buffers or files with the given ring.
+ * Registered files can be referenced using `IORING_SQE_FFIXED_FILE', which
+ * saves the per-operation file descriptor lookup, and registered buffers using
+ * `IORING_SQE_FFIXED_BUFFER', which saves the per-operation buffer validation.
+ * @param: OPCODE: One of `IORING_(UN)REGISTER_*'
+ * @throw: E_INVALID_ARGUMENT: The ring already has registered buffers/files.
+ * @throw: E_INVALID_HANDLE:   One of the given file descriptors is invalid,
+ *                             or refers to an I/O ring. */
+__REDIRECT_EXCEPT_XVOID(__LIBC,,int,__LIBCCALL,ioring_register,
+                 (__fd_t __ring, unsigned int __opcode, void *__arg, unsigned int __nr_args),
+                 (__ring,__opcode,__arg,__nr_args))
+
+#ifdef __USE_EXCEPT
+__LIBC __WUNUSED __fd_t (__LIBCCALL Xioring_setup)(struct ioring_params const *__params, __oflag_t __flags);
+__LIBC unsigned int (__LIBCCALL Xioring_enter)(__fd_t __ring, unsigned int __to_submit, unsigned int __min_complete, unsigned int __flags);
+__LIBC void (__LIBCCALL Xioring_register)(__fd_t __ring, unsigned int __opcode, void *__arg, unsigned int __nr_args);
+#endif /* __USE_EXCEPT */
+#endif /* !__KERNEL__ && __CRT_KOS */
+#endif /* __CC__ */
+
+__DECL_END
+
+#endif /* !_KOS_IORING_H */
@@ -106,30 +106,75 @@ struct ushare_strerror {
 
 
 
-/* A VIO-based ushare segment containing process information.
+/* A ushare segment containing process information.
  * When mapped, memory contents can be read as the following structure.
- * NOTE: This is less a useful memory mapping and more a demonstration
- *       of the VIO functionality of the KOS kernel, as this memory
- *       mapping doesn't actually have any real physical memory backing
- *       its contents, but rather uses virtual I/O mappings (emulated
- *       memory access) in order to implement what appears to be regular
- *       memory access.
- *       However, on the kernel-side, there's a function
- *       >> u32 procinfo_getl(uintptr_t address);
- *       that is invoked whenever user-space assembly accesses any part
- *       of the procinfo memory mappings (sorry to ruin the magic...) */
+ * Unlike the Mk2 version of this segment (and unlike `USHARE_PROCCTL_FNAME'),
+ * the PROCINFO segment is backed by real memory, meaning that reading its
+ * fields is just as fast as reading any other memory location:
+ *   - The first page is shared between all processes and contains system-wide
+ *     information. The kernel's tick counter is stored directly within this
+ *     page, so `pi_time' is always up-to-date without any extra overhead.
+ *   - The second page is private to the calling process and updated by the
+ *     kernel whenever its process group, session or parent changes.
+ * NOTE: Processes sharing the same VM (`vfork()' / `CLONE_VM') also share
+ *       the per-process page, which always describes the process that created
+ *       it. A vfork()-ed child should therefor not rely on `pi_pid'.
+ * HINT: For the calling thread's TID, use `ts_tid' from the user task segment
+ *       (`struct user_task_segment' from `<kos/thread.h>'), which is just as
+ *       fast to access, but can also be read without having to map anything. */
 #define USHARE_PROCINFO_FNAME         USHARE_NAME('K','p')
-#define USHARE_PROCINFO_FSIZE \
-      ((sizeof(struct ushare_procinfo)+(__PAGESIZE-1)) & ~(__PAGESIZE-1))
+#define USHARE_PROCINFO_FSIZE       (2*__PAGESIZE)
+#define USHARE_PROCINFO_OFFSETOF_PROCESS  __PAGESIZE /* Offset of the per-process page. */
 #ifdef __CC__
 struct ushare_procinfo {
-    volatile __UINT32_TYPE__      pi_tid;        /* The calling thread's TID. */
+    /* System-wide page. */
+    volatile __UINT64_TYPE__      pi_time;       /* The current system time in jiffies. */
+    volatile __UINT32_TYPE__      pi_hz;         /* The number of jiffies passing every second. */
+#define USHARE_PROCINFO_TSC_FNORMAL    0x0000     /* The TSC frequency is unknown. */
+#define USHARE_PROCINFO_TSC_FCALIBRATED 0x0001    /* `pi_tschz' was calibrated and may be used to convert TSC cycles. */
+#define USHARE_PROCINFO_TSC_FINVARIANT 0x0002     /* The TSC ticks at a constant rate, regardless of power-states (CPUID.80000007H:EDX[8]).
+                                                   * When this flag isn't set, TSC-based time measurements may drift. */
+    volatile __UINT32_TYPE__      pi_tscflags;   /* Set of `USHARE_PROCINFO_TSC_F*' */
+    volatile __UINT64_TYPE__      pi_tschz;      /* [valid_if(pi_tscflags & USHARE_PROCINFO_TSC_FCALIBRATED)]
+                                                  * The number of TSC cycles passing every second (as calibrated by the boot CPU).
+                                                  * HINT: This is the unit used by the kernel for CPU time accounting. */
+    __UINT8_TYPE__              __pi_pad1[__PAGESIZE-24];
+    /* Per-process page. */
     volatile __UINT32_TYPE__      pi_pid;        /* The calling process's PID. */
-    volatile __UINT32_TYPE__      pi_ppid;       /* The calling process parent PID. */
+    volatile __UINT32_TYPE__      pi_ppid;       /* The calling process parent PID (ONE(1) once the parent has terminated). */
     volatile __UINT32_TYPE__      pi_gpid;       /* The calling process group's GPID. */
     volatile __UINT32_TYPE__      pi_sid;        /* The calling process group's session id. */
-    volatile __UINT32_TYPE__      pi_hz;         /* The number of jiffies passing every second. */
-    volatile __UINT64_TYPE__      pi_time;       /* The current system time in jiffies. */
+    __UINT8_TYPE__              __pi_pad2[__PAGESIZE-16];
+};
+#endif
+
+
+/* A VIO-based ushare segment containing thread information and controls.
+ * When mapped, memory contents can be read as the following structure.
+ * NOTE: This segment doesn't actually have any real physical memory backing
+ *       its contents, but rather uses virtual I/O mappings (emulated memory
+ *       access) in order to implement what appears to be regular memory access.
+ *       This makes every access about as expensive as a system call, meaning
+ *       that it should only be used for fields that must have side-effects,
+ *       or describe the calling thread.
+ *       However, on the kernel-side, there's a function
+ *       >> u32 procctl_readl(uintptr_t address);
+ *       that is invoked whenever user-space assembly accesses any part
+ *       of the procctl memory mappings (sorry to ruin the magic...) */
+#define USHARE_PROCCTL_FNAME          USHARE_NAME('K','c')
+#define USHARE_PROCCTL_FSIZE \
+      ((sizeof(struct ushare_procctl)+(__PAGESIZE-1)) & ~(__PAGESIZE-1))
+#ifdef __CC__
+struct ushare_procctl {
+    volatile __UINT32_TYPE__      pc_tid;        /* The calling thread's TID. */
+    volatile __UINT32_TYPE__      pc_exit;       /* Writing to this field will cause the calling thread to exit with the value written as status. */
+    volatile __UINT32_TYPE__      pc_exit_group; /* Writing to this field will cause the calling process to exit with the value written as status. */
+    volatile __UINT32_TYPE__      pc_rand;       /* Evaluates to a 32-bit pseudo-random integer every time it is read from (using the kernel's `rand()' function) */
+    volatile __UINT32_TYPE__      pc_counter;    /* Returns how often this field has already been read from.
+                                                  * NOTE: The counter for this is system-wide and incremented atomically,
+                                                  *       meaning you could use this to generate system-wide unique IDs.
+                                                  *       However, there is no way of safely detecting when it overflows... */
+    __UINT32_TYPE__             __pc_pad;        /* ... */
     struct {
         volatile __UINT64_TYPE__  t_start;       /* The time (in jiffies) when the current thread was started. */
         volatile __UINT32_TYPE__  t_hswitch;     /* Amount of times the thread was preempted while in kernel-space. */
@@ -139,14 +184,12 @@ struct ushare_procinfo {
         volatile __UINT32_TYPE__  t_sleep;       /* Amount of times the thread entered a sleeping-state. */
         volatile __UINT32_TYPE__  t_xrpc;        /* Amount of RPC functions served by this thread (including those send by the thread itself). */
         volatile __UINT32_TYPE__  t_qrpc;        /* Amount of RPC functions queued (sent) by this thread (for execution by other threads, or the thread itself). */
-    }                             pi_thread;     /* Statistical information about the calling thread. */
-    volatile __UINT32_TYPE__      pi_exit;       /* Writing to this field will cause the calling thread to exit with the value written as status. */
-    volatile __UINT32_TYPE__      pi_exit_group; /* Writing to this field will cause the calling process to exit with the value written as status. */
-    volatile __UINT32_TYPE__      pi_rand;       /* Evaluates to a 32-bit pseudo-random integer every time it is read from (using the kernel's `rand()' function) */
-    volatile __UINT32_TYPE__      pi_counter;    /* Returns how often this field has already been read from.
-                                                  * NOTE: The counter for this is system-wide and incremented atomically,
-                                                  *       meaning you could use this to generate system-wide unique IDs.
-                                                  *       However, there is no way of safely detecting when it overflows... */
+        __UINT32_TYPE__         __t_pad;         /* ... (Keep the following fields 8-byte aligned on all architectures) */
+        volatile __UINT64_TYPE__  t_utime;       /* Time (in nanoseconds) spent by the calling thread executing in user-space. */
+        volatile __UINT64_TYPE__  t_stime;       /* Time (in nanoseconds) spent by the calling thread executing in kernel-space. */
+        volatile __UINT64_TYPE__  t_irqtime;     /* Time (in nanoseconds) spent servicing hardware interrupts while the calling thread was running. */
+        volatile __UINT64_TYPE__  t_waittime;    /* Time (in nanoseconds) the calling thread spent ready to run, but waiting for a CPU. */
+    }                             pc_thread;     /* Statistical information about the calling thread. */
 };
 #endif
 
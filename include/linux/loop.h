@@ -0,0 +1,51 @@
+#ifndef _LINUX_LOOP_H
+#define _LINUX_LOOP_H 1
+
+/* Taken from '/usr/include/linux/loop.h' before being modified. */
+
+#include <__stdinc.h>
+#include "types.h"
+
+__DECL_BEGIN
+
+#define LO_NAME_SIZE    64
+#define LO_KEY_SIZE     32
+
+/* Loop device flags (`lo_flags') */
+#define LO_FLAGS_READ_ONLY  1  /* The loop device is read-only. */
+#define LO_FLAGS_AUTOCLEAR  4  /* Automatically unbind the backing file once the device is no longer used. */
+#define LO_FLAGS_PARTSCAN   8  /* Scan the device for partitions. (Ignored) */
+#define LO_FLAGS_DIRECT_IO  16 /* Bypass buffering. (Always the case in KOS) */
+
+struct loop_info64 {
+    __u64 lo_device;                    /* `st_dev' of the backing file. */
+    __u64 lo_inode;                     /* `st_ino' of the backing file. */
+    __u64 lo_rdevice;                   /* Device number of the loop device. */
+    __u64 lo_offset;                    /* Offset into the backing file where the device starts. */
+    __u64 lo_sizelimit;                 /* Max number of bytes (0 == Max available) */
+    __u32 lo_number;                    /* Loop device number. */
+    __u32 lo_encrypt_type;              /* Unsupported (Must be 0) */
+    __u32 lo_encrypt_key_size;          /* Unsupported (Must be 0) */
+    __u32 lo_flags;                     /* Set of `LO_FLAGS_*' */
+    __u8  lo_file_name[LO_NAME_SIZE];   /* Name of the backing file (informational) */
+    __u8  lo_crypt_name[LO_NAME_SIZE];  /* Unsupported */
+    __u8  lo_encrypt_key[LO_KEY_SIZE];  /* Unsupported */
+    __u64 lo_init[2];                   /* Unsupported */
+};
+
+/* IOCTL commands for loop devices (`/dev/loop*') */
+#define LOOP_SET_FD          0x4c00 /* Bind to the file `(int)arg' */
+#define LOOP_CLR_FD          0x4c01 /* Unbind the backing file. */
+#define LOOP_SET_STATUS64    0x4c04 /* Set the offset/size-limit/flags (`struct loop_info64 *arg') */
+#define LOOP_GET_STATUS64    0x4c05 /* Get information about the binding (`struct loop_info64 *arg') */
+#define LOOP_SET_CAPACITY    0x4c07 /* Re-read the size of the backing file. */
+#define LOOP_SET_BLOCK_SIZE  0x4c09 /* Set the logical sector size to `(unsigned long)arg' */
+
+/* IOCTL commands for `/dev/loop-control' */
+#define LOOP_CTL_ADD         0x4c80 /* Create the loop device `(int)arg' */
+#define LOOP_CTL_REMOVE      0x4c81 /* Remove the (unbound) loop device `(int)arg' */
+#define LOOP_CTL_GET_FREE    0x4c82 /* Return the number of an unbound loop device (creating one if necessary) */
+
+__DECL_END
+
+#endif /* !_LINUX_LOOP_H */
@@ -0,0 +1,110 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef _SPAWN_H
+#define _SPAWN_H 1
+
+#include <__stdinc.h>
+#include <features.h>
+#include <sched.h>
+#include <bits/types.h>
+#include <bits/sigset.h>
+
+#ifndef __CRT_GLC
+#error "<spawn.h> is not supported by the linked libc"
+#endif /* !__CRT_GLC */
+
+__SYSDECL_BEGIN
+
+/* Flags for `posix_spawnattr_setflags()' */
+#define POSIX_SPAWN_RESETIDS      0x01 /* Reset the effective user/group IDs to the real ones. */
+#define POSIX_SPAWN_SETPGROUP     0x02 /* Set the child's process group (s.a. `posix_spawnattr_setpgroup()') */
+#define POSIX_SPAWN_SETSIGDEF     0x04 /* Reset the signals from `posix_spawnattr_setsigdefault()' to `SIG_DFL' */
+#define POSIX_SPAWN_SETSIGMASK    0x08 /* Set the child's signal mask (s.a. `posix_spawnattr_setsigmask()') */
+#define POSIX_SPAWN_SETSCHEDPARAM 0x10 /* Set the child's scheduling parameters. */
+#define POSIX_SPAWN_SETSCHEDULER  0x20 /* Set the child's scheduling policy. */
+#ifdef __USE_GNU
+#define POSIX_SPAWN_USEVFORK      0x40 /* Ignored (KOS always uses `vfork()') */
+#endif /* __USE_GNU */
+
+#ifdef __CC__
+#ifndef __pid_t_defined
+#define __pid_t_defined 1
+typedef __pid_t pid_t;
+#endif /* !__pid_t_defined */
+
+typedef struct {
+    short              __flags;   /* Set of `POSIX_SPAWN_*' */
+    __pid_t            __pgrp;    /* Process group for `POSIX_SPAWN_SETPGROUP' */
+    __sigset_t         __sd;      /* Signals for `POSIX_SPAWN_SETSIGDEF' */
+    __sigset_t         __ss;      /* Signal mask for `POSIX_SPAWN_SETSIGMASK' */
+    struct sched_param __sp;      /* Parameters for `POSIX_SPAWN_SETSCHEDPARAM' */
+    int                __policy;  /* Policy for `POSIX_SPAWN_SETSCHEDULER' */
+    int                __pad[16];
+} posix_spawnattr_t;
+
+struct __spawn_action;
+typedef struct {
+    int                    __allocated; /* Allocated number of actions. */
+    int                    __used;      /* Number of used actions. */
+    struct __spawn_action *__actions;   /* [0..__used|ALLOC(__allocated)][owned] Vector of actions. */
+    int                    __pad[16];
+} posix_spawn_file_actions_t;
+
+#ifndef __KERNEL__
+/* Spawn a new process executing `path' (or `file', which is searched for in $PATH).
+ * The child is created using `vfork()', meaning that the caller's address space
+ * is never copied, before `file_actions' and `attrp' are applied, and `exec()' is called.
+ * @return: 0 :     The child was started and its PID was stored in `*pid' (if non-NULL)
+ * @return: errno : Failed to start the child (no child process remains in this case) */
+__LIBC __PORT_NODOS int (__LIBCCALL posix_spawn)(__pid_t *__restrict __pid, char const *__restrict __path,
+                                                  posix_spawn_file_actions_t const *__file_actions,
+                                                  posix_spawnattr_t const *__restrict __attrp,
+                                                  char *const __argv[__restrict_arr],
+                                                  char *const __envp[__restrict_arr]);
+__LIBC __PORT_NODOS int (__LIBCCALL posix_spawnp)(__pid_t *__pid, char const *__file,
+                                                   posix_spawn_file_actions_t const *__file_actions,
+                                                   posix_spawnattr_t const *__attrp,
+                                                   char *const __argv[], char *const __envp[]);
+
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawnattr_init)(posix_spawnattr_t *__attr);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawnattr_destroy)(posix_spawnattr_t *__attr);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getsigdefault)(posix_spawnattr_t const *__restrict __attr, __sigset_t *__restrict __sigdefault);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_setsigdefault)(posix_spawnattr_t *__restrict __attr, __sigset_t const *__restrict __sigdefault);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getsigmask)(posix_spawnattr_t const *__restrict __attr, __sigset_t *__restrict __sigmask);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_setsigmask)(posix_spawnattr_t *__restrict __attr, __sigset_t const *__restrict __sigmask);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getflags)(posix_spawnattr_t const *__restrict __attr, short int *__restrict __flags);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawnattr_setflags)(posix_spawnattr_t *__attr, short int __flags);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getpgroup)(posix_spawnattr_t const *__restrict __attr, __pid_t *__restrict __pgroup);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawnattr_setpgroup)(posix_spawnattr_t *__attr, __pid_t __pgroup);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getschedpolicy)(posix_spawnattr_t const *__restrict __attr, int *__restrict __schedpolicy);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawnattr_setschedpolicy)(posix_spawnattr_t *__attr, int __schedpolicy);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_getschedparam)(posix_spawnattr_t const *__restrict __attr, struct sched_param *__restrict __schedparam);
+__LIBC __PORT_NODOS __NONNULL((1,2)) int (__LIBCCALL posix_spawnattr_setschedparam)(posix_spawnattr_t *__restrict __attr, struct sched_param const *__restrict __schedparam);
+
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawn_file_actions_init)(posix_spawn_file_actions_t *__file_actions);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawn_file_actions_destroy)(posix_spawn_file_actions_t *__file_actions);
+__LIBC __PORT_NODOS __NONNULL((1,3)) int (__LIBCCALL posix_spawn_file_actions_addopen)(posix_spawn_file_actions_t *__restrict __file_actions, __fd_t __fd, char const *__restrict __path, int __oflag, __mode_t __mode);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawn_file_actions_addclose)(posix_spawn_file_actions_t *__file_actions, __fd_t __fd);
+__LIBC __PORT_NODOS __NONNULL((1)) int (__LIBCCALL posix_spawn_file_actions_adddup2)(posix_spawn_file_actions_t *__file_actions, __fd_t __fd, __fd_t __newfd);
+#endif /* !__KERNEL__ */
+#endif /* __CC__ */
+
+__SYSDECL_END
+
+#endif /* !_SPAWN_H */
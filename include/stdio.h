@@ -550,6 +550,49 @@ __REDIRECT_EXCEPT(__LIBC,,__ssize_t,__LIBCCALL,file_printer_unlocked,(char const
 #endif /* __USE_KOS3 */
 #endif
 #endif /* __USE_KOS */
+
+#if defined(__CRT_KOS) && !defined(__DOS_COMPAT__) && \
+   !defined(__GLC_COMPAT__) && !defined(__CYG_COMPAT__) && \
+   !defined(__BUILDING_LIBC) && !defined(__NO_INLINE__) && \
+   !defined(__cplusplus)
+#ifndef _BITS_IO_FILE_H
+#include <bits/io-file.h>
+#endif /* !_BITS_IO_FILE_H */
+/* Inline fast-paths for reading characters from already loaded buffer data.
+ * `__f_cnt' is the number of unread bytes at `__f_ptr', and only when it is
+ * exhausted do we have to call into libc in order to load more data.
+ * Locked functions may only do this while the process is single-threaded,
+ * as libc won't be acquiring the stream's lock during that time either.
+ * NOTE: Writes aren't inlined, because their bookkeeping is private to libc. */
+#ifndef ____libc_single_threaded_defined
+#define ____libc_single_threaded_defined 1
+__LIBC char __libc_single_threaded;
+#endif /* !____libc_single_threaded_defined */
+__REDIRECT_EXCEPT_(__LIBC,__WUNUSED_SUGGESTED,int,__LIBCCALL,__fgetc_locked,(__FILE *__stream),fgetc,(__stream))
+__REDIRECT_EXCEPT_(__LIBC,__WUNUSED_SUGGESTED,int,__LIBCCALL,__fgetc_nolock,(__FILE *__stream),fgetc_unlocked,(__stream))
+__LOCAL __WUNUSED_SUGGESTED int (__LIBCCALL __getc_unlocked_inline)(__FILE *__stream) {
+ if __likely(__stream->__f_cnt > 0) {
+  --__stream->__f_cnt;
+  return (int)(unsigned char)*__stream->__f_ptr++;
+ }
+ return __fgetc_nolock(__stream);
+}
+__LOCAL __WUNUSED_SUGGESTED int (__LIBCCALL __getc_inline)(__FILE *__stream) {
+ if (!__libc_single_threaded)
+      return __fgetc_locked(__stream);
+ return __getc_unlocked_inline(__stream);
+}
+#define getc(stream)  __getc_inline(stream)
+#define fgetc(stream) __getc_inline(stream)
+#define getchar()     __getc_inline(stdin)
+#ifdef __USE_MISC
+#define fgetc_unlocked(stream) __getc_unlocked_inline(stream)
+#endif /* __USE_MISC */
+#ifdef __USE_POSIX
+#define getc_unlocked(stream)  __getc_unlocked_inline(stream)
+#define getchar_unlocked()     __getc_unlocked_inline(stdin)
+#endif /* __USE_POSIX */
+#endif /* __CRT_KOS && !__DOS_COMPAT__ && !__GLC_COMPAT__ && !__CYG_COMPAT__ && ... */
 #endif /* !__KERNEL__ */
 
 #ifndef ____libc_vsnprintf_defined
@@ -119,12 +119,35 @@ typedef __mode_t mode_t;
 #define MAP_HUGETLB       0x00040000 /* Create huge page mapping. */
 #define MAP_HUGE_SHIFT    26
 #define MAP_HUGE_MASK     0x3f
+#define MAP_HUGE_2MB     (21 << MAP_HUGE_SHIFT) /* Request 2MiB huge pages. */
+#define MAP_HUGE_4MB     (22 << MAP_HUGE_SHIFT) /* Request 4MiB huge pages. */
+#define MAP_HUGE_1GB     (30 << MAP_HUGE_SHIFT) /* Request 1GiB huge pages. */
 #define MAP_UNINITIALIZED 0x04000000 /* For anonymous mmap, memory could be uninitialized.
                                       * NOTE: Implied for physical mappings.
                                       * NOTE: The kernel may initialize memory randomly in sandboxed threads. */
 #endif /* __USE_MISC */
 
 
+/* Advice for `madvise()'. */
+#ifdef __USE_MISC
+#define MADV_NORMAL       0  /* No further special treatment. */
+#define MADV_RANDOM       1  /* Expect random page references. */
+#define MADV_SEQUENTIAL   2  /* Expect sequential page references. */
+#define MADV_WILLNEED     3  /* Will need these pages. */
+#define MADV_DONTNEED     4  /* Don't need these pages. */
+#define MADV_HUGEPAGE     14 /* Back this range using huge pages where possible (default). */
+#define MADV_NOHUGEPAGE   15 /* Never back this range using huge pages. */
+#endif /* __USE_MISC */
+
+/* Advice for `posix_madvise()'. */
+#ifdef __USE_XOPEN2K
+#define POSIX_MADV_NORMAL     0 /* No further special treatment. */
+#define POSIX_MADV_RANDOM     1 /* Expect random page references. */
+#define POSIX_MADV_SEQUENTIAL 2 /* Expect sequential page references. */
+#define POSIX_MADV_WILLNEED   3 /* Will need these pages. */
+#define POSIX_MADV_DONTNEED   4 /* Don't need these pages. */
+#endif /* __USE_XOPEN2K */
+
 /* Flags for 'mremap'. */
 #ifdef __USE_GNU
 #   define MREMAP_MAYMOVE 1
@@ -191,6 +191,9 @@ __SYSDECL_BEGIN
 #ifndef BLKGETSIZE64
 #define BLKGETSIZE64 _IOR(0x12,114,size_t) /* return device size. (u64 *arg) */
 #endif /* !BLKGETSIZE64 */
+#ifndef BLKDISCARD
+#define BLKDISCARD   _IO(0x12,119) /* Discard a range of sectors. (u64 const arg[2] = { offset, length } (in bytes)) */
+#endif /* !BLKDISCARD */
 
 /* Possible value for FLAGS parameter of `umount2'. */
 #ifndef MNT_FORCE
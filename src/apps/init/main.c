@@ -241,21 +241,12 @@ int main(int argc, char *argv[]) {
  {
   struct ushare_procinfo *base;
   base = map_procinfo();
-  syslog(LOG_DEBUG,"pi_tid              = %u\n",base->pi_tid);
   syslog(LOG_DEBUG,"pi_pid              = %u\n",base->pi_pid);
   syslog(LOG_DEBUG,"pi_ppid             = %u\n",base->pi_ppid);
   syslog(LOG_DEBUG,"pi_gpid             = %u\n",base->pi_gpid);
   syslog(LOG_DEBUG,"pi_sid              = %u\n",base->pi_sid);
   syslog(LOG_DEBUG,"pi_hz               = %u\n",base->pi_hz);
   syslog(LOG_DEBUG,"pi_time             = %u\n",base->pi_time);
-  syslog(LOG_DEBUG,"pi_thread.t_start   = %u\n",base->pi_thread.t_start);
-  syslog(LOG_DEBUG,"pi_thread.t_hswitch = %u\n",base->pi_thread.t_hswitch);
-  syslog(LOG_DEBUG,"pi_thread.t_uswitch = %u\n",base->pi_thread.t_uswitch);
-  syslog(LOG_DEBUG,"pi_thread.t_hyield  = %u\n",base->pi_thread.t_hyield);
-  syslog(LOG_DEBUG,"pi_thread.t_uyield  = %u\n",base->pi_thread.t_uyield);
-  syslog(LOG_DEBUG,"pi_thread.t_sleep   = %u\n",base->pi_thread.t_sleep);
-  syslog(LOG_DEBUG,"pi_thread.t_xrpc    = %u\n",base->pi_thread.t_xrpc);
-  syslog(LOG_DEBUG,"pi_thread.t_qrpc    = %u\n",base->pi_thread.t_qrpc);
  }
 #endif
  kernctl(KERNEL_CONTROL_DBG_DUMP_LEAKS);
@@ -95,6 +95,7 @@ term_palettes[TERM_PALETTES] = {
 #define PUTIMG(image)        (*SELF->tr_ops.to_putimg)(SELF,image)
 #define GET_CELL_SIZE(x,y)   (*SELF->tr_ops.to_get_cell_size)(SELF,&(x),&(y))
 #define OUTPUT(text)         (*SELF->tr_ops.to_output)(SELF,text)
+#define ALTSCREEN(cmd)       (*SELF->tr_ops.to_altscreen)(SELF,cmd)
 
 #define STUB  ATTR_COLDTEXT
 
@@ -164,6 +165,10 @@ PRIVATE STUB void TCALL stub_set_title(struct term *UNUSED(self), char *UNUSED(t
 PRIVATE STUB void TCALL stub_putimg(struct term *self, struct term_rgba image[]) { (void)image; PUTC('?'); }
 PRIVATE STUB void TCALL stub_get_cell_size(struct term *UNUSED(self), size_t *x, size_t *y) { *x = *y = 8; }
 PRIVATE STUB void TCALL stub_output(struct term *UNUSED(self), char *UNUSED(text)) {}
+PRIVATE STUB void TCALL stub_altscreen(struct term *self, int cmd) {
+ /* Without a second screen, at least make sure that it starts out empty. */
+ if (cmd == TERM_ALTSCREEN_YES) { CLS(TERM_CLS_ALL); SET_CURSOR(0,0); }
+}
 
 #define UPDATE_FG_PALETTE() \
  (SELF->tr_fg = SELF->tr_palette_sel->tp_colors[SELF->tr_palette_idx & 0x0f])
@@ -229,6 +234,7 @@ term_init(struct term *__restrict self,
  if (!self->tr_ops.to_putimg)        self->tr_ops.to_putimg        = &stub_putimg;
  if (!self->tr_ops.to_get_cell_size) self->tr_ops.to_get_cell_size = &stub_get_cell_size;
  if (!self->tr_ops.to_output)        self->tr_ops.to_output        = &stub_output;
+ if (!self->tr_ops.to_altscreen)     self->tr_ops.to_altscreen     = &stub_altscreen;
  term_selpalette(self,TERM_PALETTE(TERM_DEFAULT_FG,TERM_DEFAULT_BG));
  return self;
 //err_ansiargv: free(ansi_argv);
@@ -489,7 +495,8 @@ enter_escape_mode:
   case ANSI_SHOW:
    if (ARGC && ARGV[0][0] == '?') {
     switch (atoi(ARGV[0]+1)) {
-    case 1049: CLS(TERM_CLS_ALL); SET_CURSOR(0,0); break;
+    case 47: case 1047:
+    case 1049: ALTSCREEN(TERM_ALTSCREEN_YES); break;
     case 1000: self->tr_mouseon = TERM_MOUSEON_YES; break;
     case 1002: self->tr_mouseon = TERM_MOUSEON_WITHMOTION; break;
     case 25:   SHOW_CURSOR(TERM_SHOWCURSOR_YES); break;
@@ -501,7 +508,8 @@ enter_escape_mode:
   case ANSI_HIDE:
    if (ARGC && ARGV[0][0] == '?') {
     switch (atoi(ARGV[0]+1)) {
-    case 1049: /* TODO */ break;
+    case 47: case 1047:
+    case 1049: ALTSCREEN(TERM_ALTSCREEN_NO); break;
     case 1000:
     case 1002: self->tr_mouseon = TERM_MOUSEON_NO; break;
     case 25:   SHOW_CURSOR(TERM_SHOWCURSOR_NO); break;
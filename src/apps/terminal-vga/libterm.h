@@ -123,6 +123,12 @@ struct term_operations {
     void    (TERM_CALL *to_putimg)(struct term *term, struct term_rgba image[]);
     void    (TERM_CALL *to_get_cell_size)(struct term *term, size_t *x, size_t *y); /* Returns the size of a cell in pixels. */
     void    (TERM_CALL *to_output)(struct term *term, char *text); /*< Output `text' to the slave process (`write(amaster,text,strlen(text))'; amaster from <pty.h>:openpty) */
+#define TERM_ALTSCREEN_NO  0
+#define TERM_ALTSCREEN_YES 1
+    /* Switch to/from the alternate screen (`ESC[?1049h' / `ESC[?1049l').
+     * The alternate screen starts out empty, and leaving it restores the
+     * contents and cursor position of the main screen from before. */
+    void    (TERM_CALL *to_altscreen)(struct term *term, int cmd);
 };
 
 struct term {
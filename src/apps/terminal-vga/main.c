@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <format-printer.h>
 #include <hybrid/atomic.h>
+#include <hybrid/bit.h>
 #include <hybrid/compiler.h>
 #include <hybrid/sync/atomic-rwlock.h>
 #include <kos/types.h>
@@ -198,89 +199,79 @@ typedef uint16_t cell_t;
 PRIVATE int     vga_fd;
 #endif
 PRIVATE cell_t *vga_dev;
-PRIVATE cell_t *vga_buf,*vga_bufpos,*vga_bufend;
-PRIVATE cell_t *vga_bufsecondline,*vga_lastline;
-#define vga_spaceline   vga_bufend
 PRIVATE cell_t  vga_attrib;
 #define VGA_SIZE   (VTTY_WIDTH*VTTY_HEIGHT)
 #define CHR(x)    ((cell_t)(unsigned char)(x)|vga_attrib)
 #define SPACE       CHR(' ')
-#define INVCHR(x) ((cell_t)(unsigned char)(x)\
-   | ((cell_t)vga_invert[(vga_attrib&0xf000) >> 12] << 12)\
-   | ((cell_t)vga_invert[(vga_attrib&0x0f00) >> 8] << 8))
-
-
-// Cell/Line access
-#define DEV_CELL(x,y)  (vga_dev+(x)+(y)*VTTY_WIDTH)
-#define BUF_CELL(x,y)  (vga_buf+(x)+(y)*VTTY_WIDTH)
-#define DEV_LINE(y)    (vga_dev+(y)*VTTY_WIDTH)
-#define BUF_LINE(y)    (vga_buf+(y)*VTTY_WIDTH)
-#define DEV_CELL_CUR() (vga_dev+(vga_bufpos-vga_buf))
-#define BUF_CELL_CUR() (vga_bufpos)
-
-// Blit commands (swap buffers)
-#define BLIT_CNT(start,count)  memcpy(vga_dev+(start),vga_buf+(start),(count)*sizeof(cell_t))
-#define BLIT()                 BLIT_CNT(0,VGA_SIZE)
-#define BLIT_LINE(y)           memcpy(DEV_LINE(y),BUF_LINE(y),VTTY_WIDTH*sizeof(cell_t))
-#define BLIT_CELL(x,y)        (*DEV_CELL(x,y) = *BUF_CELL(x,y))
-#define BLIT_CUR()            (*DEV_CELL_CUR() = *BUF_CELL_CUR())
-#define BLIT_BUF(buf)         (vga_dev[(buf)-vga_buf] = *(buf))
-#define BLIT_CUR_INV()        (*DEV_CELL_CUR() = INVERT(*BUF_CELL_CUR()))
-
-// Get/Set/Move the cursor
-#define GET_CUR_X()    (coord_t)((vga_bufpos-vga_buf)%VTTY_WIDTH)
-#define GET_CUR_Y()    (coord_t)((vga_bufpos-vga_buf)/VTTY_WIDTH)
-#define SET_CUR(x,y)   (vga_bufpos = vga_buf+((x)+(y)*VTTY_WIDTH))
-#define SET_CUR_X(x)   (vga_bufpos -= (((vga_bufpos-vga_buf) % VTTY_WIDTH)-(x)))
-#define SET_CUR_Y(y)    SET_CUR(GET_CUR_X(),y)
-#define MOV_CUR(ox,oy) (vga_bufpos += ((ox)+(oy)*VTTY_WIDTH))
-#define MOV_CUR_X(ox)  (vga_bufpos += (ox))
-#define MOV_CUR_Y(oy)  (vga_bufpos += (ox)*VTTY_WIDTH)
-#define CUR_LINE()     (vga_bufpos-((vga_bufpos-vga_buf) % VTTY_WIDTH))
-
-#define CR()            SET_CUR_X(0)
-#define LF()           (vga_bufpos += (VTTY_WIDTH-((vga_bufpos-vga_buf) % VTTY_WIDTH)))
-#define BACK()         (vga_bufpos != vga_buf ? --vga_bufpos : vga_bufpos)
+#define DEV_LINE(y) (vga_dev+(y)*VTTY_WIDTH)
 
 /* Terminal configuration */
-#define HAVE_CURSOR_BLINK        1
-#define HAVE_CURSOR_BLINK_THREAD 0
-#define HAVE_CURSOR_LOCK         1
-#define INVERT_CURSOR_AFTER_MOVE 1
+#define VTTY_SCROLLBACK          256 /* Number of lines of history kept for the main screen. */
 #define TTY_DEVNAME              "/dev/vga"
 #undef TERM_BELL
 
 
-#if !HAVE_CURSOR_BLINK
-#undef HAVE_CURSOR_BLINK_THREAD
-#define HAVE_CURSOR_BLINK_THREAD 0
-#undef INVERT_CURSOR_AFTER_MOVE
-#define INVERT_CURSOR_AFTER_MOVE 0
-#undef HAVE_CURSOR_LOCK
-#define HAVE_CURSOR_LOCK 0
-#endif
-
-PRIVATE             pid_t relay_incoming_thread;
-#if HAVE_CURSOR_BLINK_THREAD
-PRIVATE             pid_t cursor_blink_thread;
-#endif
-#if HAVE_CURSOR_BLINK
-PRIVATE ATOMIC_DATA int   cursor_blink_enabled = 1;
-PRIVATE             int   cursor_inverted = 0;
-#endif
+/* A screen is a ring buffer of lines, `VTTY_HEIGHT' of which are visible.
+ * Scrolling only advances `s_top' and clears the line that wraps around,
+ * meaning that text never has to be moved. Lines before `s_top' that
+ * haven't been overwritten yet make up the scroll-back history. */
+struct screen {
+ cell_t      *s_lines; /* [1..1][owned][s_count*VTTY_WIDTH] Ring buffer of lines. */
+ unsigned int s_count; /* [const][>= VTTY_HEIGHT] Number of lines in the ring. */
+ unsigned int s_top;   /* [< s_count] Ring index of the first visible line. */
+ unsigned int s_hist;  /* [<= s_count-VTTY_HEIGHT] Number of history lines before `s_top'. */
+ coord_t      s_curx;  /* [<= VTTY_WIDTH] Cursor column (`VTTY_WIDTH' while a line-wrap is pending). */
+ coord_t      s_cury;  /* [< VTTY_HEIGHT] Cursor line. */
+};
 
-#if HAVE_CURSOR_LOCK
-PRIVATE DEFINE_ATOMIC_RWLOCK(cursor_lock);
-#define CURSOR_LOCK   atomic_rwlock_write(&cursor_lock);
-#define CURSOR_UNLOCK atomic_rwlock_endwrite(&cursor_lock);
-#else
-#define CURSOR_LOCK   /* Nothing */
-#define CURSOR_UNLOCK /* Nothing */
-#endif
+PRIVATE struct screen  vga_main;              /* The main screen (with scroll-back). */
+PRIVATE struct screen  vga_alt;               /* The alternate screen (`ESC[?1049h'; without scroll-back). */
+PRIVATE struct screen *vga_screen = &vga_main;/* [1..1] The active screen. */
+PRIVATE unsigned int   vga_view;              /* Number of lines the display is scrolled back into history. */
+PRIVATE int            cursor_visible = 1;    /* Draw the cursor. */
+#define CUR_X          (vga_screen->s_curx)
+#define CUR_Y          (vga_screen->s_cury)
+#define CUR_LINE()      screen_line(vga_screen,(int)CUR_Y)
+
+/* Return a pointer to the line `y' of the given screen.
+ * Negative values address history lines (`-s_hist <= y < VTTY_HEIGHT') */
+LOCAL cell_t *screen_line(struct screen *__restrict s, int y) {
+ int index = (int)s->s_top+y;
+ if (index < 0) index += (int)s->s_count;
+ else if ((unsigned int)index >= s->s_count)
+     index -= (int)s->s_count;
+ return s->s_lines+(unsigned int)index*VTTY_WIDTH;
+}
 
+/* Changes are only ever made to the screen's ring buffer, with modified
+ * cells being tracked here and then copied into video memory all at once
+ * by `vga_flush()', which the display loop calls after every burst of output.
+ * This way, something like `cat' of a large file only has to update
+ * VGA memory a couple of times, rather than once for every character. */
+PRIVATE u32     vga_dirty_lines;             /* Bitset of lines containing dirty cells. */
+PRIVATE u8      vga_dirty_begin[VTTY_HEIGHT];/* [valid_if(vga_dirty_lines & 1 << INDEX)] First dirty column. */
+PRIVATE u8      vga_dirty_end[VTTY_HEIGHT];  /* [valid_if(vga_dirty_lines & 1 << INDEX)] End of dirty columns. */
+PRIVATE cell_t *vga_cursor_cell;             /* [0..1] The cell in `vga_dev' currently drawn as cursor. */
+STATIC_ASSERT(VTTY_HEIGHT <= 32);
+STATIC_ASSERT(VTTY_WIDTH <= 0xff);
+
+LOCAL void vga_dirty(coord_t y, coord_t begin, coord_t end) {
+ if (vga_dirty_lines & ((u32)1 << y)) {
+  if (vga_dirty_begin[y] > begin) vga_dirty_begin[y] = (u8)begin;
+  if (vga_dirty_end[y] < end) vga_dirty_end[y] = (u8)end;
+ } else {
+  vga_dirty_lines   |= (u32)1 << y;
+  vga_dirty_begin[y] = (u8)begin;
+  vga_dirty_end[y]   = (u8)end;
+ }
+}
+PRIVATE void vga_dirty_all(void) {
+ vga_dirty_lines = ((u32)1 << (VTTY_HEIGHT-1) << 1)-1;
+ memset(vga_dirty_begin,0,sizeof(vga_dirty_begin));
+ memset(vga_dirty_end,VTTY_WIDTH,sizeof(vga_dirty_end));
+}
 
 
-#if defined(TERM_BELL) || HAVE_CURSOR_BLINK
 PRIVATE u8 vga_invert[VTTY_COLORS] = {
     [VTTY_COLOR_BLACK]          = VTTY_COLOR_WHITE,
     [VTTY_COLOR_BLUE]           = VTTY_COLOR_LIGHT_BROWN,
@@ -299,34 +290,6 @@ PRIVATE u8 vga_invert[VTTY_COLORS] = {
     [VTTY_COLOR_LIGHT_BROWN]    = VTTY_COLOR_BLUE,
     [VTTY_COLOR_WHITE]          = VTTY_COLOR_BLACK,
 };
-#endif
-
-#if HAVE_CURSOR_BLINK
-PRIVATE void cursor_enable(void) {
- if (!ATOMIC_CMPXCH(cursor_blink_enabled,0,1)) return;
-#if HAVE_CURSOR_BLINK_THREAD
- kill(cursor_blink_thread,SIGCONT);
-#endif
-}
-PRIVATE void cursor_disable(void) {
- if (!ATOMIC_CMPXCH(cursor_blink_enabled,1,0)) return;
-#if HAVE_CURSOR_BLINK_THREAD
- kill(cursor_blink_thread,SIGSTOP);
-#endif
- if (cursor_inverted) {
-  /* Fix inverted cursor */
-  BLIT_CUR();
-  cursor_inverted = 0;
- }
-}
-#define BEGIN_MOVE_CUR()      { CURSOR_LOCK if (cursor_inverted) BLIT_CUR(); }
-#define END_MOVE_CUR()        { CURSOR_UNLOCK }
-#else
-#define cursor_enable()  (void)0
-#define cursor_disable() (void)0
-#define BEGIN_MOVE_CUR()      { CURSOR_LOCK }
-#define END_MOVE_CUR()        { CURSOR_UNLOCK }
-#endif
 
 #define INVERT(cell) \
  (((cell)&0xff)\
@@ -334,107 +297,127 @@ PRIVATE void cursor_disable(void) {
    | ((cell_t)vga_invert[((cell)&0x0f00) >> 8] << 8))
 
 
-#if HAVE_CURSOR_BLINK_THREAD
-PRIVATE void blink_cur(void) {
- cell_t cur;
- CURSOR_LOCK
- assert(vga_bufpos <= vga_bufend);
- if (vga_bufpos != vga_bufend) {
-  cur = *BUF_CELL_CUR();
-  cursor_inverted ^= 1;
-  if (cursor_inverted) cur = INVERT(cur);
-  *DEV_CELL_CUR() = cur;
+/* Copy all dirty cells into video memory and (re-)draw the cursor. */
+PRIVATE void vga_flush(void) {
+ u32 lines; coord_t y;
+ if (vga_cursor_cell) {
+  /* Restore the cell that was previously drawn as cursor. */
+  size_t index = (size_t)(vga_cursor_cell-vga_dev);
+  vga_dirty((coord_t)(index/VTTY_WIDTH),
+            (coord_t)(index%VTTY_WIDTH),
+            (coord_t)(index%VTTY_WIDTH)+1);
+  vga_cursor_cell = NULL;
+ }
+ lines = vga_dirty_lines;
+ vga_dirty_lines = 0;
+ while (lines) {
+  cell_t *src; coord_t begin;
+  y     = ctz(lines);
+  lines &= lines-1;
+  begin = vga_dirty_begin[y];
+  src   = screen_line(vga_screen,(int)y-(int)vga_view);
+  memcpy(DEV_LINE(y)+begin,src+begin,
+        (vga_dirty_end[y]-begin)*sizeof(cell_t));
+ }
+ if (cursor_visible && !vga_view) {
+  coord_t x = CUR_X;
+  /* Draw the cursor by inverting the colors of its cell. */
+  if (x >= VTTY_WIDTH) x = VTTY_WIDTH-1;
+  vga_cursor_cell  = DEV_LINE(CUR_Y)+x;
+  *vga_cursor_cell = INVERT(CUR_LINE()[x]);
  }
- CURSOR_UNLOCK
 }
-PRIVATE ATTR_NORETURN void cursor_blink_threadmain(void) {
- for (;;) { usleep(300000); blink_cur(); }
+
+/* Scroll the display `offset' lines back into the history
+ * of the active screen (negative values scroll forward). */
+PRIVATE void vga_scrollview(int offset) {
+ int view = (int)vga_view+offset;
+ if (view < 0) view = 0;
+ if ((unsigned int)view > vga_screen->s_hist)
+      view = (int)vga_screen->s_hist;
+ if ((unsigned int)view == vga_view) return;
+ vga_view = (unsigned int)view;
+ vga_dirty_all();
 }
-#endif /* HAVE_CURSOR_BLINK_THREAD */
 
 #ifdef TERM_BELL
 PRIVATE void blit_inverted(void) {
- cell_t *iter,*end,*dst,cell;
- iter = vga_buf,end = vga_bufend;
- dst = vga_dev;
- for (; iter != end; ++iter,++dst) {
-  cell = *iter;
-  cell = INVERT(cell);
-  *dst = cell;
+ coord_t x,y; cell_t *src,*dst;
+ for (y = 0; y < VTTY_HEIGHT; ++y) {
+  src = screen_line(vga_screen,(int)y-(int)vga_view);
+  dst = DEV_LINE(y);
+  for (x = 0; x < VTTY_WIDTH; ++x)
+      dst[x] = INVERT(src[x]);
  }
 }
 #endif
 
 
-PRIVATE void term_doscroll(void) {
- memmove(vga_buf,vga_bufsecondline,
-        (VGA_SIZE-VTTY_WIDTH)*sizeof(cell_t));
- memcpy(vga_lastline,vga_spaceline,VTTY_WIDTH*sizeof(cell_t));
- vga_bufpos = vga_lastline;
+/* Shift the visible lines of `s' up by `n', moving the top-most
+ * lines into history and clearing those appearing at the bottom. */
+PRIVATE void screen_scrollup(struct screen *__restrict s, unsigned int n) {
+ if (n > VTTY_HEIGHT) n = VTTY_HEIGHT;
+ while (n--) {
+  if (++s->s_top == s->s_count) s->s_top = 0;
+  if (s->s_hist < s->s_count-VTTY_HEIGHT) ++s->s_hist;
+  memsetw(screen_line(s,VTTY_HEIGHT-1),SPACE,VTTY_WIDTH);
+ }
+ vga_dirty_all();
+}
+
+/* Shift the visible lines of `s' down by `n', clearing those appearing at the top. */
+PRIVATE void screen_scrolldown(struct screen *__restrict s, unsigned int n) {
+ unsigned int y;
+ if (n > VTTY_HEIGHT) n = VTTY_HEIGHT;
+ for (y = VTTY_HEIGHT; y-- > n;) {
+  memcpy(screen_line(s,(int)y),
+         screen_line(s,(int)(y-n)),
+         VTTY_WIDTH*sizeof(cell_t));
+ }
+ for (y = 0; y < n; ++y)
+     memsetw(screen_line(s,(int)y),SPACE,VTTY_WIDTH);
+ vga_dirty_all();
+}
+
+
+/* Move the cursor down by one line, scrolling at the bottom of the screen. */
+PRIVATE void term_lf(void) {
+ if (CUR_Y < VTTY_HEIGHT-1)
+     ++CUR_Y;
+ else screen_scrollup(vga_screen,1);
 }
 PRIVATE void term_doput(char ch) {
- if (vga_bufpos == vga_bufend) {
-  /* Scroll at the end of the terminal */
-  term_doscroll();
-#if INVERT_CURSOR_AFTER_MOVE
-  if (cursor_blink_enabled) {
-   cursor_inverted = 1;
-   *vga_bufpos++ = INVCHR(ch);
-   BLIT();
-   vga_bufpos[-1] = CHR(ch);
-  } else
-#endif
-  {
-   *vga_bufpos++ = CHR(ch);
-   BLIT();
-  }
- } else {
-  *vga_bufpos = CHR(ch);
-  BLIT_CUR();
-#if INVERT_CURSOR_AFTER_MOVE
-  if (cursor_blink_enabled) {
-   cursor_inverted = 1;
-   ++vga_bufpos;
-   if (vga_bufpos != vga_bufend) {
-    BLIT_CUR_INV();
-   }
-  } else
-#endif
-  {
-   ++vga_bufpos;
-   BLIT_CUR();
-  }
+ coord_t x = CUR_X;
+ if (x >= VTTY_WIDTH) {
+  /* Perform a pending line-wrap. */
+  term_lf();
+  x = 0;
  }
+ CUR_LINE()[x] = CHR(ch);
+ vga_dirty(CUR_Y,x,x+1);
+ CUR_X = x+1;
 }
 
 PRIVATE void TERM_CALL term_putc(struct term *UNUSED(t), char ch) {
  /* v This introducing lag is actually something that's currently intended. */
  //k_syslogf(KLOG_MSG,"%c",ch);
- BEGIN_MOVE_CUR()
  switch (ch) {
- case TERM_CR: CR(); break;
- case TERM_LF:
-  //printf(":AFTER LS: %d\n",vga_bufpos == vga_bufend);
-  if (vga_bufpos != vga_bufend) LF();
-  else term_doscroll();
-  break;
+ case TERM_CR: CUR_X = 0; break;
+ case TERM_LF: term_lf(); break;
  case TERM_BACK:
-  BACK();
-#if INVERT_CURSOR_AFTER_MOVE
-  if (cursor_blink_enabled) {
-   cursor_inverted = 1;
-   BLIT_CUR_INV();
-  }
-#endif
+  /* Also undoes a pending line-wrap, and wraps back to the previous line. */
+  if (CUR_X) --CUR_X;
+  else if (CUR_Y) CUR_X = VTTY_WIDTH-1,--CUR_Y;
   break;
  {
   size_t chrs;
  case TERM_TAB:
-  chrs = TERM_TABSIZE-(GET_CUR_X() % TERM_TABSIZE);
+  chrs = TERM_TABSIZE-(CUR_X % TERM_TABSIZE);
   while (chrs--) term_doput(' ');
  } break;
 #ifdef TERM_BELL
  case TERM_BELL: // Bell
+  vga_flush();
   /* Wait until a current retrace has ended. */
   while (inb(VGA_IS1_RC)&VGA_IS1_V_RETRACE) task_yield();
   /* Draw the screen inverted. */
@@ -445,24 +428,18 @@ PRIVATE void TERM_CALL term_putc(struct term *UNUSED(t), char ch) {
   while (inb(VGA_IS1_RC)&VGA_IS1_V_RETRACE) task_yield();
   while (!(inb(VGA_IS1_RC)&VGA_IS1_V_RETRACE)) task_yield();
   /* Draw the screen normal again. */
-  BLIT();
+  vga_dirty_all();
+  vga_flush();
   /* Wait until the next retrace starts. */
   while (inb(VGA_IS1_RC)&VGA_IS1_V_RETRACE) task_yield();
   while (!(inb(VGA_IS1_RC)&VGA_IS1_V_RETRACE)) task_yield();
   usleep(1000);
+  break;
 #else
- case '\a':
-#endif
-#if INVERT_CURSOR_AFTER_MOVE
-  if (cursor_blink_enabled) {
-   cursor_inverted = 1;
-   BLIT_CUR_INV();
-  }
+ case '\a': break;
 #endif
-  break;
  default: term_doput(ch); break;
  }
- END_MOVE_CUR()
 }
 
 PRIVATE uint8_t const vga_box_chars[] = {
@@ -485,86 +462,76 @@ term_set_color(struct term *UNUSED(t),
 PRIVATE void TERM_CALL term_set_cursor(struct term *UNUSED(t), coord_t x, coord_t y) {
  if (x >= VTTY_WIDTH)  x = *(__s32 *)&x < 0 ? 0 : VTTY_WIDTH-1;
  if (y >= VTTY_HEIGHT) y = *(__s32 *)&y < 0 ? 0 : VTTY_HEIGHT-1;
- BEGIN_MOVE_CUR()
- SET_CUR(x,y);
-#if INVERT_CURSOR_AFTER_MOVE
- if (cursor_blink_enabled) {
-  cursor_inverted = 1;
-  BLIT_CUR_INV();
- }
-#endif
- END_MOVE_CUR()
+ CUR_X = x;
+ CUR_Y = y;
 }
 PRIVATE void TERM_CALL term_get_cursor(struct term *UNUSED(t), coord_t *x, coord_t *y) {
- *x = GET_CUR_X();
- *y = GET_CUR_Y();
+ *x = CUR_X < VTTY_WIDTH ? CUR_X : VTTY_WIDTH-1;
+ *y = CUR_Y;
 }
 PRIVATE void TERM_CALL term_show_cursor(struct term *UNUSED(t), int cmd) {
- if (cmd == TERM_SHOWCURSOR_YES) {
-  cursor_enable();
- } else {
-  cursor_disable();
- }
+ cursor_visible = cmd == TERM_SHOWCURSOR_YES;
 }
 PRIVATE void TERM_CALL term_cls(struct term *UNUSED(t), int mode) {
- cell_t *begin,*end,*iter,filler = SPACE;
+ coord_t x,y,begin,end;
+ x = CUR_X < VTTY_WIDTH ? CUR_X : VTTY_WIDTH-1;
  switch (mode) {
- case TERM_CLS_BEFORE: begin = vga_buf; end = vga_bufpos; break;
- case TERM_CLS_AFTER : begin = vga_bufpos; end = vga_bufend; break;
- default             : begin = vga_buf; end = vga_bufend; break;
+ case TERM_CLS_BEFORE:
+  memsetw(CUR_LINE(),SPACE,x);
+  vga_dirty(CUR_Y,0,x);
+  begin = 0,end = CUR_Y;
+  break;
+ case TERM_CLS_AFTER:
+  memsetw(CUR_LINE()+x,SPACE,VTTY_WIDTH-x);
+  vga_dirty(CUR_Y,x,VTTY_WIDTH);
+  begin = CUR_Y+1,end = VTTY_HEIGHT;
+  break;
+ case TERM_CLS_ALLPAGES:
+  /* Also discard the scroll-back history. */
+  vga_screen->s_hist = 0;
+  ATTR_FALLTHROUGH
+ default:
+  begin = 0,end = VTTY_HEIGHT;
+  break;
  }
- for (iter = begin; iter != end; ++iter) *iter = filler;
- BLIT_CNT(begin-vga_buf,end-begin);
-#if INVERT_CURSOR_AFTER_MOVE
- if (cursor_blink_enabled) {
-  cursor_inverted = 1;
-  BLIT_CUR_INV();
+ for (y = begin; y < end; ++y) {
+  memsetw(screen_line(vga_screen,(int)y),SPACE,VTTY_WIDTH);
+  vga_dirty(y,0,VTTY_WIDTH);
  }
-#endif
 }
 PRIVATE void TERM_CALL term_el(struct term *UNUSED(t), int mode) {
- cell_t *begin,*end,*iter,filler = SPACE;
- bool refresh_all = vga_bufpos == vga_bufend;
- if (refresh_all) term_doscroll();
+ coord_t x,begin,end;
+ x = CUR_X < VTTY_WIDTH ? CUR_X : VTTY_WIDTH-1;
  switch (mode) {
- case TERM_EL_BEFORE: begin = CUR_LINE(); end = vga_bufpos; break;
- case TERM_EL_AFTER : begin = vga_bufpos; end = CUR_LINE()+VTTY_WIDTH; break;
- default            : begin = CUR_LINE(); end = begin+VTTY_WIDTH; break;
- }
- for (iter = begin; iter != end; ++iter) *iter = filler;
- if (refresh_all) BLIT();
- else BLIT_CNT(begin-vga_buf,end-begin);
-#if INVERT_CURSOR_AFTER_MOVE
- if (cursor_blink_enabled) {
-  cursor_inverted = 1;
-  BLIT_CUR_INV();
+ case TERM_EL_BEFORE: begin = 0; end = x; break;
+ case TERM_EL_AFTER : begin = x; end = VTTY_WIDTH; break;
+ default            : begin = 0; end = VTTY_WIDTH; break;
  }
-#endif
+ if (begin == end) return;
+ memsetw(CUR_LINE()+begin,SPACE,end-begin);
+ vga_dirty(CUR_Y,begin,end);
 }
 PRIVATE void TERM_CALL term_scroll(struct term *UNUSED(t), offset_t offset) {
- cell_t filler = SPACE;
- cell_t *new_begin,*new_end;
- size_t copycells;
- /*if (!offset) return;*/
- if (offset >= VTTY_HEIGHT || offset <= -VTTY_HEIGHT) {
-  term_cls(NULL,TERM_CLS_ALL);
-  return;
+ if (offset > 0)
+     screen_scrollup(vga_screen,(unsigned int)offset);
+ else if (offset < 0) {
+     screen_scrolldown(vga_screen,(unsigned int)-offset);
  }
- if (offset > 0) {
-  // Shift lines upwards
-  copycells = (VTTY_HEIGHT-offset)*VTTY_WIDTH;
-  memmove(vga_buf,vga_buf+offset*VTTY_WIDTH,copycells*sizeof(cell_t));
-  new_begin = vga_buf+copycells;
-  new_end = vga_bufend;
- } else {
-  // Shift lines downwards
-  copycells = (VTTY_HEIGHT+offset)*VTTY_WIDTH;
-  memmove(vga_buf-offset*VTTY_WIDTH,vga_buf,copycells*sizeof(cell_t));
-  new_end = (new_begin = vga_buf)+copycells;
+}
+PRIVATE void TERM_CALL term_altscreen(struct term *UNUSED(t), int cmd) {
+ struct screen *s = cmd == TERM_ALTSCREEN_YES ? &vga_alt : &vga_main;
+ if (vga_screen == s) return;
+ if (s == &vga_alt) {
+  /* The alternate screen always starts out empty.
+   * NOTE: Since every screen has its own cursor, that of
+   *       the main screen is restored when switching back. */
+  memsetw(s->s_lines,SPACE,s->s_count*VTTY_WIDTH);
+  s->s_curx = 0;
+  s->s_cury = 0;
  }
- for (; new_begin != new_end; ++new_begin)
-  *new_begin = filler;
- BLIT();
+ vga_screen = s;
+ vga_view   = 0;
+ vga_dirty_all();
 }
 
 PRIVATE struct term_operations const term_ops = {
@@ -581,6 +548,7 @@ PRIVATE struct term_operations const term_ops = {
     .to_putimg        = NULL,
     .to_get_cell_size = NULL,
     .to_output        = NULL,
+    .to_altscreen     = &term_altscreen,
 };
 
 PRIVATE struct winsize const winsize = {
@@ -596,12 +564,23 @@ usage(char const *name, int exitcode) {
  exit(exitcode);
 }
 
+PRIVATE pid_t relay_incoming_thread;
 PRIVATE int keyboard_fd;
 PRIVATE struct keyboard_keymap const *current_keymap;
 PRIVATE struct term pty;
 PRIVATE int amaster,aslave;
 PRIVATE keyboard_state_t keystate;
 
+/* The input relay runs in a separate process, and uses these signals to
+ * ask the display to scroll through its history (SHIFT+PGUP/SHIFT+PGDOWN). */
+#define SIG_VIEWUP   SIGUSR1
+#define SIG_VIEWDOWN SIGUSR2
+PRIVATE ATOMIC_DATA int view_request = 0; /* Pending `vga_scrollview()' offset. */
+PRIVATE void view_sighandler(int signo) {
+ ATOMIC_FETCHADD(view_request,signo == SIG_VIEWUP
+                 ? +(VTTY_HEIGHT/2) : -(VTTY_HEIGHT/2));
+}
+
 /* Parse and relay keyboard-style inputs from the terminal driver's STDIN */
 PRIVATE ATTR_NORETURN void relay_incoming_threadmain(void) {
  char text[32]; char *iter; keyboard_key_t key; ssize_t s;
@@ -661,6 +640,13 @@ rescan:
    }
   }
 
+  if ((key == KEY_PGUP || key == KEY_PGDOWN) &&
+       KEYBOARD_STATE_FISSHIFT(keystate)) {
+   /* Scroll the display, rather than forwarding the key. */
+   kill(getppid(),key == KEY_PGUP ? SIG_VIEWUP : SIG_VIEWDOWN);
+   goto send_nothing;
+  }
+
   if (KEYBOARD_STATE_FISALT(keystate) &&
      (!KEYBOARD_STATE_FISALTGR(keystate) ||
        key >= 256 ||
@@ -765,9 +751,6 @@ PRIVATE void *LIBCCALL map_phys(void *pptr, size_t size) {
 
 int main(int argc, char *argv[]) {
  pid_t child_proc; int result;
- /* TODO: Re-write to support multiple pages allocated in a ring-buffer
-  *       were appending a new line only requires shifting of some
-  *       base-pointer, as well as duplication into VGA memory. */
 
  if (argc < 2) { usage(argv[0],EXIT_FAILURE); }
 
@@ -798,16 +781,13 @@ int main(int argc, char *argv[]) {
 #endif
 
  /*printf("Mapped terminal driver to %p\n",vga_dev);*/
- vga_buf = (cell_t *)malloc((VGA_SIZE+VTTY_WIDTH)*sizeof(cell_t));
- if (!vga_buf) err(EXIT_FAILURE,"Failed to allocate VGA buffer");
- vga_bufend        = vga_buf+VGA_SIZE;
- vga_bufpos        = vga_buf;
- vga_bufsecondline = vga_buf+VTTY_WIDTH;
- vga_lastline      = vga_buf+(VGA_SIZE-VTTY_WIDTH);
- { cell_t *end = vga_bufend+VTTY_WIDTH;
-   cell_t *iter = vga_buf,filler = SPACE;
-   for (; iter != end; ++iter) *iter = filler;
- }
+ vga_main.s_count = VTTY_HEIGHT+VTTY_SCROLLBACK;
+ vga_main.s_lines = (cell_t *)malloc(vga_main.s_count*VTTY_WIDTH*sizeof(cell_t));
+ vga_alt.s_count  = VTTY_HEIGHT;
+ vga_alt.s_lines  = (cell_t *)malloc(VGA_SIZE*sizeof(cell_t));
+ if (!vga_main.s_lines || !vga_alt.s_lines)
+      err(EXIT_FAILURE,"Failed to allocate VGA buffer");
+ memsetw(vga_main.s_lines,SPACE,vga_main.s_count*VTTY_WIDTH);
  if (!term_init(&pty,&term_ops,NULL,NULL))
       err(EXIT_FAILURE,"Failed to create terminal host");
 
@@ -849,11 +829,17 @@ int main(int argc, char *argv[]) {
  /* Close the slave end of the terminal driver */
  close(aslave);
 
+ /* Setup handlers for scroll requests from the relay.
+  * NOTE: Don't use `SA_RESTART', so that `read()' below gets interrupted. */
+ {
+  struct sigaction act;
+  memset(&act,0,sizeof(act));
+  act.sa_handler = &view_sighandler;
+  sigaction(SIG_VIEWUP,&act,NULL);
+  sigaction(SIG_VIEWDOWN,&act,NULL);
+ }
+
  /* Spawn helper threads */
-#if HAVE_CURSOR_BLINK_THREAD
- if ((cursor_blink_thread = fork()) == 0)
-      cursor_blink_threadmain();
-#endif
  if ((relay_incoming_thread = fork()) == 0) {
   relay_incoming_threadmain();
  } else if (relay_incoming_thread < 0) {
@@ -861,24 +847,35 @@ int main(int argc, char *argv[]) {
  }
 
  /*k_syslogf(KLOG_DEBUG,"Updating screen for the first time\n");*/
- BLIT();
+ vga_dirty_all();
+ vga_flush();
 
  syslog(LOG_DEBUG,"Entering relay-display loop on %u\n",syscall(__NR_gettid));
  for (;;) {
-  ssize_t s; char buf[128];
+  ssize_t s; char buf[1024];
   /* Relay everything being printed to the terminal towards the screen. */
   while ((s = read(amaster,buf,sizeof(buf))) > 0) {
+   /* New output returns the display to the live screen. */
+   if (vga_view) vga_scrollview(-(int)vga_view);
 #if 0
    format_printf(&term_printer,&pty,"%$q\n",s,buf);
    syslog(LOG_DEBUG,"TERM: %$q\n",s,buf);
 #else
    term_printer(buf,(size_t)s,&pty);
 #endif
+   /* Update video memory once for the entire burst. */
+   vga_flush();
   }
   if (s < 0) {
    if (errno == EINTR) {
+    siginfo_t info; int offset;
+    /* Check if we were interrupted to scroll through history. */
+    if ((offset = ATOMIC_XCH(view_request,0)) != 0) {
+     vga_scrollview(offset);
+     vga_flush();
+     continue;
+    }
     /* Check if we were interrupted because the child died. */
-    siginfo_t info;
     if (waitid(P_PID,child_proc,&info,WNOHANG|WEXITED) >= 0) {
      result = WEXITSTATUS(info.si_status);
      goto child_joined;
@@ -896,16 +893,13 @@ int main(int argc, char *argv[]) {
  result = WEXITSTATUS(result);
 child_joined:
 
-#if HAVE_CURSOR_BLINK_THREAD
- if (kill(cursor_blink_thread,SIGKILL))
-     perror("Failed to kill <cursor_blink_thread>");
-#endif
  if (kill(relay_incoming_thread,SIGKILL))
      perror("Failed to kill <relay_incoming_thread>");
 
 #if 1
  term_fini(&pty);
- free(vga_buf);
+ free(vga_alt.s_lines);
+ free(vga_main.s_lines);
  munmap(vga_dev,VGA_SIZE*sizeof(cell_t));
 #if __KOS_VERSION__ < 300
  close(vga_fd);
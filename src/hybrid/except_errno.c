@@ -130,18 +130,26 @@ libc_exception_errno(struct exception_info *__restrict info) {
   break;
  case E_NET_ERROR:
   switch (info->e_error.e_net_error.n_errcode) {
-  case ERROR_NET_UNSUPPORTED_DOMAIN:   result = EAFNOSUPPORT;
-  case ERROR_NET_UNSUPPORTED_TYPE:     result = EINVAL;
-  case ERROR_NET_UNSUPPORTED_PROTOCOL: result = EPROTONOSUPPORT;
-  case ERROR_NET_SHUTDOWN:             result = ESHUTDOWN;
-  case ERROR_NET_CANNOT_RECONNECT:     result = EALREADY;
-  case ERROR_NET_CANNOT_REBIND:        result = EALREADY;
-  case ERROR_NET_NOT_BOUND:            result = EOPNOTSUPP;
-  case ERROR_NET_NOT_CONNECTED:        result = ENOTCONN;
-  case ERROR_NET_NOT_LISTENING:        result = EINVAL;
-  case ERROR_NET_ALREADY_LISTENING:    result = EALREADY;
-  case ERROR_NET_CANNOT_LISTEN:        result = EOPNOTSUPP;
-  case ERROR_NET_CANNOT_ACCEPT:        result = EOPNOTSUPP;
+  case ERROR_NET_UNSUPPORTED_DOMAIN:     result = EAFNOSUPPORT; break;
+  case ERROR_NET_UNSUPPORTED_TYPE:       result = EINVAL; break;
+  case ERROR_NET_UNSUPPORTED_PROTOCOL:   result = EPROTONOSUPPORT; break;
+  case ERROR_NET_SHUTDOWN:               result = ESHUTDOWN; break;
+  case ERROR_NET_CANNOT_RECONNECT:       result = EALREADY; break;
+  case ERROR_NET_CANNOT_REBIND:          result = EALREADY; break;
+  case ERROR_NET_NOT_BOUND:              result = EOPNOTSUPP; break;
+  case ERROR_NET_NOT_CONNECTED:          result = ENOTCONN; break;
+  case ERROR_NET_NOT_LISTENING:          result = EINVAL; break;
+  case ERROR_NET_ALREADY_LISTENING:      result = EALREADY; break;
+  case ERROR_NET_CANNOT_LISTEN:          result = EOPNOTSUPP; break;
+  case ERROR_NET_CANNOT_ACCEPT:          result = EOPNOTSUPP; break;
+  case ERROR_NET_INVALID_SOCKET_ADDRESS: result = EINVAL; break;
+  case ERROR_NET_INVALID_ADDRESS_FAMILY: result = EAFNOSUPPORT; break;
+  case ERROR_NET_CONNECTION_REFUSED:     result = ECONNREFUSED; break;
+  case ERROR_NET_ADDRESS_IN_USE:         result = EADDRINUSE; break;
+  case ERROR_NET_PACKET_TOO_LARGE:       result = EMSGSIZE; break;
+  case ERROR_NET_ADDRESS_NOT_AVAILABLE:  result = EADDRNOTAVAIL; break;
+  case ERROR_NET_NETWORK_UNREACHABLE:    result = ENETUNREACH; break;
+  case ERROR_NET_BROKEN_PIPE:            result = EPIPE; break;
   default: break;
   }
   break;
@@ -650,6 +650,9 @@ libc_error_vfprintf(FILE *fp, char const *reason, va_list args)
   case ERROR_NET_CONNECTION_REFUSED:     PRINTF("\t\tFailed to connect to an address with no one listen(2)-ing on the other end\n"); break;
   case ERROR_NET_ADDRESS_IN_USE:         PRINTF("\t\tLocal address is already in use\n"); break;
   case ERROR_NET_PACKET_TOO_LARGE:       PRINTF("\t\tA packet is too large for the associated protocol\n"); break;
+  case ERROR_NET_ADDRESS_NOT_AVAILABLE:  PRINTF("\t\tThe requested local address isn't assigned to any interface\n"); break;
+  case ERROR_NET_NETWORK_UNREACHABLE:    PRINTF("\t\tNo route exists to reach the specified address\n"); break;
+  case ERROR_NET_BROKEN_PIPE:            PRINTF("\t\tThe other end of the connection was closed\n"); break;
   default: break;
   }
   break;
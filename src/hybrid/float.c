@@ -0,0 +1,1142 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_HYBRID_FLOAT_C
+#define GUARD_HYBRID_FLOAT_C 1
+#define _KOS_SOURCE 2
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <hybrid/bit.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <float.h>
+#include <errno.h>
+
+#include "hybrid.h"
+
+#ifndef CONFIG_LIBC_LIMITED_API
+#include "float-tables.c.inl"
+
+DECL_BEGIN
+
+/* Floating point <-> decimal conversion.
+ *  - Printing uses the Ryu algorithm to find the shortest representation
+ *    of a `double', which is also used by `printf()' whenever the requested
+ *    precision doesn't exceed what that representation already provides.
+ *    Everything else (including all `long double' values) is printed from
+ *    the exact decimal expansion of the value, so output is always correctly
+ *    rounded, no matter how many digits are requested.
+ *  - Parsing uses the Eisel-Lemire algorithm for `float' and `double', which
+ *    produces the correctly rounded result for almost all inputs using one or
+ *    two 64x64-bit multiplications. Inputs it cannot decide (as well as all
+ *    `long double' inputs) fall back to an arbitrary precision decimal that
+ *    is repeatedly shifted until it can be rounded to an integer. */
+
+
+/* Multiply two 64-bit integers, returning the low 64 bits of
+ * the result and storing the high 64 bits in `*phi' */
+LOCAL u64 float_umul128(u64 a, u64 b, u64 *__restrict phi) {
+#ifdef __SIZEOF_INT128__
+ unsigned __int128 result;
+ result = (unsigned __int128)a * b;
+ *phi   = (u64)(result >> 64);
+ return (u64)result;
+#else
+ u64 ll,lh,hl,hh,mid;
+ ll   = (u64)(u32)a * (u32)b;
+ lh   = (u64)(u32)a * (u32)(b >> 32);
+ hl   = (u64)(u32)(a >> 32) * (u32)b;
+ hh   = (u64)(u32)(a >> 32) * (u32)(b >> 32);
+ mid  = (ll >> 32) + (u32)lh + (u32)hl;
+ *phi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+ return (mid << 32) | (u32)ll;
+#endif
+}
+
+/* floor(log10(2^e)) / floor(log10(5^e)) / ceil(log2(5^e)) (for `0 <= e <= 3528') */
+#define FLOAT_LOG10_POW2(e) ((s32)(((u32)(e) * 78913) >> 18))
+#define FLOAT_LOG10_POW5(e) ((s32)(((u32)(e) * 732923) >> 20))
+#define FLOAT_POW5_BITS(e)  ((s32)((((u32)(e) * 1217359) >> 19) + 1))
+
+PRIVATE u32 const float_pow10_32[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000,
+    10000000, 100000000, 1000000000
+};
+
+
+
+/* ===================================================================================== */
+/*     DECOMPOSITION                                                                     */
+/* ===================================================================================== */
+INTERN void LIBCCALL
+libc_float_fromdouble(struct float_value *__restrict self, double value) {
+ union { double f; u64 i; } bits;
+ unsigned int bexp;
+ bits.f          = value;
+ bexp            = (unsigned int)(bits.i >> 52) & 0x7ff;
+ self->fv_mant   = bits.i & ((UINT64_C(1) << 52)-1);
+ self->fv_neg    = (u8)(bits.i >> 63);
+ self->fv_type   = FLOAT_TYPE_DOUBLE;
+ if (bexp == 0x7ff) {
+  self->fv_class = self->fv_mant ? FLOAT_CLASS_NAN : FLOAT_CLASS_INF;
+  self->fv_exp   = 0;
+ } else {
+  self->fv_class = FLOAT_CLASS_FINITE;
+  if (bexp) self->fv_mant |= UINT64_C(1) << 52;
+  else bexp = 1; /* Subnormal */
+  self->fv_exp = (s32)bexp - (1023 + 52);
+ }
+}
+
+INTERN void LIBCCALL
+libc_float_fromldouble(struct float_value *__restrict self, long double value) {
+#if LDBL_MANT_DIG == 64
+ union { long double f; struct { u64 m; u16 se; } i; } bits;
+ unsigned int bexp;
+ bits.f          = value;
+ bexp            = bits.i.se & 0x7fff;
+ self->fv_mant   = bits.i.m;
+ self->fv_neg    = (u8)(bits.i.se >> 15);
+ self->fv_type   = FLOAT_TYPE_LDOUBLE;
+ if (bexp == 0x7fff) {
+  self->fv_class = (self->fv_mant << 1) ? FLOAT_CLASS_NAN : FLOAT_CLASS_INF;
+  self->fv_exp   = 0;
+ } else {
+  self->fv_class = FLOAT_CLASS_FINITE;
+  if (!bexp) bexp = 1; /* Subnormal */
+  self->fv_exp = (s32)bexp - (16383 + 63);
+ }
+#else
+ libc_float_fromdouble(self,(double)value);
+#endif
+}
+
+
+
+/* ===================================================================================== */
+/*     RYU (SHORTEST REPRESENTATION OF A DOUBLE)                                         */
+/* ===================================================================================== */
+/* Return `(m * mul) >> j', where `mul' is a 125-bit table entry and `j >= 64' */
+LOCAL u64 ryu_mulshift(u64 m, u64 const mul[2], s32 j) {
+ u64 b0_hi,b2_hi,b2_lo,sum_lo,sum_hi;
+ float_umul128(m,mul[0],&b0_hi);
+ b2_lo  = float_umul128(m,mul[1],&b2_hi);
+ sum_lo = b2_lo + b0_hi;
+ sum_hi = b2_hi + (sum_lo < b0_hi);
+ j -= 64;
+ if (!j) return sum_lo;
+ return (sum_hi << (64 - j)) | (sum_lo >> j);
+}
+LOCAL unsigned int ryu_pow5_factor(u64 value) {
+ unsigned int result = 0;
+ for (;;) {
+  u64 q = value / 5;
+  if (value != q * 5) break;
+  value = q;
+  ++result;
+ }
+ return result;
+}
+#define ryu_multiple_of_pow5(value,p) (ryu_pow5_factor(value) >= (unsigned int)(p))
+#define ryu_multiple_of_pow2(value,p) (((value) & ((UINT64_C(1) << (p))-1)) == 0)
+
+/* Find the shortest decimal `*pdigits * 10^return' that rounds back to `value'.
+ * `value' must be finite and non-zero. */
+PRIVATE s32 KCALL
+ryu_shortest(struct float_value const *__restrict value, u64 *__restrict pdigits) {
+ s32 e2,e10; u64 m2,mv,vr,vp,vm,output;
+ bool accept_bounds,vm_zeros = false,vr_zeros = false;
+ unsigned int mm_shift,removed = 0,last_removed = 0;
+ /* Ryu works on `m2 * 2^e2' with 2 extra bits for the interval boundaries. */
+ m2            = value->fv_mant;
+ e2            = value->fv_exp - 2;
+ mm_shift      = (m2 != (UINT64_C(1) << 52)) || (value->fv_exp <= 1 - (1023 + 52));
+ accept_bounds = !(m2 & 1);
+ mv            = 4 * m2;
+ if (e2 >= 0) {
+  s32 q = FLOAT_LOG10_POW2(e2) - (e2 > 3);
+  s32 i = -e2 + q + FLOAT_RYU_POW5_INV_BITS + FLOAT_POW5_BITS(q) - 1;
+  e10 = q;
+  vr  = ryu_mulshift(mv,ryu_pow5_inv[q],i);
+  vp  = ryu_mulshift(mv + 2,ryu_pow5_inv[q],i);
+  vm  = ryu_mulshift(mv - 1 - mm_shift,ryu_pow5_inv[q],i);
+  if (q <= 21) {
+   /* Only one of mp, mv, and mm can be a multiple of 5, if any. */
+   if (mv % 5 == 0)
+       vr_zeros = ryu_multiple_of_pow5(mv,q);
+   else if (accept_bounds)
+       vm_zeros = ryu_multiple_of_pow5(mv - 1 - mm_shift,q);
+   else vp -= ryu_multiple_of_pow5(mv + 2,q);
+  }
+ } else {
+  s32 q = FLOAT_LOG10_POW5(-e2) - (-e2 > 1);
+  s32 i = -e2 - q;
+  s32 j = q - (FLOAT_POW5_BITS(i) - FLOAT_RYU_POW5_BITS);
+  e10 = q + e2;
+  vr  = ryu_mulshift(mv,ryu_pow5[i],j);
+  vp  = ryu_mulshift(mv + 2,ryu_pow5[i],j);
+  vm  = ryu_mulshift(mv - 1 - mm_shift,ryu_pow5[i],j);
+  if (q <= 1) {
+   /* `mv' has at least q trailing 0 bits, so `vr' has at least q trailing zeros. */
+   vr_zeros = true;
+   if (accept_bounds)
+       vm_zeros = mm_shift == 1;
+   else --vp;
+  } else if (q < 63) {
+   vr_zeros = ryu_multiple_of_pow2(mv,q);
+  }
+ }
+ /* Remove digits for as long as the interval permits. */
+ if (vm_zeros || vr_zeros) {
+  /* Rare case: trailing zeros must be tracked to round correctly. */
+  for (;;) {
+   u64 vp_div10 = vp / 10;
+   u64 vm_div10 = vm / 10;
+   u64 vr_div10;
+   if (vp_div10 <= vm_div10) break;
+   vm_zeros    &= vm == vm_div10 * 10;
+   vr_zeros    &= last_removed == 0;
+   vr_div10     = vr / 10;
+   last_removed = (unsigned int)(vr - vr_div10 * 10);
+   vr = vr_div10,vp = vp_div10,vm = vm_div10;
+   ++removed;
+  }
+  if (vm_zeros) {
+   for (;;) {
+    u64 vm_div10 = vm / 10;
+    u64 vr_div10;
+    if (vm != vm_div10 * 10) break;
+    vr_zeros    &= last_removed == 0;
+    vr_div10     = vr / 10;
+    last_removed = (unsigned int)(vr - vr_div10 * 10);
+    vr = vr_div10,vp = vp / 10,vm = vm_div10;
+    ++removed;
+   }
+  }
+  /* Round even if the exact value is .....50..0. */
+  if (vr_zeros && last_removed == 5 && !(vr & 1))
+      last_removed = 4;
+  output = vr + ((vr == vm && (!accept_bounds || !vm_zeros)) ||
+                  last_removed >= 5);
+ } else {
+  bool round_up = false;
+  for (;;) {
+   u64 vp_div10 = vp / 10;
+   u64 vm_div10 = vm / 10;
+   u64 vr_div10;
+   if (vp_div10 <= vm_div10) break;
+   vr_div10 = vr / 10;
+   round_up = vr - vr_div10 * 10 >= 5;
+   vr = vr_div10,vp = vp_div10,vm = vm_div10;
+   ++removed;
+  }
+  output = vr + (vr == vm || round_up);
+ }
+ *pdigits = output;
+ return e10 + (s32)removed;
+}
+
+
+
+/* ===================================================================================== */
+/*     EXACT DECIMAL EXPANSION                                                           */
+/* ===================================================================================== */
+/* Max number of base-10^9 words needed to hold the integer `N' of any
+ * finite value `N * 10^E', where `N' is either `m * 2^e' or `m * 5^-e'. */
+#define FLOAT_BIG_BASE      1000000000
+#define FLOAT_BIG_DIGITS    9
+#define FLOAT_BIG_MAXWORDS (((LDBL_MANT_DIG - LDBL_MIN_EXP) * 7 / 10 + 20) / FLOAT_BIG_DIGITS + 2)
+
+struct float_big {
+    size_t fb_count;                     /* Number of used words (ZERO(0) for a value of ZERO(0)). */
+    size_t fb_ndigits;                   /* Number of decimal digits (ONE(1) for a value of ZERO(0)). */
+    s32    fb_exp;                       /* Decimal exponent `E' */
+    u32    fb_word[FLOAT_BIG_MAXWORDS];  /* Base-10^9 words, least significant first. */
+};
+
+PRIVATE void KCALL
+float_big_count(struct float_big *__restrict self) {
+ u32 top; unsigned int n = 1;
+ while (self->fb_count && !self->fb_word[self->fb_count-1])
+      --self->fb_count;
+ if (!self->fb_count) { self->fb_ndigits = 1; return; }
+ top = self->fb_word[self->fb_count-1];
+ while (n < FLOAT_BIG_DIGITS && top >= float_pow10_32[n]) ++n;
+ self->fb_ndigits = (self->fb_count-1) * FLOAT_BIG_DIGITS + n;
+}
+
+PRIVATE void KCALL
+float_big_setu64(struct float_big *__restrict self, u64 value, s32 exp10) {
+ self->fb_count = 0;
+ self->fb_exp   = exp10;
+ while (value) {
+  self->fb_word[self->fb_count++] = (u32)(value % FLOAT_BIG_BASE);
+  value /= FLOAT_BIG_BASE;
+ }
+ float_big_count(self);
+}
+
+/* Multiply by `factor' (which must not exceed `2^31') */
+PRIVATE void KCALL
+float_big_mul(struct float_big *__restrict self, u32 factor) {
+ u64 carry = 0; size_t i;
+ for (i = 0; i < self->fb_count; ++i) {
+  carry += (u64)self->fb_word[i] * factor;
+  self->fb_word[i] = (u32)(carry % FLOAT_BIG_BASE);
+  carry /= FLOAT_BIG_BASE;
+ }
+ while (carry) {
+  self->fb_word[self->fb_count++] = (u32)(carry % FLOAT_BIG_BASE);
+  carry /= FLOAT_BIG_BASE;
+ }
+}
+
+/* Load the exact decimal expansion of `mant * 2^exp' */
+PRIVATE void KCALL
+float_big_load(struct float_big *__restrict self, u64 mant, s32 exp) {
+ if (mant) {
+  /* Strip trailing zero bits to keep the expansion short. */
+  unsigned int shift = ctz(mant);
+  if (exp < 0 && (s32)shift > -exp)
+      shift = (unsigned int)-exp;
+  mant >>= shift;
+  exp   += (s32)shift;
+ }
+ if (exp >= 0) {
+  float_big_setu64(self,mant,0);
+  for (; exp >= 29; exp -= 29)
+      float_big_mul(self,UINT32_C(1) << 29);
+  if (exp) float_big_mul(self,UINT32_C(1) << exp);
+ } else {
+  /* m * 2^-k == (m * 5^k) * 10^-k */
+  s32 k = -exp;
+  float_big_setu64(self,mant,exp);
+  for (; k >= 13; k -= 13)
+      float_big_mul(self,UINT32_C(1220703125)); /* 5^13 */
+  if (k) {
+   u32 factor = 1;
+   while (k--) factor *= 5;
+   float_big_mul(self,factor);
+  }
+ }
+ float_big_count(self);
+}
+
+/* Return the `index'th most significant digit (`0..9'), where
+ * digits outside of `[0,fb_ndigits)' are implicitly ZERO(0). */
+PRIVATE unsigned int KCALL
+float_big_digit(struct float_big const *__restrict self, ssize_t index) {
+ size_t pos;
+ if (index < 0 || (size_t)index >= self->fb_ndigits || !self->fb_count)
+     return 0;
+ pos = self->fb_ndigits - 1 - (size_t)index;
+ return (self->fb_word[pos / FLOAT_BIG_DIGITS] /
+         float_pow10_32[pos % FLOAT_BIG_DIGITS]) % 10;
+}
+
+/* Return the number of significant digits, ignoring trailing zeros. */
+PRIVATE size_t KCALL
+float_big_significant(struct float_big const *__restrict self) {
+ size_t i = 0; u32 word;
+ if (!self->fb_count) return 0;
+ while (!self->fb_word[i]) ++i;
+ word = self->fb_word[i];
+ i   *= FLOAT_BIG_DIGITS;
+ while (!(word % 10)) word /= 10,++i;
+ return self->fb_ndigits - i;
+}
+
+/* Round to `keep' significant digits (rounding half to even)
+ * Digits that get rounded away are replaced with ZERO(0). */
+PRIVATE void KCALL
+float_big_round(struct float_big *__restrict self, ssize_t keep) {
+ size_t drop,i,word; bool round_up;
+ unsigned int next,last;
+ if (!self->fb_count || keep >= (ssize_t)self->fb_ndigits) return;
+ if (keep < 0) {
+  /* Less than half of the smallest digit being kept. */
+  self->fb_count = 0;
+  float_big_count(self);
+  return;
+ }
+ drop = self->fb_ndigits - (size_t)keep;
+ next = float_big_digit(self,keep);
+ last = keep ? float_big_digit(self,keep-1) : 0;
+ round_up = next > 5;
+ if (next == 5) {
+  /* Check for a tie. */
+  round_up = (last & 1) != 0;
+  if (!round_up) {
+   size_t pos = drop - 1; /* Position of `next' */
+   for (i = 0; i < pos / FLOAT_BIG_DIGITS; ++i)
+       if (self->fb_word[i]) { round_up = true; break; }
+   if (!round_up && self->fb_word[pos / FLOAT_BIG_DIGITS] %
+                    float_pow10_32[pos % FLOAT_BIG_DIGITS])
+       round_up = true;
+  }
+ }
+ /* Clear all dropped digits. */
+ word = drop / FLOAT_BIG_DIGITS;
+ for (i = 0; i < word && i < self->fb_count; ++i)
+     self->fb_word[i] = 0;
+ if (word < self->fb_count)
+     self->fb_word[word] -= self->fb_word[word] % float_pow10_32[drop % FLOAT_BIG_DIGITS];
+ if (round_up) {
+  u32 carry = float_pow10_32[drop % FLOAT_BIG_DIGITS];
+  while (self->fb_count <= word)
+      self->fb_word[self->fb_count++] = 0;
+  for (i = word; carry; ++i) {
+   if (i == self->fb_count)
+       self->fb_word[self->fb_count++] = 0;
+   self->fb_word[i] += carry;
+   carry = 0;
+   if (self->fb_word[i] >= FLOAT_BIG_BASE) {
+    self->fb_word[i] -= FLOAT_BIG_BASE;
+    carry = 1;
+   }
+  }
+ }
+ float_big_count(self);
+}
+
+
+
+/* ===================================================================================== */
+/*     PRINTING                                                                          */
+/* ===================================================================================== */
+struct float_printer {
+    pformatprinter fp_printer; /* [1..1] The target printer. */
+    void          *fp_closure; /* [?..?] Closure for `fp_printer' */
+    ssize_t        fp_result;  /* Sum of printer return values, or the first negative error. */
+    size_t         fp_bufsiz;  /* Number of buffered characters. */
+    char           fp_buf[64]; /* Output buffer. */
+};
+
+PRIVATE void KCALL
+float_flush(struct float_printer *__restrict self) {
+ ssize_t temp;
+ if (self->fp_bufsiz && self->fp_result >= 0) {
+  temp = (*self->fp_printer)(self->fp_buf,self->fp_bufsiz,self->fp_closure);
+  if unlikely(temp < 0) self->fp_result  = temp;
+  else                  self->fp_result += temp;
+ }
+ self->fp_bufsiz = 0;
+}
+LOCAL void KCALL
+float_putc(struct float_printer *__restrict self, char ch) {
+ if unlikely(self->fp_bufsiz == COMPILER_LENOF(self->fp_buf))
+    float_flush(self);
+ self->fp_buf[self->fp_bufsiz++] = ch;
+}
+PRIVATE void KCALL
+float_repeat(struct float_printer *__restrict self, char ch, size_t count) {
+ ssize_t temp;
+ if (count <= COMPILER_LENOF(self->fp_buf) - self->fp_bufsiz) {
+  while (count--) self->fp_buf[self->fp_bufsiz++] = ch;
+  return;
+ }
+ float_flush(self);
+ if (self->fp_result < 0) return;
+ temp = libc_format_repeat(self->fp_printer,self->fp_closure,ch,count);
+ if unlikely(temp < 0) self->fp_result  = temp;
+ else                  self->fp_result += temp;
+}
+PRIVATE void KCALL
+float_print(struct float_printer *__restrict self, char const *__restrict str) {
+ for (; *str; ++str) float_putc(self,*str);
+}
+/* Print digits `[start,end)' of `big' */
+PRIVATE void KCALL
+float_digits(struct float_printer *__restrict self,
+             struct float_big const *__restrict big,
+             ssize_t start, ssize_t end) {
+ for (; start < end; ++start)
+     float_putc(self,(char)('0' + float_big_digit(big,start)));
+}
+/* Print the decimal exponent `exp', using at least 2 digits. */
+PRIVATE void KCALL
+float_exponent(struct float_printer *__restrict self, s32 exp) {
+ char buf[16],*iter = COMPILER_ENDOF(buf);
+ u32 value = exp < 0 ? (u32)-exp : (u32)exp;
+ *--iter = '\0';
+ do *--iter = (char)('0' + value % 10);
+ while ((value /= 10) != 0);
+ if (iter == COMPILER_ENDOF(buf)-2) *--iter = '0';
+ *--iter = exp < 0 ? '-' : '+';
+ float_print(self,iter);
+}
+LOCAL size_t KCALL float_exponent_length(s32 exp) {
+ u32 value = exp < 0 ? (u32)-exp : (u32)exp;
+ size_t result = 1;
+ while (value >= 10) value /= 10,++result;
+ return 1 + (result < 2 ? 2 : result);
+}
+
+#define FLOAT_STYLE_F 0 /* [-]ddd.ddd */
+#define FLOAT_STYLE_E 1 /* [-]d.ddde[+-]dd */
+#define FLOAT_STYLE_A 2 /* [-]0xh.hhhp[+-]d */
+#define FLOAT_STYLE_S 3 /* inf / nan */
+
+INTERN ssize_t LIBCCALL
+libc_format_float(pformatprinter printer, void *closure,
+                  struct float_value const *__restrict value,
+                  char conv, unsigned int flags,
+                  size_t width, size_t precision) {
+ struct float_printer out;
+ struct float_big big;
+ char sign = 0,lower = conv | 0x20;
+ bool upper = conv != lower;
+ unsigned int style; size_t length,total;
+ ssize_t keep; s32 exp10 = 0;
+ char const *special = NULL;
+ /* Hexadecimal formatting state. */
+ u64 hex_frac = 0; unsigned int hex_lead = 0,hex_digits = 0;
+ size_t hex_zeros = 0; s32 hex_exp = 0;
+
+ out.fp_printer = printer;
+ out.fp_closure = closure;
+ out.fp_result  = 0;
+ out.fp_bufsiz  = 0;
+ if (value->fv_neg) sign = '-';
+ else if (flags & FORMAT_FLOAT_FSIGN) sign = '+';
+ else if (flags & FORMAT_FLOAT_FSPACE) sign = ' ';
+ if (!(flags & FORMAT_FLOAT_FHASPREC))
+       precision = 6;
+ if (value->fv_class != FLOAT_CLASS_FINITE) {
+  style   = FLOAT_STYLE_S;
+  special = value->fv_class == FLOAT_CLASS_INF ? (upper ? "INF" : "inf")
+                                               : (upper ? "NAN" : "nan");
+  length  = 3;
+  flags  &= ~FORMAT_FLOAT_FPADZERO;
+ } else if (lower == 'a') {
+  u64 mant = value->fv_mant;
+  style = FLOAT_STYLE_A;
+  if (!mant) {
+   hex_lead = 0;
+  } else {
+   unsigned int bits = 63 - clz(mant); /* Number of fraction bits. */
+   hex_lead   = 1;
+   hex_exp    = value->fv_exp + (s32)bits;
+   hex_digits = (bits + 3) / 4;
+   hex_frac   = (mant & ((UINT64_C(1) << bits)-1)) << (hex_digits*4 - bits);
+   if (flags & FORMAT_FLOAT_FHASPREC && precision < hex_digits) {
+    /* Round to `precision' hex digits (half to even). */
+    unsigned int drop = (hex_digits - (unsigned int)precision) * 4;
+    u64 rem,half = UINT64_C(1) << (drop-1);
+    if (drop == 64) {
+     rem = hex_frac,hex_frac = 0;
+    } else {
+     rem = hex_frac & ((UINT64_C(1) << drop)-1);
+     hex_frac >>= drop;
+    }
+    hex_digits = (unsigned int)precision;
+    if (rem > half || (rem == half && ((hex_digits ? hex_frac : hex_lead) & 1))) {
+     ++hex_frac;
+     if (hex_frac == (hex_digits == 16 ? 0 : UINT64_C(1) << (hex_digits*4)))
+         hex_frac = 0,++hex_lead;
+    }
+   }
+  }
+  if (flags & FORMAT_FLOAT_FHASPREC) {
+   if (precision > hex_digits)
+       hex_zeros = precision - hex_digits;
+  } else {
+   /* Strip trailing zeros. */
+   while (hex_digits && !(hex_frac & 0xf))
+       hex_frac >>= 4,--hex_digits;
+  }
+  length = 2 + 1 + hex_digits + hex_zeros + 1;
+  if (hex_digits || hex_zeros || (flags & FORMAT_FLOAT_FPREFIX)) ++length;
+  length += float_exponent_length(hex_exp) - (hex_exp >= -9 && hex_exp <= 9);
+ } else {
+  bool general = lower == 'g' || lower == 'r';
+  if (lower == 'g' && !precision) precision = 1;
+  /* Figure out the digits of the value. */
+  if (!value->fv_mant) {
+   float_big_setu64(&big,0,0);
+  } else if (value->fv_type == FLOAT_TYPE_DOUBLE) {
+   u64 digits;
+   exp10 = ryu_shortest(value,&digits);
+   float_big_setu64(&big,digits,exp10);
+   if (lower == 'r') goto got_digits;
+   /* The shortest representation can be used if the requested number of
+    * digits doesn't exceed its length, and is small enough to guaranty
+    * that a rounding boundary can't be closer to it than the exact value.
+    * NOTE: This relies on `DBL_DIG', which doesn't hold for subnormals. */
+   keep = lower == 'e' ? (ssize_t)precision + 1 :
+          lower == 'f' ? (ssize_t)big.fb_ndigits + big.fb_exp + (ssize_t)precision :
+                         (ssize_t)precision;
+   if (keep >= (ssize_t)big.fb_ndigits && keep <= 15 &&
+      (value->fv_mant >> 52))
+       goto got_digits;
+   if (keep >= 0 && keep < (ssize_t)big.fb_ndigits) {
+    /* Fewer digits are needed. The exact value is less than 7 units of the
+     * last digit away from `digits', so rounding `digits' instead gives the
+     * same result, unless the discarded part is too close to one half. */
+    u64 unit = 1,half,rem;
+    ssize_t drop = (ssize_t)big.fb_ndigits - keep;
+    while (drop--) unit *= 10;
+    half = unit / 2;
+    rem  = digits % unit;
+    if (rem > half ? rem - half >= 20 : half - rem >= 20) {
+     digits -= rem;
+     if (rem > half) digits += unit;
+     float_big_setu64(&big,digits,exp10);
+     goto got_digits;
+    }
+   }
+   float_big_load(&big,value->fv_mant,value->fv_exp);
+  } else {
+   float_big_load(&big,value->fv_mant,value->fv_exp);
+  }
+  /* Round to the requested number of digits. */
+  keep = lower == 'e' ? (ssize_t)precision + 1 :
+         lower == 'f' ? (ssize_t)big.fb_ndigits + big.fb_exp + (ssize_t)precision :
+         lower == 'g' ? (ssize_t)precision : LDBL_DECIMAL_DIG;
+  float_big_round(&big,keep);
+got_digits:
+  /* The decimal exponent of the first digit. */
+  exp10 = big.fb_count ? (s32)big.fb_ndigits + big.fb_exp - 1 : 0;
+  if (general) {
+   size_t sig = float_big_significant(&big);
+   if (lower == 'r' ? (exp10 >= -4 && exp10 < 16)
+                    : ((s32)precision > exp10 && exp10 >= -4)) {
+    style     = FLOAT_STYLE_F;
+    precision = lower == 'r' ? 0 : (size_t)((s32)precision - 1 - exp10);
+    if (lower == 'r' || !(flags & FORMAT_FLOAT_FPREFIX)) {
+     ssize_t need = (ssize_t)sig - (exp10 + 1);
+     if (need < 0) need = 0;
+     if (lower == 'r' || (size_t)need < precision)
+         precision = (size_t)need;
+    }
+   } else {
+    style     = FLOAT_STYLE_E;
+    precision = lower == 'r' ? 0 : precision - 1;
+    if (lower == 'r' || !(flags & FORMAT_FLOAT_FPREFIX)) {
+     size_t need = sig ? sig - 1 : 0;
+     if (lower == 'r' || need < precision)
+         precision = need;
+    }
+   }
+  } else {
+   style = lower == 'e' ? FLOAT_STYLE_E : FLOAT_STYLE_F;
+  }
+  if (!big.fb_count) big.fb_exp = 0; /* Zero. */
+  if (style == FLOAT_STYLE_E) {
+   length = 1 + precision + float_exponent_length(exp10) + 1;
+  } else {
+   ssize_t whole = (ssize_t)big.fb_ndigits + big.fb_exp;
+   length = (size_t)(whole > 0 ? whole : 1) + precision;
+  }
+  if (precision || (flags & FORMAT_FLOAT_FPREFIX)) ++length;
+ }
+
+ /* Print the value, including padding. */
+ total = length + (sign ? 1 : 0);
+ if (total < width && !(flags & (FORMAT_FLOAT_FLJUST|FORMAT_FLOAT_FPADZERO)))
+     float_repeat(&out,' ',width - total);
+ if (sign) float_putc(&out,sign);
+ if (style == FLOAT_STYLE_A) {
+  float_putc(&out,'0');
+  float_putc(&out,upper ? 'X' : 'x');
+ }
+ if (total < width && (flags & (FORMAT_FLOAT_FLJUST|FORMAT_FLOAT_FPADZERO)) == FORMAT_FLOAT_FPADZERO)
+     float_repeat(&out,'0',width - total);
+ switch (style) {
+
+ case FLOAT_STYLE_S:
+  float_print(&out,special);
+  break;
+
+ case FLOAT_STYLE_A:
+  float_putc(&out,(char)('0' + hex_lead));
+  if (hex_digits || hex_zeros || (flags & FORMAT_FLOAT_FPREFIX))
+      float_putc(&out,'.');
+  while (hex_digits--)
+      float_putc(&out,libc_decimals[upper][(hex_frac >> (hex_digits*4)) & 0xf]);
+  float_repeat(&out,'0',hex_zeros);
+  float_putc(&out,upper ? 'P' : 'p');
+  if (hex_exp >= 0) float_putc(&out,'+');
+  else float_putc(&out,'-'),hex_exp = -hex_exp;
+  {
+   char buf[16],*iter = COMPILER_ENDOF(buf);
+   *--iter = '\0';
+   do *--iter = (char)('0' + (u32)hex_exp % 10);
+   while ((hex_exp = (s32)((u32)hex_exp / 10)) != 0);
+   float_print(&out,iter);
+  }
+  break;
+
+ case FLOAT_STYLE_E:
+  float_digits(&out,&big,0,1);
+  if (precision || (flags & FORMAT_FLOAT_FPREFIX))
+      float_putc(&out,'.');
+  float_digits(&out,&big,1,1 + (ssize_t)precision);
+  float_putc(&out,upper ? 'E' : 'e');
+  float_exponent(&out,exp10);
+  break;
+
+ default: {
+  ssize_t whole = (ssize_t)big.fb_ndigits + big.fb_exp;
+  if (whole <= 0) float_putc(&out,'0');
+  else float_digits(&out,&big,0,whole);
+  if (precision || (flags & FORMAT_FLOAT_FPREFIX))
+      float_putc(&out,'.');
+  float_digits(&out,&big,whole,whole + (ssize_t)precision);
+ } break;
+ }
+ if (total < width && (flags & FORMAT_FLOAT_FLJUST))
+     float_repeat(&out,' ',width - total);
+ float_flush(&out);
+ return out.fp_result;
+}
+
+
+
+/* ===================================================================================== */
+/*     PARSING                                                                           */
+/* ===================================================================================== */
+struct float_format {
+    u8  ff_mantbits; /* Number of fraction bits (excluding the integer bit). */
+    u8  ff_expbits;  /* Number of exponent bits. */
+    u8  ff_lemire;   /* The Eisel-Lemire algorithm may be used. */
+    u8  ff_pad;      /* ... */
+    s32 ff_bias;     /* Exponent bias (e.g. `-1023' for `double') */
+    s32 ff_maxdp;    /* Decimal point positions greater than this always overflow. */
+    s32 ff_mindp;    /* Decimal point positions lower than this always underflow. */
+    s32 ff_minq;     /* [valid_if(ff_lemire)] Lowest power of 10 that may produce a non-zero value. */
+    s32 ff_maxq;     /* [valid_if(ff_lemire)] Greatest power of 10 that may produce a finite value. */
+    s32 ff_rte_min;  /* [valid_if(ff_lemire)] Lowest power of 10 for which ties are possible. */
+    s32 ff_rte_max;  /* [valid_if(ff_lemire)] Greatest power of 10 for which ties are possible. */
+};
+
+PRIVATE struct float_format const float_format_float = {
+    23, 8, 1, 0, -127, 40, -50, -65, 38, -17, 10
+};
+PRIVATE struct float_format const float_format_double = {
+    52, 11, 1, 0, -1023, 310, -330, -342, 308, -4, 23
+};
+#if LDBL_MANT_DIG == 64
+PRIVATE struct float_format const float_format_ldouble = {
+    63, 15, 0, 0, -16383, 4934, -4960, 0, 0, 0, 0
+};
+#endif
+
+/* A binary floating point value that has been rounded to some `struct float_format':
+ *   - `fb_mant' contains `ff_mantbits+1' bits, including the integer bit.
+ *   - `fb_bexp' is the biased exponent (ZERO(0) for subnormals and ZERO(0)) */
+struct float_bits {
+    u64 fb_mant; /* Mantissa */
+    u32 fb_bexp; /* Biased exponent */
+};
+
+LOCAL void KCALL
+float_bits_zero(struct float_bits *__restrict self) {
+ self->fb_mant = 0;
+ self->fb_bexp = 0;
+}
+LOCAL void KCALL
+float_bits_inf(struct float_bits *__restrict self,
+               struct float_format const *__restrict fmt) {
+ /* NOTE: x87 long doubles have an explicit integer bit that must be set. */
+ self->fb_mant = fmt->ff_mantbits == 63 ? UINT64_C(1) << 63 : 0;
+ self->fb_bexp = ((u32)1 << fmt->ff_expbits)-1;
+}
+
+/* Round `(hi:lo) * 2^exp' (with `sticky' indicating additional
+ * non-zero bits below `lo') to the nearest value of `fmt'. */
+PRIVATE void KCALL
+float_round(u64 hi, u64 lo, bool sticky, s32 exp,
+            struct float_format const *__restrict fmt,
+            struct float_bits *__restrict result) {
+ unsigned int prec = fmt->ff_mantbits + 1,lz;
+ s32 ue,shift; u64 mant; bool half,rest;
+ if (!hi) {
+  if (!lo) { float_bits_zero(result); return; }
+  hi = lo,lo = 0,exp -= 64;
+ }
+ lz = clz(hi);
+ if (lz) {
+  hi   = (hi << lz) | (lo >> (64 - lz));
+  lo <<= lz;
+  exp -= (s32)lz;
+ }
+ ue    = exp + 127; /* Exponent of the most significant bit. */
+ shift = 64 - (s32)prec;
+ if (ue < fmt->ff_bias + 1) {
+  /* Subnormal (or underflow to ZERO(0)) */
+  shift += (fmt->ff_bias + 1) - ue;
+  ue     = fmt->ff_bias + 1;
+ }
+ if (ue - fmt->ff_bias >= ((s32)1 << fmt->ff_expbits)-1)
+     goto overflow;
+ if (shift == 0) {
+  mant = hi;
+  half = (lo >> 63) != 0;
+  rest = (lo << 1) != 0 || sticky;
+ } else if (shift < 64) {
+  mant = hi >> shift;
+  half = ((hi >> (shift-1)) & 1) != 0;
+  rest = (hi & ((UINT64_C(1) << (shift-1))-1)) != 0 || lo != 0 || sticky;
+ } else if (shift == 64) {
+  mant = 0;
+  half = (hi >> 63) != 0;
+  rest = (hi << 1) != 0 || lo != 0 || sticky;
+ } else {
+  mant = 0;
+  half = false;
+  rest = true;
+ }
+ if (half && (rest || (mant & 1))) {
+  ++mant;
+  if (prec == 64 ? mant == 0 : mant == (UINT64_C(1) << prec)) {
+   mant = UINT64_C(1) << (prec-1);
+   if (++ue - fmt->ff_bias >= ((s32)1 << fmt->ff_expbits)-1)
+       goto overflow;
+  }
+ }
+ result->fb_mant = mant;
+ result->fb_bexp = (mant >> (prec-1)) & 1 ? (u32)(ue - fmt->ff_bias) : 0;
+ return;
+overflow:
+ float_bits_inf(result,fmt);
+}
+
+/* The Eisel-Lemire algorithm: Convert `w * 10^q' to `fmt'.
+ * @return: false: The result cannot be determined this way. */
+PRIVATE bool KCALL
+float_lemire(u64 w, s32 q,
+             struct float_format const *__restrict fmt,
+             struct float_bits *__restrict result) {
+ unsigned int lz,upperbit,shift;
+ u64 hi,lo,mant,mask; s32 power2;
+ u64 const *pow5;
+ if (!w || q < fmt->ff_minq) { float_bits_zero(result); return true; }
+ if (q > fmt->ff_maxq) { float_bits_inf(result,fmt); return true; }
+ lz   = clz(w);
+ w  <<= lz;
+ pow5 = lemire_pow5[q - FLOAT_LEMIRE_MIN_POW10];
+ lo   = float_umul128(w,pow5[0],&hi);
+ mask = (u64)-1 >> (fmt->ff_mantbits + 3);
+ if ((hi & mask) == mask) {
+  /* The truncated product isn't precise enough. -> Include the next 64 bits of 5^q */
+  u64 hi2;
+  float_umul128(w,pow5[1],&hi2);
+  lo += hi2;
+  if (hi2 > lo) ++hi;
+  if (lo == (u64)-1 && (q < -27 || q > 55))
+      return false;
+ }
+ upperbit = (unsigned int)(hi >> 63);
+ shift    = upperbit + 64 - fmt->ff_mantbits - 3;
+ mant     = hi >> shift;
+ power2   = ((((152170 + 65536) * q) >> 16) + 63) +
+             (s32)upperbit - (s32)lz - fmt->ff_bias;
+ if (power2 <= 0)
+     return false; /* Subnormal (leave these to the slow path) */
+ /* Ties can only happen for a small range of exponents, in which case
+  * the product is exact, and the lower bits of `lo' are all zero. */
+ if (lo <= 1 && q >= fmt->ff_rte_min && q <= fmt->ff_rte_max &&
+    (mant & 3) == 1 && (mant << shift) == hi)
+     mant &= ~(u64)1;
+ mant += mant & 1;
+ mant >>= 1;
+ if (mant >= (UINT64_C(2) << fmt->ff_mantbits)) {
+  mant = UINT64_C(1) << fmt->ff_mantbits;
+  ++power2;
+ }
+ if (power2 >= ((s32)1 << fmt->ff_expbits)-1) {
+  float_bits_inf(result,fmt);
+  return true;
+ }
+ result->fb_mant = mant;
+ result->fb_bexp = (u32)power2;
+ return true;
+}
+
+
+/* Arbitrary precision decimal arithmetic (operating on `struct float_digits') */
+#define FLOAT_MAXSHIFT 60 /* Max shift that can be done without overflowing a u64 */
+
+/* Remove trailing zeros. */
+LOCAL void KCALL
+float_dec_trim(struct float_digits *__restrict self) {
+ while (self->fd_ndigits && !self->fd_digit[self->fd_ndigits-1])
+      --self->fd_ndigits;
+ if (!self->fd_ndigits) self->fd_dp = 0;
+}
+
+/* Multiply by `2^k' (`k <= FLOAT_MAXSHIFT') */
+PRIVATE void KCALL
+float_dec_lshift(struct float_digits *__restrict self, unsigned int k) {
+ /* The number of digits increases by either `delta' or `delta-1' */
+ size_t delta = (size_t)FLOAT_LOG10_POW2(k) + 1;
+ size_t r = self->fd_ndigits,w = r + delta;
+ u64 n = 0;
+ while (r) {
+  u64 quo;
+  n  += (u64)self->fd_digit[--r] << k;
+  quo = n / 10;
+  self->fd_digit[--w] = (u8)(n - quo * 10);
+  n   = quo;
+ }
+ while (n) {
+  u64 quo = n / 10;
+  self->fd_digit[--w] = (u8)(n - quo * 10);
+  n = quo;
+ }
+ /* `w' is now the number of leading digit slots that went unused. */
+ if (w) {
+  delta -= w;
+  libc_memmove(self->fd_digit,self->fd_digit + w,
+               self->fd_ndigits + delta);
+ }
+ self->fd_ndigits += delta;
+ self->fd_dp      += (s32)delta;
+ if (self->fd_ndigits > FLOAT_DIGITS_MAX) {
+  size_t i;
+  for (i = FLOAT_DIGITS_MAX; i < self->fd_ndigits; ++i)
+      if (self->fd_digit[i]) self->fd_trunc = 1;
+  self->fd_ndigits = FLOAT_DIGITS_MAX;
+ }
+ float_dec_trim(self);
+}
+
+/* Divide by `2^k' (`k <= FLOAT_MAXSHIFT') */
+PRIVATE void KCALL
+float_dec_rshift(struct float_digits *__restrict self, unsigned int k) {
+ size_t r = 0,w = 0; u64 n = 0,mask;
+ for (; !(n >> k); ++r) {
+  if (r >= self->fd_ndigits) {
+   if (!n) { self->fd_ndigits = 0; return; }
+   while (!(n >> k)) n *= 10,++r;
+   break;
+  }
+  n = n * 10 + self->fd_digit[r];
+ }
+ self->fd_dp -= (s32)r - 1;
+ mask = (UINT64_C(1) << k)-1;
+ for (; r < self->fd_ndigits; ++r) {
+  u8 c = self->fd_digit[r];
+  self->fd_digit[w++] = (u8)(n >> k);
+  n = (n & mask) * 10 + c;
+ }
+ while (n) {
+  u8 digit = (u8)(n >> k);
+  n = (n & mask) * 10;
+  if (w < FLOAT_DIGITS_MAX)
+      self->fd_digit[w++] = digit;
+  else if (digit)
+      self->fd_trunc = 1;
+ }
+ self->fd_ndigits = w;
+ float_dec_trim(self);
+}
+
+PRIVATE void KCALL
+float_dec_shift(struct float_digits *__restrict self, s32 k) {
+ if (!self->fd_ndigits) return;
+ if (k > 0) {
+  for (; k > FLOAT_MAXSHIFT; k -= FLOAT_MAXSHIFT)
+      float_dec_lshift(self,FLOAT_MAXSHIFT);
+  float_dec_lshift(self,(unsigned int)k);
+ } else if (k < 0) {
+  for (; k < -FLOAT_MAXSHIFT; k += FLOAT_MAXSHIFT)
+      float_dec_rshift(self,FLOAT_MAXSHIFT);
+  float_dec_rshift(self,(unsigned int)-k);
+ }
+}
+
+/* Round to the nearest integer (half to even), setting `*pcarry'
+ * when the result overflows to `2^64'. (Requires `fd_dp <= 20') */
+PRIVATE u64 KCALL
+float_dec_integer(struct float_digits *__restrict self, bool *__restrict pcarry) {
+ u64 result = 0; s32 i;
+ bool round_up = false;
+ for (i = 0; i < self->fd_dp && (size_t)i < self->fd_ndigits; ++i)
+      result = result * 10 + self->fd_digit[i];
+ for (; i < self->fd_dp; ++i)
+      result *= 10;
+ if (self->fd_dp >= 0 && (size_t)self->fd_dp < self->fd_ndigits) {
+  u8 next = self->fd_digit[self->fd_dp];
+  if (next == 5 && (size_t)self->fd_dp + 1 == self->fd_ndigits) {
+   /* Exactly half-way -> round to even. */
+   round_up = self->fd_trunc || (result & 1);
+  } else {
+   round_up = next >= 5;
+  }
+ }
+ *pcarry = false;
+ if (round_up && !++result)
+     *pcarry = true;
+ return result;
+}
+
+/* Decimal point positions used to scale values towards `[0.5,1)'. */
+PRIVATE u8 const float_powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+
+/* Convert a decimal to `fmt' by scaling it into the range `[2^(p-1),2^p)'.
+ * This is always correct, though also fairly slow (and destroys `self') */
+PRIVATE void KCALL
+float_dec_tobits(struct float_digits *__restrict self,
+                 struct float_format const *__restrict fmt,
+                 struct float_bits *__restrict result) {
+ s32 exp = 0,n; u64 mant; bool carry;
+ while (self->fd_dp > 0) {
+  n = self->fd_dp >= (s32)COMPILER_LENOF(float_powtab) ? 27 : float_powtab[self->fd_dp];
+  float_dec_shift(self,-n);
+  exp += n;
+ }
+ while (self->fd_dp < 0 || (self->fd_dp == 0 && self->fd_digit[0] < 5)) {
+  n = -self->fd_dp >= (s32)COMPILER_LENOF(float_powtab) ? 27 : float_powtab[-self->fd_dp];
+  float_dec_shift(self,n);
+  exp -= n;
+ }
+ /* The value is now in `[0.5,1) * 2^exp' -> Switch to `[1,2)' */
+ --exp;
+ if (exp < fmt->ff_bias + 1) {
+  /* Subnormal */
+  n = fmt->ff_bias + 1 - exp;
+  float_dec_shift(self,-n);
+  exp += n;
+ }
+ if (exp - fmt->ff_bias >= ((s32)1 << fmt->ff_expbits)-1)
+     goto overflow;
+ float_dec_shift(self,1 + fmt->ff_mantbits);
+ mant = float_dec_integer(self,&carry);
+ if (carry || (fmt->ff_mantbits < 63 &&
+               mant == (UINT64_C(2) << fmt->ff_mantbits))) {
+  mant = UINT64_C(1) << fmt->ff_mantbits;
+  if (++exp - fmt->ff_bias >= ((s32)1 << fmt->ff_expbits)-1)
+      goto overflow;
+ }
+ result->fb_mant = mant;
+ result->fb_bexp = (mant >> fmt->ff_mantbits) & 1 ? (u32)(exp - fmt->ff_bias) : 0;
+ return;
+overflow:
+ float_bits_inf(result,fmt);
+}
+
+PRIVATE void KCALL
+float_tobits(struct float_digits *__restrict self,
+             struct float_format const *__restrict fmt,
+             struct float_bits *__restrict result) {
+ bool nonzero = self->fd_ndigits != 0;
+ switch (self->fd_kind) {
+
+ case FLOAT_DIGITS_INF:
+  float_bits_inf(result,fmt);
+  return;
+
+ case FLOAT_DIGITS_NAN:
+  /* Quiet NaN */
+  result->fb_mant = (UINT64_C(3) << (fmt->ff_mantbits - 1));
+  result->fb_bexp = ((u32)1 << fmt->ff_expbits)-1;
+  return;
+
+ case FLOAT_DIGITS_HEX: {
+  u64 hi = 0,lo = 0; size_t i,count;
+  count = self->fd_ndigits;
+  if (count > 32) count = 32;
+  for (i = 0; i < count; ++i) {
+   hi = (hi << 4) | (lo >> 60);
+   lo = (lo << 4) | self->fd_digit[i];
+  }
+  float_round(hi,lo,self->fd_trunc || self->fd_ndigits > 32,
+              4 * (self->fd_dp - (s32)count) + self->fd_exp,
+              fmt,result);
+ } break;
+
+ default: {
+  u64 w = 0; s32 q; size_t i,count;
+  if (!self->fd_ndigits) { float_bits_zero(result); return; }
+  if (self->fd_dp > fmt->ff_maxdp) { float_bits_inf(result,fmt); break; }
+  if (self->fd_dp < fmt->ff_mindp) { float_bits_zero(result); break; }
+  count = self->fd_ndigits;
+  if (count > 19) count = 19;
+  for (i = 0; i < count; ++i)
+      w = w * 10 + self->fd_digit[i];
+  q = self->fd_dp - (s32)count;
+  if (count == self->fd_ndigits && !self->fd_trunc) {
+   /* Small integers are exact. */
+   if (q >= 0 && self->fd_dp <= 19) {
+    while (q--) w *= 10;
+    float_round(0,w,false,0,fmt,result);
+    break;
+   }
+   if (fmt->ff_lemire && float_lemire(w,q,fmt,result))
+       break;
+  } else if (fmt->ff_lemire) {
+   /* Too many digits: If `w' and `w+1' produce the
+    * same value, then so must everything in-between. */
+   struct float_bits upper;
+   if (float_lemire(w,q,fmt,result) &&
+       float_lemire(w+1,q,fmt,&upper) &&
+       result->fb_mant == upper.fb_mant &&
+       result->fb_bexp == upper.fb_bexp)
+       break;
+  }
+  float_dec_tobits(self,fmt,result);
+ } break;
+ }
+ /* Indicate overflow, underflow and subnormal results. */
+ if (nonzero &&
+    (result->fb_bexp == ((u32)1 << fmt->ff_expbits)-1 ||
+     result->fb_bexp == 0))
+     libc_seterrno(ERANGE);
+}
+
+INTERN float LIBCCALL
+libc_float_tofloat(struct float_digits *__restrict self) {
+ union { float f; u32 i; } result;
+ struct float_bits bits;
+ float_tobits(self,&float_format_float,&bits);
+ result.i = ((u32)self->fd_neg << 31) | (bits.fb_bexp << 23) |
+            ((u32)bits.fb_mant & ((UINT32_C(1) << 23)-1));
+ return result.f;
+}
+
+INTERN double LIBCCALL
+libc_float_todouble(struct float_digits *__restrict self) {
+ union { double f; u64 i; } result;
+ struct float_bits bits;
+ float_tobits(self,&float_format_double,&bits);
+ result.i = ((u64)self->fd_neg << 63) | ((u64)bits.fb_bexp << 52) |
+            (bits.fb_mant & ((UINT64_C(1) << 52)-1));
+ return result.f;
+}
+
+INTERN long double LIBCCALL
+libc_float_toldouble(struct float_digits *__restrict self) {
+#if LDBL_MANT_DIG == 64
+ union { long double f; struct { u64 m; u16 se; } i; } result;
+ struct float_bits bits;
+ float_tobits(self,&float_format_ldouble,&bits);
+ result.i.m  = bits.fb_mant;
+ result.i.se = (u16)(((u32)self->fd_neg << 15) | bits.fb_bexp);
+ return result.f;
+#else
+ return (long double)libc_float_todouble(self);
+#endif
+}
+
+DECL_END
+#endif /* !CONFIG_LIBC_LIMITED_API */
+
+#endif /* !GUARD_HYBRID_FLOAT_C */
@@ -395,6 +395,38 @@ struct va_cont { va_list args; };
 
 #define UNIQUE(x) PP_CAT2(LIBC_FORMAT_PRINTF,x)
 
+#ifndef CONFIG_LIBC_LIMITED_API
+#if F_LJUST != FORMAT_FLOAT_FLJUST || F_SIGN != FORMAT_FLOAT_FSIGN || \
+    F_SPACE != FORMAT_FLOAT_FSPACE || F_PADZERO != FORMAT_FLOAT_FPADZERO || \
+    F_HASPREC != FORMAT_FLOAT_FHASPREC || F_PREFIX != FORMAT_FLOAT_FPREFIX
+#error "Printf flags don't match `FORMAT_FLOAT_F*'"
+#endif
+PRIVATE ssize_t LIBCCALL
+UNIQUE(print_float)(PFORMATPRINTER printer, void *closure,
+                    struct float_value const *__restrict value,
+                    char conv, unsigned int flags,
+                    size_t width, size_t precision) {
+#if FORMAT_OPTION_CHARTYPE == CHARACTER_TYPE_CHAR
+ return libc_format_float(printer,closure,value,conv,
+                          flags,width,precision);
+#else
+ ssize_t COMPILER_IGNORE_UNINITIALIZED(result);
+#if FORMAT_OPTION_CHARTYPE == CHARACTER_TYPE_CHAR16
+ STRUCT_PRINTER fwd = W16PRINTER_INIT(printer,closure);
+#else
+ STRUCT_PRINTER fwd = W32PRINTER_INIT(printer,closure);
+#endif
+ TRY {
+  result = libc_format_float(&STRUCT_PRINTER_PRINT,&fwd,value,
+                             conv,flags,width,precision);
+ } FINALLY {
+  STRUCT_PRINTER_FINI(&fwd);
+ }
+ return result;
+#endif
+}
+#endif /* !CONFIG_LIBC_LIMITED_API */
+
 #ifndef FORMAT_OPTION_POSITIONAL
 #ifdef __KERNEL__
 #define KERNEL_XFORMAT(x) x
@@ -410,6 +442,7 @@ struct va_cont { va_list args; };
                    callback(UNIQUE(xformat_vinfo_name),UNIQUE(xformat_vinfo)) \
     KERNEL_XFORMAT(callback(UNIQUE(xformat_path_name),UNIQUE(xformat_path))) \
       USER_XFORMAT(callback(UNIQUE(xformat_errno_name),UNIQUE(xformat_errno))) \
+      USER_XFORMAT(callback(UNIQUE(xformat_float_name),UNIQUE(xformat_float))) \
 
 PRIVATE format_T_char const UNIQUE(xformat_hex_name)[] = { 'h', 'e', 'x' };
 PRIVATE ssize_t LIBCCALL
@@ -834,6 +867,31 @@ UNIQUE(xformat_errno)(PFORMATPRINTER printer, void *closure,
  return LIBC_FORMAT_PRINTF(printer,closure,str_name_and_desc,libc_strerrorname_s(error),msg);
 #endif
 }
+
+/* `%[float]': Print the shortest representation of a `double'
+ * (or `long double' when used as `%L[float]') that reads back
+ * as the same value, using either fixed or scientific notation. */
+PRIVATE format_T_char const UNIQUE(xformat_float_name)[] = { 'f', 'l', 'o', 'a', 't' };
+PRIVATE ssize_t LIBCCALL
+UNIQUE(xformat_float)(PFORMATPRINTER printer, void *closure,
+                      format_T_char const *UNUSED(arg), unsigned int length,
+                      unsigned int flags, size_t UNUSED(precision),
+#ifdef FORMAT_OPTION_LOCALE
+                      locale_t UNUSED(locale),
+#endif
+                      struct va_cont *args) {
+ struct float_value value;
+#ifndef FORMAT_OPTION_WCHAR16
+ if (length == LENGTH_L)
+     libc_float_fromldouble(&value,va_arg(args->args,long double));
+ else
+#endif
+ {
+  libc_float_fromdouble(&value,va_arg(args->args,double));
+ }
+ return UNIQUE(print_float)(printer,closure,&value,'r',
+                            flags & ~F_HASPREC,0,0);
+}
 #endif /* !__KERNEL__ */
 
 
@@ -1153,6 +1211,28 @@ print_string:
   }
  } break;
 
+#ifndef CONFIG_LIBC_LIMITED_API
+ {
+  struct float_value fvalue;
+ case 'e': case 'E':
+ case 'f': case 'F':
+ case 'g': case 'G':
+ case 'a': case 'A':
+#ifndef FORMAT_OPTION_WCHAR16 /* DOS uses the same type for `double' and `long double' */
+  if (length == LENGTH_L)
+      libc_float_fromldouble(&fvalue,va_arg(args,long double));
+  else
+#endif
+  {
+   libc_float_fromdouble(&fvalue,va_arg(args,double));
+  }
+  temp = UNIQUE(print_float)(printer,closure,&fvalue,(char)ch,
+                             flags,width,precision);
+  if unlikely(temp < 0) goto err;
+  result += temp;
+ } break;
+#endif /* !CONFIG_LIBC_LIMITED_API */
+
 #ifndef FORMAT_OPTION_POSITIONAL
  {
   format_T_char const *xformat_start;
@@ -119,7 +119,27 @@ DECL_BEGIN
 #endif
 #define EXPORT_STRONG(name,symbol)  DEFINE_PUBLIC_ALIAS(name,symbol)
 
+#if defined(__i386__) || defined(__x86_64__)
+/* Optional CPU features used by the string functions from `string(32|64).S'.
+ * These are detected by `x86_string_detect()' the first time a
+ * large copy/fill is performed (or eagerly by the kernel during boot). */
+#define X86_STRING_FDETECTED  0x01 /* `x86_string_features' has been initialized. */
+#define X86_STRING_FERMS      0x02 /* Enhanced `rep movsb' / `rep stosb' (`CPUID_7B_ERMS') */
+#define X86_STRING_FFSRM      0x04 /* Fast short `rep movsb' (`CPUID_7D_FSRM') */
+/* Minimum number of bytes before `rep movsb' / `rep stosb' is used with ERMS.
+ * On x86_64, `rep movsb' is used for copies of any size when FSRM is available. */
+#ifndef CONFIG_ERMS_THRESHOLD
+#define CONFIG_ERMS_THRESHOLD 512
+#endif
+#endif
+
 #ifdef __CC__
+#if defined(__i386__) || defined(__x86_64__)
+/* [const_after(X86_STRING_FDETECTED)] Set of `X86_STRING_F*' */
+INTDEF u32 x86_string_features;
+/* Initialize `x86_string_features'. (Preserves all registers) */
+INTDEF void LIBCCALL x86_string_detect(void);
+#endif
 #if 1
 #define LIBC_TRY                  TRY
 #define LIBC_FINALLY              FINALLY
@@ -430,6 +450,83 @@ INTDEF ssize_t  LIBCCALL   libd_format_vscanf_l(pformatgetc scanner, pformatunge
 
 
 
+/* ===================================================================================== */
+/*     FLOAT                                                                             */
+/* ===================================================================================== */
+#ifndef CONFIG_LIBC_LIMITED_API
+INTDEF void LIBCCALL libc_seterrno(errno_t value);
+
+/* A finite value is `(-1)^fv_neg * fv_mant * 2^fv_exp' */
+#define FLOAT_CLASS_FINITE 0
+#define FLOAT_CLASS_INF    1
+#define FLOAT_CLASS_NAN    2
+#define FLOAT_TYPE_DOUBLE  0
+#define FLOAT_TYPE_LDOUBLE 1
+struct float_value {
+    u64   fv_mant;  /* Integer mantissa (ZERO(0) for +/- 0.0) */
+    s32   fv_exp;   /* Binary exponent */
+    u8    fv_neg;   /* The sign bit is set. */
+    u8    fv_class; /* The class of value (One of `FLOAT_CLASS_*') */
+    u8    fv_type;  /* The type of value (One of `FLOAT_TYPE_*') */
+    u8    fv_pad;   /* ... */
+};
+INTDEF void LIBCCALL libc_float_fromdouble(struct float_value *__restrict self, double value);
+INTDEF void LIBCCALL libc_float_fromldouble(struct float_value *__restrict self, long double value);
+
+/* Print `value' the way printf() would for the conversion `conv'
+ * (One of `eEfFgGaA', or `r' for the shortest representation that
+ *  reads back as the same value, formatted like `%g' would)
+ * @param: flags: Set of `FORMAT_FLOAT_F*'
+ * @return: * : The sum of all printer return values, or the first negative one. */
+#define FORMAT_FLOAT_FLJUST   0x02 /* `-' */
+#define FORMAT_FLOAT_FSIGN    0x04 /* `+' */
+#define FORMAT_FLOAT_FSPACE   0x08 /* ` ' */
+#define FORMAT_FLOAT_FPADZERO 0x10 /* `0' */
+#define FORMAT_FLOAT_FHASPREC 0x40 /* `precision' was given. */
+#define FORMAT_FLOAT_FPREFIX  0x80 /* `#' */
+INTDEF ssize_t LIBCCALL
+libc_format_float(pformatprinter printer, void *closure,
+                  struct float_value const *__restrict value,
+                  char conv, unsigned int flags,
+                  size_t width, size_t precision);
+
+/* The digits of a floating point number, as parsed by `strtod()' & friends.
+ * Decimal:     `0.<fd_digit...> * 10^fd_dp'
+ * Hexadecimal: `0x0.<fd_digit...> * 16^fd_dp * 2^fd_exp'
+ * Leading and trailing ZERO(0)-digits are not stored. */
+#define FLOAT_DIGITS_MAX    800 /* Max number of digits that are stored. */
+#define FLOAT_DIGITS_SLACK  20  /* Additional space used during conversion. */
+#define FLOAT_DIGITS_DPMAX  0x10000000 /* Max magnitude of `fd_dp' / `fd_exp' */
+#define FLOAT_DIGITS_DEC    0
+#define FLOAT_DIGITS_HEX    1
+#define FLOAT_DIGITS_INF    2
+#define FLOAT_DIGITS_NAN    3
+struct float_digits {
+    u8     fd_kind;    /* The kind of number (One of `FLOAT_DIGITS_*') */
+    u8     fd_neg;     /* The number is negative. */
+    u8     fd_trunc;   /* Non-zero digits past `FLOAT_DIGITS_MAX' were discarded. */
+    u8     fd_pad;     /* ... */
+    s32    fd_dp;      /* Position of the decimal point. */
+    s32    fd_exp;     /* Additional binary exponent (hexadecimal only). */
+    size_t fd_ndigits; /* Number of digits. */
+    u8     fd_digit[FLOAT_DIGITS_MAX+FLOAT_DIGITS_SLACK]; /* Digit values (`0..9' / `0..15') */
+};
+/* Convert parsed digits to the nearest floating point value
+ * (rounding half to even), setting `errno=ERANGE' for results
+ * that overflow, underflow to ZERO(0), or are subnormal.
+ * NOTE: These functions may modify `self' */
+INTDEF float LIBCCALL libc_float_tofloat(struct float_digits *__restrict self);
+INTDEF double LIBCCALL libc_float_todouble(struct float_digits *__restrict self);
+INTDEF long double LIBCCALL libc_float_toldouble(struct float_digits *__restrict self);
+#endif /* !CONFIG_LIBC_LIMITED_API */
+
+
+
+
+
+
+
+
 /* ===================================================================================== */
 /*     MEMORY                                                                            */
 /* ===================================================================================== */
@@ -1094,25 +1094,147 @@ libc_strX(to64_l)(T_char *__restrict nptr,
 }
 EXPORT_SYMBOL(to64_l);
 
+/* Scan a floating point number (after optional whitespace) into `result'
+ * @return: * : Pointer past the end of the number, or `nptr' if there is none. */
+CRT_STRING T_char *LIBCCALL
+libc_strX(scanfloat_l)(T_char *__restrict nptr,
+                       struct float_digits *__restrict result,
+                       locale_t locale) {
+ T_char *iter = nptr,ch; unsigned int digit,base = 10;
+ bool has_digits = false,has_point = false;
+ result->fd_kind    = FLOAT_DIGITS_DEC;
+ result->fd_neg     = 0;
+ result->fd_trunc   = 0;
+ result->fd_dp      = 0;
+ result->fd_exp     = 0;
+ result->fd_ndigits = 0;
+ while (T_isspace_l(*iter,locale)) ++iter;
+ if (*iter == '-') result->fd_neg = 1,++iter;
+ else if (*iter == '+') ++iter;
+ if ((iter[0] | 0x20) == 'i' && (iter[1] | 0x20) == 'n' &&
+     (iter[2] | 0x20) == 'f') {
+  result->fd_kind = FLOAT_DIGITS_INF;
+  iter += 3;
+  if ((iter[0] | 0x20) == 'i' && (iter[1] | 0x20) == 'n' &&
+      (iter[2] | 0x20) == 'i' && (iter[3] | 0x20) == 't' &&
+      (iter[4] | 0x20) == 'y')
+       iter += 5;
+  return iter;
+ }
+ if ((iter[0] | 0x20) == 'n' && (iter[1] | 0x20) == 'a' &&
+     (iter[2] | 0x20) == 'n') {
+  T_char *end = iter + 3;
+  result->fd_kind = FLOAT_DIGITS_NAN;
+  iter = end;
+  if (*end == '(') {
+   /* nan(n-char-sequence) */
+   for (;;) {
+    ch = *++end;
+    if ((ch >= '0' && ch <= '9') || ch == '_' ||
+        ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z'))
+        continue;
+    break;
+   }
+   if (ch == ')') iter = end + 1;
+  }
+  return iter;
+ }
+ if (iter[0] == '0' && (iter[1] | 0x20) == 'x') {
+  /* Only treat this as hex if at least one hex digit follows. */
+  T_char *start = iter + 2;
+  if (*start == '.') ++start;
+  ch = *start;
+  if ((ch >= '0' && ch <= '9') || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f')) {
+   result->fd_kind = FLOAT_DIGITS_HEX;
+   base  = 16;
+   iter += 2;
+  }
+ }
+ for (;; ++iter) {
+  ch = *iter;
+  if (ch == '.') {
+   if (has_point) break;
+   has_point = true;
+   continue;
+  }
+  if (ch >= '0' && ch <= '9') digit = (unsigned int)(ch - '0');
+  else if (base == 16 && (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f')
+       digit = (unsigned int)((ch | 0x20) - 'a') + 10;
+  else break;
+  has_digits = true;
+  if (!digit && !result->fd_ndigits) {
+   /* Leading zero */
+   if (has_point && result->fd_dp > -FLOAT_DIGITS_DPMAX)
+       --result->fd_dp;
+   continue;
+  }
+  if (!has_point && result->fd_dp < FLOAT_DIGITS_DPMAX)
+      ++result->fd_dp;
+  if (result->fd_ndigits < FLOAT_DIGITS_MAX)
+      result->fd_digit[result->fd_ndigits++] = (u8)digit;
+  else if (digit)
+      result->fd_trunc = 1;
+ }
+ if (!has_digits) {
+  result->fd_neg = 0;
+  return nptr;
+ }
+ /* Strip trailing zeros. */
+ while (result->fd_ndigits && !result->fd_digit[result->fd_ndigits-1])
+      --result->fd_ndigits;
+ if (!result->fd_ndigits) result->fd_dp = 0;
+ /* Parse the exponent. */
+ if ((*iter | 0x20) == (base == 16 ? 'p' : 'e')) {
+  T_char *exp_start = iter + 1;
+  bool exp_neg = false; s32 exp = 0;
+  if (*exp_start == '-') exp_neg = true,++exp_start;
+  else if (*exp_start == '+') ++exp_start;
+  if (*exp_start >= '0' && *exp_start <= '9') {
+   do {
+    if (exp < FLOAT_DIGITS_DPMAX)
+        exp = exp * 10 + (s32)(*exp_start - '0');
+   } while (*++exp_start >= '0' && *exp_start <= '9');
+   if (exp > FLOAT_DIGITS_DPMAX)
+       exp = FLOAT_DIGITS_DPMAX;
+   if (exp_neg) exp = -exp;
+   iter = exp_start;
+   if (base == 16)
+       result->fd_exp = exp;
+   else if (result->fd_ndigits) {
+    result->fd_dp += exp;
+   }
+  }
+ }
+ return iter;
+}
+
 CRT_STRING long double LIBCCALL
 libc_strX(told_l)(T_char *__restrict nptr,
                   T_char **endptr, locale_t locale) {
- assertf(0,"TODO");
- return 0;
+ struct float_digits digits; T_char *end;
+ end = libc_strX(scanfloat_l)(nptr,&digits,locale);
+ if (endptr) *endptr = end;
+ return libc_float_toldouble(&digits);
 }
 //EXPORT_SYMBOL(told_l);
 
 CRT_STRING double LIBCCALL
 libc_strX(tod_l)(T_char *__restrict nptr,
                  T_char **endptr, locale_t locale) {
- return (double)libc_strX(told_l)(nptr,endptr,locale);
+ struct float_digits digits; T_char *end;
+ end = libc_strX(scanfloat_l)(nptr,&digits,locale);
+ if (endptr) *endptr = end;
+ return libc_float_todouble(&digits);
 }
 EXPORT_SYMBOL(tod_l);
 
 CRT_STRING float LIBCCALL
 libc_strX(tof_l)(T_char *__restrict nptr,
                  T_char **endptr, locale_t locale) {
- return (float)libc_strX(told_l)(nptr,endptr,locale);
+ struct float_digits digits; T_char *end;
+ end = libc_strX(scanfloat_l)(nptr,&digits,locale);
+ if (endptr) *endptr = end;
+ return libc_float_tofloat(&digits);
 }
 EXPORT_SYMBOL(tof_l);
 
@@ -1200,7 +1322,8 @@ libc_aX(tof_l)(T_char *__restrict nptr, locale_t locale) {
  while (T_isspace_l(*nptr,locale)) ++nptr;
  return libc_strX(tof_l)(nptr,NULL,locale);
 }
-EXPORT_SYMBOLa(tof_l);
+/* `atof()' returns `double' (as opposed to what its name might suggest) */
+DEFINE_PUBLIC_WEAK_ALIAS(glob_aX(tof_l),libc_aX(tod_l));
 
 CRT_STRING double LIBCCALL
 libc_aX(tod_l)(T_char *__restrict nptr, locale_t locale) {
@@ -1245,7 +1368,7 @@ CRT_STRING float LIBCCALL
 libc_aX(tof)(T_char *__restrict nptr) {
  return libc_aX(tof_l)(nptr,NULL);
 }
-EXPORT_SYMBOLa(tof);
+DEFINE_PUBLIC_WEAK_ALIAS(glob_aX(tof),libc_aX(tod));
 
 CRT_STRING double LIBCCALL
 libc_aX(tod)(T_char *__restrict nptr) {
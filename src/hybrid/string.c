@@ -606,8 +606,8 @@ EXPORT(_strtoui64,libc_strtou64);
 EXPORT(_strtoui64_l,libc_strtou64_l);
 EXPORT(_atodbl,libc_atod);
 EXPORT(_atodbl_l,libc_atod_l);
-EXPORT(_atof,libc_atof);
-EXPORT(_atof_l,libc_atof_l);
+EXPORT(_atof,libc_atod);
+EXPORT(_atof_l,libc_atod_l);
 EXPORT(_atoflt,libc_atof);
 EXPORT(_atoflt_l,libc_atof_l);
 EXPORT(__KSYM(_atoldbl),libc_atold);
@@ -616,10 +616,10 @@ EXPORT(__KSYM(_atoldbl_l),libc_atold_l);
 EXPORT(__DSYM(_atoldbl_l),libc_atod_l);
 EXPORT(_atoi64,libc_ato64);
 EXPORT(_atoi64_l,libc_ato64_l);
-EXPORT(__SYMw16(_wtof),libc_w16tof);
-EXPORT(__SYMw32(_wtof),libc_w32tof);
-EXPORT(__SYMw16(_wtof_l),libc_w16tof_l);
-EXPORT(__SYMw32(_wtof_l),libc_w32tof_l);
+EXPORT(__SYMw16(_wtof),libc_aw16tod);
+EXPORT(__SYMw32(_wtof),libc_aw32tod);
+EXPORT(__SYMw16(_wtof_l),libc_aw16tod_l);
+EXPORT(__SYMw32(_wtof_l),libc_aw32tod_l);
 EXPORT(__SYMw16(_wtoi64),libc_w16to64);
 EXPORT(__SYMw32(_wtoi64),libc_w32to64);
 EXPORT(__SYMw16(_wtoi64_l),libc_w16to64_l);
@@ -26,6 +26,7 @@
 #include <kos/types.h>
 #include <hybrid/align.h>
 #include <i386-kos/apic.h>
+#include <i386-kos/cpuid.h>
 #include <i386-kos/pic.h>
 #include <i386-kos/pit.h>
 #include <i386-kos/scheduler.h>
@@ -35,6 +36,7 @@
 #include <kernel/sections.h>
 #include <kernel/memory.h>
 #include <sched/task.h>
+#include <sched/cputime.h>
 #include <sys/io.h>
 #include <i386-kos/smp.h>
 #include <string.h>
@@ -42,6 +44,19 @@
 DECL_BEGIN
 
 PUBLIC ATTR_PERCPU volatile u32 x86_lapic_timer_freq;
+PUBLIC ATTR_PERCPU u64 x86_tsc_freq;
+
+/* Save the TSC frequency of the calling CPU, given the number
+ * of TSC ticks that passed during a 10ms PIT one-shot window. */
+PRIVATE ATTR_FREETEXT void KCALL
+x86_tsc_calibrated(u64 num_cycles) {
+ u64 hz = num_cycles*100;
+ PERCPU(x86_tsc_freq) = hz;
+ debug_printf(FREESTR("[APIC] CPU #%u has a TSC frequency of %I64u Hz%s\n"),
+              THIS_CPU->cpu_id,hz,
+             (CPU_FEATURES.ci_80000007d & CPUID_80000007D_INVARIANT_TSC)
+              ? FREESTR(" (invariant)") : FREESTR(""));
+}
 
 #ifndef CONFIG_NO_SMP
 DATDEF cpuid_t _cpu_count ASMNAME("cpu_count");
@@ -49,14 +64,17 @@ DATDEF struct cpu *_cpu_vector[CONFIG_MAX_CPU_COUNT] ASMNAME("cpu_vector");
 
 INTDEF INITCALL void KCALL x86_load_cpuid(void);
 INTDEF INITCALL void KCALL x86_initialize_sysenter(void);
+INTDEF INITCALL void KCALL x86_initialize_pat(void);
 
 INTERN ATTR_FREETEXT void KCALL x86_percpu_initialize(void) {
- u32 num_ticks;
+ u32 num_ticks; u64 tsc_start;
 
  /* Load CPUID information. */
  x86_load_cpuid();
  /* Enable support for sysenter on this CPU. */
  x86_initialize_sysenter();
+ /* Use the same PAT layout as the boot CPU. */
+ x86_initialize_pat();
 
  /* Enable the APIC of this CPU */
  lapic_write(APIC_SPURIOUS,APIC_SPURIOUS_FENABLED | 0xff);
@@ -79,9 +97,11 @@ INTERN ATTR_FREETEXT void KCALL x86_percpu_initialize(void) {
    outb(PIT_PCSPEAKER,temp | PIT_PCSPEAKER_OUT);
  }
  lapic_write(APIC_TIMER_INITIAL,(u32)-1);
+ tsc_start = __rdtsc();
  while (inb(PIT_PCSPEAKER) & PIT_PCSPEAKER_FPIT2OUT)
      __asm__("pause");
  lapic_write(APIC_TIMER,APIC_TIMER_FDISABLED);
+ x86_tsc_calibrated(__rdtsc()-tsc_start);
  num_ticks = lapic_read(APIC_TIMER_CURRENT);
  num_ticks = (((u32)-1) - num_ticks)*100;
  PERCPU(x86_lapic_timer_freq) = num_ticks;
@@ -194,7 +214,7 @@ x86_apic_initialize(void) {
   cpuid_t i;
   size_t entry_size = (size_t)(x86_smp_entry_end - x86_smp_entry);
 #endif
-  u32 num_ticks;
+  u32 num_ticks; u64 tsc_start;
 
   debug_printf(FREESTR("[APIC] Enable LAPIC\n"));
   /* Disable the PIT interrupt if we're going to use the LAPIC timer. */
@@ -253,6 +273,8 @@ x86_apic_initialize(void) {
   /* The PIC timer is now running. */
   /* Set LAPIC counter to its maximum possible value. */
   lapic_write(APIC_TIMER_INITIAL,(u32)-1);
+  /* Also use the window to measure the frequency of the TSC. */
+  tsc_start = __rdtsc();
 
   /* Wait for our one-shot time to expire. */
   while (inb(PIT_PCSPEAKER) & PIT_PCSPEAKER_FPIT2OUT)
@@ -260,6 +282,7 @@ x86_apic_initialize(void) {
 
   /* Stop LAPIC counter */
   lapic_write(APIC_TIMER,APIC_TIMER_FDISABLED);
+  x86_tsc_calibrated(__rdtsc()-tsc_start);
   num_ticks = lapic_read(APIC_TIMER_CURRENT);
 
 #ifndef CONFIG_NO_SMP
@@ -351,6 +374,28 @@ all_online:;
   /* Re-write the preemption code to acknowledge PIC interrupts. */
   memcpy(x86_pic_acknowledge,x86_ack_pic,sizeof(x86_ack_pic));
 
+  /* Without a LAPIC timer to calibrate, use a
+   * dedicated PIT one-shot to measure the TSC. */
+  { u8 temp; u64 tsc_start;
+    outb(PIT_PCSPEAKER,
+        (inb(PIT_PCSPEAKER) &
+           ~(PIT_PCSPEAKER_FSYNCPIT|PIT_PCSPEAKER_FINOUT)) |
+             PIT_PCSPEAKER_FSYNCPIT);
+    outb(PIT_COMMAND,
+         PIT_COMMAND_SELEFT_F2 |
+         PIT_COMMAND_ACCESS_FLOHI |
+         PIT_COMMAND_MODE_FONESHOT);
+    outb_p(PIT_DATA2,(PIT_HZ_DIV(100) & 0xff));
+    outb  (PIT_DATA2,(PIT_HZ_DIV(100) >> 8) & 0xff);
+    temp = inb(PIT_PCSPEAKER) & ~PIT_PCSPEAKER_FINOUT;
+    outb(PIT_PCSPEAKER,temp);
+    outb(PIT_PCSPEAKER,temp | PIT_PCSPEAKER_OUT);
+    tsc_start = __rdtsc();
+    while (inb(PIT_PCSPEAKER) & PIT_PCSPEAKER_FPIT2OUT)
+        __asm__("pause");
+    x86_tsc_calibrated(__rdtsc()-tsc_start);
+  }
+
   /* Set the PIC speed. */
   outb(PIT_COMMAND,
        PIT_COMMAND_SELEFT_F0 |
@@ -362,6 +407,13 @@ all_online:;
 
   PREEMPTION_ENABLE();
  }
+
+ /* Use the TSC frequency of the boot CPU for CPU time accounting. */
+ if (PERCPU(x86_tsc_freq)) {
+  cputime_calibrate(PERCPU(x86_tsc_freq),
+                   (CPU_FEATURES.ci_80000007d & CPUID_80000007D_INVARIANT_TSC)
+                    ? CPUTIME_FINVARIANT : CPUTIME_FNORMAL);
+ }
 }
 
 PUBLIC NOIRQ qtime_t KCALL qtime_now_noirq(void) {
@@ -158,6 +158,7 @@ INTDEF INITCALL void KCALL x86_mount_rootfs(void);
 INTERN ATTR_NORETURN INITCALL void KCALL x86_switch_to_userspace(void);
 
 INTDEF INITCALL void KCALL x86_configure_paging(void);
+INTDEF INITCALL void KCALL x86_initialize_pat(void);
 INTDEF INITCALL void KCALL kernel_relocate_commandline(void);
 INTDEF INITCALL void KCALL kernel_eval_commandline(void);
 
@@ -221,6 +222,9 @@ INTERN ATTR_FREETEXT void KCALL x86_kernel_main(void) {
  /* Collect information about the host. */
  x86_configure_paging();
 
+ /* Configure the PAT, so drivers can use write-combining mappings. */
+ x86_initialize_pat();
+
  /* Copy predefined memory information. */
  memcpy(x86_boot_stack.is_predef,
         predefined_meminfo,
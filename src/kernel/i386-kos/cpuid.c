@@ -35,6 +35,9 @@ DECL_BEGIN
 PUBLIC ATTR_PERCPU u16 _cpu_basic_features ASMNAME("cpu_basic_features") = CPU_BASIC_FEATURE_FNONE;
 PUBLIC ATTR_PERCPU struct cpu_cpuid _cpu_id_features ASMNAME("cpu_id_features") = { 0, };
 
+/* Detect string-acceleration features (ERMS/FSRM) used by `memcpy()' & friends. */
+INTDEF void LIBCCALL x86_string_detect(void);
+
 INTERN ATTR_FREETEXT void KCALL x86_load_cpuid(void) {
  struct cpu_cpuid *info;
  /* TODO: A lot of this stuff was already done by the boot(32|64).S. */
@@ -107,6 +110,12 @@ INTERN ATTR_FREETEXT void KCALL x86_load_cpuid(void) {
                        : "a" (0x80000001)
                        : "ebx");
  }
+ if (info->ci_eleaf_max >= 0x80000007) {
+  __asm__ __volatile__("cpuid"
+                       : "=d" (info->ci_80000007d)
+                       : "a" (0x80000007)
+                       : "ebx", "ecx");
+ }
  if (info->ci_eleaf_max >= 0x80000004) {
   __asm__ __volatile__("cpuid"
                        : "=a" (info->ci_80000002a)
@@ -142,11 +151,26 @@ INTERN ATTR_FREETEXT void KCALL x86_load_cpuid(void) {
    debug_printf(FREESTR("[X86] Enable PGE\n"));
    new_cr4 |= CR4_PGE;
   }
+#ifndef __x86_64__
+  /* NOTE: On x86_64, PSE is already enabled during early boot. */
+  if ((info->ci_1d & CPUID_1D_PSE) ||
+      (info->ci_80000001d & CPUID_80000001D_PSE)) {
+   debug_printf(FREESTR("[X86] Enable PSE\n"));
+   new_cr4 |= CR4_PSE;
+  }
+#endif
 #ifdef __x86_64__
   if (info->ci_7b & CPUID_7B_FSGSBASE) {
    debug_printf(FREESTR("[X86] Enable userspace fs/gs base access\n"));
    new_cr4 |= CR4_FSGSBASE;
   }
+  /* NOTE: PCIDE may only be set while CR3[11:0] is zero, which
+   *       is always the case this early (we're still running
+   *       in `pagedir_kernel', which doesn't have a PCID). */
+  if ((info->ci_1c & CPUID_1C_PCID) && (new_cr4 & CR4_PGE)) {
+   debug_printf(FREESTR("[X86] Enable PCID\n"));
+   new_cr4 |= CR4_PCIDE;
+  }
 #endif
   if (old_cr4 != new_cr4)
       __wrcr4(new_cr4);
@@ -157,7 +181,8 @@ INTERN ATTR_FREETEXT void KCALL x86_load_cpuid(void) {
   __wrmsr(IA32_EFER,__rdmsr(IA32_EFER) | IA32_EFER_NXE);
  }
 #endif
-
+ /* Select string operation implementations now, rather than lazily. */
+ x86_string_detect();
 }
 
 
@@ -48,6 +48,7 @@
 
 #include "emulator.h"
 #include "posix_signals.h"
+#include <sched/stat.h>
 #include <sched/userstack.h>
 
 DECL_BEGIN
@@ -92,6 +93,7 @@ x86_handle_pagefault(struct cpu_anycontext *__restrict context,
  /* Extract the fault address before re-enabling interrupts. */
  fault_address = (void *)__rdcr2();
  assert(!PREEMPTION_ENABLED());
+ INCCPUSTAT(cs_pgfault);
 #if 0
  debug_printf("#PF at %p (from %p; errcode %Ix)\n",
               fault_address,context->c_pip,errcode);
@@ -719,12 +721,18 @@ do_throw_error:
 
 
 
+INTDEF bool KCALL x86_pic_dispatch(u8 line);
+
 /* The default, fallback interrupt handler. */
 INTERN void KCALL
 x86_interrupt_handler(struct cpu_anycontext *__restrict context,
                       register_t intno, register_t errcode) {
  struct exception_info *info;
  assertf(intno <= 0xff,"intno = %p",intno);
+ /* Check for a dynamically installed PIC line handler. */
+ if (intno >= X86_INTERRUPT_PIC1_BASE &&
+     x86_pic_dispatch((u8)(intno-X86_INTERRUPT_PIC1_BASE)))
+     return;
  /* Re-enable interrupts if they were enabled before. */
  if (context->c_pflags & EFLAGS_IF)
      x86_interrupt_enable();
@@ -157,7 +157,7 @@ void KCALL x86_switch_to_userspace(void) {
 
  /* Update the VM context.
   * NOTE: The kernel-share segment is already mapped in the new VM. */
- pagedir_set((pagedir_t *)(uintptr_t)init_vm->vm_physdir);
+ pagedir_setvm(init_vm);
 
  /* With the new context now active, re-enable preemption. */
  PREEMPTION_ENABLE();
@@ -22,16 +22,19 @@
 #include <hybrid/compiler.h>
 #include <kos/types.h>
 #include <hybrid/section.h>
+#include <hybrid/sync/atomic-rwlock.h>
 #include <asm/cpu-flags.h>
 #include <i386-kos/idt_pointer.h>
 #include <i386-kos/interrupt.h>
 #include <i386-kos/pic.h>
 #include <except.h>
 #include <string.h>
+#include <assert.h>
 #include <kernel/debug.h>
 #include <kernel/interrupt.h>
 #include <kos/i386-kos/bits/cpu-context.h>
 #include <sched/task.h>
+#include <sched/softirq.h>
 
 #include <unwind/eh_frame.h>
 #include <kos/context.h>
@@ -58,6 +61,7 @@ PUBLIC struct exception_descriptor const x86_interrupt_guard = {
 STATIC_ASSERT(sizeof(struct x86_idtentry) == X86_IDTENTRY_SIZE);
 
 PUBLIC ATTR_PERCPU struct x86_spurious_interrupts x86_spurious_interrupts = { 0, 0, 0 };
+PUBLIC ATTR_PERCPU u32 x86_pic_interrupts[16] = { 0, };
 INTERN void KCALL x86_pic1_spur(void) {
  debug_printf("Spurious interrupt on PIC #1\n");
  ++PERCPU(x86_spurious_interrupts.sp_pic1);
@@ -72,6 +76,77 @@ INTERN void KCALL x86_apic_spur(void) {
 }
 
 
+struct pic_handler {
+    x86_pic_handler_t ph_func; /* [0..1][lock(x86_pic_handler_lock)] Handler callback. */
+    void             *ph_arg;  /* [?..?][lock(x86_pic_handler_lock)] Handler argument. */
+};
+
+/* PIC lines that are serviced by dedicated interrupt handlers.
+ * (PIT, Keyboard, Cascade, PS/2 mouse and both ATA buses) */
+#define PIC_STATIC_LINES  ((1 << 0)|(1 << 1)|(1 << 2)|(1 << 12)|(1 << 14)|(1 << 15))
+
+PRIVATE DEFINE_ATOMIC_RWLOCK(x86_pic_handler_lock);
+PRIVATE struct pic_handler x86_pic_handlers[16];
+
+PUBLIC bool KCALL
+x86_pic_sethandler(u8 line, x86_pic_handler_t func, void *arg) {
+ bool result = false; pflag_t was;
+ assert(func);
+ if unlikely(line >= 16 || (PIC_STATIC_LINES & (1 << line)))
+    return false;
+ /* Disable preemption, so the interrupt can't
+  * fire on this CPU while we're holding the lock. */
+ was = PREEMPTION_PUSHOFF();
+ atomic_rwlock_write(&x86_pic_handler_lock);
+ if (!x86_pic_handlers[line].ph_func) {
+  x86_pic_handlers[line].ph_func = func;
+  x86_pic_handlers[line].ph_arg  = arg;
+  result = true;
+ }
+ atomic_rwlock_endwrite(&x86_pic_handler_lock);
+ PREEMPTION_POP(was);
+ return result;
+}
+
+PUBLIC void KCALL
+x86_pic_delhandler(u8 line, x86_pic_handler_t func, void *arg) {
+ pflag_t was;
+ if unlikely(line >= 16) return;
+ was = PREEMPTION_PUSHOFF();
+ atomic_rwlock_write(&x86_pic_handler_lock);
+ if (x86_pic_handlers[line].ph_func == func &&
+     x86_pic_handlers[line].ph_arg  == arg) {
+  x86_pic_handlers[line].ph_func = NULL;
+  x86_pic_handlers[line].ph_arg  = NULL;
+ }
+ atomic_rwlock_endwrite(&x86_pic_handler_lock);
+ PREEMPTION_POP(was);
+}
+
+/* Invoked by `x86_interrupt_handler()' for PIC interrupts
+ * without a dedicated handler (interrupts are still disabled).
+ * @return: true:  The interrupt was handled and acknowledged.
+ * @return: false: No handler has been installed for the line. */
+INTERN bool KCALL x86_pic_dispatch(u8 line) {
+ struct pic_handler handler; u64 start;
+ start = IRQSTAT_HARDIRQ_BEGIN();
+ atomic_rwlock_read(&x86_pic_handler_lock);
+ handler = x86_pic_handlers[line];
+ if (!handler.ph_func) {
+  atomic_rwlock_endread(&x86_pic_handler_lock);
+  return false;
+ }
+ ++PERCPU(x86_pic_interrupts)[line];
+ /* Keep holding the lock while the handler runs, so that
+  * `x86_pic_delhandler()' can wait for it to finish. */
+ (*handler.ph_func)(handler.ph_arg);
+ atomic_rwlock_endread(&x86_pic_handler_lock);
+ X86_PIC_EOI(X86_INTNO_PIC1(line));
+ IRQSTAT_HARDIRQ_END(start);
+ return true;
+}
+
+
 DECL_END
 
 #endif /* !GUARD_KERNEL_I386_KOS_INTERRUPT_C */
@@ -33,6 +33,7 @@
 #include <kernel/interrupt.h>
 #include <kernel/vm.h>
 #include <sched/task.h>
+#include <sched/cputime.h>
 
 #include <asm/cpu-flags.h>
 #include <except.h>
@@ -79,6 +80,13 @@ INTDEF NOIRQ ATTR_NORETURN void FCALL
 x86_load_context(struct task *__restrict next_task,
                  PHYS uintptr_t old_pdir);
 
+#ifdef __x86_64__
+/* Invalidate TLB entries of page directories cached under other PCIDs. (paging64.c.inl) */
+INTDEF NOIRQ ATTR_NOTHROW void KCALL
+x86_pcid_sync(VIRT pagedir_t *__restrict dir,
+              vm_vpage_t page_index, size_t num_pages);
+INTDEF NOIRQ ATTR_NOTHROW void KCALL x86_pcid_syncall(void);
+#endif /* __x86_64__ */
 
 
 /* Handle an IPI request.
@@ -108,10 +116,19 @@ x86_ipi_handle(struct x86_ipi const *__restrict ipi,
       &pagedir_kernel      == ipi->ipi_invlpg.ivp_pagedir)
        pagedir_sync(ipi->ipi_invlpg.ivp_pageindex,
                     ipi->ipi_invlpg.ivp_numpages);
+#ifdef __x86_64__
+  /* The page directory may still be cached under some other PCID. */
+  else x86_pcid_sync(ipi->ipi_invlpg.ivp_pagedir,
+                     ipi->ipi_invlpg.ivp_pageindex,
+                     ipi->ipi_invlpg.ivp_numpages);
+#endif
   break;
 
  case X86_IPI_INVLPG_ALL:
   pagedir_syncall();
+#ifdef __x86_64__
+  x86_pcid_syncall();
+#endif
   break;
 
  case X86_IPI_INVLPG_ONE:
@@ -120,6 +137,10 @@ x86_ipi_handle(struct x86_ipi const *__restrict ipi,
   if (&THIS_VM->vm_pagedir == ipi->ipi_invlpg.ivp_pagedir ||
       &pagedir_kernel      == ipi->ipi_invlpg.ivp_pagedir)
        pagedir_syncone(ipi->ipi_invlpg.ivp_pageindex);
+#ifdef __x86_64__
+  else x86_pcid_sync(ipi->ipi_invlpg.ivp_pagedir,
+                     ipi->ipi_invlpg.ivp_pageindex,1);
+#endif
   break;
 
  case X86_IPI_SCHEDULE:
@@ -176,6 +197,9 @@ x86_ipi_handle(struct x86_ipi const *__restrict ipi,
      RING_REMOVE(thread,t_sched.sched_ring);
      /* Set the next pending thread as the one now actively running. */
      THIS_CPU->c_running = sched_next;
+     /* Account the switch (`x86_load_context' doesn't do this for us). */
+     cputime_sync();
+     cputime_resume(sched_next);
 #ifdef __x86_64__
      __asm__ __volatile__ goto("movq   %%rsp, %%r8\n\t"
                                "safe_rdfsbase %%rax\n\t"
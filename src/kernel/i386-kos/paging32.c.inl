@@ -109,8 +109,12 @@ PRIVATE u16 x86_pageperm_matrix[0xf+1] = {
     [PAGEDIR_MAP_FUSER|PAGEDIR_MAP_FREAD|PAGEDIR_MAP_FWRITE|PAGEDIR_MAP_FEXEC] = X86_PAGE_FDIRTY|X86_PAGE_FACCESSED|X86_PAGE_FUSER|X86_PAGE_FPRESENT|X86_PAGE_FWRITE,
 };
 INTERN u32 x86_page_global = X86_PAGE_FGLOBAL;
+/* Memory type selection bits, indexed by `(perm & PAGEDIR_MAP_FMEMTYPE) >> 4'
+ * NOTE: Configured by `x86_initialize_pat()' based on PAT availability. */
+INTDEF u16 x86_pagecache_matrix[4];
 PRIVATE unsigned int x86_paging_features = 0;
 #define PAGING_FEATURE_4MIB_PAGES  0x0001/* Host supports 4MIB pages. */
+PUBLIC size_t _pagedir_hugepages ASMNAME("pagedir_hugepages") = 0;
 
 
 INTDEF INITCALL void KCALL x86_config_pagedir_invlpg_unsupported(void);
@@ -126,6 +130,8 @@ INTERN ATTR_FREETEXT void KCALL x86_configure_paging(void) {
      (feat->ci_80000001d & CPUID_80000001D_PSE)) {
   debug_printf(FREESTR("[X86] Enable 4MIB pages\n"));
   x86_paging_features |= PAGING_FEATURE_4MIB_PAGES;
+  /* NOTE: `CR4_PSE' is set by `x86_load_cpuid()' on every CPU. */
+  _pagedir_hugepages = 1024;
  }
 }
 
@@ -212,7 +218,7 @@ pagedir_split_before(VIRT vm_vpage_t virt_page) {
   }
   COMPILER_WRITE_BARRIER();
   /* Re-add bits. */
-  e2->p_addr |= (e2_data & X86_PAGE_FMASK);
+  e2->p_addr |= (e2_data & (X86_PAGE_FMASK & ~X86_PAGE_FCACHEMASK));
   COMPILER_WRITE_BARRIER();
  } else if ((e2_data&X86_PAGE_FADDR) == X86_PAGE_ABSENT) {
   assertf(virt_page < KERNEL_BASE_PAGE,
@@ -253,6 +259,8 @@ pagedir_merge_before(VIRT vm_vpage_t virt_page) {
   /* Check if there is any page that doesn't fit a linear mapping. */
   if (!(x86_paging_features & PAGING_FEATURE_4MIB_PAGES))
       return; /* Without PSE, we can't actually make use of `X86_PAGE_F4MIB' */
+  if (X86_PDIR_4MIBPAGEINDEX(expected_mapping & X86_PAGE_FADDR) != 0)
+      return; /* The physical address isn't 4MIB-aligned. */
   for (i = 0; i < 1024; ++i) {
    if ((e1_vector[i].p_addr & ~(X86_PAGE_FDIRTY|X86_PAGE_FACCESSED)) !=
         expected_mapping) return; /* Cannot combine */
@@ -325,7 +333,8 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
          "num_pages = %p\n",
          virt_page,num_pages);
  assert((perm&PAGEDIR_MAP_FUNMAP) || phys_page+num_pages < VM_PPAGE_MAX);
- edata = (u32)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf];
+ edata = (u32)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf] |
+         x86_pagecache_matrix[(perm & PAGEDIR_MAP_FMEMTYPE) >> 4];
  if (virt_page >= KERNEL_BASE_PAGE)
      edata |= x86_page_global; /* Kernel-share mapping. */
  /* Create splits in the virtual address space. */
@@ -375,7 +384,7 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
     edata += PAGESIZE;
    }
    /* Add permission bits to the E2 table. */
-   X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & X86_PAGE_FMASK;
+   X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & (X86_PAGE_FMASK & ~X86_PAGE_FCACHEMASK);
   }
   num_pages -= e1_count;
   if (!num_pages) goto done;
@@ -387,39 +396,43 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
   /* Map entire E2 tables (Using `X86_PAGE_F4MIB' if available). */
   e2_entry = &X86_PDIR_E2_IDENTITY[e2_index];
   e2_data  = e2_entry->p_data;
-#if 0 /* XXX: This doesn't seem to be working... */
+  /* NOTE: 4MIB pages require `CR4_PSE', as well as the physical
+   *       address to be aligned just like the virtual one is. */
   if ((x86_paging_features & PAGING_FEATURE_4MIB_PAGES) &&
-       e2_index < VEC2_SHARE_BEGIN) {
+      !(perm & PAGEDIR_MAP_FUNMAP) && e2_index < VEC2_SHARE_BEGIN &&
+       X86_PDIR_4MIBPAGEINDEX(edata & X86_PAGE_FADDR) == 0) {
    /* Override the E2 entries data. */
-   e2_entry->p_data = (perm & PAGEDIR_MAP_FUNMAP) ? X86_PAGE_ABSENT : (edata|X86_PAGE_F4MIB);
+   e2_entry->p_data = edata|X86_PAGE_F4MIB;
    COMPILER_WRITE_BARRIER();
    /* Free a previously allocated E1 vector at this location. */
    if (!(e2_data&X86_PAGE_F4MIB) &&
         (e2_data&X86_PAGE_FADDR) != X86_PAGE_ABSENT)
          page_free(VM_ADDR2PAGE(e2_data),1);
    edata += 1024*PAGESIZE;
-  } else
-#endif
-  if (perm & PAGEDIR_MAP_FUNMAP) {
+  } else if (perm & PAGEDIR_MAP_FUNMAP) {
    if (e2_index < VEC2_SHARE_BEGIN) {
     /* When unmapping, we can simply get rid of this E1 vector. */
     e2_entry->p_data = X86_PAGE_ABSENT;
     COMPILER_WRITE_BARRIER();
-    /* Free the old table if one was allocated before. */
-    if ((e2_data&X86_PAGE_FADDR) != X86_PAGE_ABSENT)
-         page_free(VM_ADDR2PAGE(e2_data),1);
+    /* Free the old table if one was allocated before.
+     * NOTE: 4MIB pages don't use a table, and the memory
+     *       they point to is owned by whoever mapped it. */
+    if (!(e2_data&X86_PAGE_F4MIB) &&
+         (e2_data&X86_PAGE_FADDR) != X86_PAGE_ABSENT)
+          page_free(VM_ADDR2PAGE(e2_data),1);
    } else {
     /* Unmap each entry */
     e1_vector = X86_PDIR_E1_IDENTITY[e2_index];
     memsetl(e1_vector,0,1024);
    }
   } else {
-   /* Without PSE, we must manually map this entry. */
-   assertf(!(e2_data&X86_PAGE_F4MIB),"PSE isn't enabled. The 4MIB flag is illegal");
+   /* Without PSE (or proper alignment), we must manually map this entry. */
    assert(!(edata&X86_PAGE_F4MIB));
    e1_vector = X86_PDIR_E1_IDENTITY[e2_index];
-   if ((e2_data&X86_PAGE_FADDR) == X86_PAGE_ABSENT) {
-    /* Must allocate the vector. */
+   if ((e2_data&X86_PAGE_F4MIB) ||
+       (e2_data&X86_PAGE_FADDR) == X86_PAGE_ABSENT) {
+    /* Must allocate the vector (A 4MIB page being
+     * replaced entirely doesn't need to be split). */
     e2_entry->p_data = (VM_PAGE2ADDR(page_malloc(1,MZONE_PAGING)) |
                        (X86_PAGE_FDIRTY | X86_PAGE_FACCESSED |
                         X86_PAGE_FWRITE | X86_PAGE_FPRESENT));
@@ -434,7 +447,7 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
     edata += PAGESIZE;
    }
    /* Set permissions flags. */
-   e2_entry->p_data |= edata&X86_PAGE_FMASK;
+   e2_entry->p_data |= edata&(X86_PAGE_FMASK & ~X86_PAGE_FCACHEMASK);
    COMPILER_WRITE_BARRIER();
   }
   /* Advance to the next part. */
@@ -458,7 +471,7 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
     edata += PAGESIZE;
    }
    /* Add permission bits to the E2 table. */
-   X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & X86_PAGE_FMASK;
+   X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & (X86_PAGE_FMASK & ~X86_PAGE_FCACHEMASK);
   }
  }
 
@@ -493,7 +506,8 @@ pagedir_mapone(VIRT vm_vpage_t virt_page,
  assert(phys_page+1 >= phys_page);
  assert(virt_page+1 < VM_VPAGE_MAX);
  assert(phys_page+1 < VM_PPAGE_MAX);
- edata = (u32)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf];
+ edata = (u32)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf] |
+         x86_pagecache_matrix[(perm & PAGEDIR_MAP_FMEMTYPE) >> 4];
  if (virt_page >= KERNEL_BASE_PAGE)
      edata |= x86_page_global; /* Kernel-share mapping. */
  /* Create splits in the virtual address space. */
@@ -521,7 +535,7 @@ pagedir_mapone(VIRT vm_vpage_t virt_page,
  } else {
   e1_vector[e1_begin].p_data = edata;
   /* Add permission bits to the E2 table. */
-  X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & X86_PAGE_FMASK;
+  X86_PDIR_E2_IDENTITY[e2_index].p_data |= edata & (X86_PAGE_FMASK & ~X86_PAGE_FCACHEMASK);
  }
  /* Merge the splits from before. */
  pagedir_merge_before(vpage_start+1);
@@ -34,6 +34,10 @@
 #include <i386-kos/interrupt.h>
 #include <i386-kos/cpuid.h>
 #include <asm/cpu-flags.h>
+#include <kernel/bind.h>
+#include <hybrid/atomic.h>
+#include <sched/task.h>
+#include <kos/intrin.h>
 
 DECL_BEGIN
 
@@ -67,6 +71,9 @@ typedef union x86_pdir_e4  E4;
 #endif /* !CONFIG_NO_GIGABYTE_PAGES */
 #define PAGE_FDIRTY    X86_PAGE_FDIRTY    /* The page has been written to. */
 #define PAGE_FACCESSED X86_PAGE_FACCESSED /* The page has been read from, or written to. */
+#define PAGE_FPCD      X86_PAGE_FPCD      /* Page-level cache disable. */
+#define PAGE_FPWT      X86_PAGE_FPWT      /* Page-level write-through. */
+#define PAGE_FCACHEMASK X86_PAGE_FCACHEMASK /* Mask of memory-type bits. */
 #define PAGE_FUSER     X86_PAGE_FUSER     /* User-space may access this page (read, or write). */
 #define PAGE_FWRITE    X86_PAGE_FWRITE    /* The page is writable. */
 #define PAGE_FPRESENT  X86_PAGE_FPRESENT  /* The page is present (When not set, cause a PAGEFAULT that may be used for allocate/load-on-read). */
@@ -253,16 +260,38 @@ INTERN u64 x86_pageperm_matrix[0xf+1] = {
 };
 
 INTERN u64 x86_page_global = PAGE_FGLOBAL;
+/* Memory type selection bits, indexed by `(perm & PAGEDIR_MAP_FMEMTYPE) >> 4'
+ * NOTE: Configured by `x86_initialize_pat()' based on PAT availability. */
+INTDEF u16 x86_pagecache_matrix[4];
 #ifndef CONFIG_NO_GIGABYTE_PAGES
 INTERN unsigned int x86_paging_features = 0;
 #define PAGING_FEATURE_1GIB_PAGES  0x0001 /* Host supports 1GIB pages. */
 #endif /* !CONFIG_NO_GIGABYTE_PAGES */
 
+/* 2MIB pages are always available in long mode. */
+PUBLIC size_t _pagedir_hugepages ASMNAME("pagedir_hugepages") = (size_t)(X86_PDIR_E2_SIZE/PAGESIZE);
+
+
+/* [const] Non-zero if PCIDs are used to tag TLB entries of different VMs (`CR4_PCIDE' is set). */
+INTERN u8 x86_pcid_enabled = 0;
+/* [const][valid_if(x86_pcid_enabled)] Non-zero if the `invpcid' instruction is available. */
+INTERN u8 x86_invpcid_enabled = 0;
 
 INTERN ATTR_FREETEXT void KCALL x86_configure_paging(void) {
  struct cpu_cpuid const *feat = &CPU_FEATURES;
  if (!(feat->ci_1d & CPUID_1D_PGE))
        x86_page_global = 0;
+ /* NOTE: PCIDs are only used alongside global pages, so we
+  *       don't have to worry about kernel mappings being
+  *       cached separately for every PCID. (`x86_load_cpuid()'
+  *       only sets `CR4_PCIDE' when PGE is available) */
+ if (__rdcr4() & CR4_PCIDE) {
+  x86_pcid_enabled = 1;
+  if (feat->ci_7b & CPUID_7B_INVPCID)
+      x86_invpcid_enabled = 1;
+  debug_printf(FREESTR("[X86] Using PCIDs to tag TLB entries (invpcid: %s)\n"),
+               x86_invpcid_enabled ? FREESTR("yes") : FREESTR("no"));
+ }
 #ifndef CONFIG_NO_NX_PAGES
  if (!(feat->ci_80000001d & CPUID_80000001D_NX)) {
   unsigned int i; /* The NX bit isn't supported. */
@@ -279,6 +308,203 @@ INTERN ATTR_FREETEXT void KCALL x86_configure_paging(void) {
 }
 
 
+
+/* The number of PCIDs used by every CPU.
+ * PCIDs are allocated round-robin, with PCID #0 being reserved
+ * for raw CR3 writes done by `pagedir_set()' (e.g. the initial
+ * kernel page directory, or the temporary switch in `pagedir_fini()'),
+ * meaning that slot `i' uses PCID `i+1'. */
+#define X86_PCID_COUNT  8
+
+struct x86_pcid_cache {
+    struct vm    *pc_vm[X86_PCID_COUNT];  /* [0..1][*] The VM last loaded with PCID `i+1'. (Only compared; never dereferenced) */
+    u64           pc_gen[X86_PCID_COUNT]; /* [valid_if(pc_vm[i])] The `x86_vm_pcidgen' of `pc_vm[i]' at the time it was loaded. */
+    unsigned int  pc_cur;                 /* [< X86_PCID_COUNT] Index of the slot last loaded into CR3. */
+    unsigned int  pc_next;                /* [< X86_PCID_COUNT] Index of the next slot to recycle. */
+};
+
+/* [lock(WRITE(THIS_CPU && !PREEMPTION_ENABLED()))] Per-CPU PCID allocations. */
+PRIVATE ATTR_PERCPU struct x86_pcid_cache x86_pcid = { { NULL, }, { 0, }, 0, 0 };
+
+/* A unique generation number assigned to every VM when it is created.
+ * Because a VM may be freed while some CPU still has it cached in one
+ * of its PCID slots, and another VM may later be allocated at the same
+ * address, matching VM pointers alone isn't enough to determine if the
+ * TLB entries of some PCID can be re-used without flushing them. */
+PRIVATE ATTR_PERVM u64 x86_vm_pcidgen = 0;
+PRIVATE u64 x86_pcidgen_next = 0;
+
+DEFINE_PERVM_INIT(x86_pcid_vminit);
+PRIVATE ATTR_USED void KCALL
+x86_pcid_vminit(struct vm *__restrict self) {
+ FORVM(self,x86_vm_pcidgen) = ATOMIC_INCFETCH(x86_pcidgen_next);
+}
+
+/* Load the page directory of `new_vm' into CR3, tagged with a PCID of `me'.
+ * NOTE: This function is called by the scheduler while switching tasks,
+ *       at which point `THIS_CPU' may not be usable, hence the `me' argument. */
+INTERN NOIRQ ATTR_NOTHROW void FCALL
+x86_pcid_loadvm(struct vm *__restrict new_vm,
+                struct cpu *__restrict me) {
+ struct x86_pcid_cache *cache = &FORCPU(me,x86_pcid);
+ u64 gen = FORVM(new_vm,x86_vm_pcidgen);
+ unsigned int i,hit = X86_PCID_COUNT;
+ assert(x86_pcid_enabled);
+ for (i = 0; i < X86_PCID_COUNT; ++i) {
+  if (cache->pc_vm[i] != new_vm)
+      continue;
+  if (cache->pc_gen[i] != gen) {
+   /* Left behind by a dead VM that used to live at the same address.
+    * Drop it, so invalidation requests for `new_vm' can only ever
+    * match the slot that is actually in use by it. */
+   cache->pc_vm[i] = NULL;
+   continue;
+  }
+  hit = i;
+ }
+ if (hit != X86_PCID_COUNT) {
+  /* The VM is still cached. -> Re-use its TLB entries. */
+  cache->pc_cur = hit;
+  __asm__ __volatile__("movq %0, %%cr3"
+                       :
+                       : "r" (new_vm->vm_physdir | (hit+1) | X86_CR3_FNOFLUSH)
+                       : "memory");
+  return;
+ }
+ /* Recycle the next slot. */
+ i = cache->pc_next;
+ cache->pc_next = (i+1) % X86_PCID_COUNT;
+ cache->pc_vm[i]  = new_vm;
+ cache->pc_gen[i] = gen;
+ cache->pc_cur    = i;
+ COMPILER_WRITE_BARRIER();
+ /* Load without `X86_CR3_FNOFLUSH', thus flushing anything
+  * that may have been left over by the slot's previous VM. */
+ __asm__ __volatile__("movq %0, %%cr3"
+                      :
+                      : "r" (new_vm->vm_physdir | (i+1))
+                      : "memory");
+}
+
+PUBLIC NOIRQ ATTR_NOTHROW void KCALL
+pagedir_setvm(struct vm *__restrict self) {
+ assert(!PREEMPTION_ENABLED());
+ if (x86_pcid_enabled) {
+  x86_pcid_loadvm(self,THIS_CPU);
+ } else {
+  pagedir_set((pagedir_t *)self->vm_physdir);
+ }
+}
+
+/* Forget any PCID that may be used by `self' on the calling CPU. */
+PRIVATE NOIRQ ATTR_NOTHROW void KCALL
+x86_pcid_forget(struct vm *__restrict self) {
+ struct x86_pcid_cache *cache = &PERCPU(x86_pcid);
+ unsigned int i;
+ for (i = 0; i < X86_PCID_COUNT; ++i) {
+  if (cache->pc_vm[i] == self)
+      cache->pc_vm[i] = NULL;
+ }
+}
+
+struct x86_invpcid_desc {
+    u64 id_pcid; /* The PCID to invalidate. */
+    u64 id_addr; /* The address to invalidate (`X86_INVPCID_ADDRESS' only). */
+};
+#define X86_INVPCID_ADDRESS 0 /* Invalidate a single address of a single PCID. */
+#define X86_INVPCID_SINGLE  1 /* Invalidate all non-global entries of a single PCID. */
+#define X86_INVPCID_ALL     2 /* Invalidate all entries of all PCIDs (including global ones). */
+#define X86_INVPCID_NONGLOB 3 /* Invalidate all non-global entries of all PCIDs. */
+
+LOCAL ATTR_NOTHROW void KCALL
+x86_invpcid(u64 type, u64 pcid, u64 addr) {
+ struct x86_invpcid_desc desc;
+ desc.id_pcid = pcid;
+ desc.id_addr = addr;
+ __asm__ __volatile__("invpcid %0, %1"
+                      :
+                      : "m" (desc), "r" (type)
+                      : "memory");
+}
+
+/* Invalidate TLB entries of `dir' that are cached by the calling CPU
+ * under a PCID other than the one currently in use. Called by the
+ * `X86_IPI_INVLPG' handler when `dir' isn't the active directory. */
+INTERN NOIRQ ATTR_NOTHROW void KCALL
+x86_pcid_sync(VIRT pagedir_t *__restrict dir,
+              vm_vpage_t page_index, size_t num_pages) {
+ struct x86_pcid_cache *cache = &PERCPU(x86_pcid);
+ struct vm *vm; u64 gen; unsigned int i;
+ if (!x86_pcid_enabled) return;
+ /* NOTE: The page directory is located at `VM_OFFSETOF_PAGEDIR' */
+ vm  = (struct vm *)((uintptr_t)dir - VM_OFFSETOF_PAGEDIR);
+ gen = FORVM(vm,x86_vm_pcidgen);
+ for (i = 0; i < X86_PCID_COUNT; ++i) {
+  if (cache->pc_vm[i] != vm)
+      continue;
+  if (cache->pc_gen[i] != gen) {
+   /* Stale slot of a dead VM that used to live at the same address. */
+   cache->pc_vm[i] = NULL;
+   continue;
+  }
+  if (!x86_invpcid_enabled) {
+   /* No way of invalidating a specific PCID from the outside.
+    * -> Just forget about it, so it will be flushed the next
+    *    time the VM is loaded on this CPU. */
+   cache->pc_vm[i] = NULL;
+  } else if (num_pages > 64 ||
+             page_index+num_pages <= page_index ||
+             page_index+num_pages > KERNEL_BASE_PAGE) {
+   x86_invpcid(X86_INVPCID_SINGLE,i+1,0);
+  } else {
+   size_t j;
+   for (j = 0; j < num_pages; ++j)
+       x86_invpcid(X86_INVPCID_ADDRESS,i+1,VM_PAGE2ADDR(page_index+j));
+  }
+ }
+}
+
+/* Invalidate everything cached under any PCID not currently
+ * in use by the calling CPU. Called by `X86_IPI_INVLPG_ALL'. */
+INTERN NOIRQ ATTR_NOTHROW void KCALL x86_pcid_syncall(void) {
+ struct x86_pcid_cache *cache = &PERCPU(x86_pcid);
+ unsigned int i;
+ if (!x86_pcid_enabled) return;
+ if (x86_invpcid_enabled) {
+  x86_invpcid(X86_INVPCID_NONGLOB,0,0);
+  return;
+ }
+ for (i = 0; i < X86_PCID_COUNT; ++i) {
+  if (i != cache->pc_cur)
+      cache->pc_vm[i] = NULL;
+ }
+}
+
+#ifndef CONFIG_NO_SMP
+/* Add all CPUs that may still have TLB entries of `self' cached
+ * under some PCID to `set'. Used by `vm_sync()' to also reach CPUs
+ * not currently hosting any thread using `self'.
+ * The caller must ensure that changes to the page directory
+ * of `self' are visible before this function is called. */
+INTERN ATTR_NOTHROW void KCALL
+x86_pcid_addcpus(struct vm *__restrict self, kernel_cpuset_t set) {
+ cpuid_t id;
+ if (!x86_pcid_enabled) return;
+ for (id = 0; id < cpu_count; ++id) {
+  struct x86_pcid_cache *cache;
+  unsigned int i;
+  cache = &FORCPU(cpu_vector[id],x86_pcid);
+  for (i = 0; i < X86_PCID_COUNT; ++i) {
+   if (ATOMIC_READ(cache->pc_vm[i]) != self)
+       continue;
+   kernel_cpuset_add(set,id);
+   break;
+  }
+ }
+}
+#endif /* !CONFIG_NO_SMP */
+
+
 /* The memory zone used to allocate memory for page directories. */
 #define MZONE_PAGING  MZONE_ANY
 
@@ -370,7 +596,12 @@ pagedir_fini(VIRT pagedir_t *__restrict self) {
  }
  /* Switch back to the real page directory if we had to change it. */
  if (did_switch) {
-  pagedir_set((pagedir_t *)THIS_VM->vm_physdir);
+  /* While the other directory was active, invalidation requests
+   * for our own VM only reached PCID #0, meaning that whatever PCID
+   * was used for it before may contain stale entries by now. */
+  if (x86_pcid_enabled)
+      x86_pcid_forget(THIS_VM);
+  pagedir_setvm(THIS_VM);
   /* Re-enable preemption if we disabled it momentarily. */
   PREEMPTION_POP(was);
  }
@@ -433,7 +664,7 @@ pagedir_allocate_e2(unsigned int x4, unsigned int x3) {
   }
   COMPILER_WRITE_BARRIER();
   /* Re-add permission bits. */
-  E3_IDENTITY[x4][x3].p_data |= ent.p_flag & (PAGE_FMASK & ~PAGE_F1GIB);
+  E3_IDENTITY[x4][x3].p_data |= ent.p_flag & (PAGE_FMASK & ~(PAGE_F1GIB|PAGE_FCACHEMASK));
   COMPILER_WRITE_BARRIER();
  } else
 #endif
@@ -588,7 +819,7 @@ pagedir_allocate_e1(unsigned int x4, unsigned int x3, unsigned int x2) {
    ATOMIC_STORE(E2_IDENTITY[x4][x3][x2].p_data,
                (VM_PAGE2ENTADDR(e1_pageptr) |
                (PAGE_FDIRTY | PAGE_FACCESSED | PAGE_FWRITE | PAGE_FPRESENT) |
-               (ent.p_flag & PAGE_FMASK)));
+               (ent.p_flag & (PAGE_FMASK & ~PAGE_FCACHEMASK))));
    COMPILER_WRITE_BARRIER();
   } else {
    COMPILER_WRITE_BARRIER();
@@ -607,7 +838,7 @@ pagedir_allocate_e1(unsigned int x4, unsigned int x3, unsigned int x2) {
    }
    COMPILER_WRITE_BARRIER();
    /* Re-add permission bits. */
-   E2_IDENTITY[x4][x3][x2].p_data |= ent.p_flag & PAGE_FMASK;
+   E2_IDENTITY[x4][x3][x2].p_data |= ent.p_flag & (PAGE_FMASK & ~PAGE_FCACHEMASK);
    COMPILER_WRITE_BARRIER();
   }
  } else {
@@ -752,9 +983,9 @@ pagedir_addperm_e2(unsigned int x4,
  //assert(x4 != PAGING_E4_IDENTITY_INDEX);
  flags = E2_IDENTITY[x4][x3][x2].p_flag;
 #ifdef CONFIG_NO_NX_PAGES
- flags |= edata & PAGE_FMASK;
+ flags |= edata & (PAGE_FMASK & ~PAGE_FCACHEMASK);
 #else /* CONFIG_NO_NX_PAGES */
- flags |= edata & (PAGE_FMASK & ~PAGE_FNOEXEC);
+ flags |= edata & (PAGE_FMASK & ~(PAGE_FNOEXEC|PAGE_FCACHEMASK));
  flags &= (edata & PAGE_FNOEXEC) | ~PAGE_FNOEXEC;
 #endif /* !CONFIG_NO_NX_PAGES */
  E2_IDENTITY[x4][x3][x2].p_flag = flags;
@@ -768,9 +999,9 @@ pagedir_addperm_e3(unsigned int x4,
  //assert(x4 != PAGING_E4_IDENTITY_INDEX);
  flags = E3_IDENTITY[x4][x3].p_flag;
 #ifdef CONFIG_NO_NX_PAGES
- flags |= edata & PAGE_FMASK;
+ flags |= edata & (PAGE_FMASK & ~PAGE_FCACHEMASK);
 #else /* CONFIG_NO_NX_PAGES */
- flags |= edata & (PAGE_FMASK & ~PAGE_FNOEXEC);
+ flags |= edata & (PAGE_FMASK & ~(PAGE_FNOEXEC|PAGE_FCACHEMASK));
  flags &= (edata & PAGE_FNOEXEC) | ~PAGE_FNOEXEC;
 #endif /* !CONFIG_NO_NX_PAGES */
  E3_IDENTITY[x4][x3].p_flag = flags;
@@ -783,9 +1014,9 @@ pagedir_addperm_e4(unsigned int x4,
  //assert(x4 != PAGING_E4_IDENTITY_INDEX);
  flags = E4_IDENTITY[x4].p_flag;
 #ifdef CONFIG_NO_NX_PAGES
- flags |= edata & PAGE_FMASK;
+ flags |= edata & (PAGE_FMASK & ~PAGE_FCACHEMASK);
 #else /* CONFIG_NO_NX_PAGES */
- flags |= edata & (PAGE_FMASK & ~PAGE_FNOEXEC);
+ flags |= edata & (PAGE_FMASK & ~(PAGE_FNOEXEC|PAGE_FCACHEMASK));
  flags &= (edata & PAGE_FNOEXEC) | ~PAGE_FNOEXEC;
 #endif /* !CONFIG_NO_NX_PAGES */
  E4_IDENTITY[x4].p_flag = flags;
@@ -846,7 +1077,8 @@ pagedir_map(VIRT vm_vpage_t virt_page, size_t num_pages,
          "num_pages = %p\n",
          virt_page,num_pages);
  assert((perm&PAGEDIR_MAP_FUNMAP) || phys_page+num_pages <= (VM_PPAGE_MAX+1));
- edata = (u64)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf];
+ edata = (u64)VM_PAGE2ADDR(phys_page) | x86_pageperm_matrix[perm & 0xf] |
+         x86_pagecache_matrix[(perm & PAGEDIR_MAP_FMEMTYPE) >> 4];
  if (virt_page >= KERNEL_BASE_PAGE)
      edata |= x86_page_global; /* Kernel-share mapping. */
  pagedir_split_before(vpage_start,(perm & PAGEDIR_MAP_FUNMAP) != 0);
@@ -0,0 +1,87 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_I386_KOS_PAT_C
+#define GUARD_KERNEL_I386_KOS_PAT_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/section.h>
+#include <kos/types.h>
+#include <kernel/paging.h>
+#include <kernel/debug.h>
+#include <i386-kos/cpuid.h>
+#include <sched/task.h>
+#include <asm/cpu-flags.h>
+#include <kos/intrin.h>
+
+DECL_BEGIN
+
+/* The PAT layout used by KOS.
+ * Only the first 4 entries are ever selected (we never set the PAT bit,
+ * which would have a different position for every page size), so the
+ * memory type is fully described by the PWT and PCD bits, which have
+ * the same meaning in every level of the page directory:
+ *    [0] -- WB   (     |     ) -- Same as the power-up default.
+ *    [1] -- WC   (     | PWT ) -- Power-up default: WT
+ *    [2] -- WT   ( PCD |     ) -- Power-up default: UC-
+ *    [3] -- UC   ( PCD | PWT ) -- Same as the power-up default.
+ * The upper 4 entries mirror the lower ones, so that
+ * even a stray PAT bit wouldn't change the memory type. */
+#define KOS_PAT_LAYOUT \
+   (IA32_PAT_ENTRY(0,IA32_PAT_WB) | IA32_PAT_ENTRY(1,IA32_PAT_WC) | \
+    IA32_PAT_ENTRY(2,IA32_PAT_WT) | IA32_PAT_ENTRY(3,IA32_PAT_UC) | \
+    IA32_PAT_ENTRY(4,IA32_PAT_WB) | IA32_PAT_ENTRY(5,IA32_PAT_WC) | \
+    IA32_PAT_ENTRY(6,IA32_PAT_WT) | IA32_PAT_ENTRY(7,IA32_PAT_UC))
+
+/* Page directory bits used to select a given `PAGEDIR_MAP_FMEMTYPE_*'
+ * The default configuration matches the power-up PAT layout, which
+ * has no way of expressing write-combining, so we fall back to UC-. */
+INTERN u16 x86_pagecache_matrix[4] = {
+    [PAGEDIR_MAP_FMEMTYPE_WB >> 4] = 0,
+    [PAGEDIR_MAP_FMEMTYPE_WC >> 4] = X86_PAGE_FPCD,
+    [PAGEDIR_MAP_FMEMTYPE_UC >> 4] = X86_PAGE_FPCD|X86_PAGE_FPWT,
+    [PAGEDIR_MAP_FMEMTYPE_WT >> 4] = X86_PAGE_FPWT,
+};
+
+/* Program the PAT MSR of the calling CPU.
+ * Must be called by every CPU before it may use memory
+ * mappings with a memory type other than write-back. */
+INTERN ATTR_FREETEXT void KCALL x86_initialize_pat(void) {
+ struct cpu_cpuid const *feat = &CPU_FEATURES;
+ if (!(feat->ci_1d & CPUID_1D_PAT))
+       return; /* Not available (Stick to the power-up layout). */
+ if (THIS_CPU == &_boot_cpu) {
+  debug_printf(FREESTR("[X86] Enable PAT (write-combining memory)\n"));
+  x86_pagecache_matrix[PAGEDIR_MAP_FMEMTYPE_WC >> 4] = X86_PAGE_FPWT;
+  x86_pagecache_matrix[PAGEDIR_MAP_FMEMTYPE_UC >> 4] = X86_PAGE_FPCD|X86_PAGE_FPWT;
+  x86_pagecache_matrix[PAGEDIR_MAP_FMEMTYPE_WT >> 4] = X86_PAGE_FPCD;
+ }
+ /* NOTE: At this point, no mapping using PAT entries #1 or #2
+  *       exists yet, meaning that no cache line can have been
+  *       loaded using one of the memory types we're changing.
+  *       Still flush caches and TLBs, as required by the spec. */
+ __wbinvd();
+ __wrmsr(IA32_PAT,KOS_PAT_LAYOUT);
+ __wbinvd();
+ pagedir_syncall();
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_I386_KOS_PAT_C */
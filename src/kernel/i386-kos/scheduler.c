@@ -46,6 +46,7 @@
 #include <kernel/vm.h>
 #include <kos/types.h>
 #include <sched/affinity.h>
+#include <sched/cputime.h>
 #include <sched/group.h>
 #include <sched/pid.h>
 #include <sched/posix_signals.h>
@@ -156,6 +157,19 @@ x86_scheduler_initialize(void) {
  * NOTE: This function will enable preemption before returning. */
 INTDEF void KCALL x86_cpu_idle(void);
 
+#ifndef CONFIG_NO_TASKSTAT
+/* Same as `x86_cpu_idle()', but account timer interrupts
+ * that arrive while the CPU is halted as idle time. */
+LOCAL void KCALL x86_cpu_idle_stat(void) {
+ struct cpu *me = THIS_CPU;
+ uintptr_t old_ticks = FORCPU(me,_this_cpustat).cs_system;
+ x86_cpu_idle();
+ FORCPU(me,_this_cpustat).cs_idle += FORCPU(me,_this_cpustat).cs_system-old_ticks;
+}
+#else
+#define x86_cpu_idle_stat()  x86_cpu_idle()
+#endif
+
 /* NOTE: Must be called with interrupts disabled.
  * NOTE: Will return with interrupts enabled.
  * Save the caller's CPU context into the current task,
@@ -204,6 +218,7 @@ x86_scheduler_localwake(struct task *__restrict thread) {
                      t_sched.sched_ring);
 #endif
   thread->t_state &= ~TASK_STATE_FSLEEPING;
+  cputime_wake(thread);
   return true;
  }
  return false;
@@ -220,6 +235,7 @@ x86_scheduler_localwake_p(struct task *prev,
        prev = THIS_CPU->c_running;
   RING_INSERT_AFTER(prev,thread,t_sched.sched_ring);
   ATOMIC_FETCHAND(thread->t_state,~TASK_STATE_FSLEEPING);
+  cputime_wake(thread);
   return true;
  } else if (prev && prev->t_cpu == THIS_CPU &&
           !(prev->t_state & TASK_STATE_FSLEEPING)) {
@@ -564,6 +580,7 @@ task_wake_ex(struct task *__restrict thread,
   LIST_REMOVE(thread,t_sched.sched_list);
   RING_INSERT_BEFORE(THIS_CPU->c_running,thread,
                      t_sched.sched_ring);
+  cputime_wake(thread);
  } else if (mode == X86_IPI_WAKETASK_FOR_RPC) {
   x86_redirect_preempted_userspace(thread);
  }
@@ -695,7 +712,7 @@ PUBLIC NOIRQ ATTR_HOTTEXT bool KCALL task_sleep(jtime_t abs_timeout) {
    *      That way, we could safe up on some energy when we
    *      don't get constant awoken by the PIT clock, only
    *      to find that there is no other task to switch to. */
-  x86_cpu_idle();
+  x86_cpu_idle_stat();
   return (abs_timeout > jiffies ||
           abs_timeout == JTIME_INFINITE);
  }
@@ -987,6 +1004,8 @@ task_start(struct task *__restrict self) {
  /* Save a timestamp of when the thread was started. */
  FORTASK(self,_this_stat).ts_started = jiffies;
 #endif
+ /* Time until the thread is first scheduled is accounted as wait-time. */
+ cputime_wake(self);
 
  /* Start scheduling this task on its launch CPU. */
 #ifndef CONFIG_NO_SMP
@@ -1196,7 +1215,7 @@ restart_final_decref:
         task_queue_rpc(&_boot_task,&print_here,NULL,TASK_RPC_SYNC);
 #endif
    }
-   x86_cpu_idle(); /* XXX: Disable PIT */
+   x86_cpu_idle_stat(); /* XXX: Disable PIT */
    continue;
   }
   break;
@@ -1209,6 +1228,9 @@ restart_final_decref:
  assert(next_task != calling_task);
  RING_REMOVE(calling_task,t_sched.sched_ring);
  old_pagedir = (uintptr_t)calling_task->t_vm->vm_physdir;
+ /* Account the switch now, as `x86_load_context' doesn't. */
+ cputime_sync();
+ cputime_resume(next_task);
  /* Try to decrement our own reference counter, but only do so
   * if it wouldn't result in us having to destroy ourselves.
   * If the decrement worked, immediately jump to `x86_load_context' */
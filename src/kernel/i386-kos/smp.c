@@ -297,7 +297,7 @@ PRIVATE struct vm_region lapic_region = {
     .vr_futex  = ATOMIC_RWPTR_INIT(NULL),
     .vr_type   = VM_REGION_PHYSICAL,
     .vr_init   = VM_REGION_INIT_FNORMAL,
-    .vr_flags  = VM_REGION_FIMMUTABLE|VM_REGION_FDONTMERGE|VM_REGION_FLEAKINGPARTS,
+    .vr_flags  = VM_REGION_FIMMUTABLE|VM_REGION_FDONTMERGE|VM_REGION_FLEAKINGPARTS|VM_REGION_FMEMTYPE_UC,
     .vr_funds  = 0,
     .vr_size   = 0, /* Filled later. */
     .vr_parts  = &lapic_region.vr_part0,
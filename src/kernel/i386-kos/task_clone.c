@@ -331,6 +331,11 @@ x86_clone_impl(USER CHECKED struct x86_usercontext *context,
 
   COMPILER_WRITE_BARRIER();
 
+  /* The parent of a vfork()-ed child remains suspended
+   * until the child calls exec(), or terminates. */
+  if (flags & CLONE_VFORK)
+      new_task->t_flags |= TASK_FVFORK;
+
   /* Set the user-space TLS pointer (this will get overwritten
    * during `clone_entry' if `CLONE_SETTLS' isn't set) */
   new_task->t_userseg = (USER struct user_task_segment *)tls_val;
@@ -378,6 +383,9 @@ x86_clone_impl(USER CHECKED struct x86_usercontext *context,
 
   /* Start the new thread. */
   task_start(new_task);
+  /* Keep the child alive while we wait for it below. */
+  if (flags & CLONE_VFORK)
+      task_incref(new_task);
 
   /*task_yield();*/
 
@@ -386,6 +394,15 @@ x86_clone_impl(USER CHECKED struct x86_usercontext *context,
       task_failed(new_task);
   task_decref(new_task);
  }
+ if (flags & CLONE_VFORK) {
+  /* The child is using our VM and (in case of `vfork()') our
+   * user-space stack. Wait for it to exec() or terminate. */
+  TRY {
+   task_vfork_wait(new_task);
+  } FINALLY {
+   task_decref(new_task);
+  }
+ }
  return result;
 }
 
@@ -404,7 +421,7 @@ DEFINE_SYSCALL5(clone,
 
 
 PRIVATE void KCALL
-task_fork_impl(void *UNUSED(arg),
+task_fork_impl(void *arg,
                struct cpu_hostcontext_user *__restrict context,
                unsigned int UNUSED(mode)) {
  struct x86_usercontext user_state;
@@ -442,7 +459,14 @@ task_fork_impl(void *UNUSED(arg),
  user_state.c_gpregs.gp_eax = 0;
 
  /* Do the clone. */
- child_pid = x86_clone_impl(&user_state,(SIGCHLD+1),NULL,NULL,NULL);
+ if (arg) {
+  /* vfork(): Share the VM, and keep using our TLS segment until exec(). */
+  child_pid = x86_clone_impl(&user_state,
+                            (SIGCHLD+1)|CLONE_VM|CLONE_VFORK|CLONE_SETTLS,
+                             NULL,THIS_TASK->t_userseg,NULL);
+ } else {
+  child_pid = x86_clone_impl(&user_state,(SIGCHLD+1),NULL,NULL,NULL);
+ }
 
  /* Return the child process's PID in the parent process. */
  context->c_gpregs.gp_eax = child_pid;
@@ -456,6 +480,13 @@ DEFINE_SYSCALL0(fork) {
  __builtin_unreachable();
 }
 
+DEFINE_SYSCALL0(vfork) {
+ /* Same as fork(), but don't duplicate the VM. Instead, the
+  * child borrows it (including our stack) until it exec()s. */
+ task_queue_rpc_user(THIS_TASK,&task_fork_impl,(void *)1,TASK_RPC_USER);
+ __builtin_unreachable();
+}
+
 
 
 
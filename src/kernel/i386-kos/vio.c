@@ -26,6 +26,7 @@
 #include <kernel/interrupt.h>
 #include <kernel/malloc.h>
 #include <kernel/vm.h>
+#include <kernel/user.h>
 #include <i386-kos/interrupt.h>
 #include <kos/i386-kos/bits/cpu-context.h>
 #include <kos/i386-kos/asm/except.h>
@@ -559,6 +560,135 @@ LOCAL register_t KCALL x86_bsrl(u32 x, u32 *__restrict presult) {
 
 
 
+/* String instructions handled by `x86_vio_string()' */
+#define X86_VIO_STRING_MOVS 0 /* movs */
+#define X86_VIO_STRING_STOS 1 /* stos */
+#define X86_VIO_STRING_LODS 2 /* lods */
+
+/* Emulate a (possibly `rep'-prefixed) `movs', `stos' or `lods' instruction
+ * accessing VIO memory at `addr' (`abs_addr' in virtual memory).
+ * Rather than emulating only a single element and having the instruction
+ * fault again for every remaining one, transfer as many elements as possible
+ * at once, using the bulk VIO operators (when available).
+ * Transfers only stop at the end of the page containing `abs_addr' (the next
+ * page may not even be VIO, or belong to a different region), after which the
+ * instruction is restarted with updated registers.
+ * @return: true:  The instruction has completed.
+ * @return: false: The instruction must be restarted (don't advance IP). */
+PRIVATE bool KCALL
+x86_vio_string(struct cpu_anycontext *__restrict context,
+               struct vio_ops *__restrict ops, void *closure,
+               uintptr_t addr, VIRT void *abs_addr,
+               unsigned int kind, size_t elem_size, u16 flags) {
+ size_t count = 1,num_bytes;
+ bool is_rep = (flags & (F_REP|F_REPNE)) != 0;
+ if (is_rep) {
+  count = CONTEXT_CREG(*context);
+  if unlikely(!count) return true;
+ }
+ /* Only transfer multiple elements at once when moving forward.
+  * With DF set, elements must be accessed in descending order, and
+  * with a 16-bit (32-bit on x86_64) address size, registers would have
+  * to wrap around. Both are rare enough to just do one element per trap. */
+ if (count > 1) {
+  if ((context->c_pflags & EFLAGS_DF) || (flags & F_AD16)) {
+   count = 1;
+  } else {
+   size_t avail;
+   avail = (PAGESIZE - ((uintptr_t)abs_addr & (PAGESIZE-1))) / elem_size;
+   if (!avail) avail = 1; /* The element crosses the page boundary. */
+   if (count > avail)
+       count = avail;
+  }
+ }
+ num_bytes = count * elem_size;
+ switch (kind) {
+
+ case X86_VIO_STRING_MOVS:
+  if ((uintptr_t)abs_addr == CONTEXT_DIREG(*context)) {
+   /* Memory -> VIO */
+   void *src = (void *)CONTEXT_SIREG(*context);
+   if (X86_ANYCONTEXT_ISUSER(*context))
+       validate_readable(src,num_bytes);
+   vio_copyto(ops,closure,addr,src,elem_size,num_bytes);
+  } else {
+   /* VIO -> Memory */
+   void *dst = (void *)CONTEXT_DIREG(*context);
+   if (X86_ANYCONTEXT_ISUSER(*context))
+       validate_writable(dst,num_bytes);
+   vio_copyfrom(ops,closure,addr,dst,elem_size,num_bytes);
+  }
+  if (context->c_pflags & EFLAGS_DF) {
+   CONTEXT_DIREG(*context) -= num_bytes;
+   CONTEXT_SIREG(*context) -= num_bytes;
+  } else {
+   CONTEXT_DIREG(*context) += num_bytes;
+   CONTEXT_SIREG(*context) += num_bytes;
+  }
+  break;
+
+ case X86_VIO_STRING_STOS:
+  /* NOTE: Little endian, so the low bytes of the A-register come first. */
+  vio_fill(ops,closure,addr,&CONTEXT_AREG(*context),elem_size,num_bytes);
+  if (context->c_pflags & EFLAGS_DF) {
+   CONTEXT_DIREG(*context) -= num_bytes;
+  } else {
+   CONTEXT_DIREG(*context) += num_bytes;
+  }
+  break;
+
+ {
+  union {
+   u8  b;
+   u16 w;
+   u32 l;
+#ifdef __x86_64__
+   u64 q;
+#endif
+  } value;
+  size_t i;
+ case X86_VIO_STRING_LODS:
+  /* Every element must still be read (reads may have side-effects),
+   * but only the last one ends up in the A-register. */
+  for (i = 0; i < count; ++i)
+      vio_copyfrom(ops,closure,addr+i*elem_size,&value,elem_size,elem_size);
+  switch (elem_size) {
+  case 1: context->c_gpregs.gp_al = value.b; break;
+  case 2: context->c_gpregs.gp_ax = value.w; break;
+#ifdef __x86_64__
+  case 8: context->c_gpregs.gp_rax = value.q; break;
+  default: context->c_gpregs.gp_rax = value.l; break;
+#else
+  default: context->c_gpregs.gp_eax = value.l; break;
+#endif
+  }
+  if (context->c_pflags & EFLAGS_DF) {
+   CONTEXT_SIREG(*context) -= num_bytes;
+  } else {
+   CONTEXT_SIREG(*context) += num_bytes;
+  }
+ } break;
+
+ default: __builtin_unreachable();
+ }
+ if (is_rep) {
+  CONTEXT_CREG(*context) -= count;
+  if (CONTEXT_CREG(*context) != 0)
+      return false;
+ }
+ return true;
+}
+
+/* The element size of a `movs/stos/lods' instruction using a 16/32(/64)-bit operand. */
+#ifdef __x86_64__
+#define X86_STRING_ELEMSIZE(flags) \
+   ((flags) & F_OP16 ? 2 : (flags) & F_REX_W ? 8 : 4)
+#else
+#define X86_STRING_ELEMSIZE(flags) \
+   ((flags) & F_OP16 ? 2 : 4)
+#endif
+
+
 #define CF EFLAGS_CF
 #define PF EFLAGS_PF
 #define AF EFLAGS_AF
@@ -2905,71 +3035,53 @@ skip_modrm:
   }
   goto ok;
 
+ case 0xa4:
+  /* movsb */
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_MOVS,1,flags))
+      goto ok;
+  goto ok_noip;
+
+ case 0xa5:
+  /* movsw */
+  /* movsl */
+  /* movsq */
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_MOVS,X86_STRING_ELEMSIZE(flags),flags))
+      goto ok;
+  goto ok_noip;
+
  case 0xaa:
   /* stosb */
-  vio_writeb(ops,closure,addr,context->c_gpregs.gp_al);
-  if (context->c_pflags & DF) {
-   ++CONTEXT_DIREG(*context);
-   ++CONTEXT_SIREG(*context);
-  } else {
-   --CONTEXT_DIREG(*context);
-   --CONTEXT_SIREG(*context);
-  }
-  goto ok_handle_rep;
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_STOS,1,flags))
+      goto ok;
+  goto ok_noip;
 
  case 0xab:
   /* stosw */
   /* stosl */
-  if (flags & F_OP16) {
-   vio_writew(ops,closure,addr,context->c_gpregs.gp_ax);
-   if (context->c_pflags & DF) {
-    CONTEXT_DIREG(*context) -= 2;
-    CONTEXT_SIREG(*context) -= 2;
-   } else {
-    CONTEXT_DIREG(*context) += 2;
-    CONTEXT_SIREG(*context) += 2;
-   }
-  } else {
-   vio_writel(ops,closure,addr,context->c_gpregs.gp_eax);
-   if (context->c_pflags & DF) {
-    CONTEXT_DIREG(*context) -= 4;
-    CONTEXT_SIREG(*context) -= 4;
-   } else {
-    CONTEXT_DIREG(*context) += 4;
-    CONTEXT_SIREG(*context) += 4;
-   }
-  }
-  goto ok_handle_rep;
+  /* stosq */
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_STOS,X86_STRING_ELEMSIZE(flags),flags))
+      goto ok;
+  goto ok_noip;
 
  case 0xac:
   /* lodsb */
-  context->c_gpregs.gp_al = vio_readb(ops,closure,addr);
-  if (context->c_pflags & DF) {
-   --CONTEXT_SIREG(*context);
-  } else {
-   ++CONTEXT_SIREG(*context);
-  }
-  goto ok_handle_rep;
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_LODS,1,flags))
+      goto ok;
+  goto ok_noip;
 
  case 0xad:
   /* lodsw */
   /* lodsl */
-  if (flags & F_OP16) {
-   context->c_gpregs.gp_ax = vio_readw(ops,closure,addr);
-   if (context->c_pflags & DF) {
-    CONTEXT_DIREG(*context) -= 2;
-   } else {
-    CONTEXT_DIREG(*context) += 2;
-   }
-  } else {
-   context->c_gpregs.gp_eax = vio_readl(ops,closure,addr);
-   if (context->c_pflags & DF) {
-    CONTEXT_DIREG(*context) -= 4;
-   } else {
-    CONTEXT_DIREG(*context) += 4;
-   }
-  }
-  goto ok_handle_rep;
+  /* lodsq */
+  if (x86_vio_string(context,ops,closure,addr,abs_addr,
+                     X86_VIO_STRING_LODS,X86_STRING_ELEMSIZE(flags),flags))
+      goto ok;
+  goto ok_noip;
 
  case 0xae:
   /* scasb */
@@ -3111,12 +3223,6 @@ skip_modrm:
  }
 fail:
  return false;
-ok_handle_rep:
- if (flags & F_REP) {
-  if (--CONTEXT_CREG(*context) != 0)
-      goto ok_noip;
- }
- goto ok;
 ok_handle_repe:
  if (flags & (F_REP|F_REPNE)) {
   if (--CONTEXT_CREG(*context) != 0) {
@@ -51,7 +51,7 @@ struct PACKED handle {
     union PACKED {
         struct PACKED {
             u16                             h_type;                /* [const] Handle type (One of `HANDLE_TYPE_F*') */
-            iomode_t                        h_flag;                /* [lock(:hm_lock)] I/O mode flags (Set of `IO_*') */
+            iomode_t                        h_flag;                /* [lock(WRITE(:hm_lock))] I/O mode flags (Set of `IO_*') */
         };
         uintptr_t                           h_mode;                /* Handle mode (constructed from `HANDLE_MODE'). */
         uintptr_t                         __h_pad;                 /* Padding. */
@@ -85,6 +85,7 @@ struct PACKED handle {
             REF struct futex               *o_futex;               /* [1..1][const][HANDLE_TYPE_FFUTEX] */
             REF struct futex_handle        *o_futex_handle;        /* [1..1][const][HANDLE_TYPE_FFUTEX_HANDLE] */
             REF struct device_stream       *o_device_stream;       /* [1..1][const][HANDLE_TYPE_FDEVICE_STREAM] */
+            REF struct ioring              *o_ioring;              /* [1..1][const][HANDLE_TYPE_FIORING] */
         }                                   h_object;              /* [const] The object pointed to by this handle. */
     };
 };
@@ -161,17 +162,48 @@ DATDEF struct handle_types_struct const handle_types;
 #endif
 
 
+/* Number of handle slots in one chunk of a handle table.
+ * Chunks are never moved or freed while the handle manager
+ * is alive, which is what allows `handle_get()' to be lock-less. */
+#define HANDLE_TABLE_CHUNK   (__SIZEOF_POINTER__*8)
+
+struct handle_slot {
+    ATOMIC_DATA uintptr_t       hs_inuse;  /* Number of lock-less readers currently inspecting this slot.
+                                            * Writers that remove a handle must wait for this to drop to
+                                            * ZERO before re-using the slot, or dropping the old handle's
+                                            * reference. */
+    ATOMIC_DATA uintptr_t       hs_seq;    /* [lock(WRITE(:hm_lock))] Odd while the handle is being replaced
+                                            * with another (s.a. `dup2()'). Lock-less readers must re-read
+                                            * the handle when this changes during their read. */
+    struct handle               hs_hnd;    /* [lock(WRITE(:hm_lock))] The handle stored in this slot.
+                                            * Lock-less readers must read `h_mode' before `h_ptr'. */
+};
+
+struct handle_table {
+    unsigned int                ht_alloc;  /* [const] Number of slots (Always a multiple of `HANDLE_TABLE_CHUNK') */
+    struct handle_table        *ht_prev;   /* [0..1][const][owned] Previous (smaller) table that was retired when
+                                            * this one was installed. Lock-less readers may still be using it,
+                                            * so it is only freed alongside the handle manager. */
+    struct handle_slot         *ht_chunk[1]; /* [1..1][const][ht_alloc / HANDLE_TABLE_CHUNK]
+                                            * Slot chunks (owned by the most recent table). */
+};
+
 struct handle_manager {
     /* Handle manager.
      * WARNING: The handle-manager system isn't PF-safe, meaning that
      *          code which may be called from page-fault handlers is
      *          not allowed to use it. */
     ATOMIC_DATA ref_t           hm_refcnt; /* Handle manager reference counter. */
-    atomic_rwlock_t             hm_lock;   /* Lock for accessing this handle manager. */
+    atomic_rwlock_t             hm_lock;   /* Lock for modifying this handle manager (lookups don't need it). */
     WEAK unsigned int           hm_limit;  /* Max number of handles that may be allocated. */
-    unsigned int                hm_alloc;  /* [lock(hm_lock)] Allocated number of handles. */
     unsigned int                hm_count;  /* [lock(hm_lock)] Amount of handles currently in use. */
-    struct handle              *hm_vector; /* [lock(hm_lock)][0..hm_alloc][owned] Vector of owned handles (unused handles have `HANDLE_TYPE_FNONE' set as type) */
+    unsigned int                hm_next;   /* [lock(hm_lock)] All handles below this one are known to be in use. */
+    ATOMIC_DATA struct handle_table
+                               *hm_table;  /* [0..1][lock(WRITE(hm_lock))][owned] The current handle table.
+                                            * Unused slots have `HANDLE_TYPE_FNONE' set as type. */
+    uintptr_t                  *hm_used;   /* [lock(hm_lock)][0..hm_table->ht_alloc/HANDLE_TABLE_CHUNK][owned]
+                                            * Bitset of slots that are in use. */
+    uintptr_t                  *hm_full;   /* [lock(hm_lock)][owned] Bitset of `hm_used' words that are all ones. */
 #define HANDLE_MANAGER_FNORMAL  0x0000     /* Normal handle manager flags. */
     u16                         hm_flags;  /* [lock(hm_lock)] Set of `HANDLE_MANAGER_F*' */
 };
@@ -297,6 +329,7 @@ FUNDEF ATTR_RETNONNULL REF struct task_weakref *KCALL handle_get_thread(fd_t fd)
 FUNDEF ATTR_RETNONNULL REF struct vm_region *KCALL handle_get_vm_region(fd_t fd);
 FUNDEF ATTR_RETNONNULL REF struct pipewriter *KCALL handle_get_pipewriter(fd_t fd);
 FUNDEF ATTR_RETNONNULL REF struct socket *KCALL handle_get_socket(fd_t fd);
+FUNDEF ATTR_RETNONNULL REF struct ioring *KCALL handle_get_ioring(fd_t fd);
 #else
 #define handle_get_file(fd)             ((REF struct file *)handle_get_typed(fd,HANDLE_TYPE_FFILE))
 #define handle_get_directory_entry(fd)  ((REF struct directory_entry *)handle_get_typed(fd,HANDLE_TYPE_FDIRECTORY_ENTRY))
@@ -306,6 +339,7 @@ FUNDEF ATTR_RETNONNULL REF struct socket *KCALL handle_get_socket(fd_t fd);
 #define handle_get_pipereader(fd)       ((REF struct pipereader *)handle_get_typed(fd,HANDLE_TYPE_FPIPEREADER))
 #define handle_get_pipewriter(fd)       ((REF struct pipewriter *)handle_get_typed(fd,HANDLE_TYPE_FPIPEWRITER))
 #define handle_get_socket(fd)           ((REF struct socket *)handle_get_typed(fd,HANDLE_TYPE_FSOCKET))
+#define handle_get_ioring(fd)           ((REF struct ioring *)handle_get_typed(fd,HANDLE_TYPE_FIORING))
 FUNDEF ATTR_RETNONNULL REF void *KCALL handle_get_typed(fd_t fd, u16 type);
 #endif
 
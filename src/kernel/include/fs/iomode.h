@@ -115,7 +115,8 @@ typedef u32 packet_iomode_t;
                                        *        End of record. */
 #define PACKET_IO_FWRCONFIRM   0x0800 /* [SEND][== MSG_CONFIRM][???]
                                        *        Confirm path validity. */
-/*      PACKET_IO_FWR...       0x4000  * Reserved for `MSG_NOSIGNAL' */
+#define PACKET_IO_FWRNOSIGNAL  0x4000 /* [SEND][== MSG_NOSIGNAL]
+                                       *        Don't raise `SIGPIPE' when the other end was closed. */
 #define PACKET_IO_FWRMORE      0x8000 /* [SEND][== MSG_MORE] Sender will send more. */
 
 
@@ -0,0 +1,131 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_INCLUDE_FS_IORING_H
+#define GUARD_KERNEL_INCLUDE_FS_IORING_H 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/sync/atomic-rwlock.h>
+#include <kos/types.h>
+#include <kos/ioring.h>
+#include <kos/except.h>
+#include <fs/handle.h>
+#include <fs/iomode.h>
+#include <sched/signal.h>
+#include <sched/mutex.h>
+#include <bits/uio.h>
+
+DECL_BEGIN
+
+#ifdef __CC__
+struct vm;
+struct task;
+struct socket;
+
+struct ioring_req {
+    /* A single asynchronous I/O operation, from submission until
+     * its completion has been written into the ring's CQ. */
+    struct ioring_req    *rq_next;   /* [0..1][lock(:ir_lock)] Next request in the same queue. */
+    struct ioring_sqe     rq_sqe;    /* [const] Kernel-side copy of the submission queue entry. */
+    REF struct handle     rq_hnd;    /* [const] The handle targeted by the operation (`HANDLE_TYPE_FNONE' if none) */
+    iomode_t              rq_mode;   /* [const] I/O mode used for the operation (Usually `rq_hnd.h_flag') */
+    u16                   rq_flags;  /* Set of `IORING_CQE_F*' */
+    except_t              rq_error;  /* `E_OK', or the error that caused the operation to fail. */
+    u16                 __rq_pad;    /* ... */
+    s64                   rq_result; /* [valid_if(rq_error == E_OK)] Operation result. */
+    REF struct socket    *rq_accept; /* [0..1][IORING_OP_ACCEPT] The accepted connection.
+                                      * It is only added to the handle manager of the thread that
+                                      * writes the completion into the CQ, since worker threads
+                                      * don't share their handle manager with the ring's owner. */
+};
+
+struct ioring {
+    /* The kernel-side descriptor of an I/O ring (`HANDLE_TYPE_FIORING').
+     * NOTE: Worker threads only hold weak references, such that closing the
+     *       last handle of the ring will stop them, even though they are still
+     *       referenced by pending requests. */
+    ATOMIC_DATA ref_t     ir_refcnt;   /* Reference counter. */
+    ATOMIC_DATA ref_t     ir_weakcnt;  /* Weak reference counter (+1 while `ir_refcnt != 0'; +1 for every worker thread) */
+    REF struct vm        *ir_vm;       /* [1..1][const] The VM that created the ring (and in which the SQ/CQ live) */
+    USER CHECKED struct ioring_sq *ir_sq; /* [1..1][const] The user-space submission queue. */
+    USER CHECKED struct ioring_cq *ir_cq; /* [1..1][const] The user-space completion queue. */
+    u32                   ir_sqmask;   /* [const] Index mask of the submission queue. */
+    u32                   ir_cqmask;   /* [const] Index mask of the completion queue. */
+    u32                   ir_sqhead;   /* [lock(ir_submit)] Kernel-side copy of `sq_head' */
+    u32                   ir_cqtail;   /* [lock(ir_submit)] Kernel-side copy of `cq_tail' */
+    u32                   ir_setup;    /* [const] Set of `IORING_SETUP_F*' */
+    mutex_t               ir_submit;   /* Lock held while accessing the SQ and CQ (serializes `ioring_enter()') */
+    atomic_rwlock_t       ir_lock;     /* Lock for the fields below. */
+    struct ioring_req    *ir_pend;     /* [0..1][owned][lock(ir_lock)] Queue of requests waiting for a worker thread. */
+    struct ioring_req   **ir_ppend;    /* [1..1][lock(ir_lock)] Pointer to the `rq_next' field of the last pending request. */
+    struct ioring_req    *ir_done;     /* [0..1][owned][lock(ir_lock)] Queue of completed requests not yet written to the CQ. */
+    struct ioring_req   **ir_pdone;    /* [1..1][lock(ir_lock)] Pointer to the `rq_next' field of the last completed request. */
+    size_t                ir_npend;    /* [lock(ir_lock)] Number of requests in `ir_pend' */
+    size_t                ir_ndone;    /* [lock(ir_lock)] Number of requests in `ir_done' */
+    ATOMIC_DATA size_t    ir_inflight; /* Number of submitted requests not yet written to the CQ. */
+#define IORING_FNORMAL    0x0000       /* Normal flags. */
+#define IORING_FSHUTDOWN  0x0001       /* The last handle has been closed (Worker threads must stop) */
+    u16                   ir_flags;    /* [lock(ir_lock)] Set of `IORING_F*' */
+    u16                   ir_maxthreads; /* [const] Max number of worker threads. */
+    u16                   ir_nthreads; /* [lock(ir_lock)] Number of worker threads spawned so far. */
+    ATOMIC_DATA u16       ir_idle;     /* Number of worker threads waiting for `ir_work' */
+    REF struct task     **ir_threads;  /* [1..1][0..ir_nthreads][owned][lock(ir_lock)] Worker threads. */
+    struct sig            ir_work;     /* Broadcast when requests are added to `ir_pend', or `IORING_FSHUTDOWN' is set. */
+    struct sig            ir_avail;    /* Broadcast when requests are added to `ir_done' */
+    size_t                ir_nfiles;   /* [lock(ir_lock)] Number of registered files. */
+    REF struct handle    *ir_files;    /* [0..ir_nfiles][owned][lock(ir_lock)] Registered files (`IORING_SQE_FFIXED_FILE') */
+    size_t                ir_nbufs;    /* [lock(ir_lock)] Number of registered buffers. */
+    struct iovec         *ir_bufs;     /* [0..ir_nbufs][owned][lock(ir_lock)] Registered (and validated) buffers (`IORING_SQE_FFIXED_BUFFER') */
+};
+
+/* Increment/decrement the reference counter of the given I/O ring `x' */
+#define ioring_incref(x)       ATOMIC_FETCHINC((x)->ir_refcnt)
+#define ioring_decref(x)      (ATOMIC_DECFETCH((x)->ir_refcnt) || (ioring_shutdown(x),0))
+#define ioring_weak_incref(x)  ATOMIC_FETCHINC((x)->ir_weakcnt)
+#define ioring_weak_decref(x) (ATOMIC_DECFETCH((x)->ir_weakcnt) || (ioring_destroy(x),0))
+
+/* Stop the worker threads of a ring after its last handle was closed,
+ * then drop the weak reference held on behalf of all regular references. */
+FUNDEF ATTR_NOTHROW void KCALL ioring_shutdown(struct ioring *__restrict self);
+/* Destroy a previously allocated I/O ring. */
+FUNDEF ATTR_NOTHROW void KCALL ioring_destroy(struct ioring *__restrict self);
+
+/* Allocate a new I/O ring for the SQ/CQ described by `params',
+ * living in the calling thread's VM, and initialize their control words.
+ * @throw: E_INVALID_ARGUMENT: Invalid entry counts, or flags.
+ * @throw: E_SEGFAULT:         The SQ or CQ are faulty. */
+FUNDEF ATTR_RETNONNULL REF struct ioring *KCALL
+ioring_alloc(USER CHECKED struct ioring_params const *__restrict params);
+
+/* Consume up to `max_submit' entries from the SQ of `self', executing
+ * them inline, or handing them to worker threads when they would block.
+ * Submission stops early when `2*ip_cq_entries' operations are in flight.
+ * NOTE: The caller must be holding a lock to `self->ir_submit'.
+ * @return: * : The number of consumed entries. */
+FUNDEF size_t KCALL ioring_submit(struct ioring *__restrict self, size_t max_submit);
+
+/* Write completed operations into the CQ of `self', for as long as it has space.
+ * NOTE: The caller must be holding a lock to `self->ir_submit'.
+ * @return: * : The number of written completions. */
+FUNDEF size_t KCALL ioring_flush(struct ioring *__restrict self);
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_INCLUDE_FS_IORING_H */
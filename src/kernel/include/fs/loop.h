@@ -0,0 +1,86 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_INCLUDE_FS_LOOP_H
+#define GUARD_KERNEL_INCLUDE_FS_LOOP_H 1
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <sched/rwlock.h>
+#include <fs/device.h>
+#include <kos/kdev_t.h>
+
+DECL_BEGIN
+
+#define LOOP_MAJOR                 7   /* Major device number of `/dev/loop*' */
+#define LOOP_CONTROL_DEVNO  MKDEV(10,237) /* Device number of `/dev/loop-control' */
+
+#ifndef CONFIG_LOOP_MAXDEVICES
+#define CONFIG_LOOP_MAXDEVICES     256 /* Max number of named loop devices. */
+#endif
+#define LOOP_DEFAULT_BLOCKSIZE     512 /* Default sector size of loop devices. */
+
+#ifdef __CC__
+struct inode;
+
+/* A block device operating in linear mode, that forwards all I/O
+ * directly to the `f_pread()' / `f_pwrite()' operators of a backing
+ * INode (or to another block device), without keeping its own copy
+ * of the data in a `block_pages' buffer. */
+struct loop_device {
+    struct block_device         ld_dev;    /* Underlying block device (`DEVICE_BLOCK_FLINEAR' is set) */
+    rwlock_t                    ld_lock;   /* Lock for the binding of this loop device. */
+    REF struct inode           *ld_node;   /* [0..1][lock(ld_lock)] The backing INode (NULL if unbound). */
+    REF struct block_device    *ld_bdev;   /* [0..1][lock(ld_lock)] The backing block device, if `ld_node' is a block-device file. */
+    pos_t                       ld_offset; /* [lock(ld_lock)] Offset into `ld_node' where the device starts. */
+    pos_t                       ld_limit;  /* [lock(ld_lock)] Max number of bytes mapped from `ld_node' (0 for everything) */
+    u32                         ld_flags;  /* [lock(ld_lock)] Set of `LO_FLAGS_*' (from <linux/loop.h>) */
+    u32                         ld_number; /* [const] Loop device number (`/dev/loop<ld_number>') or (u32)-1 if anonymous. */
+};
+
+/* Bind the given loop device to `node' (which must be a regular file or
+ * a block-device file), using the given offset, size limit and flags.
+ * @param: flags: Set of `LO_FLAGS_*' (`LO_FLAGS_READ_ONLY' is set automatically
+ *                when `node' can't be written to)
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_OBJECT_IS_BUSY: `self' is already bound, or
+ *                                                     a filesystem is mounted on it.
+ * @throw: E_INVALID_ARGUMENT: `node' is neither a regular file, nor a block device. */
+FUNDEF void KCALL
+loop_bind(struct loop_device *__restrict self,
+          struct inode *__restrict node,
+          pos_t offset, pos_t limit, u32 flags);
+
+/* Unbind the backing INode of `self'.
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_OBJECT_IS_BUSY: A filesystem is mounted on `self'. */
+FUNDEF void KCALL loop_unbind(struct loop_device *__restrict self);
+
+/* Construct an anonymous (unregistered) loop device bound to `node'.
+ * This is used to automatically set up a loop device when `mount()'
+ * is given a regular file as source, and the binding will be released
+ * alongside the loop device once the mounted filesystem is destroyed. */
+FUNDEF ATTR_RETNONNULL REF struct block_device *KCALL
+loop_open_anonymous(struct inode *__restrict node, bool read_only);
+
+/* Lookup, or create and register `/dev/loop<number>' */
+FUNDEF ATTR_RETNONNULL REF struct loop_device *KCALL
+loop_lookup(u32 number, bool create);
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_INCLUDE_FS_LOOP_H */
@@ -744,6 +744,8 @@ struct directory_node {
     REF struct directory_entry      **d_map;      /* [0..1][lock(d_node.i_lock)][1..d_mask+1][owned] Hash-map of directory entries. */
     struct directory_entry           *d_bypos;    /* [lock(d_node.i_lock)][0..1] Chain of all known directory entries, ordered by address. */
     struct directory_entry           *d_bypos_end;/* [lock(d_node.i_lock)][0..1] Last directory entry that marks the end of the directory. */
+    ATOMIC_DATA u32                   d_version;  /* [lock(WRITE(d_node.i_lock))] Incremented every time a new entry is added
+                                                   * to the directory. Used to validate negative path cache entries. */
 };
 
 struct symlink_node {
@@ -37,8 +37,32 @@ struct superblock;
 struct vfs;
 
 
-#define CONFIG_PATH_CHILD_MAPSIZE   4
-#define CONFIG_VFS_RECENT_CACHESIZE 32
+#ifndef CONFIG_PATH_CHILD_MAPSIZE
+#define CONFIG_PATH_CHILD_MAPSIZE   4  /* Initial (inline) size of the child hash-map of a path. */
+#endif
+#ifndef CONFIG_PATH_NEGATIVE_MAX
+#define CONFIG_PATH_NEGATIVE_MAX    16 /* Max number of negative entries cached per directory path. */
+#endif
+#ifndef CONFIG_VFS_RECENT_CACHESIZE
+#define CONFIG_VFS_RECENT_CACHESIZE 64
+#endif
+
+
+/* A negative path cache entry (remembers a name that doesn't exist) */
+struct path_negative {
+    struct path_negative           *pn_next;     /* [0..1][lock(:p_directory.d_lock)] Next negative entry. */
+    struct directory_node          *pn_node;     /* [1..1][const] The directory node in which the lookup failed.
+                                                  *  The entry is ignored if the path no longer points to this node. */
+    uintptr_t                       pn_hash;     /* [const] Hash of the name (s.a. `directory_entry_hash()') */
+    u32                             pn_version;  /* [const] Value of `d_version' of the directory
+                                                  *  node at the time the lookup failed. The entry is
+                                                  *  stale once that counter has changed. */
+    u16                             pn_namelen;  /* [const] Length of the name (in characters). */
+#define PATH_NEGATIVE_FNORMAL       0x0000       /* The name isn't matched by `directory_getentry()' */
+#define PATH_NEGATIVE_FNOCASE       0x0001       /* The name isn't matched by `directory_getcaseentry()' either. */
+    u16                             pn_flags;    /* [const] Set of `PATH_NEGATIVE_F*' */
+    char                            pn_name[1];  /* [const][pn_namelen] Name that wasn't found. */
+};
 
 
 
@@ -71,9 +95,19 @@ struct path {
     struct {
         atomic_rwlock_t             d_lock;      /* [order(AFTER(:p_lock))]
                                                   * Lock for this directory. */
-        WEAK struct path           *d_child[CONFIG_PATH_CHILD_MAPSIZE];
-                                                 /* [0..1][*][lock(d_lock)]
-                                                  * Hash-map of child paths (using `->p_dirent->de_hash' as hash) */
+        size_t                      d_mask;      /* [!0][lock(d_lock)] Hash-mask of `d_child' */
+        size_t                      d_size;      /* [lock(d_lock)] Number of child paths in `d_child' */
+        WEAK struct path          **d_child;     /* [0..1][*][1..d_mask+1][lock(d_lock)][owned_if(!= d_inline)]
+                                                  * Hash-map of child paths (using `->p_dirent->de_hash' as hash)
+                                                  * Initially points to `d_inline', and is re-allocated
+                                                  * as more and more child paths are added. */
+        WEAK struct path           *d_inline[CONFIG_PATH_CHILD_MAPSIZE];
+                                                 /* [0..1][*][lock(d_lock)] Inline child hash-map. */
+        struct path_negative       *d_negative;  /* [0..1][owned][lock(d_lock)] Chain of negative entries
+                                                  * (most recent first) for names that were looked up
+                                                  * through `path_child()', but didn't exist. */
+        size_t                      d_negcount;  /* [<= CONFIG_PATH_NEGATIVE_MAX][lock(d_lock)]
+                                                  *  Number of negative entries in `d_negative' */
     }                               p_directory; /* Directory children. */
     u16                             p_recent;    /* [lock(:v_recent.r_lock)] Recently-used counter.
                                                   * NOTE: The recently-used system mirrors the
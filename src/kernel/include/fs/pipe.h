@@ -23,7 +23,7 @@
 #include <kos/types.h>
 #include <hybrid/sync/atomic-rwlock.h>
 #include <sched/signal.h>
-#include <fs/ringbuffer.h>
+#include <fs/pipebuffer.h>
 
 DECL_BEGIN
 
@@ -33,7 +33,7 @@ DECL_BEGIN
 
 struct pipe {
     ATOMIC_DATA ref_t p_refcnt; /* Pipe reference counter. */
-    struct ringbuffer p_buffer; /* Ring buffer for pipe data. */
+    struct pipebuffer p_buffer; /* Page buffer for pipe data. */
 };
 
 /* Increment/decrement the reference counter of the given pipe `x' */
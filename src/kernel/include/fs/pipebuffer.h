@@ -0,0 +1,197 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_INCLUDE_FS_PIPEBUFFER_H
+#define GUARD_KERNEL_INCLUDE_FS_PIPEBUFFER_H 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/limits.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <hybrid/sync/atomic-rwlock.h>
+#include <sched/signal.h>
+#include <sched/mutex.h>
+#include <fs/iomode.h>
+
+/* Page-granular pipe buffer.
+ * Unlike `struct ringbuffer', data is stored as a queue of (page,offset,length)
+ * tuples, where pages are reference counted. This allows data to be moved
+ * (`splice()'), or shared (`tee()') between pipe buffers without copying it. */
+
+DECL_BEGIN
+
+#define PIPE_PAGESIZE  PAGESIZE /* Size of a single pipe data page. */
+
+#ifdef __CC__
+struct pipe_page {
+    ATOMIC_DATA ref_t pp_refcnt;               /* Reference counter (Greater than one if shared by `tee()') */
+    byte_t            pp_data[PIPE_PAGESIZE];  /* Page data. */
+};
+
+/* Allocate a new pipe page (with a reference counter of ONE(1)) */
+FUNDEF ATTR_RETNONNULL REF struct pipe_page *KCALL pipe_page_alloc(void);
+/* Destroy a previously allocated pipe page. */
+FUNDEF ATTR_NOTHROW void KCALL pipe_page_destroy(struct pipe_page *__restrict self);
+
+/* Increment/decrement the reference counter of the given pipe_page `x' */
+#define pipe_page_incref(x)  ATOMIC_FETCHINC((x)->pp_refcnt)
+#define pipe_page_decref(x) (ATOMIC_DECFETCH((x)->pp_refcnt) || (pipe_page_destroy(x),0))
+
+
+struct pipe_slot {
+    REF struct pipe_page *ps_page;   /* [1..1] The page containing data. */
+    size_t                ps_offset; /* Offset into `ps_page->pp_data' of the first byte. */
+    size_t                ps_length; /* [!0] Number of bytes of data. */
+};
+
+/* Max number of slots that may be used by a pipe buffer with the given limit.
+ * Twice as many as there are pages, so that partially filled pages that were
+ * moved from another pipe don't immediately cause the buffer to be full. */
+#define PIPEBUFFER_MAXSLOTS(limt) \
+  (((limt)+(PIPE_PAGESIZE-1))/PIPE_PAGESIZE*2)
+
+/* Data blocks smaller than this are copied, rather than shared by `pipebuffer_splice()' */
+#ifndef CONFIG_PIPEBUFFER_SHARE_THRESHOLD
+#define CONFIG_PIPEBUFFER_SHARE_THRESHOLD  (PIPE_PAGESIZE/8)
+#endif
+
+/* The max limit that may be set for a pipe buffer using `pipebuffer_setlimit()' */
+#ifndef CONFIG_PIPE_MAX_LIMIT
+#define CONFIG_PIPE_MAX_LIMIT  0x100000
+#endif
+
+struct pipebuffer {
+    mutex_t               pb_rlock;  /* Lock held by the consumer (Serializes reading, `splice()' and `tee()' from this buffer) */
+    mutex_t               pb_wlock;  /* Lock held by the producer (Serializes writing and `splice()' into this buffer)
+                                      * NOTE: When both are needed, `pb_rlock' must be acquired first. */
+    atomic_rwlock_t       pb_lock;   /* Lock for the slot vector.
+                                      * NOTE: This lock is never held while copying data. */
+    struct pipe_slot     *pb_slotv;  /* [lock(pb_lock)][0..pb_slotm+1][owned] Ring-vector of data slots. */
+    size_t                pb_slotm;  /* [lock(pb_lock)] Mask for indices into `pb_slotv' (Vector length - 1) */
+    size_t                pb_first;  /* [lock(pb_lock)][<= pb_slotm] Index of the first used slot. */
+    size_t                pb_count;  /* [lock(pb_lock)] Number of used slots. */
+    size_t                pb_size;   /* [lock(pb_lock)] Total number of buffered bytes. */
+    size_t                pb_unread; /* [lock(pb_lock)] Number of bytes directly in front of the first slot that can be unread. */
+    REF struct pipe_page *pb_spare;  /* [lock(pb_lock)][0..1] A spare page that is re-used before allocating a new one. */
+#define PIPEBUFFER_LIMT_FMASK   (~3ul) /* Mask for the buffer limit. */
+#define PIPEBUFFER_LIMT_FCLOSED   0x2  /* [lock(WEAK(WRITE_ONCE))] The buffer was closed. */
+    size_t                pb_limt;   /* [lock(pb_lock)] The max number of bytes that may be buffered. */
+    struct sig            pb_stat;   /* Signal broadcast to notify the following state changes:
+                                      *   - The buffer was closed -> BROADCAST(*)
+                                      *   - Data was written to an empty buffer -> BROADCAST(*)
+                                      *   - Data was read from a full buffer -> BROADCAST(PIPEBUF_STATE_CHANNEL_NOTFULL)
+                                      *   - The buffer is empty -> BROADCAST(PIPEBUF_STATE_CHANNEL_EMPTY) */
+};
+
+#define PIPEBUF_STATE_CHANNEL_NOTFULL 0x1 /* Channel mask broadcast after data was read from a full buffer. */
+#define PIPEBUF_STATE_CHANNEL_EMPTY   0x2 /* Channel mask broadcast when the buffer becomes empty. */
+
+#define pipebuffer_init(self,limt) \
+    (mutex_init(&(self)->pb_rlock),mutex_init(&(self)->pb_wlock), \
+     atomic_rwlock_init(&(self)->pb_lock),(self)->pb_slotv = NULL, \
+    (self)->pb_slotm = (self)->pb_first = (self)->pb_count = 0, \
+    (self)->pb_size = (self)->pb_unread = 0,(self)->pb_spare = NULL, \
+    (self)->pb_limt = (limt) & PIPEBUFFER_LIMT_FMASK, \
+     sig_init(&(self)->pb_stat))
+
+/* Finalize a given pipe buffer. */
+FUNDEF ATTR_NOTHROW void KCALL pipebuffer_fini(struct pipebuffer *__restrict self);
+
+/* Close the buffer and wake all blocking readers/writers. */
+FUNDEF ATTR_NOTHROW bool KCALL pipebuffer_close(struct pipebuffer *__restrict self);
+
+/* Return the number of buffered bytes.
+ * WARNING: By the time this function returns, the
+ *          returned value may no longer be up-to-date. */
+FUNDEF ATTR_NOTHROW WEAK size_t KCALL pipebuffer_size(struct pipebuffer *__restrict self);
+
+/* Get/Set the max number of bytes that may be buffered.
+ * `new_limit' is rounded up to a multiple of `PIPE_PAGESIZE'
+ * @return: * : The new (actual) buffer limit.
+ * @throw: E_INVALID_ARGUMENT: `new_limit' is greater than `CONFIG_PIPE_MAX_LIMIT'
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_OBJECT_IS_BUSY: More than `new_limit' bytes are currently buffered. */
+FUNDEF ATTR_NOTHROW WEAK size_t KCALL pipebuffer_getlimit(struct pipebuffer *__restrict self);
+FUNDEF size_t KCALL pipebuffer_setlimit(struct pipebuffer *__restrict self, size_t new_limit);
+
+/* Try to un-read up to `num_bytes' bytes and return how much could actually be unread.
+ * NOTE: Data can only be unread from the page of the first slot. */
+FUNDEF size_t KCALL pipebuffer_unread(struct pipebuffer *__restrict self, size_t num_bytes);
+/* Try to un-write up to `num_bytes' bytes and return how much could actually be unwritten. */
+FUNDEF size_t KCALL pipebuffer_unwrite(struct pipebuffer *__restrict self, size_t num_bytes);
+/* Discard up to `num_bytes' bytes of previously written data as though it was read.
+ * Return the actual amount of bytes discarded. */
+FUNDEF size_t KCALL pipebuffer_discard(struct pipebuffer *__restrict self, size_t num_bytes);
+
+
+/* Callbacks used to produce data for, or consume data from a pipe buffer.
+ * @return: * : The number of bytes produced/consumed.
+ *              When less than `num_bytes', the operation stops. */
+typedef size_t (KCALL *pipebuffer_produce_t)(void *arg, byte_t *__restrict dst, size_t num_bytes);
+typedef size_t (KCALL *pipebuffer_consume_t)(void *arg, byte_t const *__restrict src, size_t num_bytes);
+
+/* Produce up to `num_bytes' bytes of data by invoking `func' to fill in
+ * pipe pages directly, and return the number of bytes produced.
+ * Unless `IO_NONBLOCK' is passed, block until at least some data
+ * can be written, or the buffer is closed.
+ * NOTE: `func' is invoked without any lock other than `pb_wlock' held,
+ *        meaning that it may block, or fault on user-space memory. */
+FUNDEF size_t KCALL
+pipebuffer_produce(struct pipebuffer *__restrict self, size_t num_bytes,
+                   iomode_t mode, pipebuffer_produce_t func, void *arg);
+
+/* Consume up to `num_bytes' bytes of data by invoking `func' with the data
+ * of pipe pages directly, and return the number of bytes consumed.
+ * Unless `IO_NONBLOCK' is passed, block until at least some data
+ * can be read, or the buffer is closed.
+ * NOTE: `func' is invoked without any lock other than `pb_rlock' held. */
+FUNDEF size_t KCALL
+pipebuffer_consume(struct pipebuffer *__restrict self, size_t num_bytes,
+                   iomode_t mode, pipebuffer_consume_t func, void *arg);
+
+/* Read/Write data to/from user-space buffers.
+ * Same semantics as the equivalent `ringbuffer_*' functions.
+ * @throw: E_INTERRUPT: The calling thread was interrupted.
+ * @throw: E_SEGFAULT:  A faulty buffer was given. */
+FUNDEF size_t KCALL pipebuffer_read(struct pipebuffer *__restrict self, USER CHECKED void *buf, size_t num_bytes, iomode_t mode);
+FUNDEF size_t KCALL pipebuffer_readv(struct pipebuffer *__restrict self, USER CHECKED struct iovec const *iov, size_t iov_offset, size_t num_bytes, iomode_t mode);
+FUNDEF size_t KCALL pipebuffer_write(struct pipebuffer *__restrict self, USER CHECKED void const *buf, size_t num_bytes, iomode_t mode);
+FUNDEF size_t KCALL pipebuffer_writev(struct pipebuffer *__restrict self, USER CHECKED struct iovec const *iov, size_t iov_offset, size_t num_bytes, iomode_t mode);
+
+/* Transfer up to `num_bytes' bytes from `src' to `dst' without copying them
+ * (Pages are shared between the two buffers, and only small fragments are copied)
+ * @param: keep: When true, don't consume data from `src' (`tee()')
+ *               Otherwise, data is moved from `src' to `dst' (`splice()')
+ * Unless `IO_NONBLOCK' is passed, block until at least some data could be
+ * transferred, `src' was closed while empty, or `dst' was closed.
+ * @throw: E_INVALID_ARGUMENT: `src' and `dst' are the same buffer. */
+FUNDEF size_t KCALL
+pipebuffer_splice(struct pipebuffer *__restrict dst,
+                  struct pipebuffer *__restrict src,
+                  size_t num_bytes, iomode_t mode, bool keep);
+
+/* Asynchronously wait for a read/write operation to become non-blocking:
+ *   - Specify `POLLIN' to poll for `pipebuffer_read()'
+ *   - Specify `POLLOUT' to poll for `pipebuffer_write()'
+ * @param: mode: Set of `POLLIN|POLLOUT' from <bits/poll.h>
+ * @return: * :  Set of `POLLIN|POLLOUT|POLLHUP' */
+FUNDEF unsigned int KCALL pipebuffer_poll(struct pipebuffer *__restrict self, unsigned int mode);
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_INCLUDE_FS_PIPEBUFFER_H */
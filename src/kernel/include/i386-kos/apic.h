@@ -283,6 +283,11 @@ DATDEF VIRT volatile byte_t *const x86_lapic_base_address;      /* [const] Virtu
  *       as fair and consistent as possible. */
 DATDEF ATTR_PERCPU volatile u32 x86_lapic_timer_freq;
 
+/* The frequency of the CPU's TSC (in ticks per second), as measured
+ * during LAPIC timer calibration. ZERO if it couldn't be determined.
+ * The value of the boot CPU is used for `cputime_hz' (s.a. <sched/cputime.h>) */
+DATDEF ATTR_PERCPU u64 x86_tsc_freq;
+
 /* [valid_if(X86_HAVE_LAPIC)] The LAPIC ID of the controller associated with the CPU. */
 DATDEF ATTR_PERCPU u8 const x86_lapic_id;
 
@@ -66,6 +66,7 @@ struct cpu_cpuid {
     u32               ci_7b;           /* [const][== cpuid(7,0).EBX] Set of `CPUID_7B_*' */
     u32               ci_80000001c;    /* [const][== cpuid(0x80000001).ECX] Set of `CPUID_80000001C_*' */
     u32               ci_80000001d;    /* [const][== cpuid(0x80000001).EDX] Set of `CPUID_80000001D_*' */
+    u32               ci_80000007d;    /* [const][== cpuid(0x80000007).EDX] Set of `CPUID_80000007D_*' */
     union PACKED {
         struct PACKED {
             u32       ci_0b;           /* [const][== cpuid(0).EBX] */
@@ -122,6 +122,9 @@ typedef PHYS u64               vm_phys_t;  /* A physical memory pointer. */
                                        * NOTE: Use of this requires the `CR4_PSE' bit to be set. */
 #define X86_PAGE_FDIRTY    0x00000040 /* The page has been written to. */
 #define X86_PAGE_FACCESSED 0x00000020 /* The page has been read from, or written to. */
+#define X86_PAGE_FPCD      0x00000010 /* Page-level cache disable (Selects bit#1 of the PAT index). */
+#define X86_PAGE_FPWT      0x00000008 /* Page-level write-through (Selects bit#0 of the PAT index). */
+#define X86_PAGE_FCACHEMASK 0x00000018 /* Mask of memory-type bits (Never inherited by E2 entries describing E1 vectors). */
 #define X86_PAGE_FUSER     0x00000004 /* User-space may access this page (read, or write). */
 #define X86_PAGE_FWRITE    0x00000002 /* The page is writable. */
 #define X86_PAGE_FPRESENT  0x00000001 /* The page is present (When not set, cause a PAGEFAULT that may be used for allocate/load-on-read). */
@@ -270,6 +273,11 @@ FORCELOCAL void KCALL pagedir_set(PHYS pagedir_t *__restrict value) {
  __asm__("movl %0, %%cr3" : : "r" (value) : "memory");
 }
 
+/* Switch to the page directory of the given VM.
+ * NOTE: i386 doesn't have PCIDs, so this is the same as `pagedir_set()' */
+#define pagedir_setvm(self) \
+        pagedir_set((pagedir_t *)(uintptr_t)(self)->vm_physdir)
+
 FUNDEF ATTR_NOTHROW bool KCALL pagedir_haschanged(vm_vpage_t vpage);
 FUNDEF ATTR_NOTHROW void KCALL pagedir_unsetchanged(vm_vpage_t vpage);
 #endif /* __CC__ */
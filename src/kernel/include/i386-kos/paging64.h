@@ -186,6 +186,9 @@ typedef PHYS u64 vm_phys_t;  /* A physical memory pointer. */
 #endif /* !CONFIG_NO_GIGABYTE_PAGES */
 #define X86_PAGE_FDIRTY    __UINT64_C(0x0000000000000040) /* The page has been written to. */
 #define X86_PAGE_FACCESSED __UINT64_C(0x0000000000000020) /* The page has been read from, or written to. */
+#define X86_PAGE_FPCD      __UINT64_C(0x0000000000000010) /* Page-level cache disable (Selects bit#1 of the PAT index). */
+#define X86_PAGE_FPWT      __UINT64_C(0x0000000000000008) /* Page-level write-through (Selects bit#0 of the PAT index). */
+#define X86_PAGE_FCACHEMASK __UINT64_C(0x0000000000000018) /* Mask of memory-type bits (Never inherited by entries describing lower-level vectors). */
 #define X86_PAGE_FUSER     __UINT64_C(0x0000000000000004) /* User-space may access this page (read, or write). */
 #define X86_PAGE_FWRITE    __UINT64_C(0x0000000000000002) /* The page is writable. */
 #define X86_PAGE_FPRESENT  __UINT64_C(0x0000000000000001) /* The page is present (When not set, cause a PAGEFAULT that may be used for allocate/load-on-read). */
@@ -400,6 +403,19 @@ FORCELOCAL PHYS pagedir_t *KCALL pagedir_get(void) {
 FORCELOCAL void KCALL pagedir_set(PHYS pagedir_t *__restrict value) {
  __asm__("movq %0, %%cr3" : : "r" (value) : "memory");
 }
+
+/* Additional CR3 bits when PCIDs are enabled (`CR4_PCIDE') */
+#define X86_CR3_FPCID    __UINT64_C(0x0000000000000fff) /* Mask for the PCID used to tag TLB entries. */
+#define X86_CR3_FNOFLUSH __UINT64_C(0x8000000000000000) /* Don't flush TLB entries tagged with the new PCID. */
+
+struct vm;
+/* Switch to the page directory of the given VM.
+ * Unlike `pagedir_set()', this function is PCID-aware and
+ * will re-use TLB entries still cached for `self' from the
+ * last time it was active on the calling CPU.
+ * The caller must disable preemption, and `self' should
+ * be `THIS_VM' (or about to become `THIS_VM'). */
+FUNDEF NOIRQ ATTR_NOTHROW void KCALL pagedir_setvm(struct vm *__restrict self);
 #else
 FORCELOCAL PHYS pagedir_t *KCALL pagedir_get(void) {
  pagedir_t *result;
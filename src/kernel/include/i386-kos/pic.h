@@ -21,6 +21,7 @@
 
 #include <hybrid/compiler.h>
 #include <kos/types.h>
+#include <stdbool.h>
 #include <sys/io.h>
 #include "interrupt.h"
 
@@ -72,6 +73,30 @@ struct x86_spurious_interrupts {
  *    wrong time, or for tracking problems in hardware, such as line noise. */
 DATDEF ATTR_PERCPU struct x86_spurious_interrupts x86_spurious_interrupts;
 
+/* Amount of interrupts dispatched to handlers installed
+ * with `x86_pic_sethandler()', indexed by PIC line. */
+DATDEF ATTR_PERCPU u32 x86_pic_interrupts[16];
+
+
+/* Dynamically installed handlers for PIC interrupt lines not
+ * already serviced by a dedicated, statically linked handler.
+ * >> Used by drivers for PCI devices, which are wired to one
+ *    of the free lines of the PIC (s.a. `PCI_GDEV3C_IRQLINE()')
+ * The handler is invoked with interrupts disabled, and the
+ * EOI command is sent to the PIC(s) after it returns.
+ * NOTE: Handlers for level-triggered lines must acknowledge the
+ *       interrupt with their device before returning.
+ * @param: line:   The PIC line number (0..15)
+ * @return: true:  The handler was installed.
+ * @return: false: The line is already in use by another handler. */
+typedef void (KCALL *x86_pic_handler_t)(void *arg);
+FUNDEF bool KCALL x86_pic_sethandler(u8 line, x86_pic_handler_t func, void *arg);
+
+/* Remove a handler previously installed by `x86_pic_sethandler()'.
+ * Once this function returns, the handler is guarantied not to
+ * be executing on any CPU, and will not be invoked again. */
+FUNDEF void KCALL x86_pic_delhandler(u8 line, x86_pic_handler_t func, void *arg);
+
 
 /* Get/Set the mask of disabled interrupt lines.
  * >> `INTNO_PIC1_STMASK()' disables irq_t: 0x20...0x27
@@ -90,6 +90,18 @@ page_malloc_part(size_t min_pages, size_t max_pages,
                  size_t *__restrict res_pages,
                  mzone_t max_zone);
 
+/* Try to allocate `num_pages' continuous pages of physical memory,
+ * such that the returned page number is aligned by `num_pages'.
+ * Unlike `page_malloc()', this function doesn't throw an error
+ * when no such range exists, but returns `(pageptr_t)-1' instead.
+ * This is used to allocate huge pages, where failure isn't fatal
+ * because the caller can always fall back to using regular pages.
+ * @assume(IS_POWER_OF_TWO(num_pages));
+ * @return: * :            The page number of the newly allocated memory range.
+ * @return: (pageptr_t)-1: No suitably aligned range of memory is available. */
+FUNDEF ATTR_NOTHROW pageptr_t KCALL
+page_trymalloc_aligned(size_t num_pages, mzone_t max_zone);
+
 /* Free a given physical address range.
  * The caller is responsible to ensure that the
  * given range has previously been allocated. */
@@ -66,6 +66,13 @@ pagedir_init(VIRT pagedir_t *__restrict self,
 /* Finalize a given page directory. */
 FUNDEF ATTR_NOTHROW void KCALL pagedir_fini(VIRT pagedir_t *__restrict self);
 
+/* [const] The number of pages making up a huge page, or ZERO(0) if the host doesn't support them.
+ * `pagedir_map()' automatically uses huge pages for user-space mappings
+ *  when both the virtual and physical address are aligned by this many pages,
+ *  and transparently splits them again when only a portion is re-mapped.
+ *  On X86, this is 4MiB (1024 pages) with PSE, or 2MiB (512 pages) on x86_64. */
+DATDEF size_t const pagedir_hugepages;
+
 
 /* WARNING: If the host does not support some combination of permission
  *          bits, more permissions than specified may be granted.
@@ -77,6 +84,19 @@ FUNDEF ATTR_NOTHROW void KCALL pagedir_fini(VIRT pagedir_t *__restrict self);
 #define PAGEDIR_MAP_FUSER  0x0008 /* Permission bit: Permit the user access to the mapping. */
 #define PAGEDIR_MAP_FUNMAP 0x1000 /* Delete the mapping (permission bits are ignored) */
 
+/* Memory type used for accessing the mapping.
+ * WARNING: If the host doesn't support some memory type, the next-best
+ *          type that is at least as strictly ordered will be used instead.
+ *          For example: On X86 without PAT, write-combining falls back to uncached.
+ * NOTE: Only physical memory mappings of device memory should use anything
+ *       other than `PAGEDIR_MAP_FMEMTYPE_WB'. Mapping the same physical
+ *       memory using different memory types causes undefined behavior. */
+#define PAGEDIR_MAP_FMEMTYPE    0x0030 /* Mask for the memory type. */
+#define PAGEDIR_MAP_FMEMTYPE_WB 0x0000 /* Write-back (default; normal, cacheable memory). */
+#define PAGEDIR_MAP_FMEMTYPE_WC 0x0010 /* Write-combining (uncached, but writes may be buffered; e.g.: framebuffers). */
+#define PAGEDIR_MAP_FMEMTYPE_UC 0x0020 /* Uncached (strongly ordered; e.g.: device registers). */
+#define PAGEDIR_MAP_FMEMTYPE_WT 0x0030 /* Write-through (reads are cached; writes go straight to memory). */
+
 /* Create/delete a page-directory mapping.
  * @param: perm: A set of `PAGEDIR_MAP_F*' detailing how memory should be mapped.
  * @throw E_BADALLOC: Not enough available memory.
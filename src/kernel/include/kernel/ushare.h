@@ -101,11 +101,17 @@ DECL_BEGIN
  */
 
 struct vm_region;
+struct task;
 
 /* Lookup a user-share segment, given its `name'.
  * @throw: E_INVALID_ARGUMENT: The given `name' does not refer to a known ushare segment. */
 FUNDEF ATTR_RETNONNULL REF struct vm_region *KCALL ushare_lookup(u32 name);
 
+/* Refresh the per-process page of the `USHARE_PROCINFO_FNAME' segment of
+ * the process that `process' is apart of, after its parent, process group
+ * or session has changed. Does nothing if that process never mapped it. */
+FUNDEF void KCALL ushare_procinfo_update(struct task *__restrict process);
+
 DECL_END
 
 #endif /* !GUARD_KERNEL_INCLUDE_KERNEL_USHARE_H */
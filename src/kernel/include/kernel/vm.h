@@ -231,6 +231,18 @@ struct vio_ops {
 #if __SIZEOF_POINTER__ >= 8
     u64  (KCALL *v_atomic_cmpxchq)(void *closure, uintptr_t addr, u64 old_value, u64 new_value);
 #endif
+    /* [0..1] Optional bulk operators, used to emulate string instructions
+     *        (`rep movs', `rep stos', ...) by transferring whole blocks of
+     *        memory at once, rather than invoking the operators above once
+     *        for every element. When missing, the regular read/write operators
+     *        are used instead (s.a. `vio_copyfrom()', `vio_copyto()', `vio_fill()')
+     * @param: addr:      The offset into the region where the transfer starts.
+     * @param: num_bytes: The number of bytes to transfer (Never ZERO(0)).
+     * NOTE: `v_fill' repeats the `pattern_size' (1/2/4/8) byte large `pattern'
+     *        until `num_bytes' (a multiple of `pattern_size') bytes were written. */
+    void (KCALL *v_read)(void *closure, uintptr_t addr, void *__restrict buf, size_t num_bytes);
+    void (KCALL *v_write)(void *closure, uintptr_t addr, void const *__restrict buf, size_t num_bytes);
+    void (KCALL *v_fill)(void *closure, uintptr_t addr, void const *__restrict pattern, size_t pattern_size, size_t num_bytes);
 };
 
 /* VIO Operator invocation.
@@ -269,6 +281,16 @@ FUNDEF u32 KCALL vio_atomic_cmpxchl(struct vio_ops *__restrict ops, void *closur
 FUNDEF u64 KCALL vio_atomic_cmpxchq(struct vio_ops *__restrict ops, void *closure, uintptr_t addr, u64 old_value, u64 new_value);
 #endif
 
+/* Bulk VIO transfers, as used to emulate string instructions.
+ * These use the `v_read', `v_write' and `v_fill' operators when available,
+ * and fall back to invoking the regular operators for every `elem_size'
+ * (1/2/4/8) bytes large element when they're not.
+ * @throw: E_INVALID_ALIGNMENT: [fallback] The given address is miss-aligned.
+ * @throw: E_NOT_IMPLEMENTED:   Cannot perform the memory lookup. */
+FUNDEF void KCALL vio_copyfrom(struct vio_ops *__restrict ops, void *closure, uintptr_t addr, void *__restrict buf, size_t elem_size, size_t num_bytes);
+FUNDEF void KCALL vio_copyto(struct vio_ops *__restrict ops, void *closure, uintptr_t addr, void const *__restrict buf, size_t elem_size, size_t num_bytes);
+FUNDEF void KCALL vio_fill(struct vio_ops *__restrict ops, void *closure, uintptr_t addr, void const *__restrict pattern, size_t pattern_size, size_t num_bytes);
+
 #endif /* __CC__ */
 #endif /* !CONFIG_NO_VIO */
 
@@ -379,6 +401,13 @@ typedef ssize_t (KCALL *pregionctl)(struct vm_region *__restrict self,
 #define VM_REGION_FNORMAL                0x0000     /* [const] Normal region flags. */
 #define VM_REGION_FMONITOR               0x0001     /* [const] Monitor attempts to write to data in the region and
                                                      *         set the `VM_PART_FCHANGED' flag of changed parts. */
+#define VM_REGION_FMEMTYPE               0x0300     /* [const] Mask for the memory type used to map the region (One of `VM_REGION_FMEMTYPE_*')
+                                                     *  NOTE: Only meaningful for `VM_REGION_PHYSICAL' regions describing device memory. */
+#define VM_REGION_FMEMTYPE_WB            0x0000     /* [const] Write-back (default) */
+#define VM_REGION_FMEMTYPE_WC            0x0100     /* [const] Write-combining (Use this for framebuffers) */
+#define VM_REGION_FMEMTYPE_UC            0x0200     /* [const] Uncached (Use this for device registers) */
+#define VM_REGION_FMEMTYPE_WT            0x0300     /* [const] Write-through */
+#define VM_REGION_PAGEDIR_MEMTYPE(flags) (((flags)&VM_REGION_FMEMTYPE) >> 4) /* Convert to `PAGEDIR_MAP_FMEMTYPE_*' */
 #define VM_REGION_FCANTSHARE             0x0800     /* [const] `PROT_SHARED' cannot be used to prevent copy-on-write. */
 #define VM_REGION_FIMMUTABLE             0x1000     /* [const] The region cannot be unmapped (Only set for kernel core regions). */
 #define VM_REGION_FDONTMERGE             0x2000     /* [const] Never merge this region with neighboring regions.
@@ -691,6 +720,10 @@ typedef void *(KCALL *vm_notify_t)(void *closure, unsigned int command,
 
 /* VM Node flags. */
 #define VM_NODE_FNORMAL                   0x0000      /* Normal node flags. */
+#define VM_NODE_FNOHUGEPAGE               0x0001      /* [lock(:vm_lock)] Don't back faults in this mapping using huge pages.
+                                                       *  Set by `MADV_NOHUGEPAGE'; cleared by `MADV_HUGEPAGE'.
+                                                       *  NOTE: This is a property of the mapping, rather than the region,
+                                                       *        since regions may be shared with other VMs after fork(). */
 #define VM_NODE_FIMMUTABLE                0x4000      /* [const] The node cannot be unmapped. */
 #define VM_NODE_FCORENODE                 0x8000      /* [const] The node was allocated using the core-base allocator. */
 
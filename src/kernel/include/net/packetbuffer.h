@@ -69,7 +69,10 @@ struct PACKED packet_header {
                             * aligned address after the payload, and spans for `p_ancillary')
                             * With that in mind:
                             * >> `p_payload + p_ancillary + sizeof(struct packet_header) <= p_total' */
-    u16     __p_pad;       /* ... */
+    u16       p_consumed;  /* Number of leading payload bytes that were already consumed by
+                            * truncating reads (`PACKET_IO_FRDIFFIT|PACKET_IO_FRDTRUNC').
+                            * Only the remaining `p_payload - p_consumed' bytes are still unread.
+                            * NOTE: The packet's memory is only released once it was fully read. */
 };
 
 union PACKED packetbuffer_state {
@@ -105,6 +108,9 @@ struct packetbuffer {
                                        *   - The buffer is empty -> BROADCAST(PBUF_STATE_CHANNEL_EMPTY)
                                        *   - The buffer is full -> BROADCAST(PBUF_STATE_CHANNEL_FULL) */
     struct sig               pb_read; /* Signal broadcast when a packet is read */
+    size_t                   pb_last; /* [lock(pb_lock)][valid_if(pb_state.pbs_count != 0)]
+                                       * Offset into `pb_base', where the most recently written packet starts.
+                                       * Since packets are read in order, this packet is always unread. */
 };
 
 #define PBUF_STATE_CHANNEL_EMPTY   0x2 /* Channel mask broadcast when the buffer becomes empty. */
@@ -120,6 +126,7 @@ struct packetbuffer {
     (self)->pb_base = NULL,(self)->pb_mask = 0, \
     (self)->pb_limt = (limt) & PBUFFER_LIMT_FMASK, \
     (self)->pb_ancillary_fini = (anc_fini), \
+    (self)->pb_last = 0, \
      sig_init(&(self)->pb_stat))
 #define packetbuffer_cinit(self,limt,anc_fini) \
     (atomic_rwlock_cinit(&(self)->pb_lock), \
@@ -136,6 +143,19 @@ FUNDEF ATTR_NOTHROW void KCALL packetbuffer_fini(struct packetbuffer *__restrict
 /* Close the buffer and wake all blocking readers/writers. */
 FUNDEF ATTR_NOTHROW bool KCALL packetbuffer_close(struct packetbuffer *__restrict self);
 
+/* Change the max length to which the packet buffer is allowed to grow.
+ * NOTE: Lowering the limit doesn't discard packets that were already written,
+ *       but simply prevents new ones from being written until enough were read.
+ * NOTE: The `PBUFFER_LIMT_F*' flags are preserved. */
+LOCAL ATTR_NOTHROW void KCALL
+packetbuffer_setlimit(struct packetbuffer *__restrict self, size_t limt) {
+ size_t old_limt;
+ do old_limt = ATOMIC_READ(self->pb_limt);
+ while (!ATOMIC_CMPXCH_WEAK(self->pb_limt,old_limt,
+                           (limt & PBUFFER_LIMT_FMASK)|
+                           (old_limt & ~PBUFFER_LIMT_FMASK)));
+}
+
 
 /* An extended variant of `packetbuffer_write()' which can be used to
  * construct a single packet with the data from more than one location.
@@ -302,16 +322,50 @@ packetbuffer_write_stream(struct packetbuffer *__restrict self,
 
 
 
+/* An extended variant of `packetbuffer_readva()' which can be used to
+ * continue filling an IO vector that was already partially filled.
+ * @param: iov_offset: Offset from the start of the iov vector, describing
+ *                     a number of bytes that should be skipped.
+ *                     This number of bytes should not be included in `*pbufsize' */
+FUNDEF bool KCALL
+packetbuffer_reada_vio(struct packetbuffer *__restrict self,
+                       USER CHECKED struct iovec const *iov,
+                       size_t iov_offset, size_t *__restrict pbufsize,
+                       HOST void *anc_buffer, size_t *__restrict pancsize,
+                       iomode_t mode, packet_iomode_t packet_mode);
+
+/* Try to append data to the most recently written packet, rather than
+ * constructing a new one. This is used to coalesce small writes to
+ * stream-oriented buffers, where packet boundaries don't matter.
+ * This function never blocks, but simply returns `false' when:
+ *   - The buffer is empty, or was closed.
+ *   - The last packet contains ancillary data.
+ *   - The resulting payload would exceed `max_payload' bytes.
+ *   - There isn't enough free buffer space to extend the packet.
+ * @return: true:  All of `num_bytes' were appended to the last packet.
+ * @return: false: Nothing was written (see above)
+ * @throw: E_SEGFAULT: The provided user-buffer is faulty. */
+FUNDEF bool KCALL
+packetbuffer_append_vio(struct packetbuffer *__restrict self,
+                        USER CHECKED struct iovec const *iov,
+                        size_t iov_offset, size_t num_bytes,
+                        size_t max_payload, iomode_t mode);
+
+
+
 /* Just as `packetbuffer_readv' is for `packetbuffer_read', allow
  * the user-space target buffer to be located in more than one place.
  * @param: anc_buffer: When `NULL', operate the same way `packetbuffer_reada()' would.
  * @param: pbufsize:   Upon entry, contains the total sum of bytes found in `iov'
  * @param: pbufsize:   Upon exit, store the total amount of required buffer space here. */
-FUNDEF bool KCALL
+FORCELOCAL bool KCALL
 packetbuffer_readva(struct packetbuffer *__restrict self,
                     USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
                     HOST void *anc_buffer, size_t *__restrict pancsize,
-                    iomode_t mode, packet_iomode_t packet_mode);
+                    iomode_t mode, packet_iomode_t packet_mode) {
+ return packetbuffer_reada_vio(self,iov,0,pbufsize,anc_buffer,
+                               pancsize,mode,packet_mode);
+}
 
 /* Read a packet including ancillary data.
  * This function differs from `packetbuffer_read()', in that the
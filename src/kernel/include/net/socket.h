@@ -680,6 +680,7 @@ FUNDEF bool KCALL socket_recvfrom(struct socket *__restrict self,
  * @throw: E_NOT_IMPLEMENTED: The socket provides no way of sending data.
  * @throw: E_NET_ERROR.ERROR_NET_SHUTDOWN:         [...]
  * @throw: E_NET_ERROR.ERROR_NET_CANNOT_RECONNECT: [...]
+ * @throw: E_NET_ERROR.ERROR_NET_BROKEN_PIPE:      The peer has closed the connection (s.a. `socket_throw_broken_pipe()')
  * @throw: E_WOULDBLOCK: `IO_NONBLOCK' was set and the operation would have blocked.
  * @throw: E_INTERRUPT:   The calling thread was interrupted.
  * @throw: E_BADALLOC:    Failed to (re-)allocate the internal packet buffer.
@@ -736,6 +737,14 @@ FUNDEF size_t KCALL socket_sendato(struct socket *__restrict self,
                                    iomode_t mode, packet_iomode_t packet_mode);
 
 
+/* Used by connection-oriented sockets to fail sending after the
+ * other end was closed: Unless `PACKET_IO_FWRNOSIGNAL' is set in
+ * `packet_mode', raise `SIGPIPE' in the calling thread, then throw
+ * an `E_NET_ERROR.ERROR_NET_BROKEN_PIPE' error (`EPIPE'). */
+FUNDEF ATTR_NORETURN void KCALL
+socket_throw_broken_pipe(packet_iomode_t packet_mode);
+
+
 DECL_END
 
 #endif /* !GUARD_KERNEL_INCLUDE_NET_SOCKET_H */
@@ -0,0 +1,221 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_INCLUDE_SCHED_CPUTIME_H
+#define GUARD_KERNEL_INCLUDE_SCHED_CPUTIME_H 1
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <hybrid/section.h>
+#include <sched/task.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <kos/intrin.h>
+#endif
+
+DECL_BEGIN
+
+/* Cycle-accurate CPU time accounting.
+ * Unlike `struct taskstat', which only counts events, CPU time
+ * is measured using the CPU's cycle counter (the TSC on X86),
+ * and is charged to one of the following buckets:
+ *   - USER:   Time spent executing user-space code.
+ *   - SYSTEM: Time spent executing kernel code on behalf of the thread.
+ *   - IRQ:    Time spent in accounted hardware interrupt handlers
+ *             that interrupted the thread (see `IRQSTAT_HARDIRQ_END()').
+ *   - WAIT:   Time the thread spent runnable, but not running.
+ * Time is charged when entering/leaving the kernel through a
+ * system call, as well as whenever the scheduler switches tasks. */
+
+#define TASKCPUTIME_OFFSETOF_USER          0
+#define TASKCPUTIME_OFFSETOF_SYSTEM        8
+#define TASKCPUTIME_OFFSETOF_IRQ           16
+#define TASKCPUTIME_OFFSETOF_WAIT          24
+#define TASKCPUTIME_OFFSETOF_STAMP         32
+#define TASKCPUTIME_OFFSETOF_EXITED_USER   40
+#define TASKCPUTIME_OFFSETOF_EXITED_SYSTEM 48
+#define TASKCPUTIME_OFFSETOF_CHILD_USER    56
+#define TASKCPUTIME_OFFSETOF_CHILD_SYSTEM  64
+#define TASKCPUTIME_SIZE                   72
+
+#define CPUCPUTIME_OFFSETOF_USER           0
+#define CPUCPUTIME_OFFSETOF_SYSTEM         8
+#define CPUCPUTIME_OFFSETOF_WAIT           16
+#define CPUCPUTIME_SIZE                    24
+
+/* Flags describing the cycle counter (`cputime_flags') */
+#define CPUTIME_FNORMAL      0x0000 /* The frequency of the cycle counter is unknown. */
+#define CPUTIME_FCALIBRATED  0x0001 /* `cputime_hz' has been calibrated. */
+#define CPUTIME_FINVARIANT   0x0002 /* The cycle counter runs at a constant rate in all power-states.
+                                     * When not set, cycle counts may not translate to wall-time
+                                     * perfectly (they are still used for accounting, though). */
+
+#ifdef __CC__
+/* Read the cycle counter used for CPU time accounting. */
+#if defined(__i386__) || defined(__x86_64__)
+#define CPUTIME_CLOCK()   __rdtsc()
+#else
+#define CPUTIME_CLOCK()   0
+#endif
+
+struct taskcputime {
+    /* All times are measured in cycles of `CPUTIME_CLOCK()'
+     * NOTE: Like `struct taskstat', these values are weak when read
+     *       by any thread other than the one they are describing.
+     *       Additionally, other threads may observe torn 64-bit
+     *       values on architectures without atomic 64-bit reads. */
+    WEAK u64                  tc_user;          /* Time spent in user-space. */
+    WEAK u64                  tc_system;        /* Time spent in kernel-space. */
+    WEAK u64                  tc_irq;           /* Time spent in hardware interrupts that interrupted this thread. */
+    WEAK u64                  tc_wait;          /* Time spent waiting to be scheduled. */
+    WEAK u64                  tc_stamp;         /* [lock(!PREEMPTION_ENABLED() && PRIVATE(t_cpu))]
+                                                 * While running: The last time that CPU time was charged.
+                                                 * While runnable: The time when the thread became runnable.
+                                                 * ZERO if the thread has never been stamped. */
+    /* Per-process totals (Only used by process leaders) */
+    WEAK u64                  tc_exited_user;   /* [lock(tg_process.h_lock)] Sum of `tc_user' of all exited secondary threads. */
+    WEAK u64                  tc_exited_system; /* [lock(tg_process.h_lock)] Sum of `tc_system' of all exited secondary threads. */
+    WEAK u64                  tc_child_user;    /* [lock(tg_process.h_cldevent)] User-time of all terminated and reaped child processes. */
+    WEAK u64                  tc_child_system;  /* [lock(tg_process.h_cldevent)] System-time of all terminated and reaped child processes. */
+};
+
+/* CPU time accounting of the calling thread.
+ * NOTE: After creation of a thread using `task_alloc()',
+ *       this structure is ZERO-initialized. */
+DATDEF ATTR_PERTASK struct taskcputime _this_cputime;
+#define THIS_CPUTIME   PERTASK(_this_cputime)
+
+struct cpucputime {
+    /* Per-CPU sums of the times charged to threads running on a CPU.
+     * NOTE: Time spent in hardware interrupts is `is_hardtime'
+     *       from `struct irqstat' (s.a. <sched/softirq.h>) */
+    WEAK u64                  cc_user;   /* Time spent running user-space code. */
+    WEAK u64                  cc_system; /* Time spent running kernel code (including the IDLE thread). */
+    WEAK u64                  cc_wait;   /* Sum of the time that threads had to wait before being run by this CPU. */
+};
+
+/* CPU time accounting of the calling CPU. */
+DATDEF ATTR_PERCPU struct cpucputime _this_cpucputime;
+#define THIS_CPUCPUTIME   PERCPU(_this_cpucputime)
+
+
+/* [const_after(cputime_calibrate)] The frequency of `CPUTIME_CLOCK()' in Hz,
+ * as measured on the boot CPU. ZERO until calibrated.
+ * This value is also exported to user-space as `pi_tschz' in `USHARE_PROCINFO_FNAME' */
+DATDEF u64 const cputime_hz;
+/* [const_after(cputime_calibrate)] Set of `CPUTIME_F*' */
+DATDEF u32 const cputime_flags;
+
+/* Set the frequency of the cycle counter (called by arch-specific boot code).
+ * @param: flags: Set of `CPUTIME_F*' (`CPUTIME_FCALIBRATED' is added automatically) */
+FUNDEF ATTR_FREETEXT void KCALL cputime_calibrate(u64 hz, u32 flags);
+
+/* Convert a cycle count to nano- or microseconds.
+ * Before calibration, cycles are returned as-is. */
+FUNDEF ATTR_PURE u64 KCALL cputime_to_nsec(u64 cycles);
+FUNDEF ATTR_PURE u64 KCALL cputime_to_usec(u64 cycles);
+
+/* Charge the time since the calling thread's last accounting point
+ * as system time, so that `THIS_CPUTIME' is up-to-date. */
+FUNDEF ASYNCSAFE void KCALL cputime_sync(void);
+
+/* Mark `thread' as runnable (used when waking a sleeping thread),
+ * meaning that time until it gets scheduled is accounted as wait time.
+ * NOTE: The caller must have preemption disabled. */
+#define cputime_wake(thread) \
+ (void)(FORTASK(thread,_this_cputime).tc_stamp = CPUTIME_CLOCK())
+
+/* Account a task switch on the calling CPU. Called by the scheduler
+ * with preemption disabled, after the context of `old_task' was saved.
+ * `old_task' is charged user- or system-time based on its saved context,
+ * while `new_task' is charged the time it spent waiting to be scheduled.
+ * NOTE: `old_task' and `new_task' may be identical. */
+FUNDEF NOIRQ void FCALL
+cputime_switch(struct task *__restrict old_task,
+               struct task *__restrict new_task);
+
+/* Same as `cputime_switch()', but the calling thread is the old task,
+ * meaning it is charged system-time and hasn't saved its context.
+ * NOTE: The caller must have preemption disabled. */
+FUNDEF NOIRQ void FCALL cputime_resume(struct task *__restrict new_task);
+
+/* Gather the CPU time used by the given process (including all of its threads),
+ * or by the terminated and reaped children of the given process.
+ * @param: leader: The leader of the process to gather information about. */
+FUNDEF void KCALL cputime_getprocess(struct task *__restrict leader, u64 *__restrict putime, u64 *__restrict pstime);
+FUNDEF void KCALL cputime_getchildren(struct task *__restrict leader, u64 *__restrict putime, u64 *__restrict pstime);
+
+#endif /* __CC__ */
+
+
+
+/* Helper macros for charging the time since the last accounting
+ * point to a given bucket of the calling thread (and CPU).
+ * Used when entering/leaving the kernel through system calls.
+ * >> CPUTIME_CHARGE(TASKCPUTIME_OFFSETOF_USER) // Entered the kernel from user-space
+ * >> CPUTIME_CHARGE(TASKCPUTIME_OFFSETOF_SYSTEM) // About to return to user-space
+ * NOTE: The field offsets of `struct cpucputime' match those of `struct taskcputime'
+ * NOTE: All registers (but not the flags) are preserved,
+ *       and interrupts are disabled during accounting. */
+#ifdef __ASSEMBLER__
+#ifdef CONFIG_NO_SMP
+#define __CPUTIME_CPUFIELD(x)  _this_cpucputime+x
+#define __CPUTIME_LOADCPU(reg) /* nothing */
+#elif defined(__x86_64__)
+#define __CPUTIME_CPUFIELD(x)  _this_cpucputime+x(%rcx)
+#define __CPUTIME_LOADCPU(reg) movq %taskseg:TASK_OFFSETOF_CPU, reg;
+#else
+#define __CPUTIME_CPUFIELD(x)  _this_cpucputime+x(%ecx)
+#define __CPUTIME_LOADCPU(reg) movl %taskseg:TASK_OFFSETOF_CPU, reg;
+#endif
+
+#ifdef __x86_64__
+#define CPUTIME_CHARGE(x) \
+    pushfq_cfi; cli; \
+    pushq_cfi %rax; pushq_cfi %rcx; pushq_cfi %rdx; \
+    rdtsc; shlq $32, %rdx; orq %rdx, %rax; \
+    movq %rax, %rdx; \
+    subq %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP, %rax; \
+    movq %rdx, %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP; \
+    addq %rax, %taskseg:_this_cputime+x; \
+    __CPUTIME_LOADCPU(%rcx) \
+    addq %rax, __CPUTIME_CPUFIELD(x); \
+    popq_cfi %rdx; popq_cfi %rcx; popq_cfi %rax; popfq_cfi
+#elif defined(__i386__)
+#define CPUTIME_CHARGE(x) \
+    pushfl_cfi; cli; \
+    pushl_cfi %eax; pushl_cfi %ecx; pushl_cfi %edx; \
+    rdtsc; \
+    pushl_cfi %edx; pushl_cfi %eax; \
+    subl %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP, %eax; \
+    sbbl %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP+4, %edx; \
+    addl %eax, %taskseg:_this_cputime+x; \
+    adcl %edx, %taskseg:_this_cputime+x+4; \
+    __CPUTIME_LOADCPU(%ecx) \
+    addl %eax, __CPUTIME_CPUFIELD(x); \
+    adcl %edx, __CPUTIME_CPUFIELD(x+4); \
+    popl_cfi %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP; \
+    popl_cfi %taskseg:_this_cputime+TASKCPUTIME_OFFSETOF_STAMP+4; \
+    popl_cfi %edx; popl_cfi %ecx; popl_cfi %eax; popfl_cfi
+#else
+#warning FIXME
+#endif
+#endif /* __ASSEMBLER__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_INCLUDE_SCHED_CPUTIME_H */
@@ -54,6 +54,10 @@ struct thread_pid {
     int                              tp_status;      /* [lock(tp_task_lock,WRITE(THIS_TASK))]
                                                       *  The wait status of this thread. */
 #endif
+    u64                              tp_utime;       /* [lock(WRITE_ONCE)] For process leaders: The total user-time (in `CPUTIME_CLOCK()' cycles) of
+                                                      *  the process (including all its threads and reaped children), written when it exits.
+                                                      *  Added to `tc_child_user' of the parent process when it reaps this child. */
+    u64                              tp_stime;       /* [lock(WRITE_ONCE)] Same as `tp_utime', but for system-time. */
     REF LIST_NODE(struct thread_pid) tp_siblings;    /* [lock(FORTASK(FORTASK(task_get_parent(),_this_group)->tg_leader,_this_group).tg_process.h_cldlock)]
                                                       * [CHAIN(FORTASK(FORTASK(task_get_parent(),_this_group)->tg_leader,_this_group).tg_process.h_children)]
                                                       * [0..1] Chain of sibling processes spawned by the parent process of the calling thread. */
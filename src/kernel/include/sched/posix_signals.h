@@ -248,6 +248,15 @@ signal_chaction_compat(int signo,
                        USER CHECKED struct sigaction_compat *old_action);
 #endif
 
+/* Connect to the signals broadcast when new signals are queued for the
+ * calling thread or its process, then check if a `SIGKILL' is pending.
+ * If it is, disconnect all signals and terminate the calling process
+ * without first returning to user-space (or serving any other signal).
+ * This is meant for waits that can't use `task_wait()', because they
+ * mustn't serve user-RPCs, yet should remain killable.
+ * NOTE: Call this before connecting to any other signal. */
+FUNDEF void KCALL signal_connect_kill(void);
+
 /* Change the signal disposition of all signal actions using
  * a user-space disposition to `SIG_DFL'. (called during exec()) */
 FUNDEF void KCALL signal_resetexec(void);
@@ -0,0 +1,125 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_INCLUDE_SCHED_SOFTIRQ_H
+#define GUARD_KERNEL_INCLUDE_SCHED_SOFTIRQ_H 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <sched/task.h>
+#include <sched/cputime.h>
+
+DECL_BEGIN
+
+/* Max number of softirqs executed by a CPU's softirq
+ * worker before it yields to other runnable threads.
+ * The worker also yields once a timer tick has passed
+ * since it started working on the current batch. */
+#ifndef CONFIG_SOFTIRQ_BATCH
+#define CONFIG_SOFTIRQ_BATCH  16
+#endif
+
+#ifdef __CC__
+typedef void (KCALL *softirq_func_t)(void *arg);
+
+struct softirq {
+    /* Descriptor for a piece of work deferred out of an interrupt handler.
+     * >> PRIVATE void KCALL ata_complete(void *arg) { ... }
+     * >> PRIVATE DEFINE_SOFTIRQ(ata_softirq,&ata_complete,NULL);
+     * >> INTERN void KCALL ata_irq(void) {
+     * >>     ... // Acknowledge the device.
+     * >>     softirq_raise(&ata_softirq);
+     * >> }
+     * NOTE: A softirq is queued at most once, no matter how often
+     *       it is raised before its callback gets invoked.
+     * NOTE: Because `SOFTIRQ_FPENDING' is cleared before the callback
+     *       is invoked, a softirq raised on different CPUs may be
+     *       executing on more than one of them at the same time. */
+    struct softirq *si_next;  /* [0..1][valid_if(SOFTIRQ_FPENDING)][lock(PRIVATE(THIS_CPU))]
+                               * Next softirq queued on the same CPU. */
+    softirq_func_t  si_func;  /* [1..1][const] The callback invoked by the softirq worker.
+                               * NOTE: This callback is executed in the context of a kernel
+                               *       thread with preemption enabled, meaning that it may
+                               *       block, but should not throw any exceptions. */
+    void           *si_arg;   /* [?..?][const] Argument passed to `si_func'. */
+#define SOFTIRQ_FNORMAL 0x0000
+#define SOFTIRQ_FPENDING 0x0001 /* The softirq has been queued for execution. */
+    ATOMIC_DATA uintptr_t si_flags; /* Set of `SOFTIRQ_F*' */
+};
+#define SOFTIRQ_INIT(func,arg)      { NULL, func, arg, SOFTIRQ_FNORMAL }
+#define DEFINE_SOFTIRQ(name,func,arg) struct softirq name = SOFTIRQ_INIT(func,arg)
+#define softirq_init(self,func,arg) \
+ (void)((self)->si_next = NULL,(self)->si_func = (func), \
+        (self)->si_arg = (arg),(self)->si_flags = SOFTIRQ_FNORMAL)
+
+/* Schedule the given softirq for execution by the calling CPU's softirq worker.
+ * NOTE: This function is ASYNC-SAFE, and is meant to be called from
+ *       interrupt handlers that want to do as little work as possible,
+ *       deferring the rest until interrupts have been re-enabled.
+ * @return: true:  The softirq was queued.
+ * @return: false: The softirq was already pending. */
+FUNDEF ASYNCSAFE bool KCALL softirq_raise(struct softirq *__restrict self);
+
+
+
+/* A cycle counter used for accounting time spent in interrupt handlers.
+ * NOTE: This must be the same clock as used for `struct taskcputime' */
+#define IRQSTAT_CLOCK()   CPUTIME_CLOCK()
+
+struct irqstat {
+    /* Per-CPU interrupt accounting (used to implement `/proc/softirqs')
+     * Just like `struct cpustat', all of these are weak. */
+    WEAK u64              is_hardtime;  /* Cycles spent in accounted hardware interrupt handlers. */
+    WEAK u64              is_softtime;  /* Cycles spent executing softirq callbacks. */
+    WEAK uintptr_t        is_hardirq;   /* Amount of accounted hardware interrupts. */
+    WEAK uintptr_t        is_raised;    /* Amount of softirqs queued on this CPU. */
+    WEAK uintptr_t        is_softirq;   /* Amount of softirqs executed on this CPU. */
+    WEAK uintptr_t        is_batches;   /* Amount of batches started by the softirq worker. */
+    WEAK uintptr_t        is_deferred;  /* Amount of batches that ran out of budget with work still pending. */
+};
+
+/* Interrupt statistics for the calling CPU. */
+DATDEF ATTR_PERCPU struct irqstat _this_irqstat;
+#define THIS_IRQSTAT   PERCPU(_this_irqstat)
+
+/* Account the time spent in a hardware interrupt handler.
+ * >> u64 start = IRQSTAT_HARDIRQ_BEGIN();
+ * >> ...
+ * >> IRQSTAT_HARDIRQ_END(start);
+ * The time is also charged as IRQ time to the interrupted thread, and
+ * excluded from its user/system time (s.a. `struct taskcputime').
+ * NOTE: Must be used with interrupts disabled. */
+#define IRQSTAT_HARDIRQ_BEGIN()     IRQSTAT_CLOCK()
+#define IRQSTAT_HARDIRQ_END(start)  irqstat_hardirq_end(start)
+
+LOCAL NOIRQ void KCALL irqstat_hardirq_end(u64 start) {
+ u64 delta = IRQSTAT_CLOCK()-start;
+ ++THIS_IRQSTAT.is_hardirq;
+ THIS_IRQSTAT.is_hardtime += delta;
+ THIS_CPUTIME.tc_irq      += delta;
+ /* Move the accounting point forward, so the time isn't charged twice. */
+ if (THIS_CPUTIME.tc_stamp)
+     THIS_CPUTIME.tc_stamp += delta;
+}
+
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_INCLUDE_SCHED_SOFTIRQ_H */
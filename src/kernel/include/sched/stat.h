@@ -38,6 +38,16 @@ DECL_BEGIN
 #define TASKSTATE_OFFSETOF_XRPC      (__SIZEOF_JTIME_T__+5*__SIZEOF_POINTER__)
 #define TASKSTATE_OFFSETOF_QRPC      (__SIZEOF_JTIME_T__+6*__SIZEOF_POINTER__)
 #define TASKSTATE_SIZE               (__SIZEOF_JTIME_T__+7*__SIZEOF_POINTER__)
+
+#define CPUSTAT_OFFSETOF_USER         0
+#define CPUSTAT_OFFSETOF_SYSTEM       __SIZEOF_POINTER__
+#define CPUSTAT_OFFSETOF_IDLE      (2*__SIZEOF_POINTER__)
+#define CPUSTAT_OFFSETOF_PGFAULT   (3*__SIZEOF_POINTER__)
+#define CPUSTAT_OFFSETOF_PGCOW     (4*__SIZEOF_POINTER__)
+#define CPUSTAT_OFFSETOF_THPALLOC  (5*__SIZEOF_POINTER__)
+#define CPUSTAT_OFFSETOF_THPFALLBACK (6*__SIZEOF_POINTER__)
+#define CPUSTAT_OFFSETOF_THPSPLIT  (7*__SIZEOF_POINTER__)
+#define CPUSTAT_SIZE               (8*__SIZEOF_POINTER__)
 #endif /* !CONFIG_NO_TASKSTAT */
 
 #ifdef __CC__
@@ -75,6 +85,24 @@ struct taskstat {
  *       tasking information is ZERO-initialized. */
 DATDEF ATTR_PERTASK struct taskstat _this_stat;
 #define THIS_STAT   PERTASK(_this_stat)
+
+struct cpustat {
+    /* Per-CPU counters (used to implement `/proc/stat' and `/proc/vmstat')
+     * Just like `struct taskstat', all of these are weak, and may be
+     * incremented by a thread that was just migrated to another CPU. */
+    WEAK uintptr_t        cs_user;    /* Amount of timer interrupts that preempted user-space. */
+    WEAK uintptr_t        cs_system;  /* Amount of timer interrupts that preempted kernel-space (including `cs_idle'). */
+    WEAK uintptr_t        cs_idle;    /* Amount of timer interrupts that occurred while the CPU was halted. */
+    WEAK uintptr_t        cs_pgfault; /* Amount of page faults handled. */
+    WEAK uintptr_t        cs_pgcow;   /* Amount of copy-on-write faults that required memory to be duplicated. */
+    WEAK uintptr_t        cs_thpalloc;    /* Amount of page faults that were handled by allocating a huge page. */
+    WEAK uintptr_t        cs_thpfallback; /* Amount of page faults that could have used a huge page, but fell back to regular pages. */
+    WEAK uintptr_t        cs_thpsplit;    /* Amount of copy-on-write faults that split a huge page, rather than duplicating all of it. */
+};
+
+/* Statistics for the calling CPU. */
+DATDEF ATTR_PERCPU struct cpustat _this_cpustat;
+#define THIS_CPUSTAT   PERCPU(_this_cpustat)
 #endif /* !CONFIG_NO_TASKSTAT */
 
 #endif /* __CC__ */
@@ -98,6 +126,32 @@ DATDEF ATTR_PERTASK struct taskstat _this_stat;
 #warning FIXME
 #endif
 
+/* Helper macro for incrementing a per-CPU statistical counter.
+ * In assembly, `reg' is clobbered to hold the CPU base address. */
+#if defined(CONFIG_NO_TASKSTAT)
+#ifdef __CC__
+#define INCCPUSTAT(x)      (void)0
+#else
+#define INCCPUSTAT(x,reg)  /* Nothing */
+#endif
+#elif !defined(__ASSEMBLER__)
+#define INCCPUSTAT(x)  (++THIS_CPUSTAT.x)
+#elif defined(CONFIG_NO_SMP)
+#ifdef __x86_64__
+#define INCCPUSTAT(x,reg)  incq _this_cpustat+x
+#else
+#define INCCPUSTAT(x,reg)  incl _this_cpustat+x
+#endif
+#elif defined(__x86_64__)
+#define INCCPUSTAT(x,reg)  movq %taskseg:TASK_OFFSETOF_CPU, reg; \
+                           incq _this_cpustat+x(reg)
+#elif defined(__i386__)
+#define INCCPUSTAT(x,reg)  movl %taskseg:TASK_OFFSETOF_CPU, reg; \
+                           incl _this_cpustat+x(reg)
+#else
+#warning FIXME
+#endif
+
 
 
 
@@ -213,6 +213,9 @@ typedef struct qtime {
                                              *                   of immediate indirection.
                                              *             NOTE: An RPC function that sets this flag is also
                                              *                   responsible to unsetting it before returning. */
+#define TASK_FVFORK              0x0040     /* [lock(THIS_TASK)] The task was created by `vfork()' (`CLONE_VFORK') and still shares
+                                             *                   its VM (and stack) with its parent, which remains suspended until
+                                             *                   this flag is cleared by `exec()', or the task terminates. */
 #define TASK_FNOHOSTSTACK        0x1000     /* [const] The task uses a custom host stack, which must not be freed during its destruction. */
 #ifdef CONFIG_VM86
 #define TASK_FVM86               0x4000     /* [lock(PRIVATE(THIS_TASK))] This task is running in VM86 mode. */
@@ -1164,6 +1167,20 @@ task_propagate_user_exception(struct cpu_hostcontext_user *__restrict context,
 FUNDEF ATTR_RETNONNULL REF struct vm *KCALL task_getvm(struct task *__restrict thread);
 FUNDEF void KCALL task_setvm(struct vm *__restrict new_vm);
 
+#ifdef CONFIG_BUILDING_KERNEL_CORE
+/* Wait for a `vfork()'-ed `child' to either terminate, or
+ * release its parent by calling `task_vfork_release()'.
+ * NOTE: This function doesn't serve RPC functions, meaning that
+ *       the parent cannot be interrupted while its child is
+ *       still running on its stack. The only exception is `SIGKILL'.
+ * @throw: E_EXIT_PROCESS: A `SIGKILL' was sent to the calling thread/process. */
+INTDEF void KCALL task_vfork_wait(struct task *__restrict child);
+/* Clear `TASK_FVFORK' and resume the vfork()-parent of the calling thread.
+ * Called by `exec()' after the caller has switched to a new VM.
+ * No-op if the calling thread wasn't created by `vfork()'. */
+INTDEF void KCALL task_vfork_release(void);
+#endif /* CONFIG_BUILDING_KERNEL_CORE */
+
 
 /* Unshare certain components of the calling thread
  * that were shared with other threads before.
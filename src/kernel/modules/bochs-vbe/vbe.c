@@ -184,6 +184,9 @@ VBE_Mmap(struct character_device *__restrict UNUSED(self),
   /* Construct a memory region for the LFB (Linear Frame Buffer). */
   result = vm_region_alloc((VBE_DISPI_TOTAL_VIDEO_MEMORY_MB * 1024 * 1024) / PAGESIZE);
   result->vr_type           = VM_REGION_PHYSICAL;
+  /* Map the LFB as write-combining, so that consecutive
+   * pixel writes get merged into burst transfers. */
+  result->vr_flags         |= VM_REGION_FMEMTYPE_WC;
   result->vr_part0.vp_state = VM_PART_INCORE;
   result->vr_part0.vp_flags = VM_PART_FKEEP|VM_PART_FWEAKREF|VM_PART_FNOSWAP;
   result->vr_part0.vp_phys.py_num_scatter = 1;
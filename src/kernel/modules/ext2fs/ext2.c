@@ -24,13 +24,18 @@
 #include <hybrid/byteswap.h>
 #include <hybrid/byteorder.h>
 #include <hybrid/align.h>
+#include <hybrid/atomic.h>
+#include <hybrid/limits.h>
+#include <hybrid/minmax.h>
 #include <fs/node.h>
 #include <fs/path.h>
 #include <fs/driver.h>
 #include <fs/iomode.h>
 #include <fs/device.h>
+#include <dev/wall.h>
 #include <kernel/debug.h>
 #include <string.h>
+#include <dirent.h>
 #include <except.h>
 
 #include "ext2.h"
@@ -112,25 +117,291 @@ Ext2_WriteINode(struct superblock *__restrict fs,
 }
 
 
+INTERN void KCALL
+Ext2_CheckWritable(struct superblock *__restrict fs) {
+ if unlikely(fs->s_fsdata->sd_flags & EXT2_FREADONLY)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_READONLY_FILESYSTEM);
+}
+
+/* Write `num_bytes' ZERO-bytes to the given on-disk location. */
+PRIVATE void KCALL
+Ext2_ZeroDisk(struct superblock *__restrict fs,
+              pos_t addr, size_t num_bytes) {
+ byte_t *EXCEPT_VAR buffer;
+ size_t bufsize = MIN(num_bytes,PAGESIZE);
+ buffer = (byte_t *)kmalloc(bufsize,GFP_SHARED|GFP_CALLOC);
+ TRY {
+  while (num_bytes) {
+   size_t part = MIN(num_bytes,bufsize);
+   if (block_device_write(fs->s_device,buffer,part,addr,IO_WRONLY) != part)
+       error_throw(E_WOULDBLOCK);
+   addr      += part;
+   num_bytes -= part;
+  }
+ } FINALLY {
+  kfree(buffer);
+ }
+}
+
+#define EXT2_BIT_GT(set,i) ((set)[(i)/8] & (1 << ((i)%8)))
+#define EXT2_BIT_ST(set,i) ((set)[(i)/8] |= (1 << ((i)%8)))
+#define EXT2_BIT_CL(set,i) ((set)[(i)/8] &= ~(1 << ((i)%8)))
+
+/* Return the block-usage (`inodes == false') or INode-usage (`inodes == true')
+ * bitset of `group', lazily reading it from disk upon first access.
+ * NOTE: The caller must be holding a write-lock on `sd_lock' */
+PRIVATE ATTR_RETNONNULL byte_t *KCALL
+Ext2_GetBitmap(struct superblock *__restrict fs,
+               struct block_group *__restrict group,
+               bool inodes) {
+ Ext2 *ext = fs->s_fsdata;
+ byte_t **pbitmap,*EXCEPT_VAR result;
+ ext2_block_t addr; size_t size;
+ assert(rwlock_writing(&ext->sd_lock));
+ assert(group->bg_flags & BLOCK_GROUP_FLOADED);
+ if (inodes) {
+  pbitmap = &group->bg_iusage;
+  addr    = group->bg_iusage_addr;
+  size    = CEILDIV(ext->sd_ino_per_bgrp,8);
+ } else {
+  pbitmap = &group->bg_busage;
+  addr    = group->bg_busage_addr;
+  size    = CEILDIV(ext->sd_blk_per_bgrp,8);
+ }
+ if ((result = *pbitmap) != NULL)
+      return result;
+ if unlikely(size > ext->sd_blocksize)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+ result = (byte_t *)kmalloc(size,GFP_SHARED);
+ TRY {
+  if (block_device_read(fs->s_device,result,size,
+                        EXT2_BLOCK2ADDR(ext,addr),
+                        IO_RDONLY) != size)
+      error_throw(E_WOULDBLOCK);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  kfree(result);
+  error_rethrow();
+ }
+ *pbitmap = result;
+ return result;
+}
+
+INTERN ext2_block_t KCALL
+Ext2_AllocBlocks(struct superblock *__restrict fs, ext2_block_t goal,
+                 ext2_block_t max_count, ext2_block_t *__restrict pcount) {
+ Ext2 *EXCEPT_VAR ext = fs->s_fsdata;
+ ext2_block_t EXCEPT_VAR result = 0;
+ ext2_bgroup_t group_index,i;
+ ext2_block_t offset;
+ assert(max_count != 0);
+ if (goal < ext->sd_first_block || goal >= ext->sd_total_blocks)
+     goal = ext->sd_first_block;
+ group_index = EXT2_BLOCK_BGRP_INDEX(ext,goal);
+ offset      = EXT2_BLOCK_BGRP_OFFSET(ext,goal);
+ rwlock_write(&ext->sd_lock);
+ TRY {
+  /* Scan the remainder of the goal's group, followed by all
+   * other groups and finally the start of the goal's group. */
+  for (i = 0; i <= ext->sd_bgroups_cnt; ++i) {
+   struct block_group *group;
+   group = Ext2_Group(fs,group_index,IO_RDWR);
+   if (group->bg_free_blocks != 0) {
+    byte_t *bitmap = Ext2_GetBitmap(fs,group,false);
+    ext2_block_t count,group_size;
+    group_size = EXT2_BGRP_BLOCK_COUNT(ext,group_index);
+    for (; offset < group_size; ++offset) {
+     if (!(offset & 7) && bitmap[offset/8] == 0xff) {
+      offset += 7; /* Skip fully allocated bytes. */
+      continue;
+     }
+     if (EXT2_BIT_GT(bitmap,offset)) continue;
+     /* Found a free block. - Extend the allocation for as long as possible. */
+     count = 0;
+     do EXT2_BIT_ST(bitmap,offset+count);
+     while (++count < max_count && offset+count < group_size &&
+           !EXT2_BIT_GT(bitmap,offset+count));
+     group->bg_free_blocks = group->bg_free_blocks > count ? group->bg_free_blocks-count : 0;
+     group->bg_flags      |= BLOCK_GROUP_FCHANGE|BLOCK_GROUP_FBCHANG;
+     ext->sd_free_blocks   = ext->sd_free_blocks > count ? ext->sd_free_blocks-count : 0;
+     ext->sd_flags        |= EXT2_FCHANGED;
+     result  = EXT2_BGRP_FIRST_BLOCK(ext,group_index)+offset;
+     *pcount = count;
+     break;
+    }
+    if (result) break;
+   }
+   offset = 0;
+   if (++group_index == ext->sd_bgroups_cnt)
+       group_index = 0;
+  }
+ } FINALLY {
+  rwlock_endwrite(&ext->sd_lock);
+ }
+ if unlikely(!result)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_DISK_FULL);
+ return result;
+}
+
+INTERN void KCALL
+Ext2_FreeBlocks(struct superblock *__restrict fs,
+                ext2_block_t block, ext2_block_t count) {
+ Ext2 *EXCEPT_VAR ext = fs->s_fsdata;
+ rwlock_write(&ext->sd_lock);
+ TRY {
+  while (count) {
+   struct block_group *group; byte_t *bitmap;
+   ext2_bgroup_t group_index; ext2_block_t offset,group_size;
+   if unlikely(block < ext->sd_first_block ||
+               block >= ext->sd_total_blocks)
+      error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+   group_index = EXT2_BLOCK_BGRP_INDEX(ext,block);
+   offset      = EXT2_BLOCK_BGRP_OFFSET(ext,block);
+   group_size  = EXT2_BGRP_BLOCK_COUNT(ext,group_index);
+   group       = Ext2_Group(fs,group_index,IO_RDWR);
+   bitmap      = Ext2_GetBitmap(fs,group,false);
+   for (; count && offset < group_size; --count,++offset,++block) {
+    if unlikely(!EXT2_BIT_GT(bitmap,offset)) {
+     debug_printf("[EXT2] Block %I32u was already free\n",block);
+     continue;
+    }
+    EXT2_BIT_CL(bitmap,offset);
+    ++group->bg_free_blocks;
+    ++ext->sd_free_blocks;
+   }
+   group->bg_flags |= BLOCK_GROUP_FCHANGE|BLOCK_GROUP_FBCHANG;
+  }
+  ext->sd_flags |= EXT2_FCHANGED;
+ } FINALLY {
+  rwlock_endwrite(&ext->sd_lock);
+ }
+}
+
+INTERN ext2_ino_t KCALL
+Ext2_AllocINode(struct superblock *__restrict fs,
+                ext2_ino_t parent_ino, bool is_directory) {
+ Ext2 *EXCEPT_VAR ext = fs->s_fsdata;
+ ext2_ino_t EXCEPT_VAR result = 0;
+ ext2_bgroup_t group_index,i;
+ rwlock_write(&ext->sd_lock);
+ TRY {
+  struct block_group *group;
+  group_index = EXT2_INO_BGRP_INDEX(ext,parent_ino);
+  if (is_directory) {
+   /* Spread directories out: Out of all groups with an above-average
+    * number of free INodes, use the one with the most free blocks. */
+   ext2_ino_t avg_free = ext->sd_free_inodes/ext->sd_bgroups_cnt;
+   u16 max_blocks = 0; bool found = false;
+   for (i = 0; i < ext->sd_bgroups_cnt; ++i) {
+    group = Ext2_Group(fs,i,IO_RDWR);
+    if (!group->bg_free_inodes ||
+         group->bg_free_inodes < avg_free)
+         continue;
+    if (!found || group->bg_free_blocks > max_blocks) {
+     max_blocks  = group->bg_free_blocks;
+     group_index = i;
+     found       = true;
+    }
+   }
+  }
+  for (i = 0; i < ext->sd_bgroups_cnt; ++i) {
+   group = Ext2_Group(fs,group_index,IO_RDWR);
+   if (group->bg_free_inodes != 0) {
+    byte_t *bitmap = Ext2_GetBitmap(fs,group,true);
+    ext2_ino_t base = group_index*ext->sd_ino_per_bgrp+1;
+    ext2_ino_t offset = 0;
+    /* Never hand out reserved INodes. */
+    if (base < ext->sd_first_ino)
+        offset = ext->sd_first_ino-base;
+    for (; offset < ext->sd_ino_per_bgrp; ++offset) {
+     if (!(offset & 7) && bitmap[offset/8] == 0xff) {
+      offset += 7;
+      continue;
+     }
+     if (EXT2_BIT_GT(bitmap,offset)) continue;
+     EXT2_BIT_ST(bitmap,offset);
+     --group->bg_free_inodes;
+     if (is_directory)
+         ++group->bg_num_dirs;
+     group->bg_flags |= BLOCK_GROUP_FCHANGE|BLOCK_GROUP_FICHANG;
+     if (ext->sd_free_inodes)
+       --ext->sd_free_inodes;
+     ext->sd_flags |= EXT2_FCHANGED;
+     result = base+offset;
+     break;
+    }
+    if (result) break;
+   }
+   if (++group_index == ext->sd_bgroups_cnt)
+       group_index = 0;
+  }
+ } FINALLY {
+  rwlock_endwrite(&ext->sd_lock);
+ }
+ if unlikely(!result)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_DISK_FULL);
+ return result;
+}
+
+INTERN void KCALL
+Ext2_FreeINode(struct superblock *__restrict fs,
+               ext2_ino_t ino, bool is_directory) {
+ Ext2 *EXCEPT_VAR ext = fs->s_fsdata;
+ ASSERT_BOUNDS(ext->sd_bound_inodes,ino);
+ rwlock_write(&ext->sd_lock);
+ TRY {
+  struct block_group *group; byte_t *bitmap;
+  ext2_ino_t offset = EXT2_INO_BGRP_OFFSET(ext,ino);
+  group  = Ext2_Group(fs,EXT2_INO_BGRP_INDEX(ext,ino),IO_RDWR);
+  bitmap = Ext2_GetBitmap(fs,group,true);
+  if unlikely(!EXT2_BIT_GT(bitmap,offset)) {
+   debug_printf("[EXT2] INode %I32u was already free\n",ino);
+  } else {
+   EXT2_BIT_CL(bitmap,offset);
+   ++group->bg_free_inodes;
+   if (is_directory && group->bg_num_dirs)
+     --group->bg_num_dirs;
+   group->bg_flags |= BLOCK_GROUP_FCHANGE|BLOCK_GROUP_FICHANG;
+   ++ext->sd_free_inodes;
+   ext->sd_flags |= EXT2_FCHANGED;
+  }
+ } FINALLY {
+  rwlock_endwrite(&ext->sd_lock);
+ }
+}
+
+
+/* Return unused blocks of the preallocation window of `self' to the filesystem. */
+PRIVATE void KCALL
+Ext_DiscardPrealloc(struct inode *__restrict self) {
+ struct inode_data *node = self->i_fsdata;
+ ext2_block_t count = node->i_pa_count;
+ if (!count) return;
+ node->i_pa_count = 0;
+ Ext2_FreeBlocks(self->i_super,node->i_pa_block,count);
+}
+
+
 PRIVATE void KCALL
 free_x2_table(struct block_table_x2 *__restrict self, size_t size) {
  size_t i;
- assert(self->b2_tables);
- for (i = 0; i < size; ++i)
-    kfree(self->b2_tables[i]);
- kfree(self->b2_tables);
+ if (self->b2_tables) {
+  for (i = 0; i < size; ++i)
+     kfree(self->b2_tables[i]);
+  kfree(self->b2_tables);
+ }
  kfree(self);
 }
 
 PRIVATE void KCALL
 free_x3_table(struct block_table_x3 *__restrict self, size_t size) {
  size_t i;
- assert(self->b3_tables);
- for (i = 0; i < size; ++i) {
-  if (self->b3_tables[i])
-      free_x2_table(self->b3_tables[i],size);
+ if (self->b3_tables) {
+  for (i = 0; i < size; ++i) {
+   if (self->b3_tables[i])
+       free_x2_table(self->b3_tables[i],size);
+  }
+  kfree(self->b3_tables);
  }
- kfree(self->b3_tables);
  kfree(self);
 }
 
@@ -138,6 +409,15 @@ INTERN void KCALL
 ExtINode_Fini(struct inode *__restrict self) {
  struct inode_data *node = self->i_fsdata;
  if (!node) return;
+ if (node->i_pa_count) {
+  /* Return blocks that were reserved for the file. */
+  TRY {
+   Ext2_FreeBlocks(self->i_super,node->i_pa_block,node->i_pa_count);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   error_printf("[EXT2] Failed to release preallocated blocks\n");
+   error_handled();
+  }
+ }
  kfree(node->i_siblock);
  if (node->i_diblock)
      free_x2_table(node->i_diblock,self->i_super->s_fsdata->sd_ind_blocksize);
@@ -237,6 +517,8 @@ ExtINode_SaveAttr(struct inode *__restrict self) {
  Ext2INode data; Ext2 *ext; unsigned int i;
  struct inode_data *node = self->i_fsdata;
  assert(node != NULL);
+ /* Blocks reserved for appending writers must not leak onto the disk. */
+ Ext_DiscardPrealloc(self);
  /* Copy unused, but cached fields. */
  data.i_dtime      = node->i_dtime;
  data.i_flags      = node->i_flags;
@@ -294,66 +576,155 @@ ExtINode_SaveAttr(struct inode *__restrict self) {
 
 
 
+/* Allocate an in-memory copy of the indirection block at `addr', prefixed
+ * by `header_size' bytes of ZERO-initialized memory. When `addr' is ZERO(0),
+ * the block hasn't been allocated and the table is filled with ZEROes. */
+PRIVATE ATTR_RETNONNULL void *KCALL
+Ext_LoadTable(struct inode *__restrict self, size_t header_size,
+              ext2_block_t addr, iomode_t flags) {
+ Ext2 *ext = self->i_super->s_fsdata;
+ byte_t *EXCEPT_VAR result;
+ assert(ext->sd_blocksize == ext->sd_ind_blocksize*sizeof(ext2_block_t));
+ result = (byte_t *)kmalloc(header_size+ext->sd_blocksize,
+                            GFP_SHARED|GFP_CALLOC);
+ if (addr) {
+  TRY {
+   /* Read the table from disk. */
+   if (block_device_read(self->i_super->s_device,
+                         result+header_size,
+                         ext->sd_blocksize,
+                         EXT2_BLOCK2ADDR(ext,addr),
+                         flags) != ext->sd_blocksize)
+       error_throw(E_WOULDBLOCK);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   kfree(result);
+   error_rethrow();
+  }
+ }
+ return result;
+}
+
+/* Save `new_table' in `*ptable', unless another thread was faster,
+ * in which case `new_table' is freed and the other table is returned. */
+PRIVATE ATTR_RETNONNULL void *KCALL
+Ext_InstallTable(void **__restrict ptable, void *__restrict new_table) {
+ void *result;
+ if likely(ATOMIC_CMPXCH(*ptable,NULL,new_table))
+    return new_table;
+ result = ATOMIC_READ(*ptable);
+ kfree(new_table);
+ return result;
+}
+
+/* Return the sub-table `(*pvector)[index]' of some indirection table,
+ * lazily allocating both the vector, as well as the table itself
+ * from the indirection block that is referenced by `blocks[index]' */
+PRIVATE ATTR_RETNONNULL void *KCALL
+Ext_GetSubTable(struct inode *__restrict self, void ***__restrict pvector,
+                ext2_block_t const *__restrict blocks, size_t index,
+                size_t header_size, iomode_t flags) {
+ void **vector,*result;
+ if ((vector = ATOMIC_READ(*pvector)) == NULL) {
+  vector = (void **)kmalloc(self->i_super->s_fsdata->sd_ind_blocksize*
+                            sizeof(void *),GFP_SHARED|GFP_CALLOC);
+  vector = (void **)Ext_InstallTable((void **)pvector,vector);
+ }
+ if ((result = ATOMIC_READ(vector[index])) != NULL)
+      return result;
+ result = Ext_LoadTable(self,header_size,
+                        BSWAP_LE2H32(blocks[index]),
+                        flags);
+ return Ext_InstallTable(&vector[index],result);
+}
+
 /* Returns the single-indirection table for the given INode.
  * NOTE: The caller is responsible to ensure that attributes of the
  *       INode have been loaded (`inode_loadattr()' has been called) */
 INTERN ATTR_RETNONNULL struct block_table *KCALL
 Ext_GetINodeSTable(struct inode *__restrict self, iomode_t flags) {
- struct block_table *result; Ext2 *ext;
- if ((result = self->i_fsdata->i_siblock) != NULL)
+ struct inode_data *node = self->i_fsdata;
+ struct block_table *result;
+ if ((result = ATOMIC_READ(node->i_siblock)) != NULL)
       return result;
- ext = self->i_super->s_fsdata;
- /* Allocate a new block table. */
- assert(ext->sd_blocksize == ext->sd_ind_blocksize*sizeof(ext2_block_t));
- result = (struct block_table *)kmalloc(offsetof(struct block_table,bt_blocks)+
-                                        ext->sd_blocksize,GFP_SHARED);
- TRY {
-  result->bt_flags = BLOCK_TABLE_FNORMAL;
-  /* Read the table from disk. */
-  if (block_device_read(self->i_super->s_device,
-                        result->bt_blocks,
-                        ext->sd_blocksize,
-                        EXT2_BLOCK2ADDR(ext,self->i_fsdata->i_siblock_addr),
-                        flags) != ext->sd_blocksize)
-      error_throw(E_WOULDBLOCK);
+ result = (struct block_table *)Ext_LoadTable(self,offsetof(struct block_table,bt_blocks),
+                                              node->i_siblock_addr,flags);
+ return (struct block_table *)Ext_InstallTable((void **)&node->i_siblock,result);
+}
 
-  /* Save the buffer within the INode. */
-  rwlock_write(&self->i_lock);
-  /* Check if the block has been allocated in the mean time. */
-  if unlikely(self->i_fsdata->i_siblock) {
-   struct block_table *new_result;
-   new_result = self->i_fsdata->i_siblock;
-   rwlock_endwrite(&self->i_lock);
-   kfree(result);
-   return new_result;
-  }
-  /* Save the block. */
-  self->i_fsdata->i_siblock = result;
-  rwlock_endwrite(&self->i_lock);
- } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
-  kfree(result);
-  error_rethrow();
- }
- return result;
+/* Return the root tables for doubly and triply indirect block pointers. */
+PRIVATE ATTR_RETNONNULL struct block_table_x2 *KCALL
+Ext_GetINodeDRoot(struct inode *__restrict self, iomode_t flags) {
+ struct inode_data *node = self->i_fsdata;
+ struct block_table_x2 *result;
+ if ((result = ATOMIC_READ(node->i_diblock)) != NULL)
+      return result;
+ result = (struct block_table_x2 *)Ext_LoadTable(self,offsetof(struct block_table_x2,b2_blocks),
+                                                 node->i_diblock_addr,flags);
+ return (struct block_table_x2 *)Ext_InstallTable((void **)&node->i_diblock,result);
+}
+PRIVATE ATTR_RETNONNULL struct block_table_x3 *KCALL
+Ext_GetINodeTRoot(struct inode *__restrict self, iomode_t flags) {
+ struct inode_data *node = self->i_fsdata;
+ struct block_table_x3 *result;
+ if ((result = ATOMIC_READ(node->i_tiblock)) != NULL)
+      return result;
+ result = (struct block_table_x3 *)Ext_LoadTable(self,offsetof(struct block_table_x3,b3_blocks),
+                                                 node->i_tiblock_addr,flags);
+ return (struct block_table_x3 *)Ext_InstallTable((void **)&node->i_tiblock,result);
+}
+
+/* Return the second level table `i_tiblock->b3_tables[x3_index]' */
+PRIVATE ATTR_RETNONNULL struct block_table_x2 *KCALL
+Ext_GetINodeTMiddle(struct inode *__restrict self,
+                    size_t x3_index, iomode_t flags) {
+ struct block_table_x3 *root = Ext_GetINodeTRoot(self,flags);
+ return (struct block_table_x2 *)Ext_GetSubTable(self,(void ***)&root->b3_tables,
+                                                 root->b3_blocks,x3_index,
+                                                 offsetof(struct block_table_x2,b2_blocks),
+                                                 flags);
 }
 
-/* Return the indirection block table for doubly and triply indirect block pointers:
- * Ext_GetINodeDTable() -> i_diblock->b2_tables[x2_index]
- * Ext_GetINodeTTable() -> i_tiblock->b3_tables[x3_index]->b2_tables[x2_index] */
 INTERN ATTR_RETNONNULL struct block_table *KCALL
 Ext_GetINodeDTable(struct inode *__restrict self,
                    size_t x2_index, iomode_t flags) {
- /* TODO (It's really just the same as `Ext_GetINodeSTable()') */
- error_throw(E_NOT_IMPLEMENTED);
+ struct block_table_x2 *root = Ext_GetINodeDRoot(self,flags);
+ return (struct block_table *)Ext_GetSubTable(self,(void ***)&root->b2_tables,
+                                              root->b2_blocks,x2_index,
+                                              offsetof(struct block_table,bt_blocks),
+                                              flags);
 }
 INTERN ATTR_RETNONNULL struct block_table *KCALL
 Ext_GetINodeTTable(struct inode *__restrict self,
                    size_t x3_index, size_t x2_index, iomode_t flags) {
- /* TODO (It's really just the same as `Ext_GetINodeSTable()') */
- error_throw(E_NOT_IMPLEMENTED);
+ struct block_table_x2 *middle = Ext_GetINodeTMiddle(self,x3_index,flags);
+ return (struct block_table *)Ext_GetSubTable(self,(void ***)&middle->b2_tables,
+                                              middle->b2_blocks,x2_index,
+                                              offsetof(struct block_table,bt_blocks),
+                                              flags);
 }
 
 
+/* Remember that file block `index' of `node' maps to `block'.
+ * Sequential lookups extend the cached extent, such that the
+ * following reads can skip walking indirection tables. */
+PRIVATE void KCALL
+Ext_CacheBlock(struct inode_data *__restrict node,
+               ext2_blockid_t index, ext2_block_t block) {
+ /* Don't wait for the lock. - This is just a cache. */
+ if (!atomic_rwlock_trywrite(&node->i_cache_lock))
+      return;
+ if (node->i_cache_count &&
+     index == node->i_cache_index+node->i_cache_count &&
+     block == node->i_cache_block+node->i_cache_count) {
+  ++node->i_cache_count;
+ } else {
+  node->i_cache_index = index;
+  node->i_cache_block = block;
+  node->i_cache_count = 1;
+ }
+ atomic_rwlock_endwrite(&node->i_cache_lock);
+}
+
 
 /* Return the data block referenced by the given `index' within `self'.
  * If the data block hasn't been allocated, return ZERO(0), which
@@ -362,37 +733,237 @@ Ext_GetINodeTTable(struct inode *__restrict self,
 INTERN ext2_block_t KCALL
 Ext_GetINodeBlockAtIndex(struct inode *__restrict self,
                          ext2_blockid_t index, iomode_t flags) {
- Ext2 *ext; size_t ind_tabsize;
+ Ext2 *ext; size_t ind_tabsize; unsigned int ind_shift;
+ struct inode_data *node; ext2_block_t result;
+ ext2_blockid_t rel_index;
  /* Make sure that INode attribute have been loaded! */
  inode_loadattr(self);
+ node = self->i_fsdata;
  /* Check for direct data blocks. */
  if (index < EXT2_DIRECT_BLOCK_COUNT)
-     return self->i_fsdata->i_dblock[index];
- index -= EXT2_DIRECT_BLOCK_COUNT;
+     return node->i_dblock[index];
+ /* Check the extent cache. */
+ if (atomic_rwlock_tryread(&node->i_cache_lock)) {
+  if ((ext2_blockid_t)(index-node->i_cache_index) < node->i_cache_count) {
+   result = node->i_cache_block+(index-node->i_cache_index);
+   atomic_rwlock_endread(&node->i_cache_lock);
+   return result;
+  }
+  atomic_rwlock_endread(&node->i_cache_lock);
+ }
+ rel_index   = index-EXT2_DIRECT_BLOCK_COUNT;
  ext         = self->i_super->s_fsdata;
  ind_tabsize = ext->sd_ind_blocksize;
+ ind_shift   = ext->sd_block_shift-2;
  /* Check for singly indirect data blocks. */
- if (index < ind_tabsize)
-     return Ext_GetINodeSTable(self,flags)->bt_blocks[index];
- index -= ind_tabsize;
+ if (rel_index < ind_tabsize) {
+  result = Ext_GetINodeSTable(self,flags)->bt_blocks[rel_index];
+  goto done;
+ }
+ rel_index -= ind_tabsize;
  /* Check for doubly indirect data blocks. */
- if (index < ind_tabsize*ind_tabsize) {
-  /* Doubly indirect block pointers. */
-  return Ext_GetINodeDTable(self,index >> (ext->sd_block_shift-2),
-                                 flags)
-                     ->bt_blocks[index & (ind_tabsize-1)];
- }
- index -= ind_tabsize*ind_tabsize;
- if (index < ind_tabsize*ind_tabsize*ind_tabsize) {
-  /* Triply indirect block pointers. */
-  return Ext_GetINodeTTable(self,index >> ((ext->sd_block_shift-2)*2),
-                                (index >>  (ext->sd_block_shift-2)) & (ind_tabsize-1),
-                                 flags)
-                     ->bt_blocks[index & (ind_tabsize-1)];
+ if ((u64)rel_index < (u64)1 << (ind_shift*2)) {
+  result = Ext_GetINodeDTable(self,rel_index >> ind_shift,flags)
+                     ->bt_blocks[rel_index & (ind_tabsize-1)];
+  goto done;
+ }
+ rel_index -= 1 << (ind_shift*2);
+ /* Triply indirect block pointers. */
+ if ((u64)rel_index < (u64)1 << (ind_shift*3)) {
+  result = Ext_GetINodeTTable(self,rel_index >> (ind_shift*2),
+                             (rel_index >> ind_shift) & (ind_tabsize-1),
+                              flags)
+                     ->bt_blocks[rel_index & (ind_tabsize-1)];
+  goto done;
  }
  /* Fallback: anything still in excess of this
   *           point is just considered unallocated. */
  return 0;
+done:
+ result = BSWAP_LE2H32(result);
+ if (result)
+     Ext_CacheBlock(node,index,result);
+ return result;
+}
+
+
+/* Set entry `index' of the on-disk indirection block `table_addr'
+ * (which is mirrored in memory by `vector') to `value' */
+PRIVATE void KCALL
+Ext_SetTableEntry(struct inode *__restrict self, ext2_block_t table_addr,
+                  ext2_block_t *__restrict vector, size_t index,
+                  ext2_block_t value, iomode_t flags) {
+ Ext2 *ext = self->i_super->s_fsdata;
+ ext2_block_t entry = BSWAP_H2LE32(value);
+ /* Only update the in-memory copy once the disk has been written,
+  * so that a failed write doesn't leave the two out of sync. */
+ if (block_device_write(self->i_super->s_device,&entry,
+                        sizeof(ext2_block_t),
+                        EXT2_BLOCK2ADDR(ext,table_addr)+
+                        index*sizeof(ext2_block_t),
+                        flags) != sizeof(ext2_block_t))
+     error_throw(E_WOULDBLOCK);
+ vector[index] = entry;
+}
+
+/* Allocate a new, ZERO-initialized indirection block for `self' */
+PRIVATE ext2_block_t KCALL
+Ext_AllocIndirection(struct inode *__restrict self, ext2_block_t goal) {
+ struct superblock *EXCEPT_VAR fs = self->i_super;
+ ext2_block_t EXCEPT_VAR result; ext2_block_t count;
+ result = Ext2_AllocBlocks(fs,goal,1,&count);
+ TRY {
+  Ext2_ZeroDisk(fs,EXT2_BLOCK2ADDR(fs->s_fsdata,result),
+                fs->s_fsdata->sd_blocksize);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  Ext2_FreeBlocks(fs,result,1);
+  error_rethrow();
+ }
+ self->i_attr.a_blocks += EXT2_BLOCK_SECTORS(fs->s_fsdata);
+ return result;
+}
+
+/* Return the indirection block referenced by `vector[index]', allocating
+ * it if necessary, where `vector' mirrors the block at `table_addr' */
+PRIVATE ext2_block_t KCALL
+Ext_EnsureTableEntry(struct inode *__restrict self, ext2_block_t table_addr,
+                     ext2_block_t *__restrict vector, size_t index,
+                     ext2_block_t goal, iomode_t flags) {
+ struct inode *EXCEPT_VAR xself = self;
+ ext2_block_t EXCEPT_VAR result = BSWAP_LE2H32(vector[index]);
+ if (!result) {
+  result = Ext_AllocIndirection(self,goal);
+  TRY {
+   Ext_SetTableEntry(self,table_addr,vector,index,result,flags);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   Ext2_FreeBlocks(xself->i_super,result,1);
+   xself->i_attr.a_blocks -= EXT2_BLOCK_SECTORS(xself->i_super->s_fsdata);
+   error_rethrow();
+  }
+ }
+ return result;
+}
+
+INTERN void KCALL
+Ext_SetINodeBlockAtIndex(struct inode *__restrict self,
+                         ext2_blockid_t index, ext2_block_t block,
+                         iomode_t flags) {
+ struct inode_data *node = self->i_fsdata;
+ struct block_table *table; Ext2 *ext;
+ size_t ind_tabsize; unsigned int ind_shift;
+ ext2_block_t addr;
+ if (index < EXT2_DIRECT_BLOCK_COUNT) {
+  /* Saved alongside the other INode attributes. */
+  node->i_dblock[index] = block;
+  return;
+ }
+ index      -= EXT2_DIRECT_BLOCK_COUNT;
+ ext         = self->i_super->s_fsdata;
+ ind_tabsize = ext->sd_ind_blocksize;
+ ind_shift   = ext->sd_block_shift-2;
+ if (index < ind_tabsize) {
+  table = Ext_GetINodeSTable(self,flags);
+  if (!node->i_siblock_addr)
+       node->i_siblock_addr = Ext_AllocIndirection(self,block);
+  Ext_SetTableEntry(self,node->i_siblock_addr,
+                    table->bt_blocks,index,block,flags);
+  return;
+ }
+ index -= ind_tabsize;
+ if ((u64)index < (u64)1 << (ind_shift*2)) {
+  struct block_table_x2 *root;
+  root = Ext_GetINodeDRoot(self,flags);
+  if (!node->i_diblock_addr)
+       node->i_diblock_addr = Ext_AllocIndirection(self,block);
+  addr  = Ext_EnsureTableEntry(self,node->i_diblock_addr,root->b2_blocks,
+                               index >> ind_shift,block,flags);
+  table = Ext_GetINodeDTable(self,index >> ind_shift,flags);
+  Ext_SetTableEntry(self,addr,table->bt_blocks,
+                    index & (ind_tabsize-1),block,flags);
+  return;
+ }
+ index -= 1 << (ind_shift*2);
+ if ((u64)index < (u64)1 << (ind_shift*3)) {
+  struct block_table_x3 *root; struct block_table_x2 *middle;
+  size_t x3_index = index >> (ind_shift*2);
+  size_t x2_index = (index >> ind_shift) & (ind_tabsize-1);
+  root = Ext_GetINodeTRoot(self,flags);
+  if (!node->i_tiblock_addr)
+       node->i_tiblock_addr = Ext_AllocIndirection(self,block);
+  addr   = Ext_EnsureTableEntry(self,node->i_tiblock_addr,root->b3_blocks,
+                                x3_index,block,flags);
+  middle = Ext_GetINodeTMiddle(self,x3_index,flags);
+  addr   = Ext_EnsureTableEntry(self,addr,middle->b2_blocks,
+                                x2_index,block,flags);
+  table  = Ext_GetINodeTTable(self,x3_index,x2_index,flags);
+  Ext_SetTableEntry(self,addr,table->bt_blocks,
+                    index & (ind_tabsize-1),block,flags);
+  return;
+ }
+ error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_FILE_TOO_LARGE);
+}
+
+
+/* Allocate and map a new data block for file block `index' of `self'
+ * The block is placed right after the one preceding it whenever possible.
+ * NOTE: The caller must be holding a write-lock on `self' */
+PRIVATE ext2_block_t KCALL
+Ext_AllocDataBlock(struct inode *__restrict self,
+                   ext2_blockid_t index, iomode_t flags) {
+ struct superblock *EXCEPT_VAR fs = self->i_super;
+ struct inode_data *node = self->i_fsdata;
+ Ext2 *ext = fs->s_fsdata;
+ ext2_block_t EXCEPT_VAR result;
+ ext2_block_t goal = 0,count;
+ if (index != 0 &&
+    (goal = Ext_GetINodeBlockAtIndex(self,index-1,flags)) != 0)
+     ++goal;
+ if (node->i_pa_count && (!goal || goal == node->i_pa_block)) {
+  /* Take the block from the preallocation window. */
+  result = node->i_pa_block++;
+  --node->i_pa_count;
+ } else {
+  Ext_DiscardPrealloc(self);
+  /* Default to the block group containing the INode. */
+  if (!goal) goal = EXT2_BGRP_FIRST_BLOCK(ext,EXT2_INO_BGRP_INDEX(ext,self->i_attr.a_ino));
+  /* Reserve a couple of blocks ahead for regular files, such that
+   * allocations made for other files in the mean time don't end
+   * up fragmenting files that are being appended to. */
+  result = Ext2_AllocBlocks(fs,goal,INODE_ISREG(self) ? EXT2_PREALLOC_BLOCKS : 1,&count);
+  if (count > 1) {
+   node->i_pa_block = result+1;
+   node->i_pa_count = count-1;
+  }
+ }
+ TRY {
+  Ext_SetINodeBlockAtIndex(self,index,result,flags);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  Ext2_FreeBlocks(fs,result,1);
+  error_rethrow();
+ }
+ self->i_attr.a_blocks += EXT2_BLOCK_SECTORS(ext);
+ return result;
+}
+
+/* Discard all cached indirection tables and block mappings of `self'
+ * NOTE: The caller must be holding a write-lock on `self' */
+PRIVATE void KCALL
+Ext_ClearTables(struct inode *__restrict self) {
+ struct inode_data *node = self->i_fsdata;
+ size_t ind_tabsize = self->i_super->s_fsdata->sd_ind_blocksize;
+ atomic_rwlock_write(&node->i_cache_lock);
+ node->i_cache_count = 0;
+ atomic_rwlock_endwrite(&node->i_cache_lock);
+ kfree(node->i_siblock);
+ node->i_siblock = NULL;
+ if (node->i_diblock) {
+  free_x2_table(node->i_diblock,ind_tabsize);
+  node->i_diblock = NULL;
+ }
+ if (node->i_tiblock) {
+  free_x3_table(node->i_tiblock,ind_tabsize);
+  node->i_tiblock = NULL;
+ }
 }
 
 
@@ -465,8 +1036,177 @@ INTERN size_t KCALL
 Ext_WriteToINode(struct inode *__restrict self,
                  CHECKED USER void const *buf, size_t bufsize,
                  pos_t pos, iomode_t flags) {
- /* TODO */
- error_throw(E_NOT_IMPLEMENTED);
+ Ext2 *ext = self->i_super->s_fsdata;
+ ext2_blockid_t block_id; size_t offset;
+ ext2_block_t block;
+ size_t result = 0;
+ Ext2_CheckWritable(self->i_super);
+ inode_loadattr(self);
+ while (bufsize) {
+  size_t max_write,disk_write;
+  block_id  = (ext2_blockid_t)(pos >> ext->sd_block_shift);
+  offset    = (size_t)pos & ext->sd_blockmask;
+  max_write = ext->sd_blocksize - offset;
+  block     = Ext_GetINodeBlockAtIndex(self,block_id,flags);
+  if (!block) {
+   /* Allocate a new block for this part of the file. */
+   block = Ext_AllocDataBlock(self,block_id,flags);
+   if (max_write > bufsize)
+       max_write = bufsize;
+   /* Portions of the new block not being written must read as ZEROes. */
+   if (offset)
+       Ext2_ZeroDisk(self->i_super,EXT2_BLOCK2ADDR(ext,block),offset);
+   if (offset+max_write < ext->sd_blocksize)
+       Ext2_ZeroDisk(self->i_super,EXT2_BLOCK2ADDR(ext,block)+offset+max_write,
+                     ext->sd_blocksize-(offset+max_write));
+  } else {
+   ext2_block_t next_block = block+1;
+   /* Optimize for contingency */
+   while (max_write < bufsize &&
+          Ext_GetINodeBlockAtIndex(self,block_id+1,flags) == next_block)
+          ++block_id,++next_block,
+          max_write += ext->sd_blocksize;
+   if (max_write > bufsize)
+       max_write = bufsize;
+  }
+  /* Write data to disk. */
+  disk_write = block_device_write(self->i_super->s_device,
+                                  buf,
+                                  max_write,
+                                  EXT2_BLOCK2ADDR(ext,block)+offset,
+                                  flags);
+  result  += disk_write;
+  bufsize -= disk_write;
+  if (disk_write != max_write)
+      break; /* Not everything could be written (the operation would have blocked...) */
+  /* Continue writing the next block. */
+  pos                += max_write;
+  *(uintptr_t *)&buf += max_write;
+ }
+ return result;
+}
+
+
+/* Release all blocks referenced by the indirection block `addr' of the given `depth'
+ * (1: single, 2: double, 3: triple), starting at the relative block index `first'.
+ * @return: true:  The table became empty and `addr' itself was released.
+ * @return: false: The table still references blocks and has been written back. */
+PRIVATE bool KCALL
+Ext_TruncateTable(struct inode *__restrict self, ext2_block_t addr,
+                  unsigned int depth, u64 first,
+                  blkcnt_t *__restrict pnum_freed) {
+ struct superblock *fs = self->i_super;
+ Ext2 *ext = fs->s_fsdata;
+ ext2_block_t *EXCEPT_VAR vector;
+ unsigned int span_shift = (ext->sd_block_shift-2)*(depth-1);
+ size_t i,first_index = (size_t)(first >> span_shift);
+ bool result = first == 0;
+ vector = (ext2_block_t *)kmalloc(ext->sd_blocksize,GFP_SHARED);
+ TRY {
+  if (block_device_read(fs->s_device,vector,ext->sd_blocksize,
+                        EXT2_BLOCK2ADDR(ext,addr),IO_RDONLY) !=
+                        ext->sd_blocksize)
+      error_throw(E_WOULDBLOCK);
+  for (i = first_index; i < ext->sd_ind_blocksize; ++i) {
+   ext2_block_t block = BSWAP_LE2H32(vector[i]);
+   if (!block) continue;
+   if (depth == 1) {
+    Ext2_FreeBlocks(fs,block,1);
+    ++*pnum_freed;
+   } else if (!Ext_TruncateTable(self,block,depth-1,
+                                 i == first_index
+                               ? first & (((u64)1 << span_shift)-1)
+                               : 0,
+                                 pnum_freed)) {
+    continue;
+   }
+   vector[i] = 0;
+  }
+  if (result) {
+   /* The table is now empty. */
+   Ext2_FreeBlocks(fs,addr,1);
+   ++*pnum_freed;
+  } else {
+   if (block_device_write(fs->s_device,vector,ext->sd_blocksize,
+                          EXT2_BLOCK2ADDR(ext,addr),IO_WRONLY) !=
+                          ext->sd_blocksize)
+       error_throw(E_WOULDBLOCK);
+  }
+ } FINALLY {
+  kfree(vector);
+ }
+ return result;
+}
+
+/* Truncate one indirection level of `self', where `*prel' is the
+ * index of the first block that should be released, relative to
+ * the start of the level (and updated for the next level). */
+PRIVATE void KCALL
+Ext_TruncateLevel(struct inode *__restrict self,
+                  ext2_block_t *__restrict paddr,
+                  unsigned int depth, u64 *__restrict prel,
+                  blkcnt_t *__restrict pnum_freed) {
+ u64 capacity = (u64)1 << ((self->i_super->s_fsdata->sd_block_shift-2)*depth);
+ if (*prel >= capacity) {
+  *prel -= capacity;
+  return;
+ }
+ if (*paddr && Ext_TruncateTable(self,*paddr,depth,*prel,pnum_freed))
+     *paddr = 0;
+ *prel = 0;
+}
+
+INTERN void KCALL
+ExtINode_Truncate(struct inode *__restrict self,
+                  pos_t new_smaller_size) {
+ struct superblock *fs = self->i_super;
+ Ext2 *ext = fs->s_fsdata;
+ struct inode_data *node;
+ blkcnt_t EXCEPT_VAR num_freed = 0;
+ u64 first; unsigned int i;
+ Ext2_CheckWritable(fs);
+ inode_loadattr(self);
+ node = self->i_fsdata;
+ if (INODE_ISLNK(self) && !self->i_attr.a_blocks) {
+  /* Fast symbolic link (The link text is stored in the block pointers) */
+  memset(node->i_dblock,0,sizeof(node->i_dblock));
+  return;
+ }
+ Ext_DiscardPrealloc(self);
+ first = (new_smaller_size+ext->sd_blockmask) >> ext->sd_block_shift;
+ if (new_smaller_size & ext->sd_blockmask) {
+  /* Clear the tail of the last block, so that it
+   * reads as ZEROes when the file grows again. */
+  ext2_block_t last; size_t offset;
+  last = Ext_GetINodeBlockAtIndex(self,(ext2_blockid_t)first-1,IO_RDWR);
+  if (last) {
+   offset = (size_t)new_smaller_size & ext->sd_blockmask;
+   Ext2_ZeroDisk(fs,EXT2_BLOCK2ADDR(ext,last)+offset,
+                 ext->sd_blocksize-offset);
+  }
+ }
+ TRY {
+  /* Release direct data blocks. */
+  for (i = (unsigned int)MIN(first,EXT2_DIRECT_BLOCK_COUNT);
+       i < EXT2_DIRECT_BLOCK_COUNT; ++i) {
+   if (!node->i_dblock[i]) continue;
+   Ext2_FreeBlocks(fs,node->i_dblock[i],1);
+   node->i_dblock[i] = 0;
+   ++num_freed;
+  }
+  first = first > EXT2_DIRECT_BLOCK_COUNT ? first-EXT2_DIRECT_BLOCK_COUNT : 0;
+  /* Release indirect data blocks. */
+  Ext_TruncateLevel(self,&node->i_siblock_addr,1,&first,(blkcnt_t *)&num_freed);
+  Ext_TruncateLevel(self,&node->i_diblock_addr,2,&first,(blkcnt_t *)&num_freed);
+  Ext_TruncateLevel(self,&node->i_tiblock_addr,3,&first,(blkcnt_t *)&num_freed);
+ } FINALLY {
+  /* In-memory tables no longer match what's on disk. */
+  Ext_ClearTables(self);
+  num_freed *= EXT2_BLOCK_SECTORS(ext);
+  if (!new_smaller_size || num_freed >= self->i_attr.a_blocks)
+       self->i_attr.a_blocks = 0;
+  else self->i_attr.a_blocks -= num_freed;
+ }
 }
 
 
@@ -518,6 +1258,426 @@ do_write:
 }
 
 
+PRIVATE u8 const ext2_ft2dt[EXT2_FT_COUNT] = {
+    [EXT2_FT_UNKNOWN]  = DT_UNKNOWN,
+    [EXT2_FT_REG_FILE] = DT_REG,
+    [EXT2_FT_DIR]      = DT_DIR,
+    [EXT2_FT_CHRDEV]   = DT_CHR,
+    [EXT2_FT_BLKDEV]   = DT_BLK,
+    [EXT2_FT_FIFO]     = DT_FIFO,
+    [EXT2_FT_SOCK]     = DT_SOCK,
+    [EXT2_FT_SYMLINK]  = DT_LNK,
+};
+
+PRIVATE u8 KCALL Ext2_ModeToFT(mode_t mode) {
+ switch (mode & S_IFMT) {
+ case S_IFREG:  return EXT2_FT_REG_FILE;
+ case S_IFDIR:  return EXT2_FT_DIR;
+ case S_IFCHR:  return EXT2_FT_CHRDEV;
+ case S_IFBLK:  return EXT2_FT_BLKDEV;
+ case S_IFIFO:  return EXT2_FT_FIFO;
+ case S_IFSOCK: return EXT2_FT_SOCK;
+ case S_IFLNK:  return EXT2_FT_SYMLINK;
+ default: break;
+ }
+ return EXT2_FT_UNKNOWN;
+}
+
+/* Get/Set the name length (and type) fields of a directory entry. */
+LOCAL u16 KCALL
+Ext2_GetDirentNameLen(Ext2 *__restrict ext,
+                      Ext2Dirent const *__restrict entry) {
+ if (ext->sd_feat_required & EXT2_FEAT_REQ_FDIRENT_TYPE)
+     return entry->d_namlen_low;
+ return BSWAP_LE2H16(entry->d_namlen);
+}
+LOCAL void KCALL
+Ext2_SetDirentName(Ext2 *__restrict ext,
+                   Ext2Dirent *__restrict entry,
+                   u16 namelen, mode_t mode) {
+ if (ext->sd_feat_required & EXT2_FEAT_REQ_FDIRENT_TYPE) {
+  entry->d_namlen_low = (u8)namelen;
+  entry->d_type       = Ext2_ModeToFT(mode);
+ } else {
+  entry->d_namlen     = BSWAP_H2LE16(namelen);
+ }
+}
+
+
+/* Insert a new directory entry for `ino' into `self' and fill in `dirent->de_pos'
+ * Slack space of existing entries is re-used before the directory is extended.
+ * NOTE: The caller must be holding a write-lock on `self' */
+PRIVATE void KCALL
+ExtDirectory_AddEntry(struct directory_node *__restrict self,
+                      struct directory_entry *__restrict dirent,
+                      ext2_ino_t ino, mode_t mode) {
+ Ext2 *ext = self->d_node.i_super->s_fsdata;
+ byte_t buffer[EXT2_DIRENT_SIZE(EXT2_NAME_MAX)];
+ Ext2Dirent *entry = (Ext2Dirent *)buffer;
+ size_t need,entsize,used;
+ pos_t pos,end; bool grow = false;
+ if unlikely(dirent->de_namelen > EXT2_NAME_MAX)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_FILENAME_TOO_LONG);
+ need = EXT2_DIRENT_SIZE(dirent->de_namelen);
+ inode_loadattr(&self->d_node);
+ end = self->d_node.i_attr.a_size;
+ for (pos = 0; pos < end; pos += entsize) {
+  if (Ext_ReadFromINode(&self->d_node,entry,sizeof(Ext2Dirent),
+                         pos,IO_RDWR) != sizeof(Ext2Dirent))
+      error_throw(E_WOULDBLOCK);
+  entsize = BSWAP_LE2H16(entry->d_entsize);
+  if unlikely(entsize < sizeof(Ext2Dirent) || (entsize & 3) ||
+             ((size_t)pos & ext->sd_blockmask)+entsize > ext->sd_blocksize)
+     error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+  used = 0;
+  if (entry->d_ino)
+      used = EXT2_DIRENT_SIZE(Ext2_GetDirentNameLen(ext,entry));
+  if (entsize >= used+need) {
+   if (used) {
+    /* Split off the unused tail of this entry. */
+    le16 new_size = BSWAP_H2LE16((u16)used);
+    if (Ext_WriteToINode(&self->d_node,&new_size,sizeof(le16),
+                          pos+offsetof(Ext2Dirent,d_entsize),
+                          IO_RDWR) != sizeof(le16))
+        error_throw(E_WOULDBLOCK);
+    pos     += used;
+    entsize -= used;
+   }
+   goto write_entry;
+  }
+ }
+ /* Append a new block to the directory. */
+ pos     = end;
+ entsize = ext->sd_blocksize;
+ grow    = true;
+write_entry:
+ entry->d_ino     = BSWAP_H2LE32(ino);
+ entry->d_entsize = BSWAP_H2LE16((u16)entsize);
+ Ext2_SetDirentName(ext,entry,dirent->de_namelen,mode);
+ memcpy(buffer+sizeof(Ext2Dirent),dirent->de_name,
+        dirent->de_namelen*sizeof(char));
+ if (Ext_WriteToINode(&self->d_node,buffer,
+                      sizeof(Ext2Dirent)+dirent->de_namelen*sizeof(char),
+                      pos,IO_RDWR) !=
+                      sizeof(Ext2Dirent)+dirent->de_namelen*sizeof(char))
+     error_throw(E_WOULDBLOCK);
+ if (grow)
+     self->d_node.i_attr.a_size = end+ext->sd_blocksize;
+ dirent->de_pos = pos;
+ inode_changed(&self->d_node);
+}
+
+/* Remove the directory entry at `entry_pos' from `self'
+ * NOTE: The caller must be holding a write-lock on `self' */
+PRIVATE void KCALL
+ExtDirectory_DelEntry(struct directory_node *__restrict self,
+                      pos_t entry_pos) {
+ Ext2 *ext = self->d_node.i_super->s_fsdata;
+ Ext2Dirent entry; pos_t pos,prev;
+ u16 prev_size; le16 new_size;
+ pos = entry_pos & ~(pos_t)ext->sd_blockmask;
+ if (pos == entry_pos) {
+  /* First entry of its block: Just mark it as unused. */
+  le32 unused = 0;
+  if (Ext_WriteToINode(&self->d_node,&unused,sizeof(le32),
+                        entry_pos+offsetof(Ext2Dirent,d_ino),
+                        IO_RDWR) != sizeof(le32))
+      error_throw(E_WOULDBLOCK);
+ } else {
+  /* Merge the entry into the one preceding it. */
+  do {
+   if (Ext_ReadFromINode(&self->d_node,&entry,sizeof(Ext2Dirent),
+                          pos,IO_RDWR) != sizeof(Ext2Dirent))
+       error_throw(E_WOULDBLOCK);
+   prev      = pos;
+   prev_size = BSWAP_LE2H16(entry.d_entsize);
+   if unlikely(prev_size < sizeof(Ext2Dirent))
+      error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+   pos += prev_size;
+  } while (pos < entry_pos);
+  if unlikely(pos != entry_pos)
+     error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+  if (Ext_ReadFromINode(&self->d_node,&entry,sizeof(Ext2Dirent),
+                         entry_pos,IO_RDWR) != sizeof(Ext2Dirent))
+      error_throw(E_WOULDBLOCK);
+  new_size = BSWAP_H2LE16(prev_size+BSWAP_LE2H16(entry.d_entsize));
+  if (Ext_WriteToINode(&self->d_node,&new_size,sizeof(le16),
+                        prev+offsetof(Ext2Dirent,d_entsize),
+                        IO_RDWR) != sizeof(le16))
+      error_throw(E_WOULDBLOCK);
+ }
+ inode_changed(&self->d_node);
+}
+
+
+/* Allocate a new on-disk INode for `node', which is about to be created in `dir' */
+PRIVATE void KCALL
+ExtDirectory_NewINode(struct directory_node *__restrict dir,
+                      struct inode *__restrict node,
+                      struct inode_operations *__restrict ops) {
+ struct superblock *EXCEPT_VAR fs = dir->d_node.i_super;
+ Ext2 *ext = fs->s_fsdata;
+ ext2_ino_t EXCEPT_VAR ino;
+ bool EXCEPT_VAR is_directory = INODE_ISDIR(node);
+ ino = Ext2_AllocINode(fs,dir->d_node.i_attr.a_ino,is_directory);
+ TRY {
+  node->i_fsdata = (struct inode_data *)kmalloc(sizeof(struct inode_data),
+                                                GFP_SHARED|GFP_CALLOC);
+  node->i_ops        = ops;
+  node->i_attr.a_ino = ino;
+  node->i_nlink      = 1;
+  /* Clear extended INode fields left behind by a previous file. */
+  if (ext->sd_inode_size > sizeof(Ext2INode))
+      Ext2_ZeroDisk(fs,Ext2_InoAddr(fs,ino,IO_RDWR)+sizeof(Ext2INode),
+                    ext->sd_inode_size-sizeof(Ext2INode));
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  Ext2_FreeINode(fs,ino,is_directory);
+  error_rethrow();
+ }
+}
+
+/* Release the on-disk INode of `self' after its last link has been removed.
+ * NOTE: The caller must be holding a write-lock on `self' */
+PRIVATE void KCALL
+Ext_DeleteINode(struct inode *__restrict self) {
+ assert(self->i_nlink == 0);
+ /* Release data that wasn't already freed using `f_truncate' */
+ if (self->i_attr.a_blocks)
+     ExtINode_Truncate(self,0);
+ self->i_attr.a_size = 0;
+ self->i_fsdata->i_dtime = BSWAP_H2LE32((u32)wall_gettime(self->i_super->s_wall).tv_sec);
+ ExtINode_SaveAttr(self);
+ /* The INode may be re-allocated from here on, so make sure
+  * that our (now outdated) copy is never written back. */
+ ATOMIC_FETCHAND(self->i_flags,~INODE_FCHANGED);
+ Ext2_FreeINode(self->i_super,self->i_attr.a_ino,INODE_ISDIR(self));
+}
+
+/* Remove a directory after its entry in `parent' has been deleted. */
+PRIVATE void KCALL
+ExtDirectory_Delete(struct directory_node *__restrict parent,
+                    struct inode *__restrict dir) {
+ dir->i_nlink = 0;
+ Ext_DeleteINode(dir);
+ /* The `..' entry of `dir' no longer links to `parent' */
+ if (parent->d_node.i_nlink > 1)
+   --parent->d_node.i_nlink;
+}
+
+/* Fill in the initial data block of a new directory `self'
+ * that contains the `.' and `..' (with `parent_ino') entries. */
+PRIVATE void KCALL
+ExtDirectory_InitBlock(struct directory_node *__restrict self,
+                       ext2_ino_t parent_ino) {
+ Ext2 *ext = self->d_node.i_super->s_fsdata;
+ byte_t *EXCEPT_VAR data; Ext2Dirent *entry;
+ data = (byte_t *)kmalloc(ext->sd_blocksize,GFP_SHARED|GFP_CALLOC);
+ TRY {
+  entry = (Ext2Dirent *)data;
+  entry->d_ino     = BSWAP_H2LE32(self->d_node.i_attr.a_ino);
+  entry->d_entsize = BSWAP_H2LE16(EXT2_DIRENT_SIZE(1));
+  Ext2_SetDirentName(ext,entry,1,S_IFDIR);
+  data[sizeof(Ext2Dirent)] = '.';
+  entry = (Ext2Dirent *)(data+EXT2_DIRENT_SIZE(1));
+  entry->d_ino     = BSWAP_H2LE32(parent_ino);
+  entry->d_entsize = BSWAP_H2LE16((u16)(ext->sd_blocksize-EXT2_DIRENT_SIZE(1)));
+  Ext2_SetDirentName(ext,entry,2,S_IFDIR);
+  data[EXT2_DIRENT_SIZE(1)+sizeof(Ext2Dirent)+0] = '.';
+  data[EXT2_DIRENT_SIZE(1)+sizeof(Ext2Dirent)+1] = '.';
+  if (Ext_WriteToINode(&self->d_node,data,ext->sd_blocksize,0,IO_RDWR) !=
+                       ext->sd_blocksize)
+      error_throw(E_WOULDBLOCK);
+  self->d_node.i_attr.a_size = ext->sd_blocksize;
+ } FINALLY {
+  kfree(data);
+ }
+}
+
+
+PRIVATE struct inode_operations Ext2_DirectoryOps;
+PRIVATE struct inode_operations Ext2_RegularOps;
+
+PRIVATE void KCALL
+ExtDirectory_Creat(struct directory_node *__restrict target_directory,
+                   struct directory_entry *__restrict target_dirent,
+                   struct regular_node *__restrict new_node) {
+ struct superblock *EXCEPT_VAR fs = target_directory->d_node.i_super;
+ struct regular_node *EXCEPT_VAR xnode = new_node;
+ Ext2_CheckWritable(fs);
+ ExtDirectory_NewINode(target_directory,&new_node->re_node,&Ext2_RegularOps);
+ TRY {
+  ExtINode_SaveAttr(&new_node->re_node);
+  ExtDirectory_AddEntry(target_directory,target_dirent,
+                        new_node->re_node.i_attr.a_ino,
+                        new_node->re_node.i_attr.a_mode);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  Ext2_FreeINode(fs,xnode->re_node.i_attr.a_ino,false);
+  error_rethrow();
+ }
+ target_dirent->de_ino = new_node->re_node.i_attr.a_ino;
+}
+
+PRIVATE void KCALL
+ExtDirectory_MkDir(struct directory_node *__restrict target_directory,
+                   struct directory_entry *__restrict target_dirent,
+                   struct directory_node *__restrict new_directory) {
+ struct superblock *EXCEPT_VAR fs = target_directory->d_node.i_super;
+ struct directory_node *EXCEPT_VAR xnew = new_directory;
+ Ext2_CheckWritable(fs);
+ if unlikely(target_directory->d_node.i_nlink >= EXT2_LINK_MAX)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_TOO_MANY_HARD_LINKS);
+ ExtDirectory_NewINode(target_directory,&new_directory->d_node,&Ext2_DirectoryOps);
+ TRY {
+  ExtDirectory_InitBlock(new_directory,target_directory->d_node.i_attr.a_ino);
+  new_directory->d_node.i_nlink = 2; /* `.' links back to the directory itself. */
+  ExtINode_SaveAttr(&new_directory->d_node);
+  ExtDirectory_AddEntry(target_directory,target_dirent,
+                        new_directory->d_node.i_attr.a_ino,
+                        S_IFDIR);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  if (xnew->d_node.i_fsdata->i_dblock[0])
+      Ext2_FreeBlocks(fs,xnew->d_node.i_fsdata->i_dblock[0],1);
+  Ext2_FreeINode(fs,xnew->d_node.i_attr.a_ino,true);
+  error_rethrow();
+ }
+ target_dirent->de_ino = new_directory->d_node.i_attr.a_ino;
+ /* The `..' entry of the new directory links to its parent. */
+ ++target_directory->d_node.i_nlink;
+}
+
+PRIVATE void KCALL
+ExtDirectory_Link(struct directory_node *__restrict target_directory,
+                  struct directory_entry *__restrict target_dirent,
+                  struct inode *__restrict link_target) {
+ Ext2_CheckWritable(target_directory->d_node.i_super);
+ inode_loadattr(link_target);
+ if unlikely(link_target->i_nlink >= EXT2_LINK_MAX)
+    error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_TOO_MANY_HARD_LINKS);
+ ExtDirectory_AddEntry(target_directory,target_dirent,
+                       link_target->i_attr.a_ino,
+                       link_target->i_attr.a_mode);
+ ++link_target->i_nlink;
+ ExtINode_SaveAttr(link_target);
+}
+
+PRIVATE void KCALL
+ExtDirectory_Unlink(struct directory_node *__restrict containing_directory,
+                    struct directory_entry *__restrict containing_entry,
+                    struct inode *__restrict node_to_unlink) {
+ Ext2_CheckWritable(containing_directory->d_node.i_super);
+ inode_loadattr(node_to_unlink);
+ ExtDirectory_DelEntry(containing_directory,containing_entry->de_pos);
+ if (INODE_ISDIR(node_to_unlink)) {
+  /* Ext2 directories always have at least 2 links (their
+   * own `.' entry), but are still removed as a whole. */
+  ExtDirectory_Delete(containing_directory,node_to_unlink);
+ } else if (--node_to_unlink->i_nlink == 0) {
+  Ext_DeleteINode(node_to_unlink);
+ } else {
+  ExtINode_SaveAttr(node_to_unlink);
+ }
+}
+
+PRIVATE void KCALL
+ExtDirectory_RmDir(struct directory_node *__restrict containing_directory,
+                   struct directory_entry *__restrict containing_entry,
+                   struct directory_node *__restrict node_to_unlink) {
+ Ext2_CheckWritable(containing_directory->d_node.i_super);
+ inode_loadattr(&node_to_unlink->d_node);
+ ExtDirectory_DelEntry(containing_directory,containing_entry->de_pos);
+ ExtDirectory_Delete(containing_directory,&node_to_unlink->d_node);
+}
+
+PRIVATE void KCALL
+ExtDirectory_Rename(struct directory_node *__restrict source_directory,
+                    struct directory_entry *__restrict source_dirent,
+                    struct directory_node *__restrict target_directory,
+                    struct directory_entry *__restrict target_dirent,
+                    struct inode *__restrict source_node) {
+ Ext2_CheckWritable(source_directory->d_node.i_super);
+ inode_loadattr(source_node);
+ if (INODE_ISDIR(source_node) && source_directory != target_directory &&
+     target_directory->d_node.i_nlink >= EXT2_LINK_MAX)
+     error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_TOO_MANY_HARD_LINKS);
+ ExtDirectory_AddEntry(target_directory,target_dirent,
+                       source_node->i_attr.a_ino,
+                       source_node->i_attr.a_mode);
+ target_dirent->de_ino = source_node->i_attr.a_ino;
+ ExtDirectory_DelEntry(source_directory,source_dirent->de_pos);
+ if (INODE_ISDIR(source_node) && source_directory != target_directory) {
+  Ext2Dirent entry; le32 parent_ino;
+  /* Update the `..' entry (which always follows `.') of the moved directory. */
+  if (Ext_ReadFromINode(source_node,&entry,sizeof(Ext2Dirent),0,IO_RDWR) !=
+                        sizeof(Ext2Dirent))
+      error_throw(E_WOULDBLOCK);
+  parent_ino = BSWAP_H2LE32(target_directory->d_node.i_attr.a_ino);
+  if (Ext_WriteToINode(source_node,&parent_ino,sizeof(le32),
+                       BSWAP_LE2H16(entry.d_entsize)+offsetof(Ext2Dirent,d_ino),
+                       IO_RDWR) != sizeof(le32))
+      error_throw(E_WOULDBLOCK);
+  --source_directory->d_node.i_nlink;
+  ++target_directory->d_node.i_nlink;
+ }
+}
+
+
+/* Write all modified allocation bitmaps, block group
+ * descriptors and free-counters back to disk. */
+PRIVATE void KCALL
+Ext2FS_Sync(struct superblock *__restrict self) {
+ Ext2 *EXCEPT_VAR ext = self->s_fsdata;
+ struct block_device *dev = self->s_device;
+ rwlock_write(&ext->sd_lock);
+ TRY {
+  ext2_bgroup_t i;
+  for (i = 0; i < ext->sd_bgroups_cnt; ++i) {
+   struct block_group *group = &ext->sd_groups[i];
+   if ((group->bg_flags & BLOCK_GROUP_FBCHANG) && group->bg_busage) {
+    size_t size = CEILDIV(ext->sd_blk_per_bgrp,8);
+    if (block_device_write(dev,group->bg_busage,size,
+                           EXT2_BLOCK2ADDR(ext,group->bg_busage_addr),
+                           IO_WRONLY) != size)
+        error_throw(E_WOULDBLOCK);
+    group->bg_flags &= ~BLOCK_GROUP_FBCHANG;
+   }
+   if ((group->bg_flags & BLOCK_GROUP_FICHANG) && group->bg_iusage) {
+    size_t size = CEILDIV(ext->sd_ino_per_bgrp,8);
+    if (block_device_write(dev,group->bg_iusage,size,
+                           EXT2_BLOCK2ADDR(ext,group->bg_iusage_addr),
+                           IO_WRONLY) != size)
+        error_throw(E_WOULDBLOCK);
+    group->bg_flags &= ~BLOCK_GROUP_FICHANG;
+   }
+   if (group->bg_flags & BLOCK_GROUP_FCHANGE) {
+    le16 counters[3];
+    counters[0] = BSWAP_H2LE16(group->bg_free_blocks);
+    counters[1] = BSWAP_H2LE16(group->bg_free_inodes);
+    counters[2] = BSWAP_H2LE16(group->bg_num_dirs);
+    if (block_device_write(dev,counters,sizeof(counters),
+                           ext->sd_bgroups_pos+i*EXT2_BLOCKGROUP_SIZE+
+                           offsetof(Ext2Blockgroup,bg_free_blocks),
+                           IO_WRONLY) != sizeof(counters))
+        error_throw(E_WOULDBLOCK);
+    group->bg_flags &= ~BLOCK_GROUP_FCHANGE;
+   }
+  }
+  if (ext->sd_flags & EXT2_FCHANGED) {
+   le32 counters[2];
+   counters[0] = BSWAP_H2LE32(ext->sd_free_blocks);
+   counters[1] = BSWAP_H2LE32(ext->sd_free_inodes);
+   if (block_device_write(dev,counters,sizeof(counters),
+                          EXT2_SUPERBLOCK_OFFSET+
+                          offsetof(Ext2Superblock,e_free_blocks),
+                          IO_WRONLY) != sizeof(counters))
+       error_throw(E_WOULDBLOCK);
+   ext->sd_flags &= ~EXT2_FCHANGED;
+  }
+ } FINALLY {
+  rwlock_endwrite(&ext->sd_lock);
+ }
+}
+
+
 INTERN REF struct directory_entry *KCALL
 ExtDirectory_ReadDir(struct directory_node *__restrict self,
                      pos_t *__restrict pentry_pos,
@@ -528,6 +1688,7 @@ ExtDirectory_ReadDir(struct directory_node *__restrict self,
  inode_loadattr(&self->d_node);
 again:
  entry_pos = *pentry_pos;
+ if (entry_pos >= self->d_node.i_attr.a_size) return NULL; /* End of directory */
  if (Ext_ReadFromINode(&self->d_node,&entry,sizeof(Ext2Dirent),
                         entry_pos,flags) != sizeof(Ext2Dirent))
      error_throw(E_WOULDBLOCK);
@@ -536,7 +1697,7 @@ again:
  *pentry_pos += entsize;
  if (!entry.d_ino) goto again; /* Unused entry. */
  if (self->d_node.i_super->s_fsdata->sd_feat_required & EXT2_FEAT_REQ_FDIRENT_TYPE) {
-  entry_type = entry.d_type;
+  entry_type = entry.d_type < EXT2_FT_COUNT ? ext2_ft2dt[entry.d_type] : DT_UNKNOWN;
   namlen     = entry.d_namlen_low;
   if ((entsize-sizeof(Ext2Dirent)) > 0xff) {
    /* The filename is longer than 255 characters, and
@@ -667,6 +1828,12 @@ PRIVATE struct inode_operations Ext2_DirectoryOps = {
     .io_saveattr = &ExtINode_SaveAttr,
     .io_directory = {
         .d_readdir = &ExtDirectory_ReadDir,
+        .d_creat   = &ExtDirectory_Creat,
+        .d_mkdir   = &ExtDirectory_MkDir,
+        .d_link    = &ExtDirectory_Link,
+        .d_rename  = &ExtDirectory_Rename,
+        .d_unlink  = &ExtDirectory_Unlink,
+        .d_rmdir   = &ExtDirectory_RmDir,
     }
 };
 
@@ -675,8 +1842,9 @@ PRIVATE struct inode_operations Ext2_RegularOps = {
     .io_loadattr = &ExtINode_LoadAttr,
     .io_saveattr = &ExtINode_SaveAttr,
     .io_file = {
-        .f_pread  = &ExtINode_PRead,
-        .f_pwrite = &ExtINode_PWrite,
+        .f_pread    = &ExtINode_PRead,
+        .f_pwrite   = &ExtINode_PWrite,
+        .f_truncate = &ExtINode_Truncate,
     }
 };
 
@@ -684,12 +1852,18 @@ PRIVATE struct inode_operations Ext2_DeviceOps = {
     .io_fini     = &ExtINode_Fini,
     .io_loadattr = &ExtINode_LoadAttr,
     .io_saveattr = &ExtINode_SaveAttr,
+    .io_file = {
+        .f_truncate = &ExtINode_Truncate,
+    }
 };
 
 PRIVATE struct inode_operations Ext2_SymlinkOps = {
     .io_fini     = &ExtINode_Fini,
     .io_loadattr = &ExtINode_LoadAttr,
     .io_saveattr = &ExtINode_SaveAttr,
+    .io_file = {
+        .f_truncate = &ExtINode_Truncate,
+    },
     .io_symlink  = {
         .sl_readlink = &ExtINode_ReadLink,
     }
@@ -723,7 +1897,10 @@ Ext2FS_Open(struct superblock *__restrict self,
      !super.e_inodes_per_group)
      error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
 
- num_block_groups = CEILDIV(BSWAP_LE2H32(super.e_total_blocks),
+ if (BSWAP_LE2H32(super.e_super_blockno) >= BSWAP_LE2H32(super.e_total_blocks))
+     error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
+ num_block_groups = CEILDIV(BSWAP_LE2H32(super.e_total_blocks)-
+                            BSWAP_LE2H32(super.e_super_blockno),
                             BSWAP_LE2H32(super.e_blocks_per_group));
  temp             = CEILDIV(BSWAP_LE2H32(super.e_total_inodes),
                             BSWAP_LE2H32(super.e_inodes_per_group));
@@ -763,6 +1940,10 @@ Ext2FS_Open(struct superblock *__restrict self,
  ext->sd_blk_per_bgrp = BSWAP_LE2H32(super.e_blocks_per_group);
  ext->sd_total_inodes = BSWAP_LE2H32(super.e_total_inodes);
  ext->sd_total_blocks = BSWAP_LE2H32(super.e_total_blocks);
+ ext->sd_first_block  = BSWAP_LE2H32(super.e_super_blockno);
+ ext->sd_free_blocks  = BSWAP_LE2H32(super.e_free_blocks);
+ ext->sd_free_inodes  = BSWAP_LE2H32(super.e_free_inodes);
+ ext->sd_first_ino    = 11;
  ext->sd_version = ((u32)BSWAP_LE2H16(super.e_version_major) << 16 |
                     (u32)BSWAP_LE2H16(super.e_version_minor));
  ext->sd_bound_inodes.b_min = 1;
@@ -773,6 +1954,9 @@ Ext2FS_Open(struct superblock *__restrict self,
   ext->sd_feat_required = BSWAP_LE2H32(super.e_feat_required);
   ext->sd_feat_mountro  = BSWAP_LE2H32(super.e_feat_mountro);
   ext->sd_inode_size    = BSWAP_LE2H16(super.e_inode_size);
+  ext->sd_first_ino     = BSWAP_LE2H32(super.e_nonreserved_inode);
+  if unlikely(ext->sd_first_ino <= EXT2_ROOT_DIRECTORY_INO)
+     error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
   /* Make sure that the specified INode size isn't too small. */
   if unlikely(ext->sd_inode_size < 128)
      error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_CORRUPTED_FILESYSTEM);
@@ -797,8 +1981,9 @@ Ext2FS_Open(struct superblock *__restrict self,
  self->s_root->d_node.i_attr.a_ino = EXT2_ROOT_DIRECTORY_INO;
  self->s_root->d_node.i_ops        = &Ext2_DirectoryOps;
 
- (void)must_mount_ro; /* TODO */
-
+ /* Journaled filesystems, or ones using features we don't know about can still be read. */
+ if (must_mount_ro)
+     ext->sd_flags |= EXT2_FREADONLY;
 }
 
 PRIVATE void KCALL
@@ -853,7 +2038,8 @@ INTERN struct superblock_type ext2fs_type = {
     .st_open      = &Ext2FS_Open,
     .st_functions = {
         .f_fini     = &Ext2FS_Fini,
-        .f_opennode = &Ext2FS_OpenNode
+        .f_opennode = &Ext2FS_OpenNode,
+        .f_sync     = &Ext2FS_Sync
     }
 };
 
@@ -23,6 +23,7 @@
 #include <kos/types.h>
 #include <fs/node.h>
 #include <sched/rwlock.h>
+#include <hybrid/sync/atomic-rwlock.h>
 #include <kos/bound.h>
 
 DECL_BEGIN
@@ -213,11 +214,25 @@ typedef struct PACKED {
                                   * length of the name (in characters; excluding \0) */
         struct PACKED {
             u8  d_namlen_low;    /* Low 8 bits of the name length. */
-            u8  d_type;          /* Entry type (One of `DT_*'). */
+            u8  d_type;          /* Entry type (One of `EXT2_FT_*'). */
         };
     };
 //  char        d_name[1];       /* The directory entry name. */
 } Ext2Dirent;
+#define EXT2_FT_UNKNOWN  0 /* Unknown file type. */
+#define EXT2_FT_REG_FILE 1 /* Regular file. */
+#define EXT2_FT_DIR      2 /* Directory. */
+#define EXT2_FT_CHRDEV   3 /* Character device. */
+#define EXT2_FT_BLKDEV   4 /* Block device. */
+#define EXT2_FT_FIFO     5 /* Named pipe. */
+#define EXT2_FT_SOCK     6 /* Socket. */
+#define EXT2_FT_SYMLINK  7 /* Symbolic link. */
+#define EXT2_FT_COUNT    8
+#define EXT2_NAME_MAX    255 /* Max length of a directory entry name. */
+#define EXT2_LINK_MAX    32000 /* Max number of hard links to an INode. */
+/* Return the size of a directory entry with a name of `namelen' characters. */
+#define EXT2_DIRENT_SIZE(namelen) \
+   (((sizeof(Ext2Dirent)+(namelen)*sizeof(char))+3) & ~3)
 
 
 
@@ -289,6 +304,14 @@ typedef struct superblock_data {
     size_t              sd_blocksize;     /* [const][== 1 << sd_block_shift] Size of a single block (in bytes) */
     size_t              sd_blockmask;     /* [const][== sd_blocksize-1] Block mask for extracting the offset within a block. */
     size_t              sd_ind_blocksize; /* [const][== sd_blocksize / 4] Number of entries in an indirect block pointer block. */
+    ext2_block_t        sd_first_block;   /* [const] Block number of the first block described by block group #0. */
+    ext2_ino_t          sd_first_ino;     /* [const] First INode number that may be allocated for regular use. */
+    ext2_block_t        sd_free_blocks;   /* [lock(sd_lock)] Total number of unallocated blocks. */
+    ext2_ino_t          sd_free_inodes;   /* [lock(sd_lock)] Total number of unallocated INodes. */
+#define EXT2_FNORMAL    0x0000            /* Normal superblock flags. */
+#define EXT2_FREADONLY  0x0001            /* [const] The filesystem must not be written to. */
+#define EXT2_FCHANGED   0x0002            /* [lock(sd_lock)] `sd_free_blocks' or `sd_free_inodes' differ from their on-disk shadow. */
+    u32                 sd_flags;         /* Superblock flags (Set of `EXT2_F*') */
     struct block_group  sd_groups[1];     /* [1..sd_bgroups_cnt][lock(sd_lock)]
                                            * Vector of block group descriptors that have been loaded into memory. */
 } Ext2;
@@ -306,6 +329,21 @@ typedef struct superblock_data {
 /* Return the offset into a block group of a given INode. */
 #define EXT2_INO_BGRP_OFFSET(super,ino)  ((ext2_ino_t)((ext2_ino_t)((ino)-1) % (super)->sd_ino_per_bgrp))
 
+/* Return the block group index / the offset into that group of a given block. */
+#define EXT2_BLOCK_BGRP_INDEX(super,block)  ((ext2_bgroup_t)((ext2_block_t)((block)-(super)->sd_first_block) / (super)->sd_blk_per_bgrp))
+#define EXT2_BLOCK_BGRP_OFFSET(super,block) ((ext2_block_t)((ext2_block_t)((block)-(super)->sd_first_block) % (super)->sd_blk_per_bgrp))
+
+/* Return the first block / the number of blocks of a given block group.
+ * NOTE: The last group may be smaller than `sd_blk_per_bgrp' */
+#define EXT2_BGRP_FIRST_BLOCK(super,index)  ((ext2_block_t)((super)->sd_first_block+(index)*(super)->sd_blk_per_bgrp))
+#define EXT2_BGRP_BLOCK_COUNT(super,index) \
+   ((index) == (super)->sd_bgroups_cnt-1 \
+  ? (ext2_block_t)((super)->sd_total_blocks-EXT2_BGRP_FIRST_BLOCK(super,index)) \
+  : (super)->sd_blk_per_bgrp)
+
+/* Number of 512-byte sectors that make up a single block (used for `i_attr.a_blocks') */
+#define EXT2_BLOCK_SECTORS(super)           ((super)->sd_blocksize >> 9)
+
 
 
 
@@ -330,6 +368,35 @@ INTDEF void KCALL Ext2_ReadINode(struct superblock *__restrict fs, ext2_ino_t in
 INTDEF void KCALL Ext2_WriteINode(struct superblock *__restrict fs, ext2_ino_t ino,
                                   Ext2INode const *__restrict node, iomode_t mode);
 
+/* Throw an `ERROR_FS_READONLY_FILESYSTEM' error if `fs' cannot be written to. */
+INTDEF void KCALL Ext2_CheckWritable(struct superblock *__restrict fs);
+
+/* Allocate up to `max_count' (>= 1) consecutive blocks, preferably starting at `goal'.
+ * Allocation begins searching at `goal', scanning the remainder of its block group
+ * before moving on to the next ones, thus keeping blocks of a file close together.
+ * @return: * : The first allocated block (`*pcount' is filled with the number of blocks allocated)
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_DISK_FULL: No free blocks are left.
+ * @throw: E_WOULDBLOCK: `IO_NONBLOCK' has been specified, but the operation would have blocked. */
+INTDEF ext2_block_t KCALL
+Ext2_AllocBlocks(struct superblock *__restrict fs, ext2_block_t goal,
+                 ext2_block_t max_count, ext2_block_t *__restrict pcount);
+/* Release `count' consecutive blocks starting at `block' */
+INTDEF void KCALL
+Ext2_FreeBlocks(struct superblock *__restrict fs,
+                ext2_block_t block, ext2_block_t count);
+
+/* Allocate/Free an INode number.
+ * New INodes are allocated within the same block group as `parent_ino', unless
+ * `is_directory' is true, in which case directories are spread out across all
+ * groups with an above-average number of free INodes.
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_DISK_FULL: No free INodes are left. */
+INTDEF ext2_ino_t KCALL
+Ext2_AllocINode(struct superblock *__restrict fs,
+                ext2_ino_t parent_ino, bool is_directory);
+INTDEF void KCALL
+Ext2_FreeINode(struct superblock *__restrict fs,
+               ext2_ino_t ino, bool is_directory);
+
 
 
 
@@ -383,6 +450,13 @@ struct inode_data {
                                        * Same as `i_siblock', but for doubly indirect blocks. */
     struct block_table_x3 *i_tiblock; /* [0..1][MIRROR(lock,struct block_table_x2::b2_tables)]
                                        * Same as `i_siblock', but for triply indirect blocks. */
+    atomic_rwlock_t        i_cache_lock;  /* Lock for the extent cache below. */
+    ext2_blockid_t         i_cache_index; /* [lock(i_cache_lock)] First file block index of the cached extent. */
+    ext2_block_t           i_cache_block; /* [lock(i_cache_lock)] On-disk block mapped to `i_cache_index'. */
+    ext2_blockid_t         i_cache_count; /* [lock(i_cache_lock)] Number of consecutive blocks in the cached extent (ZERO(0) if invalid). */
+#define EXT2_PREALLOC_BLOCKS 8            /* Number of blocks reserved ahead of appending writers. */
+    ext2_block_t           i_pa_block;    /* [lock(WRITE(::i_lock))] First block of the preallocation window. */
+    ext2_block_t           i_pa_count;    /* [lock(WRITE(::i_lock))] Number of blocks remaining in the preallocation window. */
     /* Caches values of all the fields found in `Ext2INode', but not in `struct inode' */
     ext2_block_t i_dblock[EXT2_DIRECT_BLOCK_COUNT]; /* Direct block pointers for file data. */
     ext2_block_t i_siblock_addr; /* Pointer to a block filled with `ext2_block_t[EXT2_BLOCKSIZE(:)]'. */
@@ -420,6 +494,16 @@ INTDEF ext2_block_t KCALL
 Ext_GetINodeBlockAtIndex(struct inode *__restrict self,
                          ext2_blockid_t index, iomode_t flags);
 
+/* Map the data block `index' within `self' to `block', allocating
+ * intermediate indirection blocks as necessary.
+ * NOTE: The caller must be holding a write-lock on `self'
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_FILE_TOO_LARGE: `index' cannot be mapped.
+ * @throw: E_FILESYSTEM_ERROR.ERROR_FS_DISK_FULL:      Failed to allocate an indirection block. */
+INTDEF void KCALL
+Ext_SetINodeBlockAtIndex(struct inode *__restrict self,
+                         ext2_blockid_t index, ext2_block_t block,
+                         iomode_t flags);
+
 /* Returns the single-indirection table for the given INode.
  * NOTE: The caller is responsible to ensure that attributes of the
  *       INode have been loaded (`inode_loadattr()' has been called),
@@ -459,6 +543,12 @@ INTDEF size_t KCALL ExtINode_PWrite(struct inode *__restrict self,
                                     CHECKED USER void const *buf, size_t bufsize,
                                     pos_t pos, iomode_t flags);
 
+/* Truncate the data of `self' to `new_smaller_size' bytes, releasing all blocks beyond.
+ * This function is the `f_truncate' operator of Ext2 regular files.
+ * NOTE: The caller must be holding a write-lock on `self' */
+INTDEF void KCALL ExtINode_Truncate(struct inode *__restrict self,
+                                    pos_t new_smaller_size);
+
 /* Read a directory entry from an Ext2 directory INode. */
 INTDEF REF struct directory_entry *KCALL
 ExtDirectory_ReadDir(struct directory_node *__restrict self,
@@ -0,0 +1,382 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_INET_INET_C
+#define GUARD_KERNEL_MODULES_INET_INET_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/minmax.h>
+#include <kos/types.h>
+#include <net/socket.h>
+#include <kernel/bind.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <except.h>
+
+#include "inet.h"
+
+DECL_BEGIN
+
+INTERN void KCALL
+inet_getaddr(struct inet_addr *__restrict result, u16 family,
+             USER CHECKED struct sockaddr const *addr, socklen_t addrlen) {
+ memset(result,0,sizeof(struct inet_addr));
+ result->ia_family = family;
+ if (family == AF_INET) {
+  USER CHECKED struct sockaddr_in const *in;
+  in = (USER CHECKED struct sockaddr_in const *)addr;
+  if unlikely(addrlen < sizeof(struct sockaddr_in))
+     error_throwf(E_NET_ERROR,ERROR_NET_INVALID_SOCKET_ADDRESS);
+  if (in->sin_family != AF_INET)
+      error_throwf(E_NET_ERROR,ERROR_NET_INVALID_ADDRESS_FAMILY);
+  result->ia_port       = in->sin_port;
+  result->ia_addr16[5]  = 0xffff;
+  result->ia_addr32[3]  = in->sin_addr.s_addr;
+ } else {
+  USER CHECKED struct sockaddr_in6 const *in6;
+  assert(family == AF_INET6);
+  in6 = (USER CHECKED struct sockaddr_in6 const *)addr;
+  if unlikely(addrlen < sizeof(struct sockaddr_in6))
+     error_throwf(E_NET_ERROR,ERROR_NET_INVALID_SOCKET_ADDRESS);
+  if (in6->sin6_family != AF_INET6)
+      error_throwf(E_NET_ERROR,ERROR_NET_INVALID_ADDRESS_FAMILY);
+  result->ia_port = in6->sin6_port;
+  memcpy(result->ia_addr8,in6->sin6_addr.s6_addr,16);
+ }
+ COMPILER_READ_BARRIER();
+}
+
+INTERN socklen_t KCALL
+inet_putaddr(struct inet_addr const *__restrict self, u16 family,
+             USER CHECKED struct sockaddr *buf, socklen_t buflen) {
+ if (family == AF_INET) {
+  struct sockaddr_in result;
+  memset(&result,0,sizeof(struct sockaddr_in));
+  result.sin_family      = AF_INET;
+  result.sin_port        = self->ia_port;
+  result.sin_addr.s_addr = self->ia_addr32[3];
+  memcpy(buf,&result,MIN(buflen,sizeof(struct sockaddr_in)));
+  return sizeof(struct sockaddr_in);
+ } else {
+  struct sockaddr_in6 result;
+  assert(family == AF_INET6);
+  memset(&result,0,sizeof(struct sockaddr_in6));
+  result.sin6_family = AF_INET6;
+  result.sin6_port   = self->ia_port;
+  memcpy(result.sin6_addr.s6_addr,self->ia_addr8,16);
+  memcpy(buf,&result,MIN(buflen,sizeof(struct sockaddr_in6)));
+  return sizeof(struct sockaddr_in6);
+ }
+}
+
+INTERN ATTR_NOTHROW bool KCALL
+inet_addr_islocal(struct inet_addr const *__restrict self) {
+ if (INET_ADDR_ISMAPPED(self))
+     return self->ia_addr8[12] == IN_LOOPBACKNET; /* 127.0.0.0/8 */
+ return (self->ia_addr32[0] == 0 && self->ia_addr32[1] == 0 &&
+         self->ia_addr32[2] == 0 && self->ia_addr32[3] == htonl(1)); /* ::1 */
+}
+
+INTERN ATTR_NOTHROW bool KCALL
+inet_addr_matches(struct inet_addr const *__restrict bound,
+                  struct inet_addr const *__restrict dst) {
+ if (INET_ADDR_ISANY(bound)) {
+  /* `::' receives everything, but `0.0.0.0' only receives IPv4 traffic. */
+  return !INET_ADDR_ISMAPPED(bound) || INET_ADDR_ISMAPPED(dst);
+ }
+ return memcmp(bound->ia_addr8,dst->ia_addr8,16) == 0;
+}
+
+INTERN ATTR_NOTHROW void KCALL
+inet_addr_setlocal(struct inet_addr *self,
+                   struct inet_addr const *dst) {
+ bool is_mapped = INET_ADDR_ISMAPPED(dst);
+ memset(self->ia_addr8,0,16);
+ if (is_mapped) {
+  self->ia_addr16[5] = 0xffff;
+  self->ia_addr32[3] = htonl(INADDR_LOOPBACK);
+ } else {
+  self->ia_addr32[3] = htonl(1);
+ }
+}
+
+INTERN void KCALL
+inet_route(struct inet_addr *__restrict dst) {
+ /* Like other systems, treat a connection to the
+  * wildcard address as a connection to localhost. */
+ if (INET_ADDR_ISANY(dst))
+     inet_addr_setlocal(dst,dst);
+ else if (!inet_addr_islocal(dst))
+     error_throwf(E_NET_ERROR,ERROR_NET_NETWORK_UNREACHABLE);
+}
+
+
+INTERN struct inet_iface inet_loopback = {
+    .if_name    = "lo",
+    .if_mtu     = INET_LOOPBACK_MTU,
+    .if_packets = 0,
+    .if_bytes   = 0,
+    .if_drops   = 0,
+};
+
+INTERN struct inet_ports inet_udp_ports = {
+    .ip_lock = ATOMIC_RWLOCK_INIT,
+    .ip_next = INET_PORT_EPHEMERAL_MIN,
+};
+INTERN struct inet_ports inet_tcp_ports = {
+    .ip_lock = ATOMIC_RWLOCK_INIT,
+    .ip_next = INET_PORT_EPHEMERAL_MIN,
+};
+
+
+/* Check if a socket bound to `addr' would conflict with another socket. */
+PRIVATE ATTR_NOTHROW bool KCALL
+inet_port_inuse(struct inet_ports *__restrict ports,
+                struct inet_addr const *__restrict addr) {
+ InetSocket *iter;
+ iter = ports->ip_hash[INET_PORT_HASH(addr->ia_port)];
+ for (; iter; iter = iter->is_bind.le_next) {
+  if (iter->is_local.ia_port != addr->ia_port)
+      continue;
+  if (inet_addr_matches(&iter->is_local,addr) ||
+      inet_addr_matches(addr,&iter->is_local))
+      return true;
+ }
+ return false;
+}
+
+INTERN void KCALL
+inet_bind(InetSocket *__restrict self,
+          struct inet_ports *__restrict ports,
+          struct inet_addr const *__restrict addr) {
+ struct inet_addr local = *addr;
+ if (!INET_ADDR_ISANY(&local) && !inet_addr_islocal(&local))
+      error_throwf(E_NET_ERROR,ERROR_NET_ADDRESS_NOT_AVAILABLE);
+ atomic_rwlock_write(&ports->ip_lock);
+ if unlikely(self->is_ports) {
+  /* Another thread automatically bound the socket in the mean time. */
+  atomic_rwlock_endwrite(&ports->ip_lock);
+  return;
+ }
+ if (!local.ia_port) {
+  /* Search for an unused ephemeral port. */
+  unsigned int count = (INET_PORT_EPHEMERAL_MAX-INET_PORT_EPHEMERAL_MIN)+1;
+  u16 port = ports->ip_next;
+  for (;;) {
+   local.ia_port = htons(port);
+   port = port == INET_PORT_EPHEMERAL_MAX ? INET_PORT_EPHEMERAL_MIN : port+1;
+   if (!inet_port_inuse(ports,&local))
+        break;
+   if unlikely(!--count) {
+    atomic_rwlock_endwrite(&ports->ip_lock);
+    error_throwf(E_NET_ERROR,ERROR_NET_ADDRESS_IN_USE);
+   }
+  }
+  ports->ip_next = port;
+ } else if (inet_port_inuse(ports,&local)) {
+  atomic_rwlock_endwrite(&ports->ip_lock);
+  error_throwf(E_NET_ERROR,ERROR_NET_ADDRESS_IN_USE);
+ }
+ self->is_local = local;
+ self->is_ports = ports;
+ LIST_INSERT(ports->ip_hash[INET_PORT_HASH(local.ia_port)],self,is_bind);
+ atomic_rwlock_endwrite(&ports->ip_lock);
+ ATOMIC_FETCHOR(self->is_socket.s_state,SOCKET_STATE_FBOUND);
+}
+
+INTERN void KCALL
+inet_autobind(InetSocket *__restrict self,
+              struct inet_ports *__restrict ports) {
+ struct inet_addr addr;
+ memset(&addr,0,sizeof(struct inet_addr));
+ addr.ia_family = INET_FAMILY(self);
+ if (addr.ia_family == AF_INET)
+     addr.ia_addr16[5] = 0xffff;
+ inet_bind(self,ports,&addr);
+}
+
+INTERN ATTR_NOTHROW void KCALL
+inet_unbind(InetSocket *__restrict self) {
+ struct inet_ports *ports = self->is_ports;
+ if (!ports) return;
+ atomic_rwlock_write(&ports->ip_lock);
+ LIST_REMOVE(self,is_bind);
+ atomic_rwlock_endwrite(&ports->ip_lock);
+}
+
+INTERN REF InetSocket *KCALL
+inet_lookup(struct inet_ports *__restrict ports,
+            struct inet_addr const *__restrict dst) {
+ InetSocket *iter;
+ /* NOTE: Since `inet_bind()' refuses overlapping bindings,
+  *       there can only ever be a single matching socket. */
+ atomic_rwlock_read(&ports->ip_lock);
+ iter = ports->ip_hash[INET_PORT_HASH(dst->ia_port)];
+ for (; iter; iter = iter->is_bind.le_next) {
+  if (iter->is_local.ia_port != dst->ia_port)
+      continue;
+  if (!inet_addr_matches(&iter->is_local,dst))
+      continue;
+  if (!socket_tryincref(&iter->is_socket))
+      continue; /* Socket is being destroyed. */
+  break;
+ }
+ atomic_rwlock_endread(&ports->ip_lock);
+ return iter;
+}
+
+
+
+INTERN socklen_t KCALL
+InetSocket_GetSockOpt(InetSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void *buf,
+                      socklen_t buflen, iomode_t UNUSED(mode)) {
+ int value;
+ if (level != SOL_SOCKET)
+     error_throw(E_NOT_IMPLEMENTED);
+ switch (optname) {
+ case SO_RCVBUF:
+ case SO_RCVBUFFORCE:
+  value = (int)self->is_rcvbuf;
+  break;
+ case SO_SNDBUF:
+ case SO_SNDBUFFORCE:
+  value = (int)self->is_sndbuf;
+  break;
+ case SO_TYPE:
+  value = self->is_socket.s_type;
+  break;
+ case SO_PROTOCOL:
+  value = self->is_socket.s_proto;
+  break;
+ case SO_DOMAIN:
+  value = INET_FAMILY(self);
+  break;
+ case SO_ERROR:
+  /* Errors are always reported synchronously. */
+  value = 0;
+  break;
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+ memcpy(buf,&value,MIN(buflen,sizeof(int)));
+ return sizeof(int);
+}
+
+INTERN void KCALL
+InetSocket_SetSockOpt(InetSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void const *buf,
+                      socklen_t buflen, iomode_t UNUSED(mode)) {
+ int value; size_t size;
+ if (level != SOL_SOCKET)
+     error_throw(E_NOT_IMPLEMENTED);
+ if (optname != SO_RCVBUF && optname != SO_RCVBUFFORCE &&
+     optname != SO_SNDBUF && optname != SO_SNDBUFFORCE)
+     error_throw(E_NOT_IMPLEMENTED);
+ if (buflen != sizeof(int))
+     error_throw(E_INVALID_ARGUMENT);
+ memcpy(&value,buf,sizeof(int));
+ COMPILER_READ_BARRIER();
+ size = value < 0 ? 0 : (size_t)value;
+ if (size < INET_BUFSIZE_MIN) size = INET_BUFSIZE_MIN;
+ if (size > INET_BUFSIZE_MAX) size = INET_BUFSIZE_MAX;
+ if (optname == SO_RCVBUF || optname == SO_RCVBUFFORCE) {
+  self->is_rcvbuf = size;
+  packetbuffer_setlimit(&self->is_rx,size);
+ } else {
+  self->is_sndbuf = size;
+ }
+}
+
+INTERN socklen_t KCALL
+InetSocket_GetSockName(InetSocket *__restrict self,
+                       USER CHECKED struct sockaddr *buf,
+                       socklen_t buflen, iomode_t UNUSED(mode)) {
+ return inet_putaddr(&self->is_local,INET_FAMILY(self),buf,buflen);
+}
+
+INTERN socklen_t KCALL
+InetSocket_GetPeerName(InetSocket *__restrict self,
+                       USER CHECKED struct sockaddr *buf,
+                       socklen_t buflen, iomode_t UNUSED(mode)) {
+ return inet_putaddr(&self->is_remote,INET_FAMILY(self),buf,buflen);
+}
+
+
+
+INTERN ATTR_RETNONNULL REF InetSocket *KCALL
+inet_socket_alloc(struct socket_domain *__restrict domain,
+                  u16 type, u16 proto) {
+ REF InetSocket *result;
+ struct socket_ops *ops;
+ size_t struct_size;
+ switch (type) {
+ case SOCK_STREAM:
+  if (proto != 0 && proto != IPPROTO_TCP)
+      error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_PROTOCOL);
+  proto       = IPPROTO_TCP;
+  ops         = &tcp_socket_ops;
+  struct_size = sizeof(TcpSocket);
+  break;
+ case SOCK_DGRAM:
+  if (proto != 0 && proto != IPPROTO_UDP)
+      error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_PROTOCOL);
+  proto       = IPPROTO_UDP;
+  ops         = &udp_socket_ops;
+  struct_size = sizeof(InetSocket);
+  break;
+ default:
+  error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_TYPE);
+ }
+ /* NOTE: All the remaining fields are automatically ZERO-initialized. */
+ result = (REF InetSocket *)socket_alloc(struct_size,domain,type,proto,ops);
+ result->is_rcvbuf = INET_BUFSIZE_DEFAULT;
+ result->is_sndbuf = INET_BUFSIZE_DEFAULT;
+ packetbuffer_cinit(&result->is_rx,result->is_rcvbuf,NULL);
+ return result;
+}
+
+PRIVATE REF struct socket *KCALL
+Inet_CreateSocket(struct socket_domain *__restrict domain,
+                  u16 type, u16 proto) {
+ return &inet_socket_alloc(domain,type,proto)->is_socket;
+}
+
+
+INTERN struct socket_domain inet_domain = {
+    .sd_domain = AF_INET,
+    .sd_flags  = SOCKET_DOMAIN_FNORMAL,
+    .sd_driver = &this_driver,
+    .sd_socket = &Inet_CreateSocket,
+};
+INTERN struct socket_domain inet6_domain = {
+    .sd_domain = AF_INET6,
+    .sd_flags  = SOCKET_DOMAIN_FNORMAL,
+    .sd_driver = &this_driver,
+    .sd_socket = &Inet_CreateSocket,
+};
+DEFINE_SOCKET_DOMAIN(inet_domain);
+DEFINE_SOCKET_DOMAIN(inet6_domain);
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_INET_INET_C */
@@ -0,0 +1,246 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_INET_INET_H
+#define GUARD_KERNEL_MODULES_INET_INET_H 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/list/list.h>
+#include <hybrid/sync/atomic-rwlock.h>
+#include <kos/types.h>
+#include <net/socket.h>
+#include <net/packetbuffer.h>
+#include <sched/signal.h>
+#include <netinet/in.h>
+
+DECL_BEGIN
+
+/* Internet (AF_INET / AF_INET6) sockets.
+ * For now, the only interface that exists is the loopback device, meaning
+ * that packets never leave the machine. Because of this, there's no need
+ * to construct any real IP/TCP/UDP headers. Instead, data is delivered
+ * straight into the receive buffer of the target socket, with the socket
+ * addresses and port tables still behaving like they would on a real stack.
+ * IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d),
+ * meaning that a single set of port tables can be shared by both families. */
+
+struct PACKED inet_addr {
+    union PACKED {
+        u8                ia_addr8[16];  /* IPv6 address (Network byte order) */
+        u16               ia_addr16[8];  /* IPv6 address (Network byte order) */
+        u32               ia_addr32[4];  /* IPv6 address (Network byte order) */
+    };
+    u16                   ia_port;       /* Port number (Network byte order) */
+    u16                   ia_family;     /* Address family of the associated socket (`AF_INET' or `AF_INET6') */
+};
+
+/* Check for special addresses. */
+#define INET_ADDR_ISMAPPED(x) \
+   ((x)->ia_addr32[0] == 0 && (x)->ia_addr32[1] == 0 && \
+    (x)->ia_addr16[4] == 0 && (x)->ia_addr16[5] == 0xffff)
+#define INET_ADDR_ISANY(x) \
+   ((x)->ia_addr32[0] == 0 && (x)->ia_addr32[1] == 0 && \
+    ((x)->ia_addr32[2] == 0 || (x)->ia_addr32[2] == htonl(0xffff)) && \
+    (x)->ia_addr32[3] == 0)
+
+/* Load a socket address from user-space.
+ * @throw: E_NET_ERROR.ERROR_NET_INVALID_SOCKET_ADDRESS: `addrlen' is too small.
+ * @throw: E_NET_ERROR.ERROR_NET_INVALID_ADDRESS_FAMILY: The address family doesn't match `family'. */
+INTDEF void KCALL
+inet_getaddr(struct inet_addr *__restrict result, u16 family,
+             USER CHECKED struct sockaddr const *addr, socklen_t addrlen);
+/* Store a socket address in user-space.
+ * @return: * : The required buffer size. (usual rules apply) */
+INTDEF socklen_t KCALL
+inet_putaddr(struct inet_addr const *__restrict self, u16 family,
+             USER CHECKED struct sockaddr *buf, socklen_t buflen);
+/* Check if `self' is a loopback address (127.0.0.0/8 or ::1) */
+INTDEF ATTR_NOTHROW bool KCALL inet_addr_islocal(struct inet_addr const *__restrict self);
+/* Check if a socket bound to `bound' would receive packets sent to `dst'
+ * NOTE: This only compares the address, but not the port. */
+INTDEF ATTR_NOTHROW bool KCALL
+inet_addr_matches(struct inet_addr const *__restrict bound,
+                  struct inet_addr const *__restrict dst);
+/* Fill in `self' with the loopback address of the family of `dst' (port isn't modified)
+ * NOTE: `self' and `dst' may be the same address. */
+INTDEF ATTR_NOTHROW void KCALL
+inet_addr_setlocal(struct inet_addr *self,
+                   struct inet_addr const *dst);
+/* Figure out how to reach `dst', replacing the wildcard address with loopback.
+ * @throw: E_NET_ERROR.ERROR_NET_NETWORK_UNREACHABLE: No interface can reach `dst' */
+INTDEF void KCALL inet_route(struct inet_addr *__restrict dst);
+
+
+/* Network interface statistics. */
+struct inet_iface {
+    char                   if_name[8]; /* [const] Name of the interface. */
+    size_t                 if_mtu;     /* [const] Max size of a single packet (including IP headers). */
+    ATOMIC_DATA uintptr_t  if_packets; /* Number of packets transmitted. */
+    ATOMIC_DATA uintptr_t  if_bytes;   /* Number of payload bytes transmitted. */
+    ATOMIC_DATA uintptr_t  if_drops;   /* Number of packets that had to be dropped. */
+};
+#define INET_LOOPBACK_MTU  16384
+INTDEF struct inet_iface inet_loopback;
+#define inet_loopback_xmit(num_bytes) \
+   (ATOMIC_FETCHINC(inet_loopback.if_packets), \
+    ATOMIC_FETCHADD(inet_loopback.if_bytes,num_bytes))
+#define inet_loopback_drop() \
+    ATOMIC_FETCHINC(inet_loopback.if_drops)
+
+/* Size of the IP headers that would be used on a real interface. */
+#define INET_IPV4_HEADER    20
+#define INET_UDP_HEADER     8
+#define INET_TCP_HEADER     20
+/* Max payload of a single UDP datagram (we don't do fragmentation) */
+#define INET_UDP_MAXPAYLOAD (INET_LOOPBACK_MTU-(INET_IPV4_HEADER+INET_UDP_HEADER))
+/* Default TCP max segment size. */
+#define INET_TCP_DEFMSS     (INET_LOOPBACK_MTU-(INET_IPV4_HEADER+INET_TCP_HEADER))
+#define INET_TCP_MINMSS     88
+
+/* Socket buffer sizes.
+ * NOTE: The max is limited by the 16-bit state of `struct packetbuffer' */
+#define INET_BUFSIZE_MIN     0x100
+#define INET_BUFSIZE_DEFAULT 0x4000
+#define INET_BUFSIZE_MAX     0x7ff8
+
+
+typedef struct inet_socket InetSocket;
+typedef struct tcp_socket  TcpSocket;
+
+/* A table of bound ports. */
+#define INET_PORT_HASHSIZE      64
+#define INET_PORT_HASH(port)  ((port) % INET_PORT_HASHSIZE)
+#define INET_PORT_EPHEMERAL_MIN 49152 /* First port used for automatic binding. */
+#define INET_PORT_EPHEMERAL_MAX 65535 /* Last port used for automatic binding. */
+struct inet_ports {
+    atomic_rwlock_t        ip_lock;                         /* Lock for this port table. */
+    LIST_HEAD(InetSocket)  ip_hash[INET_PORT_HASHSIZE];     /* [0..1][lock(ip_lock)] Hash-table of bound sockets (by port). */
+    u16                    ip_next;                         /* [lock(ip_lock)] Next ephemeral port to try. */
+};
+INTDEF struct inet_ports inet_udp_ports;
+INTDEF struct inet_ports inet_tcp_ports;
+
+
+struct inet_socket {
+    struct socket          is_socket; /* The underlying socket. */
+    struct inet_ports     *is_ports;  /* [0..1][lock(WRITE_ONCE)] The port table this socket is bound in. */
+    LIST_NODE(InetSocket)  is_bind;   /* [valid_if(is_ports)][lock(is_ports->ip_lock)] Chain of sockets bound in `is_ports' */
+    struct inet_addr       is_local;  /* [lock(is_socket.s_lock)][valid_if(SOCKET_STATE_FBOUND)] The local address. */
+    struct inet_addr       is_remote; /* [lock(is_socket.s_lock)][valid_if(SOCKET_STATE_FCONNECTED)] The remote address. */
+    size_t                 is_rcvbuf; /* [lock(is_socket.s_lock)] Receive buffer size (`SO_RCVBUF') */
+    size_t                 is_sndbuf; /* [lock(is_socket.s_lock)] Send buffer size (`SO_SNDBUF') */
+    struct packetbuffer    is_rx;     /* Buffer for incoming data.
+                                       * UDP:  Ancillary data is the `struct inet_addr' of the sender.
+                                       * TCP:  Packets are segments with no ancillary data. */
+};
+#define INET_FAMILY(x)  ((x)->is_socket.s_domain->sd_domain)
+
+/* Allocate and initialize a new internet socket.
+ * @throw: E_NET_ERROR.ERROR_NET_UNSUPPORTED_TYPE:     [...]
+ * @throw: E_NET_ERROR.ERROR_NET_UNSUPPORTED_PROTOCOL: [...] */
+INTDEF ATTR_RETNONNULL REF InetSocket *KCALL
+inet_socket_alloc(struct socket_domain *__restrict domain,
+                  u16 type, u16 proto);
+
+/* Bind `self' to `addr' in `ports'.
+ * When the port of `addr' is ZERO(0), an ephemeral port is chosen.
+ * If `self' was already bound (as the result of a race with another
+ * thread automatically binding the socket), do nothing.
+ * @throw: E_NET_ERROR.ERROR_NET_ADDRESS_NOT_AVAILABLE: `addr' isn't a local address.
+ * @throw: E_NET_ERROR.ERROR_NET_ADDRESS_IN_USE:        The address is already in use. */
+INTDEF void KCALL
+inet_bind(InetSocket *__restrict self,
+          struct inet_ports *__restrict ports,
+          struct inet_addr const *__restrict addr);
+/* Automatically bind `self' to an ephemeral port of the wildcard address. */
+INTDEF void KCALL
+inet_autobind(InetSocket *__restrict self,
+              struct inet_ports *__restrict ports);
+/* Remove `self' from its port table (no-op if it wasn't bound). */
+INTDEF ATTR_NOTHROW void KCALL inet_unbind(InetSocket *__restrict self);
+/* Lookup the socket that should receive packets sent to `dst'
+ * @return: NULL: No socket is bound to `dst' */
+INTDEF REF InetSocket *KCALL
+inet_lookup(struct inet_ports *__restrict ports,
+            struct inet_addr const *__restrict dst);
+
+/* Common operators for `SOL_SOCKET' options. */
+INTDEF socklen_t KCALL
+InetSocket_GetSockOpt(InetSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void *buf,
+                      socklen_t buflen, iomode_t mode);
+INTDEF void KCALL
+InetSocket_SetSockOpt(InetSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void const *buf,
+                      socklen_t buflen, iomode_t mode);
+INTDEF socklen_t KCALL
+InetSocket_GetSockName(InetSocket *__restrict self,
+                       USER CHECKED struct sockaddr *buf,
+                       socklen_t buflen, iomode_t mode);
+INTDEF socklen_t KCALL
+InetSocket_GetPeerName(InetSocket *__restrict self,
+                       USER CHECKED struct sockaddr *buf,
+                       socklen_t buflen, iomode_t mode);
+
+
+
+/* UDP sockets are simply `InetSocket' objects. */
+INTDEF struct socket_ops udp_socket_ops;
+
+
+/* TCP sockets come in 2 variants:
+ *   #1 Listening sockets (the ones that called `bind()' + `listen()')
+ *      - Holds the set of pending connections yet to be accept(2)-ed
+ *   #2 Connected sockets (either from `connect()' or `accept()')
+ *      - Hold a weak reference to the other end of the connection.
+ *        Data sent to the socket is directly written into the peer's
+ *       `is_rx' buffer, meaning that the peer's buffer limit doubles
+ *        as the receive window.
+ * NOTE: Accepted sockets are never part of the port table. */
+struct tcp_socket {
+    InetSocket                   ts_inet;    /* The underlying internet socket. */
+    union {
+        struct {
+            atomic_rwlock_t          l_lock;    /* Lock used to guard the accept queue. */
+            REF LIST_HEAD(TcpSocket) l_pending; /* [lock(l_lock)] Chain of pending, not-yet accepted connections. */
+            unsigned int             l_length;  /* [lock(l_lock)] The current number of queued sockets. */
+            unsigned int             l_limit;   /* [lock(l_lock)] The maximum number of sockets that may be queued. */
+            struct sig               l_newcon;  /* Signal broadcast when a new socket is added to a previously empty queue. */
+        }                        ts_listen;  /* [valid_if(SOCKET_STATE_FLISTENING)] Listener data. */
+        struct {
+            WEAK REF TcpSocket      *c_peer;    /* [0..1][lock(WRITE_ONCE)] The other end of the connection.
+                                                 * When its reference counter has dropped to ZERO(0),
+                                                 * the connection was closed by the peer. */
+        }                        ts_conn;    /* [valid_if(SOCKET_STATE_FCONNECTED)] Connection data. */
+    };
+    LIST_NODE(TcpSocket)         ts_pending; /* [lock(:ts_listen.l_lock)] Chain of pending connections. */
+#define TCP_SOCKET_FNORMAL       0x0000      /* Normal socket flags. */
+#define TCP_SOCKET_FNODELAY      0x0001      /* `TCP_NODELAY': Don't coalesce small writes. */
+    u16                          ts_flags;   /* [lock(ts_inet.is_socket.s_lock)] Set of `TCP_SOCKET_F*' */
+    u16                          ts_mss;     /* [lock(ts_inet.is_socket.s_lock)] Max segment size (`TCP_MAXSEG'; ZERO(0) for default). */
+};
+#define TCP_ISLISTENING(x)  ((x)->ts_inet.is_socket.s_state & SOCKET_STATE_FLISTENING)
+#define TCP_ISCONNECTED(x)  ((x)->ts_inet.is_socket.s_state & SOCKET_STATE_FCONNECTED)
+
+INTDEF struct socket_ops tcp_socket_ops;
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_INET_INET_H */
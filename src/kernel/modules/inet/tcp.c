@@ -0,0 +1,427 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_INET_TCP_C
+#define GUARD_KERNEL_MODULES_INET_TCP_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/minmax.h>
+#include <kos/types.h>
+#include <net/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched/task.h>
+#include <sched/signal.h>
+#include <string.h>
+#include <except.h>
+#include <bits/poll.h>
+
+#include "inet.h"
+
+DECL_BEGIN
+
+/* Returns a reference to the other end of the
+ * connection, or NULL if it has been closed. */
+PRIVATE REF TcpSocket *KCALL
+TcpSocket_GetPeer(TcpSocket *__restrict self) {
+ TcpSocket *peer = self->ts_conn.c_peer;
+ if (!peer || !socket_tryincref(&peer->ts_inet.is_socket))
+      return NULL;
+ return peer;
+}
+
+PRIVATE void KCALL
+TcpSocket_Fini(TcpSocket *__restrict self) {
+ if (TCP_ISLISTENING(self)) {
+  TcpSocket *iter,*next;
+  /* Drop all connections that were never accepted. */
+  iter = self->ts_listen.l_pending;
+  while (iter) {
+   next = iter->ts_pending.le_next;
+   socket_decref(&iter->ts_inet.is_socket);
+   iter = next;
+  }
+ } else if (TCP_ISCONNECTED(self) && self->ts_conn.c_peer) {
+  TcpSocket *peer = self->ts_conn.c_peer;
+  /* Close the peer's receive buffer to indicate EOF. */
+  if (socket_tryincref(&peer->ts_inet.is_socket)) {
+   packetbuffer_close(&peer->ts_inet.is_rx);
+   socket_decref(&peer->ts_inet.is_socket);
+  }
+  socket_weak_decref(&peer->ts_inet.is_socket);
+ }
+ inet_unbind(&self->ts_inet);
+ packetbuffer_fini(&self->ts_inet.is_rx);
+}
+
+PRIVATE void KCALL
+TcpSocket_Shutdown(TcpSocket *__restrict self, u16 new_flags) {
+ if (TCP_ISCONNECTED(self)) {
+  if (new_flags & SOCKET_STATE_FSHUTWR) {
+   REF TcpSocket *peer = TcpSocket_GetPeer(self);
+   /* Send EOF to the other end. */
+   if (peer) {
+    packetbuffer_close(&peer->ts_inet.is_rx);
+    socket_decref(&peer->ts_inet.is_socket);
+   }
+  }
+ }
+ if (new_flags & SOCKET_STATE_FSHUTRD)
+     packetbuffer_close(&self->ts_inet.is_rx);
+}
+
+PRIVATE void KCALL
+TcpSocket_Bind(TcpSocket *__restrict self,
+               USER CHECKED struct sockaddr const *addr,
+               socklen_t addr_len, iomode_t UNUSED(mode)) {
+ struct inet_addr local;
+ inet_getaddr(&local,INET_FAMILY(&self->ts_inet),addr,addr_len);
+ inet_bind(&self->ts_inet,&inet_tcp_ports,&local);
+}
+
+PRIVATE void KCALL
+TcpSocket_Connect(TcpSocket *__restrict self,
+                  USER CHECKED struct sockaddr const *addr,
+                  socklen_t addr_len, iomode_t UNUSED(mode)) {
+ struct inet_addr dst;
+ REF TcpSocket *EXCEPT_VAR server;
+ REF TcpSocket *accept;
+ bool is_first_connection;
+ inet_getaddr(&dst,INET_FAMILY(&self->ts_inet),addr,addr_len);
+ inet_route(&dst);
+ if (!(self->ts_inet.is_socket.s_state & SOCKET_STATE_FBOUND)) {
+  /* Automatically bind the socket to an ephemeral port. */
+  struct inet_addr local;
+  memset(&local,0,sizeof(struct inet_addr));
+  local.ia_family = INET_FAMILY(&self->ts_inet);
+  inet_addr_setlocal(&local,&dst);
+  inet_bind(&self->ts_inet,&inet_tcp_ports,&local);
+ }
+ server = (REF TcpSocket *)inet_lookup(&inet_tcp_ports,&dst);
+ if (!server) /* Nothing bound to this port. */
+      error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+ TRY {
+  if (!TCP_ISLISTENING(server))
+       error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+  /* Construct the socket that will be returned by `accept()' */
+  accept = (REF TcpSocket *)inet_socket_alloc(server->ts_inet.is_socket.s_domain,
+                                              server->ts_inet.is_socket.s_type,
+                                              server->ts_inet.is_socket.s_proto);
+  /* The accept-socket comes in a pre-connected, and pre-bound state. */
+  accept->ts_inet.is_socket.s_state |= (SOCKET_STATE_FCONNECTED|
+                                        SOCKET_STATE_FBOUND);
+  /* Inherit options from the listening socket. */
+  accept->ts_inet.is_rcvbuf = server->ts_inet.is_rcvbuf;
+  accept->ts_inet.is_sndbuf = server->ts_inet.is_sndbuf;
+  accept->ts_flags          = server->ts_flags;
+  accept->ts_mss            = server->ts_mss;
+  packetbuffer_setlimit(&accept->ts_inet.is_rx,accept->ts_inet.is_rcvbuf);
+  accept->ts_inet.is_local  = dst;
+  accept->ts_inet.is_remote = self->ts_inet.is_local;
+  accept->ts_inet.is_local.ia_family  = INET_FAMILY(&accept->ts_inet);
+  accept->ts_inet.is_remote.ia_family = INET_FAMILY(&accept->ts_inet);
+  /* Create the references that link the two ends of the connection. */
+  socket_weak_incref(&accept->ts_inet.is_socket);
+  socket_weak_incref(&self->ts_inet.is_socket);
+  accept->ts_conn.c_peer = self;   /* Inherit reference. */
+  self->ts_conn.c_peer   = accept; /* Inherit reference. */
+  self->ts_inet.is_remote = dst;
+  atomic_rwlock_write(&server->ts_listen.l_lock);
+  /* Check if the server is able to accept our new socket. */
+  if unlikely(server->ts_listen.l_length >= server->ts_listen.l_limit ||
+             (server->ts_inet.is_socket.s_state & SOCKET_STATE_FSHUTRD)) {
+   atomic_rwlock_endwrite(&server->ts_listen.l_lock);
+   ATOMIC_FETCHDEC(accept->ts_inet.is_socket.s_weakcnt);
+   ATOMIC_FETCHDEC(self->ts_inet.is_socket.s_weakcnt);
+   self->ts_conn.c_peer   = NULL;
+   accept->ts_conn.c_peer = NULL;
+   socket_decref(&accept->ts_inet.is_socket);
+   error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+  }
+  /* Insert the accept-socket into the server's pending chain,
+   * and have _it_ inherit our reference to that socket. */
+  LIST_INSERT(server->ts_listen.l_pending,accept,ts_pending); /* Inherit reference. */
+  is_first_connection = server->ts_listen.l_length == 0;
+  ++server->ts_listen.l_length;
+  atomic_rwlock_endwrite(&server->ts_listen.l_lock);
+  /* If it's the first connection, wake the server. */
+  if (is_first_connection)
+      sig_broadcast(&server->ts_listen.l_newcon);
+ } FINALLY {
+  socket_decref(&server->ts_inet.is_socket);
+ }
+}
+
+PRIVATE void KCALL
+TcpSocket_Listen(TcpSocket *__restrict self,
+                 unsigned int max_backlog, iomode_t UNUSED(mode)) {
+ /* `ts_listen' is still ZERO-initialized from construction. */
+ assert(!self->ts_listen.l_pending);
+ assert(!self->ts_listen.l_length);
+ self->ts_listen.l_limit = max_backlog;
+}
+
+PRIVATE REF TcpSocket *KCALL
+TcpSocket_Accept(TcpSocket *__restrict self, iomode_t mode) {
+ REF TcpSocket *result;
+ assert(TCP_ISLISTENING(self));
+ assert(!task_isconnected());
+again:
+ atomic_rwlock_write(&self->ts_listen.l_lock);
+ result = self->ts_listen.l_pending;
+ if (result) {
+  /* Remove the resulting socket from the chain. */
+  LIST_REMOVE(result,ts_pending); /* Inherit reference. */
+  assert(self->ts_listen.l_length);
+  --self->ts_listen.l_length;
+  atomic_rwlock_endwrite(&self->ts_listen.l_lock);
+  return result;
+ }
+ atomic_rwlock_endwrite(&self->ts_listen.l_lock);
+ if (mode & IO_NONBLOCK)
+     return NULL; /* No connections available. */
+ /* Connect to the signal used to indicate connection availability. */
+ task_connect(&self->ts_listen.l_newcon);
+ COMPILER_READ_BARRIER();
+ if (ATOMIC_READ(self->ts_listen.l_pending) != NULL) {
+  task_disconnect();
+  goto again;
+ }
+ task_wait();
+ goto again;
+}
+
+PRIVATE unsigned int KCALL
+TcpSocket_Poll(TcpSocket *__restrict self, unsigned int mode) {
+ unsigned int result = 0;
+ if (TCP_ISLISTENING(self)) {
+  /* Poll for incoming connections. */
+  if (mode & POLLIN) {
+   if (ATOMIC_READ(self->ts_listen.l_length))
+       result |= POLLIN;
+   else {
+    task_connect_ghost(&self->ts_listen.l_newcon);
+    COMPILER_READ_BARRIER();
+    if (ATOMIC_READ(self->ts_listen.l_length))
+        result |= POLLIN;
+   }
+  }
+ } else if (TCP_ISCONNECTED(self)) {
+  if ((mode & POLLIN) && packetbuffer_poll_nonempty(&self->ts_inet.is_rx))
+       result |= POLLIN;
+  if (mode & POLLOUT) {
+   REF TcpSocket *peer = TcpSocket_GetPeer(self);
+   if (!peer) {
+    /* Writes won't block once the connection was closed. */
+    result |= POLLOUT;
+   } else {
+    struct packetbuffer *rx = &peer->ts_inet.is_rx;
+    /* Writable while there is space in the peer's receive window. */
+    task_connect_ghost(&rx->pb_read);
+    if (ATOMIC_READ(rx->pb_state.pbs_count) < (ATOMIC_READ(rx->pb_limt) & PBUFFER_LIMT_FMASK) ||
+        packetbuffer_isclosed(rx))
+        result |= POLLOUT;
+    socket_decref(&peer->ts_inet.is_socket);
+   }
+  }
+ }
+ return result;
+}
+
+PRIVATE bool KCALL
+TcpSocket_Recv(TcpSocket *__restrict self,
+               USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+               iomode_t mode, packet_iomode_t packet_mode) {
+ size_t EXCEPT_VAR total = 0;
+ size_t bufsize = *pbufsize;
+ size_t part;
+ struct packetbuffer *rx = &self->ts_inet.is_rx;
+ if (packet_mode & PACKET_IO_FRDNEVER) {
+  /* Peek at the first segment in line. */
+  part = bufsize;
+  packetbuffer_readv(rx,iov,&part,mode,PACKET_IO_FRDNEVER);
+  *pbufsize = MIN(part,bufsize);
+  return *pbufsize != 0;
+ }
+ if unlikely(!bufsize)
+    return false;
+ /* Segment boundaries don't matter for a stream, so read
+  * as much of the queued data as we can in a single call. */
+ TRY {
+  for (;;) {
+   part = bufsize - total;
+   if (!packetbuffer_reada_vio(rx,iov,total,&part,NULL,NULL,mode,
+                               PACKET_IO_FRDIFFIT|PACKET_IO_FRDTRUNC))
+        break; /* EOF */
+   total += part;
+   if (total >= bufsize)
+       break;
+   if (!(packet_mode & PACKET_IO_FRDWAITALL)) {
+    /* Only keep reading segments that are already available. */
+    if (!ATOMIC_READ(rx->pb_state.pbs_count))
+         break;
+    mode |= IO_NONBLOCK;
+   }
+  }
+ } FINALLY {
+  if (FINALLY_WILL_RETHROW && total != 0 &&
+     (error_code() == E_WOULDBLOCK ||
+      error_code() == E_INTERRUPT)) {
+   /* Return what we've already got. */
+   error_handled();
+   *pbufsize = total;
+   return true;
+  }
+ }
+ *pbufsize = total;
+ return total != 0;
+}
+
+PRIVATE size_t KCALL
+TcpSocket_Send(TcpSocket *__restrict self,
+               USER CHECKED struct iovec const *iov, size_t num_bytes,
+               iomode_t mode, packet_iomode_t packet_mode) {
+ size_t EXCEPT_VAR result = 0;
+ REF TcpSocket *EXCEPT_VAR peer;
+ struct packetbuffer *rx;
+ size_t max_segment,part;
+ if unlikely(!num_bytes)
+    return 0; /* Don't send empty segments. */
+ peer = TcpSocket_GetPeer(self);
+ if unlikely(!peer)
+    socket_throw_broken_pipe(packet_mode); /* Connection was closed. */
+ TRY {
+  rx = &peer->ts_inet.is_rx;
+  /* The max segment size is limited by our MSS and send buffer,
+   * as well as the receive window of the other end. */
+  max_segment = self->ts_mss ? self->ts_mss : INET_TCP_DEFMSS;
+  if (max_segment > self->ts_inet.is_sndbuf)
+      max_segment = self->ts_inet.is_sndbuf;
+  part = (ATOMIC_READ(rx->pb_limt) & PBUFFER_LIMT_FMASK) - 2*PACKET_BUFFER_ALIGNMENT;
+  if (max_segment > part)
+      max_segment = part;
+  /* Nagle: Rather than sending lots of tiny segments, append small writes
+   *        to the last segment that hasn't been received yet. Since data is
+   *        delivered instantly, we don't need to delay anything to do this. */
+  if (num_bytes < max_segment &&
+    (!(self->ts_flags & TCP_SOCKET_FNODELAY) ||
+      (packet_mode & PACKET_IO_FWRMORE)) &&
+      packetbuffer_append_vio(rx,iov,0,num_bytes,max_segment,mode)) {
+   result = num_bytes;
+   inet_loopback_xmit(num_bytes);
+  } else {
+   /* Send the data as a sequence of segments. */
+   while (result < num_bytes) {
+    part = MIN(num_bytes - result,max_segment);
+    if (!packetbuffer_writea_vio(rx,iov,result,part,NULL,0,mode,0)) {
+     /* The other end was closed. */
+     if (result != 0) break; /* Return the number of bytes already sent. */
+     socket_throw_broken_pipe(packet_mode);
+    }
+    result += part;
+    inet_loopback_xmit(part);
+   }
+  }
+ } FINALLY {
+  socket_decref(&peer->ts_inet.is_socket);
+  if (FINALLY_WILL_RETHROW && result != 0 &&
+     (error_code() == E_WOULDBLOCK ||
+      error_code() == E_INTERRUPT)) {
+   /* Return the number of bytes already sent. */
+   error_handled();
+   return result;
+  }
+ }
+ return result;
+}
+
+
+PRIVATE socklen_t KCALL
+TcpSocket_GetSockOpt(TcpSocket *__restrict self,
+                     int level, int optname,
+                     USER CHECKED void *buf,
+                     socklen_t buflen, iomode_t mode) {
+ int value;
+ if (level != SOL_TCP)
+     return InetSocket_GetSockOpt(&self->ts_inet,level,optname,buf,buflen,mode);
+ switch (optname) {
+ case TCP_NODELAY:
+  value = (self->ts_flags & TCP_SOCKET_FNODELAY) ? 1 : 0;
+  break;
+ case TCP_MAXSEG:
+  value = self->ts_mss ? self->ts_mss : INET_TCP_DEFMSS;
+  break;
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+ memcpy(buf,&value,MIN(buflen,sizeof(int)));
+ return sizeof(int);
+}
+
+PRIVATE void KCALL
+TcpSocket_SetSockOpt(TcpSocket *__restrict self,
+                     int level, int optname,
+                     USER CHECKED void const *buf,
+                     socklen_t buflen, iomode_t mode) {
+ int value;
+ if (level != SOL_TCP) {
+  InetSocket_SetSockOpt(&self->ts_inet,level,optname,buf,buflen,mode);
+  return;
+ }
+ if (buflen != sizeof(int))
+     error_throw(E_INVALID_ARGUMENT);
+ memcpy(&value,buf,sizeof(int));
+ COMPILER_READ_BARRIER();
+ switch (optname) {
+ case TCP_NODELAY:
+  if (value)
+       self->ts_flags |= TCP_SOCKET_FNODELAY;
+  else self->ts_flags &= ~TCP_SOCKET_FNODELAY;
+  break;
+ case TCP_MAXSEG:
+  if (value < INET_TCP_MINMSS || value > INET_TCP_DEFMSS)
+      error_throw(E_INVALID_ARGUMENT);
+  self->ts_mss = (u16)value;
+  break;
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+}
+
+
+INTERN struct socket_ops tcp_socket_ops = {
+    .so_fini        = (void(KCALL *)(struct socket *__restrict))&TcpSocket_Fini,
+    .so_shutdown    = (void(KCALL *)(struct socket *__restrict,u16))&TcpSocket_Shutdown,
+    .so_connect     = (void(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr const *,socklen_t,iomode_t))&TcpSocket_Connect,
+    .so_bind        = (void(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr const *,socklen_t,iomode_t))&TcpSocket_Bind,
+    .so_listen      = (void(KCALL *)(struct socket *__restrict,unsigned int,iomode_t))&TcpSocket_Listen,
+    .so_accept      = (REF struct socket *(KCALL *)(struct socket *__restrict,iomode_t))&TcpSocket_Accept,
+    .so_poll        = (unsigned int(KCALL *)(struct socket *__restrict,unsigned int))&TcpSocket_Poll,
+    .so_getsockname = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&InetSocket_GetSockName,
+    .so_getpeername = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&InetSocket_GetPeerName,
+    .so_getsockopt  = (socklen_t(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void *,socklen_t,iomode_t))&TcpSocket_GetSockOpt,
+    .so_setsockopt  = (void(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void const *,socklen_t,iomode_t))&TcpSocket_SetSockOpt,
+    .so_recv        = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,iomode_t,packet_iomode_t))&TcpSocket_Recv,
+    .so_send        = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,iomode_t,packet_iomode_t))&TcpSocket_Send,
+};
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_INET_TCP_C */
@@ -0,0 +1,185 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_INET_UDP_C
+#define GUARD_KERNEL_MODULES_INET_UDP_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <net/socket.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <except.h>
+#include <bits/poll.h>
+
+#include "inet.h"
+
+DECL_BEGIN
+
+/* UDP sockets don't implement `so_connect()', meaning that the socket
+ * layer keeps track of the connected peer address in `s_peeraddr', and
+ * forwards `send()' to `UdpSocket_SendTo()'. Since the layer would compare
+ * sender addresses byte-wise (which doesn't work when the same address can
+ * be written in more than one way, e.g. `0.0.0.0' vs. `127.0.0.1'), we do
+ * implement `so_recv()' to filter datagrams by their normalized sender. */
+
+PRIVATE void KCALL
+UdpSocket_Fini(InetSocket *__restrict self) {
+ inet_unbind(self);
+ packetbuffer_fini(&self->is_rx);
+}
+
+PRIVATE void KCALL
+UdpSocket_Shutdown(InetSocket *__restrict self, u16 new_flags) {
+ if (new_flags & SOCKET_STATE_FSHUTRD)
+     packetbuffer_close(&self->is_rx);
+}
+
+PRIVATE void KCALL
+UdpSocket_Bind(InetSocket *__restrict self,
+               USER CHECKED struct sockaddr const *addr,
+               socklen_t addr_len, iomode_t UNUSED(mode)) {
+ struct inet_addr local;
+ inet_getaddr(&local,INET_FAMILY(self),addr,addr_len);
+ inet_bind(self,&inet_udp_ports,&local);
+}
+
+PRIVATE unsigned int KCALL
+UdpSocket_Poll(InetSocket *__restrict self, unsigned int mode) {
+ unsigned int result = 0;
+ if ((mode & POLLIN) && packetbuffer_poll_nonempty(&self->is_rx))
+      result |= POLLIN;
+ /* Datagrams are never queued on the sending side. */
+ if (mode & POLLOUT)
+     result |= POLLOUT;
+ return result;
+}
+
+PRIVATE size_t KCALL
+UdpSocket_SendTo(InetSocket *__restrict self,
+                 USER CHECKED struct iovec const *iov, size_t num_bytes,
+                 USER CHECKED struct sockaddr const *addrbuf, socklen_t addrlen,
+                 iomode_t mode, packet_iomode_t UNUSED(packet_mode)) {
+ struct inet_addr dst,src;
+ REF InetSocket *EXCEPT_VAR peer;
+ if unlikely(num_bytes > INET_UDP_MAXPAYLOAD)
+    error_throwf(E_NET_ERROR,ERROR_NET_PACKET_TOO_LARGE);
+ inet_getaddr(&dst,INET_FAMILY(self),addrbuf,addrlen);
+ inet_route(&dst);
+ /* Automatically bind the socket to an ephemeral port. */
+ if (!(ATOMIC_READ(self->is_socket.s_state) & SOCKET_STATE_FBOUND))
+       inet_autobind(self,&inet_udp_ports);
+ src = self->is_local;
+ if (INET_ADDR_ISANY(&src))
+     inet_addr_setlocal(&src,&dst);
+ peer = inet_lookup(&inet_udp_ports,&dst);
+ if (!peer) {
+  /* Nobody's listening (A real interface would send ICMP port-unreachable) */
+  inet_loopback_drop();
+  return num_bytes;
+ }
+ TRY {
+  /* Deliver the datagram directly into the receiver's buffer.
+   * UDP is unreliable, so if it's full, we simply drop the packet. */
+  if (packetbuffer_writeva(&peer->is_rx,iov,num_bytes,
+                           &src,sizeof(struct inet_addr),
+                           mode|IO_NONBLOCK,0) == num_bytes)
+      inet_loopback_xmit(num_bytes);
+  else inet_loopback_drop();
+ } FINALLY {
+  socket_decref(&peer->is_socket);
+  if (FINALLY_WILL_RETHROW &&
+     (error_code() == E_WOULDBLOCK ||
+      error_code() == E_NET_ERROR)) {
+   /* The receiver's buffer is full, or too small to ever fit the datagram. */
+   error_handled();
+   inet_loopback_drop();
+   return num_bytes;
+  }
+ }
+ return num_bytes;
+}
+
+PRIVATE bool KCALL
+UdpSocket_RecvFrom(InetSocket *__restrict self,
+                   USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+                   USER CHECKED struct sockaddr *addrbuf, socklen_t *__restrict paddrlen,
+                   iomode_t mode, packet_iomode_t packet_mode) {
+ bool result;
+ struct inet_addr src;
+ size_t ancsize = sizeof(struct inet_addr);
+ /* Datagrams are always read as a whole (excess data is discarded) */
+ packet_mode &= PACKET_IO_FRDNEVER;
+ result = packetbuffer_readva(&self->is_rx,iov,pbufsize,
+                              &src,&ancsize,mode,packet_mode);
+ if (result && ancsize == sizeof(struct inet_addr)) {
+  *paddrlen = inet_putaddr(&src,INET_FAMILY(self),addrbuf,*paddrlen);
+ } else {
+  *paddrlen = 0;
+ }
+ return result;
+}
+
+PRIVATE bool KCALL
+UdpSocket_Recv(InetSocket *__restrict self,
+               USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+               iomode_t mode, packet_iomode_t packet_mode) {
+ bool result;
+ struct inet_addr peer,src;
+ size_t bufsize = *pbufsize;
+ size_t ancsize;
+ inet_getaddr(&peer,INET_FAMILY(self),
+             (struct sockaddr *)&self->is_socket.s_peeraddr,
+              self->is_socket.s_peeraddr_len);
+ inet_route(&peer);
+ packet_mode &= PACKET_IO_FRDNEVER;
+ for (;;) {
+  *pbufsize = bufsize;
+  ancsize   = sizeof(struct inet_addr);
+  result = packetbuffer_readva(&self->is_rx,iov,pbufsize,
+                               &src,&ancsize,mode,packet_mode);
+  /* Only accept datagrams from the connected peer. */
+  if (!result || ancsize != sizeof(struct inet_addr))
+      break;
+  if (src.ia_port == peer.ia_port &&
+      memcmp(src.ia_addr8,peer.ia_addr8,16) == 0)
+      break;
+  /* Discard datagrams from other senders. */
+ }
+ return result;
+}
+
+
+INTERN struct socket_ops udp_socket_ops = {
+    .so_fini        = (void(KCALL *)(struct socket *__restrict))&UdpSocket_Fini,
+    .so_shutdown    = (void(KCALL *)(struct socket *__restrict,u16))&UdpSocket_Shutdown,
+    .so_bind        = (void(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr const *,socklen_t,iomode_t))&UdpSocket_Bind,
+    .so_poll        = (unsigned int(KCALL *)(struct socket *__restrict,unsigned int))&UdpSocket_Poll,
+    .so_getsockname = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&InetSocket_GetSockName,
+    .so_getsockopt  = (socklen_t(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void *,socklen_t,iomode_t))&InetSocket_GetSockOpt,
+    .so_setsockopt  = (void(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void const *,socklen_t,iomode_t))&InetSocket_SetSockOpt,
+    .so_recv        = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,iomode_t,packet_iomode_t))&UdpSocket_Recv,
+    .so_recvfrom    = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,USER CHECKED struct sockaddr *,socklen_t *__restrict,iomode_t,packet_iomode_t))&UdpSocket_RecvFrom,
+    .so_sendto      = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,USER CHECKED struct sockaddr const *,socklen_t,iomode_t,packet_iomode_t))&UdpSocket_SendTo,
+};
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_INET_UDP_C */
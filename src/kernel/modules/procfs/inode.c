@@ -235,6 +235,31 @@ ProcFS_OpenNode(struct inode *__restrict node,
      node->i_ops = &Iprocfs_thread_self_link;
      break;
 
+    case PROCFS_INODE_STAT:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintStat);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
+    case PROCFS_INODE_MEMINFO:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintMeminfo);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
+    case PROCFS_INODE_VMSTAT:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintVmstat);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
+    case PROCFS_INODE_INTERRUPTS:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintInterrupts);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
+    case PROCFS_INODE_SOFTIRQS:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintSoftirqs);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
     default: goto invalid_pid;
     }
    } else {
@@ -288,6 +313,16 @@ ProcFS_OpenNode(struct inode *__restrict node,
      node->i_ops = &Iprocfs_p_task_dir;
      break;
 
+    case PROCFS_INODE_P_STAT:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintPStat);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
+    case PROCFS_INODE_P_SCHEDSTAT:
+     node->i_fsdata = PROCFS_PRINTER_DATA(&ProcFS_PrintPSchedstat);
+     node->i_ops    = &Iprocfs_printer;
+     break;
+
     default: goto invalid_pid;
     }
    }
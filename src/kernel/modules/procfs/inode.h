@@ -21,6 +21,7 @@
 
 #include <hybrid/compiler.h>
 #include <fs/node.h>
+#include <format-printer.h>
 
 DECL_BEGIN
 
@@ -145,6 +146,11 @@ DECL_BEGIN
 #define PROCFS_INODE_CMDLINE       0x0001 /* [-] /proc/cmdline */
 #define PROCFS_INODE_SELF          0x0002 /* [l] /proc/self */
 #define PROCFS_INODE_THREAD_SELF   0x0003 /* [l] /proc/thread-self */
+#define PROCFS_INODE_STAT          0x0004 /* [-] /proc/stat */
+#define PROCFS_INODE_MEMINFO       0x0005 /* [-] /proc/meminfo */
+#define PROCFS_INODE_VMSTAT        0x0006 /* [-] /proc/vmstat */
+#define PROCFS_INODE_INTERRUPTS    0x0007 /* [-] /proc/interrupts */
+#define PROCFS_INODE_SOFTIRQS      0x0008 /* [-] /proc/softirqs */
 
 #define PROCFS_INODE_P             0x0000 /* [d] /proc/[PID]/ */
 #define PROCFS_INODE_P_CMDLINE     0x0001 /* [-] /proc/[PID]/cmdline */
@@ -154,6 +160,8 @@ DECL_BEGIN
 #define PROCFS_INODE_P_ENVIRON     0x0005 /* [-] /proc/[PID]/environ */
 #define PROCFS_INODE_P_FD          0x0006 /* [d] /proc/[PID]/fd/ */
 #define PROCFS_INODE_P_TASK        0x0007 /* [d] /proc/[PID]/task/ */
+#define PROCFS_INODE_P_STAT        0x0008 /* [-] /proc/[PID]/stat */
+#define PROCFS_INODE_P_SCHEDSTAT   0x0009 /* [-] /proc/[PID]/schedstat */
 
 
 struct pidns;
@@ -221,6 +229,23 @@ INTDEF ATTR_RETNONNULL struct inode_data *KCALL
 ProcFS_OpenRwText(/*inherit(kfree())*/void *data, size_t num_bytes);
 
 
+/* Printer for the contents of a dynamically generated text file.
+ * The text is re-generated every time the file is read from. */
+typedef void (KCALL *procfs_printer_t)(struct inode *__restrict node,
+                                       pformatprinter printer, void *closure);
+INTDEF struct inode_operations Iprocfs_printer; /* [-] ... (`node->i_fsdata' is a `procfs_printer_t') */
+#define PROCFS_PRINTER_DATA(func) ((struct inode_data *)(void *)(procfs_printer_t)(func))
+
+/* Printers for telemetry files. */
+INTDEF void KCALL ProcFS_PrintStat(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintMeminfo(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintVmstat(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintInterrupts(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintSoftirqs(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintPStat(struct inode *__restrict node, pformatprinter printer, void *closure);
+INTDEF void KCALL ProcFS_PrintPSchedstat(struct inode *__restrict node, pformatprinter printer, void *closure);
+
+
 INTDEF struct inode_operations Iprocfs_path_link;        /* [l] ... (`node->i_fsdata' is a `REF struct path *'; this link expands to the string of that path) */
 INTDEF struct inode_operations Iprocfs_root_dir;         /* /proc/ */
 INTDEF struct inode_operations Iprocfs_self_link;        /* /proc/self */
@@ -120,6 +120,33 @@ INTERN struct inode_operations Iprocfs_text_rw = {
 
 
 
+PRIVATE size_t KCALL
+PrinterFile_PRead(struct inode *__restrict self,
+                  CHECKED USER void *buf, size_t bufsize,
+                  pos_t pos, iomode_t UNUSED(flags)) {
+ struct stringprinter printer; size_t result = 0;
+ StringPrinter_Init(&printer,512);
+ TRY {
+  size_t textlen;
+  (*(procfs_printer_t)(void *)self->i_fsdata)(self,&StringPrinter_Print,&printer);
+  textlen = (size_t)(printer.sp_bufpos-printer.sp_buffer);
+  if (pos < textlen) {
+   result = MIN(textlen-(size_t)pos,bufsize);
+   memcpy(buf,printer.sp_buffer+(size_t)pos,result);
+  }
+ } FINALLY {
+  StringPrinter_Fini(&printer);
+ }
+ return result;
+}
+
+INTERN struct inode_operations Iprocfs_printer = {
+    .io_file = {
+        .f_pread = &PrinterFile_PRead,
+    }
+};
+
+
 
 PRIVATE ATTR_NOTHROW void KCALL
 PathLink_Fini(struct inode *__restrict self) {
@@ -186,7 +213,6 @@ INTERN struct inode_operations Iprocfs_thread_self_link = {
 };
 
 
-INTERN struct inode_operations Iprocfs_p_root_dir = {};       /* /proc/[PID]/ */
 INTERN struct inode_operations Iprocfs_p_fd_dir = {};         /* /proc/[PID]/fd/ */
 INTERN struct inode_operations Iprocfs_p_fd_link = {};        /* /proc/[PID]/fd/xxx */
 INTERN struct inode_operations Iprocfs_p_task_dir = {};       /* /proc/[PID]/task/ */
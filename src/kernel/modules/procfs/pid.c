@@ -0,0 +1,182 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_PROCFS_PID_C
+#define GUARD_KERNEL_MODULES_PROCFS_PID_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <kernel/malloc.h>
+#include <fs/node.h>
+#include <fs/path.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "inode.h"
+
+DECL_BEGIN
+
+
+/* NOTE: The INode numbers of these entries don't contain the PID.
+ *       Lookup creates a copy of the directory entry that does. */
+/*[[[deemon STATIC_DIRECTORY("PRIVATE","pid_directory",{
+    "cmdline"   : [ "DT_REG", "PROCFS_INODE_P_CMDLINE" ],
+    "exe"       : [ "DT_LNK", "PROCFS_INODE_P_EXE" ],
+    "cwd"       : [ "DT_LNK", "PROCFS_INODE_P_CWD" ],
+    "root"      : [ "DT_LNK", "PROCFS_INODE_P_ROOT" ],
+    "environ"   : [ "DT_REG", "PROCFS_INODE_P_ENVIRON" ],
+    "fd"        : [ "DT_DIR", "PROCFS_INODE_P_FD" ],
+    "task"      : [ "DT_DIR", "PROCFS_INODE_P_TASK" ],
+    "stat"      : [ "DT_REG", "PROCFS_INODE_P_STAT" ],
+    "schedstat" : [ "DT_REG", "PROCFS_INODE_P_SCHEDSTAT" ],
+});]]]*/
+#if __SIZEOF_POINTER__ == 4
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_0,"schedstat",0x831f865bul,DT_REG,PROCFS_INODE_P_SCHEDSTAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_2,"root",0x17eaeb02ul,DT_LNK,PROCFS_INODE_P_ROOT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_3,"cwd",0x647763ul,DT_LNK,PROCFS_INODE_P_CWD);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_4,"cmdline",0xcfed46e4ul,DT_REG,PROCFS_INODE_P_CMDLINE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_5,"exe",0x657865ul,DT_LNK,PROCFS_INODE_P_EXE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_6,"fd",0x6466ul,DT_DIR,PROCFS_INODE_P_FD);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_9,"task",0xc70e6d14ul,DT_DIR,PROCFS_INODE_P_TASK);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_11,"stat",0x176d180bul,DT_REG,PROCFS_INODE_P_STAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_15,"environ",0xb59850fful,DT_REG,PROCFS_INODE_P_ENVIRON);
+PRIVATE struct directory_entry *const pid_directory[] = {
+    (struct directory_entry *)&pid_directory_0,
+    NULL,
+    (struct directory_entry *)&pid_directory_2,
+    (struct directory_entry *)&pid_directory_3,
+    (struct directory_entry *)&pid_directory_4,
+    (struct directory_entry *)&pid_directory_5,
+    (struct directory_entry *)&pid_directory_6,
+    NULL,
+    NULL,
+    (struct directory_entry *)&pid_directory_9,
+    NULL,
+    (struct directory_entry *)&pid_directory_11,
+    NULL,
+    NULL,
+    NULL,
+    (struct directory_entry *)&pid_directory_15,
+};
+#else
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_0,"cwd",0x647763ull,DT_LNK,PROCFS_INODE_P_CWD);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_1,"stat",0x74617473ull,DT_REG,PROCFS_INODE_P_STAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_2,"root",0x746f6f72ull,DT_LNK,PROCFS_INODE_P_ROOT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_3,"cmdline",0x656e696c646d63ull,DT_REG,PROCFS_INODE_P_CMDLINE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_4,"task",0x6b736174ull,DT_DIR,PROCFS_INODE_P_TASK);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_5,"exe",0x657865ull,DT_LNK,PROCFS_INODE_P_EXE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_6,"fd",0x6466ull,DT_DIR,PROCFS_INODE_P_FD);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_11,"schedstat",0x6d180e8790ab7f7full,DT_REG,PROCFS_INODE_P_SCHEDSTAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(pid_directory_15,"environ",0x6e6f7269766e65ull,DT_REG,PROCFS_INODE_P_ENVIRON);
+PRIVATE struct directory_entry *const pid_directory[] = {
+    (struct directory_entry *)&pid_directory_0,
+    (struct directory_entry *)&pid_directory_1,
+    (struct directory_entry *)&pid_directory_2,
+    (struct directory_entry *)&pid_directory_3,
+    (struct directory_entry *)&pid_directory_4,
+    (struct directory_entry *)&pid_directory_5,
+    (struct directory_entry *)&pid_directory_6,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    (struct directory_entry *)&pid_directory_11,
+    NULL,
+    NULL,
+    NULL,
+    (struct directory_entry *)&pid_directory_15,
+};
+#endif
+//[[[end]]]
+
+
+PRIVATE REF struct directory_entry *KCALL
+PidDir_MakeEntry(struct directory_node *__restrict self,
+                 struct directory_entry *__restrict entry) {
+ REF struct directory_entry *result;
+ result = (REF struct directory_entry *)kmalloc(offsetof(struct directory_entry,de_name)+
+                                               (entry->de_namelen+1)*sizeof(char),
+                                                GFP_SHARED);
+ result->de_refcnt  = 1;
+ result->de_namelen = entry->de_namelen;
+ result->de_type    = entry->de_type;
+ result->de_hash    = entry->de_hash;
+ result->de_ino     = PROCFS_INODE_MKINO(PROCFS_INODE_GTPID(self->d_node.i_attr.a_ino),
+                                         PROCFS_CLASS_FNORMAL,entry->de_ino);
+ memcpy(result->de_name,entry->de_name,(entry->de_namelen+1)*sizeof(char));
+ return result;
+}
+
+PRIVATE REF struct directory_entry *KCALL
+PidDir_Lookup(struct directory_node *__restrict self,
+              CHECKED USER char const *__restrict name,
+              u16 namelen, uintptr_t hash, unsigned int mode) {
+ struct directory_entry *entry;
+ u32 perturb,i;
+ perturb = i = hash & (COMPILER_LENOF(pid_directory)-1);
+ for (;; i = ((i << 2) + i + perturb + 1),perturb >>= 5) {
+  entry = pid_directory[i & (COMPILER_LENOF(pid_directory)-1)];
+  if (!entry) break;
+  if (entry->de_hash != hash) continue;
+  if (entry->de_namelen != namelen) continue;
+  if (memcmp(entry->de_name,name,namelen*sizeof(char)) != 0) continue;
+found_it:
+  return PidDir_MakeEntry(self,entry);
+ }
+ if (mode & FS_MODE_FDOSPATH) {
+  /* Do another (case-insensitive) search. */
+  for (i = 0; i < COMPILER_LENOF(pid_directory); ++i) {
+   if ((entry = pid_directory[i]) == NULL) continue;
+   if (entry->de_namelen != namelen) continue;
+   if (memcasecmp(entry->de_name,name,namelen*sizeof(char)) != 0) continue;
+   goto found_it;
+  }
+ }
+ return NULL;
+}
+
+PRIVATE void KCALL
+PidDir_Enum(struct directory_node *__restrict node,
+            directory_enum_callback_t callback, void *arg) {
+ unsigned int i;
+ pid_t pid = PROCFS_INODE_GTPID(node->d_node.i_attr.a_ino);
+ for (i = 0; i < COMPILER_LENOF(pid_directory); ++i) {
+  if (!pid_directory[i]) continue;
+  (*callback)(pid_directory[i]->de_name,
+              pid_directory[i]->de_namelen,
+              pid_directory[i]->de_type,
+              PROCFS_INODE_MKINO(pid,PROCFS_CLASS_FNORMAL,
+                                 pid_directory[i]->de_ino),
+              arg);
+ }
+}
+
+
+INTERN struct inode_operations Iprocfs_p_root_dir = {
+    /* /proc/[PID]/ */
+    .io_directory = {
+        .d_oneshot = {
+            .o_lookup = &PidDir_Lookup,
+            .o_enum   = &PidDir_Enum,
+        }
+    }
+};
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_PROCFS_PID_C */
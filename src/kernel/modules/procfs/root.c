@@ -27,6 +27,9 @@
 #include <sched/group.h>
 #include <sched/pid.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <except.h>
+#include <kernel/malloc.h>
 
 #include "inode.h"
 
@@ -37,32 +40,63 @@ DECL_BEGIN
     "cmdline"     : [ "DT_REG", "PROCFS_INODE_CMDLINE" ],
     "self"        : [ "DT_LNK", "PROCFS_INODE_SELF" ],
     "thread-self" : [ "DT_LNK", "PROCFS_INODE_THREAD_SELF" ],
+    "stat"        : [ "DT_REG", "PROCFS_INODE_STAT" ],
+    "meminfo"     : [ "DT_REG", "PROCFS_INODE_MEMINFO" ],
+    "vmstat"      : [ "DT_REG", "PROCFS_INODE_VMSTAT" ],
+    "interrupts"  : [ "DT_REG", "PROCFS_INODE_INTERRUPTS" ],
+    "softirqs"    : [ "DT_REG", "PROCFS_INODE_SOFTIRQS" ],
 });]]]*/
 #if __SIZEOF_POINTER__ == 4
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_0,"meminfo",0xb547f743ul,DT_REG,PROCFS_INODE_MEMINFO);
 PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_2,"thread-self",0x26320082ul,DT_LNK,PROCFS_INODE_THREAD_SELF);
-PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_3,"self",0x99cf910bul,DT_LNK,PROCFS_INODE_SELF);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_3,"stat",0x176d180bul,DT_REG,PROCFS_INODE_STAT);
 PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_4,"cmdline",0xcfed46e4ul,DT_REG,PROCFS_INODE_CMDLINE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_7,"vmstat",0x180f4d87ul,DT_REG,PROCFS_INODE_VMSTAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_9,"softirqs",0xe3664914ul,DT_REG,PROCFS_INODE_SOFTIRQS);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_11,"self",0x99cf910bul,DT_LNK,PROCFS_INODE_SELF);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_15,"interrupts",0xdf868aful,DT_REG,PROCFS_INODE_INTERRUPTS);
 PRIVATE struct directory_entry *const root_directory[] = {
-    NULL,
+    (struct directory_entry *)&root_directory_0,
     NULL,
     (struct directory_entry *)&root_directory_2,
     (struct directory_entry *)&root_directory_3,
     (struct directory_entry *)&root_directory_4,
     NULL,
     NULL,
+    (struct directory_entry *)&root_directory_7,
+    NULL,
+    (struct directory_entry *)&root_directory_9,
+    NULL,
+    (struct directory_entry *)&root_directory_11,
+    NULL,
     NULL,
+    NULL,
+    (struct directory_entry *)&root_directory_15,
 };
 #else
 PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_0,"self",0x666c6573ull,DT_LNK,PROCFS_INODE_SELF);
-PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_1,"thread-self",0xc98876c916c1879ull,DT_LNK,PROCFS_INODE_THREAD_SELF);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_1,"stat",0x74617473ull,DT_REG,PROCFS_INODE_STAT);
 PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_3,"cmdline",0x656e696c646d63ull,DT_REG,PROCFS_INODE_CMDLINE);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_5,"interrupts",0xf421060591185525ull,DT_REG,PROCFS_INODE_INTERRUPTS);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_6,"vmstat",0x746174736d76ull,DT_REG,PROCFS_INODE_VMSTAT);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_9,"thread-self",0xc98876c916c1879ull,DT_LNK,PROCFS_INODE_THREAD_SELF);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_11,"softirqs",0xefd05b51799eb0bull,DT_REG,PROCFS_INODE_SOFTIRQS);
+PRIVATE DEFINE_DIRECTORY_ENTRY(root_directory_13,"meminfo",0x6f666e696d656dull,DT_REG,PROCFS_INODE_MEMINFO);
 PRIVATE struct directory_entry *const root_directory[] = {
     (struct directory_entry *)&root_directory_0,
     (struct directory_entry *)&root_directory_1,
     NULL,
     (struct directory_entry *)&root_directory_3,
     NULL,
+    (struct directory_entry *)&root_directory_5,
+    (struct directory_entry *)&root_directory_6,
+    NULL,
+    NULL,
+    (struct directory_entry *)&root_directory_9,
     NULL,
+    (struct directory_entry *)&root_directory_11,
+    NULL,
+    (struct directory_entry *)&root_directory_13,
     NULL,
     NULL,
 };
@@ -104,8 +138,25 @@ found_it:
     if unlikely(__builtin_add_overflow(pid,ch-'0',&pid))
        goto not_a_pid;
    }
-   /* TODO: Lookup the directory entry of the given PID.
-    *       (Use the `struct thread_pid::tp_procfsent' cache) */
+   /* TODO: Use the `struct thread_pid::tp_procfsent' cache */
+   TRY {
+    REF struct thread_pid *tpid;
+    tpid = pidns_lookup(self->d_node.i_super->s_fsdata->pf_pidns,pid);
+    thread_pid_decref(tpid);
+   } CATCH_HANDLED (E_PROCESS_EXITED) {
+    goto not_a_pid;
+   }
+   result = (REF struct directory_entry *)kmalloc(offsetof(struct directory_entry,de_name)+
+                                                 (namelen+1)*sizeof(char),
+                                                  GFP_SHARED);
+   result->de_refcnt  = 1;
+   result->de_namelen = namelen;
+   result->de_type    = DT_DIR;
+   result->de_hash    = hash;
+   result->de_ino     = PROCFS_INODE_MKINO(pid,PROCFS_CLASS_FNORMAL,PROCFS_INODE_P);
+   memcpy(result->de_name,name,namelen*sizeof(char));
+   result->de_name[namelen] = 0;
+   return result;
   }
  }
 not_a_pid:
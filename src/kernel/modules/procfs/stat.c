@@ -0,0 +1,377 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_PROCFS_STAT_C
+#define GUARD_KERNEL_MODULES_PROCFS_STAT_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <kernel/memory.h>
+#include <kernel/vm.h>
+#include <fs/node.h>
+#include <fs/path.h>
+#include <fs/linker.h>
+#include <sched/task.h>
+#include <sched/taskref.h>
+#include <sched/group.h>
+#include <sched/pid.h>
+#include <sched/stat.h>
+#include <sched/cputime.h>
+#include <sched/softirq.h>
+#include <format-printer.h>
+#include <string.h>
+#include <except.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <i386-kos/pic.h>
+#endif
+
+#include "inode.h"
+
+DECL_BEGIN
+
+/* Clock ticks, as reported by `sysconf(_SC_CLK_TCK)' (and used by `times()') */
+#define PROCFS_CLK_TCK         1000000
+#define JIFFIES_TO_CLK_TCK(x) ((u64)(x)*(PROCFS_CLK_TCK/HZ))
+
+/* All of these files are generated from counters that are maintained
+ * anyways (per-CPU, or per-task), meaning that reading them never has
+ * to lock anything more than the task being described. */
+
+PRIVATE void KCALL
+ProcFS_GetCpuStat(cpuid_t id, struct cpustat *__restrict result) {
+#ifndef CONFIG_NO_TASKSTAT
+ memcpy(result,&FORCPU(cpu_vector[id],_this_cpustat),sizeof(struct cpustat));
+ /* Idle time is also accounted as system time. */
+ if unlikely(result->cs_idle > result->cs_system)
+    result->cs_idle = result->cs_system;
+ result->cs_system -= result->cs_idle;
+#else
+ memset(result,0,sizeof(struct cpustat));
+#endif
+}
+
+
+/* /proc/stat */
+INTERN void KCALL
+ProcFS_PrintStat(struct inode *__restrict UNUSED(node),
+                 pformatprinter printer, void *closure) {
+ struct cpustat total,st; cpuid_t i;
+ uintptr_t num_intr = 0;
+ memset(&total,0,sizeof(struct cpustat));
+ for (i = 0; i < cpu_count; ++i) {
+  ProcFS_GetCpuStat(i,&st);
+  total.cs_user   += st.cs_user;
+  total.cs_system += st.cs_system;
+  total.cs_idle   += st.cs_idle;
+ }
+ /* The counters are sampled once per jiffy, but must be printed in
+  * clock ticks (`sysconf(_SC_CLK_TCK)'), which are microseconds. */
+ format_printf(printer,closure,"cpu  %I64u 0 %I64u %I64u 0 0 0 0 0 0\n",
+               JIFFIES_TO_CLK_TCK(total.cs_user),
+               JIFFIES_TO_CLK_TCK(total.cs_system),
+               JIFFIES_TO_CLK_TCK(total.cs_idle));
+ for (i = 0; i < cpu_count; ++i) {
+  ProcFS_GetCpuStat(i,&st);
+  format_printf(printer,closure,"cpu%u %I64u 0 %I64u %I64u 0 0 0 0 0 0\n",
+               (unsigned int)i,
+               JIFFIES_TO_CLK_TCK(st.cs_user),
+               JIFFIES_TO_CLK_TCK(st.cs_system),
+               JIFFIES_TO_CLK_TCK(st.cs_idle));
+ }
+ /* Timer interrupts. */
+ num_intr = total.cs_user+total.cs_system+total.cs_idle;
+#if defined(__i386__) || defined(__x86_64__)
+ for (i = 0; i < cpu_count; ++i) {
+  unsigned int line;
+  for (line = 0; line < 16; ++line)
+      num_intr += FORCPU(cpu_vector[i],x86_pic_interrupts)[line];
+ }
+#endif
+ format_printf(printer,closure,"intr %Iu\n",num_intr);
+}
+
+
+/* /proc/meminfo */
+INTERN void KCALL
+ProcFS_PrintMeminfo(struct inode *__restrict UNUSED(node),
+                    pformatprinter printer, void *closure) {
+ size_t i,total = 0,free = 0;
+ for (i = 0; i < mzone_count; ++i) {
+  size_t zone_free = ATOMIC_READ(mzones[i]->mz_free);
+  total += ATOMIC_READ(mzones[i]->mz_used)+zone_free;
+  free  += zone_free;
+ }
+#define KB(num_pages) ((num_pages)*(PAGESIZE/1024))
+ format_printf(printer,closure,
+               "MemTotal:       %8Iu kB\n"
+               "MemFree:        %8Iu kB\n"
+               "MemAvailable:   %8Iu kB\n"
+               "SwapTotal:      %8u kB\n"
+               "SwapFree:       %8u kB\n"
+               "Hugepagesize:   %8Iu kB\n",
+               KB(total),KB(free),KB(free),0,0,
+               KB(pagedir_hugepages));
+#undef KB
+}
+
+
+/* /proc/vmstat */
+INTERN void KCALL
+ProcFS_PrintVmstat(struct inode *__restrict UNUSED(node),
+                   pformatprinter printer, void *closure) {
+ struct cpustat st; cpuid_t i;
+ uintptr_t pgfault = 0,pgcow = 0;
+ uintptr_t thpalloc = 0,thpfallback = 0,thpsplit = 0;
+ size_t free = 0;
+ for (i = 0; i < cpu_count; ++i) {
+  ProcFS_GetCpuStat(i,&st);
+  pgfault     += st.cs_pgfault;
+  pgcow       += st.cs_pgcow;
+  thpalloc    += st.cs_thpalloc;
+  thpfallback += st.cs_thpfallback;
+  thpsplit    += st.cs_thpsplit;
+ }
+ for (i = 0; i < mzone_count; ++i)
+     free += ATOMIC_READ(mzones[i]->mz_free);
+ /* There is no swap (yet), so those counters are always ZERO. */
+ format_printf(printer,closure,
+               "nr_free_pages %Iu\n"
+               "pgfault %Iu\n"
+               "pgcow %Iu\n"
+               "pswpin 0\n"
+               "pswpout 0\n"
+               "thp_fault_alloc %Iu\n"
+               "thp_fault_fallback %Iu\n"
+               "thp_split %Iu\n",
+               free,pgfault,pgcow,
+               thpalloc,thpfallback,thpsplit);
+}
+
+
+/* /proc/interrupts */
+INTERN void KCALL
+ProcFS_PrintInterrupts(struct inode *__restrict UNUSED(node),
+                       pformatprinter printer, void *closure) {
+ struct cpustat st; cpuid_t i;
+ format_printf(printer,closure,"    ");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %10s%-u",
+                   "CPU",(unsigned int)i);
+ format_printf(printer,closure,"\n  0:");
+ for (i = 0; i < cpu_count; ++i) {
+  ProcFS_GetCpuStat(i,&st);
+  format_printf(printer,closure," %10Iu",
+                st.cs_user+st.cs_system+st.cs_idle);
+ }
+ format_printf(printer,closure,"  timer\n");
+#if defined(__i386__) || defined(__x86_64__)
+ {
+  unsigned int line;
+  for (line = 1; line < 16; ++line) {
+   u32 sum = 0;
+   for (i = 0; i < cpu_count; ++i)
+       sum |= FORCPU(cpu_vector[i],x86_pic_interrupts)[line];
+   if (!sum) continue; /* Line isn't being used by any driver. */
+   format_printf(printer,closure,"%3u:",line);
+   for (i = 0; i < cpu_count; ++i)
+       format_printf(printer,closure," %10I32u",
+                     FORCPU(cpu_vector[i],x86_pic_interrupts)[line]);
+   format_printf(printer,closure,"  XT-PIC\n");
+  }
+ }
+ format_printf(printer,closure,"SPU:");
+ for (i = 0; i < cpu_count; ++i) {
+  struct x86_spurious_interrupts *spur;
+  spur = &FORCPU(cpu_vector[i],x86_spurious_interrupts);
+  format_printf(printer,closure," %10I32u",
+                spur->sp_pic1+spur->sp_pic2+spur->sp_apic);
+ }
+ format_printf(printer,closure,"  Spurious interrupts\n");
+#endif
+}
+
+
+/* /proc/softirqs */
+INTERN void KCALL
+ProcFS_PrintSoftirqs(struct inode *__restrict UNUSED(node),
+                     pformatprinter printer, void *closure) {
+#define IRQSTAT(i)  FORCPU(cpu_vector[i],_this_irqstat)
+ cpuid_t i;
+ format_printf(printer,closure,"          ");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %16s%-u",
+                   "CPU",(unsigned int)i);
+ format_printf(printer,closure,"\n   HARDIRQ:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19Iu",IRQSTAT(i).is_hardirq);
+ format_printf(printer,closure,"\n  HARDTIME:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19I64u",IRQSTAT(i).is_hardtime);
+ format_printf(printer,closure,"\n    RAISED:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19Iu",IRQSTAT(i).is_raised);
+ format_printf(printer,closure,"\n   SOFTIRQ:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19Iu",IRQSTAT(i).is_softirq);
+ format_printf(printer,closure,"\n  SOFTTIME:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19I64u",IRQSTAT(i).is_softtime);
+ format_printf(printer,closure,"\n   BATCHES:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19Iu",IRQSTAT(i).is_batches);
+ format_printf(printer,closure,"\n  DEFERRED:");
+ for (i = 0; i < cpu_count; ++i)
+     format_printf(printer,closure," %19Iu",IRQSTAT(i).is_deferred);
+ format_printf(printer,closure,"\n");
+#undef IRQSTAT
+}
+
+
+
+PRIVATE void KCALL
+ProcFS_PrintComm(struct task *__restrict thread,
+                 pformatprinter printer, void *closure) {
+ REF struct vm *EXCEPT_VAR thread_vm;
+ REF struct application *app;
+ char const *name = NULL; u16 namelen = 0;
+ thread_vm = task_getvm(thread);
+ TRY {
+  app = vm_apps_primary(thread_vm);
+ } FINALLY {
+  vm_decref(thread_vm);
+ }
+ if (app) {
+  struct path *p = app->a_module->m_path;
+  if (p && p->p_dirent) {
+   name    = p->p_dirent->de_name;
+   namelen = p->p_dirent->de_namelen;
+  }
+ }
+ TRY {
+  (*printer)("(",1,closure);
+  if (name) {
+   /* Linux truncates this to 15 characters. */
+   (*printer)(name,namelen > 15 ? 15 : namelen,closure);
+  } else {
+   (*printer)("kernel",6,closure);
+  }
+  (*printer)(")",1,closure);
+ } FINALLY {
+  if (app) application_decref(app);
+ }
+}
+
+PRIVATE pid_t KCALL
+ProcFS_GetParentPid(struct task *__restrict process) {
+ struct task_weakref *parent_ref;
+ REF struct task *parent;
+ pid_t result = 0;
+ parent_ref = FORTASK(process,_this_group).tg_process.h_parent;
+ if (parent_ref && (parent = task_weakref_lock(parent_ref)) != NULL) {
+  result = posix_gettid_view(get_process_of(parent));
+  task_decref(parent);
+ }
+ return result;
+}
+
+/* /proc/[PID]/stat */
+INTERN void KCALL
+ProcFS_PrintPStat(struct inode *__restrict node,
+                  pformatprinter printer, void *closure) {
+ REF struct task *EXCEPT_VAR thread;
+ thread = ProcFS_GetTask(node->i_super,PROCFS_INODE_GTPID(node->i_attr.a_ino));
+ TRY {
+  struct task *process = get_process_of(thread);
+  REF struct task *group,*session;
+  struct task *iter;
+  u16 state = ATOMIC_READ(thread->t_state);
+  size_t num_threads = 1;
+  pid_t pgrp,sid;
+  group   = get_processgroup_of(thread);
+  pgrp    = posix_gettid_view(group);
+  task_decref(group);
+  session = get_session_of(thread);
+  sid     = posix_gettid_view(session);
+  task_decref(session);
+  atomic_rwlock_read(&FORTASK(process,_this_group).tg_process.h_lock);
+  for (iter = FORTASK(process,_this_group).tg_process.h_group; iter;
+       iter = FORTASK(iter,_this_group).tg_thread.g_group.le_next)
+       ++num_threads;
+  atomic_rwlock_endread(&FORTASK(process,_this_group).tg_process.h_lock);
+
+  format_printf(printer,closure,"%u ",posix_gettid_view(thread));
+  ProcFS_PrintComm(thread,printer,closure);
+  /* utime, stime and starttime are in clock ticks (`sysconf(_SC_CLK_TCK)'),
+   * which are microseconds, just like the CPU times returned by `times()'. */
+  format_printf(printer,closure,
+                " %c %u %u %u 0 0 %#I16x 0 0 0 0 "
+#ifndef CONFIG_NO_TASKSTAT
+                "%I64u %I64u 0 0 20 0 %Iu 0 %I64u "
+#else
+                "%I64u %I64u 0 0 20 0 %Iu 0 0 "
+#endif
+                "0 0\n",
+                (state & TASK_STATE_FTERMINATED) ? 'Z' :
+                (state & TASK_STATE_FSLEEPING) ? 'S' : 'R',
+                ProcFS_GetParentPid(process),pgrp,sid,
+                thread->t_flags,
+                cputime_to_usec(FORTASK(thread,_this_cputime).tc_user),
+                cputime_to_usec(FORTASK(thread,_this_cputime).tc_system),
+                num_threads
+#ifndef CONFIG_NO_TASKSTAT
+                ,
+                JIFFIES_TO_CLK_TCK(FORTASK(thread,_this_stat).ts_started)
+#endif
+                );
+ } FINALLY {
+  task_decref(thread);
+ }
+}
+
+/* /proc/[PID]/schedstat */
+INTERN void KCALL
+ProcFS_PrintPSchedstat(struct inode *__restrict node,
+                       pformatprinter printer, void *closure) {
+ REF struct task *EXCEPT_VAR thread;
+ thread = ProcFS_GetTask(node->i_super,PROCFS_INODE_GTPID(node->i_attr.a_ino));
+ TRY {
+  struct taskcputime *ct = &FORTASK(thread,_this_cputime);
+  /* Run time and time spent waiting on a run-queue (both in nanoseconds),
+   * and the number of times the thread gave up the CPU (preempted, yielded, or slept) */
+#ifndef CONFIG_NO_TASKSTAT
+  struct taskstat *st = &FORTASK(thread,_this_stat);
+  format_printf(printer,closure,"%I64u %I64u %I64u\n",
+                cputime_to_nsec(ct->tc_user+ct->tc_system),
+                cputime_to_nsec(ct->tc_wait),
+                (u64)st->ts_uswitch+st->ts_hswitch+
+                     st->ts_hyield+st->ts_uyield+st->ts_sleep);
+#else
+  format_printf(printer,closure,"%I64u %I64u 0\n",
+                cputime_to_nsec(ct->tc_user+ct->tc_system),
+                cputime_to_nsec(ct->tc_wait));
+#endif
+ } FINALLY {
+  task_decref(thread);
+ }
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_PROCFS_STAT_C */
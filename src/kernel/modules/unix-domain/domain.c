@@ -28,6 +28,7 @@
 #include <kernel/bind.h>
 #include <string.h>
 #include <hybrid/minmax.h>
+#include <hybrid/atomic.h>
 #include <sched/task.h>
 #include <sched/signal.h>
 #include <except.h>
@@ -186,6 +187,181 @@ no_anc:
 }
 
 
+/* Grow the limit of an auto-tuned buffer, such that `num_bytes'
+ * more bytes can be written to it without having to block. */
+PRIVATE void KCALL
+unix_autotune(struct packetbuffer *__restrict self, size_t num_bytes) {
+ size_t limit,required;
+ limit = ATOMIC_READ(self->pb_limt) & PBUFFER_LIMT_FMASK;
+ if (limit >= UNIX_BUFSIZE_MAX)
+     return;
+ required  = ATOMIC_READ(self->pb_state.pbs_count);
+ required += num_bytes+2*sizeof(struct packet_header);
+ if (required <= limit)
+     return;
+ do limit *= 2;
+ while (limit < required && limit < UNIX_BUFSIZE_MAX);
+ if (limit > UNIX_BUFSIZE_MAX)
+     limit = UNIX_BUFSIZE_MAX;
+ packetbuffer_setlimit(self,limit);
+}
+
+/* Send data through one of the buffers of a connection. */
+PRIVATE size_t KCALL
+unix_send(UnixSocket *__restrict client,
+          struct packetbuffer *__restrict buffer, uintptr_t fixed_flag,
+          USER CHECKED struct iovec const *buf, size_t num_bytes,
+          iomode_t mode, packet_iomode_t packet_mode) {
+ size_t max_payload;
+ if (!(ATOMIC_READ(client->us_client.c_fixed) & fixed_flag))
+       unix_autotune(buffer,num_bytes);
+ /* Message boundaries are preserved for `SOCK_SEQPACKET' */
+ if (!SOCKET_ISSTREAM(client))
+      return packetbuffer_writev(buffer,buf,num_bytes,mode,packet_mode);
+ /* Empty packets would be read as EOF. */
+ if unlikely(!num_bytes)
+    return 0;
+ /* Rather than creating lots of tiny packets, append
+  * small writes to the last packet that hasn't been read, yet. */
+ max_payload = (ATOMIC_READ(buffer->pb_limt) & PBUFFER_LIMT_FMASK)-2*PACKET_BUFFER_ALIGNMENT;
+ if (num_bytes < UNIX_STREAM_COALESCE &&
+     packetbuffer_append_vio(buffer,buf,0,num_bytes,max_payload,mode))
+     return num_bytes;
+ /* Larger writes are copied straight into the buffer,
+  * and split into as many packets as necessary. */
+ return packetbuffer_writev(buffer,buf,num_bytes,mode,
+                            packet_mode|PACKET_IO_FWRSPLIT);
+}
+
+/* Receive data from one of the buffers of a connection. */
+PRIVATE bool KCALL
+unix_recv(UnixSocket *__restrict client,
+          struct packetbuffer *__restrict buffer,
+          USER CHECKED struct iovec const *buf, size_t *__restrict pbufsize,
+          iomode_t mode, packet_iomode_t packet_mode) {
+ size_t EXCEPT_VAR total = 0;
+ size_t bufsize,part;
+ if (!SOCKET_ISSTREAM(client))
+      return packetbuffer_readv(buffer,buf,pbufsize,mode,packet_mode);
+ bufsize = *pbufsize;
+ if (packet_mode & PACKET_IO_FRDNEVER) {
+  /* Peek at the first packet in line. */
+  part = bufsize;
+  packetbuffer_readv(buffer,buf,&part,mode,PACKET_IO_FRDNEVER);
+  *pbufsize = MIN(part,bufsize);
+  return *pbufsize != 0;
+ }
+ if unlikely(!bufsize)
+    return false;
+ /* Packet boundaries don't matter for a stream, so read
+  * as much of the queued data as we can in a single call. */
+ TRY {
+  for (;;) {
+   part = bufsize - total;
+   if (!packetbuffer_reada_vio(buffer,buf,total,&part,NULL,NULL,mode,
+                               PACKET_IO_FRDIFFIT|PACKET_IO_FRDTRUNC))
+        break; /* EOF */
+   total += part;
+   if (total >= bufsize)
+       break;
+   if (!(packet_mode & PACKET_IO_FRDWAITALL)) {
+    /* Only keep reading packets that are already available. */
+    if (!ATOMIC_READ(buffer->pb_state.pbs_count))
+         break;
+    mode |= IO_NONBLOCK;
+   }
+  }
+ } FINALLY {
+  if (FINALLY_WILL_RETHROW && total != 0 &&
+     (error_code() == E_WOULDBLOCK ||
+      error_code() == E_INTERRUPT)) {
+   /* Return what we've already got. */
+   error_handled();
+   *pbufsize = total;
+   return true;
+  }
+ }
+ *pbufsize = total;
+ return total != 0;
+}
+
+/* Returns the packet mode used to receive ancillary data from `client'
+ * Since ancillary data must not be mixed, streams only read one packet at a time. */
+#define UNIX_RECVA_MODE(client,packet_mode) \
+   (!SOCKET_ISSTREAM(client) ? (packet_mode) : \
+    ((packet_mode) & PACKET_IO_FRDNEVER) ? PACKET_IO_FRDNEVER : \
+     (PACKET_IO_FRDIFFIT|PACKET_IO_FRDTRUNC))
+
+/* Check if data can be written to `self' without blocking. */
+PRIVATE bool KCALL
+unix_poll_writable(struct packetbuffer *__restrict self) {
+ task_connect_ghost(&self->pb_read);
+ return ATOMIC_READ(self->pb_state.pbs_count) <
+       (ATOMIC_READ(self->pb_limt) & PBUFFER_LIMT_FMASK) ||
+        packetbuffer_isclosed(self);
+}
+
+
+/* Parse the value of a `SO_SNDBUF' / `SO_RCVBUF' socket option. */
+PRIVATE size_t KCALL
+unix_getbufsize(USER CHECKED void const *buf, socklen_t buflen) {
+ int value; size_t result;
+ if (buflen != sizeof(int))
+     error_throw(E_INVALID_ARGUMENT);
+ memcpy(&value,buf,sizeof(int));
+ COMPILER_READ_BARRIER();
+ result = value < 0 ? 0 : (size_t)value;
+ if (result < UNIX_BUFSIZE_MIN) result = UNIX_BUFSIZE_MIN;
+ if (result > UNIX_BUFSIZE_MAX) result = UNIX_BUFSIZE_MAX;
+ return result;
+}
+
+/* Implement `getsockopt()' for any kind of unix domain socket.
+ * @param: tx: [0..1] The buffer that this socket sends data through.
+ * @param: rx: [0..1] The buffer that this socket receives data from.
+ * @param: sndbuf: The buffer size used when `tx' is NULL.
+ * @param: rcvbuf: The buffer size used when `rx' is NULL. */
+PRIVATE socklen_t KCALL
+unix_getsockopt(struct socket *__restrict self,
+                struct packetbuffer *tx, size_t sndbuf,
+                struct packetbuffer *rx, size_t rcvbuf,
+                int level, int optname,
+                USER CHECKED void *buf, socklen_t buflen) {
+ int value;
+ if (level != SOL_SOCKET)
+     error_throw(E_NOT_IMPLEMENTED);
+ switch (optname) {
+ case SO_SNDBUF:
+ case SO_SNDBUFFORCE:
+  if (tx) sndbuf = ATOMIC_READ(tx->pb_limt) & PBUFFER_LIMT_FMASK;
+  value = (int)(sndbuf ? sndbuf : UNIX_BUFSIZE_DEFAULT);
+  break;
+ case SO_RCVBUF:
+ case SO_RCVBUFFORCE:
+  if (rx) rcvbuf = ATOMIC_READ(rx->pb_limt) & PBUFFER_LIMT_FMASK;
+  value = (int)(rcvbuf ? rcvbuf : UNIX_BUFSIZE_DEFAULT);
+  break;
+ case SO_TYPE:
+  value = self->s_type;
+  break;
+ case SO_PROTOCOL:
+  value = self->s_proto;
+  break;
+ case SO_DOMAIN:
+  value = AF_UNIX;
+  break;
+ case SO_ERROR:
+  /* Errors are always reported synchronously. */
+  value = 0;
+  break;
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+ memcpy(buf,&value,MIN(buflen,sizeof(int)));
+ return sizeof(int);
+}
+
+
 
 
 
@@ -202,13 +378,6 @@ UnixSocket_Fini(UnixSocket *__restrict self) {
    socket_decref(&pending->as_socket);
    pending = next;
   }
-  /* Unbind the server socket from its filesystem location. */
-  if (self->us_bind_node) {
-   atomic_rwlock_write(&self->us_bind_node->re_unix.u_lock);
-   if (self->us_bind_node->re_unix.u_server == self)
-       self->us_bind_node->re_unix.u_server = NULL;
-   atomic_rwlock_endwrite(&self->us_bind_node->re_unix.u_lock);
-  }
  } else if (SOCKET_ISCLIENT(self)) {
   /* Drop a reference from the connection accept-socket,
    * and clear the ring buffers of all data that was never
@@ -217,8 +386,16 @@ UnixSocket_Fini(UnixSocket *__restrict self) {
   packetbuffer_fini(&self->us_client.c_client2server);
   packetbuffer_fini(&self->us_client.c_server2client);
  }
- if (self->us_bind_node)
-     inode_decref((struct inode *)self->us_bind_node);
+ if (self->us_bind_node) {
+  /* Unbind the socket from its filesystem location.
+   * NOTE: Client sockets are bound to the server's location, but
+   *       since they're not the one registered there, this is a no-op. */
+  atomic_rwlock_write(&self->us_bind_node->re_unix.u_lock);
+  if (self->us_bind_node->re_unix.u_server == self)
+      self->us_bind_node->re_unix.u_server = NULL;
+  atomic_rwlock_endwrite(&self->us_bind_node->re_unix.u_lock);
+  inode_decref((struct inode *)self->us_bind_node);
+ }
  if (self->us_bind_path)
      path_decref(self->us_bind_path);
 }
@@ -282,7 +459,7 @@ AcceptSocket_GetSockName(AcceptSocket *__restrict self,
 PRIVATE unsigned int KCALL
 AcceptSocket_Poll(AcceptSocket *__restrict self,
                   unsigned int mode) {
- socklen_t COMPILER_IGNORE_UNINITIALIZED(result);
+ unsigned int result = 0;
  REF UnixSocket *client;
  client = self->as_client;
  if (!socket_tryincref(&client->us_socket))
@@ -290,9 +467,9 @@ AcceptSocket_Poll(AcceptSocket *__restrict self,
  TRY {
   /* Poll the ring buffer used to communicate data. */
   if ((mode & POLLIN) && packetbuffer_poll_nonempty(&client->us_client.c_client2server))
-       mode |= POLLIN;
-  if ((mode & POLLOUT) && packetbuffer_poll_empty(&client->us_client.c_server2client))
-       mode |= POLLOUT;
+       result |= POLLIN;
+  if ((mode & POLLOUT) && unix_poll_writable(&client->us_client.c_server2client))
+       result |= POLLOUT;
  } FINALLY {
   socket_decref(&client->us_socket);
  }
@@ -309,11 +486,12 @@ AcceptSocket_Recv(AcceptSocket *__restrict self,
  if (!socket_tryincref(&client->us_socket))
       return 0; /* Connection terminated. */
  TRY {
-  result = packetbuffer_readv(&client->us_client.c_client2server,
-                               buf,
-                               pbufsize,
-                               mode,
-                               packet_mode);
+  result = unix_recv(client,
+                      &client->us_client.c_client2server,
+                       buf,
+                       pbufsize,
+                       mode,
+                       packet_mode);
  } FINALLY {
   socket_decref(&client->us_socket);
  }
@@ -337,7 +515,7 @@ AcceptSocket_Recva(AcceptSocket *__restrict self,
                        anc,
                        pancsize,
                        mode,
-                       packet_mode);
+                       UNIX_RECVA_MODE(client,packet_mode));
  } FINALLY {
   socket_decref(&client->us_socket);
  }
@@ -354,11 +532,13 @@ AcceptSocket_Send(AcceptSocket *__restrict self,
  if (!socket_tryincref(&client->us_socket))
       return 0; /* Connection terminated. */
  TRY {
-  result = packetbuffer_writev(&client->us_client.c_server2client,
-                                buf,
-                                num_bytes,
-                                mode,
-                                packet_mode);
+  result = unix_send(client,
+                      &client->us_client.c_server2client,
+                       UNIX_CLIENT_FS2CFIXED,
+                       buf,
+                       num_bytes,
+                       mode,
+                       packet_mode);
  } FINALLY {
   socket_decref(&client->us_socket);
  }
@@ -376,16 +556,69 @@ AcceptSocket_Senda(AcceptSocket *__restrict self,
  if (!socket_tryincref(&client->us_socket))
       return 0; /* Connection terminated. */
  TRY {
+  if (!(ATOMIC_READ(client->us_client.c_fixed) & UNIX_CLIENT_FS2CFIXED))
+        unix_autotune(&client->us_client.c_server2client,num_bytes);
   result = unix_senda(&client->us_client.c_server2client,
                        buf,num_bytes,
                        anc,anc_size,
-                       mode,packet_mode);
+                       mode,SOCKET_ISSTREAM(client)
+                     ? packet_mode|PACKET_IO_FWRSPLIT
+                     : packet_mode);
  } FINALLY {
   socket_decref(&client->us_socket);
  }
  return result;
 }
 
+PRIVATE socklen_t KCALL
+AcceptSocket_GetSockOpt(AcceptSocket *__restrict self,
+                        int level, int optname,
+                        USER CHECKED void *buf,
+                        socklen_t buflen, iomode_t UNUSED(mode)) {
+ socklen_t COMPILER_IGNORE_UNINITIALIZED(result);
+ REF UnixSocket *client;
+ client = self->as_client;
+ if (!socket_tryincref(&client->us_socket))
+      error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+ TRY {
+  /* The buffers are used in the opposite direction of the client. */
+  result = unix_getsockopt(&self->as_socket,
+                           &client->us_client.c_server2client,0,
+                           &client->us_client.c_client2server,0,
+                            level,optname,buf,buflen);
+ } FINALLY {
+  socket_decref(&client->us_socket);
+ }
+ return result;
+}
+
+PRIVATE void KCALL
+AcceptSocket_SetSockOpt(AcceptSocket *__restrict self,
+                        int level, int optname,
+                        USER CHECKED void const *buf,
+                        socklen_t buflen, iomode_t UNUSED(mode)) {
+ REF UnixSocket *client;
+ size_t size;
+ if (level != SOL_SOCKET)
+     error_throw(E_NOT_IMPLEMENTED);
+ if (optname != SO_RCVBUF && optname != SO_RCVBUFFORCE &&
+     optname != SO_SNDBUF && optname != SO_SNDBUFFORCE)
+     error_throw(E_NOT_IMPLEMENTED);
+ size   = unix_getbufsize(buf,buflen);
+ client = self->as_client;
+ if (!socket_tryincref(&client->us_socket))
+      error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+ /* An explicit buffer size disables auto-tuning. */
+ if (optname == SO_RCVBUF || optname == SO_RCVBUFFORCE) {
+  packetbuffer_setlimit(&client->us_client.c_client2server,size);
+  ATOMIC_FETCHOR(client->us_client.c_fixed,UNIX_CLIENT_FC2SFIXED);
+ } else {
+  packetbuffer_setlimit(&client->us_client.c_server2client,size);
+  ATOMIC_FETCHOR(client->us_client.c_fixed,UNIX_CLIENT_FS2CFIXED);
+ }
+ socket_decref(&client->us_socket);
+}
+
 
 
 PRIVATE struct socket_ops AcceptSocket_Ops = {
@@ -393,6 +626,8 @@ PRIVATE struct socket_ops AcceptSocket_Ops = {
     .so_getsockname = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&AcceptSocket_GetSockName,
     .so_getpeername = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&AcceptSocket_GetSockName,
     .so_poll        = (unsigned int(KCALL *)(struct socket *__restrict,unsigned int))&AcceptSocket_Poll,
+    .so_getsockopt  = (socklen_t(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void *,socklen_t,iomode_t))&AcceptSocket_GetSockOpt,
+    .so_setsockopt  = (void(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void const *,socklen_t,iomode_t))&AcceptSocket_SetSockOpt,
     /* Assign some non-NULL pointers to bind() and connect() to make it look
      * like a connection-oriented socket. However, they are never invoked as
      * accept-sockets are constructed with the `SOCKET_STATE_FCONNECTED' and
@@ -458,6 +693,19 @@ UnixSocket_Connect(UnixSocket *__restrict self,
   TRY {
    REF AcceptSocket *accept;
    bool is_first_connection;
+   /* Only sockets of the same type can be connected. */
+   if (server->us_socket.s_type != self->us_socket.s_type)
+       error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+   /* Initialize the client buffers before the server can see them.
+    * Unless configured explicitly, their sizes are auto-tuned. */
+   packetbuffer_cinit(&self->us_client.c_client2server,
+                       self->us_sndbuf ? self->us_sndbuf : UNIX_BUFSIZE_DEFAULT,
+                      &UnixSocket_DestroyAncillaryData);
+   packetbuffer_cinit(&self->us_client.c_server2client,
+                       self->us_rcvbuf ? self->us_rcvbuf : UNIX_BUFSIZE_DEFAULT,
+                      &UnixSocket_DestroyAncillaryData);
+   self->us_client.c_fixed = ((self->us_sndbuf ? UNIX_CLIENT_FC2SFIXED : 0)|
+                              (self->us_rcvbuf ? UNIX_CLIENT_FS2CFIXED : 0));
    /* Construct the accept-socket for the server. */
    accept = (REF AcceptSocket *)socket_alloc(sizeof(AcceptSocket),
                                             &unix_domain,
@@ -509,11 +757,6 @@ UnixSocket_Connect(UnixSocket *__restrict self,
   error_rethrow();
  }
 
- /* Initialize the client buffer.
-  * XXX: Buffer limit configuration? */
- packetbuffer_cinit(&self->us_client.c_client2server,4096,&UnixSocket_DestroyAncillaryData);
- packetbuffer_cinit(&self->us_client.c_server2client,4096,&UnixSocket_DestroyAncillaryData);
-
  /* Deal with the binding of our own socket
   * to the specified filesystem location. */
  if (self->us_socket.s_state & SOCKET_STATE_FBOUND) {
@@ -619,7 +862,7 @@ UnixSocket_Poll(UnixSocket *__restrict self,
   /* Poll the buffers used to communicate between server and client. */
   if ((mode & POLLIN) && packetbuffer_poll_nonempty(&self->us_client.c_server2client))
        result |= POLLIN;
-  if ((mode & POLLOUT) && packetbuffer_poll_empty(&self->us_client.c_client2server))
+  if ((mode & POLLOUT) && unix_poll_writable(&self->us_client.c_client2server))
        result |= POLLOUT;
  }
  return result;
@@ -678,11 +921,12 @@ UnixSocket_Recv(UnixSocket *__restrict self,
                 USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
                 iomode_t mode, packet_iomode_t packet_mode) {
  assert(SOCKET_ISCLIENT(self));
- return packetbuffer_readv(&self->us_client.c_server2client,
-                            iov,
-                            pbufsize,
-                            mode,
-                            packet_mode);
+ return unix_recv(self,
+                 &self->us_client.c_server2client,
+                  iov,
+                  pbufsize,
+                  mode,
+                  packet_mode);
 }
 
 PRIVATE bool KCALL
@@ -697,7 +941,7 @@ UnixSocket_Recva(UnixSocket *__restrict self,
                     anc,
                     pancsize,
                     mode,
-                    packet_mode);
+                    UNIX_RECVA_MODE(self,packet_mode));
 }
 
 PRIVATE size_t KCALL
@@ -705,11 +949,13 @@ UnixSocket_Send(UnixSocket *__restrict self,
                 USER CHECKED struct iovec const *buf, size_t num_bytes,
                 iomode_t mode, packet_iomode_t packet_mode) {
  assert(SOCKET_ISCLIENT(self));
- return packetbuffer_writev(&self->us_client.c_client2server,
-                             buf,
-                             num_bytes,
-                             mode,
-                             packet_mode);
+ return unix_send(self,
+                 &self->us_client.c_client2server,
+                  UNIX_CLIENT_FC2SFIXED,
+                  buf,
+                  num_bytes,
+                  mode,
+                  packet_mode);
 }
 
 PRIVATE size_t KCALL
@@ -718,13 +964,67 @@ UnixSocket_Senda(UnixSocket *__restrict self,
                  USER CHECKED struct cmsghdr const *anc, size_t anc_size,
                  iomode_t mode, packet_iomode_t packet_mode) {
  assert(SOCKET_ISCLIENT(self));
+ if (!(ATOMIC_READ(self->us_client.c_fixed) & UNIX_CLIENT_FC2SFIXED))
+       unix_autotune(&self->us_client.c_client2server,num_bytes);
  return unix_senda(&self->us_client.c_client2server,
                     buf,
                     num_bytes,
                     anc,
                     anc_size,
                     mode,
-                    packet_mode);
+                    SOCKET_ISSTREAM(self)
+                  ? packet_mode|PACKET_IO_FWRSPLIT
+                  : packet_mode);
+}
+
+PRIVATE socklen_t KCALL
+UnixSocket_GetSockOpt(UnixSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void *buf,
+                      socklen_t buflen, iomode_t UNUSED(mode)) {
+ struct packetbuffer *tx = NULL,*rx = NULL;
+ if (SOCKET_ISDGRAM(self)) {
+  rx = &self->us_dgram.d_rx;
+ } else if (SOCKET_ISCLIENT(self)) {
+  tx = &self->us_client.c_client2server;
+  rx = &self->us_client.c_server2client;
+ }
+ return unix_getsockopt(&self->us_socket,
+                         tx,self->us_sndbuf,
+                         rx,self->us_rcvbuf,
+                         level,optname,buf,buflen);
+}
+
+PRIVATE void KCALL
+UnixSocket_SetSockOpt(UnixSocket *__restrict self,
+                      int level, int optname,
+                      USER CHECKED void const *buf,
+                      socklen_t buflen, iomode_t UNUSED(mode)) {
+ size_t size;
+ if (level != SOL_SOCKET)
+     error_throw(E_NOT_IMPLEMENTED);
+ if (optname != SO_RCVBUF && optname != SO_RCVBUFFORCE &&
+     optname != SO_SNDBUF && optname != SO_SNDBUFFORCE)
+     error_throw(E_NOT_IMPLEMENTED);
+ size = unix_getbufsize(buf,buflen);
+ /* An explicit buffer size disables auto-tuning. */
+ if (optname == SO_RCVBUF || optname == SO_RCVBUFFORCE) {
+  self->us_rcvbuf = size;
+  if (SOCKET_ISDGRAM(self))
+      packetbuffer_setlimit(&self->us_dgram.d_rx,size);
+  else if (SOCKET_ISCLIENT(self)) {
+   packetbuffer_setlimit(&self->us_client.c_server2client,size);
+   ATOMIC_FETCHOR(self->us_client.c_fixed,UNIX_CLIENT_FS2CFIXED);
+  }
+ } else {
+  /* Datagrams are written directly into the receiver's buffer,
+   * meaning that for them, this option is only informational. */
+  self->us_sndbuf = size;
+  if (!SOCKET_ISDGRAM(self) && SOCKET_ISCLIENT(self)) {
+   packetbuffer_setlimit(&self->us_client.c_client2server,size);
+   ATOMIC_FETCHOR(self->us_client.c_fixed,UNIX_CLIENT_FC2SFIXED);
+  }
+ }
 }
 
 
@@ -738,6 +1038,8 @@ PRIVATE struct socket_ops UnixSocket_Ops = {
     .so_poll        = (unsigned int(KCALL *)(struct socket *__restrict,unsigned int))&UnixSocket_Poll,
     .so_getsockname = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&UnixSocket_GetSockName,
     .so_getpeername = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&UnixSocket_GetSockName,
+    .so_getsockopt  = (socklen_t(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void *,socklen_t,iomode_t))&UnixSocket_GetSockOpt,
+    .so_setsockopt  = (void(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void const *,socklen_t,iomode_t))&UnixSocket_SetSockOpt,
     .so_recv        = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,iomode_t,packet_iomode_t))&UnixSocket_Recv,
     .so_send        = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,iomode_t,packet_iomode_t))&UnixSocket_Send,
     .so_senda       = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,USER CHECKED struct cmsghdr const *,size_t,iomode_t,packet_iomode_t))&UnixSocket_Senda,
@@ -746,23 +1048,209 @@ PRIVATE struct socket_ops UnixSocket_Ops = {
 
 
 
+
+/* Datagram sockets don't implement `so_connect()', meaning that the
+ * socket layer keeps track of the connected peer address, and forwards
+ * `send()' to `UnixDgram_Sendto()'. Every datagram is written directly
+ * into the receive buffer of the socket bound to the target address. */
+PRIVATE ATTR_NOTHROW void KCALL
+UnixDgram_Fini(UnixSocket *__restrict self) {
+ packetbuffer_fini(&self->us_dgram.d_rx);
+ if (self->us_bind_node) {
+  /* Unbind the socket from its filesystem location. */
+  atomic_rwlock_write(&self->us_bind_node->re_unix.u_lock);
+  if (self->us_bind_node->re_unix.u_server == self)
+      self->us_bind_node->re_unix.u_server = NULL;
+  atomic_rwlock_endwrite(&self->us_bind_node->re_unix.u_lock);
+  inode_decref((struct inode *)self->us_bind_node);
+ }
+ if (self->us_bind_path)
+     path_decref(self->us_bind_path);
+}
+
+PRIVATE void KCALL
+UnixDgram_Shutdown(UnixSocket *__restrict self, u16 new_flags) {
+ if (new_flags & SOCKET_STATE_FSHUTRD)
+     packetbuffer_close(&self->us_dgram.d_rx);
+}
+
+PRIVATE unsigned int KCALL
+UnixDgram_Poll(UnixSocket *__restrict self, unsigned int mode) {
+ unsigned int result = 0;
+ if ((mode & POLLIN) && packetbuffer_poll_nonempty(&self->us_dgram.d_rx))
+      result |= POLLIN;
+ /* Datagrams are never queued on the sending side. */
+ if (mode & POLLOUT)
+     result |= POLLOUT;
+ return result;
+}
+
+/* Return a reference to the datagram socket bound to `addr' */
+PRIVATE ATTR_RETNONNULL REF UnixSocket *KCALL
+UnixDgram_Lookup(USER CHECKED struct sockaddr_un const *addr,
+                 socklen_t addr_len) {
+ size_t path_len;
+ REF struct regular_node *conn_node;
+ REF UnixSocket *result;
+ if unlikely(addr_len <= offsetof(struct sockaddr_un,sun_path))
+     error_throwf(E_NET_ERROR,ERROR_NET_INVALID_SOCKET_ADDRESS);
+ if (addr->sun_family != AF_UNIX)
+     error_throwf(E_NET_ERROR,ERROR_NET_INVALID_ADDRESS_FAMILY);
+ addr_len -= offsetof(struct sockaddr_un,sun_path);
+ path_len = strnlen(addr->sun_path,addr_len);
+ /* Lookup the described filesystem path. */
+ path_decref(fs_path(NULL,addr->sun_path,path_len,
+                    (struct inode **)&conn_node,
+                     FS_DEFAULT_ATMODE));
+ result = NULL;
+ if (INODE_ISREG((struct inode *)conn_node)) {
+  atomic_rwlock_read(&conn_node->re_unix.u_lock);
+  result = conn_node->re_unix.u_server;
+  if (result && (!SOCKET_ISDGRAM(result) ||
+                 !socket_tryincref(&result->us_socket)))
+      result = NULL;
+  atomic_rwlock_endread(&conn_node->re_unix.u_lock);
+ }
+ inode_decref((struct inode *)conn_node);
+ if (!result) /* No datagram socket bound to this address. */
+      error_throwf(E_NET_ERROR,ERROR_NET_CONNECTION_REFUSED);
+ return result;
+}
+
+PRIVATE size_t KCALL
+UnixDgram_Sendato(UnixSocket *__restrict self,
+                  USER CHECKED struct iovec const *buf, size_t num_bytes,
+                  USER CHECKED struct cmsghdr const *anc, size_t anc_size,
+                  USER CHECKED struct sockaddr const *addrbuf, socklen_t addrlen,
+                  iomode_t mode, packet_iomode_t packet_mode) {
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ REF UnixSocket *EXCEPT_VAR peer;
+ peer = UnixDgram_Lookup((struct sockaddr_un *)addrbuf,addrlen);
+ TRY {
+  /* Make sure that the receiver can hold the datagram. */
+  if (!peer->us_rcvbuf)
+       unix_autotune(&peer->us_dgram.d_rx,num_bytes);
+  result = unix_senda(&peer->us_dgram.d_rx,
+                       buf,num_bytes,
+                       anc,anc_size,
+                       mode,packet_mode);
+ } FINALLY {
+  socket_decref(&peer->us_socket);
+ }
+ return result;
+}
+
+PRIVATE size_t KCALL
+UnixDgram_Sendto(UnixSocket *__restrict self,
+                 USER CHECKED struct iovec const *buf, size_t num_bytes,
+                 USER CHECKED struct sockaddr const *addrbuf, socklen_t addrlen,
+                 iomode_t mode, packet_iomode_t packet_mode) {
+ return UnixDgram_Sendato(self,buf,num_bytes,NULL,0,
+                          addrbuf,addrlen,mode,packet_mode);
+}
+
+/* The sender of a datagram isn't recorded, so it always appears unnamed. */
+PRIVATE void KCALL
+UnixDgram_PutSender(USER CHECKED struct sockaddr *addrbuf,
+                    socklen_t *__restrict paddrlen) {
+ if (*paddrlen >= sizeof(sa_family_t))
+     addrbuf->sa_family = AF_UNIX;
+ *paddrlen = sizeof(sa_family_t);
+}
+
+/* NOTE: `so_recv()' is implemented so that connected datagram sockets
+ *        don't filter received packets by their (unnamed) sender. */
+PRIVATE bool KCALL
+UnixDgram_Recv(UnixSocket *__restrict self,
+               USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+               iomode_t mode, packet_iomode_t packet_mode) {
+ return packetbuffer_readv(&self->us_dgram.d_rx,iov,pbufsize,mode,packet_mode);
+}
+
+PRIVATE bool KCALL
+UnixDgram_Recva(UnixSocket *__restrict self,
+                USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+                USER CHECKED struct cmsghdr *anc, size_t *__restrict pancsize,
+                iomode_t mode, packet_iomode_t packet_mode) {
+ return unix_recva(&self->us_dgram.d_rx,iov,pbufsize,
+                    anc,pancsize,mode,packet_mode);
+}
+
+PRIVATE bool KCALL
+UnixDgram_RecvFrom(UnixSocket *__restrict self,
+                   USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+                   USER CHECKED struct sockaddr *addrbuf, socklen_t *__restrict paddrlen,
+                   iomode_t mode, packet_iomode_t packet_mode) {
+ bool result;
+ result = packetbuffer_readv(&self->us_dgram.d_rx,iov,pbufsize,mode,packet_mode);
+ UnixDgram_PutSender(addrbuf,paddrlen);
+ return result;
+}
+
+PRIVATE bool KCALL
+UnixDgram_RecvaFrom(UnixSocket *__restrict self,
+                    USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
+                    USER CHECKED struct cmsghdr *anc, size_t *__restrict pancsize,
+                    USER CHECKED struct sockaddr *addrbuf, socklen_t *__restrict paddrlen,
+                    iomode_t mode, packet_iomode_t packet_mode) {
+ bool result;
+ result = unix_recva(&self->us_dgram.d_rx,iov,pbufsize,
+                      anc,pancsize,mode,packet_mode);
+ UnixDgram_PutSender(addrbuf,paddrlen);
+ return result;
+}
+
+
+PRIVATE struct socket_ops UnixDgram_Ops = {
+    .so_fini        = (void(KCALL *)(struct socket *__restrict))&UnixDgram_Fini,
+    .so_shutdown    = (void(KCALL *)(struct socket *__restrict,u16))&UnixDgram_Shutdown,
+    .so_bind        = (void(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr const *,socklen_t,iomode_t))&UnixSocket_Bind,
+    .so_poll        = (unsigned int(KCALL *)(struct socket *__restrict,unsigned int))&UnixDgram_Poll,
+    .so_getsockname = (socklen_t(KCALL *)(struct socket *__restrict,USER CHECKED struct sockaddr *,socklen_t,iomode_t))&UnixSocket_GetSockName,
+    .so_getsockopt  = (socklen_t(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void *,socklen_t,iomode_t))&UnixSocket_GetSockOpt,
+    .so_setsockopt  = (void(KCALL *)(struct socket *__restrict,int,int,USER CHECKED void const *,socklen_t,iomode_t))&UnixSocket_SetSockOpt,
+    .so_recv        = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,iomode_t,packet_iomode_t))&UnixDgram_Recv,
+    .so_recvfrom    = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,USER CHECKED struct sockaddr *,socklen_t *__restrict,iomode_t,packet_iomode_t))&UnixDgram_RecvFrom,
+    .so_sendto      = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,USER CHECKED struct sockaddr const *,socklen_t,iomode_t,packet_iomode_t))&UnixDgram_Sendto,
+    .so_recva       = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,USER CHECKED struct cmsghdr *,size_t *__restrict,iomode_t,packet_iomode_t))&UnixDgram_Recva,
+    .so_recvafrom   = (bool(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t *__restrict,USER CHECKED struct cmsghdr *,size_t *__restrict,USER CHECKED struct sockaddr *,socklen_t *__restrict,iomode_t,packet_iomode_t))&UnixDgram_RecvaFrom,
+    .so_sendato     = (size_t(KCALL *)(struct socket *__restrict,USER CHECKED struct iovec const *,size_t,USER CHECKED struct cmsghdr const *,size_t,USER CHECKED struct sockaddr const *,socklen_t,iomode_t,packet_iomode_t))&UnixDgram_Sendato,
+};
+
+
+
 PRIVATE REF struct socket *KCALL
 UnixDomain_CreateSocket(struct socket_domain *__restrict domain,
                         u16 type, u16 proto) {
- /* Currently, unix domain sockets only support SOCK_STREAM with PF_UNIX */
- if (type != SOCK_STREAM)
-     error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_TYPE);
+ REF UnixSocket *result;
+ struct socket_ops *ops;
+ switch (type) {
+ case SOCK_STREAM:
+ case SOCK_SEQPACKET:
+  ops = &UnixSocket_Ops;
+  break;
+ case SOCK_DGRAM:
+  ops = &UnixDgram_Ops;
+  break;
+ default:
+  error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_TYPE);
+ }
  if (proto != PF_UNIX)
      error_throwf(E_NET_ERROR,ERROR_NET_UNSUPPORTED_PROTOCOL);
 
  /* Allocate a new Unix domain socket.
   * NOTE: All the remaining fields are automatically ZERO-initialized.
-  *       All of the magic then only happens in the callbacks of `UnixSocket_Ops' */
- return socket_alloc(sizeof(UnixSocket),
-                     domain,
-                     type,
-                     proto,
-                    &UnixSocket_Ops);
+  *       All of the magic then only happens in the callbacks of `ops' */
+ result = (REF UnixSocket *)socket_alloc(sizeof(UnixSocket),
+                                         domain,
+                                         type,
+                                         proto,
+                                         ops);
+ if (type == SOCK_DGRAM) {
+  packetbuffer_cinit(&result->us_dgram.d_rx,UNIX_BUFSIZE_DEFAULT,
+                     &UnixSocket_DestroyAncillaryData);
+ }
+ return &result->us_socket;
 }
 
 
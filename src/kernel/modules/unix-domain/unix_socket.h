@@ -29,6 +29,18 @@
 
 DECL_BEGIN
 
+/* Limits for the SO_SNDBUF / SO_RCVBUF socket options.
+ * Unless set explicitly, connection buffers start out at `UNIX_BUFSIZE_DEFAULT'
+ * and are automatically grown up to `UNIX_BUFSIZE_MAX' when a sender
+ * would block. The max is bound by the 16-bit fields of `struct packet_header'. */
+#define UNIX_BUFSIZE_MIN     0x100
+#define UNIX_BUFSIZE_DEFAULT 0x1000
+#define UNIX_BUFSIZE_MAX     0x7ff8
+
+/* Stream writes smaller than this are appended to the
+ * last unread packet, rather than creating a new one. */
+#define UNIX_STREAM_COALESCE 0x200
+
 /* Unix domain sockets come in 3 variants:
  *   #1 Server socket (the one that called `bind()' + `listen()')
  *      - This socket is the one that holds the set of pending
@@ -42,6 +54,9 @@ DECL_BEGIN
  *   #3 Accepted connection socket (the one returned by `accept(2)')
  *      - This is the simplest of them all, as all it really is, is
  *        a weak pointer to the connection `client socket' (see #2)
+ * `SOCK_STREAM' and `SOCK_SEQPACKET' sockets both follow this model
+ * (with the later preserving message boundaries), while `SOCK_DGRAM'
+ * sockets are connection-less and simply own their receive buffer.
  */
 typedef struct unix_socket UnixSocket;
 typedef struct accept_socket AcceptSocket;
@@ -52,6 +67,8 @@ struct unix_socket {
                                             * This one's not actually used, except for implementation of
                                             * the `so_getsockname()' and `so_getpeername()' operator,
                                             * which returns this path. */
+    size_t                   us_sndbuf;    /* [lock(us_socket.s_lock)] Value set by `SO_SNDBUF', or ZERO(0) to auto-tune. */
+    size_t                   us_rcvbuf;    /* [lock(us_socket.s_lock)] Value set by `SO_RCVBUF', or ZERO(0) to auto-tune. */
     union {
         struct {
             atomic_rwlock_t             s_accept_lock;   /* Lock used to guard the socket-accept queue. */
@@ -69,11 +86,20 @@ struct unix_socket {
                                                      * NOTE: Ancillary data consists of `struct handle[]' */
             struct packetbuffer    c_server2client; /* Buffer of data being sent from the server to the client.
                                                      * NOTE: Ancillary data consists of `struct handle[]' */
+#define UNIX_CLIENT_FC2SFIXED 0x0001                /* The size of `c_client2server' was set explicitly. */
+#define UNIX_CLIENT_FS2CFIXED 0x0002                /* The size of `c_server2client' was set explicitly. */
+            ATOMIC_DATA uintptr_t  c_fixed;         /* Set of `UNIX_CLIENT_F*' */
         }             us_client;    /* [valid_if(SOCKET_ISCLIENT(self))] Client data. */
+        struct {
+            struct packetbuffer    d_rx;            /* Buffer of datagrams sent to this socket.
+                                                     * NOTE: Ancillary data consists of `struct handle[]' */
+        }             us_dgram;     /* [valid_if(SOCKET_ISDGRAM(self))] Datagram socket data. */
     };
 };
 #define SOCKET_ISSERVER(x)   ((x)->us_socket.s_state & SOCKET_STATE_FLISTENING)
 #define SOCKET_ISCLIENT(x)   ((x)->us_socket.s_state & SOCKET_STATE_FCONNECTED)
+#define SOCKET_ISDGRAM(x)    ((x)->us_socket.s_type == SOCK_DGRAM)
+#define SOCKET_ISSTREAM(x)   ((x)->us_socket.s_type == SOCK_STREAM)
 
 struct accept_socket {
     struct socket               as_socket;  /* The underlying socket. */
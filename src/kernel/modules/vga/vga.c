@@ -571,6 +571,7 @@ VGA_MMap(VGA *__restrict self,
   /* Construct a new physical memory region */
   result = vm_region_alloc(self->v_vram_size/PAGESIZE);
   result->vr_type           = VM_REGION_PHYSICAL;
+  result->vr_flags         |= VM_REGION_FMEMTYPE_WC; /* Framebuffer memory. */
   result->vr_part0.vp_state = VM_PART_INCORE;
   result->vr_part0.vp_flags = VM_PART_FWEAKREF|VM_PART_FNOSWAP;
   result->vr_part0.vp_phys.py_num_scatter = 1;
@@ -0,0 +1,434 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_C
+#define GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_C 1
+#define _KOS_SOURCE 1
+
+/* Required because requests can't be abandoned once submitted. */
+#define _NOSERVE_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/align.h>
+#include <hybrid/minmax.h>
+#include <hybrid/section.h>
+#include <kos/types.h>
+#include <kos/kdev_t.h>
+#include <dev/pci.h>
+#include <fs/device.h>
+#include <fs/driver.h>
+#include <i386-kos/pic.h>
+#include <kernel/debug.h>
+#include <kernel/user.h>
+#include <sched/async_signal.h>
+#include <sched/mutex.h>
+#include <sched/task.h>
+#include <sys/mount.h>
+#include <except.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "virtio.h"
+#include "blk.h"
+
+DECL_BEGIN
+
+/* The max amount of time to wait for a batch of requests to complete. */
+INTERN WEAK jtime_t VirtioBlk_Timeout = JIFFIES_FROM_SECONDS(10);
+
+/* [0..1][VirtioBlk_Count] Registered devices (used to dispatch interrupts). */
+PRIVATE REF VirtioBlk *VirtioBlk_Devices[VIRTIO_BLK_MAXDEVICES];
+PRIVATE unsigned int   VirtioBlk_Count = 0;
+/* Set of PIC lines for which `VirtioBlk_Interrupt()' has been installed. */
+PRIVATE u16            VirtioBlk_IrqLines = 0;
+
+
+PRIVATE void KCALL
+VirtioBlk_Interrupt(void *arg) {
+ unsigned int i,count;
+ u8 line = (u8)(uintptr_t)arg;
+ count = ATOMIC_READ(VirtioBlk_Count);
+ /* PCI interrupt lines may be shared between multiple devices. */
+ for (i = 0; i < count; ++i) {
+  VirtioBlk *dev = VirtioBlk_Devices[i];
+  u16 j;
+  if (dev->vb_virtio.vd_irq != line)
+      continue;
+  /* Reading the ISR acknowledges the interrupt. */
+  if (!(virtio_ackirq(&dev->vb_virtio) & VIRTIO_ISR_FQUEUE))
+      continue;
+  for (j = 0; j < dev->vb_queuec; ++j)
+      async_sig_broadcast(&dev->vb_queuev[j].bq_queue.vq_signal);
+ }
+}
+
+DEFINE_DRIVER_FINI(VirtioBlk_Fini);
+PRIVATE ATTR_USED void KCALL VirtioBlk_Fini(void) {
+ u8 line;
+ for (line = 0; line < 16; ++line) {
+  if (VirtioBlk_IrqLines & (1 << line))
+      x86_pic_delhandler(line,&VirtioBlk_Interrupt,(void *)(uintptr_t)line);
+ }
+}
+
+
+/* Select the request queue of the calling CPU. */
+LOCAL VirtioBlkQueue *KCALL
+VirtioBlk_GetQueue(VirtioBlk *__restrict self) {
+ if (self->vb_queuec == 1)
+     return &self->vb_queuev[0];
+ return &self->vb_queuev[THIS_CPU->cpu_id % self->vb_queuec];
+}
+
+/* Fill in request #index, and push it onto the available ring.
+ * @param: data_flags: Flags for the data descriptor (`VRING_DESC_FWRITE' for reads) */
+PRIVATE void KCALL
+VirtioBlk_Prepare(VirtioBlkQueue *__restrict queue, u16 index,
+                  u32 type, u64 sector, PHYS vm_phys_t data,
+                  u32 length, u16 data_flags) {
+ struct virtio_blk_req *req = &queue->bq_req[index];
+ struct vring_desc *desc = &queue->bq_queue.vq_desc[index*3];
+ req->r_type     = type;
+ req->r_reserved = 0;
+ req->r_sector   = sector;
+ req->r_status   = 0xff;
+ if (length) {
+  desc[0].d_next  = index*3+1;
+  desc[1].d_addr  = data;
+  desc[1].d_len   = length;
+  desc[1].d_flags = VRING_DESC_FNEXT|data_flags;
+ } else {
+  /* No data (e.g. flush): link the header directly to the status. */
+  desc[0].d_next  = index*3+2;
+ }
+ virtqueue_push(&queue->bq_queue,index*3);
+}
+
+/* Submit all prepared requests to the device with a single
+ * notification, then wait for all of them to complete. */
+PRIVATE void KCALL
+VirtioBlk_Submit(VirtioBlk *__restrict self,
+                 VirtioBlkQueue *__restrict queue,
+                 u16 count) {
+ u16 i;
+ virtqueue_kick(&queue->bq_queue,&self->vb_virtio);
+ if (!virtqueue_wait(&queue->bq_queue,&self->vb_virtio,VirtioBlk_Timeout)) {
+  /* The device still owns the queue. - Don't touch it again. */
+  debug_printf("[VIRTIO] Request timed out on %s (queue %I16u)\n",
+               self->vb_device.b_device.d_name,
+               queue->bq_queue.vq_index);
+  queue->bq_broken = true;
+  error_throw(E_IOERROR);
+ }
+ for (i = 0; i < count; ++i) {
+  u8 status = ATOMIC_READ(queue->bq_req[i].r_status);
+  if likely(status == VIRTIO_BLK_S_OK) continue;
+  if (status == VIRTIO_BLK_S_UNSUPP)
+      error_throw(E_NOT_IMPLEMENTED);
+  error_throw(E_IOERROR);
+ }
+}
+
+PRIVATE void KCALL
+VirtioBlk_Transfer(VirtioBlk *__restrict self, u32 type,
+                   CHECKED USER void *buf, size_t num_blocks,
+                   blkaddr_t first_block) {
+ VirtioBlkQueue *EXCEPT_VAR queue;
+ queue = VirtioBlk_GetQueue(self);
+ mutex_get(&queue->bq_lock);
+ TRY {
+  if unlikely(queue->bq_broken)
+     error_throw(E_IOERROR);
+  while (num_blocks) {
+   size_t batch_size,offset; u16 count = 0;
+   batch_size = MIN(VIRTIO_BLK_BUFSIZE,(size_t)queue->bq_maxreq*self->vb_reqmax);
+   if (num_blocks < batch_size/VIRTIO_BLK_SECTORSIZE)
+       batch_size = num_blocks*VIRTIO_BLK_SECTORSIZE;
+   if (type == VIRTIO_BLK_T_OUT)
+       memcpy(queue->bq_buf,buf,batch_size);
+   /* Split the batch into requests, all of which are submitted at once. */
+   for (offset = 0; offset < batch_size; ++count) {
+    u32 part = (u32)MIN(batch_size-offset,self->vb_reqmax);
+    VirtioBlk_Prepare(queue,count,type,
+                      first_block+offset/VIRTIO_BLK_SECTORSIZE,
+                      queue->bq_bufphys+offset,part,
+                      type == VIRTIO_BLK_T_IN ? VRING_DESC_FWRITE : 0);
+    offset += part;
+   }
+   VirtioBlk_Submit(self,queue,count);
+   if (type == VIRTIO_BLK_T_IN)
+       memcpy(buf,queue->bq_buf,batch_size);
+   buf          = (void *)((uintptr_t)buf+batch_size);
+   first_block += batch_size/VIRTIO_BLK_SECTORSIZE;
+   num_blocks  -= batch_size/VIRTIO_BLK_SECTORSIZE;
+  }
+ } FINALLY {
+  mutex_put(&queue->bq_lock);
+ }
+}
+
+PRIVATE void KCALL
+VirtioBlk_Read(VirtioBlk *__restrict self,
+               CHECKED USER void *buf, size_t num_blocks,
+               blkaddr_t first_block) {
+ VirtioBlk_Transfer(self,VIRTIO_BLK_T_IN,buf,num_blocks,first_block);
+}
+PRIVATE void KCALL
+VirtioBlk_Write(VirtioBlk *__restrict self,
+                CHECKED USER void const *buf, size_t num_blocks,
+                blkaddr_t first_block) {
+ VirtioBlk_Transfer(self,VIRTIO_BLK_T_OUT,(void *)buf,num_blocks,first_block);
+}
+
+PRIVATE void KCALL
+VirtioBlk_Sync(VirtioBlk *__restrict self) {
+ VirtioBlkQueue *EXCEPT_VAR queue;
+ if (!(self->vb_virtio.vd_features & VIRTIO_FEATURE(VIRTIO_BLK_F_FLUSH)))
+     return; /* The device doesn't have a write-back cache. */
+ queue = VirtioBlk_GetQueue(self);
+ mutex_get(&queue->bq_lock);
+ TRY {
+  if unlikely(queue->bq_broken)
+     error_throw(E_IOERROR);
+  VirtioBlk_Prepare(queue,0,VIRTIO_BLK_T_FLUSH,0,0,0,0);
+  VirtioBlk_Submit(self,queue,1);
+ } FINALLY {
+  mutex_put(&queue->bq_lock);
+ }
+}
+
+PRIVATE void KCALL
+VirtioBlk_Discard(VirtioBlk *__restrict self,
+                  blkaddr_t first_block, blkcnt_t num_blocks) {
+ VirtioBlkQueue *EXCEPT_VAR queue;
+ queue = VirtioBlk_GetQueue(self);
+ mutex_get(&queue->bq_lock);
+ TRY {
+  if unlikely(queue->bq_broken)
+     error_throw(E_IOERROR);
+  while (num_blocks) {
+   u16 count = 0;
+   /* Each request holds a single segment. */
+   for (; num_blocks && count < queue->bq_maxreq; ++count) {
+    struct virtio_blk_req *req = &queue->bq_req[count];
+    u32 part = (u32)MIN(num_blocks,(blkcnt_t)self->vb_discard);
+    req->r_discard.d_sector      = first_block;
+    req->r_discard.d_num_sectors = part;
+    req->r_discard.d_flags       = 0;
+    VirtioBlk_Prepare(queue,count,VIRTIO_BLK_T_DISCARD,0,
+                      queue->bq_reqphys+count*sizeof(struct virtio_blk_req)+
+                      COMPILER_OFFSETOF(struct virtio_blk_req,r_discard),
+                      sizeof(struct virtio_blk_discard),0);
+    first_block += part;
+    num_blocks  -= part;
+   }
+   VirtioBlk_Submit(self,queue,count);
+  }
+ } FINALLY {
+  mutex_put(&queue->bq_lock);
+ }
+}
+
+PRIVATE ssize_t KCALL
+VirtioBlk_Ioctl(VirtioBlk *__restrict self,
+                unsigned long cmd, USER UNCHECKED void *arg,
+                iomode_t UNUSED(flags)) {
+ switch (cmd) {
+
+ case BLKSECTGET:
+  validate_writable(arg,sizeof(unsigned short));
+  *(unsigned short *)arg = (unsigned short)MIN(0xffff,VIRTIO_BLK_BUFSIZE/VIRTIO_BLK_SECTORSIZE);
+  break;
+
+ case BLKDISCARD: {
+  u64 range[2];
+  validate_readable(arg,sizeof(range));
+  memcpy(range,arg,sizeof(range));
+  if (!self->vb_discard)
+       error_throw(E_NOT_IMPLEMENTED);
+  if (self->vb_device.b_device.d_flags & DEVICE_FREADONLY)
+      error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_READONLY_FILESYSTEM);
+  if ((range[0] | range[1]) & (VIRTIO_BLK_SECTORSIZE-1) ||
+       range[0]+range[1] < range[0] ||
+      (range[0]+range[1])/VIRTIO_BLK_SECTORSIZE > self->vb_device.b_blockcount)
+       error_throw(E_INVALID_ARGUMENT);
+  VirtioBlk_Discard(self,
+                   (blkaddr_t)(range[0]/VIRTIO_BLK_SECTORSIZE),
+                   (blkcnt_t)(range[1]/VIRTIO_BLK_SECTORSIZE));
+ } break;
+
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+ return 0;
+}
+
+
+PRIVATE ATTR_FREETEXT void KCALL
+VirtioBlk_InitQueue(VirtioBlk *__restrict self,
+                    VirtioBlkQueue *__restrict queue,
+                    u16 index, u16 size) {
+ size_t req_size; u16 i;
+ u16 maxreq = MIN(size/3,VIRTIO_BLK_MAXBATCH);
+ req_size = CEIL_ALIGN(maxreq*sizeof(struct virtio_blk_req),PAGESIZE);
+ virtqueue_init(&queue->bq_queue,&self->vb_virtio,index,size,
+                req_size+VIRTIO_BLK_BUFSIZE);
+ mutex_cinit(&queue->bq_lock);
+ queue->bq_maxreq   = maxreq;
+ queue->bq_req      = (struct virtio_blk_req *)VIRTQUEUE_XMEM(&queue->bq_queue);
+ queue->bq_reqphys  = VIRTQUEUE_XPHYS(&queue->bq_queue);
+ queue->bq_buf      = VIRTQUEUE_XMEM(&queue->bq_queue)+req_size;
+ queue->bq_bufphys  = VIRTQUEUE_XPHYS(&queue->bq_queue)+req_size;
+ /* Pre-link the header and status descriptors of all requests. */
+ for (i = 0; i < maxreq; ++i) {
+  struct vring_desc *desc = &queue->bq_queue.vq_desc[i*3];
+  vm_phys_t req_phys = queue->bq_reqphys+i*sizeof(struct virtio_blk_req);
+  desc[0].d_addr  = req_phys;
+  desc[0].d_len   = VIRTIO_BLK_REQ_HDRSIZE;
+  desc[0].d_flags = VRING_DESC_FNEXT;
+  desc[1].d_next  = i*3+2;
+  desc[2].d_addr  = req_phys+COMPILER_OFFSETOF(struct virtio_blk_req,r_status);
+  desc[2].d_len   = 1;
+  desc[2].d_flags = VRING_DESC_FWRITE;
+ }
+}
+
+PRIVATE ATTR_FREETEXT void KCALL
+VirtioBlk_Probe(struct pci_device *__restrict pci) {
+ VirtioBlk *EXCEPT_VAR self;
+ struct virtio_device transport;
+ u16 EXCEPT_VAR num_queues = 1;
+ u16 i,queue_size;
+ unsigned int index = ATOMIC_READ(VirtioBlk_Count);
+ if (index >= VIRTIO_BLK_MAXDEVICES)
+     return;
+ if (!virtio_open(&transport,pci))
+     return;
+ TRY {
+  virtio_negotiate(&transport,
+                   VIRTIO_FEATURE(VIRTIO_F_RING_EVENT_IDX)|
+                   VIRTIO_FEATURE(VIRTIO_BLK_F_SIZE_MAX)|
+                   VIRTIO_FEATURE(VIRTIO_BLK_F_RO)|
+                   VIRTIO_FEATURE(VIRTIO_BLK_F_FLUSH)|
+                   VIRTIO_FEATURE(VIRTIO_BLK_F_MQ)|
+                   VIRTIO_FEATURE(VIRTIO_BLK_F_DISCARD));
+  /* Use one request queue per CPU, if the device allows it. */
+  if (transport.vd_features & VIRTIO_FEATURE(VIRTIO_BLK_F_MQ)) {
+   num_queues = virtio_readcfg16(&transport,VIRTIO_BLK_CFG_NUM_QUEUES);
+   num_queues = MIN(num_queues,MIN(cpu_count,VIRTIO_BLK_MAXQUEUES));
+   if unlikely(!num_queues) num_queues = 1;
+  }
+  self = (VirtioBlk *)block_device_alloc(COMPILER_OFFSETOF(VirtioBlk,vb_queuev)+
+                                         num_queues*sizeof(VirtioBlkQueue),
+                                         VIRTIO_BLK_MAXPARTS);
+  TRY {
+   memcpy(&self->vb_virtio,&transport,sizeof(struct virtio_device));
+   self->vb_reqmax = VIRTIO_BLK_REQSIZE;
+   if (transport.vd_features & VIRTIO_FEATURE(VIRTIO_BLK_F_SIZE_MAX)) {
+    u32 size_max = virtio_readcfg32(&transport,VIRTIO_BLK_CFG_SIZE_MAX);
+    size_max &= ~(VIRTIO_BLK_SECTORSIZE-1);
+    if (size_max && size_max < self->vb_reqmax)
+        self->vb_reqmax = size_max;
+   }
+   if (transport.vd_features & VIRTIO_FEATURE(VIRTIO_BLK_F_DISCARD)) {
+    self->vb_discard = virtio_readcfg32(&transport,VIRTIO_BLK_CFG_MAX_DISCARD_SECTORS);
+    if (!virtio_readcfg32(&transport,VIRTIO_BLK_CFG_MAX_DISCARD_SEG))
+         self->vb_discard = 0;
+   }
+   for (i = 0; i < num_queues; ++i) {
+    queue_size = virtio_queue_size(&self->vb_virtio,i);
+    if (self->vb_virtio.vd_flags & VIRTIO_DEVICE_FMODERN)
+        queue_size = MIN(queue_size,VIRTIO_BLK_MAXQUEUESIZE);
+    if (queue_size < 3 || (queue_size & (queue_size-1))) {
+     if (!i) error_throw(E_IOERROR);
+     break;
+    }
+    TRY {
+     VirtioBlk_InitQueue(self,&self->vb_queuev[i],i,queue_size);
+    } CATCH (E_BADALLOC) {
+     /* Continue with fewer queues if we already have one. */
+     if (!i) error_rethrow();
+     error_handled();
+     break;
+    }
+   }
+   self->vb_queuec = i;
+   self->vb_device.b_blockcount  = (blkcnt_t)virtio_readcfg64(&transport,VIRTIO_BLK_CFG_CAPACITY);
+   if (!self->vb_device.b_blockcount)
+        error_throw(E_IOERROR);
+   self->vb_device.b_blocksize   = VIRTIO_BLK_SECTORSIZE;
+   self->vb_device.b_io.io_read  = (void(KCALL *)(struct block_device *__restrict,CHECKED USER void *,size_t,blkaddr_t))&VirtioBlk_Read;
+   self->vb_device.b_io.io_write = (void(KCALL *)(struct block_device *__restrict,CHECKED USER void const *,size_t,blkaddr_t))&VirtioBlk_Write;
+   self->vb_device.b_io.io_sync  = (void(KCALL *)(struct block_device *__restrict))&VirtioBlk_Sync;
+   self->vb_device.b_io.io_ioctl = (ssize_t(KCALL *)(struct block_device *__restrict,unsigned long,USER UNCHECKED void *,iomode_t))&VirtioBlk_Ioctl;
+   if (transport.vd_features & VIRTIO_FEATURE(VIRTIO_BLK_F_RO))
+       self->vb_device.b_device.d_flags |= DEVICE_FREADONLY;
+   self->vb_device.b_device.d_devno = MKDEV(VIRTIO_BLK_MAJOR,index*(VIRTIO_BLK_MAXPARTS+1));
+   sprintf(self->vb_device.b_device.d_namebuf,"vd%c",'a'+index);
+
+   /* Make the device known to the interrupt handler before installing it. */
+   block_device_incref(&self->vb_device);
+   VirtioBlk_Devices[index] = self;
+   ATOMIC_WRITE(VirtioBlk_Count,index+1);
+   if (self->vb_virtio.vd_irq != 0xff) {
+    u8 line = self->vb_virtio.vd_irq;
+    if ((VirtioBlk_IrqLines & (1 << line)) ||
+         x86_pic_sethandler(line,&VirtioBlk_Interrupt,(void *)(uintptr_t)line)) {
+     VirtioBlk_IrqLines |= 1 << line;
+     self->vb_virtio.vd_flags |= VIRTIO_DEVICE_FIRQ;
+    }
+   }
+   debug_printf("[VIRTIO] Found %s block device %s (%I64u sectors, %I16u queues, irq %s)\n",
+                self->vb_virtio.vd_flags & VIRTIO_DEVICE_FMODERN ? "modern" : "legacy",
+                self->vb_device.b_device.d_namebuf,
+               (u64)self->vb_device.b_blockcount,self->vb_queuec,
+                self->vb_virtio.vd_flags & VIRTIO_DEVICE_FIRQ ? "yes" : "no (polling)");
+   virtio_ready(&self->vb_virtio);
+
+   /* Register the device. */
+   register_device(&self->vb_device.b_device);
+   /* Automatically construct partitions. */
+   block_device_autopart(&self->vb_device);
+  } FINALLY {
+   block_device_decref(&self->vb_device);
+  }
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  virtio_fail(&transport);
+  error_rethrow();
+ }
+}
+
+DEFINE_DRIVER_INIT(VirtioBlk_Init);
+PRIVATE ATTR_USED ATTR_FREETEXT void KCALL VirtioBlk_Init(void) {
+ struct pci_device *dev;
+ PCI_FOREACH(dev) {
+  if (dev->pd_vendorid != VIRTIO_PCI_VENDORID)
+      continue;
+  if (dev->pd_deviceid != VIRTIO_PCI_DEVICEID_BLK &&
+      dev->pd_deviceid != VIRTIO_PCI_DEVICEID_BLK_V1)
+      continue;
+  TRY VirtioBlk_Probe(dev);
+  CATCH_HANDLED(E_IOERROR) {}
+ }
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_C */
@@ -0,0 +1,118 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_H
+#define GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_H 1
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <fs/device.h>
+#include <sched/mutex.h>
+
+#include "virtio.h"
+
+DECL_BEGIN
+
+#define VIRTIO_ID_BLOCK             2
+#define VIRTIO_PCI_DEVICEID_BLK     0x1001 /* Transitional block device. */
+#define VIRTIO_PCI_DEVICEID_BLK_V1 (VIRTIO_PCI_DEVICEID_V1+VIRTIO_ID_BLOCK)
+
+/* Block device feature bits. */
+#define VIRTIO_BLK_F_SIZE_MAX  1  /* `size_max' is the max size of any single segment. */
+#define VIRTIO_BLK_F_SEG_MAX   2  /* `seg_max' is the max number of segments in a request. */
+#define VIRTIO_BLK_F_RO        5  /* The device is read-only. */
+#define VIRTIO_BLK_F_FLUSH     9  /* Cache flush command support. */
+#define VIRTIO_BLK_F_MQ        12 /* The device supports multiple request queues. */
+#define VIRTIO_BLK_F_DISCARD   13 /* The device supports discard commands. */
+
+/* Block device configuration layout. */
+#define VIRTIO_BLK_CFG_CAPACITY    0x00 /* [u64] Capacity (in 512-byte sectors). */
+#define VIRTIO_BLK_CFG_SIZE_MAX    0x08 /* [u32][VIRTIO_BLK_F_SIZE_MAX] */
+#define VIRTIO_BLK_CFG_SEG_MAX     0x0c /* [u32][VIRTIO_BLK_F_SEG_MAX] */
+#define VIRTIO_BLK_CFG_NUM_QUEUES  0x22 /* [u16][VIRTIO_BLK_F_MQ] */
+#define VIRTIO_BLK_CFG_MAX_DISCARD_SECTORS 0x24 /* [u32][VIRTIO_BLK_F_DISCARD] */
+#define VIRTIO_BLK_CFG_MAX_DISCARD_SEG     0x28 /* [u32][VIRTIO_BLK_F_DISCARD] */
+
+/* Request types. */
+#define VIRTIO_BLK_T_IN        0  /* Read sectors. */
+#define VIRTIO_BLK_T_OUT       1  /* Write sectors. */
+#define VIRTIO_BLK_T_FLUSH     4  /* Flush the write cache. */
+#define VIRTIO_BLK_T_DISCARD   11 /* Discard sectors. */
+
+/* Request status codes. */
+#define VIRTIO_BLK_S_OK        0
+#define VIRTIO_BLK_S_IOERR     1
+#define VIRTIO_BLK_S_UNSUPP    2
+
+#define VIRTIO_BLK_SECTORSIZE  512
+#define VIRTIO_BLK_MAXQUEUES   16      /* Max number of request queues per device. */
+#define VIRTIO_BLK_MAXQUEUESIZE 256    /* Max number of descriptors per queue. */
+#define VIRTIO_BLK_MAXBATCH    32      /* Max number of requests submitted at once. */
+#define VIRTIO_BLK_BUFSIZE     0x20000 /* Size of the DMA buffer of each queue. */
+#define VIRTIO_BLK_REQSIZE     0x8000  /* Default max size of a single request. */
+#define VIRTIO_BLK_MAXDEVICES  26      /* vda...vdz */
+#define VIRTIO_BLK_MAJOR       254
+#define VIRTIO_BLK_MAXPARTS    15
+
+
+#ifdef __CC__
+struct PACKED virtio_blk_discard {
+    u64 d_sector;      /* First sector to discard. */
+    u32 d_num_sectors; /* Number of sectors to discard. */
+    u32 d_flags;       /* Unused (ZERO) */
+};
+
+/* Per-request DMA data (Read by the device, except for `r_status') */
+struct PACKED virtio_blk_req {
+    u32                       r_type;     /* Request type (One of `VIRTIO_BLK_T_*') */
+    u32                       r_reserved; /* Always ZERO */
+    u64                       r_sector;   /* First sector. */
+    struct virtio_blk_discard r_discard;  /* [VIRTIO_BLK_T_DISCARD] Discard segment. */
+    u8                        r_status;   /* [out] Request status (One of `VIRTIO_BLK_S_*') */
+    u8                      __r_pad[15];
+};
+#define VIRTIO_BLK_REQ_HDRSIZE  16
+
+typedef struct {
+    struct virtqueue          bq_queue;   /* The underlying virtqueue. */
+    struct mutex              bq_lock;    /* Lock held while a batch of requests is in flight. */
+    u16                       bq_maxreq;  /* [const] Max number of requests per batch.
+                                           *  Request #i always uses descriptors 3*i...3*i+2 */
+    bool                      bq_broken;  /* [lock(bq_lock)] A request timed out, and the device
+                                           *  may still own the queue's memory. */
+    u8                      __bq_pad;
+    struct virtio_blk_req    *bq_req;     /* [1..bq_maxreq][const] Request headers. */
+    PHYS vm_phys_t            bq_reqphys; /* [const] Physical address of `bq_req' */
+    VIRT byte_t              *bq_buf;     /* [1..VIRTIO_BLK_BUFSIZE][const] DMA data buffer. */
+    PHYS vm_phys_t            bq_bufphys; /* [const] Physical address of `bq_buf' */
+} VirtioBlkQueue;
+
+typedef struct {
+    struct block_device       vb_device;  /* Underlying block device. */
+    struct virtio_device      vb_virtio;  /* Virtio transport. */
+    u32                       vb_reqmax;  /* [const] Max number of bytes per request. */
+    u32                       vb_discard; /* [const] Max number of sectors per discard (ZERO if unsupported). */
+    u16                       vb_queuec;  /* [const] Number of request queues. */
+    u16                     __vb_pad[3];
+    VirtioBlkQueue            vb_queuev[1]; /* [vb_queuec][const] Request queues (One per CPU, if possible) */
+} VirtioBlk;
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_VIRTIO_BLK_BLK_H */
@@ -0,0 +1,462 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_C
+#define GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_C 1
+#define _KOS_SOURCE 1
+
+/* Required because requests can't be abandoned once submitted. */
+#define _NOSERVE_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/align.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <dev/pci.h>
+#include <kernel/debug.h>
+#include <kernel/memory.h>
+#include <kernel/paging.h>
+#include <kernel/vm.h>
+#include <sched/async_signal.h>
+#include <sched/task.h>
+#include <sys/io.h>
+#include <sys/mman.h>
+#include <except.h>
+#include <string.h>
+#include <assert.h>
+
+#include "virtio.h"
+
+DECL_BEGIN
+
+INTERN VIRT void *KCALL
+virtio_dma_alloc(size_t num_bytes, PHYS vm_phys_t *__restrict pphys) {
+ REF struct vm_region *EXCEPT_VAR region;
+ VIRT void *COMPILER_IGNORE_UNINITIALIZED(result);
+ size_t num_pages = CEILDIV(num_bytes,PAGESIZE);
+ pageptr_t COMPILER_IGNORE_UNINITIALIZED(pages);
+ assert(num_pages != 0);
+ region = vm_region_alloc(num_pages);
+ TRY {
+  /* The device accesses this memory by its physical address,
+   * so it must be continuous, and can never be swapped.
+   * Once assigned, the pages are owned by the region. */
+  pages = page_malloc(num_pages,MZONE_ANY);
+  region->vr_type           = VM_REGION_PHYSICAL;
+  region->vr_part0.vp_state = VM_PART_INCORE;
+  region->vr_part0.vp_flags = VM_PART_FKEEP|VM_PART_FNOSWAP;
+  region->vr_part0.vp_phys.py_num_scatter = 1;
+  region->vr_part0.vp_phys.py_iscatter[0].ps_addr = pages;
+  region->vr_part0.vp_phys.py_iscatter[0].ps_size = num_pages;
+  result = vm_map(VM_KERNELDRIVER_HINT,
+                  num_pages,
+                  1,
+                  0,
+                  VM_KERNELDRIVER_MODE,
+                  0,
+                  region,
+                  PROT_READ|PROT_WRITE|PROT_NOUSER,
+                  NULL,
+                  NULL);
+ } FINALLY {
+  vm_region_decref(region);
+ }
+ *pphys = (vm_phys_t)pages * PAGESIZE;
+ memset(result,0,num_pages*PAGESIZE);
+ return result;
+}
+
+/* Map the memory-BAR `bar' of the given PCI device as uncached memory. */
+PRIVATE VIRT byte_t volatile *KCALL
+virtio_map_bar(struct pci_device *__restrict dev, u8 bar) {
+ REF struct vm_region *EXCEPT_VAR region;
+ VIRT byte_t *COMPILER_IGNORE_UNINITIALIZED(result);
+ struct pci_resource *res;
+ size_t num_pages;
+ if unlikely(bar >= PD_RESOURCE_EXPROM)
+    return NULL;
+ res = &dev->pd_res[PD_RESOURCE_BAR(bar)];
+ if (!res->pr_size || !PCI_RESOURCE_ISMEM(res->pr_flags))
+      return NULL;
+ num_pages = CEILDIV((res->pr_begin & (PAGESIZE-1))+res->pr_size,PAGESIZE);
+ region = vm_region_alloc(num_pages);
+ TRY {
+  region->vr_type           = VM_REGION_PHYSICAL;
+  region->vr_flags         |= VM_REGION_FMEMTYPE_UC; /* Device registers. */
+  region->vr_part0.vp_state = VM_PART_INCORE;
+  region->vr_part0.vp_flags = VM_PART_FKEEP|VM_PART_FWEAKREF|VM_PART_FNOSWAP;
+  region->vr_part0.vp_phys.py_num_scatter = 1;
+  region->vr_part0.vp_phys.py_iscatter[0].ps_addr = VM_ADDR2PAGE(res->pr_begin);
+  region->vr_part0.vp_phys.py_iscatter[0].ps_size = num_pages;
+  result = (VIRT byte_t *)vm_map(VM_KERNELDRIVER_HINT,
+                                 num_pages,
+                                 1,
+                                 0,
+                                 VM_KERNELDRIVER_MODE,
+                                 0,
+                                 region,
+                                 PROT_READ|PROT_WRITE|PROT_NOUSER,
+                                 NULL,
+                                 NULL);
+ } FINALLY {
+  vm_region_decref(region);
+ }
+ return result + (res->pr_begin & (PAGESIZE-1));
+}
+
+
+PRIVATE u8 KCALL
+virtio_getstatus(struct virtio_device *__restrict self) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     return self->vd_common->cc_device_status;
+ return inb(self->vd_iobase+VIRTIO_LEGACY_STATUS);
+}
+PRIVATE void KCALL
+virtio_setstatus(struct virtio_device *__restrict self, u8 status) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     self->vd_common->cc_device_status = status;
+ else {
+     outb(self->vd_iobase+VIRTIO_LEGACY_STATUS,status);
+ }
+}
+
+/* Search the PCI capability list for the modern virtio register blocks. */
+PRIVATE bool KCALL
+virtio_open_modern(struct virtio_device *__restrict self,
+                   struct pci_device *__restrict dev) {
+ VIRT byte_t volatile *bars[PD_RESOURCE_EXPROM];
+ VIRT byte_t volatile *blocks[VIRTIO_PCI_CAP_DEVICE_CFG+1];
+ unsigned int limit = 48; /* Protect against capability loops. */
+ u8 cap; unsigned int i;
+ if (!(pci_read(dev->pd_base,PCI_DEV4) &
+      (PCI_CDEV4_STAT_HAVE_CAPLINK_34 << PCI_DEV4_STATSHIFT)))
+       return false;
+ memset(bars,0,sizeof(bars));
+ memset(blocks,0,sizeof(blocks));
+ cap = (u8)(pci_read(dev->pd_base,PCI_GDEV_RES0) & PCI_GDEV_RES0_CAPPTRMASK);
+ while (cap >= 0x40 && limit--) {
+  u32 word = pci_read(dev->pd_base,cap & ~3);
+  u8 type,bar; u32 offset,length;
+  if ((word & 0xff) != PCI_CAPID_VENDOR)
+       goto next;
+  type = (u8)(word >> 24);
+  if (type < VIRTIO_PCI_CAP_COMMON_CFG ||
+      type > VIRTIO_PCI_CAP_DEVICE_CFG ||
+      blocks[type])
+      goto next;
+  bar    = (u8)pci_read(dev->pd_base,cap+VIRTIO_PCI_CAP_OFFSETOF_BAR);
+  offset = pci_read(dev->pd_base,cap+VIRTIO_PCI_CAP_OFFSETOF_OFFSET);
+  length = pci_read(dev->pd_base,cap+VIRTIO_PCI_CAP_OFFSETOF_LENGTH);
+  if (bar >= PD_RESOURCE_EXPROM ||
+     (u64)offset+length > dev->pd_res[PD_RESOURCE_BAR(bar)].pr_size)
+      goto next;
+  if (!bars[bar] && (bars[bar] = virtio_map_bar(dev,bar)) == NULL)
+      goto next;
+  blocks[type] = bars[bar]+offset;
+  if (type == VIRTIO_PCI_CAP_NOTIFY_CFG)
+      self->vd_notify_mul = pci_read(dev->pd_base,cap+VIRTIO_PCI_CAP_OFFSETOF_NOTIFY_MULTIPLIER);
+next:
+  cap = (u8)(word >> 8) & ~3;
+ }
+ for (i = VIRTIO_PCI_CAP_COMMON_CFG; i <= VIRTIO_PCI_CAP_DEVICE_CFG; ++i) {
+  /* XXX: Unmap BARs mapped by incomplete capability lists? */
+  if (!blocks[i]) return false;
+ }
+ self->vd_common = (struct virtio_pci_common_cfg volatile *)blocks[VIRTIO_PCI_CAP_COMMON_CFG];
+ self->vd_notify = blocks[VIRTIO_PCI_CAP_NOTIFY_CFG];
+ self->vd_isr    = (u8 volatile *)blocks[VIRTIO_PCI_CAP_ISR_CFG];
+ self->vd_config = blocks[VIRTIO_PCI_CAP_DEVICE_CFG];
+ self->vd_flags |= VIRTIO_DEVICE_FMODERN;
+ return true;
+}
+
+INTERN bool KCALL
+virtio_open(struct virtio_device *__restrict self,
+            struct pci_device *__restrict dev) {
+ u32 cmd; u8 line;
+ memset(self,0,sizeof(struct virtio_device));
+ self->vd_pci = dev;
+ self->vd_irq = 0xff;
+ if (dev->pd_vendorid != VIRTIO_PCI_VENDORID)
+     return false;
+ if (!virtio_open_modern(self,dev)) {
+  /* Fall back to the legacy interface of transitional devices. */
+  if (dev->pd_deviceid < VIRTIO_PCI_DEVICEID_MIN ||
+      dev->pd_deviceid > VIRTIO_PCI_DEVICEID_MAX ||
+     !PCI_RESOURCE_ISIO(dev->pd_res[PD_RESOURCE_BAR0].pr_flags))
+      return false;
+  self->vd_iobase = (u16)dev->pd_res[PD_RESOURCE_BAR0].pr_begin;
+ }
+ /* Enable I/O and memory decoding, bus-mastering (for DMA), and interrupts. */
+ cmd  = pci_read(dev->pd_base,PCI_DEV4) & PCI_DEV4_CMDMASK;
+ cmd &= ~PCI_CDEV4_NOIRQ;
+ cmd |= PCI_CDEV4_ALLOW_IOTOUCH|PCI_CDEV4_ALLOW_MEMTOUCH|PCI_CDEV4_BUSMASTER;
+ pci_write(dev->pd_base,PCI_DEV4,cmd);
+ line = (u8)PCI_GDEV3C_IRQLINE(pci_read(dev->pd_base,PCI_GDEV3C));
+ if (line < 16) self->vd_irq = line;
+
+ /* Reset the device, and tell it that we've found it. */
+ virtio_setstatus(self,0);
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN) {
+  /* Modern devices indicate completion of the reset by reading back ZERO. */
+  while (virtio_getstatus(self) != 0)
+      task_yield();
+ }
+ virtio_setstatus(self,VIRTIO_STATUS_FACKNOWLEDGE);
+ virtio_setstatus(self,VIRTIO_STATUS_FACKNOWLEDGE|VIRTIO_STATUS_FDRIVER);
+ return true;
+}
+
+INTERN void KCALL
+virtio_negotiate(struct virtio_device *__restrict self, u64 features) {
+ u64 offered;
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN) {
+  struct virtio_pci_common_cfg volatile *cfg = self->vd_common;
+  cfg->cc_device_feature_select = 0;
+  offered  = (u64)cfg->cc_device_feature;
+  cfg->cc_device_feature_select = 1;
+  offered |= (u64)cfg->cc_device_feature << 32;
+  features |= VIRTIO_FEATURE(VIRTIO_F_VERSION_1);
+  features &= offered;
+  if unlikely(!(features & VIRTIO_FEATURE(VIRTIO_F_VERSION_1)))
+     error_throw(E_IOERROR);
+  cfg->cc_driver_feature_select = 0;
+  cfg->cc_driver_feature        = (u32)features;
+  cfg->cc_driver_feature_select = 1;
+  cfg->cc_driver_feature        = (u32)(features >> 32);
+  virtio_setstatus(self,VIRTIO_STATUS_FACKNOWLEDGE|
+                        VIRTIO_STATUS_FDRIVER|
+                        VIRTIO_STATUS_FFEATURES_OK);
+  /* The device may refuse the selected subset. */
+  if unlikely(!(virtio_getstatus(self) & VIRTIO_STATUS_FFEATURES_OK))
+     error_throw(E_IOERROR);
+ } else {
+  /* The legacy interface only knows about the first 32 features. */
+  offered   = (u64)inl(self->vd_iobase+VIRTIO_LEGACY_HOST_FEATURES);
+  features &= offered & 0xffffffff;
+  outl(self->vd_iobase+VIRTIO_LEGACY_GUEST_FEATURES,(u32)features);
+ }
+ self->vd_features = features;
+ if (features & VIRTIO_FEATURE(VIRTIO_F_RING_EVENT_IDX))
+     self->vd_flags |= VIRTIO_DEVICE_FEVENT;
+}
+
+INTERN void KCALL
+virtio_ready(struct virtio_device *__restrict self) {
+ virtio_setstatus(self,virtio_getstatus(self)|VIRTIO_STATUS_FDRIVER_OK);
+}
+INTERN void KCALL
+virtio_fail(struct virtio_device *__restrict self) {
+ virtio_setstatus(self,virtio_getstatus(self)|VIRTIO_STATUS_FFAILED);
+}
+INTERN u8 KCALL
+virtio_ackirq(struct virtio_device *__restrict self) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     return *self->vd_isr;
+ return inb(self->vd_iobase+VIRTIO_LEGACY_ISR);
+}
+
+
+INTERN u8 KCALL
+virtio_readcfg8(struct virtio_device *__restrict self, u16 offset) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     return *(u8 volatile *)(self->vd_config+offset);
+ return inb(self->vd_iobase+VIRTIO_LEGACY_CONFIG+offset);
+}
+INTERN u16 KCALL
+virtio_readcfg16(struct virtio_device *__restrict self, u16 offset) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     return *(u16 volatile *)(self->vd_config+offset);
+ return inw(self->vd_iobase+VIRTIO_LEGACY_CONFIG+offset);
+}
+INTERN u32 KCALL
+virtio_readcfg32(struct virtio_device *__restrict self, u16 offset) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN)
+     return *(u32 volatile *)(self->vd_config+offset);
+ return inl(self->vd_iobase+VIRTIO_LEGACY_CONFIG+offset);
+}
+INTERN u64 KCALL
+virtio_readcfg64(struct virtio_device *__restrict self, u16 offset) {
+ u32 lo,hi; u8 generation;
+ if (!(self->vd_flags & VIRTIO_DEVICE_FMODERN)) {
+  lo = inl(self->vd_iobase+VIRTIO_LEGACY_CONFIG+offset);
+  hi = inl(self->vd_iobase+VIRTIO_LEGACY_CONFIG+offset+4);
+  return (u64)hi << 32 | lo;
+ }
+ /* Use the configuration generation to detect torn reads. */
+ do {
+  generation = self->vd_common->cc_config_generation;
+  lo = *(u32 volatile *)(self->vd_config+offset);
+  hi = *(u32 volatile *)(self->vd_config+offset+4);
+ } while (generation != self->vd_common->cc_config_generation);
+ return (u64)hi << 32 | lo;
+}
+
+
+INTERN u16 KCALL
+virtio_queue_size(struct virtio_device *__restrict self, u16 index) {
+ if (self->vd_flags & VIRTIO_DEVICE_FMODERN) {
+  self->vd_common->cc_queue_select = index;
+  return self->vd_common->cc_queue_size;
+ }
+ outw(self->vd_iobase+VIRTIO_LEGACY_QUEUE_SELECT,index);
+ return inw(self->vd_iobase+VIRTIO_LEGACY_QUEUE_SIZE);
+}
+
+INTERN void KCALL
+virtqueue_init(struct virtqueue *__restrict self,
+               struct virtio_device *__restrict dev,
+               u16 index, u16 size, size_t extra_bytes) {
+ size_t desc_size,avail_size,used_size;
+ assertf(size && !(size & (size-1)),"size = %I16u",size);
+ desc_size  = size*sizeof(struct vring_desc);
+ avail_size = 6+size*sizeof(u16);
+ used_size  = 6+size*sizeof(struct vring_used_elem);
+ memset(self,0,sizeof(struct virtqueue));
+ async_sig_cinit(&self->vq_signal);
+ self->vq_index  = index;
+ self->vq_size   = size;
+ /* Use the legacy layout for both transports, so
+  * the used ring always starts on its own page. */
+ self->vq_ringsz = CEIL_ALIGN(desc_size+avail_size,VIRTIO_LEGACY_ALIGN)+
+                   CEIL_ALIGN(used_size,VIRTIO_LEGACY_ALIGN);
+ self->vq_memsz  = self->vq_ringsz+CEIL_ALIGN(extra_bytes,PAGESIZE);
+ self->vq_mem    = (VIRT byte_t *)virtio_dma_alloc(self->vq_memsz,&self->vq_phys);
+ self->vq_desc        = (struct vring_desc *)self->vq_mem;
+ self->vq_avail       = (struct vring_avail *)(self->vq_mem+desc_size);
+ self->vq_used_event  = &self->vq_avail->a_ring[size];
+ self->vq_used        = (struct vring_used volatile *)(self->vq_mem+
+                         CEIL_ALIGN(desc_size+avail_size,VIRTIO_LEGACY_ALIGN));
+ self->vq_avail_event = (u16 volatile *)&self->vq_used->u_ring[size];
+ /* Without event indices, suppress interrupts until somebody waits. */
+ if (!(dev->vd_flags & VIRTIO_DEVICE_FEVENT))
+     self->vq_avail->a_flags = VRING_AVAIL_FNO_INTERRUPT;
+
+ if (dev->vd_flags & VIRTIO_DEVICE_FMODERN) {
+  struct virtio_pci_common_cfg volatile *cfg = dev->vd_common;
+  vm_phys_t addr;
+  cfg->cc_queue_select      = index;
+  cfg->cc_queue_size        = size;
+  cfg->cc_queue_msix_vector = VIRTIO_MSI_NO_VECTOR;
+  /* 64-bit fields are written as 2 halves (low, then high). */
+  addr = self->vq_phys;
+  ((u32 volatile *)&cfg->cc_queue_desc)[0] = (u32)addr;
+  ((u32 volatile *)&cfg->cc_queue_desc)[1] = (u32)(addr >> 32);
+  addr = self->vq_phys+desc_size;
+  ((u32 volatile *)&cfg->cc_queue_avail)[0] = (u32)addr;
+  ((u32 volatile *)&cfg->cc_queue_avail)[1] = (u32)(addr >> 32);
+  addr = self->vq_phys+((uintptr_t)self->vq_used-(uintptr_t)self->vq_mem);
+  ((u32 volatile *)&cfg->cc_queue_used)[0] = (u32)addr;
+  ((u32 volatile *)&cfg->cc_queue_used)[1] = (u32)(addr >> 32);
+  self->vq_notify = dev->vd_notify+(u32)cfg->cc_queue_notify_off*dev->vd_notify_mul;
+  cfg->cc_queue_enable = 1;
+ } else {
+  assertf(size == virtio_queue_size(dev,index),
+          "Legacy queues must use the size chosen by the device");
+  outw(dev->vd_iobase+VIRTIO_LEGACY_QUEUE_SELECT,index);
+  outl(dev->vd_iobase+VIRTIO_LEGACY_QUEUE_PFN,
+      (u32)(self->vq_phys / VIRTIO_LEGACY_ALIGN));
+ }
+}
+
+INTERN void KCALL
+virtqueue_kick(struct virtqueue *__restrict self,
+               struct virtio_device *__restrict dev) {
+ u16 old_idx = self->vq_kick_idx;
+ u16 new_idx = self->vq_avail_idx;
+ bool need_notify;
+ if (old_idx == new_idx)
+     return;
+ /* Interrupt coalescing: Only have the device interrupt
+  * once the last chain of the batch has been used. */
+ if (dev->vd_flags & VIRTIO_DEVICE_FEVENT)
+     *self->vq_used_event = (u16)(new_idx-1);
+ /* Publish all new ring entries at once. */
+ ATOMIC_WRITE(self->vq_avail->a_idx,new_idx);
+ self->vq_kick_idx = new_idx;
+ VIRTIO_MB();
+ if (dev->vd_flags & VIRTIO_DEVICE_FEVENT)
+      need_notify = VRING_NEED_EVENT(*self->vq_avail_event,new_idx,old_idx);
+ else need_notify = !(self->vq_used->u_flags & VRING_USED_FNO_NOTIFY);
+ if (!need_notify)
+     return; /* The device is still processing the ring. */
+ if (dev->vd_flags & VIRTIO_DEVICE_FMODERN)
+     *(u16 volatile *)self->vq_notify = self->vq_index;
+ else {
+     outw(dev->vd_iobase+VIRTIO_LEGACY_QUEUE_NOTIFY,self->vq_index);
+ }
+}
+
+#define VIRTQUEUE_DONE(self,target) \
+   ((self)->vq_used->u_idx == (target))
+
+INTERN bool KCALL
+virtqueue_wait(struct virtqueue *__restrict self,
+               struct virtio_device *__restrict dev,
+               jtime_t timeout) {
+ u16 target = self->vq_kick_idx;
+ jtime_t abs_timeout;
+ if (!PREEMPTION_ENABLED()) {
+  /* Special case: Without preemption enabled, poll for completion. */
+  timeout <<= 16;
+  while (!VIRTQUEUE_DONE(self,target)) {
+   if (!timeout--) return false;
+   COMPILER_READ_BARRIER();
+  }
+  goto done;
+ }
+ abs_timeout = jiffies + timeout;
+ if (!(dev->vd_flags & VIRTIO_DEVICE_FIRQ)) {
+  /* No interrupt line available. - Poll for completion. */
+  while (!VIRTQUEUE_DONE(self,target)) {
+   if (jiffies >= abs_timeout) return false;
+   task_yield();
+  }
+  goto done;
+ }
+ /* Requests often complete quickly enough to not need an interrupt. */
+ TASK_POLL_BEFORE_CONNECT({
+  if (VIRTQUEUE_DONE(self,target))
+      goto done;
+ });
+ if (!(dev->vd_flags & VIRTIO_DEVICE_FEVENT)) {
+  /* Re-enable interrupts, now that we're about to sleep. */
+  self->vq_avail->a_flags = 0;
+  VIRTIO_MB();
+ }
+ while (!VIRTQUEUE_DONE(self,target)) {
+  struct async_task_connection con;
+  task_connect_async(&con,&self->vq_signal);
+  /* Check again, in case the device finished while we were connecting. */
+  if (VIRTQUEUE_DONE(self,target)) { task_disconnect_async(); break; }
+  if (!task_waitfor_async_noserve(abs_timeout)) {
+   if (!(dev->vd_flags & VIRTIO_DEVICE_FEVENT))
+       self->vq_avail->a_flags = VRING_AVAIL_FNO_INTERRUPT;
+   return false;
+  }
+ }
+ if (!(dev->vd_flags & VIRTIO_DEVICE_FEVENT))
+     self->vq_avail->a_flags = VRING_AVAIL_FNO_INTERRUPT;
+done:
+ self->vq_used_idx = target;
+ return true;
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_C */
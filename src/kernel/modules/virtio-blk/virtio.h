@@ -0,0 +1,264 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_H
+#define GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_H 1
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <kernel/paging.h>
+#include <sched/async_signal.h>
+#include <dev/pci.h>
+
+DECL_BEGIN
+
+/* Based on the `Virtual I/O Device (VIRTIO) Version 1.0' specifications,
+ * including the legacy interface described in section 4.1.4.8 */
+
+#define VIRTIO_PCI_VENDORID      0x1af4
+#define VIRTIO_PCI_DEVICEID_MIN  0x1000 /* First transitional device ID. */
+#define VIRTIO_PCI_DEVICEID_MAX  0x103f /* Last transitional device ID. */
+#define VIRTIO_PCI_DEVICEID_V1   0x1040 /* Base for modern device IDs (+ VIRTIO_ID_*). */
+
+/* Device status flags. */
+#define VIRTIO_STATUS_FACKNOWLEDGE 0x01 /* The guest has noticed the device. */
+#define VIRTIO_STATUS_FDRIVER      0x02 /* The guest knows how to drive the device. */
+#define VIRTIO_STATUS_FDRIVER_OK   0x04 /* The driver is set up and ready to drive the device. */
+#define VIRTIO_STATUS_FFEATURES_OK 0x08 /* Feature negotiation is complete. */
+#define VIRTIO_STATUS_FNEEDS_RESET 0x40 /* The device has experienced an unrecoverable error. */
+#define VIRTIO_STATUS_FFAILED      0x80 /* The guest has given up on the device. */
+
+/* Interrupt status flags. (Reading the ISR acknowledges the interrupt) */
+#define VIRTIO_ISR_FQUEUE          0x01 /* A virtqueue was updated. */
+#define VIRTIO_ISR_FCONFIG         0x02 /* The device configuration has changed. */
+
+/* Device-independent feature bits. */
+#define VIRTIO_F_RING_INDIRECT_DESC 28 /* Indirect descriptors are supported. */
+#define VIRTIO_F_RING_EVENT_IDX     29 /* `used_event' / `avail_event' are supported. */
+#define VIRTIO_F_VERSION_1          32 /* The device complies with version 1.0 (modern interface). */
+#define VIRTIO_FEATURE(bit)        ((u64)1 << (bit))
+
+
+/* Legacy (virtio 0.9.5) I/O register layout within BAR #0. */
+#define VIRTIO_LEGACY_HOST_FEATURES  0x00 /* [u32][r-] Device features. */
+#define VIRTIO_LEGACY_GUEST_FEATURES 0x04 /* [u32][rw] Driver features. */
+#define VIRTIO_LEGACY_QUEUE_PFN      0x08 /* [u32][rw] Physical page number of the selected queue. */
+#define VIRTIO_LEGACY_QUEUE_SIZE     0x0c /* [u16][r-] Size of the selected queue. */
+#define VIRTIO_LEGACY_QUEUE_SELECT   0x0e /* [u16][rw] Queue selector. */
+#define VIRTIO_LEGACY_QUEUE_NOTIFY   0x10 /* [u16][rw] Queue notifier. */
+#define VIRTIO_LEGACY_STATUS         0x12 /* [u8][rw]  Device status. */
+#define VIRTIO_LEGACY_ISR            0x13 /* [u8][r-]  Interrupt status. */
+#define VIRTIO_LEGACY_CONFIG         0x14 /* Device-specific configuration (With MSI-X disabled). */
+#define VIRTIO_LEGACY_ALIGN          4096 /* Alignment of the used ring. */
+
+
+/* Modern PCI transport: vendor-specific capabilities describing register locations. */
+#define PCI_CAPID_VENDOR             0x09
+#define VIRTIO_PCI_CAP_COMMON_CFG    1 /* Common configuration. */
+#define VIRTIO_PCI_CAP_NOTIFY_CFG    2 /* Notifications. */
+#define VIRTIO_PCI_CAP_ISR_CFG       3 /* ISR status. */
+#define VIRTIO_PCI_CAP_DEVICE_CFG    4 /* Device-specific configuration. */
+#define VIRTIO_PCI_CAP_PCI_CFG       5 /* PCI configuration access. */
+
+/* Offsets into a virtio PCI capability (in configuration space). */
+#define VIRTIO_PCI_CAP_OFFSETOF_TYPE    3 /* [u8]  One of `VIRTIO_PCI_CAP_*' */
+#define VIRTIO_PCI_CAP_OFFSETOF_BAR     4 /* [u8]  BAR index. */
+#define VIRTIO_PCI_CAP_OFFSETOF_OFFSET  8 /* [u32] Offset within the BAR. */
+#define VIRTIO_PCI_CAP_OFFSETOF_LENGTH 12 /* [u32] Length of the structure. */
+#define VIRTIO_PCI_CAP_OFFSETOF_NOTIFY_MULTIPLIER 16 /* [u32][VIRTIO_PCI_CAP_NOTIFY_CFG] */
+
+#ifdef __CC__
+struct PACKED virtio_pci_common_cfg {
+    /* About the whole device. */
+    u32 cc_device_feature_select; /* [rw] */
+    u32 cc_device_feature;        /* [r-] */
+    u32 cc_driver_feature_select; /* [rw] */
+    u32 cc_driver_feature;        /* [rw] */
+    u16 cc_msix_config;           /* [rw] */
+    u16 cc_num_queues;            /* [r-] */
+    u8  cc_device_status;         /* [rw] */
+    u8  cc_config_generation;     /* [r-] */
+    /* About a specific virtqueue. */
+    u16 cc_queue_select;          /* [rw] */
+    u16 cc_queue_size;            /* [rw] */
+    u16 cc_queue_msix_vector;     /* [rw] */
+    u16 cc_queue_enable;          /* [rw] */
+    u16 cc_queue_notify_off;      /* [r-] */
+    u64 cc_queue_desc;            /* [rw] */
+    u64 cc_queue_avail;           /* [rw] */
+    u64 cc_queue_used;            /* [rw] */
+};
+#endif /* __CC__ */
+#define VIRTIO_MSI_NO_VECTOR 0xffff
+
+
+/* Virtqueue ring layout. */
+#define VRING_DESC_FNEXT           0x0001 /* The descriptor continues via `d_next'. */
+#define VRING_DESC_FWRITE          0x0002 /* The buffer is device write-only (else: read-only). */
+#define VRING_DESC_FINDIRECT       0x0004 /* The buffer contains a list of buffer descriptors. */
+#define VRING_AVAIL_FNO_INTERRUPT  0x0001 /* Hint: Don't interrupt when buffers are consumed. */
+#define VRING_USED_FNO_NOTIFY      0x0001 /* Hint: Don't notify when buffers are added. */
+
+#ifdef __CC__
+struct PACKED vring_desc {
+    u64 d_addr;  /* Physical buffer address. */
+    u32 d_len;   /* Buffer length (in bytes). */
+    u16 d_flags; /* Set of `VRING_DESC_F*' */
+    u16 d_next;  /* [valid_if(d_flags & VRING_DESC_FNEXT)] Next descriptor. */
+};
+struct PACKED vring_avail {
+    u16 a_flags;    /* Set of `VRING_AVAIL_F*' */
+    u16 a_idx;      /* Index of the next ring entry to-be written. */
+    u16 a_ring[1];  /* [vq_size] Ring of descriptor chain heads.
+                     * Followed by `u16 used_event' (s.a. `VIRTIO_F_RING_EVENT_IDX') */
+};
+struct PACKED vring_used_elem {
+    u32 u_id;       /* Head of the descriptor chain that was used. */
+    u32 u_len;      /* Total number of bytes written by the device. */
+};
+struct PACKED vring_used {
+    u16 u_flags;    /* Set of `VRING_USED_F*' */
+    u16 u_idx;      /* Index of the next ring entry to-be written by the device. */
+    struct vring_used_elem u_ring[1]; /* [vq_size] Ring of used descriptor chains.
+                                       * Followed by `u16 avail_event' (s.a. `VIRTIO_F_RING_EVENT_IDX') */
+};
+
+/* Returns true if the other side wants to be notified about `new_idx', given
+ * that it asked for an event at `event_idx', and the last index was `old_idx' */
+#define VRING_NEED_EVENT(event_idx,new_idx,old_idx) \
+   ((u16)((new_idx)-(event_idx)-1) < (u16)((new_idx)-(old_idx)))
+
+/* Memory barrier ordering ring accesses against reads of the other side. */
+#define VIRTIO_MB()  __hybrid_atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+struct virtqueue {
+    struct async_sig           vq_signal;  /* Broadcast when the device interrupts for this queue. */
+    struct vring_desc         *vq_desc;    /* [1..vq_size][const] Descriptor table. */
+    struct vring_avail        *vq_avail;   /* [1..1][const] Available ring. */
+    struct vring_used volatile*vq_used;    /* [1..1][const] Used ring. */
+    u16                       *vq_used_event;  /* [1..1][const] `used_event' (Trailing the avail ring) */
+    u16 volatile              *vq_avail_event; /* [1..1][const] `avail_event' (Trailing the used ring) */
+    VIRT void volatile        *vq_notify;  /* [0..1][const] Notification address (modern transport). */
+    u16                        vq_index;   /* [const] Queue index. */
+    u16                        vq_size;    /* [const] Number of descriptors (power of 2). */
+    u16                        vq_avail_idx; /* Next value to-be written to `vq_avail->a_idx' */
+    u16                        vq_kick_idx;  /* Value of `vq_avail->a_idx' during the last kick. */
+    u16                        vq_used_idx;  /* Last value of `vq_used->u_idx' consumed by the driver. */
+    u16                      __vq_pad;
+    VIRT byte_t               *vq_mem;     /* [1..1][const] Base of DMA memory allocated for the queue. */
+    PHYS vm_phys_t             vq_phys;    /* [const] Physical address of `vq_mem' */
+    size_t                     vq_ringsz;  /* [const] Size of the ring portion of `vq_mem' (page-aligned) */
+    size_t                     vq_memsz;   /* [const] Total size of `vq_mem' (page-aligned) */
+};
+
+/* Virtual/physical address of DMA memory trailing the ring of a virtqueue. */
+#define VIRTQUEUE_XMEM(self)  ((self)->vq_mem+(self)->vq_ringsz)
+#define VIRTQUEUE_XPHYS(self) ((self)->vq_phys+(self)->vq_ringsz)
+
+
+#define VIRTIO_DEVICE_FNORMAL 0x0000 /* Normal device flags. */
+#define VIRTIO_DEVICE_FMODERN 0x0001 /* The device is driven using the modern (v1.0) interface. */
+#define VIRTIO_DEVICE_FIRQ    0x0002 /* Completion interrupts are delivered through `vd_irq'. */
+#define VIRTIO_DEVICE_FEVENT  0x0004 /* `VIRTIO_F_RING_EVENT_IDX' has been negotiated. */
+
+struct virtio_device {
+    struct pci_device         *vd_pci;      /* [1..1][const] The associated PCI device. */
+    u16                        vd_flags;    /* Set of `VIRTIO_DEVICE_F*' */
+    u16                        vd_iobase;   /* [valid_if(!VIRTIO_DEVICE_FMODERN)][const] Legacy I/O base port. */
+    u8                         vd_irq;      /* [const] PIC line number (0xff if none). */
+    u8                       __vd_pad[3];
+    u32                        vd_notify_mul; /* [valid_if(VIRTIO_DEVICE_FMODERN)][const] Notify offset multiplier. */
+    u64                        vd_features; /* [const] Negotiated features. */
+    /* Modern transport register mappings. */
+    struct virtio_pci_common_cfg volatile *vd_common; /* [valid_if(VIRTIO_DEVICE_FMODERN)] Common configuration. */
+    VIRT byte_t volatile      *vd_notify;   /* [valid_if(VIRTIO_DEVICE_FMODERN)] Notification area. */
+    VIRT u8 volatile          *vd_isr;      /* [valid_if(VIRTIO_DEVICE_FMODERN)] ISR status. */
+    VIRT byte_t volatile      *vd_config;   /* [valid_if(VIRTIO_DEVICE_FMODERN)] Device configuration. */
+};
+
+/* Allocate physically contiguous, in-core memory suitable for DMA.
+ * The memory is mapped into kernel-space and zero-initialized.
+ * @throw: E_BADALLOC: Not enough available memory. */
+INTDEF VIRT void *KCALL virtio_dma_alloc(size_t num_bytes, PHYS vm_phys_t *__restrict pphys);
+
+/* Initialize `self' for the given PCI device, reset the device, and
+ * acknowledge it (`VIRTIO_STATUS_FACKNOWLEDGE|VIRTIO_STATUS_FDRIVER').
+ * The modern interface is preferred when the device offers it.
+ * @return: false: The device doesn't expose a usable transport. */
+INTDEF bool KCALL virtio_open(struct virtio_device *__restrict self,
+                              struct pci_device *__restrict dev);
+
+/* Negotiate features by accepting those in `features' that are offered by
+ * the device (the transport-specific feature bits are handled automatically)
+ * @throw: E_IOERROR: The device didn't accept the selected features. */
+INTDEF void KCALL virtio_negotiate(struct virtio_device *__restrict self, u64 features);
+
+/* Set the `VIRTIO_STATUS_FDRIVER_OK' / `VIRTIO_STATUS_FFAILED' status bit. */
+INTDEF void KCALL virtio_ready(struct virtio_device *__restrict self);
+INTDEF void KCALL virtio_fail(struct virtio_device *__restrict self);
+
+/* Read the interrupt status register, acknowledging an interrupt.
+ * @return: * : Set of `VIRTIO_ISR_F*' */
+INTDEF u8 KCALL virtio_ackirq(struct virtio_device *__restrict self);
+
+/* Read fields from the device-specific configuration space. */
+INTDEF u8  KCALL virtio_readcfg8(struct virtio_device *__restrict self, u16 offset);
+INTDEF u16 KCALL virtio_readcfg16(struct virtio_device *__restrict self, u16 offset);
+INTDEF u32 KCALL virtio_readcfg32(struct virtio_device *__restrict self, u16 offset);
+INTDEF u64 KCALL virtio_readcfg64(struct virtio_device *__restrict self, u16 offset);
+
+/* Return the max size of the virtqueue `index', or ZERO(0) if it doesn't exist. */
+INTDEF u16 KCALL virtio_queue_size(struct virtio_device *__restrict self, u16 index);
+
+/* Allocate the rings for, and enable the virtqueue `index' with `size' descriptors.
+ * An additional `extra_bytes' of DMA memory are allocated trailing the ring
+ * (s.a. `VIRTQUEUE_XMEM()'), which the caller may use to store request data.
+ * NOTE: With the legacy transport, `size' must match `virtio_queue_size()'
+ * @throw: E_BADALLOC: Not enough available memory. */
+INTDEF void KCALL virtqueue_init(struct virtqueue *__restrict self,
+                                 struct virtio_device *__restrict dev,
+                                 u16 index, u16 size, size_t extra_bytes);
+
+/* Append the descriptor chain starting at `head' to the available ring.
+ * The new entry isn't visible to the device before `virtqueue_kick()' is called. */
+LOCAL void KCALL
+virtqueue_push(struct virtqueue *__restrict self, u16 head) {
+ self->vq_avail->a_ring[self->vq_avail_idx & (self->vq_size-1)] = head;
+ ++self->vq_avail_idx;
+}
+
+/* Publish all chains pushed since the last call and notify the device
+ * (unless it indicated that it doesn't need to be), using a single
+ * notification for all of them. When `VIRTIO_DEVICE_FEVENT' has been
+ * negotiated, the device is also told to only interrupt once all of
+ * the published chains have been used. */
+INTDEF void KCALL virtqueue_kick(struct virtqueue *__restrict self,
+                                 struct virtio_device *__restrict dev);
+
+/* Wait for the device to use all chains published by `virtqueue_kick()',
+ * either by waiting for interrupts, or by polling the used ring.
+ * @return: true:  All chains were used. (`vq_used_idx' has been updated)
+ * @return: false: The given timeout has expired. */
+INTDEF bool KCALL virtqueue_wait(struct virtqueue *__restrict self,
+                                 struct virtio_device *__restrict dev,
+                                 jtime_t timeout);
+#endif /* __CC__ */
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_MODULES_VIRTIO_BLK_VIRTIO_H */
@@ -249,16 +249,20 @@ Fat_WriteToCluster(struct superblock *__restrict self,
    COMPILER_WRITE_BARRIER();
    cluster = Fat_GetFatIndirection(self,cluster,flags);
    if (cluster >= fat->f_cluster_eof_marker) {
-    FatClusterIndex COMPILER_IGNORE_UNINITIALIZED(next_index);
-    /* Allocate another cluster. */
-    mutex_getf(&fat->f_fat_lock,flags);
+    FatClusterIndex EXCEPT_VAR next_index;
+    /* Allocate another cluster (preferably the one following the previous one). */
+    next_index = Fat_AllocCluster(self,cluster+1,flags);
     TRY {
-     /* Allocate a new, free cluster. */
-     next_index = Fat_FindFreeCluster(self,flags);
-     Fat_SetFatIndirection(self,next_index,fat->f_cluster_eof_marker,flags); /* next -> void */
-     Fat_SetFatIndirection(self,cluster,next_index,flags);                   /* prev -> next */
-    } FINALLY {
-     mutex_put(&fat->f_fat_lock);
+     mutex_getf(&fat->f_fat_lock,flags);
+     TRY {
+      Fat_SetFatIndirection(self,next_index,fat->f_cluster_eof_marker,flags); /* next -> void */
+      Fat_SetFatIndirection(self,cluster,next_index,flags);                   /* prev -> next */
+     } FINALLY {
+      mutex_put(&fat->f_fat_lock);
+     }
+    } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
+     Fat_FreeCluster(self,next_index);
+     error_rethrow();
     }
     cluster = next_index;
    }
@@ -467,116 +471,166 @@ Fat_GetAbsDiskPos(struct inode *__restrict self, pos_t pos, iomode_t flags) {
 
 
 
+/* Return the on-disk cluster of the `nth_cluster' file cluster of `self'.
+ * The caller must ensure that `nth_cluster < self->i_clusterc' */
+PRIVATE FatClusterIndex KCALL
+FatNode_LookupCluster(FatNode *__restrict self, size_t nth_cluster) {
+ size_t lo = 0,hi = self->i_extc;
+ assert(nth_cluster < self->i_clusterc);
+ /* Sequential I/O usually hits the last extent, so check that one first. */
+ if likely(nth_cluster >= self->i_extv[hi-1].fe_index)
+    return self->i_extv[hi-1].fe_cluster+(FatClusterIndex)(nth_cluster-self->i_extv[hi-1].fe_index);
+ while (lo < hi) {
+  size_t mid = (lo+hi)/2;
+  FatExtent *ext = &self->i_extv[mid];
+  if (nth_cluster < ext->fe_index)
+   hi = mid;
+  else if (nth_cluster >= ext->fe_index+ext->fe_length)
+   lo = mid+1;
+  else {
+   return ext->fe_cluster+(FatClusterIndex)(nth_cluster-ext->fe_index);
+  }
+ }
+ assertf(0,"Cluster %Iu not mapped by any extent",nth_cluster);
+ __builtin_unreachable();
+}
+
+/* Return the last loaded on-disk cluster of `self' (`self->i_extc' must be non-zero) */
+LOCAL FatClusterIndex KCALL
+FatNode_LastCluster(FatNode *__restrict self) {
+ FatExtent *ext = &self->i_extv[self->i_extc-1];
+ assert(self->i_extc != 0);
+ return ext->fe_cluster+ext->fe_length-1;
+}
+
+/* Make sure that there is room for at least one more extent,
+ * so that a following call to `FatNode_AppendCluster()' can't fail. */
+PRIVATE void KCALL
+FatNode_ReserveExtent(FatNode *__restrict self) {
+ size_t new_alloc;
+ if (self->i_extc < self->i_exta) return;
+ new_alloc = self->i_exta ? self->i_exta*2 : 2;
+ TRY {
+  self->i_extv = (FatExtent *)krealloc(self->i_extv,new_alloc*
+                                       sizeof(FatExtent),
+                                       GFP_SHARED|GFP_NOFS);
+ } CATCH_HANDLED (E_BADALLOC) {
+  /* Try to allocate the minimum increment. */
+  new_alloc = self->i_extc+1;
+  self->i_extv = (FatExtent *)krealloc(self->i_extv,new_alloc*
+                                       sizeof(FatExtent),
+                                       GFP_SHARED|GFP_NOFS);
+ }
+ self->i_exta = new_alloc;
+}
+
+/* Append `cluster' as the next file cluster of `self', either by
+ * growing the last extent, or by starting a new one.
+ * The caller must have called `FatNode_ReserveExtent()' beforehand. */
+PRIVATE ATTR_NOTHROW void KCALL
+FatNode_AppendCluster(FatNode *__restrict self,
+                      FatClusterIndex cluster) {
+ FatExtent *ext;
+ if (self->i_extc) {
+  ext = &self->i_extv[self->i_extc-1];
+  if (ext->fe_cluster+ext->fe_length == cluster) {
+   ++ext->fe_length;
+   ++self->i_clusterc;
+   return;
+  }
+ }
+ assert(self->i_extc < self->i_exta);
+ ext = &self->i_extv[self->i_extc++];
+ ext->fe_index   = (FatClusterIndex)self->i_clusterc;
+ ext->fe_cluster = cluster;
+ ext->fe_length  = 1;
+ ++self->i_clusterc;
+}
+
 INTERN FatClusterIndex KCALL
 Fat_GetFileCluster(struct inode *__restrict node,
                    size_t nth_cluster,
                    unsigned int mode, iomode_t flags) {
  struct inode *EXCEPT_VAR xnode = node;
- FatClusterIndex COMPILER_IGNORE_UNINITIALIZED(result);
- FatNode *EXCEPT_VAR data = node->i_fsdata;
- Fat *EXCEPT_VAR fat = node->i_super->s_fsdata;
- bool EXCEPT_VAR has_write_lock = false;
+ FatClusterIndex result;
+ FatNode *data = node->i_fsdata;
+ Fat *fat = node->i_super->s_fsdata;
  assert(rwlock_reading(&node->i_lock));
- if unlikely(!data->i_clusterc) {
+ if unlikely(!(data->i_clflags & FAT_NODE_FLOADED)) {
   /* Load the initial file cluster. */
   inode_loadattr(node);
-  assert(data->i_clusterc != 0);
+  assert(data->i_clflags & FAT_NODE_FLOADED);
  }
- if (nth_cluster < data->i_clusterc) {
-  result = data->i_clusterv[nth_cluster];
-  if unlikely(result >= fat->f_cluster_eof) {
-   /* Deal with EOF clusters (check if we're supposed to create new ones) */
-   result = fat->f_cluster_eof_marker;
-   goto create_cluster;
-  }
-  return result;
- }
- result = fat->f_cluster_eof_marker;
+ if (nth_cluster < data->i_clusterc)
+     return FatNode_LookupCluster(data,nth_cluster);
+ if ((data->i_clflags & FAT_NODE_FCOMPLETE) &&
+    !(mode & FAT_GETCLUSTER_MODE_FCREATE))
+     return fat->f_cluster_eof_marker;
+ rwlock_writef(&node->i_lock,flags);
  TRY {
-  for (;;) {
-   FatClusterIndex next_index;
-   assertf(nth_cluster >= data->i_clusterc,
-           "nth_cluster      = %Iu\n"
-           "data->i_clusterc = %Iu\n",
-           nth_cluster,data->i_clusterc);
-   if (data->i_clusterv[data->i_clusterc-1] >= fat->f_cluster_eof) {
-create_cluster:
-    /* Last cluster points into the void.
-     * Check if we're supposed to create more. */
-    if (!(mode & FAT_GETCLUSTER_MODE_FCREATE)) break;
-    if (!has_write_lock) {
-     rwlock_writef(&node->i_lock,flags);
-     has_write_lock = true;
+  while (nth_cluster >= data->i_clusterc) {
+   FatClusterIndex EXCEPT_VAR next_index;
+   if (data->i_clflags & FAT_NODE_FCOMPLETE) {
+    /* The chain ends here. Check if we're supposed to create more clusters. */
+    if (!(mode & FAT_GETCLUSTER_MODE_FCREATE)) {
+     result = fat->f_cluster_eof_marker;
+     goto done;
+    }
+    FatNode_ReserveExtent(data);
+    /* Allocate a new, free cluster, preferably one that
+     * is adjacent to the file's previous last cluster. */
+    next_index = Fat_AllocCluster(node->i_super,
+                                  data->i_extc ? FatNode_LastCluster(data)+1
+                                               : FAT_CLUSTER_UNUSED,
+                                  flags);
+    if (mode & FAT_GETCLUSTER_MODE_FNOZERO) {
+     /* XXX: ZERO-initialize the new memory? */
     }
-    mutex_getf(&fat->f_fat_lock,flags);
     TRY {
-     /* Allocate a new, free cluster. */
-     next_index = Fat_FindFreeCluster(node->i_super,flags);
-     if (mode & FAT_GETCLUSTER_MODE_FNOZERO) {
-      /* XXX: ZERO-initialize the new memory? */
-     }
-     /* Mark the cluster as an EOF cluster. */
-     Fat_SetFatIndirection(node->i_super,next_index,
-                           fat->f_cluster_eof_marker,flags);
-     data->i_clusterv[data->i_clusterc-1] = next_index;
-     if (data->i_clusterc == 1) {
-      /* The pointer to the first cluster is stored in the INode.
-       * Since we've just written that pointer, mark the node as changed. */
-      inode_changed(node);
-     } else {
-      /* Link the previous cluster onto the new one */
-      Fat_SetFatIndirection(node->i_super,
-                            data->i_clusterv[data->i_clusterc-2],
-                            next_index,flags);
+     mutex_getf(&fat->f_fat_lock,flags);
+     TRY {
+      /* Mark the cluster as an EOF cluster. */
+      Fat_SetFatIndirection(node->i_super,next_index,
+                            fat->f_cluster_eof_marker,flags);
+      if (!data->i_extc) {
+       /* The pointer to the first cluster is stored in the INode.
+        * Since we've just written that pointer, mark the node as changed. */
+       data->i_first = next_index;
+       inode_changed(node);
+      } else {
+       /* Link the previous cluster onto the new one */
+       Fat_SetFatIndirection(node->i_super,
+                             FatNode_LastCluster(data),
+                             next_index,flags);
+      }
+     } FINALLY {
+      mutex_put(&fat->f_fat_lock);
      }
-    } FINALLY {
-     mutex_put(&fat->f_fat_lock);
+    } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
+     Fat_FreeCluster(xnode->i_super,next_index);
+     error_rethrow();
     }
-    if (nth_cluster == data->i_clusterc-1) {
-     result = next_index;
-     break;
-    }
-    assert(data->i_clusterv[data->i_clusterc-1] < fat->f_cluster_eof);
-   }
-   /* Dereference the FAT table at the previous index. */
-   next_index = data->i_clusterv[data->i_clusterc-1];
-   next_index = Fat_GetFatIndirection(node->i_super,next_index,flags);
-   assert(data->i_clusterc <= data->i_clustera);
-   if (!has_write_lock) {
-    rwlock_writef(&node->i_lock,flags);
-    has_write_lock = true;
-   }
-   if (data->i_clusterc == data->i_clustera) {
-    /* Allocate what should be a sufficient number of clusters. */
-    size_t new_alloc = CEILDIV(node->i_attr.a_size,
-                               fat->f_clustersize)+1;
-    if unlikely(new_alloc < data->i_clustera)
-                new_alloc = data->i_clustera*2;
-    if unlikely(!new_alloc) new_alloc = 2;
-    TRY {
-     data->i_clusterv = (FatClusterIndex *)krealloc(data->i_clusterv,new_alloc*
-                                                    sizeof(FatClusterIndex),
-                                                    GFP_SHARED);
-    } CATCH_HANDLED (E_BADALLOC) {
-     /* Try to allocate the minimum increment. */
-     new_alloc = data->i_clusterc+1;
-     data->i_clusterv = (FatClusterIndex *)krealloc(data->i_clusterv,new_alloc*
-                                                    sizeof(FatClusterIndex),
-                                                    GFP_SHARED);
+   } else {
+    /* Dereference the FAT table at the previous index. */
+    next_index = data->i_extc ? Fat_GetFatIndirection(node->i_super,
+                                                      FatNode_LastCluster(data),
+                                                      flags)
+                              : data->i_first;
+    if (next_index >= fat->f_cluster_eof ||
+        next_index == FAT_CLUSTER_UNUSED) {
+     /* All clusters have been loaded. */
+     data->i_clflags |= FAT_NODE_FCOMPLETE;
+     continue;
     }
-    data->i_clustera = new_alloc;
+    FatNode_ReserveExtent(data);
    }
-   assert(data->i_clusterc < data->i_clustera);
    /* Add the new cluster information to the node. */
-   data->i_clusterv[data->i_clusterc++] = next_index;
-   if (nth_cluster == data->i_clusterc-1) {
-    result = next_index;
-    break;
-   }
+   FatNode_AppendCluster(data,next_index);
   }
+  result = FatNode_LookupCluster(data,nth_cluster);
+done:;
  } FINALLY {
-  if (has_write_lock)
-      rwlock_endwrite(&xnode->i_lock);
+  rwlock_endwrite(&xnode->i_lock);
  }
  return result;
 }
@@ -1053,7 +1107,7 @@ PRIVATE ATTR_NOTHROW void KCALL
 Fat_FinalizeNode(struct inode *__restrict self) {
  if (self->i_fsdata) {
   kfree(self->i_fsdata->i_directory.i_freev);
-  kfree(self->i_fsdata->i_clusterv);
+  kfree(self->i_fsdata->i_extv);
   kfree(self->i_fsdata);
  }
 }
@@ -1159,17 +1213,18 @@ Fat_LoadINodeFromFatFile(struct inode *__restrict self,
                          FatFile const *__restrict file) {
  FatNode *data = self->i_fsdata;
  /* file --> self */
- assert((data->i_clusterv != NULL) ==
-        (data->i_clustera != 0));
- if (!data->i_clustera) {
-  data->i_clusterv = (FatClusterIndex *)kmalloc(2*sizeof(FatClusterIndex),
-                                                GFP_SHARED|GFP_NOFS);
-  data->i_clustera = 2;
+ /* Setup the initial cluster (extents are loaded lazily). */
+ data->i_first    = (BSWAP_LE2H16(file->f_clusterlo) |
+                    (BSWAP_LE2H16(file->f_clusterhi) << 16));
+ data->i_clusterc = 0;
+ data->i_extc     = 0;
+ data->i_clflags  = FAT_NODE_FLOADED;
+ if (data->i_first == FAT_CLUSTER_UNUSED ||
+     data->i_first >= self->i_super->s_fsdata->f_cluster_eof) {
+  /* Empty file. */
+  data->i_first    = self->i_super->s_fsdata->f_cluster_eof_marker;
+  data->i_clflags |= FAT_NODE_FCOMPLETE;
  }
- /* Setup the initial cluster. */
- data->i_clusterc    = 1;
- data->i_clusterv[0] = (BSWAP_LE2H16(file->f_clusterlo) |
-                       (BSWAP_LE2H16(file->f_clusterhi) << 16));
  memcpy(&data->i_file,&file->f_attr,sizeof(data->i_file));
  self->i_attr.a_size  = BSWAP_LE2H32(file->f_size);
  assert(!(self->i_super->s_fsdata->f_mode & ~0777));
@@ -1198,13 +1253,10 @@ Fat_SaveINodeToFatFile(struct inode const *__restrict self,
  FatNode *data = self->i_fsdata;
  u32 cluster;
  /* self --> file */
- assert((data->i_clusterv != NULL) ==
-        (data->i_clustera != 0));
- if (!data->i_clusterc) {
-  cluster = self->i_super->s_fsdata->f_cluster_eof_marker;
- } else {
-  cluster = data->i_clusterv[0];
- }
+ cluster = data->i_first;
+ if (!(data->i_clflags & FAT_NODE_FLOADED) ||
+       cluster >= self->i_super->s_fsdata->f_cluster_eof)
+       cluster = FAT_CLUSTER_UNUSED; /* Empty file. */
  /* Copy basic file data. */
  memcpy(&file->f_attr,&data->i_file,sizeof(data->i_file));
  file->f_clusterlo = BSWAP_H2LE16(cluster & 0xffff);
@@ -1312,9 +1364,20 @@ Fat_TruncateINode(struct inode *__restrict self,
  }
  /* Now delete the chain of clusters that just got truncated. */
  Fat_DeleteClusterChain(self->i_super,delete_start,IO_RDWR);
- /* Mark the (now) latest cluster as an EOF cluster. */
- node->i_clusterv[new_cluster_count] = fat->f_cluster_eof_marker;
- node->i_clusterc = new_cluster_count + 1;
+ /* Drop all extents past the new end of the file. */
+ while (node->i_extc &&
+        node->i_extv[node->i_extc-1].fe_index >= new_cluster_count)
+        --node->i_extc;
+ if (node->i_extc) {
+  FatExtent *ext = &node->i_extv[node->i_extc-1];
+  if (ext->fe_index+ext->fe_length > new_cluster_count)
+      ext->fe_length = (FatClusterIndex)(new_cluster_count-ext->fe_index);
+ } else {
+  /* The file no longer has any clusters. */
+  node->i_first = fat->f_cluster_eof_marker;
+ }
+ node->i_clusterc = new_cluster_count;
+ node->i_clflags |= FAT_NODE_FCOMPLETE;
 }
 
 
@@ -1515,21 +1578,12 @@ Fat_AddFileToDirectory(struct directory_node *__restrict target_directory,
 
 PRIVATE ATTR_RETNONNULL FatNode *KCALL
 Fat_AllocateEmptyNode(Fat *__restrict fat) {
- FatNode *EXCEPT_VAR result;
+ FatNode *result;
  result = (FatNode *)kmalloc(sizeof(FatNode),
                              GFP_SHARED|GFP_CALLOC|GFP_NOFS);
- result->i_clusterc = 1;
- result->i_clustera = 2;
- TRY {
-  result->i_clusterv = (FatClusterIndex *)kmalloc(2*sizeof(FatClusterIndex),
-                                                  GFP_SHARED|GFP_CALLOC|GFP_NOFS);
-  result->i_clusterv[0] = fat->f_cluster_eof_marker;
-  return result;
- } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-  kfree(result);
-  error_rethrow();
- }
- __builtin_unreachable();
+ result->i_first   = fat->f_cluster_eof_marker;
+ result->i_clflags = FAT_NODE_FLOADED|FAT_NODE_FCOMPLETE;
+ return result;
 }
 
 
@@ -1583,7 +1637,16 @@ Fat_CreateDirectory(struct directory_node *__restrict target_directory,
  /* Allocate the initial data block for the directory. */
  memcpy(dirinit,directory_pattern,sizeof(directory_pattern));
  /* Set the parent directory cluster number. */
- clusno = target_directory->d_node.i_fsdata->i_clusterv[0];
+ if (target_directory->d_node.i_super->s_root == target_directory &&
+     target_directory->d_node.i_super->s_fsdata->f_type != FAT32) {
+  clusno = FAT_CLUSTER_FAT16_ROOT;
+ } else {
+  clusno = Fat_GetFileCluster(&target_directory->d_node,0,
+                              FAT_GETCLUSTER_MODE_FNORMAL,
+                              IO_RDONLY);
+  if (clusno >= target_directory->d_node.i_super->s_fsdata->f_cluster_eof)
+      clusno = FAT_CLUSTER_UNUSED;
+ }
  dirinit[1].f_clusterlo = BSWAP_H2LE16((u16)clusno);
  dirinit[1].f_clusterhi = BSWAP_H2LE16((u16)(clusno >> 16));
  assert(new_node->d_node.i_flags & INODE_FATTRLOADED);
@@ -1909,44 +1972,133 @@ Fat_SetFatIndirection(struct superblock *__restrict self,
 }
 
 
+#define FAT_FREE_GT(map,i) ((map)[(i)/8] & (1 << ((i)%8)))
+#define FAT_FREE_ST(map,i) ((map)[(i)/8] |= (1 << ((i)%8)))
+#define FAT_FREE_CL(map,i) ((map)[(i)/8] &= ~(1 << ((i)%8)))
+
+/* Load the free-cluster bitmap by scanning the entire FAT.
+ * This only has to be done once per mount, after which clusters
+ * can be allocated without having to touch the FAT at all. */
+PRIVATE void KCALL
+Fat_LoadFreeMap(struct superblock *__restrict self, iomode_t flags) {
+ Fat *EXCEPT_VAR fat = self->s_fsdata;
+ byte_t *EXCEPT_VAR map;
+ map = (byte_t *)kmalloc(CEILDIV(fat->f_cluster_eof,8),
+                         GFP_SHARED|GFP_CALLOC|GFP_NOFS);
+ TRY {
+  /* Hold the FAT lock, so that no clusters can be freed while we're scanning. */
+  mutex_getf(&fat->f_fat_lock,flags);
+  TRY {
+   if (!fat->f_free_map) {
+    FatClusterIndex i,count = 0;
+    for (i = FAT_CLUSTER_FIRST; i < fat->f_cluster_eof; ++i) {
+     if (Fat_GetFatIndirection(self,i,flags) != FAT_CLUSTER_UNUSED)
+         continue;
+     FAT_FREE_ST(map,i);
+     ++count;
+    }
+    if (fat->f_free_count != FAT32_FSINFO_UNKNOWN &&
+        fat->f_free_count != count) {
+     debug_printf("[FAT] FSInfo free cluster count mismatch (%I32u != %I32u)\n",
+                  fat->f_free_count,count);
+    }
+    atomic_rwlock_write(&fat->f_free_lock);
+    fat->f_free_count = count;
+    fat->f_free_map   = map;
+    atomic_rwlock_endwrite(&fat->f_free_lock);
+    map = NULL;
+   }
+  } FINALLY {
+   mutex_put(&fat->f_fat_lock);
+  }
+ } FINALLY {
+  kfree(map);
+ }
+}
+
+/* Return the first free cluster in `[start,end)', or `end' if there is none. */
+PRIVATE ATTR_NOTHROW FatClusterIndex KCALL
+Fat_ScanFreeMap(byte_t const *__restrict map,
+                FatClusterIndex start,
+                FatClusterIndex end) {
+ for (; start < end; ++start) {
+  if (!(start & 7) && !map[start/8]) {
+   start += 7; /* Skip fully allocated bytes. */
+   continue;
+  }
+  if (FAT_FREE_GT(map,start))
+      return start;
+ }
+ return end;
+}
+
 INTERN FatClusterIndex KCALL
-Fat_FindFreeCluster(struct superblock *__restrict self,
-                    iomode_t flags) {
+Fat_AllocCluster(struct superblock *__restrict self,
+                 FatClusterIndex hint, iomode_t flags) {
  FatClusterIndex result;
  Fat *fat = self->s_fsdata;
- assert(mutex_holding(&fat->f_fat_lock));
- result = fat->f_free_pos;
- for (; result < fat->f_cluster_eof; ++result) {
-  if (Fat_GetFatIndirection(self,result,flags) == FAT_CLUSTER_UNUSED)
-      goto found_one;
+ if unlikely(!ATOMIC_READ(fat->f_free_map))
+    Fat_LoadFreeMap(self,flags);
+ atomic_rwlock_write(&fat->f_free_lock);
+ if unlikely(!fat->f_free_count) {
+  atomic_rwlock_endwrite(&fat->f_free_lock);
+  /* Disk is full... */
+  throw_fs_error(ERROR_FS_DISK_FULL);
  }
- /* Scan everything before our previous location. */
- result = 0;
- for (; result < fat->f_free_pos; ++result) {
-  if (Fat_GetFatIndirection(self,result,flags) == FAT_CLUSTER_UNUSED)
-      goto found_one;
+ /* Prefer the hinted cluster, so that files are allocated as contiguous extents. */
+ if (hint >= FAT_CLUSTER_FIRST && hint < fat->f_cluster_eof &&
+     FAT_FREE_GT(fat->f_free_map,hint)) {
+  result = hint;
+ } else {
+  if (fat->f_free_pos < FAT_CLUSTER_FIRST ||
+      fat->f_free_pos >= fat->f_cluster_eof)
+      fat->f_free_pos = FAT_CLUSTER_FIRST;
+  result = Fat_ScanFreeMap(fat->f_free_map,fat->f_free_pos,fat->f_cluster_eof);
+  /* Scan everything before our previous location. */
+  if (result >= fat->f_cluster_eof)
+      result = Fat_ScanFreeMap(fat->f_free_map,FAT_CLUSTER_FIRST,fat->f_free_pos);
+  assertf(result < fat->f_cluster_eof && FAT_FREE_GT(fat->f_free_map,result),
+          "f_free_count = %I32u, but no free cluster was found",
+          fat->f_free_count);
  }
- /* Disk is full... */
- throw_fs_error(ERROR_FS_DISK_FULL);
-
-found_one:
- fat->f_free_pos = result;
+ FAT_FREE_CL(fat->f_free_map,result);
+ --fat->f_free_count;
+ fat->f_free_pos = result+1;
+ atomic_rwlock_endwrite(&fat->f_free_lock);
  return result;
 }
 
+INTERN ATTR_NOTHROW void KCALL
+Fat_FreeCluster(struct superblock *__restrict self,
+                FatClusterIndex cluster) {
+ Fat *fat = self->s_fsdata;
+ if (cluster < FAT_CLUSTER_FIRST ||
+     cluster >= fat->f_cluster_eof)
+     return;
+ atomic_rwlock_write(&fat->f_free_lock);
+ if (fat->f_free_map &&
+    !FAT_FREE_GT(fat->f_free_map,cluster)) {
+  FAT_FREE_ST(fat->f_free_map,cluster);
+  ++fat->f_free_count;
+ }
+ atomic_rwlock_endwrite(&fat->f_free_lock);
+}
+
 INTERN void KCALL
 Fat_DeleteClusterChain(struct superblock *__restrict self,
                        FatClusterIndex first_delete_index,
                        iomode_t flags) {
  Fat *EXCEPT_VAR fat = self->s_fsdata;
- mutex_get(&fat->f_fat_lock);
+ mutex_getf(&fat->f_fat_lock,flags);
  TRY {
-  while (first_delete_index < fat->f_cluster_eof) {
+  while (first_delete_index < fat->f_cluster_eof &&
+         first_delete_index >= FAT_CLUSTER_FIRST) {
    FatClusterIndex next;
    /* Read the next link. */
    next = Fat_GetFatIndirection(self,first_delete_index,flags);
    /* Mark the link as being unused now. */
    Fat_SetFatIndirection(self,first_delete_index,FAT_CLUSTER_UNUSED,flags);
+   Fat_FreeCluster(self,first_delete_index);
    /* Continue deleting all entries from the chain. */
    first_delete_index = next;
   }
@@ -1981,6 +2133,43 @@ Fat_WriteFatIndirectionTableSegment(struct superblock *__restrict self,
                      IO_WRONLY);
  }
 }
+PRIVATE void KCALL
+Fat_WriteFSInfo(struct superblock *__restrict self) {
+ Fat *fat = self->s_fsdata; le32 info[2];
+ atomic_rwlock_read(&fat->f_free_lock);
+ info[0] = BSWAP_H2LE32(fat->f_free_count);
+ info[1] = BSWAP_H2LE32(fat->f_free_pos);
+ atomic_rwlock_endread(&fat->f_free_lock);
+ block_device_write(self->s_device,info,sizeof(info),
+                    FAT_SECTORADDR(fat,fat->f_fsinfo)+
+                    offsetof(Fat32FSInfo,fi_free_clusters),
+                    IO_WRONLY);
+}
+
+/* Seed the free-cluster count and search position from the FSInfo sector. */
+PRIVATE void KCALL
+Fat_ReadFSInfo(struct superblock *__restrict self) {
+ Fat *fat = self->s_fsdata; Fat32FSInfo info;
+ if (block_device_read(self->s_device,&info,sizeof(info),
+                       FAT_SECTORADDR(fat,fat->f_fsinfo),
+                       IO_RDONLY) != sizeof(info) ||
+     BSWAP_LE2H32(info.fi_signature1) != FAT32_FSINFO_SIGNATURE1 ||
+     BSWAP_LE2H32(info.fi_signature2) != FAT32_FSINFO_SIGNATURE2 ||
+     BSWAP_LE2H32(info.fi_signature3) != FAT32_FSINFO_SIGNATURE3) {
+  /* Missing/Invalid FSInfo sector. */
+  fat->f_fsinfo = 0;
+  return;
+ }
+ fat->f_free_count = BSWAP_LE2H32(info.fi_free_clusters);
+ if (fat->f_free_count != FAT32_FSINFO_UNKNOWN &&
+     fat->f_free_count >= fat->f_cluster_eof)
+     fat->f_free_count = FAT32_FSINFO_UNKNOWN;
+ fat->f_free_pos = BSWAP_LE2H32(info.fi_next_free);
+ if (fat->f_free_pos < FAT_CLUSTER_FIRST ||
+     fat->f_free_pos >= fat->f_cluster_eof)
+     fat->f_free_pos = FAT_CLUSTER_FIRST;
+}
+
 INTERN void KCALL
 Fat_WriteFatIndirectionTable(struct superblock *__restrict self) {
  FatSectorIndex changed_begin,changed_end;
@@ -2014,6 +2203,9 @@ Fat_WriteFatIndirectionTable(struct superblock *__restrict self) {
      ++changed_begin;
     }
    }
+   /* Update the free cluster information in the FSInfo sector. */
+   if (fat->f_fsinfo && ATOMIC_READ(fat->f_free_map))
+       Fat_WriteFSInfo(self);
    fat->f_flags &= ~FAT_FCHANGED;
   }
  } FINALLY {
@@ -2114,11 +2306,11 @@ Fat_OpenSuperblock(struct superblock *__restrict self,
     fat->f_sec4fat            = BSWAP_LE2H32(disk_header.fat32.f32_sectors_per_fat);
     fat->f_cluster_eof        = (fat->f_sec4fat*fat->f_sectorsize)/4;
     fat->f_cluster_eof_marker = 0xffffffff;
+    fat->f_fsinfo             = BSWAP_LE2H16(disk_header.fat32.f32_fsinfo_cluster);
+    if (fat->f_fsinfo == 0xffff) fat->f_fsinfo = 0;
     /* Must lookup the cluster of the root directory. */
-    root_node->i_clusterc     = 1;
-    root_node->i_clustera     = 2;
-    root_node->i_clusterv     = (FatClusterIndex *)kmalloc(2*sizeof(FatClusterIndex),GFP_SHARED);
-    root_node->i_clusterv[0]  = BSWAP_LE2H32(disk_header.fat32.f32_root_cluster);
+    root_node->i_first        = BSWAP_LE2H32(disk_header.fat32.f32_root_cluster);
+    root_node->i_clflags      = FAT_NODE_FLOADED;
     fat->f_fat_get            = &Fat32_GetFatIndirection;
     fat->f_fat_set            = &Fat32_SetFatIndirection;
     fat->f_fat_sector         = &Fat32_GetTableSector;
@@ -2140,6 +2332,7 @@ Fat_OpenSuperblock(struct superblock *__restrict self,
     fat->f_volid = BSWAP_LE2H32(disk_header.fat16.f16_volid);
     memcpy(fat->f_label,disk_header.fat16.f16_label,sizeof(disk_header.fat16.f16_label));
     memcpy(fat->f_sysname,disk_header.fat16.f16_sysname,sizeof(disk_header.fat16.f16_sysname));
+    fat->f_fsinfo = 0;
     root_node->i16_root.f16_rootpos  = BSWAP_LE2H16(disk_header.bpb.bpb_reserved_sectors);
     root_node->i16_root.f16_rootpos += (disk_header.bpb.bpb_fatc*
                                         BSWAP_LE2H16(disk_header.bpb.bpb_sectors_per_fat));
@@ -2158,8 +2351,6 @@ Fat_OpenSuperblock(struct superblock *__restrict self,
    self->s_root->d_node.i_fsdata = root_node;
    self->s_fsdata                = fat;
   } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-   if (fat->f_type == FAT32)
-       kfree(root_node->i_clusterv);
    kfree(root_node);
    error_rethrow();
   }
@@ -2200,11 +2391,16 @@ Fat_OpenSuperblock(struct superblock *__restrict self,
  self->s_root->d_node.i_attr.a_ino = 0;
 
  /* Allocate the metadata tables. */
- fat->f_free_pos  = 0;
- fat->f_fat_table = kmalloc(fat->f_fat_size,GFP_SHARED);
- fat->f_fat_meta  = (byte_t *)kmalloc(CEILDIV(fat->f_sec4fat,8/FAT_METABITS),
-                                      GFP_SHARED|GFP_CALLOC);
+ fat->f_free_pos   = FAT_CLUSTER_FIRST;
+ fat->f_free_count = FAT32_FSINFO_UNKNOWN;
+ fat->f_free_map   = NULL;
+ fat->f_fat_table  = kmalloc(fat->f_fat_size,GFP_SHARED);
+ fat->f_fat_meta   = (byte_t *)kmalloc(CEILDIV(fat->f_sec4fat,8/FAT_METABITS),
+                                       GFP_SHARED|GFP_CALLOC);
  mutex_init(&fat->f_fat_lock);
+ atomic_rwlock_init(&fat->f_free_lock);
+ if (fat->f_fsinfo)
+     Fat_ReadFSInfo(self);
 }
 
 PRIVATE void KCALL
@@ -2212,6 +2408,7 @@ Fat_FinalizeSuperblock(struct superblock *__restrict self) {
  if (!self->s_fsdata) return;
  kfree(self->s_fsdata->f_fat_table);
  kfree(self->s_fsdata->f_fat_meta);
+ kfree(self->s_fsdata->f_free_map);
  kfree(self->s_fsdata);
 }
 PRIVATE void KCALL
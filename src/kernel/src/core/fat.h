@@ -24,6 +24,7 @@
 #include <hybrid/host.h>
 #include <hybrid/align.h>
 #include <sched/rwlock.h>
+#include <hybrid/sync/atomic-rwlock.h>
 #include <fs/node.h>
 #include <fs/iomode.h>
 #include <endian.h>
@@ -221,13 +222,36 @@ typedef union PACKED
     Fat32DiskHeader    fat32;
 } FatDiskHeader;
 
+typedef struct PACKED {
+    /* FAT32 File system information sector. */
+#define FAT32_FSINFO_SIGNATURE1 0x41615252
+#define FAT32_FSINFO_SIGNATURE2 0x61417272
+#define FAT32_FSINFO_SIGNATURE3 0xaa550000
+#define FAT32_FSINFO_UNKNOWN    0xffffffff
+    le32               fi_signature1;    /* Lead signature (`FAT32_FSINFO_SIGNATURE1'). */
+    u8                 fi_reserved1[480];/* Reserved. */
+    le32               fi_signature2;    /* Structure signature (`FAT32_FSINFO_SIGNATURE2'). */
+    le32               fi_free_clusters; /* Last known free cluster count (or `FAT32_FSINFO_UNKNOWN'). */
+    le32               fi_next_free;     /* Hint where to start looking for free clusters (or `FAT32_FSINFO_UNKNOWN'). */
+    u8                 fi_reserved2[12]; /* Reserved. */
+    le32               fi_signature3;    /* Trail signature (`FAT32_FSINFO_SIGNATURE3'). */
+} Fat32FSInfo;
+
 typedef u32 FatSectorIndex;  /* Sector number (sector_t). */
 typedef u32 FatClusterIndex; /* Cluster/Fat index number. */
 #define FAT_CLUSTER_UNUSED     0 /* Cluster number found in the FAT table, marking an unused cluster. */
 #define FAT_CLUSTER_FAT16_ROOT 0 /* Cluster ID found in parent-directory entries referring to the ROOT directory. */
+#define FAT_CLUSTER_FIRST      2 /* The first cluster index that can be allocated (0 and 1 are reserved). */
 
 typedef struct inode_data FatNode;
 
+typedef struct {
+    /* A contiguous run of on-disk clusters, mapped into a file. */
+    FatClusterIndex    fe_index;   /* Index of the first file cluster mapped by this extent. */
+    FatClusterIndex    fe_cluster; /* On-disk cluster of the first file cluster. */
+    FatClusterIndex    fe_length;  /* [!0] Amount of consecutive clusters. */
+} FatExtent;
+
 typedef struct {
     /* Tracking descriptor for free FAT directory file ranges. */
     u32   dfr_start; /* Starting FatFile index of the free range (directory position / sizeof(FatFile)). */
@@ -242,23 +266,25 @@ struct inode_data {
             u32                f16_rootsiz;  /* [const] Max size of the root-directory segment (in bytes) */
         }                      i16_root;     /* [valid_if(:f_type != FAT32 && :self == :s_root)] */
         struct PACKED {
-            size_t             i_clusterc;   /* [lock(:i_lock)]
-                                              * [if(:f_type != FAT32 && :self == :s_root,[== 0])]
-                                              * [if(:f_type == FAT32 || :self != :s_root,[!0])]
-                                              *  Amount of loaded cluster indices. */
-            size_t             i_clustera;   /* [lock(:i_lock)]
-                                              * [if(:f_type != FAT32 && :self == :s_root,[== 0])]
-                                              * [if(:f_type == FAT32 || :self != :s_root,[!0])]
-                                              *  Allocated amount of cluster indices. */
-            FatClusterIndex   *i_clusterv;   /* [lock(:i_lock)]
-                                              * [if(:f_type != FAT32 && :self == :s_root,[== NULL])]
-                                              * [if(:f_type == FAT32 || :self != :s_root,[1..i_clusterc|alloc(i_clustera)][owned])]
-                                              *  Vector of file cluster starting indices.
-                                              *  Indices are passed to `FAT_CLUSTERADDR()' to
-                                              *  convert them into absolute on-disk locations.
-                                              *  Each cluster has a length of `:f_clustersize' bytes.
-                                              *  If `i_clusterv[i_clusterc-1] >= :f_cluster_eof', then
-                                              *  all clusters have been loaded. */
+#define FAT_NODE_FNORMAL       0x0000        /* Normal cluster-map flags. */
+#define FAT_NODE_FLOADED       0x0001        /* `i_first' has been loaded from the node's directory entry. */
+#define FAT_NODE_FCOMPLETE     0x0002        /* The entire cluster chain has been loaded into `i_extv'. */
+            u32                i_clflags;    /* [lock(:i_lock)] Set of `FAT_NODE_F*' */
+            FatClusterIndex    i_first;      /* [lock(:i_lock)][valid_if(FAT_NODE_FLOADED)]
+                                              *  The first cluster of the file, or `:f_cluster_eof_marker'
+                                              *  if the file doesn't have any clusters allocated. */
+            size_t             i_clusterc;   /* [lock(:i_lock)][== SUM(i_extv[*].fe_length)]
+                                              *  Amount of loaded file clusters. */
+            size_t             i_extc;       /* [lock(:i_lock)] Amount of loaded cluster extents. */
+            size_t             i_exta;       /* [lock(:i_lock)] Allocated amount of cluster extents. */
+            FatExtent         *i_extv;       /* [lock(:i_lock)][0..i_extc|alloc(i_exta)][owned]
+                                              * [sort(ASCENDING(->fe_index))]
+                                              *  Vector of contiguous on-disk cluster runs, describing
+                                              *  the first `i_clusterc' clusters of the file.
+                                              *  Unless `FAT_NODE_FCOMPLETE' is set, more clusters
+                                              *  can be loaded by following the FAT chain starting
+                                              *  at the last cluster of the last extent (or `i_first'
+                                              *  when no extents have been loaded yet). */
         };
     };
     struct PACKED {
@@ -351,7 +377,17 @@ struct superblock_data {
                                             *  NOTE: This bitset contains one entry of `FAT_METABITS'
                                             *        for each sector within the FAT lookup table.
                                             *  NOTE: `f_fat_changed' must be set to `true' while changed fat entries exist. */
-    FatClusterIndex         f_free_pos;    /* [lock(f_fat_lock)] Next cluster index that should be considered when search for free clusters. */
+    atomic_rwlock_t         f_free_lock;   /* Lock for the free-cluster map. (Never acquire `f_fat_lock' while holding this) */
+    byte_t                 *f_free_map;    /* [lock(f_free_lock)][0..CEILDIV(f_cluster_eof,8)][owned][lock(WRITE_ONCE(f_fat_lock))]
+                                            * [BITSET] Lazily loaded bitset of free clusters (set bits are free).
+                                            *  Once loaded, this bitset mirrors the `FAT_CLUSTER_UNUSED'
+                                            *  entries of the FAT, allowing clusters to be allocated without
+                                            *  having to scan (and load) the FAT itself, or holding `f_fat_lock'. */
+    FatClusterIndex         f_free_count;  /* [lock(f_free_lock)] Amount of free clusters.
+                                            *  Until `f_free_map' has been loaded, this is the value taken from
+                                            *  the FAT32 FSInfo sector (or `FAT32_FSINFO_UNKNOWN') */
+    FatClusterIndex         f_free_pos;    /* [lock(f_free_lock)] Next cluster index that should be considered when search for free clusters. */
+    FatSectorIndex          f_fsinfo;      /* [const] Sector number of the FAT32 FSInfo sector, or 0 if there is none. */
 };
 
 /* NOTE: `fat_sector_index' should be obtained by calling `f_fat_sector'. */
@@ -376,16 +412,26 @@ Fat_SetFatIndirection(struct superblock *__restrict self,
                       FatClusterIndex index,
                       FatClusterIndex indirection_target,
                       iomode_t flags);
-/* Find a free cluster index.
- * NOTE: The caller will probably want to be holding a lock on `f_fat_lock' for this.
+/* Allocate a free cluster, preferring `hint' if that one is available.
+ * NOTE: The returned cluster is only reserved within `f_free_map'. The caller
+ *       is responsible for linking it into the FAT (or to release it using
+ *       `Fat_FreeCluster()' if that fails)
+ * NOTE: The caller need not (but may) be holding a lock on `f_fat_lock'.
+ * @param: hint: The preferred cluster (usually the one following the previous
+ *               cluster of a file), or `FAT_CLUSTER_UNUSED' if there is none.
  * @throw: E_FILESYSTEM_ERROR.ERROR_FS_DISK_FULL: There are no more free clusters.
  * @throw: E_WOULDBLOCK: `IO_NONBLOCK' was specified and the operation would have blocked. */
 INTDEF FatClusterIndex KCALL
-Fat_FindFreeCluster(struct superblock *__restrict self,
-                    iomode_t flags);
+Fat_AllocCluster(struct superblock *__restrict self,
+                 FatClusterIndex hint, iomode_t flags);
+
+/* Mark `cluster' as free within `f_free_map' (if it has been loaded). */
+INTDEF ATTR_NOTHROW void KCALL
+Fat_FreeCluster(struct superblock *__restrict self,
+                FatClusterIndex cluster);
 
 /* Delete a chain of free clusters, starting with `first_delete_index'
- * NOTE: The caller must be holding a lock on `f_fat_lock' */
+ * NOTE: This function acquires `f_fat_lock' internally. */
 INTDEF void KCALL
 Fat_DeleteClusterChain(struct superblock *__restrict self,
                        FatClusterIndex first_delete_index,
@@ -24,6 +24,7 @@
 #include <hybrid/section.h>
 #include <kernel/debug.h>
 #include <sched/async_signal.h>
+#include <sched/softirq.h>
 #include <dev/ps2.h>
 #include <kos/keyboard.h>
 #include <dev/keyboard.h>
@@ -559,19 +560,25 @@ done:
 
 #if 1 /* Merged interrupted mode. */
 INTERN void KCALL ps2_irq_1(void) {
+ u64 start = IRQSTAT_HARDIRQ_BEGIN();
  for (;;) {
   u8 status = inb(PS2_STATUS);
   if (!(status & PS2_STATUS_OUTFULL)) break;
   ps2_interrupt(status & PS2_STATUS_OUTFULL2 ? PS2_PORT2 : PS2_PORT1);
  }
+ IRQSTAT_HARDIRQ_END(start);
 }
 DEFINE_INTERN_ALIAS(ps2_irq_2,ps2_irq_1);
 #else
 INTERN void KCALL ps2_irq_1(void) {
+ u64 start = IRQSTAT_HARDIRQ_BEGIN();
  ps2_interrupt(PS2_PORT1);
+ IRQSTAT_HARDIRQ_END(start);
 }
 INTERN void KCALL ps2_irq_2(void) {
+ u64 start = IRQSTAT_HARDIRQ_BEGIN();
  ps2_interrupt(PS2_PORT2);
+ IRQSTAT_HARDIRQ_END(start);
 }
 #endif
 
@@ -43,6 +43,7 @@
 #include <fs/path.h>
 #include <fs/pipe.h>
 #include <fs/handle.h>
+#include <fs/ioring.h>
 #include <net/socket.h>
 #include <string.h>
 #include <except.h>
@@ -99,6 +100,7 @@ DEFINE_HANDLE_REFERENCE_FUNCTIONS(socket)
 DEFINE_HANDLE_REFERENCE_FUNCTIONS(futex)
 DEFINE_HANDLE_REFERENCE_FUNCTIONS(futex_handle)
 DEFINE_HANDLE_REFERENCE_FUNCTIONS(device_stream)
+DEFINE_HANDLE_REFERENCE_FUNCTIONS(ioring)
 #undef DEFINE_HANDLE_REFERENCE_FUNCTIONS
 #undef DEFINE_HANDLE_REFERENCE_FUNCTIONS_EX
 
@@ -144,15 +146,32 @@ PRIVATE __EXCEPT_NORETURN void
  __builtin_unreachable();
 }
 
-#if 1
+#define HANDLE_BITS  (sizeof(uintptr_t)*8)
+STATIC_ASSERT(HANDLE_TABLE_CHUNK == HANDLE_BITS);
+
+/* Return the slot used for handle number `fd' in `table'. */
+#define HANDLE_SLOT(table,fd) \
+   (&(table)->ht_chunk[(fd) / HANDLE_TABLE_CHUNK][(fd) % HANDLE_TABLE_CHUNK])
+#define HANDLE_TABLE_SIZEOF(num_chunks) \
+   (offsetof(struct handle_table,ht_chunk)+(num_chunks)*sizeof(struct handle_slot *))
+
+#if 0
 PRIVATE void KCALL
 validate_handle_manager(struct handle_manager *__restrict self) {
  unsigned int i;
- for (i = 0; i < self->hm_alloc; ++i) {
-  assertf(self->hm_vector[i].h_type < HANDLE_TYPE_FCOUNT,
-          "%$[hex]\n",
-          self->hm_alloc*sizeof(struct handle),
-          self->hm_vector);
+ struct handle_table *table = self->hm_table;
+ if (!table) return;
+ for (i = 0; i < table->ht_alloc; ++i) {
+  struct handle_slot *slot = HANDLE_SLOT(table,i);
+  assertf(slot->hs_hnd.h_type < HANDLE_TYPE_FCOUNT,
+          "fd     = %u\n"
+          "h_mode = %p\n"
+          "h_ptr  = %p\n",
+          i,slot->hs_hnd.h_mode,
+          slot->hs_hnd.h_ptr);
+  assertf((slot->hs_hnd.h_type != HANDLE_TYPE_FNONE) ==
+         ((self->hm_used[i / HANDLE_BITS] & ((uintptr_t)1 << (i % HANDLE_BITS))) != 0),
+          "Bitset mismatch for fd %u\n",i);
  }
 }
 #else
@@ -161,33 +180,257 @@ validate_handle_manager(struct handle_manager *__restrict self) {
 
 
 
+/* Install `hnd' into the unused `slot'.
+ * The caller must be holding a write-lock to the handle manager. */
+LOCAL void KCALL
+handle_slot_install(struct handle_slot *__restrict slot,
+                    struct handle hnd) {
+ assert(slot->hs_hnd.h_type == HANDLE_TYPE_FNONE);
+ /* Publish the object before its type, so lock-less
+  * readers that see the new type also see the new object. */
+ ATOMIC_WRITE(slot->hs_hnd.h_ptr,hnd.h_ptr);
+ COMPILER_WRITE_BARRIER();
+ ATOMIC_WRITE(slot->hs_hnd.h_mode,hnd.h_mode);
+}
+
+/* Remove the handle stored in `slot' (if any), and wait for lock-less
+ * readers that may still be looking at it to incref() it and let go.
+ * The caller must be holding a write-lock to the handle manager,
+ * and inherits the reference to the returned handle. */
+LOCAL struct handle KCALL
+handle_slot_remove(struct handle_slot *__restrict slot) {
+ struct handle result;
+ result.h_ptr = slot->hs_hnd.h_ptr;
+ /* NOTE: The exchange doubles as a full barrier that
+  *       orders it before the read of `hs_inuse' below. */
+ result.h_mode = ATOMIC_XCH(slot->hs_hnd.h_mode,
+                            HANDLE_MODE(HANDLE_TYPE_FNONE,0));
+ if (result.h_type != HANDLE_TYPE_FNONE) {
+  /* Readers only ever hold `hs_inuse' for the duration of an incref(). */
+  while (ATOMIC_READ(slot->hs_inuse) != 0)
+      task_tryyield();
+ }
+ return result;
+}
+
+
+/* Replace the handle stored in `slot' with `hnd' in one step, such
+ * that lock-less readers either see the old, or the new handle, but
+ * never an empty slot. Then wait for those readers to let go of the
+ * old handle, to which the caller inherits the reference.
+ * The caller must be holding a write-lock to the handle manager. */
+LOCAL struct handle KCALL
+handle_slot_exchange(struct handle_slot *__restrict slot,
+                     struct handle hnd) {
+ struct handle result;
+ result = slot->hs_hnd;
+ if (result.h_type == HANDLE_TYPE_FNONE) {
+  handle_slot_install(slot,hnd);
+  return result;
+ }
+ /* Both words change, so readers may see a mix of the
+  * two handles. Make them retry until we're done. */
+ ATOMIC_FETCHINC(slot->hs_seq);
+ COMPILER_WRITE_BARRIER();
+ ATOMIC_WRITE(slot->hs_hnd.h_ptr,hnd.h_ptr);
+ ATOMIC_WRITE(slot->hs_hnd.h_mode,hnd.h_mode);
+ COMPILER_WRITE_BARRIER();
+ /* NOTE: The increment doubles as a full barrier that
+  *       orders it before the read of `hs_inuse' below. */
+ ATOMIC_FETCHINC(slot->hs_seq);
+ while (ATOMIC_READ(slot->hs_inuse) != 0)
+     task_tryyield();
+ return result;
+}
+
+
+/* Mark `fd' as used/unused in the allocation bitsets of `self'. */
+LOCAL void KCALL
+handle_manager_setused(struct handle_manager *__restrict self,
+                       unsigned int fd) {
+ unsigned int word = fd / HANDLE_BITS;
+ self->hm_used[word] |= (uintptr_t)1 << (fd % HANDLE_BITS);
+ if (self->hm_used[word] == (uintptr_t)-1)
+     self->hm_full[word / HANDLE_BITS] |= (uintptr_t)1 << (word % HANDLE_BITS);
+ if (fd == self->hm_next)
+     ++self->hm_next;
+}
+LOCAL void KCALL
+handle_manager_setfree(struct handle_manager *__restrict self,
+                       unsigned int fd) {
+ unsigned int word = fd / HANDLE_BITS;
+ self->hm_used[word] &= ~((uintptr_t)1 << (fd % HANDLE_BITS));
+ self->hm_full[word / HANDLE_BITS] &= ~((uintptr_t)1 << (word % HANDLE_BITS));
+ if (fd < self->hm_next)
+     self->hm_next = fd;
+}
+
+/* Return the lowest unused handle number `>= start'.
+ * If all slots of the current table starting at `start' are in use,
+ * return the first index past its end (meaning the table must grow).
+ * NOTE: POSIX requires us to always use the lowest free index. */
+PRIVATE unsigned int KCALL
+handle_manager_findfree(struct handle_manager *__restrict self,
+                        unsigned int start) {
+ struct handle_table *table = self->hm_table;
+ unsigned int word,count; uintptr_t bits;
+ if (start < self->hm_next)
+     start = self->hm_next;
+ if (!table || start >= table->ht_alloc)
+     return start;
+ count = table->ht_alloc / HANDLE_BITS;
+ word  = start / HANDLE_BITS;
+ bits  = self->hm_used[word] | (((uintptr_t)1 << (start % HANDLE_BITS))-1);
+ if (bits != (uintptr_t)-1)
+     goto found;
+ /* Use the summary bitset to skip words that are fully in use. */
+ for (++word; word < count; word = (word | (HANDLE_BITS-1))+1) {
+  bits = self->hm_full[word / HANDLE_BITS] |
+       (((uintptr_t)1 << (word % HANDLE_BITS))-1);
+  if (bits == (uintptr_t)-1)
+      continue;
+  word = (word & ~(HANDLE_BITS-1)) + __builtin_ctzl(~bits);
+  if (word >= count)
+      break;
+  bits = self->hm_used[word];
+  goto found;
+ }
+ return table->ht_alloc;
+found:
+ return word*HANDLE_BITS + __builtin_ctzl(~bits);
+}
+
+
+/* Allocate a new handle table with `num_chunks' chunks,
+ * sharing all the chunks that already exist in `old_table'. */
+PRIVATE ATTR_RETNONNULL struct handle_table *KCALL
+handle_table_extend(struct handle_table *old_table,
+                    unsigned int num_chunks) {
+ struct handle_table *EXCEPT_VAR result;
+ unsigned int EXCEPT_VAR old_chunks;
+ unsigned int EXCEPT_VAR i;
+ old_chunks = old_table ? old_table->ht_alloc / HANDLE_TABLE_CHUNK : 0;
+ assert(num_chunks > old_chunks);
+ result = (struct handle_table *)kmalloc(HANDLE_TABLE_SIZEOF(num_chunks),
+                                         GFP_SHARED);
+ i = old_chunks;
+ TRY {
+  if (old_table) {
+   memcpy(result->ht_chunk,old_table->ht_chunk,
+          old_chunks*sizeof(struct handle_slot *));
+  }
+#if HANDLE_TYPE_FNONE != 0
+#error "ERROR: This kmalloc() assumes that `HANDLE_TYPE_FNONE' is ZERO"
+#endif
+  for (; i < num_chunks; ++i) {
+   result->ht_chunk[i] = (struct handle_slot *)kmalloc(HANDLE_TABLE_CHUNK*
+                                                       sizeof(struct handle_slot),
+                                                       GFP_SHARED|GFP_CALLOC);
+  }
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  while (i > old_chunks)
+      kfree(result->ht_chunk[--i]);
+  kfree(result);
+  error_rethrow();
+ }
+ result->ht_alloc = num_chunks*HANDLE_TABLE_CHUNK;
+ result->ht_prev  = old_table;
+ return result;
+}
+
+/* Grow the handle table of `self' to contain at least `min_alloc' slots.
+ * The caller must be holding a write-lock to `self->hm_lock', unless
+ * `self' hasn't been made visible to other threads yet. */
+PRIVATE void KCALL
+handle_manager_grow(struct handle_manager *__restrict self,
+                    unsigned int min_alloc) {
+ struct handle_table *old_table = self->hm_table;
+ struct handle_table *EXCEPT_VAR new_table;
+ unsigned int EXCEPT_VAR old_chunks;
+ unsigned int EXCEPT_VAR min_chunks;
+ unsigned int new_chunks,max_chunks;
+ uintptr_t *bits;
+ old_chunks = old_table ? old_table->ht_alloc / HANDLE_TABLE_CHUNK : 0;
+ min_chunks = CEILDIV(min_alloc,HANDLE_TABLE_CHUNK);
+ max_chunks = CEILDIV(self->hm_limit,HANDLE_TABLE_CHUNK);
+ assert(min_chunks > old_chunks);
+ new_chunks = old_chunks*2;
+ if (new_chunks > max_chunks) new_chunks = max_chunks;
+ if (new_chunks < min_chunks) new_chunks = min_chunks;
+ TRY {
+  new_table = handle_table_extend(old_table,new_chunks);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  /* Try once more time with the minimal increment. */
+  if (new_chunks == min_chunks)
+      error_rethrow();
+  new_table = handle_table_extend(old_table,min_chunks);
+ }
+ new_chunks = new_table->ht_alloc / HANDLE_TABLE_CHUNK;
+ TRY {
+  /* NOTE: All bitsets are allocated with `GFP_CALLOC', so
+   *       trailing, pre-allocated memory is always ZERO. */
+  bits = (uintptr_t *)krealloc(self->hm_used,new_chunks*sizeof(uintptr_t),
+                               GFP_SHARED|GFP_CALLOC);
+  self->hm_used = bits;
+  bits = (uintptr_t *)krealloc(self->hm_full,
+                               CEILDIV(new_chunks,HANDLE_BITS)*sizeof(uintptr_t),
+                               GFP_SHARED|GFP_CALLOC);
+  self->hm_full = bits;
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  unsigned int i = new_table->ht_alloc / HANDLE_TABLE_CHUNK;
+  while (i > old_chunks)
+      kfree(new_table->ht_chunk[--i]);
+  kfree(new_table);
+  error_rethrow();
+ }
+ /* Publish the new table. Lock-less readers may still be using
+  * the old one, which is why it is kept until we get destroyed. */
+ ATOMIC_WRITE(self->hm_table,new_table);
+}
+
+
+
 /* Destroy a previously allocated handle_manager. */
 PUBLIC void KCALL
 handle_manager_destroy(struct handle_manager *__restrict self) {
- unsigned int i,count;
- struct handle *vec = self->hm_vector;
- count = self->hm_alloc;
- for (i = 0; i < count; ++i) {
-  assertf(vec[i].h_type < HANDLE_TYPE_FCOUNT,
-          "h_mode = %p\n"
-          "h_ptr  = %p\n",
-          vec[i].h_mode,
-          vec[i].h_ptr);
-  if (vec[i].h_type != HANDLE_TYPE_FNONE)
-      handle_decref(vec[i]);
+ struct handle_table *table,*next;
+ unsigned int i;
+ table = self->hm_table;
+ if (table) {
+  for (i = 0; i < table->ht_alloc; ++i) {
+   struct handle_slot *slot = HANDLE_SLOT(table,i);
+   assertf(slot->hs_hnd.h_type < HANDLE_TYPE_FCOUNT,
+           "h_mode = %p\n"
+           "h_ptr  = %p\n",
+           slot->hs_hnd.h_mode,
+           slot->hs_hnd.h_ptr);
+   if (slot->hs_hnd.h_type != HANDLE_TYPE_FNONE)
+       handle_decref(slot->hs_hnd);
+  }
+  /* The most recent table owns all the chunks. */
+  for (i = 0; i < table->ht_alloc / HANDLE_TABLE_CHUNK; ++i)
+      kfree(table->ht_chunk[i]);
+  /* Free the table, as well as all the ones it has retired. */
+  do {
+   next = table->ht_prev;
+   kfree(table);
+  } while ((table = next) != NULL);
  }
- kfree(vec);
+ kfree(self->hm_used);
+ kfree(self->hm_full);
  kfree(self);
 }
 
 /* The handle manager of the kernel itself. */
 PUBLIC struct handle_manager handle_manager_kernel = {
     .hm_refcnt = 1,
-    .hm_limit  = CONFIG_HANDLE_MANAGER_DEFAULT_LIMIT,
     .hm_lock   = ATOMIC_RWLOCK_INIT,
-    .hm_alloc  = 0,
+    .hm_limit  = CONFIG_HANDLE_MANAGER_DEFAULT_LIMIT,
     .hm_count  = 0,
-    .hm_vector = NULL,
+    .hm_next   = 0,
+    .hm_table  = NULL,
+    .hm_used   = NULL,
+    .hm_full   = NULL,
 };
 
 /* [1..1][const] Handle manager of the calling thread. */
@@ -220,103 +463,54 @@ PUBLIC ATTR_RETNONNULL ATTR_MALLOC
 REF struct handle_manager *KCALL handle_manager_clone(void) {
  struct handle_manager *orig = THIS_HANDLE_MANAGER;
  REF struct handle_manager *EXCEPT_VAR result;
- unsigned int i,count; struct handle *vector;
+ struct handle_table *table; unsigned int i;
  result = (REF struct handle_manager *)kmalloc(sizeof(struct handle_manager),
-                                               GFP_SHARED);
+                                               GFP_SHARED|GFP_CALLOC);
  TRY {
   result->hm_refcnt = 1;
-  atomic_rwlock_init(&result->hm_lock);
+  result->hm_flags  = HANDLE_MANAGER_FNORMAL;
+  result->hm_limit  = orig->hm_limit;
+  atomic_rwlock_cinit(&result->hm_lock);
   atomic_rwlock_read(&orig->hm_lock);
   validate_handle_manager(orig);
-  if unlikely(!orig->hm_count) {
-   atomic_rwlock_endread(&orig->hm_lock);
-   result->hm_limit  = orig->hm_limit;
-   result->hm_alloc  = 0;
-   result->hm_count  = 0;
-   result->hm_vector = NULL;
-   goto done;
-  }
-  vector = NULL;
   for (;;) {
-   result->hm_alloc = orig->hm_alloc;
+   table = orig->hm_table;
+   if unlikely(!orig->hm_count) {
+    atomic_rwlock_endread(&orig->hm_lock);
+    goto done;
+   }
+   if (result->hm_table &&
+       result->hm_table->ht_alloc >= table->ht_alloc)
+       break;
+   i = table->ht_alloc;
    atomic_rwlock_endread(&orig->hm_lock);
    COMPILER_BARRIER();
-   vector = (struct handle *)krealloc(vector,
-                                      result->hm_alloc*
-                                      sizeof(struct handle),
-                                      GFP_SHARED);
+   /* `result' isn't visible to anyone else, so no lock is needed. */
+   handle_manager_grow(result,i);
    COMPILER_BARRIER();
    atomic_rwlock_read(&orig->hm_lock);
-   if (result->hm_alloc >= orig->hm_alloc)
-       break;
-  }
-  memcpy(vector,orig->hm_vector,orig->hm_alloc*sizeof(struct handle));
-  if unlikely(result->hm_alloc != orig->hm_alloc) {
-   /* Clear handles that we've overallocated. */
-   memset(vector+orig->hm_alloc,0,
-         (result->hm_alloc-orig->hm_alloc)*sizeof(struct handle));
   }
-  /* Now incref() all handles without the
-   * `IO_HANDLE_FCLOFORK' flag set, and clear the reset. */
-  result->hm_limit  = orig->hm_limit;
-  result->hm_count  = orig->hm_count;
-  result->hm_vector = vector;
-  assert(orig->hm_count <= orig->hm_alloc);
-  count = orig->hm_alloc;
-  for (i = 0; i < count; ++i) {
-   /* Skip unused entries. */
-   if (vector[i].h_type == HANDLE_TYPE_FNONE)
+  /* Now copy + incref() all handles without the
+   * `IO_HANDLE_FCLOFORK' flag set, and skip the rest. */
+  for (i = 0; i < table->ht_alloc; ++i) {
+   struct handle hnd = HANDLE_SLOT(table,i)->hs_hnd;
+   if (hnd.h_type == HANDLE_TYPE_FNONE)
        continue;
-   if (vector[i].h_flag & IO_HANDLE_FCLOFORK) {
-    /* Close this handle. */
-    vector[i].h_type = HANDLE_TYPE_FNONE;
-
-    /* Update the number of used handles. */
-    assert(result->hm_count);
-    --result->hm_count;
-   } else {
-    /* incref() this handle. */
-    handle_incref(vector[i]);
-   }
+   if (hnd.h_flag & IO_HANDLE_FCLOFORK)
+       continue;
+   handle_incref(hnd);
+   HANDLE_SLOT(result->hm_table,i)->hs_hnd = hnd;
+   handle_manager_setused(result,i);
+   ++result->hm_count;
   }
   validate_handle_manager(orig);
   atomic_rwlock_endread(&orig->hm_lock);
 done:
-  result->hm_flags = HANDLE_MANAGER_FNORMAL;
-  vector = result->hm_vector;
-  if (vector) {
-   size_t usable = kmalloc_usable_size(vector);
-   size_t used = result->hm_alloc*sizeof(struct handle);
-   assert(usable >= used);
-   /* ZERO out allocated, but unused trailing data.
-    * -> Because the heap is allowed to allocate more than
-    *    was actually expected, alongside the fact that we
-    *    don't pass `GFP_CALLOC' to the allocator above,
-    *    trailing memory may not actually be ZERO-initialized.
-    *    However, other handle manager functions assume that
-    *    they can reallocate the handle vector while passing
-    *    the `GFP_CALLOC' flag to ensure that ~newly~ allocated
-    *    memory is ZERO-initialized.
-    *    However, trailing memory does not count towards new
-    *    allocations, but rather belongs to existing allocations,
-    *    in other words: As far as the heap is concerned, it
-    *    will not ZERO out this trailing memory then, leading
-    *    to very strange SEGFAULT-exceptions that seem to point
-    *    back into the heap, however actually originate from
-    *    here.
-    * SOLLUTION: Just use `kmalloc_usable_size()' to ZERO out
-    *            any additional, pre-allocated, trailing memory. */
-   if unlikely(usable > used) {
-    usable -= used;
-    memset((byte_t *)vector+used,0,usable);
-#if 1 /* If it's already there, might as well use it... */
-    result->hm_alloc += usable/sizeof(struct handle);
-#endif
-   }
-  }
   validate_handle_manager(result);
  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
-  kfree(result);
+  /* Handles are only copied once nothing can fail anymore,
+   * so this will only free the tables we've allocated. */
+  handle_manager_destroy(result);
   error_rethrow();
  }
  return result;
@@ -339,19 +533,23 @@ task_clone_handle_manager(struct task *__restrict new_thread, u32 flags) {
  * flag set in the current handle manager. */
 PUBLIC void KCALL handle_manager_close_exec(void) {
  struct handle_manager *man = THIS_HANDLE_MANAGER;
+ struct handle_table *table;
  unsigned int i; bool did_change;
  do {
   did_change = false;
   atomic_rwlock_write(&man->hm_lock);
-  for (i = 0; i < man->hm_alloc; ++i) {
+  table = man->hm_table;
+  for (i = 0; table && i < table->ht_alloc; ++i) {
    struct handle hnd;
-   if (man->hm_vector[i].h_type == HANDLE_TYPE_FNONE)
+   struct handle_slot *slot = HANDLE_SLOT(table,i);
+   if (slot->hs_hnd.h_type == HANDLE_TYPE_FNONE)
        continue;
-   if (!(man->hm_vector[i].h_flag & IO_HANDLE_FCLOEXEC))
+   if (!(slot->hs_hnd.h_flag & IO_HANDLE_FCLOEXEC))
        continue;
    /* Must close this handle. */
-   hnd                      = man->hm_vector[i];
-   man->hm_vector[i].h_type = HANDLE_TYPE_FNONE;
+   hnd = handle_slot_remove(slot);
+   handle_manager_setfree(man,i);
+   --man->hm_count;
    atomic_rwlock_endwrite(&man->hm_lock);
    /* Drop a reference from the handle. */
    handle_decref(hnd);
@@ -360,6 +558,7 @@ PUBLIC void KCALL handle_manager_close_exec(void) {
     * from opening new files until this function returns. */
    did_change = true;
    atomic_rwlock_write(&man->hm_lock);
+   table = man->hm_table;
   }
   validate_handle_manager(man);
   atomic_rwlock_endwrite(&man->hm_lock);
@@ -374,17 +573,22 @@ PRIVATE bool KCALL close_symbolic_handle(fd_t fd);
  * @return: false: No handle was associated with `fd'. */
 PUBLIC bool KCALL handle_close(fd_t fd) {
  struct handle_manager *man = THIS_HANDLE_MANAGER;
+ struct handle_table *table;
  struct handle hnd;
  if (fd < 0)
      return close_symbolic_handle(fd);
  atomic_rwlock_write(&man->hm_lock);
  validate_handle_manager(man);
- if unlikely((unsigned int)fd >= man->hm_alloc) {
+ table = man->hm_table;
+ if unlikely(!table || (unsigned int)fd >= table->ht_alloc) {
   atomic_rwlock_endwrite(&man->hm_lock);
   return false;
  }
- hnd = man->hm_vector[(unsigned int)fd];
- man->hm_vector[(unsigned int)fd].h_type = HANDLE_TYPE_FNONE;
+ hnd = handle_slot_remove(HANDLE_SLOT(table,(unsigned int)fd));
+ if (hnd.h_type != HANDLE_TYPE_FNONE) {
+  handle_manager_setfree(man,(unsigned int)fd);
+  --man->hm_count;
+ }
  validate_handle_manager(man);
  atomic_rwlock_endwrite(&man->hm_lock);
  /* NOTE: decref() is a noop for FNONE */
@@ -450,146 +654,40 @@ handle_dupinto(fd_t fd, fd_t dfd, iomode_t flags) {
  * return the handle number of where it was placed.
  * @throw: E_BADALLOC.ERROR_BADALLOC_HANDLE: Too many open handles. */
 PUBLIC unsigned int KCALL handle_put(struct handle hnd) {
- struct handle *EXCEPT_VAR vector; unsigned int result;
- struct handle_manager *EXCEPT_VAR man = THIS_HANDLE_MANAGER;
- assert(hnd.h_type != HANDLE_TYPE_FNONE);
- atomic_rwlock_write(&man->hm_lock);
- validate_handle_manager(man);
- vector = man->hm_vector;
- if unlikely(man->hm_count == man->hm_alloc) {
-  /* Must allocate more vector entries. */
-  unsigned int EXCEPT_VAR new_alloc = man->hm_alloc * 2;
-  if unlikely(!new_alloc) new_alloc = 16;
-  if unlikely(new_alloc > man->hm_limit) {
-   new_alloc = man->hm_limit;
-   if unlikely(new_alloc <= man->hm_alloc) {
-    atomic_rwlock_endwrite(&man->hm_lock);
-    /* Too many handles. */
-    error_throwf(E_BADALLOC,
-                 ERROR_BADALLOC_HANDLE,
-                (size_t)new_alloc);
-   }
-  }
-#if HANDLE_TYPE_FNONE != 0
-#error "ERROR: This krealloc() assumes that `HANDLE_TYPE_FNONE' is ZERO"
-#endif
-  TRY {
-   vector = (struct handle *)krealloc(vector,new_alloc*
-                                      sizeof(struct handle),
-                                      GFP_SHARED|GFP_CALLOC);
-  } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-   /* Try once more time with a minimal increment. */
-   new_alloc = man->hm_alloc+1;
-   TRY {
-    vector = (struct handle *)krealloc(vector,new_alloc*
-                                       sizeof(struct handle),
-                                       GFP_SHARED|GFP_CALLOC);
-   } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-    atomic_rwlock_endwrite(&man->hm_lock);
-    error_rethrow();
-   }
-  }
-  assertf(!memxchr(vector+man->hm_alloc,0,
-                  (new_alloc-man->hm_alloc)*
-                   sizeof(struct handle)),
-          "New vector memory isn't ZERO-initialized:\n"
-          "%$[hex]\n",
-          new_alloc*sizeof(struct handle),vector);
-
-  /* Save the new vector. */
-  man->hm_alloc  = new_alloc;
-  man->hm_vector = vector;
- }
- /* Find a suitable location. */
- result = 0;
- /* NOTE: Since we're starting at ZERO(0), we know
-  *       that there must be at least one free slot
-  *       within the first `man->hm_count+1' entires.
-  * NOTE: POSIX requires us to always use the lowest free index. */
- for (; result < man->hm_count; ++result)
-     if (vector[result].h_type == HANDLE_TYPE_FNONE)
-         break;
- assert(vector[result].h_type == HANDLE_TYPE_FNONE);
-
- /* Save the given handle into the vector. */
- vector[result] = hnd;
- handle_incref(hnd);
-
- /* Track the number of allocated handles. */
- ++man->hm_count;
- validate_handle_manager(man);
- atomic_rwlock_endwrite(&man->hm_lock);
- return result;
+ return handle_putat(hnd,0);
 }
 
 PUBLIC unsigned int KCALL
 handle_putat(struct handle hnd, unsigned int hint) {
- unsigned int EXCEPT_VAR xhint = hint;
- struct handle *EXCEPT_VAR vector; unsigned int result;
  struct handle_manager *EXCEPT_VAR man = THIS_HANDLE_MANAGER;
+ unsigned int result;
  assert(hnd.h_type != HANDLE_TYPE_FNONE);
  atomic_rwlock_write(&man->hm_lock);
  validate_handle_manager(man);
- vector = man->hm_vector;
- if unlikely(hint >= man->hm_alloc) {
-  /* Must allocate more vector entries. */
-  unsigned int EXCEPT_VAR new_alloc = man->hm_alloc * 2;
-  if unlikely(!new_alloc) new_alloc = 16;
-  if unlikely(hint >= man->hm_limit) {
-   /* Invalid hint position. */
-   atomic_rwlock_endwrite(&man->hm_lock);
-    /* Too many handles. */
-    error_throwf(E_BADALLOC,
-                 ERROR_BADALLOC_HANDLE,
-                (size_t)new_alloc);
-  }
-  while (new_alloc <= hint) new_alloc *= 2;
-  if unlikely(new_alloc > man->hm_limit)
-     new_alloc = man->hm_limit;
-  assert(new_alloc > hint);
-#if HANDLE_TYPE_FNONE != 0
-#error "ERROR: This krealloc() assumes that `HANDLE_TYPE_FNONE' is ZERO"
-#endif
+ /* Find a suitable location. */
+ result = handle_manager_findfree(man,hint);
+ if unlikely(result >= man->hm_limit) {
+  atomic_rwlock_endwrite(&man->hm_lock);
+  /* Too many handles. */
+  error_throwf(E_BADALLOC,
+               ERROR_BADALLOC_HANDLE,
+              (size_t)man->hm_limit);
+ }
+ if (!man->hm_table || result >= man->hm_table->ht_alloc) {
+  /* Must allocate more slots. */
   TRY {
-   vector = (struct handle *)krealloc(vector,new_alloc*
-                                      sizeof(struct handle),
-                                      GFP_SHARED|GFP_CALLOC);
-  } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-   /* Try once more time with a minimal increment. */
-   new_alloc = xhint+1;
-   TRY {
-    vector = (struct handle *)krealloc(vector,new_alloc*
-                                       sizeof(struct handle),
-                                       GFP_SHARED|GFP_CALLOC);
-   } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-    atomic_rwlock_endwrite(&man->hm_lock);
-    error_rethrow();
-   }
+   handle_manager_grow(man,result+1);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   atomic_rwlock_endwrite(&man->hm_lock);
+   error_rethrow();
   }
-  assertf(!memxchr(vector+man->hm_alloc,0,
-                  (new_alloc-man->hm_alloc)*
-                   sizeof(struct handle)),
-          "New vector memory isn't ZERO-initialized:\n"
-          "%$[hex]\n",
-          new_alloc*sizeof(struct handle),vector);
-
-  /* Save the new vector. */
-  man->hm_alloc  = new_alloc;
-  man->hm_vector = vector;
  }
- /* Find a suitable location. */
- result = hint;
- /* NOTE: POSIX requires us to always use the lowest free index. */
- for (; result < man->hm_alloc; ++result)
-     if (vector[result].h_type == HANDLE_TYPE_FNONE)
-         break;
- assert(vector[result].h_type == HANDLE_TYPE_FNONE);
-
- /* Save the given handle into the vector. */
- vector[result] = hnd;
+ /* Save the given handle into the table. */
  handle_incref(hnd);
+ handle_slot_install(HANDLE_SLOT(man->hm_table,result),hnd);
 
  /* Track the number of allocated handles. */
+ handle_manager_setused(man,result);
  ++man->hm_count;
  validate_handle_manager(man);
  atomic_rwlock_endwrite(&man->hm_lock);
@@ -604,7 +702,7 @@ handle_putat(struct handle hnd, unsigned int hint) {
 PUBLIC void KCALL
 handle_putinto(fd_t dfd, struct handle hnd) {
  fd_t EXCEPT_VAR xdfd = dfd;
- struct handle *EXCEPT_VAR vector;
+ struct handle_slot *slot;
  struct handle old_hnd;
  struct handle_manager *EXCEPT_VAR man = THIS_HANDLE_MANAGER;
  assert(hnd.h_type != HANDLE_TYPE_FNONE);
@@ -707,66 +805,35 @@ handle_putinto(fd_t dfd, struct handle hnd) {
  }
  atomic_rwlock_write(&man->hm_lock);
  validate_handle_manager(man);
- vector = man->hm_vector;
- if unlikely((unsigned int)dfd >= man->hm_alloc) {
-  /* Must allocate more vector entries. */
-  unsigned int EXCEPT_VAR new_alloc = man->hm_alloc * 2;
-  if unlikely(!new_alloc) new_alloc = 16;
-  while (new_alloc <= (unsigned int)dfd) new_alloc *= 2;
-  if unlikely(new_alloc > man->hm_limit) {
-   new_alloc = (unsigned int)dfd+1;
-   if unlikely(new_alloc >= man->hm_limit) {
-    atomic_rwlock_endwrite(&man->hm_lock);
-    /* Handle is too large. */
-    throw_invalid_handle(dfd,
-                         ERROR_INVALID_HANDLE_FUNDEFINED,
-                         HANDLE_TYPE_FNONE,
-                         HANDLE_TYPE_FNONE,
-                         ERROR_INVALID_HANDLE_ILLHND_FBOUND);
-   }
+ if (!man->hm_table || (unsigned int)dfd >= man->hm_table->ht_alloc) {
+  /* Must allocate more slots. */
+  if unlikely((unsigned int)dfd >= man->hm_limit) {
+   atomic_rwlock_endwrite(&man->hm_lock);
+   /* Handle is too large. */
+   throw_invalid_handle(dfd,
+                        ERROR_INVALID_HANDLE_FUNDEFINED,
+                        HANDLE_TYPE_FNONE,
+                        HANDLE_TYPE_FNONE,
+                        ERROR_INVALID_HANDLE_ILLHND_FBOUND);
   }
-#if HANDLE_TYPE_FNONE != 0
-#error "ERROR: This krealloc() assumes that `HANDLE_TYPE_FNONE' is ZERO"
-#endif
   TRY {
-   assert(new_alloc > man->hm_alloc);
-   validate_handle_manager(man);
-   vector = (struct handle *)krealloc(vector,new_alloc*
-                                      sizeof(struct handle),
-                                      GFP_SHARED|GFP_CALLOC);
-  } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-   /* Try once more time with the minimal size. */
-   new_alloc = (unsigned int)xdfd+1;
-   assert(new_alloc > man->hm_alloc);
-   TRY {
-    vector = (struct handle *)krealloc(vector,new_alloc*
-                                       sizeof(struct handle),
-                                       GFP_SHARED|GFP_CALLOC);
-   } EXCEPT(EXCEPT_EXECUTE_HANDLER) {
-    atomic_rwlock_endwrite(&man->hm_lock);
-    error_rethrow();
-   }
+   handle_manager_grow(man,(unsigned int)xdfd+1);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   atomic_rwlock_endwrite(&man->hm_lock);
+   error_rethrow();
   }
-  assertf(!memxchr(vector+man->hm_alloc,0,
-                  (new_alloc-man->hm_alloc)*
-                   sizeof(struct handle)),
-          "New vector memory isn't ZERO-initialized:\n"
-          "%$[hex]\n",
-          new_alloc*sizeof(struct handle),vector);
-
-  /* Save the new vector. */
-  man->hm_alloc  = new_alloc;
-  man->hm_vector = vector;
  }
+ slot = HANDLE_SLOT(man->hm_table,(unsigned int)dfd);
 
- /* Save the given handle into the vector. */
- old_hnd = vector[(unsigned int)xdfd];
- vector[(unsigned int)xdfd] = hnd;
+ /* Save the given handle into the slot. */
  handle_incref(hnd);
+ old_hnd = handle_slot_exchange(slot,hnd);
 
  /* Track the number of allocated handles. */
- if (old_hnd.h_type == HANDLE_TYPE_FNONE)
-     ++man->hm_count;
+ if (old_hnd.h_type == HANDLE_TYPE_FNONE) {
+  handle_manager_setused(man,(unsigned int)dfd);
+  ++man->hm_count;
+ }
  validate_handle_manager(man);
  atomic_rwlock_endwrite(&man->hm_lock);
 
@@ -896,20 +963,44 @@ close_symbolic_handle(fd_t fd) {
 PUBLIC REF struct handle KCALL handle_get(fd_t fd) {
  REF struct handle result;
  struct handle_manager *man;
+ struct handle_table *table;
+ struct handle_slot *slot;
  /* Deal with symbolic handles. */
  if (fd < 0)
      return get_symbolic_handle(fd);
- man = THIS_HANDLE_MANAGER;
- atomic_rwlock_read(&man->hm_lock);
- if unlikely((unsigned int)fd >= man->hm_alloc) {
-  atomic_rwlock_endread(&man->hm_lock);
-  COMPILER_BARRIER();
-  goto undefined_handle;
+ man   = THIS_HANDLE_MANAGER;
+ table = ATOMIC_READ(man->hm_table);
+ if unlikely(!table || (unsigned int)fd >= table->ht_alloc)
+    goto undefined_handle;
+ slot = HANDLE_SLOT(table,(unsigned int)fd);
+ if (ATOMIC_READ(man->hm_refcnt) == 1) {
+  /* Fast path: The calling thread is the only one using its
+   *            handle manager, so nobody can modify the slot. */
+  result = slot->hs_hnd;
+  /* NOTE: incref() is a no-op on invalid handles. */
+  handle_incref(result);
+ } else {
+  /* Lock-less lookup: Announce our presence to writers, so that
+   * the handle can't be removed before we've incref()'ed it. */
+  uintptr_t seq;
+  ATOMIC_FETCHINC(slot->hs_inuse);
+  for (;;) {
+   seq = ATOMIC_READ(slot->hs_seq);
+   if unlikely(seq & 1) {
+    /* The handle is being replaced (s.a. `handle_slot_exchange()') */
+    task_tryyield();
+    continue;
+   }
+   COMPILER_READ_BARRIER();
+   result.h_mode = ATOMIC_READ(slot->hs_hnd.h_mode);
+   COMPILER_READ_BARRIER();
+   result.h_ptr  = ATOMIC_READ(slot->hs_hnd.h_ptr);
+   COMPILER_READ_BARRIER();
+   if likely(ATOMIC_READ(slot->hs_seq) == seq) break;
+  }
+  handle_incref(result);
+  ATOMIC_FETCHDEC(slot->hs_inuse);
  }
- result = man->hm_vector[(unsigned int)fd];
- /* NOTE: incref() is a no-op on invalid handles. */
- handle_incref(result);
- atomic_rwlock_endread(&man->hm_lock);
 
  /* Check if this is an invalid handle. */
  if unlikely(result.h_type == HANDLE_TYPE_FNONE) {
@@ -1314,10 +1405,34 @@ KCALL handle_get_typed(fd_t fd, u16 type) {
 }
 
 
+/* Acquire a write-lock to `self' and return the slot used by `fd'.
+ * @throw: E_INVALID_HANDLE: `fd' isn't in use (the lock is not held) */
+PRIVATE struct handle_slot *KCALL
+handle_manager_lockslot(struct handle_manager *__restrict self, fd_t fd) {
+ struct handle_table *table;
+ struct handle_slot *result;
+ atomic_rwlock_write(&self->hm_lock);
+ table = self->hm_table;
+ if unlikely(fd < 0 || !table || (unsigned int)fd >= table->ht_alloc)
+    goto undefined_handle;
+ result = HANDLE_SLOT(table,(unsigned int)fd);
+ if unlikely(result->hs_hnd.h_type == HANDLE_TYPE_FNONE) {
+undefined_handle:
+  atomic_rwlock_endwrite(&self->hm_lock);
+  throw_invalid_handle(fd,
+                       ERROR_INVALID_HANDLE_FUNDEFINED,
+                       HANDLE_TYPE_FNONE,
+                       HANDLE_TYPE_FNONE,
+                       ERROR_INVALID_HANDLE_ILLHND_FUNSET);
+ }
+ return result;
+}
+
 PUBLIC syscall_slong_t KCALL
 handle_fcntl(fd_t fd, unsigned int cmd,
              UNCHECKED USER void *arg) {
  struct handle_manager *hman;
+ struct handle_slot *slot;
  syscall_slong_t COMPILER_IGNORE_UNINITIALIZED(result);
  switch (cmd) {
 
@@ -1345,23 +1460,16 @@ handle_fcntl(fd_t fd, unsigned int cmd,
       error_throw(E_INVALID_ARGUMENT);
  case F_GETFD:
   hman = THIS_HANDLE_MANAGER;
-  atomic_rwlock_read(&hman->hm_lock);
-  if unlikely((unsigned int)fd >= hman->hm_alloc ||
-               hman->hm_vector[(unsigned int)fd].h_type == HANDLE_TYPE_FNONE) {
-   atomic_rwlock_endread(&hman->hm_lock);
-   throw_invalid_handle(fd,
-                        ERROR_INVALID_HANDLE_FUNDEFINED,
-                        HANDLE_TYPE_FNONE,
-                        HANDLE_TYPE_FNONE,
-                        ERROR_INVALID_HANDLE_ILLHND_FUNSET);
-  }
-  /* Read, write, or exchange the file flags. */
+  slot = handle_manager_lockslot(hman,fd);
+  /* Read, or write the file flags. */
   if (cmd == F_GETFD) {
-   result = IO_HANDLE_FTO_O(ATOMIC_READ(hman->hm_vector[(unsigned int)fd].h_flag));
+   result = IO_HANDLE_FTO_O(slot->hs_hnd.h_flag);
   } else {
-   ATOMIC_WRITE(hman->hm_vector[(unsigned int)fd].h_flag,(u16)(uintptr_t)arg);
+   ATOMIC_WRITE(slot->hs_hnd.h_flag,
+               (slot->hs_hnd.h_flag & ~IO_SETFD_MASK) |
+               (iomode_t)(uintptr_t)arg);
   }
-  atomic_rwlock_endread(&hman->hm_lock);
+  atomic_rwlock_endwrite(&hman->hm_lock);
   break;
 
  {
@@ -1384,48 +1492,36 @@ handle_fcntl(fd_t fd, unsigned int cmd,
   if (new_mode & ~IO_SETFL_MASK)
       error_throw(E_INVALID_ARGUMENT);
   hman = THIS_HANDLE_MANAGER;
-  atomic_rwlock_read(&hman->hm_lock);
-  if unlikely((unsigned int)fd >= hman->hm_alloc ||
-               hman->hm_vector[(unsigned int)fd].h_type == HANDLE_TYPE_FNONE) {
-   atomic_rwlock_endread(&hman->hm_lock);
-   throw_invalid_handle(fd,
-                        ERROR_INVALID_HANDLE_FUNDEFINED,
-                        HANDLE_TYPE_FNONE,
-                        HANDLE_TYPE_FNONE,
-                        ERROR_INVALID_HANDLE_ILLHND_FUNSET);
-  }
+  slot = handle_manager_lockslot(hman,fd);
   /* Exchange file flags. */
-  result = hman->hm_vector[(unsigned int)fd].h_flag & IO_SETFL_MASK;
+  result = slot->hs_hnd.h_flag & IO_SETFL_MASK;
   result = IO_TO_O(result);
-  hman->hm_vector[(unsigned int)fd].h_flag &= ~IO_SETFL_MASK;
-  hman->hm_vector[(unsigned int)fd].h_flag |= new_mode;
-  atomic_rwlock_endread(&hman->hm_lock);
+  ATOMIC_WRITE(slot->hs_hnd.h_flag,
+              (slot->hs_hnd.h_flag & ~IO_SETFL_MASK) | new_mode);
+  atomic_rwlock_endwrite(&hman->hm_lock);
   /* Only `F_SETFL_XCH' returns the old set of flags. */
   if (cmd != F_SETFL_XCH)
       result = 0;
  } break;
 
  {
-  REF struct pipe *p;
-  size_t old_limit,new_limit;
+  REF struct pipe *EXCEPT_VAR p;
  case F_SETPIPE_SZ:
   p = handle_get_pipe(fd);
-  /* XXX: Limit? */
-  do {
-   old_limit  = ATOMIC_READ(p->p_buffer.r_limt);
-   new_limit  = old_limit & ~RBUFFER_LIMT_FMASK;
-   new_limit |= CEIL_ALIGN((size_t)(uintptr_t)arg,(~RBUFFER_LIMT_FMASK)+1);
-  } while (!ATOMIC_CMPXCH_WEAK(p->p_buffer.r_limt,old_limit,new_limit));
-  pipe_decref(p);
-  result = 0;
+  TRY {
+   /* Returns the actual (page-aligned) new buffer size. */
+   result = (syscall_slong_t)pipebuffer_setlimit(&p->p_buffer,
+                                                 (size_t)(uintptr_t)arg);
+  } FINALLY {
+   pipe_decref(p);
+  }
  } break;
 
  {
   REF struct pipe *p;
  case F_GETPIPE_SZ:
   p = handle_get_pipe(fd);
-  result = (syscall_slong_t)((uintptr_t)p->p_buffer.r_limt &
-                              RBUFFER_LIMT_FMASK);
+  result = (syscall_slong_t)pipebuffer_getlimit(&p->p_buffer);
   pipe_decref(p);
  } break;
 
@@ -127,6 +127,7 @@ illegal_poll(void *__restrict UNUSED(ptr),
     macro(futex,HANDLE_TYPE_FFUTEX) \
     macro(futex_handle,HANDLE_TYPE_FFUTEX_HANDLE) \
     macro(device_stream,HANDLE_TYPE_FDEVICE_STREAM) \
+    macro(ioring,HANDLE_TYPE_FIORING) \
 /**/
 
 #define DEFINE_WEAK_OPS(name,id) \
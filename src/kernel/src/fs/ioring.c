@@ -0,0 +1,956 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_SRC_FS_IORING_C
+#define GUARD_KERNEL_SRC_FS_IORING_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <kos/ioring.h>
+#include <kernel/debug.h>
+#include <kernel/malloc.h>
+#include <kernel/syscall.h>
+#include <kernel/user.h>
+#include <kernel/vm.h>
+#include <sched/task.h>
+#include <fs/handle.h>
+#include <fs/ioring.h>
+#include <fs/iomode.h>
+#include <net/socket.h>
+#include <sys/socket.h>
+#include <sys/poll.h>
+#include <except.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+
+DECL_BEGIN
+
+INTDEF ATTR_NORETURN void KCALL
+throw_invalid_handle(fd_t fd, u16 reason, u16 istype, u16 rqtype, u16 rqkind);
+
+/* Check if an exception caught while processing a request must be
+ * propagated, rather than being reported as the request's result. */
+LOCAL bool KCALL ioring_must_propagate(except_t code) {
+ return ERRORCODE_ISRTLPRIORITY(code) || code == E_INTERRUPT;
+}
+
+PRIVATE ATTR_NOTHROW void KCALL
+ioring_req_free(struct ioring_req *__restrict self) {
+ if (self->rq_hnd.h_type != HANDLE_TYPE_FNONE)
+     handle_decref(self->rq_hnd);
+ if (self->rq_accept)
+     socket_decref(self->rq_accept);
+ kfree(self);
+}
+
+PRIVATE ATTR_NOTHROW void KCALL
+ioring_req_freelist(struct ioring_req *list) {
+ while (list) {
+  struct ioring_req *next = list->rq_next;
+  ioring_req_free(list);
+  list = next;
+ }
+}
+
+
+PUBLIC ATTR_NOTHROW void KCALL
+ioring_destroy(struct ioring *__restrict self) {
+ size_t i;
+ ioring_req_freelist(self->ir_pend);
+ ioring_req_freelist(self->ir_done);
+ for (i = 0; i < self->ir_nfiles; ++i)
+     handle_decref(self->ir_files[i]);
+ for (i = 0; i < self->ir_nthreads; ++i)
+     task_decref(self->ir_threads[i]);
+ kfree(self->ir_files);
+ kfree(self->ir_bufs);
+ kfree(self->ir_threads);
+ vm_decref(self->ir_vm);
+ kfree(self);
+}
+
+PRIVATE void KCALL ioring_exit_rpc(void *UNUSED(arg)) {
+ struct exception_info *reason;
+ reason = error_info();
+ reason->e_error.e_code = E_EXIT_THREAD;
+ reason->e_error.e_flag = ERR_FNORMAL;
+ memset(reason->e_error.e_pointers,0,sizeof(reason->e_error.e_pointers));
+ error_throw_current();
+}
+
+PUBLIC ATTR_NOTHROW void KCALL
+ioring_shutdown(struct ioring *__restrict self) {
+ u16 i,count;
+ atomic_rwlock_write(&self->ir_lock);
+ self->ir_flags |= IORING_FSHUTDOWN;
+ count = self->ir_nthreads;
+ atomic_rwlock_endwrite(&self->ir_lock);
+ /* Wake idle workers, and interrupt those blocking in an operation.
+  * NOTE: No new workers can be spawned once `IORING_FSHUTDOWN' is set. */
+ sig_broadcast(&self->ir_work);
+ for (i = 0; i < count; ++i) {
+  TRY {
+   task_queue_rpc(self->ir_threads[i],&ioring_exit_rpc,
+                  NULL,TASK_RPC_NORMAL);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   /* The worker will still notice `IORING_FSHUTDOWN'
+    * once its current operation has finished. */
+   error_handled();
+  }
+ }
+ /* Drop the weak reference shared by all regular references. */
+ ioring_weak_decref(self);
+}
+
+
+PUBLIC ATTR_RETNONNULL REF struct ioring *KCALL
+ioring_alloc(USER CHECKED struct ioring_params const *__restrict params) {
+ REF struct ioring *result;
+ USER CHECKED struct ioring_sq *sq;
+ USER CHECKED struct ioring_cq *cq;
+ u32 sq_entries,cq_entries,flags,workers;
+ sq_entries = params->ip_sq_entries;
+ cq_entries = params->ip_cq_entries;
+ flags      = params->ip_flags;
+ workers    = params->ip_workers;
+ sq         = params->ip_sq;
+ cq         = params->ip_cq;
+ COMPILER_READ_BARRIER();
+ if (!cq_entries)
+      cq_entries = sq_entries*2;
+ if (!sq_entries || sq_entries > IORING_MAX_ENTRIES ||
+     (sq_entries & (sq_entries-1)) || cq_entries < sq_entries ||
+      cq_entries > IORING_MAX_ENTRIES*2 || (cq_entries & (cq_entries-1)) ||
+     (flags & ~IORING_SETUP_FINLINE) || workers > IORING_MAX_WORKERS)
+      error_throw(E_INVALID_ARGUMENT);
+ if (!workers)
+      workers = IORING_DEFAULT_WORKERS;
+ validate_writable(sq,IORING_SQ_SIZEOF(sq_entries));
+ validate_writable(cq,IORING_CQ_SIZEOF(cq_entries));
+ /* Initialize the control words of both queues. */
+ sq->sq_head     = 0;
+ sq->sq_tail     = 0;
+ sq->sq_mask     = sq_entries-1;
+ sq->__sq_pad    = 0;
+ cq->cq_head     = 0;
+ cq->cq_tail     = 0;
+ cq->cq_mask     = cq_entries-1;
+ cq->cq_overflow = 0;
+ COMPILER_WRITE_BARRIER();
+
+ result = (REF struct ioring *)kmalloc(sizeof(struct ioring),
+                                      GFP_SHARED|GFP_CALLOC);
+ TRY {
+  result->ir_threads = (REF struct task **)kmalloc(workers*sizeof(REF struct task *),
+                                                   GFP_SHARED);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  kfree(result);
+  error_rethrow();
+ }
+ result->ir_refcnt     = 1;
+ result->ir_weakcnt    = 1;
+ result->ir_vm         = THIS_VM;
+ vm_incref(result->ir_vm);
+ result->ir_sq         = sq;
+ result->ir_cq         = cq;
+ result->ir_sqmask     = sq_entries-1;
+ result->ir_cqmask     = cq_entries-1;
+ result->ir_setup      = flags;
+ result->ir_maxthreads = (u16)workers;
+ result->ir_ppend      = &result->ir_pend;
+ result->ir_pdone      = &result->ir_done;
+ mutex_cinit(&result->ir_submit);
+ atomic_rwlock_cinit(&result->ir_lock);
+ sig_cinit(&result->ir_work);
+ sig_cinit(&result->ir_avail);
+ return result;
+}
+
+
+
+/* Add `req' to the queue of completed requests of `self'.
+ * The reference to the targeted handle is dropped now, so that
+ * closing it doesn't have to wait for user-space to reap the completion. */
+PRIVATE ATTR_NOTHROW void KCALL
+ioring_complete(struct ioring *__restrict self,
+                struct ioring_req *__restrict req) {
+ if (req->rq_hnd.h_type != HANDLE_TYPE_FNONE) {
+  handle_decref(req->rq_hnd);
+  req->rq_hnd.h_mode = HANDLE_MODE(HANDLE_TYPE_FNONE,0);
+ }
+ req->rq_next = NULL;
+ atomic_rwlock_write(&self->ir_lock);
+ *self->ir_pdone = req;
+ self->ir_pdone  = &req->rq_next;
+ ++self->ir_ndone;
+ atomic_rwlock_endwrite(&self->ir_lock);
+ sig_broadcast(&self->ir_avail);
+}
+
+
+/* Execute the operation described by `req'.
+ * @return: false: `can_block' is false, and the operation must be executed
+ *                  by a worker thread because it would block (or take long). */
+PRIVATE bool KCALL
+ioring_exec(struct ioring_req *__restrict req, bool can_block) {
+ USER CHECKED void *buf = (USER CHECKED void *)(uintptr_t)req->rq_sqe.sqe_addr;
+ size_t bufsize = (size_t)req->rq_sqe.sqe_len;
+ iomode_t mode = req->rq_mode;
+ if (!can_block) mode |= IO_NONBLOCK;
+ switch (req->rq_sqe.sqe_opcode) {
+
+ case IORING_OP_NOP:
+  req->rq_result = 0;
+  break;
+
+ case IORING_OP_READ:
+  if (req->rq_sqe.sqe_off == IORING_OFF_CURRENT)
+       req->rq_result = (s64)handle_readf(req->rq_hnd,buf,bufsize,mode);
+  else req->rq_result = (s64)handle_preadf(req->rq_hnd,buf,bufsize,(pos_t)req->rq_sqe.sqe_off,mode);
+  break;
+
+ case IORING_OP_WRITE:
+  if (req->rq_sqe.sqe_off == IORING_OFF_CURRENT)
+       req->rq_result = (s64)handle_writef(req->rq_hnd,buf,bufsize,mode);
+  else req->rq_result = (s64)handle_pwritef(req->rq_hnd,buf,bufsize,(pos_t)req->rq_sqe.sqe_off,mode);
+  break;
+
+ case IORING_OP_FSYNC:
+ case IORING_OP_FDATASYNC:
+  /* Synchronizing always has to wait for the underlying device. */
+  if (!can_block) return false;
+  handle_sync(req->rq_hnd,req->rq_sqe.sqe_opcode == IORING_OP_FDATASYNC);
+  req->rq_result = 0;
+  break;
+
+ case IORING_OP_POLL_ADD:
+ {
+  unsigned int mask;
+  for (;;) {
+   size_t num_connections = task_numconnected();
+   mask = handle_poll(req->rq_hnd,(unsigned int)req->rq_sqe.sqe_opflags);
+   if (mask) { task_disconnect(); break; }
+   if (num_connections == task_numconnected()) {
+    /* The handle doesn't support poll() (s.a. `xppoll()') */
+    mask = POLLNVAL;
+    break;
+   }
+   if (!can_block) {
+    task_disconnect();
+    return false;
+   }
+   task_wait();
+  }
+  req->rq_result = (s64)mask;
+ } break;
+
+ case IORING_OP_ACCEPT:
+  req->rq_accept = socket_accept(req->rq_hnd.h_object.o_socket,mode);
+  if (!req->rq_accept)
+       error_throw(E_WOULDBLOCK);
+  req->rq_result = 0;
+  break;
+
+ {
+  struct iovec iov[1];
+  size_t size;
+ case IORING_OP_RECV:
+  iov[0].iov_base = buf;
+  iov[0].iov_len  = bufsize;
+again_recv:
+  size = bufsize;
+  if (!socket_recv(req->rq_hnd.h_object.o_socket,iov,&size,
+                   mode|IO_NOIOVCHECK,req->rq_sqe.sqe_opflags))
+       size = 0;
+  else if (!size) goto again_recv; /* Ignore zero-length packets here. */
+  if (!(req->rq_sqe.sqe_opflags & MSG_TRUNC) && size > bufsize)
+        size = bufsize;
+  req->rq_result = (s64)size;
+  break;
+ case IORING_OP_SEND:
+  iov[0].iov_base = buf;
+  iov[0].iov_len  = bufsize;
+  req->rq_result = (s64)socket_send(req->rq_hnd.h_object.o_socket,iov,bufsize,
+                                    mode|IO_NOIOVCHECK,req->rq_sqe.sqe_opflags);
+ } break;
+
+ default: __builtin_unreachable();
+ }
+ return true;
+}
+
+/* Execute `req' and add it to the completion queue of `self'.
+ * @return: true:  The request has been completed (possibly with an error).
+ * @return: false: `can_block' is false, and the operation would block. */
+PRIVATE bool KCALL
+ioring_run(struct ioring *__restrict self,
+           struct ioring_req *__restrict req,
+           bool can_block) {
+ bool EXCEPT_VAR punt = false;
+ TRY {
+  punt = !ioring_exec(req,can_block);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  except_t code = error_code();
+  if (code == E_WOULDBLOCK && !can_block &&
+    !(req->rq_mode & IO_NONBLOCK)) {
+   /* Only the inline attempt was non-blocking. */
+   punt = true;
+  } else {
+   req->rq_error = code;
+   if (ioring_must_propagate(code)) {
+    ioring_complete(self,req);
+    error_rethrow();
+   }
+  }
+  error_handled();
+ }
+ if (punt) return false;
+ ioring_complete(self,req);
+ return true;
+}
+
+
+
+PRIVATE void KCALL ioring_worker_main(void *arg) {
+ struct ioring *self = (struct ioring *)arg;
+ TRY {
+  /* Switch to the VM of the ring's owner, so
+   * we can access the buffers of operations. */
+  task_setvm(self->ir_vm);
+  for (;;) {
+   struct ioring_req *req;
+   atomic_rwlock_write(&self->ir_lock);
+   if (self->ir_flags & IORING_FSHUTDOWN) {
+    atomic_rwlock_endwrite(&self->ir_lock);
+    break;
+   }
+   req = self->ir_pend;
+   if (req) {
+    if ((self->ir_pend = req->rq_next) == NULL)
+         self->ir_ppend = &self->ir_pend;
+    --self->ir_npend;
+    atomic_rwlock_endwrite(&self->ir_lock);
+    req->rq_flags |= IORING_CQE_FASYNC;
+    ioring_run(self,req,true);
+    continue;
+   }
+   atomic_rwlock_endwrite(&self->ir_lock);
+   /* Wait for more work to arrive. */
+   task_connect(&self->ir_work);
+   if (ATOMIC_READ(self->ir_pend) ||
+      (ATOMIC_READ(self->ir_flags) & IORING_FSHUTDOWN)) {
+    task_disconnect();
+    continue;
+   }
+   ATOMIC_FETCHINC(self->ir_idle);
+   TRY {
+    task_wait();
+   } FINALLY {
+    ATOMIC_FETCHDEC(self->ir_idle);
+   }
+  }
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  /* `E_EXIT_THREAD' is thrown by `ioring_shutdown()' */
+  if (error_code() != E_EXIT_THREAD)
+      error_printf("Unhandled exception in worker of I/O ring %p\n",self);
+  error_handled();
+ }
+ ioring_weak_decref(self);
+}
+
+/* Spawn a new worker thread for `self', unless
+ * the limit was reached, or the ring is shutting down. */
+PRIVATE void KCALL
+ioring_spawn_worker(struct ioring *__restrict self) {
+ REF struct task *EXCEPT_VAR worker;
+ worker = task_alloc();
+ TRY {
+  bool EXCEPT_VAR started = false;
+  task_setup_kernel(worker,&ioring_worker_main,self);
+  atomic_rwlock_write(&self->ir_lock);
+  if (self->ir_nthreads < self->ir_maxthreads &&
+    !(self->ir_flags & IORING_FSHUTDOWN)) {
+   /* The worker inherits this weak reference. */
+   ioring_weak_incref(self);
+   task_incref(worker);
+   self->ir_threads[self->ir_nthreads++] = worker;
+   started = true;
+  }
+  atomic_rwlock_endwrite(&self->ir_lock);
+  if (started) {
+   TRY {
+    task_start(worker);
+   } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+    size_t i;
+    /* The thread will never run (and drop its reference),
+     * so don't count it as a worker of the ring. */
+    atomic_rwlock_write(&self->ir_lock);
+    for (i = 0; i < self->ir_nthreads; ++i) {
+     if (self->ir_threads[i] != worker) continue;
+     self->ir_threads[i] = self->ir_threads[--self->ir_nthreads];
+     task_decref(worker);
+     break;
+    }
+    atomic_rwlock_endwrite(&self->ir_lock);
+    ioring_weak_decref(self);
+    error_rethrow();
+   }
+  }
+ } FINALLY {
+  if (FINALLY_WILL_RETHROW)
+      task_failed(worker);
+  task_decref(worker);
+ }
+}
+
+/* Hand `req' to the worker threads of `self'. */
+PRIVATE void KCALL
+ioring_queue(struct ioring *__restrict self,
+             struct ioring_req *__restrict req) {
+ bool spawn;
+ req->rq_next = NULL;
+ atomic_rwlock_write(&self->ir_lock);
+ *self->ir_ppend = req;
+ self->ir_ppend  = &req->rq_next;
+ ++self->ir_npend;
+ spawn = self->ir_npend > ATOMIC_READ(self->ir_idle) &&
+         self->ir_nthreads < self->ir_maxthreads;
+ atomic_rwlock_endwrite(&self->ir_lock);
+ sig_send(&self->ir_work,1);
+ /* Spawn workers lazily, when all existing ones are busy. */
+ if (spawn) {
+  TRY {
+   ioring_spawn_worker(self);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   struct ioring_req **piter;
+   bool orphaned = false;
+   /* So long as another worker exists, it will eventually get to `req'.
+    * Otherwise, nothing ever would, so take it back and fail it instead. */
+   atomic_rwlock_write(&self->ir_lock);
+   if (!self->ir_nthreads) {
+    for (piter = &self->ir_pend; *piter; piter = &(*piter)->rq_next) {
+     if (*piter != req) continue;
+     if ((*piter = req->rq_next) == NULL)
+          self->ir_ppend = piter;
+     --self->ir_npend;
+     orphaned = true;
+     break;
+    }
+   }
+   atomic_rwlock_endwrite(&self->ir_lock);
+   if (orphaned) {
+    req->rq_error = error_code();
+    ioring_complete(self,req);
+   }
+   /* Either way, `req' was submitted. - Like in `ioring_run()',
+    * only propagate interrupts and RTL-priority errors. */
+   if (ioring_must_propagate(error_code()))
+       error_rethrow();
+   error_handled();
+  }
+ }
+}
+
+
+
+/* Lookup the handle and validate the buffer of `req'.
+ * Since this is done while submitting, worker threads
+ * don't need access to the caller's handle manager. */
+PRIVATE void KCALL
+ioring_prepare(struct ioring *__restrict self,
+               struct ioring_req *__restrict req) {
+ u8 opcode = req->rq_sqe.sqe_opcode;
+ u8 flags  = req->rq_sqe.sqe_flags;
+ if (opcode >= IORING_OP_COUNT ||
+    (flags & ~(IORING_SQE_FFIXED_FILE|IORING_SQE_FFIXED_BUFFER|IORING_SQE_FASYNC)))
+     error_throw(E_INVALID_ARGUMENT);
+ if (opcode == IORING_OP_NOP)
+     return;
+
+ /* Lookup the targeted handle. */
+ if (flags & IORING_SQE_FFIXED_FILE) {
+  u32 index = (u32)req->rq_sqe.sqe_fd;
+  atomic_rwlock_read(&self->ir_lock);
+  if (index >= self->ir_nfiles) {
+   atomic_rwlock_endread(&self->ir_lock);
+   throw_invalid_handle(req->rq_sqe.sqe_fd,
+                        ERROR_INVALID_HANDLE_FUNDEFINED,
+                        HANDLE_TYPE_FNONE,HANDLE_TYPE_FNONE,
+                        ERROR_INVALID_HANDLE_ILLHND_FUNSET);
+  }
+  req->rq_hnd = self->ir_files[index];
+  handle_incref(req->rq_hnd);
+  atomic_rwlock_endread(&self->ir_lock);
+ } else {
+  req->rq_hnd = handle_get(req->rq_sqe.sqe_fd);
+  /* Don't allow rings to reference each other. */
+  if (req->rq_hnd.h_type == HANDLE_TYPE_FIORING)
+      throw_invalid_handle(req->rq_sqe.sqe_fd,
+                           ERROR_INVALID_HANDLE_FWRONGTYPE,
+                           HANDLE_TYPE_FIORING,HANDLE_TYPE_FNONE,0);
+ }
+ req->rq_mode = req->rq_hnd.h_flag;
+
+ switch (opcode) {
+ case IORING_OP_READ:
+  /* Check for read permissions. */
+  if ((req->rq_mode & IO_ACCMODE) == IO_WRONLY)
+       error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_ACCESS_ERROR);
+  break;
+ case IORING_OP_WRITE:
+  /* Check for write permissions. */
+  if ((req->rq_mode & IO_ACCMODE) == IO_RDONLY)
+       error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_ACCESS_ERROR);
+  break;
+ case IORING_OP_ACCEPT:
+  if (req->rq_sqe.sqe_opflags & ~(SOCK_NONBLOCK|SOCK_CLOEXEC|SOCK_CLOFORK))
+      error_throw(E_INVALID_ARGUMENT);
+  goto check_socket;
+ case IORING_OP_RECV:
+  if (req->rq_sqe.sqe_opflags & ~(MSG_DONTWAIT|MSG_ERRQUEUE|MSG_OOB|
+                                  MSG_PEEK|MSG_TRUNC|MSG_WAITALL))
+      error_throw(E_INVALID_ARGUMENT);
+  goto check_dontwait;
+ case IORING_OP_SEND:
+  if (req->rq_sqe.sqe_opflags & ~(MSG_CONFIRM|MSG_DONTROUTE|MSG_DONTWAIT|
+                                  MSG_EOR|MSG_MORE|MSG_NOSIGNAL|MSG_OOB))
+      error_throw(E_INVALID_ARGUMENT);
+check_dontwait:
+  if (req->rq_sqe.sqe_opflags & MSG_DONTWAIT) {
+   req->rq_sqe.sqe_opflags &= ~MSG_DONTWAIT;
+   req->rq_mode |= IO_NONBLOCK;
+  }
+check_socket:
+  if (req->rq_hnd.h_type != HANDLE_TYPE_FSOCKET)
+      throw_invalid_handle(req->rq_sqe.sqe_fd,
+                           ERROR_INVALID_HANDLE_FWRONGTYPE,
+                           req->rq_hnd.h_type,HANDLE_TYPE_FSOCKET,0);
+  break;
+ default: break;
+ }
+
+ /* Validate the I/O buffer. */
+ if (opcode == IORING_OP_READ || opcode == IORING_OP_WRITE ||
+     opcode == IORING_OP_RECV || opcode == IORING_OP_SEND) {
+  uintptr_t addr = (uintptr_t)req->rq_sqe.sqe_addr;
+  size_t size = (size_t)req->rq_sqe.sqe_len;
+#if __SIZEOF_POINTER__ < 8
+  if (req->rq_sqe.sqe_addr != (u64)addr)
+      error_throw(E_INVALID_ARGUMENT);
+#endif
+  if (flags & IORING_SQE_FFIXED_BUFFER) {
+   struct iovec *buf;
+   u16 index = req->rq_sqe.sqe_buf_index;
+   /* Registered buffers have already been validated. */
+   atomic_rwlock_read(&self->ir_lock);
+   if (index >= self->ir_nbufs) {
+    atomic_rwlock_endread(&self->ir_lock);
+    error_throw(E_INVALID_ARGUMENT);
+   }
+   buf = &self->ir_bufs[index];
+   if (addr < (uintptr_t)buf->iov_base ||
+       size > buf->iov_len - (addr-(uintptr_t)buf->iov_base)) {
+    atomic_rwlock_endread(&self->ir_lock);
+    error_throw(E_INVALID_ARGUMENT);
+   }
+   atomic_rwlock_endread(&self->ir_lock);
+  } else if (opcode == IORING_OP_READ || opcode == IORING_OP_RECV) {
+   validate_writable((USER UNCHECKED void *)addr,size);
+  } else {
+   validate_readable((USER UNCHECKED void const *)addr,size);
+  }
+ }
+}
+
+/* Prepare `req' and try to execute it inline.
+ * If it would block, hand it to a worker thread. */
+PRIVATE void KCALL
+ioring_start(struct ioring *__restrict self,
+             struct ioring_req *__restrict req) {
+ bool EXCEPT_VAR ok = false;
+ TRY {
+  ioring_prepare(self,req);
+  ok = true;
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  req->rq_error = error_code();
+  if (ioring_must_propagate(req->rq_error)) {
+   ioring_complete(self,req);
+   error_rethrow();
+  }
+  error_handled();
+ }
+ if (!ok) {
+  /* Malformed entries are completed with the error. */
+  ioring_complete(self,req);
+  return;
+ }
+ if (self->ir_setup & IORING_SETUP_FINLINE) {
+  ioring_run(self,req,true);
+  return;
+ }
+ if (!(req->rq_sqe.sqe_flags & IORING_SQE_FASYNC) &&
+       ioring_run(self,req,false))
+       return;
+ ioring_queue(self,req);
+}
+
+PUBLIC size_t KCALL
+ioring_submit(struct ioring *__restrict self, size_t max_submit) {
+ size_t EXCEPT_VAR result = 0;
+ USER CHECKED struct ioring_sq *sq = self->ir_sq;
+ u32 tail;
+ assert(mutex_holding(&self->ir_submit));
+ tail = ATOMIC_READ(sq->sq_tail);
+ COMPILER_READ_BARRIER();
+ TRY {
+  while (result < max_submit && self->ir_sqhead != tail) {
+   struct ioring_req *EXCEPT_VAR req;
+   /* Limit the number of operations in flight, since each
+    * of them needs a completion that has to be stored somewhere. */
+   if (ATOMIC_READ(self->ir_inflight) >= ((size_t)self->ir_cqmask+1)*2)
+       break;
+   req = (struct ioring_req *)kmalloc(sizeof(struct ioring_req),
+                                      GFP_SHARED|GFP_CALLOC);
+   TRY {
+    memcpy(&req->rq_sqe,&sq->sq_entries[self->ir_sqhead & self->ir_sqmask],
+            sizeof(struct ioring_sqe)); /* CAUTION: SEGFAULT */
+   } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+    kfree(req);
+    error_rethrow();
+   }
+   ++self->ir_sqhead;
+   ++result;
+   ATOMIC_FETCHINC(self->ir_inflight);
+   ioring_start(self,req);
+  }
+ } FINALLY {
+  /* Let user-space know which entries can be re-used. */
+  TRY {
+   ATOMIC_WRITE(sq->sq_head,self->ir_sqhead);
+  } CATCH_HANDLED (E_SEGFAULT) {
+  }
+ }
+ return result;
+}
+
+
+/* Add the connection accepted by `req' to the calling thread's handle manager. */
+PRIVATE void KCALL
+ioring_install(struct ioring_req *__restrict req) {
+ struct handle hresult;
+ u32 flags = req->rq_sqe.sqe_opflags;
+ hresult.h_mode = HANDLE_MODE(HANDLE_TYPE_FSOCKET,IO_RDWR);
+ if (flags & SOCK_NONBLOCK) hresult.h_flag |= IO_NONBLOCK;
+ if (flags & SOCK_CLOEXEC)  hresult.h_flag |= IO_HANDLE_FCLOEXEC;
+ if (flags & SOCK_CLOFORK)  hresult.h_flag |= IO_HANDLE_FCLOFORK;
+ hresult.h_object.o_socket = req->rq_accept;
+ TRY {
+  req->rq_result = (s64)handle_put(hresult);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  if (ioring_must_propagate(error_code()))
+      error_rethrow();
+  req->rq_error = error_code();
+  error_handled();
+ }
+ socket_decref(req->rq_accept);
+ req->rq_accept = NULL;
+}
+
+PUBLIC size_t KCALL
+ioring_flush(struct ioring *__restrict self) {
+ size_t EXCEPT_VAR result = 0;
+ USER CHECKED struct ioring_cq *cq = self->ir_cq;
+ u32 size = self->ir_cqmask+1,used;
+ assert(mutex_holding(&self->ir_submit));
+ used = self->ir_cqtail - ATOMIC_READ(cq->cq_head);
+ if unlikely(used > size)
+    used = size; /* Corrupted by user-space. */
+ TRY {
+  while (used < size) {
+   struct ioring_req *EXCEPT_VAR req;
+   USER CHECKED struct ioring_cqe *cqe;
+   atomic_rwlock_write(&self->ir_lock);
+   req = self->ir_done;
+   if (!req) {
+    atomic_rwlock_endwrite(&self->ir_lock);
+    break;
+   }
+   if ((self->ir_done = req->rq_next) == NULL)
+        self->ir_pdone = &self->ir_done;
+   --self->ir_ndone;
+   atomic_rwlock_endwrite(&self->ir_lock);
+   TRY {
+    if (req->rq_accept)
+        ioring_install(req);
+    cqe = &cq->cq_entries[self->ir_cqtail & self->ir_cqmask];
+    cqe->cqe_data   = req->rq_sqe.sqe_data; /* CAUTION: SEGFAULT */
+    cqe->cqe_result = req->rq_error == E_OK ? req->rq_result : 0;
+    cqe->cqe_error  = req->rq_error;
+    cqe->cqe_flags  = req->rq_flags;
+    cqe->__cqe_pad  = 0;
+   } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+    /* Put the completion back, so it doesn't get lost. */
+    atomic_rwlock_write(&self->ir_lock);
+    if ((req->rq_next = self->ir_done) == NULL)
+         self->ir_pdone = &req->rq_next;
+    self->ir_done = req;
+    ++self->ir_ndone;
+    atomic_rwlock_endwrite(&self->ir_lock);
+    error_rethrow();
+   }
+   ioring_req_free(req);
+   ATOMIC_FETCHDEC(self->ir_inflight);
+   ++self->ir_cqtail;
+   ++used;
+   ++result;
+  }
+ } FINALLY {
+  /* Publish the new completions. */
+  TRY {
+   COMPILER_WRITE_BARRIER();
+   ATOMIC_WRITE(cq->cq_tail,self->ir_cqtail);
+   cq->cq_overflow = (u32)ATOMIC_READ(self->ir_ndone);
+  } CATCH_HANDLED (E_SEGFAULT) {
+  }
+ }
+ return result;
+}
+
+
+
+/* I/O ring handle operators. */
+INTERN unsigned int KCALL
+handle_ioring_poll(struct ioring *__restrict self,
+                   unsigned int mode) {
+ if (!(mode & POLLIN))
+       return 0;
+ /* Signal completions that haven't been written to the CQ, yet. */
+ if (ATOMIC_READ(self->ir_ndone))
+     return POLLIN;
+ task_connect_ghost(&self->ir_avail);
+ if (ATOMIC_READ(self->ir_ndone))
+     return POLLIN;
+ return 0;
+}
+
+
+
+PRIVATE void KCALL
+ioring_register_buffers(struct ioring *__restrict self,
+                        USER UNCHECKED struct iovec const *iov,
+                        size_t count) {
+ struct iovec *EXCEPT_VAR vec; size_t i;
+ if (!count || count > IORING_MAX_REGISTER)
+      error_throw(E_INVALID_ARGUMENT);
+ validate_readablem(iov,count,sizeof(struct iovec));
+ vec = (struct iovec *)kmalloc(count*sizeof(struct iovec),GFP_SHARED);
+ TRY {
+  memcpy(vec,iov,count*sizeof(struct iovec));
+  COMPILER_READ_BARRIER();
+  /* Validate the buffers once, so operations using them don't have to. */
+  for (i = 0; i < count; ++i)
+      validate_writable(vec[i].iov_base,vec[i].iov_len);
+  atomic_rwlock_write(&self->ir_lock);
+  if (self->ir_bufs) {
+   atomic_rwlock_endwrite(&self->ir_lock);
+   error_throw(E_INVALID_ARGUMENT);
+  }
+  self->ir_bufs  = vec;
+  self->ir_nbufs = count;
+  atomic_rwlock_endwrite(&self->ir_lock);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  kfree(vec);
+  error_rethrow();
+ }
+}
+
+PRIVATE void KCALL
+ioring_register_files(struct ioring *__restrict self,
+                      USER UNCHECKED fd_t const *fds,
+                      size_t count) {
+ REF struct handle *EXCEPT_VAR vec;
+ size_t EXCEPT_VAR i = 0;
+ if (!count || count > IORING_MAX_REGISTER)
+      error_throw(E_INVALID_ARGUMENT);
+ validate_readablem(fds,count,sizeof(fd_t));
+ vec = (REF struct handle *)kmalloc(count*sizeof(struct handle),GFP_SHARED);
+ TRY {
+  for (; i < count; ++i) {
+   fd_t fd = fds[i];
+   COMPILER_READ_BARRIER();
+   vec[i] = handle_get(fd);
+   if (vec[i].h_type == HANDLE_TYPE_FIORING) {
+    handle_decref(vec[i]);
+    throw_invalid_handle(fd,ERROR_INVALID_HANDLE_FWRONGTYPE,
+                         HANDLE_TYPE_FIORING,HANDLE_TYPE_FNONE,0);
+   }
+  }
+  atomic_rwlock_write(&self->ir_lock);
+  if (self->ir_files) {
+   atomic_rwlock_endwrite(&self->ir_lock);
+   error_throw(E_INVALID_ARGUMENT);
+  }
+  self->ir_files  = vec;
+  self->ir_nfiles = count;
+  atomic_rwlock_endwrite(&self->ir_lock);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  while (i--) handle_decref(vec[i]);
+  kfree(vec);
+  error_rethrow();
+ }
+}
+
+PRIVATE void KCALL
+ioring_unregister_buffers(struct ioring *__restrict self) {
+ struct iovec *vec;
+ atomic_rwlock_write(&self->ir_lock);
+ vec = self->ir_bufs;
+ self->ir_bufs  = NULL;
+ self->ir_nbufs = 0;
+ atomic_rwlock_endwrite(&self->ir_lock);
+ if (!vec) error_throw(E_INVALID_ARGUMENT);
+ kfree(vec);
+}
+
+PRIVATE void KCALL
+ioring_unregister_files(struct ioring *__restrict self) {
+ REF struct handle *vec; size_t count;
+ atomic_rwlock_write(&self->ir_lock);
+ vec   = self->ir_files;
+ count = self->ir_nfiles;
+ self->ir_files  = NULL;
+ self->ir_nfiles = 0;
+ atomic_rwlock_endwrite(&self->ir_lock);
+ if (!vec) error_throw(E_INVALID_ARGUMENT);
+ /* In-flight operations hold their own references. */
+ while (count--) handle_decref(vec[count]);
+ kfree(vec);
+}
+
+
+
+DEFINE_SYSCALL2(xioring_setup,
+                USER UNCHECKED struct ioring_params const *,params,
+                oflag_t,flags) {
+ unsigned int COMPILER_IGNORE_UNINITIALIZED(result);
+ struct handle EXCEPT_VAR hresult;
+ if (flags & ~(O_CLOEXEC|O_CLOFORK))
+     error_throw(E_INVALID_ARGUMENT);
+ validate_readable(params,sizeof(struct ioring_params));
+ hresult.h_mode = HANDLE_MODE(HANDLE_TYPE_FIORING,
+                              IO_FROM_O(flags|O_RDWR));
+ hresult.h_object.o_ioring = ioring_alloc(params);
+ TRY {
+  /* Save the new ring in the handle manager. */
+  result = handle_put(hresult);
+ } FINALLY {
+  ioring_decref(hresult.h_object.o_ioring);
+ }
+ return result;
+}
+
+DEFINE_SYSCALL_DONTRESTART(xioring_enter);
+DEFINE_SYSCALL4(xioring_enter,fd_t,fd,
+                unsigned int,to_submit,
+                unsigned int,min_complete,
+                unsigned int,flags) {
+ REF struct ioring *EXCEPT_VAR ring;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ if (flags & ~IORING_ENTER_FGETEVENTS)
+     error_throw(E_INVALID_ARGUMENT);
+ ring = handle_get_ioring(fd);
+ TRY {
+  /* The SQ and CQ are only mapped in the VM that created the ring. */
+  if (ring->ir_vm != THIS_VM)
+      error_throw(E_ILLEGAL_OPERATION);
+  mutex_get(&ring->ir_submit);
+  TRY {
+   result = ioring_submit(ring,to_submit);
+   ioring_flush(ring);
+  } FINALLY {
+   mutex_put(&ring->ir_submit);
+  }
+  if (flags & IORING_ENTER_FGETEVENTS) {
+   USER CHECKED struct ioring_cq *cq = ring->ir_cq;
+   if (min_complete > ring->ir_cqmask+1)
+       min_complete = ring->ir_cqmask+1;
+   for (;;) {
+    u32 avail = ATOMIC_READ(ring->ir_cqtail) - ATOMIC_READ(cq->cq_head);
+    if (avail >= min_complete) break;
+    task_connect(&ring->ir_avail);
+    if (!ATOMIC_READ(ring->ir_ndone)) {
+     /* Don't wait if nothing is left in flight. */
+     if (!ATOMIC_READ(ring->ir_inflight)) {
+      task_disconnect();
+      break;
+     }
+     task_wait();
+    } else {
+     task_disconnect();
+    }
+    mutex_get(&ring->ir_submit);
+    TRY {
+     ioring_flush(ring);
+    } FINALLY {
+     mutex_put(&ring->ir_submit);
+    }
+   }
+  }
+ } FINALLY {
+  ioring_decref(ring);
+ }
+ return result;
+}
+
+DEFINE_SYSCALL4(xioring_register,fd_t,fd,
+                unsigned int,opcode,
+                USER UNCHECKED void *,arg,
+                unsigned int,nr_args) {
+ REF struct ioring *EXCEPT_VAR ring;
+ ring = handle_get_ioring(fd);
+ TRY {
+  if (ring->ir_vm != THIS_VM)
+      error_throw(E_ILLEGAL_OPERATION);
+  switch (opcode) {
+  case IORING_REGISTER_BUFFERS:
+   ioring_register_buffers(ring,(USER UNCHECKED struct iovec const *)arg,nr_args);
+   break;
+  case IORING_UNREGISTER_BUFFERS:
+   ioring_unregister_buffers(ring);
+   break;
+  case IORING_REGISTER_FILES:
+   ioring_register_files(ring,(USER UNCHECKED fd_t const *)arg,nr_args);
+   break;
+  case IORING_UNREGISTER_FILES:
+   ioring_unregister_files(ring);
+   break;
+  default:
+   error_throw(E_INVALID_ARGUMENT);
+  }
+ } FINALLY {
+  ioring_decref(ring);
+ }
+ return 0;
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_SRC_FS_IORING_C */
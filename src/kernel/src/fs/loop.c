@@ -0,0 +1,576 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_SRC_FS_LOOP_C
+#define GUARD_KERNEL_SRC_FS_LOOP_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/limits.h>
+#include <kos/types.h>
+#include <kos/kdev_t.h>
+#include <kernel/user.h>
+#include <fs/driver.h>
+#include <fs/device.h>
+#include <fs/handle.h>
+#include <fs/file.h>
+#include <fs/node.h>
+#include <fs/loop.h>
+#include <linux/loop.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <except.h>
+#include <assert.h>
+
+DECL_BEGIN
+
+#define throw_fs_error(fs_error_code) \
+        __EXCEPT_INVOKE_THROW_NORETURN(throw_fs_error(fs_error_code))
+PRIVATE __EXCEPT_NORETURN void
+(KCALL throw_fs_error)(u16 fs_error_code) {
+ struct exception_info *info;
+ info = error_info();
+ memset(info->e_error.e_pointers,0,sizeof(info->e_error.e_pointers));
+ info->e_error.e_code                        = E_FILESYSTEM_ERROR;
+ info->e_error.e_flag                        = ERR_FNORMAL;
+ info->e_error.e_filesystem_error.fs_errcode = fs_error_code;
+ error_throw_current();
+ __builtin_unreachable();
+}
+
+#define LOOP_ISLOOP(x) \
+   ((x)->b_master == (x) && \
+   ((x)->b_device.d_flags & DEVICE_BLOCK_FLINEAR) && \
+    (void *)(x)->b_io.io_linear.l_read == (void *)&Loop_Read)
+
+/* Returns the number of bytes that may be accessed at `pos',
+ * limiting `num_bytes' to the end of the device. */
+LOCAL size_t KCALL
+Loop_Clamp(struct loop_device *__restrict self,
+           size_t num_bytes, pos_t pos) {
+ pos_t size = (pos_t)self->ld_dev.b_blockcount*
+                     self->ld_dev.b_blocksize;
+ if unlikely(pos >= size) return 0;
+ if (num_bytes > size-pos)
+     num_bytes = (size_t)(size-pos);
+ return num_bytes;
+}
+
+/* Linear I/O operators: forward to the backing INode (or block device)
+ * directly. Since there is no intermediate `block_pages' buffer, data
+ * is only ever cached once (by the backing filesystem). */
+PRIVATE size_t KCALL
+Loop_Read(struct loop_device *__restrict self,
+          CHECKED USER void *buf, size_t num_bytes,
+          pos_t pos, iomode_t mode) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+again:
+ rwlock_read(&self->ld_lock);
+ TRY {
+  result = Loop_Clamp(self,num_bytes,pos);
+  if (result) {
+   if (self->ld_bdev) {
+    result = block_device_read(self->ld_bdev,buf,result,
+                               self->ld_offset+pos,mode);
+   } else if (self->ld_node) {
+    result = inode_read(self->ld_node,buf,result,
+                        self->ld_offset+pos,mode);
+   } else {
+    result = 0;
+   }
+  }
+ } FINALLY {
+  if (rwlock_endread(&xself->ld_lock))
+      goto again;
+ }
+ return result;
+}
+
+PRIVATE size_t KCALL
+Loop_Write(struct loop_device *__restrict self,
+           CHECKED USER void const *buf, size_t num_bytes,
+           pos_t pos, iomode_t mode) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+again:
+ rwlock_read(&self->ld_lock);
+ TRY {
+  result = Loop_Clamp(self,num_bytes,pos);
+  if (result) {
+   if (self->ld_bdev) {
+    result = block_device_write(self->ld_bdev,buf,result,
+                                self->ld_offset+pos,mode);
+   } else if (self->ld_node) {
+    result = inode_write(self->ld_node,buf,result,
+                         self->ld_offset+pos,mode);
+   } else {
+    result = 0;
+   }
+  }
+ } FINALLY {
+  if (rwlock_endread(&xself->ld_lock))
+      goto again;
+ }
+ return result;
+}
+
+PRIVATE void KCALL
+Loop_Sync(struct loop_device *__restrict self) {
+ struct loop_device *EXCEPT_VAR xself = self;
+again:
+ rwlock_read(&self->ld_lock);
+ TRY {
+  if (self->ld_bdev)
+      block_device_sync(self->ld_bdev);
+  else if (self->ld_node)
+      inode_sync(self->ld_node,true);
+ } FINALLY {
+  if (rwlock_endread(&xself->ld_lock))
+      goto again;
+ }
+}
+
+PRIVATE ATTR_NOTHROW void KCALL
+Loop_ClearBinding(struct loop_device *__restrict self) {
+ if (self->ld_bdev)
+     block_device_decref(self->ld_bdev);
+ if (self->ld_node)
+     inode_decref(self->ld_node);
+ self->ld_bdev   = NULL;
+ self->ld_node   = NULL;
+ self->ld_offset = 0;
+ self->ld_limit  = 0;
+ self->ld_flags  = 0;
+ self->ld_dev.b_blockcount = 0;
+}
+
+PRIVATE void KCALL
+Loop_Fini(struct loop_device *__restrict self) {
+ Loop_ClearBinding(self);
+}
+
+/* Check if a filesystem is mounted on `self'.
+ * While that is the case, the binding mustn't change. */
+PRIVATE bool KCALL
+Loop_IsMounted(struct loop_device *__restrict self) {
+ bool result;
+ atomic_rwlock_read(&self->ld_dev.b_fslock);
+ result = self->ld_dev.b_filesystem != NULL;
+ atomic_rwlock_endread(&self->ld_dev.b_fslock);
+ return result;
+}
+
+/* Re-calculate `b_blockcount' from the size of the backing file.
+ * [locked(WRITE(self->ld_lock))] */
+PRIVATE void KCALL
+Loop_UpdateSize(struct loop_device *__restrict self) {
+ pos_t size;
+ if (self->ld_bdev) {
+  size = (pos_t)self->ld_bdev->b_blockcount*
+                self->ld_bdev->b_blocksize;
+ } else if (self->ld_node) {
+  inode_loadattr(self->ld_node);
+  size = ATOMIC_READ(self->ld_node->i_attr.a_size);
+ } else {
+  size = 0;
+ }
+ if (size <= self->ld_offset)
+  size = 0;
+ else {
+  size -= self->ld_offset;
+ }
+ if (self->ld_limit && size > self->ld_limit)
+     size = self->ld_limit;
+ /* Block sizes are always powers of 2 (don't do a 64-bit division). */
+ self->ld_dev.b_blockcount = (blkcnt_t)(size >> __builtin_ctz((unsigned int)
+                                                self->ld_dev.b_blocksize));
+}
+
+
+PUBLIC void KCALL
+loop_bind(struct loop_device *__restrict self,
+          struct inode *__restrict node,
+          pos_t offset, pos_t limit, u32 flags) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ REF struct block_device *EXCEPT_VAR bdev = NULL;
+ if (S_ISBLK(node->i_attr.a_mode)) {
+  bdev = lookup_block_device(node->i_attr.a_rdev);
+  /* Don't allow a loop device to be bound to itself. */
+  if unlikely(bdev->b_master == &self->ld_dev) {
+   block_device_decref(bdev);
+   error_throw(E_INVALID_ARGUMENT);
+  }
+ } else if (!S_ISREG(node->i_attr.a_mode)) {
+  error_throw(E_INVALID_ARGUMENT);
+ }
+ TRY {
+  rwlock_write(&self->ld_lock);
+  TRY {
+   if (self->ld_node || Loop_IsMounted(self))
+       throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+   inode_incref(node);
+   self->ld_node   = node;
+   self->ld_bdev   = bdev;
+   bdev            = NULL;
+   self->ld_offset = offset;
+   self->ld_limit  = limit;
+   self->ld_flags  = flags & (LO_FLAGS_READ_ONLY|LO_FLAGS_AUTOCLEAR);
+   TRY {
+    Loop_UpdateSize(self);
+   } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+    Loop_ClearBinding(xself);
+    error_rethrow();
+   }
+   if (flags & LO_FLAGS_READ_ONLY) {
+    ATOMIC_FETCHOR(self->ld_dev.b_device.d_flags,DEVICE_FREADONLY);
+   } else {
+    ATOMIC_FETCHAND(self->ld_dev.b_device.d_flags,~DEVICE_FREADONLY);
+   }
+  } FINALLY {
+   rwlock_endwrite(&xself->ld_lock);
+  }
+ } FINALLY {
+  if (bdev)
+      block_device_decref(bdev);
+ }
+}
+
+PUBLIC void KCALL
+loop_unbind(struct loop_device *__restrict self) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ rwlock_write(&self->ld_lock);
+ TRY {
+  if (Loop_IsMounted(self))
+      throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+  Loop_ClearBinding(self);
+ } FINALLY {
+  rwlock_endwrite(&xself->ld_lock);
+ }
+}
+
+
+PRIVATE void KCALL
+Loop_SetFd(struct loop_device *__restrict self, fd_t fd) {
+ REF struct inode *EXCEPT_VAR node;
+ struct handle hnd = handle_get(fd);
+ u32 flags = 0;
+ if ((hnd.h_flag & IO_ACCMODE) == IO_RDONLY)
+      flags |= LO_FLAGS_READ_ONLY;
+ if (hnd.h_type == HANDLE_TYPE_FINODE) {
+  node = hnd.h_object.o_inode;
+ } else if (hnd.h_type == HANDLE_TYPE_FFILE) {
+  node = hnd.h_object.o_file->f_node;
+  inode_incref(node);
+  handle_decref(hnd);
+ } else {
+  handle_decref(hnd);
+  node = handle_get_inode(fd);
+ }
+ TRY {
+  loop_bind(self,node,0,0,flags);
+ } FINALLY {
+  inode_decref(node);
+ }
+}
+
+PRIVATE void KCALL
+Loop_GetStatus(struct loop_device *__restrict self,
+               USER CHECKED struct loop_info64 *info) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ struct loop_info64 result;
+ memset(&result,0,sizeof(struct loop_info64));
+again:
+ rwlock_read(&self->ld_lock);
+ TRY {
+  if (!self->ld_node)
+       error_throw(E_NO_DATA);
+  result.lo_device    = self->ld_node->i_super->s_device->b_device.d_devno;
+  result.lo_inode     = self->ld_node->i_attr.a_ino;
+  result.lo_rdevice   = self->ld_dev.b_device.d_devno;
+  result.lo_offset    = self->ld_offset;
+  result.lo_sizelimit = self->ld_limit;
+  result.lo_number    = self->ld_number;
+  result.lo_flags     = self->ld_flags;
+  if (ATOMIC_READ(self->ld_dev.b_device.d_flags) & DEVICE_FREADONLY)
+      result.lo_flags |= LO_FLAGS_READ_ONLY;
+ } FINALLY {
+  if (rwlock_endread(&xself->ld_lock))
+      goto again;
+ }
+ memcpy(info,&result,sizeof(struct loop_info64));
+}
+
+PRIVATE void KCALL
+Loop_SetStatus(struct loop_device *__restrict self,
+               USER CHECKED struct loop_info64 const *info) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ pos_t EXCEPT_VAR old_offset;
+ pos_t EXCEPT_VAR old_limit;
+ struct loop_info64 status;
+ memcpy(&status,info,sizeof(struct loop_info64));
+ if (status.lo_encrypt_type || status.lo_encrypt_key_size)
+     error_throw(E_INVALID_ARGUMENT);
+ rwlock_write(&self->ld_lock);
+ TRY {
+  if (!self->ld_node)
+       error_throw(E_NO_DATA);
+  if (status.lo_offset   != self->ld_offset ||
+      status.lo_sizelimit != self->ld_limit) {
+   /* Changing the mapping is only allowed while nothing is mounted. */
+   if (Loop_IsMounted(self))
+       throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+   old_offset      = self->ld_offset;
+   old_limit       = self->ld_limit;
+   self->ld_offset = status.lo_offset;
+   self->ld_limit  = status.lo_sizelimit;
+   TRY {
+    Loop_UpdateSize(self);
+   } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+    xself->ld_offset = old_offset;
+    xself->ld_limit  = old_limit;
+    error_rethrow();
+   }
+  }
+  /* Like linux, only the auto-clear flag can be changed. */
+  self->ld_flags &= ~LO_FLAGS_AUTOCLEAR;
+  self->ld_flags |= status.lo_flags & LO_FLAGS_AUTOCLEAR;
+ } FINALLY {
+  rwlock_endwrite(&xself->ld_lock);
+ }
+}
+
+PRIVATE void KCALL
+Loop_SetBlockSize(struct loop_device *__restrict self,
+                  unsigned long new_size) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ if (new_size < LOOP_DEFAULT_BLOCKSIZE || new_size > PAGESIZE ||
+    (new_size & (new_size-1)) != 0)
+     error_throw(E_INVALID_ARGUMENT);
+ rwlock_write(&self->ld_lock);
+ TRY {
+  if (Loop_IsMounted(self))
+      throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+  self->ld_dev.b_blocksize = (blksize_t)new_size;
+  Loop_UpdateSize(self);
+ } FINALLY {
+  rwlock_endwrite(&xself->ld_lock);
+ }
+}
+
+PRIVATE ssize_t KCALL
+Loop_Ioctl(struct loop_device *__restrict self,
+           unsigned long cmd, USER UNCHECKED void *arg,
+           iomode_t UNUSED(flags)) {
+ struct loop_device *EXCEPT_VAR xself = self;
+ switch (cmd) {
+
+ case LOOP_SET_FD:
+  Loop_SetFd(self,(fd_t)(uintptr_t)arg);
+  break;
+
+ case LOOP_CLR_FD:
+  loop_unbind(self);
+  break;
+
+ case LOOP_GET_STATUS64:
+  validate_writable(arg,sizeof(struct loop_info64));
+  Loop_GetStatus(self,(struct loop_info64 *)arg);
+  break;
+
+ case LOOP_SET_STATUS64:
+  validate_readable(arg,sizeof(struct loop_info64));
+  Loop_SetStatus(self,(struct loop_info64 *)arg);
+  break;
+
+ case LOOP_SET_CAPACITY:
+  rwlock_write(&self->ld_lock);
+  TRY {
+   Loop_UpdateSize(self);
+  } FINALLY {
+   rwlock_endwrite(&xself->ld_lock);
+  }
+  break;
+
+ case LOOP_SET_BLOCK_SIZE:
+  Loop_SetBlockSize(self,(unsigned long)arg);
+  break;
+
+ default:
+  error_throw(E_NOT_IMPLEMENTED);
+ }
+ return 0;
+}
+
+
+/* Allocate a new, unbound loop device. */
+PRIVATE ATTR_RETNONNULL REF struct loop_device *KCALL
+loop_alloc(u32 number) {
+ REF struct loop_device *result;
+ result = BLOCK_DEVICE_ALLOC(struct loop_device,0);
+ result->ld_dev.b_device.d_flags |= DEVICE_BLOCK_FLINEAR;
+ result->ld_dev.b_io.io_linear.l_read  = (size_t(KCALL *)(struct block_device *__restrict,CHECKED USER void *,size_t,pos_t,iomode_t))&Loop_Read;
+ result->ld_dev.b_io.io_linear.l_write = (size_t(KCALL *)(struct block_device *__restrict,CHECKED USER void const *,size_t,pos_t,iomode_t))&Loop_Write;
+ result->ld_dev.b_io.io_fini  = (void(KCALL *)(struct block_device *__restrict))&Loop_Fini;
+ result->ld_dev.b_io.io_sync  = (void(KCALL *)(struct block_device *__restrict))&Loop_Sync;
+ result->ld_dev.b_io.io_ioctl = (ssize_t(KCALL *)(struct block_device *__restrict,unsigned long,USER UNCHECKED void *,iomode_t))&Loop_Ioctl;
+ result->ld_dev.b_blocksize   = LOOP_DEFAULT_BLOCKSIZE;
+ result->ld_dev.b_blockcount  = 0;
+ result->ld_number            = number;
+ rwlock_cinit(&result->ld_lock);
+ return result;
+}
+
+PUBLIC ATTR_RETNONNULL REF struct block_device *KCALL
+loop_open_anonymous(struct inode *__restrict node, bool read_only) {
+ REF struct loop_device *EXCEPT_VAR result;
+ result = loop_alloc((u32)-1);
+ TRY {
+  result->ld_dev.b_device.d_devno  = devno_alloc(DEVICE_TYPE_FBLOCKDEV,1);
+  result->ld_dev.b_device.d_flags |= DEVICE_FDYNDEVICE;
+  device_setnamef(&result->ld_dev.b_device,"loop:%I64x",
+                 (u64)node->i_attr.a_ino);
+  loop_bind(result,node,0,0,read_only ? LO_FLAGS_READ_ONLY|LO_FLAGS_AUTOCLEAR
+                                      : LO_FLAGS_AUTOCLEAR);
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  block_device_decref(&result->ld_dev);
+  error_rethrow();
+ }
+ /* The device isn't registered, meaning that the superblock mounted
+  * on it holds its only reference. Once that goes away, so does the
+  * binding (which is what `LO_FLAGS_AUTOCLEAR' would do on linux). */
+ return &result->ld_dev;
+}
+
+PRIVATE REF struct loop_device *KCALL
+loop_trylookup(u32 number) {
+ REF struct block_device *result;
+ result = try_lookup_block_device(MKDEV(LOOP_MAJOR,number));
+ if (result && !LOOP_ISLOOP(result)) {
+  block_device_decref(result);
+  result = NULL;
+ }
+ return (REF struct loop_device *)result;
+}
+
+PUBLIC ATTR_RETNONNULL REF struct loop_device *KCALL
+loop_lookup(u32 number, bool create) {
+ REF struct loop_device *EXCEPT_VAR result;
+ if unlikely(number >= CONFIG_LOOP_MAXDEVICES)
+    goto nodev;
+again:
+ result = loop_trylookup(number);
+ if (result) return result;
+ if (!create) goto nodev;
+ result = loop_alloc(number);
+ TRY {
+  result->ld_dev.b_device.d_devno = MKDEV(LOOP_MAJOR,number);
+  device_setnamef(&result->ld_dev.b_device,"loop%u",number);
+  if unlikely(!register_device(&result->ld_dev.b_device)) {
+   /* Someone else created it first. */
+   block_device_decref(&result->ld_dev);
+   goto again;
+  }
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  block_device_decref(&result->ld_dev);
+  error_rethrow();
+ }
+ return result;
+nodev:
+ error_throwf(E_NO_DEVICE,ERROR_NO_DEVICE_FBLOCKDEV,
+              MKDEV(LOOP_MAJOR,number));
+}
+
+
+/* `/dev/loop-control' */
+PRIVATE ssize_t KCALL
+LoopControl_Ioctl(struct character_device *__restrict UNUSED(self),
+                  unsigned long cmd, USER UNCHECKED void *arg,
+                  iomode_t UNUSED(flags)) {
+ REF struct loop_device *EXCEPT_VAR dev;
+ u32 number = (u32)(uintptr_t)arg;
+ switch (cmd) {
+
+ case LOOP_CTL_ADD:
+  if unlikely(number >= CONFIG_LOOP_MAXDEVICES)
+     error_throw(E_INVALID_ARGUMENT);
+  dev = loop_trylookup(number);
+  if (dev) {
+   block_device_decref(&dev->ld_dev);
+   throw_fs_error(ERROR_FS_FILE_ALREADY_EXISTS);
+  }
+  dev = loop_lookup(number,true);
+  block_device_decref(&dev->ld_dev);
+  return number;
+
+ case LOOP_CTL_REMOVE:
+  dev = loop_lookup(number,false);
+  TRY {
+   rwlock_write(&dev->ld_lock);
+   TRY {
+    if (dev->ld_node || Loop_IsMounted(dev))
+        throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+    unregister_device(&dev->ld_dev.b_device);
+   } FINALLY {
+    rwlock_endwrite(&dev->ld_lock);
+   }
+  } FINALLY {
+   block_device_decref(&dev->ld_dev);
+  }
+  return number;
+
+ case LOOP_CTL_GET_FREE:
+  /* Find the lowest-numbered, unbound loop device. */
+  for (number = 0; number < CONFIG_LOOP_MAXDEVICES; ++number) {
+   bool is_free;
+   dev = loop_lookup(number,true);
+   is_free = ATOMIC_READ(dev->ld_node) == NULL;
+   block_device_decref(&dev->ld_dev);
+   if (is_free) return number;
+  }
+  throw_fs_error(ERROR_FS_OBJECT_IS_BUSY);
+
+ default: break;
+ }
+ error_throw(E_NOT_IMPLEMENTED);
+}
+
+PRIVATE struct character_device_ops loop_control_ops = {
+    .c_file = {
+        .f_ioctl = &LoopControl_Ioctl
+    }
+};
+
+DEFINE_DRIVER_INIT(loop_initialize);
+PRIVATE ATTR_USED ATTR_FREETEXT void KCALL loop_initialize(void) {
+ REF struct character_device *EXCEPT_VAR cdev;
+ cdev = CHARACTER_DEVICE_ALLOC(struct character_device);
+ TRY {
+  cdev->c_device.d_devno = LOOP_CONTROL_DEVNO;
+  cdev->c_ops            = &loop_control_ops;
+  device_setnamef(&cdev->c_device,"loop-control");
+  register_device(&cdev->c_device);
+ } FINALLY {
+  character_device_decref(cdev);
+ }
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_SRC_FS_LOOP_C */
@@ -1170,6 +1170,9 @@ directory_addentry(struct directory_node *__restrict self,
  /* Track the total number of directory entires. */
  ++self->d_size;
 
+ /* Invalidate negative path cache entries for this directory. */
+ ATOMIC_FETCHINC(self->d_version);
+
  if (self->d_size >= (self->d_mask/3)*2) {
   assert(self->d_mask != 0);
   /* Since this is a hash-map, we can simply
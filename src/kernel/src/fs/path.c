@@ -47,6 +47,10 @@ DECL_BEGIN
 #error "`CONFIG_PATH_CHILD_MAPSIZE' must be a power-of-2"
 #endif
 
+/* Return the hash-map bucket of `self' that is used for `hash' */
+#define PATH_CHILD_BUCKET(self,hash) \
+   (self)->p_directory.d_child[(hash) & (self)->p_directory.d_mask]
+
 #define throw_fs_error(fs_error_code) \
         __EXCEPT_INVOKE_THROW_NORETURN(throw_fs_error(fs_error_code))
 PRIVATE __EXCEPT_NORETURN void
@@ -62,14 +66,35 @@ PRIVATE __EXCEPT_NORETURN void
 }
 
 
+/* Initialize the (empty) child hash-map of a newly allocated path. */
+LOCAL void KCALL
+path_init_directory(struct path *__restrict self) {
+ atomic_rwlock_cinit(&self->p_directory.d_lock);
+ self->p_directory.d_mask  = CONFIG_PATH_CHILD_MAPSIZE-1;
+ self->p_directory.d_child = self->p_directory.d_inline;
+}
+
+/* Free a chain of negative path entries. */
+LOCAL ATTR_NOTHROW void KCALL
+path_negative_freechain(struct path_negative *chain) {
+ struct path_negative *next;
+ while (chain) {
+  next = chain->pn_next;
+  kfree(chain);
+  chain = next;
+ }
+}
+
 PRIVATE void KCALL
 path_clear_children(struct path *__restrict self) {
- unsigned int i;
+ size_t i;
+ struct path_negative *negative;
  /* Clear all children. */
  atomic_rwlock_write(&self->p_directory.d_lock);
- for (i = 0; i < CONFIG_PATH_CHILD_MAPSIZE; ++i) {
+ for (i = 0; i <= self->p_directory.d_mask; ++i) {
   struct path *iter,*next;
   iter = self->p_directory.d_child[i];
+  self->p_directory.d_child[i] = NULL;
   while (iter) {
    /* Unlink the sibling chain of paths. */
    next = iter->p_siblings.le_next;
@@ -78,7 +103,177 @@ path_clear_children(struct path *__restrict self) {
    iter = next;
   }
  }
+ self->p_directory.d_size = 0;
+ /* Negative entries describe the old node, too. */
+ negative = self->p_directory.d_negative;
+ self->p_directory.d_negative = NULL;
+ self->p_directory.d_negcount = 0;
  atomic_rwlock_endwrite(&self->p_directory.d_lock);
+ path_negative_freechain(negative);
+}
+
+/* Increase the size of the child hash-map of `self'.
+ * Called after a new child was added and `d_size' exceeds `d_mask'. */
+PRIVATE void KCALL
+path_rehash_children(struct path *__restrict self) {
+ WEAK struct path **new_map,**old_map;
+ struct path *iter,*next;
+ size_t i,old_mask,new_mask;
+ old_mask = ATOMIC_READ(self->p_directory.d_mask);
+ new_mask = (old_mask << 1)|1;
+ TRY {
+  new_map = (WEAK struct path **)kmalloc((new_mask+1)*sizeof(WEAK struct path *),
+                                          GFP_SHARED|GFP_CALLOC);
+ } CATCH_HANDLED (E_BADALLOC) {
+  /* Since this is a hash-map, we can simply
+   * ignore allocation failures during re-hashing. */
+  return;
+ }
+ atomic_rwlock_write(&self->p_directory.d_lock);
+ if unlikely(self->p_directory.d_mask != old_mask ||
+             self->p_directory.d_size <= old_mask) {
+  /* Another thread already re-hashed the map (or children were removed) */
+  atomic_rwlock_endwrite(&self->p_directory.d_lock);
+  kfree(new_map);
+  return;
+ }
+ /* Rehash all the child paths. */
+ old_map = self->p_directory.d_child;
+ for (i = 0; i <= old_mask; ++i) {
+  iter = old_map[i];
+  while (iter) {
+   next = iter->p_siblings.le_next;
+   LIST_INSERT(new_map[iter->p_dirent->de_hash & new_mask],iter,p_siblings);
+   iter = next;
+  }
+ }
+ self->p_directory.d_child = new_map;
+ self->p_directory.d_mask  = new_mask;
+ atomic_rwlock_endwrite(&self->p_directory.d_lock);
+ if (old_map != self->p_directory.d_inline)
+     kfree(old_map);
+}
+
+/* Insert `child' into the child hash-map of `self'.
+ * The caller must be holding a write-lock on `self->p_directory.d_lock'
+ * @return: true: The caller should call `path_rehash_children()'
+ *                after releasing their lock. */
+LOCAL bool KCALL
+path_insert_child(struct path *__restrict self,
+                  struct path *__restrict child) {
+ LIST_INSERT(PATH_CHILD_BUCKET(self,child->p_dirent->de_hash),child,p_siblings);
+ return ++self->p_directory.d_size > self->p_directory.d_mask;
+}
+
+
+/* Check if `self' contains a valid negative entry for the given name.
+ * Negative entries are validated against `d_version' of the directory
+ * node, meaning that no lock on the node has to be acquired, and any
+ * entry that was added to the directory since then invalidates them.
+ * @param: nocase: When true, only match entries that were created by
+ *                `path_casechild()', and ignore casing when comparing. */
+PRIVATE bool KCALL
+path_negative_find(struct path *__restrict self,
+                   struct directory_node *__restrict node,
+                   USER CHECKED char const *path, u16 pathlen,
+                   uintptr_t hash, bool nocase) {
+ struct path_negative *iter;
+ u32 version = ATOMIC_READ(node->d_version);
+ bool result = false;
+ atomic_rwlock_read(&self->p_directory.d_lock);
+ TRY { /* Guard against E_SEGFAULT from user-space. */
+  for (iter = self->p_directory.d_negative;
+       iter; iter = iter->pn_next) {
+   if (iter->pn_node != node) continue;
+   if (iter->pn_version != version) continue;
+   if (iter->pn_namelen != pathlen) continue;
+   if (nocase) {
+    if (!(iter->pn_flags & PATH_NEGATIVE_FNOCASE)) continue;
+    if (memcasecmp(iter->pn_name,path,pathlen*sizeof(char)) != 0) continue;
+   } else {
+    if (iter->pn_hash != hash) continue;
+    if (memcmp(iter->pn_name,path,pathlen*sizeof(char)) != 0) continue;
+   }
+   result = true;
+   break;
+  }
+ } FINALLY {
+  atomic_rwlock_endread(&self->p_directory.d_lock);
+ }
+ return result;
+}
+
+/* Remember that the given name doesn't exist in `node'
+ * @param: version: The value of `node->d_version', as read while
+ *                  the lookup that failed was being performed. */
+PRIVATE void KCALL
+path_negative_add(struct path *__restrict self,
+                  struct directory_node *__restrict node, u32 version,
+                  USER CHECKED char const *path, u16 pathlen,
+                  uintptr_t hash, u16 flags) {
+ struct path_negative *EXCEPT_VAR entry;
+ struct path_negative *iter,**piter,*drop = NULL;
+ /* Don't cache misses of directories that generate their contents on-the-fly. */
+ if (node->d_node.i_ops->io_directory.d_oneshot.o_lookup)
+     return;
+ TRY {
+  entry = (struct path_negative *)kmalloc(offsetof(struct path_negative,pn_name)+
+                                          pathlen*sizeof(char),GFP_SHARED);
+ } CATCH_HANDLED (E_BADALLOC) {
+  /* This is just a cache, so we can ignore allocation failures. */
+  return;
+ }
+ TRY {
+  memcpy(entry->pn_name,path,pathlen*sizeof(char));
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  kfree(entry);
+  error_rethrow();
+ }
+ entry->pn_node    = node;
+ entry->pn_hash    = hash;
+ entry->pn_version = version;
+ entry->pn_namelen = pathlen;
+ entry->pn_flags   = flags;
+ atomic_rwlock_write(&self->p_directory.d_lock);
+ if unlikely(self->p_node != &node->d_node) {
+  /* The path was re-mounted in the mean time. */
+  atomic_rwlock_endwrite(&self->p_directory.d_lock);
+  kfree(entry);
+  return;
+ }
+ /* Get rid of stale entries, and entries that we're about to replace. */
+ piter = &self->p_directory.d_negative;
+ while ((iter = *piter) != NULL) {
+  if (iter->pn_node != node ||
+      iter->pn_version != ATOMIC_READ(node->d_version) ||
+     (iter->pn_hash == hash && iter->pn_namelen == pathlen &&
+     (iter->pn_flags & flags) == iter->pn_flags &&
+      memcmp(iter->pn_name,entry->pn_name,pathlen*sizeof(char)) == 0)) {
+   *piter = iter->pn_next;
+   iter->pn_next = drop;
+   drop = iter;
+   --self->p_directory.d_negcount;
+   continue;
+  }
+  piter = &iter->pn_next;
+ }
+ /* Make sure not to exceed the negative entry limit. */
+ if (self->p_directory.d_negcount >= CONFIG_PATH_NEGATIVE_MAX) {
+  /* Drop the least recently added entry. */
+  piter = &self->p_directory.d_negative;
+  while ((*piter)->pn_next)
+          piter = &(*piter)->pn_next;
+  iter = *piter;
+  *piter = NULL;
+  iter->pn_next = drop;
+  drop = iter;
+  --self->p_directory.d_negcount;
+ }
+ entry->pn_next = self->p_directory.d_negative;
+ self->p_directory.d_negative = entry;
+ ++self->p_directory.d_negcount;
+ atomic_rwlock_endwrite(&self->p_directory.d_lock);
+ path_negative_freechain(drop);
 }
 
 
@@ -260,8 +455,11 @@ path_destroy(struct path *__restrict self) {
   if (self->p_siblings.le_pself) {
    atomic_rwlock_write(&parent->p_directory.d_lock);
    COMPILER_READ_BARRIER();
-   if (self->p_siblings.le_pself)
-       LIST_REMOVE(self,p_siblings);
+   if (self->p_siblings.le_pself) {
+    LIST_REMOVE(self,p_siblings);
+    assert(parent->p_directory.d_size != 0);
+    --parent->p_directory.d_size;
+   }
    atomic_rwlock_endwrite(&parent->p_directory.d_lock);
   }
 
@@ -275,6 +473,11 @@ path_destroy(struct path *__restrict self) {
  } else {
   assert(!self->p_dirent);
  }
+ /* Free the child hash-map and negative entries. */
+ if (self->p_directory.d_child &&
+     self->p_directory.d_child != self->p_directory.d_inline)
+     kfree(self->p_directory.d_child);
+ path_negative_freechain(self->p_directory.d_negative);
  /* NOTE: `p_node' may be NULL if the path was only partially constructed. */
  if (self->p_node)
      inode_decref(self->p_node);
@@ -590,12 +793,14 @@ path_child(struct path *__restrict self,
  uintptr_t hash;
  REF struct path *EXCEPT_VAR result;
  REF struct path *new_result,**pbucket;
+ size_t mask; bool must_rehash;
  assertf(self->p_node,"Path hasn't been initialized");
  assertf(self->p_vfs,"Path hasn't been initialized");
  hash = directory_entry_hash(path,pathlen);
 again:
  atomic_rwlock_read(&self->p_directory.d_lock);
- result = self->p_directory.d_child[hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+ mask   = self->p_directory.d_mask;
+ result = PATH_CHILD_BUCKET(self,hash);
  for (; result; result = result->p_siblings.le_next) {
   struct directory_entry *entry = result->p_dirent;
   if (entry->de_hash != hash) continue;
@@ -614,7 +819,9 @@ again:
   }
   /* ... Nope */
   atomic_rwlock_read(&self->p_directory.d_lock);
-  if (!ATOMIC_DECIFNOTONE(result->p_refcnt)) {
+  if (!ATOMIC_DECIFNOTONE(result->p_refcnt) ||
+      self->p_directory.d_mask != mask) {
+   /* Either the path died, or the map was re-hashed. */
    atomic_rwlock_endread(&self->p_directory.d_lock);
    path_decref(result);
    goto again;
@@ -630,19 +837,32 @@ again:
   REF struct directory_entry *EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(entry);
   REF struct inode *EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(entry_node);
   struct directory_node *EXCEPT_VAR dir;
+  u32 EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(version);
   dir = (struct directory_node *)self->p_node;
+  /* Check if we already know that this file doesn't exist. */
+  if (ATOMIC_READ(self->p_directory.d_negative) &&
+      path_negative_find(self,dir,path,pathlen,hash,false)) {
+   inode_access(&dir->d_node,R_OK|X_OK);
+   throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+  }
 again_getentry:
   rwlock_read(&dir->d_node.i_lock);
   TRY {
-   entry = directory_getentry(dir,path,pathlen,hash);
-   if (!entry)
-        throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+   version = ATOMIC_READ(dir->d_version);
+   entry   = directory_getentry(dir,path,pathlen,hash);
    /* Got the entry! */
-   directory_entry_incref(entry);
+   if (entry)
+       directory_entry_incref(entry);
   } FINALLY {
    if (rwlock_endread(&dir->d_node.i_lock))
        goto again_getentry;
   }
+  if (!entry) {
+   /* Remember that this file doesn't exist. */
+   path_negative_add(self,dir,version,path,pathlen,hash,
+                     PATH_NEGATIVE_FNORMAL);
+   throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+  }
   /* Now lookup the INode of the entry. */
   TRY {
    entry_node = superblock_opennode(dir->d_node.i_super,dir,entry);
@@ -668,11 +888,11 @@ again_getentry:
   result->p_vfs           = self->p_vfs;
   result->p_mount.m_rnode = entry_node;
   atomic_rwlock_cinit(&result->p_lock);
-  atomic_rwlock_cinit(&result->p_directory.d_lock);
+  path_init_directory(result);
 
   /* Add the new node to the directory. */
   atomic_rwlock_write(&self->p_directory.d_lock);
-  pbucket = &self->p_directory.d_child[entry->de_hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+  pbucket = &PATH_CHILD_BUCKET(self,entry->de_hash);
   new_result = *pbucket;
   for (; new_result; new_result = new_result->p_siblings.le_next) {
    if unlikely(new_result->p_dirent == entry ||
@@ -690,8 +910,10 @@ again_getentry:
    }
   }
   /* Insert the newly generated node into the parent directory. */
-  LIST_INSERT(*pbucket,result,p_siblings);
+  must_rehash = path_insert_child(self,result);
   atomic_rwlock_endwrite(&self->p_directory.d_lock);
+  if (must_rehash)
+      path_rehash_children(self);
  }
  vfs_recent(result);
  return result;
@@ -702,12 +924,14 @@ path_casechild(struct path *__restrict self,
  uintptr_t hash;
  REF struct path *EXCEPT_VAR result;
  REF struct path *new_result,**pbucket;
+ size_t mask; bool must_rehash;
  assertf(self->p_node,"Path hasn't been initialized");
  assertf(self->p_vfs,"Path hasn't been initialized");
  hash = directory_entry_hash(path,pathlen);
 again:
  atomic_rwlock_read(&self->p_directory.d_lock);
- result = self->p_directory.d_child[hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+ mask   = self->p_directory.d_mask;
+ result = PATH_CHILD_BUCKET(self,hash);
  for (; result; result = result->p_siblings.le_next) {
   struct directory_entry *entry = result->p_dirent;
   if (entry->de_hash != hash) continue;
@@ -726,7 +950,9 @@ again:
   }
   /* ... Nope */
   atomic_rwlock_read(&self->p_directory.d_lock);
-  if (!ATOMIC_DECIFNOTONE(result->p_refcnt)) {
+  if (!ATOMIC_DECIFNOTONE(result->p_refcnt) ||
+      self->p_directory.d_mask != mask) {
+   /* Either the path died, or the map was re-hashed. */
    atomic_rwlock_endread(&self->p_directory.d_lock);
    path_decref(result);
    goto again;
@@ -741,7 +967,7 @@ again:
   char first_char = path[0];
   COMPILER_READ_BARRIER();
   first_char = tolower(first_char);
-  for (hash = 0; hash < CONFIG_PATH_CHILD_MAPSIZE; ++hash) {
+  for (hash = 0; hash <= mask; ++hash) {
    result = self->p_directory.d_child[hash];
    for (; result; result = result->p_siblings.le_next) {
     struct directory_entry *entry = result->p_dirent;
@@ -761,7 +987,9 @@ again:
     }
     /* ... Nope */
     atomic_rwlock_read(&self->p_directory.d_lock);
-    if (!ATOMIC_DECIFNOTONE(result->p_refcnt)) {
+    if (!ATOMIC_DECIFNOTONE(result->p_refcnt) ||
+        self->p_directory.d_mask != mask) {
+     /* Either the path died, or the map was re-hashed. */
      atomic_rwlock_endread(&self->p_directory.d_lock);
      path_decref(result);
      goto again;
@@ -779,18 +1007,32 @@ again:
   REF struct directory_entry *EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(entry);
   REF struct inode *EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(entry_node);
   struct directory_node *EXCEPT_VAR dir;
+  u32 EXCEPT_VAR COMPILER_IGNORE_UNINITIALIZED(version);
   dir = (struct directory_node *)self->p_node;
+  /* Check if we already know that this file doesn't exist (in any casing). */
+  if (ATOMIC_READ(self->p_directory.d_negative) &&
+      path_negative_find(self,dir,path,pathlen,hash,true)) {
+   inode_access(&dir->d_node,R_OK|X_OK);
+   throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+  }
 again_getentry:
   rwlock_read(&dir->d_node.i_lock);
   TRY {
-   entry = directory_getcaseentry(dir,path,pathlen,hash);
-   if (!entry) throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+   version = ATOMIC_READ(dir->d_version);
+   entry   = directory_getcaseentry(dir,path,pathlen,hash);
    /* Got the entry! */
-   directory_entry_incref(entry);
+   if (entry)
+       directory_entry_incref(entry);
   } FINALLY {
    if (rwlock_endread(&dir->d_node.i_lock))
        goto again_getentry;
   }
+  if (!entry) {
+   /* Remember that this file doesn't exist. */
+   path_negative_add(self,dir,version,path,pathlen,hash,
+                     PATH_NEGATIVE_FNOCASE);
+   throw_fs_error(ERROR_FS_PATH_NOT_FOUND);
+  }
   /* Now lookup the INode of the entry. */
   TRY {
    entry_node = superblock_opennode(dir->d_node.i_super,dir,entry);
@@ -816,11 +1058,11 @@ again_getentry:
   result->p_vfs           = self->p_vfs;
   result->p_mount.m_rnode = entry_node;
   atomic_rwlock_cinit(&result->p_lock);
-  atomic_rwlock_cinit(&result->p_directory.d_lock);
+  path_init_directory(result);
 
   /* Add the new node to the directory. */
   atomic_rwlock_write(&self->p_directory.d_lock);
-  pbucket = &self->p_directory.d_child[entry->de_hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+  pbucket = &PATH_CHILD_BUCKET(self,entry->de_hash);
   new_result = *pbucket;
   for (; new_result; new_result = new_result->p_siblings.le_next) {
    if unlikely(new_result->p_dirent == entry ||
@@ -838,8 +1080,10 @@ again_getentry:
    }
   }
   /* Insert the newly generated node into the parent directory. */
-  LIST_INSERT(*pbucket,result,p_siblings);
+  must_rehash = path_insert_child(self,result);
   atomic_rwlock_endwrite(&self->p_directory.d_lock);
+  if (must_rehash)
+      path_rehash_children(self);
  }
  vfs_recent(result);
  return result;
@@ -861,7 +1105,7 @@ path_delchild(struct path *__restrict self,
  atomic_rwlock_write(&self->p_directory.d_lock);
  atomic_rwlock_endread(&self->p_lock);
  /* Search for a child-path for the given child_entry. */
- child = self->p_directory.d_child[child_entry->de_hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+ child = PATH_CHILD_BUCKET(self,child_entry->de_hash);
  for (; child; child = child->p_siblings.le_next) {
   struct directory_entry *entry = child->p_dirent;
   if (entry == child_entry) goto child_found;
@@ -875,6 +1119,10 @@ child_found:
   /* Remove this child from the path cache. */
   path_incref(child); /* Get a reference for the `vfs_remove_recent()' below. */
   LIST_REMOVE(child,p_siblings);
+  /* Clear the link, so `path_destroy()' won't try to unlink it again. */
+  child->p_siblings.le_pself = NULL;
+  child->p_siblings.le_next  = NULL;
+  --self->p_directory.d_size;
   atomic_rwlock_endwrite(&self->p_directory.d_lock);
   vfs_remove_recent(child);
   /* Drop our temporary reference. */
@@ -890,6 +1138,7 @@ path_newchild(struct path *__restrict self,
               struct inode *__restrict child_node,
               struct directory_entry *__restrict child_entry) {
  REF struct path *result,*new_result,**pbucket;
+ bool must_rehash;
  /* Construct the new path, optimizing for the greater
   * chance that the race condition of `path_child()'
   * having been called in the mean time (and the path
@@ -904,7 +1153,7 @@ path_newchild(struct path *__restrict self,
  result->p_node          = child_node;
  result->p_mount.m_rnode = child_node;
  atomic_rwlock_cinit(&result->p_lock);
- atomic_rwlock_cinit(&result->p_directory.d_lock);
+ path_init_directory(result);
  directory_entry_incref(child_entry);
  inode_incref(child_node);
  vfs_incref(self->p_vfs);
@@ -928,7 +1177,7 @@ path_newchild(struct path *__restrict self,
 
  /* Check for the race condition where another
   * thread already created this entry. */
- pbucket = &self->p_directory.d_child[child_entry->de_hash & (CONFIG_PATH_CHILD_MAPSIZE-1)];
+ pbucket = &PATH_CHILD_BUCKET(self,child_entry->de_hash);
  new_result = *pbucket;
  for (; new_result; new_result = new_result->p_siblings.le_next) {
 #if 0 /* XXX: Directory entries may change if files are deleted, then re-created... */
@@ -953,8 +1202,10 @@ already_exists:
   return new_result;
  }
  /* Add the path to the bucket list. */
- LIST_INSERT(*pbucket,result,p_siblings);
+ must_rehash = path_insert_child(self,result);
  atomic_rwlock_endwrite(&self->p_directory.d_lock);
+ if (must_rehash)
+     path_rehash_children(self);
  /* Cache the path as recently used. */
  vfs_recent(result);
 done:
@@ -975,7 +1226,7 @@ REF struct vfs *KCALL vfs_alloc(void) {
  atomic_rwlock_cinit(&result->v_mount.m_lock);
  atomic_rwlock_cinit(&result->v_recent.r_lock);
  atomic_rwlock_cinit(&result->v_root.p_lock);
- atomic_rwlock_cinit(&result->v_root.p_directory.d_lock);
+ path_init_directory(&result->v_root);
  return result;
 }
 
@@ -1226,10 +1477,15 @@ PUBLIC struct vfs vfs_kernel = {
             .m_rnode = NULL
         },
         .p_directory = {
-            .d_lock = ATOMIC_RWLOCK_INIT,
-            .d_child = {
+            .d_lock   = ATOMIC_RWLOCK_INIT,
+            .d_mask   = CONFIG_PATH_CHILD_MAPSIZE-1,
+            .d_size   = 0,
+            .d_child  = vfs_kernel.v_root.p_directory.d_inline,
+            .d_inline = {
                 [0 ... CONFIG_PATH_CHILD_MAPSIZE-1] = NULL
-            }
+            },
+            .d_negative = NULL,
+            .d_negcount = 0
         }
     },
     .v_fscount = 1, /* +1: fs_kernel.fs_vfs */
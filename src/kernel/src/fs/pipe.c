@@ -35,19 +35,20 @@
 #include <string.h>
 #include <bits/poll.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 DECL_BEGIN
 
 PUBLIC ATTR_NOTHROW void KCALL
 pipe_destroy(struct pipe *__restrict self) {
- ringbuffer_fini(&self->p_buffer);
+ pipebuffer_fini(&self->p_buffer);
  kfree(self);
 }
 
 PUBLIC ATTR_NOTHROW void KCALL
 pipereader_destroy(struct pipereader *__restrict self) {
  /* Close the pipe buffer. */
- ringbuffer_close(&self->pr_pipe->p_buffer);
+ pipebuffer_close(&self->pr_pipe->p_buffer);
  pipe_decref(self->pr_pipe);
  kfree(self);
 }
@@ -57,7 +58,7 @@ DEFINE_PUBLIC_ALIAS(pipewriter_destroy,pipereader_destroy);
 PUBLIC ATTR_NOTHROW void KCALL
 pipewriter_destroy(struct pipewriter *__restrict self) {
  /* Close the pipe buffer. */
- ringbuffer_close(&self->pw_pipe->p_buffer);
+ pipebuffer_close(&self->pw_pipe->p_buffer);
  pipe_decref(self->pw_pipe);
  kfree(self);
 }
@@ -69,7 +70,7 @@ KCALL pipe_alloc(size_t max_size) {
  REF struct pipe *result;
  result = (REF struct pipe *)kmalloc(sizeof(struct pipe),
                                      GFP_SHARED);
- ringbuffer_init(&result->p_buffer,max_size);
+ pipebuffer_init(&result->p_buffer,max_size);
  result->p_refcnt = 1;
  return result;
 }
@@ -107,25 +108,25 @@ INTERN size_t KCALL
 handle_pipe_read(struct pipe *__restrict self,
                  USER CHECKED void *buf,
                  size_t bufsize, iomode_t flags) {
- return ringbuffer_read(&self->p_buffer,buf,bufsize,flags);
+ return pipebuffer_read(&self->p_buffer,buf,bufsize,flags);
 }
 INTERN size_t KCALL
 handle_pipe_write(struct pipe *__restrict self,
                   USER CHECKED void const *buf,
                   size_t bufsize, iomode_t flags) {
- return ringbuffer_write(&self->p_buffer,buf,bufsize,flags);
+ return pipebuffer_write(&self->p_buffer,buf,bufsize,flags);
 }
 INTERN size_t KCALL
 handle_pipereader_read(struct pipereader *__restrict self,
                        USER CHECKED void *buf,
                        size_t bufsize, iomode_t flags) {
- return ringbuffer_read(&self->pr_pipe->p_buffer,buf,bufsize,flags);
+ return pipebuffer_read(&self->pr_pipe->p_buffer,buf,bufsize,flags);
 }
 INTERN size_t KCALL
 handle_pipewriter_write(struct pipewriter *__restrict self,
                         USER CHECKED void const *buf,
                         size_t bufsize, iomode_t flags) {
- return ringbuffer_write(&self->pw_pipe->p_buffer,buf,bufsize,flags);
+ return pipebuffer_write(&self->pw_pipe->p_buffer,buf,bufsize,flags);
 }
 INTERN pos_t KCALL
 handle_pipereader_seek(struct pipereader *__restrict self,
@@ -134,9 +135,9 @@ handle_pipereader_seek(struct pipereader *__restrict self,
      error_throw(E_INVALID_ARGUMENT);
  /* EXTENSION: `seek(42,SEEK_CUR)' -> DISCARD(42) (returns the number of discarded bytes) */
  if (off >= 0)
-     return ringbuffer_discard(&self->pr_pipe->p_buffer,(size_t)off);
+     return pipebuffer_discard(&self->pr_pipe->p_buffer,(size_t)off);
  /* EXTENSION: `seek(-42,SEEK_CUR)' -> UNREAD(42) (returns the number of unread bytes) */
- return ringbuffer_unread(&self->pr_pipe->p_buffer,(size_t)-off);
+ return pipebuffer_unread(&self->pr_pipe->p_buffer,(size_t)-off);
 }
 INTERN pos_t KCALL
 handle_pipewriter_seek(struct pipewriter *__restrict self,
@@ -144,20 +145,13 @@ handle_pipewriter_seek(struct pipewriter *__restrict self,
  if (whence != SEEK_CUR || off > 0)
      error_throw(E_INVALID_ARGUMENT);
  /* EXTENSION: `seek(-42,SEEK_CUR)' -> UNWRITE(42) (returns the number of unwritten bytes) */
- return ringbuffer_unwrite(&self->pw_pipe->p_buffer,(size_t)-off);
+ return pipebuffer_unwrite(&self->pw_pipe->p_buffer,(size_t)-off);
 }
 INTERN void KCALL
 handle_pipe_stat(struct pipe *__restrict self,
                  USER CHECKED struct stat64 *result) {
- size_t written_size; byte_t *rptr;
- atomic_rwlock_read(&self->p_buffer.r_lock);
- rptr = ATOMIC_READ(self->p_buffer.r_rptr);
- if (self->p_buffer.r_wptr > rptr)
-  written_size = self->p_buffer.r_wptr-rptr;
- else {
-  written_size = self->p_buffer.r_size-(rptr-self->p_buffer.r_wptr);
- }
- atomic_rwlock_endread(&self->p_buffer.r_lock);
+ size_t written_size;
+ written_size = pipebuffer_size(&self->p_buffer);
  COMPILER_BARRIER();
  memset(result,0,sizeof(struct stat64));
  result->st_size = written_size;
@@ -179,17 +173,17 @@ handle_pipewriter_stat(struct pipewriter *__restrict self,
 INTERN unsigned int KCALL
 handle_pipe_poll(struct pipe *__restrict self,
                  unsigned int mode) {
- return ringbuffer_poll(&self->p_buffer,mode);
+ return pipebuffer_poll(&self->p_buffer,mode);
 }
 INTERN unsigned int KCALL
 handle_pipereader_poll(struct pipereader *__restrict self,
                        unsigned int mode) {
- return ringbuffer_poll(&self->pr_pipe->p_buffer,mode & POLLIN);
+ return pipebuffer_poll(&self->pr_pipe->p_buffer,mode & POLLIN);
 }
 INTERN unsigned int KCALL
 handle_pipewriter_poll(struct pipewriter *__restrict self,
                        unsigned int mode) {
- return ringbuffer_poll(&self->pw_pipe->p_buffer,mode & POLLOUT);
+ return pipebuffer_poll(&self->pw_pipe->p_buffer,mode & POLLOUT);
 }
 
 union PACKED pipefd {
@@ -266,6 +260,229 @@ DEFINE_SYSCALL1(pipe,USER UNCHECKED int *,pipefd) {
 }
 
 
+#define throw_fs_error(fs_error_code) \
+        __EXCEPT_INVOKE_THROW_NORETURN(throw_fs_error(fs_error_code))
+PRIVATE __EXCEPT_NORETURN void
+(KCALL throw_fs_error)(u16 fs_error_code) {
+ struct exception_info *info;
+ info = error_info();
+ memset(info->e_error.e_pointers,0,sizeof(info->e_error.e_pointers));
+ info->e_error.e_code                        = E_FILESYSTEM_ERROR;
+ info->e_error.e_flag                        = ERR_FNORMAL;
+ info->e_error.e_filesystem_error.fs_errcode = fs_error_code;
+ error_throw_current();
+ __builtin_unreachable();
+}
+
+/* Return the pipe associated with `hnd', or NULL if it isn't a pipe. */
+PRIVATE struct pipe *KCALL
+handle_aspipe(struct handle hnd) {
+ switch (hnd.h_type) {
+ case HANDLE_TYPE_FPIPE:       return hnd.h_object.o_pipe;
+ case HANDLE_TYPE_FPIPEREADER: return hnd.h_object.o_pipereader->pr_pipe;
+ case HANDLE_TYPE_FPIPEWRITER: return hnd.h_object.o_pipewriter->pw_pipe;
+ default: break;
+ }
+ return NULL;
+}
+
+
+struct splice_file {
+    struct handle sf_hnd;  /* The file that is being spliced. */
+    pos_t         sf_pos;  /* [valid_if(sf_usepos)] The current file position. */
+    bool          sf_usepos; /* Use positional I/O at `sf_pos'. */
+};
+
+PRIVATE size_t KCALL
+splice_file_produce(struct splice_file *__restrict self,
+                    byte_t *__restrict dst, size_t num_bytes) {
+ size_t result;
+ /* Read file data directly into the pipe's page. */
+ if (self->sf_usepos) {
+  result = handle_preadf(self->sf_hnd,dst,num_bytes,
+                         self->sf_pos,self->sf_hnd.h_flag);
+  self->sf_pos += result;
+ } else {
+  result = handle_readf(self->sf_hnd,dst,num_bytes,
+                        self->sf_hnd.h_flag);
+ }
+ return result;
+}
+PRIVATE size_t KCALL
+splice_file_consume(struct splice_file *__restrict self,
+                    byte_t const *__restrict src, size_t num_bytes) {
+ size_t result;
+ /* Write data directly from the pipe's page. */
+ if (self->sf_usepos) {
+  result = handle_pwritef(self->sf_hnd,src,num_bytes,
+                          self->sf_pos,self->sf_hnd.h_flag);
+  self->sf_pos += result;
+ } else {
+  result = handle_writef(self->sf_hnd,src,num_bytes,
+                         self->sf_hnd.h_flag);
+ }
+ return result;
+}
+
+
+DEFINE_SYSCALL6(splice,
+                fd_t,fd_in,USER UNCHECKED pos_t *,poff_in,
+                fd_t,fd_out,USER UNCHECKED pos_t *,poff_out,
+                size_t,length,unsigned int,flags) {
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ struct handle EXCEPT_VAR hin;
+ struct handle EXCEPT_VAR hout;
+ if (flags & ~(SPLICE_F_MOVE|SPLICE_F_NONBLOCK|
+               SPLICE_F_MORE|SPLICE_F_GIFT))
+     error_throw(E_INVALID_ARGUMENT);
+ hin = handle_get(fd_in);
+ TRY {
+  hout = handle_get(fd_out);
+  TRY {
+   struct pipe *pin,*pout;
+   struct splice_file file;
+   iomode_t mode;
+   /* Check for read/write permissions. */
+   if ((hin.h_flag & IO_ACCMODE) == IO_WRONLY ||
+       (hout.h_flag & IO_ACCMODE) == IO_RDONLY)
+        throw_fs_error(ERROR_FS_ACCESS_ERROR);
+   pin  = handle_aspipe(hin);
+   pout = handle_aspipe(hout);
+   if (pin && pout) {
+    /* Pipes can't be seeked. */
+    if (poff_in || poff_out)
+        throw_fs_error(ERROR_FS_NEGATIVE_SEEK);
+    mode = (hin.h_flag|hout.h_flag) & IO_NONBLOCK;
+    if (flags & SPLICE_F_NONBLOCK) mode |= IO_NONBLOCK;
+    /* Move page references from one pipe to the other. */
+    result = pipebuffer_splice(&pout->p_buffer,&pin->p_buffer,
+                                length,mode,false);
+   } else if (pin) {
+    if (poff_in)
+        throw_fs_error(ERROR_FS_NEGATIVE_SEEK);
+    mode = hin.h_flag & IO_NONBLOCK;
+    if (flags & SPLICE_F_NONBLOCK) mode |= IO_NONBLOCK;
+    file.sf_hnd    = hout;
+    file.sf_usepos = poff_out != NULL;
+    if (poff_out) {
+     validate_writable(poff_out,sizeof(pos_t));
+     file.sf_pos = *poff_out;
+     COMPILER_READ_BARRIER();
+    }
+    result = pipebuffer_consume(&pin->p_buffer,length,mode,
+                               (pipebuffer_consume_t)&splice_file_consume,
+                               &file);
+    if (poff_out) {
+     COMPILER_WRITE_BARRIER();
+     *poff_out = file.sf_pos;
+    }
+   } else if (pout) {
+    if (poff_out)
+        throw_fs_error(ERROR_FS_NEGATIVE_SEEK);
+    mode = hout.h_flag & IO_NONBLOCK;
+    if (flags & SPLICE_F_NONBLOCK) mode |= IO_NONBLOCK;
+    file.sf_hnd    = hin;
+    file.sf_usepos = poff_in != NULL;
+    if (poff_in) {
+     validate_writable(poff_in,sizeof(pos_t));
+     file.sf_pos = *poff_in;
+     COMPILER_READ_BARRIER();
+    }
+    result = pipebuffer_produce(&pout->p_buffer,length,mode,
+                               (pipebuffer_produce_t)&splice_file_produce,
+                               &file);
+    if (poff_in) {
+     COMPILER_WRITE_BARRIER();
+     *poff_in = file.sf_pos;
+    }
+   } else {
+    /* At least one of the two handles must be a pipe. */
+    error_throw(E_INVALID_ARGUMENT);
+   }
+  } FINALLY {
+   handle_decref(hout);
+  }
+ } FINALLY {
+  handle_decref(hin);
+ }
+ return result;
+}
+
+DEFINE_SYSCALL4(tee,fd_t,fd_in,fd_t,fd_out,
+                size_t,length,unsigned int,flags) {
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ struct handle EXCEPT_VAR hin;
+ struct handle EXCEPT_VAR hout;
+ if (flags & ~(SPLICE_F_MOVE|SPLICE_F_NONBLOCK|
+               SPLICE_F_MORE|SPLICE_F_GIFT))
+     error_throw(E_INVALID_ARGUMENT);
+ hin = handle_get(fd_in);
+ TRY {
+  hout = handle_get(fd_out);
+  TRY {
+   struct pipe *pin,*pout;
+   iomode_t mode;
+   if ((hin.h_flag & IO_ACCMODE) == IO_WRONLY ||
+       (hout.h_flag & IO_ACCMODE) == IO_RDONLY)
+        throw_fs_error(ERROR_FS_ACCESS_ERROR);
+   pin  = handle_aspipe(hin);
+   pout = handle_aspipe(hout);
+   if (!pin || !pout)
+        error_throw(E_INVALID_ARGUMENT);
+   mode = (hin.h_flag|hout.h_flag) & IO_NONBLOCK;
+   if (flags & SPLICE_F_NONBLOCK) mode |= IO_NONBLOCK;
+   /* Share page references without consuming the input. */
+   result = pipebuffer_splice(&pout->p_buffer,&pin->p_buffer,
+                               length,mode,true);
+  } FINALLY {
+   handle_decref(hout);
+  }
+ } FINALLY {
+  handle_decref(hin);
+ }
+ return result;
+}
+
+DEFINE_SYSCALL4(vmsplice,fd_t,fd,
+                USER UNCHECKED struct iovec const *,iov,
+                size_t,count,unsigned int,flags) {
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ struct handle EXCEPT_VAR hnd;
+ size_t i,total = 0;
+ if (flags & ~(SPLICE_F_MOVE|SPLICE_F_NONBLOCK|
+               SPLICE_F_MORE|SPLICE_F_GIFT) ||
+     count > UIO_MAXIOV)
+     error_throw(E_INVALID_ARGUMENT);
+ validate_readable(iov,count*sizeof(struct iovec));
+ for (i = 0; i < count; ++i) {
+  size_t part = ATOMIC_READ(iov[i].iov_len);
+  if unlikely(__builtin_add_overflow(total,part,&total))
+     error_throw(E_INVALID_ARGUMENT);
+ }
+ hnd = handle_get(fd);
+ TRY {
+  struct pipe *p = handle_aspipe(hnd);
+  iomode_t mode;
+  if unlikely(!p)
+     error_throw(E_INVALID_ARGUMENT);
+  mode = hnd.h_flag & IO_NONBLOCK;
+  if (flags & SPLICE_F_NONBLOCK) mode |= IO_NONBLOCK;
+  /* NOTE: `iov_read()' / `iov_write()' re-validate each entry,
+   *        and will stop at the total calculated above. */
+  if ((hnd.h_flag & IO_ACCMODE) == IO_RDONLY) {
+   /* Reader-end: copy pipe data into the user-buffers. */
+   result = pipebuffer_readv(&p->p_buffer,iov,0,total,mode);
+  } else {
+   /* Writer-end: fill pipe pages with user-data. */
+   result = pipebuffer_writev(&p->p_buffer,iov,0,total,mode);
+  }
+ } FINALLY {
+  handle_decref(hnd);
+ }
+ return result;
+}
+
+
 DECL_END
 
 #endif /* !GUARD_KERNEL_SRC_FS_PIPE_C */
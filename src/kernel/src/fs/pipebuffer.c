@@ -0,0 +1,761 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_SRC_FS_PIPEBUFFER_C
+#define GUARD_KERNEL_SRC_FS_PIPEBUFFER_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <kos/types.h>
+#include <hybrid/align.h>
+#include <hybrid/atomic.h>
+#include <hybrid/minmax.h>
+#include <hybrid/sync/atomic-rwlock.h>
+#include <sched/signal.h>
+#include <sched/mutex.h>
+#include <sched/task.h>
+#include <kernel/malloc.h>
+#include <fs/pipebuffer.h>
+#include <assert.h>
+#include <string.h>
+#include <except.h>
+#include <bits/poll.h>
+#include <sys/uio.h>
+
+/* Page-granular pipe buffer. */
+
+DECL_BEGIN
+
+#define PIPEBUFFER_INITSLOTS  4 /* Initial length of the slot vector. */
+
+#define PIPEBUFFER_TAIL(self) \
+  (&(self)->pb_slotv[((self)->pb_first+(self)->pb_count-1) & (self)->pb_slotm])
+
+
+PUBLIC ATTR_RETNONNULL REF struct pipe_page *KCALL
+pipe_page_alloc(void) {
+ REF struct pipe_page *result;
+ result = (REF struct pipe_page *)kmalloc(sizeof(struct pipe_page),
+                                          GFP_SHARED);
+ result->pp_refcnt = 1;
+ return result;
+}
+PUBLIC ATTR_NOTHROW void KCALL
+pipe_page_destroy(struct pipe_page *__restrict self) {
+ kfree(self);
+}
+
+/* Free a chain of dead pages linked through their first data word. */
+PRIVATE ATTR_NOTHROW void KCALL
+pipe_page_freechain(struct pipe_page *chain) {
+ while (chain) {
+  struct pipe_page *next;
+  next = *(struct pipe_page **)chain->pp_data;
+  pipe_page_destroy(chain);
+  chain = next;
+ }
+}
+
+
+/* [locked(WRITE(self->pb_lock))]
+ * Drop a reference to `page'. If that was the last one, either keep
+ * the page as spare, or add it to `*pchain' to be freed once the lock
+ * has been released. */
+PRIVATE ATTR_NOTHROW void KCALL
+pipebuffer_droppage_locked(struct pipebuffer *__restrict self,
+                           struct pipe_page *__restrict page,
+                           struct pipe_page **__restrict pchain) {
+ if (ATOMIC_DECFETCH(page->pp_refcnt) != 0)
+     return;
+ if (!self->pb_spare) {
+  page->pp_refcnt = 1;
+  self->pb_spare  = page;
+ } else {
+  *(struct pipe_page **)page->pp_data = *pchain;
+  *pchain = page;
+ }
+}
+
+PRIVATE ATTR_NOTHROW void KCALL
+pipebuffer_droppage(struct pipebuffer *__restrict self,
+                    struct pipe_page *__restrict page) {
+ struct pipe_page *chain = NULL;
+ atomic_rwlock_write(&self->pb_lock);
+ pipebuffer_droppage_locked(self,page,&chain);
+ atomic_rwlock_endwrite(&self->pb_lock);
+ pipe_page_freechain(chain);
+}
+
+/* [locked(self->pb_lock)]
+ * Return the number of bytes that can be written without blocking. */
+PRIVATE ATTR_NOTHROW size_t KCALL
+pipebuffer_space_locked(struct pipebuffer *__restrict self) {
+ size_t limit = self->pb_limt & PIPEBUFFER_LIMT_FMASK;
+ struct pipe_slot *tail; size_t end;
+ if (self->pb_size >= limit)
+     return 0;
+ if (self->pb_count < PIPEBUFFER_MAXSLOTS(limit))
+     return limit-self->pb_size;
+ /* All slots are in use. - Check if data can be appended to the last one. */
+ tail = PIPEBUFFER_TAIL(self);
+ end  = tail->ps_offset+tail->ps_length;
+ if (end >= PIPE_PAGESIZE ||
+     ATOMIC_READ(tail->ps_page->pp_refcnt) != 1)
+     return 0;
+ return MIN(PIPE_PAGESIZE-end,limit-self->pb_size);
+}
+
+/* [locked(WRITE(self->pb_lock))]
+ * Return a new reference to the last page, if more data can be appended
+ * to it (in which case `*poffset' is set to where that data should go) */
+PRIVATE ATTR_NOTHROW REF struct pipe_page *KCALL
+pipebuffer_tailpage_locked(struct pipebuffer *__restrict self,
+                           size_t *__restrict poffset) {
+ struct pipe_slot *tail; size_t end;
+ if (!self->pb_count)
+     return NULL;
+ tail = PIPEBUFFER_TAIL(self);
+ end  = tail->ps_offset+tail->ps_length;
+ /* Pages shared with another pipe must not be modified. */
+ if (end >= PIPE_PAGESIZE ||
+     ATOMIC_READ(tail->ps_page->pp_refcnt) != 1)
+     return NULL;
+ *poffset = end;
+ pipe_page_incref(tail->ps_page);
+ return tail->ps_page;
+}
+
+/* [locked(self->pb_wlock)]
+ * Make sure that the slot vector has space for at least one more slot. */
+PRIVATE void KCALL
+pipebuffer_reserve(struct pipebuffer *__restrict self) {
+ struct pipe_slot *new_vector,*old_vector;
+ size_t i,new_length;
+ atomic_rwlock_read(&self->pb_lock);
+ if (self->pb_slotv && self->pb_count <= self->pb_slotm) {
+  atomic_rwlock_endread(&self->pb_lock);
+  return;
+ }
+ new_length = self->pb_slotv ? (self->pb_slotm+1)*2 : PIPEBUFFER_INITSLOTS;
+ atomic_rwlock_endread(&self->pb_lock);
+ new_vector = (struct pipe_slot *)kmalloc(new_length*
+                                          sizeof(struct pipe_slot),
+                                          GFP_SHARED);
+ atomic_rwlock_write(&self->pb_lock);
+ /* Since we're holding `pb_wlock', only consumers may have
+  * changed the buffer, meaning that it can only have shrunk. */
+ old_vector = self->pb_slotv;
+ assert(self->pb_count < new_length);
+ for (i = 0; i < self->pb_count; ++i)
+     new_vector[i] = old_vector[(self->pb_first+i) & self->pb_slotm];
+ self->pb_slotv = new_vector;
+ self->pb_slotm = new_length-1;
+ self->pb_first = 0;
+ atomic_rwlock_endwrite(&self->pb_lock);
+ kfree(old_vector);
+}
+
+/* [locked(WRITE(self->pb_lock))]
+ * Append a new slot, inheriting a reference to `page'. */
+PRIVATE ATTR_NOTHROW void KCALL
+pipebuffer_push_locked(struct pipebuffer *__restrict self,
+                       REF struct pipe_page *__restrict page,
+                       size_t offset, size_t length) {
+ struct pipe_slot *slot;
+ assert(self->pb_slotv);
+ assert(self->pb_count <= self->pb_slotm);
+ assert(length != 0);
+ if (!self->pb_count)
+      self->pb_unread = 0;
+ slot = &self->pb_slotv[(self->pb_first+self->pb_count) & self->pb_slotm];
+ slot->ps_page   = page;
+ slot->ps_offset = offset;
+ slot->ps_length = length;
+ ++self->pb_count;
+ self->pb_size += length;
+}
+
+/* [locked(self->pb_wlock)]
+ * Commit `length' bytes that were written to `page' at `offset',
+ * inheriting a reference to `page'. */
+PRIVATE ATTR_NOTHROW void KCALL
+pipebuffer_commit(struct pipebuffer *__restrict self,
+                  REF struct pipe_page *__restrict page,
+                  size_t offset, size_t length) {
+ bool was_empty;
+ atomic_rwlock_write(&self->pb_lock);
+ was_empty = self->pb_size == 0;
+ if (self->pb_count) {
+  struct pipe_slot *tail = PIPEBUFFER_TAIL(self);
+  if (tail->ps_page == page &&
+      tail->ps_offset+tail->ps_length == offset) {
+   /* Extend the last slot (which already holds a reference to `page') */
+   tail->ps_length += length;
+   self->pb_size   += length;
+   ATOMIC_FETCHDEC(page->pp_refcnt);
+   goto done;
+  }
+ }
+ /* The last slot was consumed in the mean time, or this is a new page. */
+ pipebuffer_push_locked(self,page,offset,length);
+done:
+ atomic_rwlock_endwrite(&self->pb_lock);
+ if (was_empty)
+     sig_broadcast(&self->pb_stat);
+}
+
+/* [locked(self->pb_rlock)]
+ * Remove up to `num_bytes' bytes from the front of the buffer. */
+PRIVATE ATTR_NOTHROW size_t KCALL
+pipebuffer_take(struct pipebuffer *__restrict self, size_t num_bytes) {
+ struct pipe_page *chain = NULL;
+ size_t result = 0;
+ bool was_full,is_empty;
+ atomic_rwlock_write(&self->pb_lock);
+ was_full = pipebuffer_space_locked(self) == 0;
+ while (result < num_bytes && self->pb_count) {
+  struct pipe_slot *slot = &self->pb_slotv[self->pb_first];
+  size_t part = MIN(slot->ps_length,num_bytes-result);
+  slot->ps_offset += part;
+  slot->ps_length -= part;
+  self->pb_unread += part;
+  result          += part;
+  if (!slot->ps_length) {
+   /* The slot has been fully consumed. */
+   pipebuffer_droppage_locked(self,slot->ps_page,&chain);
+   self->pb_first  = (self->pb_first+1) & self->pb_slotm;
+   self->pb_unread = 0;
+   --self->pb_count;
+  }
+ }
+ self->pb_size -= result;
+ is_empty = self->pb_size == 0;
+ atomic_rwlock_endwrite(&self->pb_lock);
+ pipe_page_freechain(chain);
+ if (result) {
+  /* If the buffer was full, wake writers after we've read some data. */
+  if (was_full)
+      sig_broadcast_channel(&self->pb_stat,PIPEBUF_STATE_CHANNEL_NOTFULL);
+  if (is_empty)
+      sig_broadcast_channel(&self->pb_stat,PIPEBUF_STATE_CHANNEL_EMPTY);
+ }
+ return result;
+}
+
+PRIVATE bool KCALL
+pipebuffer_canread(struct pipebuffer *__restrict self) {
+ return ATOMIC_READ(self->pb_size) != 0 ||
+       (ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FCLOSED);
+}
+PRIVATE bool KCALL
+pipebuffer_canwrite(struct pipebuffer *__restrict self) {
+ bool result;
+ atomic_rwlock_read(&self->pb_lock);
+ result = pipebuffer_space_locked(self) != 0;
+ atomic_rwlock_endread(&self->pb_lock);
+ return result || (ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FCLOSED);
+}
+
+/* Wait for `cond' to become true. */
+PRIVATE void KCALL
+pipebuffer_wait(struct pipebuffer *__restrict self, uintptr_t channel,
+                bool (KCALL *cond)(struct pipebuffer *__restrict self)) {
+ uintptr_t EXCEPT_VAR old_mask;
+ old_mask = task_channelmask(channel);
+ TRY {
+  task_connect(&self->pb_stat);
+  if ((*cond)(self))
+   task_disconnect();
+  else {
+   task_wait();
+  }
+ } FINALLY {
+  task_channelmask(old_mask);
+ }
+}
+
+
+
+PUBLIC ATTR_NOTHROW void KCALL
+pipebuffer_fini(struct pipebuffer *__restrict self) {
+ size_t i;
+ for (i = 0; i < self->pb_count; ++i)
+     pipe_page_decref(self->pb_slotv[(self->pb_first+i) & self->pb_slotm].ps_page);
+ if (self->pb_spare)
+     pipe_page_decref(self->pb_spare);
+ kfree(self->pb_slotv);
+}
+
+PUBLIC ATTR_NOTHROW bool KCALL
+pipebuffer_close(struct pipebuffer *__restrict self) {
+ size_t old_limit;
+ /* Set the closed-flag. */
+ old_limit = ATOMIC_FETCHOR(self->pb_limt,PIPEBUFFER_LIMT_FCLOSED);
+ if (old_limit & PIPEBUFFER_LIMT_FCLOSED) return false;
+ /* Broadcast the state-change signal to wake everyone. */
+ sig_broadcast(&self->pb_stat);
+ return true;
+}
+
+PUBLIC ATTR_NOTHROW WEAK size_t KCALL
+pipebuffer_size(struct pipebuffer *__restrict self) {
+ return ATOMIC_READ(self->pb_size);
+}
+
+PUBLIC ATTR_NOTHROW WEAK size_t KCALL
+pipebuffer_getlimit(struct pipebuffer *__restrict self) {
+ return ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FMASK;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_setlimit(struct pipebuffer *__restrict self, size_t new_limit) {
+ size_t old_limit;
+ if unlikely(new_limit > CONFIG_PIPE_MAX_LIMIT)
+    error_throw(E_INVALID_ARGUMENT);
+ new_limit = CEIL_ALIGN(new_limit,PIPE_PAGESIZE);
+ if unlikely(!new_limit)
+    new_limit = PIPE_PAGESIZE;
+ atomic_rwlock_write(&self->pb_lock);
+ if unlikely(self->pb_size > new_limit) {
+  atomic_rwlock_endwrite(&self->pb_lock);
+  error_throwf(E_FILESYSTEM_ERROR,ERROR_FS_OBJECT_IS_BUSY);
+ }
+ old_limit = self->pb_limt;
+ self->pb_limt = (old_limit & ~PIPEBUFFER_LIMT_FMASK) | new_limit;
+ atomic_rwlock_endwrite(&self->pb_lock);
+ /* Wake writers if the buffer just grew. */
+ if (new_limit > (old_limit & PIPEBUFFER_LIMT_FMASK))
+     sig_broadcast_channel(&self->pb_stat,PIPEBUF_STATE_CHANNEL_NOTFULL);
+ return new_limit;
+}
+
+
+PUBLIC size_t KCALL
+pipebuffer_unread(struct pipebuffer *__restrict self, size_t num_bytes) {
+ size_t result = 0;
+ bool was_empty;
+ mutex_get(&self->pb_rlock);
+ atomic_rwlock_write(&self->pb_lock);
+ was_empty = self->pb_size == 0;
+ if (self->pb_count) {
+  struct pipe_slot *slot = &self->pb_slotv[self->pb_first];
+  result = MIN(num_bytes,self->pb_unread);
+  assert(result <= slot->ps_offset);
+  slot->ps_offset -= result;
+  slot->ps_length += result;
+  self->pb_unread -= result;
+  self->pb_size   += result;
+ }
+ atomic_rwlock_endwrite(&self->pb_lock);
+ mutex_put(&self->pb_rlock);
+ if (result && was_empty)
+     sig_broadcast(&self->pb_stat);
+ return result;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_unwrite(struct pipebuffer *__restrict self, size_t num_bytes) {
+ struct pipebuffer *EXCEPT_VAR xself = self;
+ struct pipe_page *chain = NULL;
+ size_t result = 0;
+ bool was_full,is_empty;
+ mutex_get(&self->pb_rlock);
+ TRY {
+  mutex_get(&self->pb_wlock);
+  atomic_rwlock_write(&self->pb_lock);
+  was_full = pipebuffer_space_locked(self) == 0;
+  while (result < num_bytes && self->pb_count) {
+   struct pipe_slot *tail = PIPEBUFFER_TAIL(self);
+   size_t part = MIN(tail->ps_length,num_bytes-result);
+   tail->ps_length -= part;
+   result          += part;
+   if (!tail->ps_length) {
+    pipebuffer_droppage_locked(self,tail->ps_page,&chain);
+    if (!--self->pb_count)
+         self->pb_unread = 0;
+   }
+  }
+  self->pb_size -= result;
+  is_empty = self->pb_size == 0;
+  atomic_rwlock_endwrite(&self->pb_lock);
+  mutex_put(&self->pb_wlock);
+ } FINALLY {
+  mutex_put(&xself->pb_rlock);
+ }
+ pipe_page_freechain(chain);
+ if (result) {
+  if (was_full)
+      sig_broadcast_channel(&self->pb_stat,PIPEBUF_STATE_CHANNEL_NOTFULL);
+  if (is_empty)
+      sig_broadcast_channel(&self->pb_stat,PIPEBUF_STATE_CHANNEL_EMPTY);
+ }
+ return result;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_discard(struct pipebuffer *__restrict self, size_t num_bytes) {
+ size_t result;
+ mutex_get(&self->pb_rlock);
+ result = pipebuffer_take(self,num_bytes);
+ mutex_put(&self->pb_rlock);
+ return result;
+}
+
+
+
+/* [locked(self->pb_wlock)] */
+PRIVATE size_t KCALL
+pipebuffer_produce_atomic(struct pipebuffer *__restrict self,
+                          size_t num_bytes, pipebuffer_produce_t func,
+                          void *arg, bool *__restrict pdone) {
+ struct pipebuffer *EXCEPT_VAR xself = self;
+ size_t result = 0;
+ while (result < num_bytes) {
+  REF struct pipe_page *EXCEPT_VAR page;
+  size_t dst_offset = 0;
+  size_t max_write,part;
+  /* Make sure that a new slot can be added. */
+  pipebuffer_reserve(self);
+  atomic_rwlock_write(&self->pb_lock);
+  max_write = pipebuffer_space_locked(self);
+  if (!max_write || (self->pb_limt & PIPEBUFFER_LIMT_FCLOSED)) {
+   atomic_rwlock_endwrite(&self->pb_lock);
+   break;
+  }
+  /* Try to append to the last page before starting a new one. */
+  page = pipebuffer_tailpage_locked(self,&dst_offset);
+  if (!page) {
+   page = self->pb_spare;
+   self->pb_spare = NULL;
+  }
+  atomic_rwlock_endwrite(&self->pb_lock);
+  if (!page)
+       page = pipe_page_alloc();
+  part = PIPE_PAGESIZE-dst_offset;
+  if (part > max_write) part = max_write;
+  if (part > num_bytes-result)
+      part = num_bytes-result;
+  /* Have the caller fill in data directly within the page. */
+  TRY {
+   max_write = (*func)(arg,page->pp_data+dst_offset,part);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   pipebuffer_droppage(xself,page);
+   error_rethrow();
+  }
+  assert(max_write <= part);
+  if (max_write)
+       pipebuffer_commit(self,page,dst_offset,max_write);
+  else pipebuffer_droppage(self,page);
+  result += max_write;
+  if (max_write < part) {
+   /* The producer is done. */
+   *pdone = true;
+   break;
+  }
+ }
+ return result;
+}
+
+/* [locked(self->pb_rlock)] */
+PRIVATE size_t KCALL
+pipebuffer_consume_atomic(struct pipebuffer *__restrict self,
+                          size_t num_bytes, pipebuffer_consume_t func,
+                          void *arg, bool *__restrict pdone) {
+ size_t result = 0;
+ while (result < num_bytes) {
+  struct pipe_slot slot;
+  size_t part,count;
+  atomic_rwlock_read(&self->pb_lock);
+  if (!self->pb_count) {
+   atomic_rwlock_endread(&self->pb_lock);
+   break;
+  }
+  /* NOTE: Since we're holding `pb_rlock', nobody
+   *       else can remove the first slot's page. */
+  slot = self->pb_slotv[self->pb_first];
+  atomic_rwlock_endread(&self->pb_lock);
+  part = MIN(slot.ps_length,num_bytes-result);
+  count = (*func)(arg,slot.ps_page->pp_data+slot.ps_offset,part);
+  assert(count <= part);
+  if (count)
+      pipebuffer_take(self,count);
+  result += count;
+  if (count < part) {
+   /* The consumer is done. */
+   *pdone = true;
+   break;
+  }
+ }
+ return result;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_produce(struct pipebuffer *__restrict self, size_t num_bytes,
+                   iomode_t mode, pipebuffer_produce_t func, void *arg) {
+ struct pipebuffer *EXCEPT_VAR xself = self;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ bool done = false;
+ for (;;) {
+  mutex_getf(&self->pb_wlock,mode);
+  TRY {
+   result = pipebuffer_produce_atomic(self,num_bytes,func,arg,&done);
+  } FINALLY {
+   mutex_put(&xself->pb_wlock);
+  }
+  if (result || done || !num_bytes || (mode & IO_NONBLOCK) ||
+     (ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FCLOSED))
+      break;
+  /* Wait for space to become available. */
+  pipebuffer_wait(self,PIPEBUF_STATE_CHANNEL_NOTFULL,&pipebuffer_canwrite);
+ }
+ return result;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_consume(struct pipebuffer *__restrict self, size_t num_bytes,
+                   iomode_t mode, pipebuffer_consume_t func, void *arg) {
+ struct pipebuffer *EXCEPT_VAR xself = self;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ bool done = false;
+ for (;;) {
+  mutex_getf(&self->pb_rlock,mode);
+  TRY {
+   result = pipebuffer_consume_atomic(self,num_bytes,func,arg,&done);
+  } FINALLY {
+   mutex_put(&xself->pb_rlock);
+  }
+  if (result || done || !num_bytes || (mode & IO_NONBLOCK) ||
+     (ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FCLOSED))
+      break;
+  /* Wait for data to become available. */
+  pipebuffer_wait(self,0,&pipebuffer_canread);
+ }
+ return result;
+}
+
+
+struct iov_cursor {
+    USER CHECKED struct iovec const *ic_iov;    /* [1..1] The I/O vector. */
+    size_t                           ic_offset; /* Current offset into `ic_iov' */
+    iomode_t                         ic_mode;   /* I/O mode for `iov_read()' / `iov_write()' */
+};
+
+PRIVATE size_t KCALL
+iov_produce(struct iov_cursor *__restrict self,
+            byte_t *__restrict dst, size_t num_bytes) {
+ iov_read(dst,self->ic_iov,self->ic_offset,num_bytes,self->ic_mode);
+ self->ic_offset += num_bytes;
+ return num_bytes;
+}
+PRIVATE size_t KCALL
+iov_consume(struct iov_cursor *__restrict self,
+            byte_t const *__restrict src, size_t num_bytes) {
+ iov_write(self->ic_iov,self->ic_offset,src,num_bytes,self->ic_mode);
+ self->ic_offset += num_bytes;
+ return num_bytes;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_readv(struct pipebuffer *__restrict self,
+                 USER CHECKED struct iovec const *iov,
+                 size_t iov_offset, size_t num_bytes,
+                 iomode_t mode) {
+ struct iov_cursor cursor;
+ cursor.ic_iov    = iov;
+ cursor.ic_offset = iov_offset;
+ cursor.ic_mode   = mode;
+ return pipebuffer_consume(self,num_bytes,mode,
+                          (pipebuffer_consume_t)&iov_consume,
+                          &cursor);
+}
+PUBLIC size_t KCALL
+pipebuffer_writev(struct pipebuffer *__restrict self,
+                  USER CHECKED struct iovec const *iov,
+                  size_t iov_offset, size_t num_bytes,
+                  iomode_t mode) {
+ struct iov_cursor cursor;
+ cursor.ic_iov    = iov;
+ cursor.ic_offset = iov_offset;
+ cursor.ic_mode   = mode;
+ return pipebuffer_produce(self,num_bytes,mode,
+                          (pipebuffer_produce_t)&iov_produce,
+                          &cursor);
+}
+PUBLIC size_t KCALL
+pipebuffer_read(struct pipebuffer *__restrict self,
+                USER CHECKED void *buf, size_t num_bytes,
+                iomode_t mode) {
+ struct iovec iov[1];
+ iov[0].iov_base = buf;
+ iov[0].iov_len  = num_bytes;
+ return pipebuffer_readv(self,iov,0,num_bytes,mode|IO_NOIOVCHECK);
+}
+PUBLIC size_t KCALL
+pipebuffer_write(struct pipebuffer *__restrict self,
+                 USER CHECKED void const *buf,
+                 size_t num_bytes, iomode_t mode) {
+ struct iovec iov[1];
+ iov[0].iov_base = (void *)buf;
+ iov[0].iov_len  = num_bytes;
+ return pipebuffer_writev(self,iov,0,num_bytes,mode|IO_NOIOVCHECK);
+}
+
+
+
+PRIVATE size_t KCALL
+copy_produce(byte_t const **__restrict psrc,
+             byte_t *__restrict dst, size_t num_bytes) {
+ memcpy(dst,*psrc,num_bytes);
+ *psrc += num_bytes;
+ return num_bytes;
+}
+
+/* [locked(self->pb_wlock)]
+ * Insert up to `length' bytes of data from `page' at `offset'.
+ * Large blocks are inserted by sharing the page, but small
+ * ones are copied to prevent slots from being wasted.
+ * @return: * : The number of inserted bytes (ZERO(0) if the buffer is full) */
+PRIVATE size_t KCALL
+pipebuffer_insert(struct pipebuffer *__restrict self,
+                  struct pipe_page *__restrict page,
+                  size_t offset, size_t length) {
+ byte_t const *src; bool done;
+ if (length >= CONFIG_PIPEBUFFER_SHARE_THRESHOLD) {
+  size_t limit;
+  pipebuffer_reserve(self);
+  atomic_rwlock_write(&self->pb_lock);
+  limit = self->pb_limt & PIPEBUFFER_LIMT_FMASK;
+  if (!(self->pb_limt & PIPEBUFFER_LIMT_FCLOSED) &&
+        self->pb_count < PIPEBUFFER_MAXSLOTS(limit) &&
+        self->pb_size < limit) {
+   bool was_empty = self->pb_size == 0;
+   if (length > limit-self->pb_size)
+       length = limit-self->pb_size;
+   pipe_page_incref(page);
+   pipebuffer_push_locked(self,page,offset,length);
+   atomic_rwlock_endwrite(&self->pb_lock);
+   if (was_empty)
+       sig_broadcast(&self->pb_stat);
+   return length;
+  }
+  atomic_rwlock_endwrite(&self->pb_lock);
+ }
+ /* Copy the data. */
+ src = page->pp_data+offset;
+ return pipebuffer_produce_atomic(self,length,
+                                 (pipebuffer_produce_t)&copy_produce,
+                                 (void *)&src,&done);
+}
+
+/* [locked(src->pb_rlock)][locked(dst->pb_wlock)] */
+PRIVATE size_t KCALL
+pipebuffer_splice_atomic(struct pipebuffer *__restrict dst,
+                         struct pipebuffer *__restrict src,
+                         size_t num_bytes, bool keep) {
+ size_t result = 0,index = 0,skip = 0;
+ while (result < num_bytes) {
+  struct pipe_slot slot; size_t part;
+  atomic_rwlock_read(&src->pb_lock);
+  if (index >= src->pb_count) {
+   atomic_rwlock_endread(&src->pb_lock);
+   break;
+  }
+  slot = src->pb_slotv[(src->pb_first+index) & src->pb_slotm];
+  atomic_rwlock_endread(&src->pb_lock);
+  assert(skip < slot.ps_length);
+  part = slot.ps_length-skip;
+  if (part > num_bytes-result)
+      part = num_bytes-result;
+  part = pipebuffer_insert(dst,slot.ps_page,slot.ps_offset+skip,part);
+  if (!part) break; /* `dst' is full. */
+  result += part;
+  if (keep) {
+   /* Move on to the next slot. */
+   skip += part;
+   if (skip >= slot.ps_length)
+       ++index,skip = 0;
+  } else {
+   pipebuffer_take(src,part);
+  }
+ }
+ return result;
+}
+
+PUBLIC size_t KCALL
+pipebuffer_splice(struct pipebuffer *__restrict dst,
+                  struct pipebuffer *__restrict src,
+                  size_t num_bytes, iomode_t mode, bool keep) {
+ struct pipebuffer *EXCEPT_VAR xdst = dst;
+ struct pipebuffer *EXCEPT_VAR xsrc = src;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ if unlikely(dst == src)
+    error_throw(E_INVALID_ARGUMENT);
+ for (;;) {
+  mutex_getf(&src->pb_rlock,mode);
+  TRY {
+   mutex_getf(&dst->pb_wlock,mode);
+   TRY {
+    result = pipebuffer_splice_atomic(dst,src,num_bytes,keep);
+   } FINALLY {
+    mutex_put(&xdst->pb_wlock);
+   }
+  } FINALLY {
+   mutex_put(&xsrc->pb_rlock);
+  }
+  if (result || !num_bytes || (mode & IO_NONBLOCK) ||
+     (ATOMIC_READ(dst->pb_limt) & PIPEBUFFER_LIMT_FCLOSED))
+      break;
+  if (!ATOMIC_READ(src->pb_size)) {
+   if (ATOMIC_READ(src->pb_limt) & PIPEBUFFER_LIMT_FCLOSED)
+       break; /* End of input. */
+   pipebuffer_wait(src,0,&pipebuffer_canread);
+  } else {
+   pipebuffer_wait(dst,PIPEBUF_STATE_CHANNEL_NOTFULL,&pipebuffer_canwrite);
+  }
+ }
+ return result;
+}
+
+
+PUBLIC unsigned int KCALL
+pipebuffer_poll(struct pipebuffer *__restrict self, unsigned int mode) {
+ unsigned int result = 0;
+ if (mode & POLLOUT) {
+  /* Open the channel for non-full buffers
+   * if we're polling for that condition. */
+  task_openchannel(PIPEBUF_STATE_CHANNEL_NOTFULL);
+  COMPILER_BARRIER();
+ }
+ /* Connect to the state-changed signal.
+  * NOTE: Use ghost connections to prevent the deadlock
+  *       scenario described by `task_connect_ghost()' */
+ task_connect_ghost(&self->pb_stat);
+ atomic_rwlock_read(&self->pb_lock);
+ if ((mode & POLLIN) && self->pb_size)
+      result |= POLLIN;
+ if ((mode & POLLOUT) && pipebuffer_space_locked(self))
+      result |= POLLOUT;
+ atomic_rwlock_endread(&self->pb_lock);
+ if (ATOMIC_READ(self->pb_limt) & PIPEBUFFER_LIMT_FCLOSED)
+     result |= POLLHUP; /* Buffer closed. -> hang-up */
+ return result;
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_SRC_FS_PIPEBUFFER_C */
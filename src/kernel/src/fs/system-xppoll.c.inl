@@ -147,6 +147,9 @@ child_died:
    if (!(info.pp_options & WEXITED)) continue; /* Don't wait for exited child processes. */
    /* Remove this child's zombie corpse when `WNOREAP' isn't set. */
    if (!(info.pp_options & WNOREAP)) {
+    /* Account the CPU time of the reaped child. */
+    FORTASK(my_process,_this_cputime).tc_child_user   += child->tp_utime;
+    FORTASK(my_process,_this_cputime).tc_child_system += child->tp_stime;
     LIST_REMOVE(child,tp_siblings); /* Inherit reference. */
     child->tp_siblings.le_pself = NULL;
     child->tp_siblings.le_next  = NULL;
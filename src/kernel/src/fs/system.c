@@ -36,6 +36,7 @@
 #include <fs/handle.h>
 #include <fs/path.h>
 #include <fs/file.h>
+#include <fs/loop.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <dirent.h>
@@ -43,6 +44,7 @@
 #include <string.h>
 #include <sched/group.h>
 #include <sched/pid.h>
+#include <sched/cputime.h>
 #include <sched/async_signal.h>
 #include <sched/userstack.h>
 #include <sched/posix_signals.h>
@@ -1689,9 +1691,24 @@ exec_user(struct exec_args *__restrict args,
   TRY {
    /* Reset all signal actions of the calling thread to their default disposition. */
    signal_resetexec();
-   /* With that out of the way, unmap _everything_ from user-space. */
-   vm_unmap_userspace();
-   pagedir_syncall();
+   if (ATOMIC_READ(THIS_VM->vm_refcnt) == 1) {
+    /* With that out of the way, unmap _everything_ from user-space. */
+    vm_unmap_userspace();
+    pagedir_syncall();
+   } else {
+    /* The VM is shared with some other process (most notably our
+     * parent when we were created by `vfork()'), meaning we mustn't
+     * touch its mappings. Instead, switch to a new, empty VM. */
+    REF struct vm *EXCEPT_VAR new_vm;
+    new_vm = vm_alloc();
+    TRY {
+     task_setvm(new_vm);
+    } FINALLY {
+     vm_decref(new_vm);
+    }
+   }
+   /* Now that we're no longer using its VM, resume our vfork()-parent. */
+   task_vfork_release();
 
    /* Update the thread configuration to indicate that stack and segments are gone. */
    PERTASK_AND(this_task.t_flags,~(TASK_FOWNUSERSEG));
@@ -2568,9 +2585,14 @@ DEFINE_SYSCALL5(mount,
                        (struct inode **)&dev_node,FS_DEFAULT_ATMODE);
     path_decref(dev_path);
     TRY {
-     if (!S_ISBLK(dev_node->i_attr.a_mode))
-          error_throw(E_INVALID_ARGUMENT); /* TODO: Loopback devices. */
-     inode_device = lookup_block_device(dev_node->i_attr.a_rdev);
+     if (S_ISREG(dev_node->i_attr.a_mode)) {
+      /* Automatically setup a loop device. */
+      inode_device = loop_open_anonymous(dev_node,(flags & MS_RDONLY) != 0);
+     } else {
+      if (!S_ISBLK(dev_node->i_attr.a_mode))
+           error_throw(E_INVALID_ARGUMENT);
+      inode_device = lookup_block_device(dev_node->i_attr.a_rdev);
+     }
     } FINALLY {
      inode_decref(dev_node);
     }
@@ -2596,10 +2618,15 @@ DEFINE_SYSCALL5(mount,
                         (struct inode **)&dev_node,FS_DEFAULT_ATMODE);
       path_decref(dev_path);
       TRY {
-       if (!S_ISBLK(dev_node->i_attr.a_mode))
-            error_throw(E_INVALID_ARGUMENT); /* TODO: Loopback devices. */
-       /* Lookup the pointed-to block device. */
-       inode_device = lookup_block_device(dev_node->i_attr.a_rdev);
+       if (S_ISREG(dev_node->i_attr.a_mode)) {
+        /* Automatically setup a loop device. */
+        inode_device = loop_open_anonymous(dev_node,(flags & MS_RDONLY) != 0);
+       } else {
+        if (!S_ISBLK(dev_node->i_attr.a_mode))
+             error_throw(E_INVALID_ARGUMENT);
+        /* Lookup the pointed-to block device. */
+        inode_device = lookup_block_device(dev_node->i_attr.a_rdev);
+       }
       } FINALLY {
        inode_decref(dev_node);
       }
@@ -426,6 +426,33 @@ page_free(pageptr_t base, size_t num_pages) {
 }
 
 
+PUBLIC ATTR_NOTHROW pageptr_t KCALL
+page_trymalloc_aligned(size_t num_pages, mzone_t max_zone) {
+ mzone_t zone_id = max_zone+1;
+ assert(num_pages != 0);
+ assert((num_pages & (num_pages-1)) == 0);
+ assert(max_zone < mzone_count);
+ while (zone_id--) {
+  struct mzone *zone = mzones[zone_id];
+  pageptr_t iter;
+  if (zone->mz_free < num_pages)
+      continue; /* Quick check: this zone is too full. */
+  iter = CEIL_ALIGN(zone->mz_min,num_pages);
+  for (; iter >= zone->mz_min &&
+         iter+num_pages-1 <= zone->mz_max;
+         iter += num_pages) {
+   if (mzone_malloc_at(zone,iter - zone->mz_min,num_pages)) {
+#ifdef CONFIG_LOG_PAGE_ALLOCATIONS
+    debug_printf("ALLOC_ALIGNED(%p...%p)\n",
+                (iter)*PAGESIZE,(iter+num_pages)*PAGESIZE-1);
+#endif
+    return iter;
+   }
+  }
+ }
+ return (pageptr_t)-1;
+}
+
 PUBLIC bool KCALL
 page_malloc_at(pageptr_t base, size_t num_pages) {
  mzone_t i = mzone_count;
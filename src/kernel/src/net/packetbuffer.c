@@ -99,15 +99,18 @@ packetbuffer_close(struct packetbuffer *__restrict self) {
 
 
 
-/* Just as `packetbuffer_readv' is for `packetbuffer_read', allow
- * the user-space target buffer to be located in more than one place.
- * @param: pbufsize: Upon entry, contains the total sum of bytes found in `iov'
- * @param: pbufsize: Upon exit, store the total amount of required buffer space here. */
+/* An extended variant of `packetbuffer_readva()' which can be used to
+ * continue filling an IO vector that was already partially filled.
+ * @param: iov_offset: Offset from the start of the iov vector, describing
+ *                     a number of bytes that should be skipped.
+ * @param: pbufsize:   Upon entry, contains the total sum of bytes found in `iov' (excluding `iov_offset')
+ * @param: pbufsize:   Upon exit, store the total amount of required buffer space here. */
 PUBLIC bool KCALL
-packetbuffer_readva(struct packetbuffer *__restrict self,
-                    USER CHECKED struct iovec const *iov, size_t *__restrict pbufsize,
-                    HOST void *anc_buffer, size_t *__restrict pancsize,
-                    iomode_t mode, packet_iomode_t packet_mode) {
+packetbuffer_reada_vio(struct packetbuffer *__restrict self,
+                       USER CHECKED struct iovec const *iov,
+                       size_t iov_offset, size_t *__restrict pbufsize,
+                       HOST void *anc_buffer, size_t *__restrict pancsize,
+                       iomode_t mode, packet_iomode_t packet_mode) {
  struct packetbuffer *EXCEPT_VAR xself = self;
  bool COMPILER_IGNORE_UNINITIALIZED(result);
  size_t buffer_mask,num_bytes;
@@ -155,21 +158,24 @@ again_locked:
           CEIL_ALIGN(header.p_ancillary,PACKET_BUFFER_ALIGNMENT)+
           sizeof(header) <= header.p_total);
 
-   /* Save the payload size as the total required size. */
-   *pbufsize = header.p_payload;
+   assert(header.p_consumed <= header.p_payload);
+
+   /* Save the remaining payload size as the total required size. */
+   *pbufsize = header.p_payload - header.p_consumed;
 
    /* Copy the packet's actual payload. */
    {
 #if 1
     size_t high_size;
-    u16 payload_addr = (state.pbs_addr + sizeof(header)) & buffer_mask;
-    size_t written_size = MIN(header.p_payload,num_bytes);
+    size_t payload_size = header.p_payload - header.p_consumed;
+    u16 payload_addr = (state.pbs_addr + sizeof(header) + header.p_consumed) & buffer_mask;
+    size_t written_size = MIN(payload_size,num_bytes);
     high_size = (buffer_mask+1) - payload_addr;
     if (high_size >= written_size) {
-     iov_write(iov,0,self->pb_base + payload_addr,written_size,mode);
+     iov_write(iov,iov_offset,self->pb_base + payload_addr,written_size,mode);
     } else {
-     iov_write(iov,0,self->pb_base + payload_addr,high_size,mode);
-     iov_write(iov,high_size,self->pb_base,
+     iov_write(iov,iov_offset,self->pb_base + payload_addr,high_size,mode);
+     iov_write(iov,iov_offset+high_size,self->pb_base,
                written_size-high_size,mode);
     }
 #else
@@ -218,7 +224,7 @@ again_locked:
     if (packet_mode & PACKET_IO_FRDNEVER)
         result = false;
     else if ((packet_mode & PACKET_IO_FRDIFFIT) &&
-             (written_size < header.p_payload)) {
+             (written_size < payload_size)) {
      if (packet_mode & PACKET_IO_FRDTRUNC) {
       if (written_size != 0) {
        /* Special case: truncate the packet. */
@@ -227,15 +233,14 @@ again_locked:
         if (!atomic_rwlock_upgrade(&self->pb_lock))
              goto again_locked;
        }
-       /* Adjust the payload size to trim the portion that was already read. */
-       header.p_payload    -= written_size;
-       /* Adjust the buffer state to point to the new header location. */
-       new_state.pbs_addr  += written_size;
-       new_state.pbs_count -= written_size;
+       /* Mark the portion that was already read as consumed.
+        * NOTE: The header itself must remain where it is, as the
+        *       offsets of all packets must remain aligned by
+        *      `PACKET_BUFFER_ALIGNMENT', meaning that the packet's
+        *       memory is only released once it was fully read. */
+       header.p_consumed += (u16)written_size;
        /* Write the updated packet header. */
-       GETL(state.pbs_addr + 0) = ((u32 *)&header)[0];
-       GETL(state.pbs_addr + 4) = ((u32 *)&header)[1];
-       ATOMIC_WRITE(self->pb_state.pbs_state,new_state.pbs_state);
+       GETW(state.pbs_addr + offsetof(struct packet_header,p_consumed)) = header.p_consumed;
        /* Since we were allowed to truncate the buffer, the
         * required buffer size is only what we actually wrote. */
        *pbufsize = written_size;
@@ -367,6 +372,7 @@ packetbuffer_writea_vio(struct packetbuffer *__restrict self,
  header.p_total    &= ~(PACKET_BUFFER_ALIGNMENT-1);
  header.p_payload   = (u16)num_bytes;
  header.p_ancillary = (u16)ancsize;
+ header.p_consumed  = 0;
 again:
  atomic_rwlock_write(&self->pb_lock);
  if unlikely(header.p_total >
@@ -380,11 +386,12 @@ again:
  if (header.p_total <= size_avail) {
   /* Can immediately write the packet. */
   bool was_empty;
-  u16 packet_address,high_size;
+  u16 packet_address,packet_start,high_size;
   was_empty = self->pb_state.pbs_count == 0;
   packet_address  = self->pb_state.pbs_addr;
   packet_address += self->pb_state.pbs_count;
   packet_address &= self->pb_mask;
+  packet_start    = packet_address;
 
   high_size = (self->pb_mask+1)-packet_address;
   if unlikely(sizeof(header) > high_size) {
@@ -429,6 +436,7 @@ again:
 
    /* And finally, update the buffer state to include the new packet. */
    self->pb_state.pbs_count += header.p_total;
+   self->pb_last             = packet_start;
   } FINALLY {
    atomic_rwlock_endwrite(&self->pb_lock);
   }
@@ -498,6 +506,11 @@ again:
       }
      }
     }
+    /* Packets that were wrapped to the start of the
+     * old buffer have now been moved into extended memory. */
+    if (self->pb_state.pbs_count &&
+        self->pb_last < self->pb_state.pbs_addr)
+        self->pb_last += self->pb_mask+1;
     /* Install the new buffer. */
     new_buffer = XCH(self->pb_base,new_buffer);
     self->pb_mask = new_mask;
@@ -594,6 +607,70 @@ packet_too_large:
 
 
 
+/* Try to append data to the most recently written packet, rather than
+ * constructing a new one. This is used to coalesce small writes to
+ * stream-oriented buffers, where packet boundaries don't matter. */
+PUBLIC bool KCALL
+packetbuffer_append_vio(struct packetbuffer *__restrict self,
+                        USER CHECKED struct iovec const *iov,
+                        size_t iov_offset, size_t num_bytes,
+                        size_t max_payload, iomode_t mode) {
+ struct packetbuffer *EXCEPT_VAR xself = self;
+ struct packet_header header;
+ bool result = false;
+ atomic_rwlock_write(&self->pb_lock);
+ TRY {
+  size_t new_total,size_avail,high_size;
+  u16 payload_end;
+  if (!self->pb_state.pbs_count ||
+      (self->pb_limt & PBUFFER_LIMT_FCLOSED))
+       goto done; /* No packet to append to. */
+  assert(IS_ALIGNED(self->pb_last,PACKET_BUFFER_ALIGNMENT));
+  ((u32 *)&header)[0] = GETL(self->pb_last+0);
+  ((u32 *)&header)[1] = GETL(self->pb_last+4);
+  if (header.p_ancillary)
+      goto done; /* Ancillary data follows the payload. */
+  if (header.p_payload+num_bytes > max_payload ||
+      header.p_payload+num_bytes > (u16)-1)
+      goto done; /* The packet would become too large. */
+  new_total  = num_bytes+header.p_payload+sizeof(header);
+  new_total += PACKET_BUFFER_ALIGNMENT-1;
+  new_total &= ~(PACKET_BUFFER_ALIGNMENT-1);
+  if (new_total > (self->pb_limt & PBUFFER_LIMT_FMASK) ||
+      new_total > (u16)-1)
+      goto done;
+  size_avail  = (self->pb_mask+1);
+  size_avail -= self->pb_state.pbs_count;
+  if (new_total-header.p_total > size_avail)
+      goto done; /* Not enough space (don't wait for any) */
+  /* Read the new data into the end of the existing payload. */
+  payload_end  = self->pb_last+sizeof(header)+header.p_payload;
+  payload_end &= self->pb_mask;
+  high_size = (self->pb_mask+1)-payload_end;
+  if (high_size >= num_bytes) {
+   iov_read(self->pb_base+payload_end,iov,iov_offset,num_bytes,mode);
+  } else {
+   iov_read(self->pb_base+payload_end,iov,iov_offset,high_size,mode);
+   iov_read(self->pb_base,iov,iov_offset+high_size,num_bytes-high_size,mode);
+  }
+  COMPILER_BARRIER();
+  /* Update the packet header, and account for the additional memory. */
+  self->pb_state.pbs_count += (u16)(new_total-header.p_total);
+  header.p_payload += (u16)num_bytes;
+  header.p_total    = (u16)new_total;
+  GETL(self->pb_last+0) = ((u32 *)&header)[0];
+  GETL(self->pb_last+4) = ((u32 *)&header)[1];
+  result = true;
+done:
+  ;
+ } FINALLY {
+  atomic_rwlock_endwrite(&xself->pb_lock);
+ }
+ return result;
+}
+
+
+
 
 
 DECL_END
@@ -31,7 +31,10 @@
 #include <fs/linker.h>
 #include <fs/driver.h>
 #include <kernel/bind.h>
+#include <sched/task.h>
+#include <sched/posix_signals.h>
 #include <sys/uio.h>
+#include <signal.h>
 
 DECL_BEGIN
 
@@ -1384,6 +1387,26 @@ handle_socket_write(struct socket *__restrict self,
 DEFINE_INTERN_ALIAS(handle_socket_poll,socket_poll);
 
 
+PUBLIC ATTR_NORETURN void KCALL
+socket_throw_broken_pipe(packet_iomode_t packet_mode) {
+ if (!(packet_mode & PACKET_IO_FWRNOSIGNAL)) {
+  siginfo_t info;
+  memset(&info,0,sizeof(siginfo_t));
+  info.si_signo = SIGPIPE+1;
+  info.si_code  = SI_KERNEL;
+  /* Raising a signal in the calling thread throws `E_INTERRUPT', so
+   * that it gets served before returning to user-space. But that also
+   * happens when any other exception is propagated there, so we can
+   * just replace it with the broken-pipe error below. */
+  TRY {
+   signal_raise_thread(THIS_TASK,&info);
+  } CATCH_HANDLED (E_INTERRUPT) {
+  }
+ }
+ throw_net_error(ERROR_NET_BROKEN_PIPE);
+}
+
+
 
 DECL_END
 
@@ -0,0 +1,339 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_SRC_SCHED_CPUTIME_C
+#define GUARD_KERNEL_SRC_SCHED_CPUTIME_C 1
+#define _KOS_SOURCE 1
+#define _GNU_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <hybrid/sync/atomic-rwlock.h>
+#include <kos/types.h>
+#include <kernel/sections.h>
+#include <kernel/syscall.h>
+#include <kernel/user.h>
+#include <sched/task.h>
+#include <sched/group.h>
+#include <sched/signal.h>
+#include <sched/cputime.h>
+#include <dev/wall.h>
+#include <bits/resource.h>
+#include <sys/times.h>
+#include <string.h>
+#include <except.h>
+#include <time.h>
+
+DECL_BEGIN
+
+STATIC_ASSERT(offsetof(struct taskcputime,tc_user)          == TASKCPUTIME_OFFSETOF_USER);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_system)        == TASKCPUTIME_OFFSETOF_SYSTEM);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_irq)           == TASKCPUTIME_OFFSETOF_IRQ);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_wait)          == TASKCPUTIME_OFFSETOF_WAIT);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_stamp)         == TASKCPUTIME_OFFSETOF_STAMP);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_exited_user)   == TASKCPUTIME_OFFSETOF_EXITED_USER);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_exited_system) == TASKCPUTIME_OFFSETOF_EXITED_SYSTEM);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_child_user)    == TASKCPUTIME_OFFSETOF_CHILD_USER);
+STATIC_ASSERT(offsetof(struct taskcputime,tc_child_system)  == TASKCPUTIME_OFFSETOF_CHILD_SYSTEM);
+STATIC_ASSERT(sizeof(struct taskcputime) == TASKCPUTIME_SIZE);
+STATIC_ASSERT(offsetof(struct cpucputime,cc_user)   == CPUCPUTIME_OFFSETOF_USER);
+STATIC_ASSERT(offsetof(struct cpucputime,cc_system) == CPUCPUTIME_OFFSETOF_SYSTEM);
+STATIC_ASSERT(offsetof(struct cpucputime,cc_wait)   == CPUCPUTIME_OFFSETOF_WAIT);
+STATIC_ASSERT(sizeof(struct cpucputime) == CPUCPUTIME_SIZE);
+/* The assembly accounting macros rely on these being identical. */
+STATIC_ASSERT(CPUCPUTIME_OFFSETOF_USER   == TASKCPUTIME_OFFSETOF_USER);
+STATIC_ASSERT(CPUCPUTIME_OFFSETOF_SYSTEM == TASKCPUTIME_OFFSETOF_SYSTEM);
+
+/* CPU time accounting (ZERO-initialized). */
+PUBLIC ATTR_PERTASK struct taskcputime _this_cputime = { 0 };
+PUBLIC ATTR_PERCPU struct cpucputime _this_cpucputime = { 0 };
+
+PUBLIC u64 _cputime_hz ASMNAME("cputime_hz") = 0;
+PUBLIC u32 _cputime_flags ASMNAME("cputime_flags") = CPUTIME_FNORMAL;
+
+/* Publish the TSC frequency in the PROCINFO USHARE segment. */
+INTDEF ATTR_FREETEXT void KCALL procinfo_settsc(u64 hz, u32 flags);
+
+PUBLIC ATTR_FREETEXT void KCALL
+cputime_calibrate(u64 hz, u32 flags) {
+ if unlikely(!hz) return;
+ flags |= CPUTIME_FCALIBRATED;
+ _cputime_hz    = hz;
+ _cputime_flags = flags;
+ procinfo_settsc(hz,flags);
+}
+
+/* Convert `cycles' into units of `1/unit' seconds. */
+LOCAL u64 KCALL
+cputime_convert(u64 cycles, u64 unit) {
+ u64 hz = cputime_hz;
+ if unlikely(!hz) return cycles;
+ /* Split the division to prevent the multiplication from overflowing. */
+ return (cycles / hz) * unit +
+       ((cycles % hz) * unit) / hz;
+}
+PUBLIC ATTR_PURE u64 KCALL
+cputime_to_nsec(u64 cycles) {
+ return cputime_convert(cycles,1000000000);
+}
+PUBLIC ATTR_PURE u64 KCALL
+cputime_to_usec(u64 cycles) {
+ return cputime_convert(cycles,1000000);
+}
+
+
+PUBLIC ASYNCSAFE void KCALL cputime_sync(void) {
+ struct taskcputime *me; u64 now;
+ pflag_t was = PREEMPTION_PUSHOFF();
+ me  = &THIS_CPUTIME;
+ now = CPUTIME_CLOCK();
+ if likely(me->tc_stamp) {
+  u64 delta = now - me->tc_stamp;
+  me->tc_system               += delta;
+  THIS_CPUCPUTIME.cc_system += delta;
+ }
+ me->tc_stamp = now;
+ PREEMPTION_POP(was);
+}
+
+PUBLIC NOIRQ void FCALL
+cputime_resume(struct task *__restrict new_task) {
+ struct taskcputime *info;
+ u64 now = CPUTIME_CLOCK();
+ info = &FORTASK(new_task,_this_cputime);
+ if likely(info->tc_stamp) {
+  u64 delta = now - info->tc_stamp;
+  info->tc_wait             += delta;
+  THIS_CPUCPUTIME.cc_wait += delta;
+ }
+ info->tc_stamp = now;
+}
+
+PUBLIC NOIRQ void FCALL
+cputime_switch(struct task *__restrict old_task,
+               struct task *__restrict new_task) {
+ struct taskcputime *info;
+ u64 now = CPUTIME_CLOCK();
+ info = &FORTASK(old_task,_this_cputime);
+ if likely(info->tc_stamp) {
+  u64 delta = now - info->tc_stamp;
+  /* Charge the old thread based on where it was interrupted. */
+#if defined(__i386__) || defined(__x86_64__)
+  if (X86_ANYCONTEXT_ISUSER(*old_task->t_context)) {
+   info->tc_user             += delta;
+   THIS_CPUCPUTIME.cc_user += delta;
+  } else
+#endif
+  {
+   info->tc_system             += delta;
+   THIS_CPUCPUTIME.cc_system += delta;
+  }
+ }
+ /* The old thread remains runnable (if it isn't, it'll be re-stamped once woken) */
+ info->tc_stamp = now;
+ if (new_task != old_task)
+     cputime_resume(new_task);
+}
+
+
+PUBLIC void KCALL
+cputime_getprocess(struct task *__restrict leader,
+                   u64 *__restrict putime,
+                   u64 *__restrict pstime) {
+ struct threadgroup *group;
+ struct task *thread;
+ u64 utime,stime;
+ group = &FORTASK(leader,_this_group);
+ atomic_rwlock_read(&group->tg_process.h_lock);
+ utime = FORTASK(leader,_this_cputime).tc_user+
+         FORTASK(leader,_this_cputime).tc_exited_user;
+ stime = FORTASK(leader,_this_cputime).tc_system+
+         FORTASK(leader,_this_cputime).tc_exited_system;
+ for (thread = group->tg_process.h_group; thread;
+      thread = FORTASK(thread,_this_group).tg_thread.g_group.le_next) {
+  utime += FORTASK(thread,_this_cputime).tc_user;
+  stime += FORTASK(thread,_this_cputime).tc_system;
+ }
+ atomic_rwlock_endread(&group->tg_process.h_lock);
+ *putime = utime;
+ *pstime = stime;
+}
+
+PUBLIC void KCALL
+cputime_getchildren(struct task *__restrict leader,
+                    u64 *__restrict putime,
+                    u64 *__restrict pstime) {
+ struct threadgroup *group;
+ group = &FORTASK(leader,_this_group);
+ sig_get(&group->tg_process.h_cldevent);
+ *putime = FORTASK(leader,_this_cputime).tc_child_user;
+ *pstime = FORTASK(leader,_this_cputime).tc_child_system;
+ sig_put(&group->tg_process.h_cldevent);
+}
+
+
+
+PRIVATE void KCALL
+cputime_totimeval(USER CHECKED struct timeval *tv, u64 cycles) {
+ u64 usec = cputime_to_usec(cycles);
+ tv->tv_sec  = (time_t)(usec / 1000000);
+ tv->tv_usec = (long)(usec % 1000000);
+}
+PRIVATE void KCALL
+cputime_totimespec(USER CHECKED struct timespec *ts, u64 nsec) {
+ ts->tv_sec  = (time_t)(nsec / 1000000000);
+ ts->tv_nsec = (long)(nsec % 1000000000);
+}
+
+/* Return the time since boot in nanoseconds. */
+PRIVATE u64 KCALL cputime_uptime(void) {
+ qtime_t now = qtime_now();
+ return (u64)now.qt_jiffies * (1000000000/HZ) +
+       ((u64)now.qt_qoffset * (1000000000/HZ)) / now.qt_qlength;
+}
+
+
+DEFINE_SYSCALL2(getrusage,int,who,
+                USER UNCHECKED struct rusage *,ru) {
+ u64 utime,stime;
+ validate_writable(ru,sizeof(struct rusage));
+ switch (who) {
+
+ case RUSAGE_SELF:
+  cputime_sync();
+  cputime_getprocess(get_this_process(),&utime,&stime);
+  break;
+
+ case RUSAGE_THREAD:
+  cputime_sync();
+  utime = THIS_CPUTIME.tc_user;
+  stime = THIS_CPUTIME.tc_system;
+  break;
+
+ case RUSAGE_CHILDREN:
+  cputime_getchildren(get_this_process(),&utime,&stime);
+  break;
+
+ default:
+  error_throw(E_INVALID_ARGUMENT);
+ }
+ memset(ru,0,sizeof(struct rusage));
+ cputime_totimeval(&ru->ru_utime,utime);
+ cputime_totimeval(&ru->ru_stime,stime);
+ return 0;
+}
+
+
+DEFINE_SYSCALL1(times,USER UNCHECKED struct tms *,buf) {
+ /* NOTE: Clock ticks (`sysconf(_SC_CLK_TCK)') are microseconds. */
+ if (buf) {
+  struct tms result;
+  u64 utime,stime;
+  validate_writable(buf,sizeof(struct tms));
+  cputime_sync();
+  cputime_getprocess(get_this_process(),&utime,&stime);
+  result.tms_utime = (clock_t)cputime_to_usec(utime);
+  result.tms_stime = (clock_t)cputime_to_usec(stime);
+  cputime_getchildren(get_this_process(),&utime,&stime);
+  result.tms_cutime = (clock_t)cputime_to_usec(utime);
+  result.tms_cstime = (clock_t)cputime_to_usec(stime);
+  memcpy(buf,&result,sizeof(struct tms));
+ }
+ return (syscall_slong_t)(clock_t)(cputime_uptime() / 1000);
+}
+
+
+DEFINE_SYSCALL2(clock_gettime,clockid_t,clock_id,
+                USER UNCHECKED struct timespec *,tp) {
+ u64 value;
+ validate_writable(tp,sizeof(struct timespec));
+ switch (clock_id) {
+
+ case CLOCK_REALTIME:
+ case CLOCK_REALTIME_COARSE:
+  *tp = wall_gettime(&wall_kernel);
+  return 0;
+
+ case CLOCK_MONOTONIC:
+ case CLOCK_MONOTONIC_RAW:
+ case CLOCK_BOOTTIME:
+  value = cputime_uptime();
+  break;
+
+ case CLOCK_MONOTONIC_COARSE:
+  value = (u64)jiffies * (1000000000/HZ);
+  break;
+
+ {
+  u64 utime,stime;
+ case CLOCK_PROCESS_CPUTIME_ID:
+  cputime_sync();
+  cputime_getprocess(get_this_process(),&utime,&stime);
+  value = cputime_to_nsec(utime+stime);
+ } break;
+
+ case CLOCK_THREAD_CPUTIME_ID:
+  cputime_sync();
+  value = cputime_to_nsec(THIS_CPUTIME.tc_user+
+                          THIS_CPUTIME.tc_system);
+  break;
+
+ default:
+  error_throw(E_INVALID_ARGUMENT);
+ }
+ cputime_totimespec(tp,value);
+ return 0;
+}
+
+DEFINE_SYSCALL2(clock_getres,clockid_t,clock_id,
+                USER UNCHECKED struct timespec *,res) {
+ u64 value;
+ validate_writable_opt(res,sizeof(struct timespec));
+ switch (clock_id) {
+
+ case CLOCK_REALTIME:
+ case CLOCK_REALTIME_COARSE:
+  value = 1000000000; /* The wall clock only has a resolution of seconds. */
+  break;
+
+ case CLOCK_MONOTONIC:
+ case CLOCK_MONOTONIC_RAW:
+ case CLOCK_BOOTTIME:
+  value = (1000000000/HZ) / qtime_now().qt_qlength;
+  break;
+
+ case CLOCK_MONOTONIC_COARSE:
+  value = 1000000000/HZ;
+  break;
+
+ case CLOCK_PROCESS_CPUTIME_ID:
+ case CLOCK_THREAD_CPUTIME_ID:
+  value = cputime_hz ? 1000000000 / cputime_hz : 0;
+  break;
+
+ default:
+  error_throw(E_INVALID_ARGUMENT);
+ }
+ if (!value) value = 1;
+ if (res) cputime_totimespec(res,value);
+ return 0;
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_SRC_SCHED_CPUTIME_C */
@@ -32,10 +32,12 @@
 #include <kernel/malloc.h>
 #include <kernel/sections.h>
 #include <kernel/syscall.h>
+#include <kernel/ushare.h>
 #include <sched/group.h>
 #include <sched/taskref.h>
 #include <sched/posix_signals.h>
 #include <sched/pid.h>
+#include <sched/cputime.h>
 #include <bits/signum.h>
 #include <errno.h>
 #include <assert.h>
@@ -210,6 +212,18 @@ INTERN void KCALL threadgroup_cleanup(void) {
  } else {
   status = __W_EXITCODE(0,0);
  }
+ if (get_this_process() == THIS_TASK &&
+     PERTASK_TEST(_this_pid)) {
+  struct thread_pid *mypid = PERTASK_GET(_this_pid);
+  u64 utime,stime,cutime,cstime;
+  /* Save the CPU time used by the process (and its reaped
+   * children), so our parent can account it once we get reaped. */
+  cputime_sync();
+  cputime_getprocess(THIS_TASK,&utime,&stime);
+  cputime_getchildren(THIS_TASK,&cutime,&cstime);
+  mypid->tp_utime = utime+cutime;
+  mypid->tp_stime = stime+cstime;
+ }
  /* Signal that the thread has now exited. */
  task_signal_event(__WIFEXITED(status) ? CLD_EXITED :
                    __WCOREDUMP(status) ? CLD_DUMPED :
@@ -236,13 +250,30 @@ INTERN void KCALL threadgroup_cleanup(void) {
    child->tp_siblings.le_pself = NULL;
    child->tp_siblings.le_next  = NULL;
    sig_put(&PERTASK(_this_group.tg_process.h_cldevent));
-   thread_pid_decref(child);
+   TRY {
+    REF struct task *child_thread;
+    /* Let the child know that it has been orphaned. */
+    child_thread = thread_pid_get(child);
+    if (child_thread) {
+     TRY {
+      ushare_procinfo_update(child_thread);
+     } FINALLY {
+      task_decref(child_thread);
+     }
+    }
+   } FINALLY {
+    thread_pid_decref(child);
+   }
   }
  } else {
   /* Not the leader of the thread group. */
   struct threadgroup *leader;
   leader = &FORTASK(get_this_process(),_this_group);
+  cputime_sync();
   atomic_rwlock_write(&leader->tg_process.h_lock);
+  /* Add our CPU time to that of the process. */
+  FORTASK(get_this_process(),_this_cputime).tc_exited_user   += THIS_CPUTIME.tc_user;
+  FORTASK(get_this_process(),_this_cputime).tc_exited_system += THIS_CPUTIME.tc_system;
   /* Remove the thread from its group. */
   if (PERTASK_TEST(_this_group.tg_thread.g_group.le_pself)) {
    struct task *next;
@@ -740,6 +771,7 @@ DEFINE_SYSCALL2(setpgid,pid_t,pid,pid_t,pgid) {
    * NOTE: The additional thread -> process indirection is performed by `task_set_group()' */
   task_set_group(thread,leader);
   task_decref(leader);
+  ushare_procinfo_update(thread);
  } FINALLY {
   task_decref(thread);
  }
@@ -785,6 +817,7 @@ DEFINE_SYSCALL_MUSTRESTART(setsid);
 DEFINE_SYSCALL0(setsid) {
  if (!task_set_session())
       return -EPERM;
+ ushare_procinfo_update(THIS_TASK);
  return posix_getpid();
 }
 
@@ -792,8 +825,22 @@ DEFINE_SYSCALL0(setsid) {
 INTERN void KCALL
 get_rusage(struct thread_pid *__restrict pid,
            USER CHECKED struct rusage *ru) {
- (void)pid; /* XXX: implement this? */
+ u64 utime = cputime_to_usec(pid->tp_utime);
+ u64 stime = cputime_to_usec(pid->tp_stime);
  memset(ru,0,sizeof(struct rusage));
+ ru->ru_utime.tv_sec  = (time_t)(utime / 1000000);
+ ru->ru_utime.tv_usec = (long)(utime % 1000000);
+ ru->ru_stime.tv_sec  = (time_t)(stime / 1000000);
+ ru->ru_stime.tv_usec = (long)(stime % 1000000);
+}
+
+/* Account the CPU time of a reaped child process to `process'.
+ * NOTE: The caller must be holding a lock to `h_cldevent' of `process' */
+LOCAL void KCALL
+reap_cputime(struct task *__restrict process,
+             struct thread_pid *__restrict child) {
+ FORTASK(process,_this_cputime).tc_child_user   += child->tp_utime;
+ FORTASK(process,_this_cputime).tc_child_system += child->tp_stime;
 }
 
 
@@ -837,6 +884,7 @@ reapall_check:
           !ATOMIC_READ(child->tp_task->t_refcnt) ||
            TASK_ISTERMINATED(child->tp_task)) {
        /* Detach (reap) this child. */
+       reap_cputime(my_process,child);
        LIST_REMOVE(child,tp_siblings); /* Inherit reference. */
        child->tp_siblings.le_pself = NULL;
        child->tp_siblings.le_next  = NULL;
@@ -928,6 +976,7 @@ child_died:
    if (!(options & WEXITED)) continue; /* Don't wait for exited child processes. */
    /* Remove this child's zombie corpse when `WNOREAP' isn't set. */
    if (!(options & WNOREAP)) {
+    reap_cputime(my_process,child);
     LIST_REMOVE(child,tp_siblings); /* Inherit reference. */
     child->tp_siblings.le_pself = NULL;
     child->tp_siblings.le_next  = NULL;
@@ -1086,6 +1086,38 @@ INTERN void KCALL posix_signal_test(void) {
  }
 }
 
+PRIVATE bool KCALL
+signal_haskill(struct sigpending *__restrict pending) {
+ struct sigqueue *iter;
+ mutex_get(&pending->sp_lock);
+ iter = pending->sp_queue;
+ for (; iter; iter = iter->sq_chain.le_next)
+     if (iter->sq_info.si_signo == SIGKILL+1) break;
+ mutex_put(&pending->sp_lock);
+ return iter != NULL;
+}
+
+PUBLIC void KCALL signal_connect_kill(void) {
+ struct sigpending *pending[2];
+ pending[0] = sigpending_gettask();
+ pending[1] = sigpending_getproc();
+ task_connect(&pending[0]->sp_newsig);
+ task_connect(&pending[1]->sp_newsig);
+ if (TASK_EVAL_CONSAFE(signal_haskill(pending[0]) ||
+                       signal_haskill(pending[1]))) {
+  struct exception_info *reason;
+  task_disconnect();
+  /* Same as the default action of `SIGKILL' in `handle_signal()',
+   * only that we don't need to go through user-space to get there. */
+  reason = error_info();
+  reason->e_error.e_code = E_EXIT_PROCESS;
+  reason->e_error.e_flag = ERR_FNORMAL;
+  memset(reason->e_error.e_pointers,0,sizeof(reason->e_error.e_pointers));
+  reason->e_error.e_exit.e_status = __W_EXITCODE(0,SIGKILL+1);
+  error_throw_current();
+ }
+}
+
 /* Change the signal mask of the calling thread.
  * Following this, check for signals that have been unblocked
  * and throw an `E_INTERRUPT' exception if any were.
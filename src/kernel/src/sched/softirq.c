@@ -0,0 +1,178 @@
+/* Copyright (c) 2018 Griefer@Work                                            *
+ *                                                                            *
+ * This software is provided 'as-is', without any express or implied          *
+ * warranty. In no event will the authors be held liable for any damages      *
+ * arising from the use of this software.                                     *
+ *                                                                            *
+ * Permission is granted to anyone to use this software for any purpose,      *
+ * including commercial applications, and to alter it and redistribute it     *
+ * freely, subject to the following restrictions:                             *
+ *                                                                            *
+ * 1. The origin of this software must not be misrepresented; you must not    *
+ *    claim that you wrote the original software. If you use this software    *
+ *    in a product, an acknowledgement in the product documentation would be  *
+ *    appreciated but is not required.                                        *
+ * 2. Altered source versions must be plainly marked as such, and must not be *
+ *    misrepresented as being the original software.                          *
+ * 3. This notice may not be removed or altered from any source distribution. *
+ */
+#ifndef GUARD_KERNEL_SRC_SCHED_SOFTIRQ_C
+#define GUARD_KERNEL_SRC_SCHED_SOFTIRQ_C 1
+#define _KOS_SOURCE 1
+
+#include <hybrid/compiler.h>
+#include <hybrid/atomic.h>
+#include <kos/types.h>
+#include <kernel/sections.h>
+#include <kernel/debug.h>
+#include <sched/task.h>
+#include <sched/softirq.h>
+#include <sched/async_signal.h>
+#include <fs/driver.h>
+#include <except.h>
+#include <assert.h>
+
+DECL_BEGIN
+
+struct softirq_queue {
+    struct softirq  *sq_head;  /* [0..1][lock(PRIVATE(THIS_CPU) && !PREEMPTION_ENABLED())] First pending softirq. */
+    struct softirq **sq_plast; /* [1..1][lock(PRIVATE(THIS_CPU) && !PREEMPTION_ENABLED())] Pointer to the last softirq's `si_next' field. */
+    struct async_sig sq_avail; /* Signal broadcast when the queue becomes non-empty. */
+};
+
+PUBLIC ATTR_PERCPU struct irqstat _this_irqstat = { 0, };
+PRIVATE ATTR_PERCPU struct softirq_queue softirq_queue = {
+    .sq_head  = NULL,
+    .sq_plast = NULL, /* Lazily initialized (The address is different for every CPU). */
+    .sq_avail = ASYNC_SIG_INIT
+};
+
+
+PUBLIC ASYNCSAFE bool KCALL
+softirq_raise(struct softirq *__restrict self) {
+ struct softirq_queue *queue; pflag_t was;
+ assert(self->si_func);
+ /* Only the first raise queues the softirq. */
+ if (ATOMIC_FETCHOR(self->si_flags,SOFTIRQ_FPENDING) & SOFTIRQ_FPENDING)
+     return false;
+ self->si_next = NULL;
+ /* Disable preemption so we can't be interrupted,
+  * or moved to another CPU while modifying the queue. */
+ was = PREEMPTION_PUSHOFF();
+ queue = &PERCPU(softirq_queue);
+ if (!queue->sq_plast)
+      queue->sq_plast = &queue->sq_head;
+ *queue->sq_plast = self;
+ queue->sq_plast  = &self->si_next;
+ ++THIS_IRQSTAT.is_raised;
+ PREEMPTION_POP(was);
+ /* Wake the worker thread of this CPU. */
+ async_sig_broadcast(&queue->sq_avail);
+ return true;
+}
+
+
+/* Pop the next pending softirq from `queue'.
+ * @return: NULL: The queue is empty. */
+PRIVATE struct softirq *KCALL
+softirq_pop(struct softirq_queue *__restrict queue) {
+ struct softirq *result; pflag_t was;
+ was = PREEMPTION_PUSHOFF();
+ result = queue->sq_head;
+ if (result &&
+    (queue->sq_head = result->si_next) == NULL)
+     queue->sq_plast = &queue->sq_head;
+ PREEMPTION_POP(was);
+ return result;
+}
+
+/* Execute a batch of pending softirqs on the calling CPU.
+ * @return: true:  The batch ran out of budget with work still pending.
+ * @return: false: The queue is now empty. */
+PRIVATE bool KCALL
+softirq_runbatch(struct softirq_queue *__restrict queue) {
+ struct softirq *EXCEPT_VAR item;
+ unsigned int count = 0;
+ jtime_t start = jiffies;
+ if (!ATOMIC_READ(queue->sq_head))
+      return false;
+ ++THIS_IRQSTAT.is_batches;
+ while ((item = softirq_pop(queue)) != NULL) {
+  u64 begin;
+  /* Clear the pending flag before invoking the callback,
+   * so that a raise that happens while the callback is
+   * running will cause it to be executed once more. */
+  ATOMIC_FETCHAND(item->si_flags,~SOFTIRQ_FPENDING);
+  begin = IRQSTAT_CLOCK();
+  TRY {
+   (*item->si_func)(item->si_arg);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   error_printf("Unhandled exception in softirq %p (func: %p)\n",
+                item,item->si_func);
+   error_handled();
+  }
+  THIS_IRQSTAT.is_softtime += IRQSTAT_CLOCK()-begin;
+  ++THIS_IRQSTAT.is_softirq;
+  /* Stop once the batch has exhausted its budget. */
+  if (++count >= CONFIG_SOFTIRQ_BATCH ||
+      jiffies != start) {
+   if (!ATOMIC_READ(queue->sq_head))
+        break;
+   ++THIS_IRQSTAT.is_deferred;
+   return true;
+  }
+ }
+ return false;
+}
+
+
+PRIVATE ATTR_NORETURN void KCALL
+softirq_threadmain(void *UNUSED(arg)) {
+ struct softirq_queue *queue;
+ /* NOTE: The worker has the `TASK_FALWAYSKEEPCORE' flag set,
+  *       so the queue of our CPU will never change. */
+ queue = &PERCPU(softirq_queue);
+ for (;;) {
+  struct async_task_connection con;
+  if (softirq_runbatch(queue)) {
+   /* Let other threads run before we process the next batch.
+    * If nothing else is runnable, we'll just continue immediately. */
+   task_yield();
+   continue;
+  }
+  /* Wait for more work to arrive. */
+  task_connect_async(&con,&queue->sq_avail);
+  if (ATOMIC_READ(queue->sq_head)) {
+   task_disconnect_async();
+   continue;
+  }
+  task_wait_async();
+ }
+}
+
+
+DEFINE_DRIVER_INIT(softirq_initialize);
+PRIVATE ATTR_USED ATTR_FREETEXT void KCALL softirq_initialize(void) {
+ cpuid_t i;
+ /* Spawn one softirq worker for every CPU. */
+ for (i = 0; i < cpu_count; ++i) {
+  REF struct task *EXCEPT_VAR worker;
+  worker = task_alloc();
+  TRY {
+   task_setup_kernel(worker,&softirq_threadmain,NULL);
+#ifndef CONFIG_NO_SMP
+   worker->t_cpu = cpu_vector[i];
+#endif /* !CONFIG_NO_SMP */
+   worker->t_flags |= (TASK_FKEEPCORE|TASK_FALWAYSKEEPCORE);
+   task_start(worker);
+  } FINALLY {
+   if (FINALLY_WILL_RETHROW)
+       task_failed(worker);
+   task_decref(worker);
+  }
+ }
+}
+
+DECL_END
+
+#endif /* !GUARD_KERNEL_SRC_SCHED_SOFTIRQ_C */
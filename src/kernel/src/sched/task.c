@@ -19,6 +19,7 @@
 #ifndef GUARD_KERNEL_SRC_SCHED_TASK_C
 #define GUARD_KERNEL_SRC_SCHED_TASK_C 1
 #define _KOS_SOURCE 1
+#define _NOSERVE_SOURCE 1
 
 #include <hybrid/compiler.h>
 #include <hybrid/atomic.h>
@@ -40,6 +41,8 @@
 #include <sched/mutex.h>
 #include <sched/pid.h>
 #include <sched/stat.h>
+#include <sched/signal.h>
+#include <sched/posix_signals.h>
 #include <sched/pertask-arith.h>
 #include <sched/userstack.h>
 #include <stdbool.h>
@@ -95,6 +98,19 @@ STATIC_ASSERT(sizeof(struct taskstat) == TASKSTATE_SIZE);
 /* Default pattern for statistical thread information (ZERO-initialized). */
 PUBLIC ATTR_PERTASK struct taskstat _this_stat = { 0 };
 
+STATIC_ASSERT(offsetof(struct cpustat,cs_user)    == CPUSTAT_OFFSETOF_USER);
+STATIC_ASSERT(offsetof(struct cpustat,cs_system)  == CPUSTAT_OFFSETOF_SYSTEM);
+STATIC_ASSERT(offsetof(struct cpustat,cs_idle)    == CPUSTAT_OFFSETOF_IDLE);
+STATIC_ASSERT(offsetof(struct cpustat,cs_pgfault) == CPUSTAT_OFFSETOF_PGFAULT);
+STATIC_ASSERT(offsetof(struct cpustat,cs_pgcow)   == CPUSTAT_OFFSETOF_PGCOW);
+STATIC_ASSERT(offsetof(struct cpustat,cs_thpalloc)    == CPUSTAT_OFFSETOF_THPALLOC);
+STATIC_ASSERT(offsetof(struct cpustat,cs_thpfallback) == CPUSTAT_OFFSETOF_THPFALLBACK);
+STATIC_ASSERT(offsetof(struct cpustat,cs_thpsplit)    == CPUSTAT_OFFSETOF_THPSPLIT);
+STATIC_ASSERT(sizeof(struct cpustat) == CPUSTAT_SIZE);
+
+/* Per-CPU statistics (ZERO-initialized). */
+PUBLIC ATTR_PERCPU struct cpustat _this_cpustat = { 0 };
+
 #endif /* !CONFIG_NO_TASKSTAT */
 
 INTERN ATTR_SECTION(".data.pertask.head")
@@ -371,12 +387,101 @@ global_unbind_pertask_drivers(struct driver *__restrict d) {
 
 
 
+/* Per-CPU cache of task descriptors and kernel stacks of threads that
+ * have been destroyed recently. Threads that only live for a short
+ * while (worker threads, or `fork()'+`exit()' loops) can re-use these
+ * instead of having to go through kmalloc() and vm_map()/vm_unmap(). */
+#ifndef CONFIG_TASK_CACHE_SIZE
+#define CONFIG_TASK_CACHE_SIZE  4
+#endif
+
+#if CONFIG_TASK_CACHE_SIZE != 0
+#define TASK_CACHE_DESCR   0 /* Task descriptors (`kernel_pertask_size' bytes, allocated by `kmalloc()') */
+#define TASK_CACHE_STACK   1 /* Kernel stacks (`CONFIG_KERNELSTACK_SIZE' bytes, mapped in kernel-share) */
+#define TASK_CACHE_COUNT   2
+struct task_cache {
+    atomic_rwlock_t      tc_lock; /* Lock for this cache.
+                                   * Only acquired with preemption disabled, meaning
+                                   * that the only contention may come from `task_cache_clear()' */
+    unsigned int         tc_count[TASK_CACHE_COUNT]; /* [lock(tc_lock)] Number of cached items. */
+    void                *tc_items[TASK_CACHE_COUNT][CONFIG_TASK_CACHE_SIZE]; /* [lock(tc_lock)][owned] Cached items. */
+};
+PRIVATE ATTR_PERCPU struct task_cache task_cache = { ATOMIC_RWLOCK_INIT, };
+
+/* Take an item from the calling CPU's cache, returning NULL if none are available. */
+PRIVATE void *KCALL task_cache_get(unsigned int kind) {
+ struct task_cache *cache;
+ void *result = NULL;
+ pflag_t was = PREEMPTION_PUSHOFF();
+ cache = &PERCPU(task_cache);
+ if (atomic_rwlock_trywrite(&cache->tc_lock)) {
+  if (cache->tc_count[kind])
+      result = cache->tc_items[kind][--cache->tc_count[kind]];
+  atomic_rwlock_endwrite(&cache->tc_lock);
+ }
+ PREEMPTION_POP(was);
+ return result;
+}
+
+/* Try to store an item in the calling CPU's cache.
+ * @return: false: The cache is full. (The caller must free the item themself) */
+PRIVATE bool KCALL task_cache_put(unsigned int kind, void *item) {
+ struct task_cache *cache;
+ bool result = false;
+ pflag_t was = PREEMPTION_PUSHOFF();
+ cache = &PERCPU(task_cache);
+ if (atomic_rwlock_trywrite(&cache->tc_lock)) {
+  if (cache->tc_count[kind] < CONFIG_TASK_CACHE_SIZE) {
+   cache->tc_items[kind][cache->tc_count[kind]++] = item;
+   result = true;
+  }
+  atomic_rwlock_endwrite(&cache->tc_lock);
+ }
+ PREEMPTION_POP(was);
+ return result;
+}
+
+PRIVATE ATTR_NOTHROW void KCALL task_unmap_stack(VIRT void *stack) {
+ vm_unmap(VM_ADDR2PAGE((uintptr_t)stack),
+          CONFIG_KERNELSTACK_SIZE / PAGESIZE,
+          VM_UNMAP_NOEXCEPT|VM_UNMAP_SYNC,NULL);
+}
+
+DEFINE_GLOBAL_CACHE_CLEAR(task_cache_clear);
+PRIVATE ATTR_USED void KCALL task_cache_clear(void) {
+ cpuid_t i;
+ for (i = 0; i < cpu_count; ++i) {
+  struct task_cache *cache = &FORCPU(cpu_vector[i],task_cache);
+  void *items[TASK_CACHE_COUNT][CONFIG_TASK_CACHE_SIZE];
+  unsigned int count[TASK_CACHE_COUNT];
+  /* Steal all items, then free them without holding the lock. */
+  atomic_rwlock_write(&cache->tc_lock);
+  memcpy(count,cache->tc_count,sizeof(count));
+  memcpy(items,cache->tc_items,sizeof(items));
+  memset(cache->tc_count,0,sizeof(cache->tc_count));
+  atomic_rwlock_endwrite(&cache->tc_lock);
+  while (count[TASK_CACHE_DESCR])
+      kfree(items[TASK_CACHE_DESCR][--count[TASK_CACHE_DESCR]]);
+  while (count[TASK_CACHE_STACK])
+      task_unmap_stack(items[TASK_CACHE_STACK][--count[TASK_CACHE_STACK]]);
+ }
+}
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
+
+
 PUBLIC ATTR_RETNONNULL ATTR_MALLOC
 REF struct task *KCALL task_alloc(void) {
  task_func_t *iter;
  REF struct task *result;
- result = (REF struct task *)kmalloc((size_t)kernel_pertask_size,
-                                      GFP_SHARED);
+#if CONFIG_TASK_CACHE_SIZE != 0
+ result = (REF struct task *)task_cache_get(TASK_CACHE_DESCR);
+ if (!result)
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
+ {
+  result = (REF struct task *)kmalloc((size_t)kernel_pertask_size,
+                                       GFP_SHARED);
+ }
+ /* All PERTASK variables are initialized by copying the template. */
  memcpy(result,kernel_pertask_start,(size_t)kernel_pertask_size);
  assert(result->t_cpu == &_boot_cpu);
  result->t_refcnt = 1;
@@ -417,6 +522,18 @@ task_alloc_stack(struct task *__restrict thread,
  assert(!thread->t_stackmin);
  assert(!thread->t_stackend);
  assert(!(thread->t_state & TASK_STATE_FSTARTED));
+#if CONFIG_TASK_CACHE_SIZE != 0
+ if (num_pages == CONFIG_KERNELSTACK_SIZE / PAGESIZE &&
+    (thread->t_stackmin = task_cache_get(TASK_CACHE_STACK)) != NULL) {
+  /* Re-use a stack that is still mapped from a dead thread. */
+  thread->t_stackend = (VIRT void *)((uintptr_t)thread->t_stackmin +
+                                     CONFIG_KERNELSTACK_SIZE);
+#ifndef NDEBUG
+  memsetl(thread->t_stackmin,0xcccccccc,CONFIG_KERNELSTACK_SIZE / 4);
+#endif
+  return;
+ }
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
  region = vm_region_alloc(num_pages);
  TRY {
   /* Use physical memory mappings for kernel stacks.
@@ -580,12 +697,21 @@ task_destroy(struct task *__restrict self) {
    vm_vpage_t stack_endpage = VM_ADDR2PAGE((uintptr_t)self->t_stackend);
    assert(IS_ALIGNED((uintptr_t)self->t_stackmin,PAGEALIGN));
    assert(IS_ALIGNED((uintptr_t)self->t_stackend,PAGEALIGN));
+#if CONFIG_TASK_CACHE_SIZE != 0
+   /* Keep the stack mapped for use by the next thread. */
+   if (stack_endpage-stack_minpage == CONFIG_KERNELSTACK_SIZE / PAGESIZE &&
+       task_cache_put(TASK_CACHE_STACK,self->t_stackmin))
+       goto stack_done;
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
    /* Unmap the host stack of this task. */
    vm_unmap(stack_minpage,
             stack_endpage-stack_minpage,
             VM_UNMAP_NOEXCEPT|
             VM_UNMAP_SYNC,NULL);
   }
+#if CONFIG_TASK_CACHE_SIZE != 0
+stack_done:
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
   atomic_rwlock_write(&self->t_vm->vm_tasklock);
   LIST_REMOVE(self,t_vmtasks);
   atomic_rwlock_endwrite(&self->t_vm->vm_tasklock);
@@ -593,7 +719,12 @@ task_destroy(struct task *__restrict self) {
  }
 
  /* Finally, free the task structure itself. */
- kfree(self);
+#if CONFIG_TASK_CACHE_SIZE != 0
+ if (!task_cache_put(TASK_CACHE_DESCR,self))
+#endif /* CONFIG_TASK_CACHE_SIZE != 0 */
+ {
+  kfree(self);
+ }
 }
 
 
@@ -635,7 +766,7 @@ again_newvm:
  COMPILER_BARRIER();
  /* Set the new physical page directory
   * pointer, switching context to it. */
- pagedir_set((pagedir_t *)(uintptr_t)new_vm->vm_physdir);
+ pagedir_setvm(new_vm);
  PREEMPTION_POP(was);
  vm_release(new_vm);
  /* Update reference counters. */
@@ -643,6 +774,38 @@ again_newvm:
  vm_decref(old_vm); /* The reference inherited from `t_vm' */
 }
 
+/* Signal broadcast when a vfork()-ed thread releases its parent. */
+PRIVATE ATTR_PERTASK struct sig task_vfork_signal = SIG_INIT;
+
+INTERN void KCALL
+task_vfork_wait(struct task *__restrict child) {
+ for (;;) {
+  /* Still allow the parent to be killed. `SIGKILL' is handled without
+   * ever running in user-space, so the child's use of our stack is
+   * of no concern. (It keeps the VM alive on its own) */
+  signal_connect_kill();
+  task_connect(&FORTASK(child,task_vfork_signal));
+  /* Also connect to the join signal, so we get
+   * woken when the child exits without exec()-ing. */
+  task_connect_join(child);
+  if (!(ATOMIC_READ(child->t_flags) & TASK_FVFORK) ||
+        TASK_ISTERMINATED(child)) {
+   task_disconnect();
+   break;
+  }
+  /* Don't serve RPCs: the child is still using our stack, so we mustn't
+   * return to user-space (e.g. to run a signal handler) until it's done. */
+  task_wait_noserve();
+ }
+}
+
+INTERN void KCALL task_vfork_release(void) {
+ if (!(THIS_TASK->t_flags & TASK_FVFORK))
+       return;
+ ATOMIC_FETCHAND(THIS_TASK->t_flags,~TASK_FVFORK);
+ sig_broadcast(&PERTASK(task_vfork_signal));
+}
+
 DEFINE_SYSCALL_DONTRESTART(sched_yield);
 DEFINE_SYSCALL0(sched_yield) {
  return (task_tryyield)();
@@ -31,6 +31,7 @@
 #include <kernel/heap.h>
 #include <kernel/interrupt.h>
 #include <fs/node.h>
+#include <sched/stat.h>
 #include <string.h>
 #include <stdlib.h>
 #include <except.h>
@@ -50,6 +51,78 @@ INTDEF ATTR_NOTHROW ATTR_RETNONNULL struct vm_part *KCALL
 vm_region_mergenext(struct vm_region *__restrict region,
                     struct vm_part *__restrict part);
 
+/* Try to allocate a huge page to back the given fault.
+ * If this succeeds, `*pstarting_page' and `*pnum_pages' are widened to
+ * describe the entire (aligned) huge page, which is then returned after
+ * the containing part was split to start/end at the huge page's bounds.
+ * Otherwise, `(pageptr_t)-1' is returned and the range isn't modified.
+ * NOTE: Only user-space memory that is entirely missing and mapped
+ *       at a suitable alignment can be loaded using huge pages. */
+PRIVATE pageptr_t KCALL
+vm_region_alloc_huge(struct vm_node *__restrict node,
+                     struct vm_region *__restrict region,
+                     vm_vpage_t region_base_page,
+                     vm_raddr_t *__restrict pstarting_page,
+                     size_t *__restrict pnum_pages,
+                     unsigned int mode) {
+ struct vm_part *part; pageptr_t result;
+ vm_vpage_t block; vm_raddr_t part_end_page;
+ size_t huge = pagedir_hugepages;
+ if (!huge || *pnum_pages >= huge)
+      goto nope;
+ if (mode & (VM_LOADCORE_NOALOA|VM_LOADCORE_LOCKED))
+     goto nope;
+ if (region->vr_type != VM_REGION_MEM ||
+    (region->vr_flags & VM_REGION_FMONITOR) ||
+    (node->vn_flag & VM_NODE_FNOHUGEPAGE))
+     goto nope;
+ switch (region->vr_init) {
+ case VM_REGION_INIT_FNORMAL:
+ case VM_REGION_INIT_FFILLER:
+ case VM_REGION_INIT_FRANDOM:
+ case VM_REGION_INIT_FFILE_RO:
+  break;
+ default: goto nope;
+ }
+ /* The huge page must be fully mapped by this node, and in user-space. */
+ block = FLOOR_ALIGN(region_base_page + *pstarting_page,huge);
+ if (block < VM_NODE_BEGIN(node) ||
+     block+huge > VM_NODE_END(node) ||
+     block+huge > KERNEL_BASE_PAGE)
+     goto nope;
+ block -= region_base_page;
+ /* The huge page must be contained within a single missing part. */
+ for (part = region->vr_parts; part; part = part->vp_chain.le_next) {
+  part_end_page = part->vp_chain.le_next ? part->vp_chain.le_next->vp_start
+                                         : region->vr_size;
+  if (part_end_page <= block) continue;
+  if (part->vp_start > block ||
+      part_end_page < block+huge ||
+      part->vp_state != VM_PART_MISSING)
+      goto nope;
+  break;
+ }
+ if unlikely(!part) goto nope;
+ /* Split the part to match the huge page _before_ allocating it, so
+  * that the caller won't have to do any splitting that could throw. */
+ if (block != part->vp_start)
+     part = vm_part_splitafter(part,block-part->vp_start);
+ if (block+huge != part_end_page)
+     vm_part_splitafter(part,huge);
+ result = page_trymalloc_aligned(huge,MZONE_ANY);
+ if (result == (pageptr_t)-1) {
+  /* Not enough contiguous memory. - Fall back to regular pages. */
+  INCCPUSTAT(cs_thpfallback);
+  goto nope;
+ }
+ INCCPUSTAT(cs_thpalloc);
+ *pstarting_page = block;
+ *pnum_pages     = huge;
+ return result;
+nope:
+ return (pageptr_t)-1;
+}
+
 /* Allocate+initialize memory from the given region range. */
 LOCAL bool KCALL
 vm_region_load_core(struct vm_node *__restrict node,
@@ -61,8 +134,12 @@ vm_region_load_core(struct vm_node *__restrict node,
  struct vm_part **ppart;
  struct vm_part *EXCEPT_VAR part;
  bool result = false;
+ pageptr_t huge_page;
  assert(starting_page+num_pages >  starting_page);
  assert(starting_page+num_pages <= region->vr_size);
+ /* Try to use a huge page first. */
+ huge_page = vm_region_alloc_huge(node,region,region_base_page,
+                                 &starting_page,&num_pages,mode);
  for (ppart = &region->vr_parts;
      (part  = *ppart) != NULL;
       ppart = &part->vp_chain.le_next) {
@@ -127,7 +204,17 @@ vm_region_load_core(struct vm_node *__restrict node,
   load_pages = part_end_page - part->vp_start;
   part->vp_phys.py_num_scatter = 1;
   part->vp_phys.py_iscatter[0].ps_size = load_pages;
-  part->vp_phys.py_iscatter[0].ps_addr = page_malloc(load_pages,MZONE_ANY);
+  if (huge_page != (pageptr_t)-1) {
+   /* Use the huge page allocated above.
+    * NOTE: Since the part was already split to match it, it must be
+    *       the first part we get here, and no splitting could have
+    *       thrown an error that would have leaked the huge page. */
+   assert(load_pages == pagedir_hugepages);
+   part->vp_phys.py_iscatter[0].ps_addr = huge_page;
+   huge_page = (pageptr_t)-1;
+  } else {
+   part->vp_phys.py_iscatter[0].ps_addr = page_malloc(load_pages,MZONE_ANY);
+  }
   /* With the part now allocated, mark it as in-core. */
   part->vp_state = VM_PART_INCORE;
   TRY {
@@ -314,6 +401,8 @@ vm_region_load_core(struct vm_node *__restrict node,
   /* Indicate that we managed to load something */
   result = true;
  }
+ assertf(huge_page == (pageptr_t)-1,
+         "The huge page should have been used");
  return result;
 }
 
@@ -363,10 +452,6 @@ vm_region_copy_core(struct vm *__restrict effective_vm,
   if (part_end_page <= starting_page) continue; /* Part below requested range. */
   /* At least some portion of this part must be loaded in some way. */
   assert(starting_page >= part->vp_start);
-#if 0
-  if (starting_page != part->vp_start) { /* XXX: Split the region part as `starting_page-part->vp_start' */ }
-  if (starting_page+num_pages < part_end_page) { /* XXX: Split the region part? */ }
-#endif
 
 
   /* Determine the new protection flags. */
@@ -385,6 +470,7 @@ vm_region_copy_core(struct vm *__restrict effective_vm,
 #endif
   if (node->vn_prot & PROT_NOUSER)
       part_prot &= ~PAGEDIR_MAP_FUSER;
+  part_prot |= VM_REGION_PAGEDIR_MEMTYPE(region->vr_flags);
   /* Handle setting the changed-flag in physical, or shared regions. */
   if ((region->vr_type == VM_REGION_PHYSICAL) ||
       ((node->vn_prot&PROT_SHARED) &&
@@ -410,7 +496,20 @@ vm_region_copy_core(struct vm *__restrict effective_vm,
    continue;
   }
 #define COW_DESCRIPTOR_GFP  (GFP_SHARED|GFP_LOCKED)
+  if (pagedir_hugepages != 0 &&
+      part_end_page-part->vp_start >= pagedir_hugepages) {
+   /* Don't duplicate an entire huge page when only a portion of it
+    * is being written to. Instead, split the part, such that only
+    * the affected pages get copied. (The page directory will then
+    * split the huge page when the copy is mapped) */
+   if (starting_page != part->vp_start)
+       part = vm_part_splitafter(part,starting_page-part->vp_start);
+   if (starting_page+num_pages < part_end_page)
+       vm_part_splitafter(part,(starting_page+num_pages)-part->vp_start);
+   INCCPUSTAT(cs_thpsplit);
+  }
   /* Duplicate this part into a new region. */
+  INCCPUSTAT(cs_pgcow);
   part_end_page = part->vp_chain.le_next ? part->vp_chain.le_next->vp_start
                                          : region->vr_size;
   part_size = part_end_page - part->vp_start;
@@ -149,6 +149,19 @@ do_xmmap(struct mmap_info *__restrict info_) {
                         MAP_NONBLOCK|MAP_STACK|MAP_HUGETLB|MAP_UNINITIALIZED|
                        (MAP_HUGE_MASK << MAP_HUGE_SHIFT)))
      error_throw(E_INVALID_ARGUMENT);
+ if (info->mi_flags & MAP_HUGETLB) {
+  unsigned int huge_shift;
+  /* Validate the requested huge page size (if one was given).
+   * NOTE: Huge pages are always optional, and faults fall back
+   *       to regular pages when not enough memory is available. */
+  huge_shift = (info->mi_flags >> MAP_HUGE_SHIFT) & MAP_HUGE_MASK;
+  if (huge_shift &&
+     (huge_shift >= sizeof(size_t)*8 ||
+     ((size_t)1 << huge_shift) != pagedir_hugepages*PAGESIZE))
+      error_throw(E_INVALID_ARGUMENT);
+  /* The huge page size overlaps with `MAP_UNINITIALIZED' */
+  info->mi_flags &= ~(MAP_HUGE_MASK << MAP_HUGE_SHIFT);
+ }
 
  switch (info->mi_flags & MAP_TYPE) {
  case MAP_AUTOMATIC: break;
@@ -499,6 +512,12 @@ got_regions:
    if (info->mi_align < PAGEALIGN)
        info->mi_align = PAGEALIGN;
    page_alignment = CEILDIV(info->mi_align,PAGESIZE);
+   /* Align large mappings by the huge page size, thus allowing
+    * page faults within them to be serviced using huge pages. */
+   if (pagedir_hugepages && page_alignment < pagedir_hugepages &&
+     ((info->mi_flags & MAP_HUGETLB) ||
+      (num_pages >= pagedir_hugepages && !is_extenal_region)))
+       page_alignment = pagedir_hugepages;
 
    /* Automatically assign  */
    if (hint != 0 || 
@@ -865,6 +884,68 @@ DEFINE_SYSCALL3(mprotect,USER void *,start,size_t,len,unsigned int,prot) {
  return 0;
 }
 
+DEFINE_SYSCALL3(madvise,USER void *,start,size_t,len,int,advice) {
+ struct vm *EXCEPT_VAR effective_vm = THIS_VM;
+ struct vm_node *node; u16 set_flags,clr_flags;
+ vm_vpage_t starting_page,end_page,next_page;
+ if unlikely(!IS_ALIGNED((uintptr_t)start,PAGESIZE))
+    error_throw(E_INVALID_ARGUMENT);
+ switch (advice) {
+ case MADV_NORMAL:
+ case MADV_RANDOM:
+ case MADV_SEQUENTIAL:
+ case MADV_WILLNEED:
+  return 0; /* Only hints (which we're free to ignore) */
+ case MADV_DONTNEED:
+  /* XXX: Callers expect private memory to read back as
+   *      zero afterwards, which we can't guaranty, yet:
+   *     `vm_deallocate_pages()' skips parts that are shared
+   *      after fork(), locked, or have been swapped out. */
+  error_throw(E_NOT_IMPLEMENTED);
+ case MADV_HUGEPAGE:
+  set_flags = 0,clr_flags = VM_NODE_FNOHUGEPAGE;
+  break;
+ case MADV_NOHUGEPAGE:
+  set_flags = VM_NODE_FNOHUGEPAGE,clr_flags = 0;
+  break;
+ default: error_throw(E_INVALID_ARGUMENT);
+ }
+ len = CEIL_ALIGN(len,PAGESIZE);
+ if unlikely(!len) return 0;
+ if unlikely((uintptr_t)start+len < (uintptr_t)start)
+    error_throw(E_INVALID_ARGUMENT);
+ starting_page = VM_ADDR2PAGE((uintptr_t)start);
+ end_page      = starting_page+(len/PAGESIZE);
+ if unlikely(end_page > KERNEL_BASE_PAGE)
+    error_throw(E_INVALID_ARGUMENT);
+ vm_acquire(effective_vm);
+ TRY {
+  /* Split mappings at the range boundaries, so the
+   * advice doesn't affect memory outside of it. */
+  vm_split_before(effective_vm,starting_page);
+  vm_split_before(effective_vm,end_page);
+  next_page = starting_page;
+  VM_FOREACH_NODE(node,effective_vm) {
+   if (VM_NODE_BEGIN(node) >= end_page) break;
+   if (VM_NODE_END(node) <= starting_page) continue;
+   if (VM_NODE_BEGIN(node) != next_page)
+       break; /* Unmapped gap. */
+   next_page = VM_NODE_END(node);
+   if (node->vn_region->vr_type != VM_REGION_MEM)
+       continue;
+   node->vn_flag &= ~clr_flags;
+   node->vn_flag |= set_flags;
+  }
+ } FINALLY {
+  vm_release(effective_vm);
+ }
+ /* Like `mprotect()', fail if part of the range isn't mapped
+  * (advice given to the mapped part before the gap remains). */
+ if unlikely(next_page < end_page)
+    return -ENOMEM;
+ return 0;
+}
+
 DEFINE_SYSCALL6(xmprotect,
                 USER void *,start,size_t,len,
                 unsigned int,protmask,unsigned int,protflag,
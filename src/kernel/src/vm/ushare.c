@@ -30,74 +30,320 @@
 #include <kernel/version.h>
 #include <kernel/syscall.h>
 #include <kernel/user.h>
+#include <kernel/bind.h>
+#include <kernel/malloc.h>
+#include <kernel/memory.h>
+#include <kernel/paging.h>
 #include <kos/ushare.h>
+#include <sched/group.h>
 #include <sched/pid.h>
 #include <sched/stat.h>
+#include <sched/cputime.h>
+#include <sched/task.h>
+#include <sched/taskref.h>
+#include <bits/sched.h>
+#include <hybrid/atomic.h>
+#include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/utsname.h>
 
 DECL_BEGIN
 
-#ifndef CONFIG_NO_VIO
-PRIVATE u32 KCALL
-procinfo_readl(void *UNUSED(closure), uintptr_t addr) {
- assert(PREEMPTION_ENABLED());
+/* The system-wide page of the PROCINFO USHARE segment.
+ * NOTE: The kernel's `jiffies' counter is an alias for `pi_time',
+ *       meaning that the timer interrupt keeps it up-to-date for us. */
+struct procinfo_sysinfo {
+    jtime_t ps_time;
+    u32     ps_hz;
+    u32     ps_tscflags;
+    u64     ps_tschz;
+    byte_t  ps_data[PAGESIZE-24];
+};
+STATIC_ASSERT(offsetof(struct ushare_procinfo,pi_time) == offsetof(struct procinfo_sysinfo,ps_time));
+STATIC_ASSERT(offsetof(struct ushare_procinfo,pi_hz) == offsetof(struct procinfo_sysinfo,ps_hz));
+STATIC_ASSERT(offsetof(struct ushare_procinfo,pi_tscflags) == offsetof(struct procinfo_sysinfo,ps_tscflags));
+STATIC_ASSERT(offsetof(struct ushare_procinfo,pi_tschz) == offsetof(struct procinfo_sysinfo,ps_tschz));
+STATIC_ASSERT(offsetof(struct ushare_procinfo,pi_pid) == USHARE_PROCINFO_OFFSETOF_PROCESS);
+STATIC_ASSERT(sizeof(struct procinfo_sysinfo) == PAGESIZE);
+
+INTERN ATTR_SECTION(".data.ushare.procinfo")
+struct procinfo_sysinfo _ushare_procinfo ASMNAME("ushare_procinfo") = {
+    .ps_time = 0,
+    .ps_hz   = HZ
+};
+DEFINE_PUBLIC_ALIAS(jiffies,ushare_procinfo);
+INTDEF byte_t ushare_procinfo_pageno[];
+
+/* Publish the calibrated TSC frequency to user-space. */
+INTERN ATTR_FREETEXT void KCALL
+procinfo_settsc(u64 hz, u32 flags) {
+ _ushare_procinfo.ps_tschz = hz;
+ COMPILER_WRITE_BARRIER();
+ _ushare_procinfo.ps_tscflags = flags;
+}
 
-#define FIELD(x) case offsetof(struct ushare_procinfo,x):
- switch (addr) {
+/* [0..1][lock(WRITE_ONCE)] The PROCINFO USHARE region of this VM.
+ * Allocated lazily the first time the segment is mapped. */
+PRIVATE ATTR_PERVM REF struct vm_region *vm_procinfo = NULL;
 
- FIELD(pi_tid)
-  return posix_gettid();
+DEFINE_PERVM_FINI(procinfo_vmfini);
+PRIVATE ATTR_USED void KCALL
+procinfo_vmfini(struct vm *__restrict self) {
+ if (FORVM(self,vm_procinfo))
+     vm_region_decref(FORVM(self,vm_procinfo));
+}
 
- FIELD(pi_pid)
-  return posix_getpid();
+/* Allocate a new PROCINFO region. The per-process page is left uninitialized. */
+PRIVATE ATTR_RETNONNULL REF struct vm_region *KCALL procinfo_alloc(void) {
+ REF struct vm_region *EXCEPT_VAR result;
+ struct vm_part *EXCEPT_VAR part;
+ result = vm_region_alloc(USHARE_PROCINFO_FSIZE/PAGESIZE);
+ TRY {
+  result->vr_flags |= (VM_REGION_FCANTSHARE|VM_REGION_FDONTMERGE);
+  /* The first page is shared with all other processes. */
+  result->vr_part0.vp_state                       = VM_PART_INCORE;
+  result->vr_part0.vp_flags                       = VM_PART_FKEEP|VM_PART_FWEAKREF|VM_PART_FNOSWAP;
+  result->vr_part0.vp_phys.py_num_scatter         = 1;
+  result->vr_part0.vp_phys.py_iscatter[0].ps_addr = (uintptr_t)ushare_procinfo_pageno;
+  result->vr_part0.vp_phys.py_iscatter[0].ps_size = 1;
+  /* The second page is owned by the region, and freed alongside it. */
+  part = (struct vm_part *)kmalloc(sizeof(struct vm_part),
+                                   GFP_SHARED|GFP_LOCKED|GFP_CALLOC);
+  TRY {
+   part->vp_phys.py_iscatter[0].ps_addr = page_malloc(1,MZONE_ANY);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   kfree(part);
+   error_rethrow();
+  }
+  part->vp_start                       = USHARE_PROCINFO_OFFSETOF_PROCESS/PAGESIZE;
+  part->vp_state                       = VM_PART_INCORE;
+  part->vp_flags                       = VM_PART_FKEEP|VM_PART_FNOSWAP;
+  part->vp_phys.py_num_scatter         = 1;
+  part->vp_phys.py_iscatter[0].ps_size = 1;
+  part->vp_chain.le_pself              = &result->vr_part0.vp_chain.le_next;
+  result->vr_part0.vp_chain.le_next    = part;
+ } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+  vm_region_decref(result);
+  error_rethrow();
+ }
+ return result;
+}
 
- FIELD(pi_ppid)
-  return posix_getppid();
+/* Write `info' (pid, ppid, pgid, sid) into the per-process page of `region'.
+ * When `clear' is true, the remainder of the page is cleared as well. */
+PRIVATE void KCALL
+procinfo_write(struct vm_region *__restrict region,
+               u32 const info[4], bool clear) {
+ struct vm_part *part = region->vr_part0.vp_chain.le_next;
+ vm_vpage_t vpage = task_temppage();
+ u32 *dst = (u32 *)VM_PAGE2ADDR(vpage);
+ assert(part && part->vp_state == VM_PART_INCORE);
+ vm_acquire(&vm_kernel);
+ TRY {
+  pagedir_mapone(vpage,
+                 part->vp_phys.py_iscatter[0].ps_addr,
+                 PAGEDIR_MAP_FREAD|PAGEDIR_MAP_FWRITE);
+ } FINALLY {
+  vm_release(&vm_kernel);
+ }
+ pagedir_syncone(vpage);
+ /* Write one field at a time, so user-space never sees torn values. */
+ ATOMIC_WRITE(dst[0],info[0]);
+ ATOMIC_WRITE(dst[1],info[1]);
+ ATOMIC_WRITE(dst[2],info[2]);
+ ATOMIC_WRITE(dst[3],info[3]);
+ if (clear) memsetl(dst+4,0,(PAGESIZE/4)-4);
+}
 
- FIELD(pi_gpid)
-  return posix_getpgid();
+/* View the process leader of `thread' in `ns'. */
+PRIVATE ATTR_NOTHROW pid_t KCALL
+procinfo_view(struct task *__restrict thread,
+              struct pidns *__restrict ns) {
+ struct thread_pid *pid;
+ pid = FORTASK(FORTASK(thread,_this_group).tg_leader,_this_pid);
+ return pid ? thread_pid_view(pid,ns) : 0;
+}
 
- FIELD(pi_sid)
-  return posix_getsid();
+/* Gather the per-process information of `process', as seen by itself. */
+PRIVATE void KCALL
+procinfo_gather(struct task *__restrict process, u32 info[4]) {
+ struct thread_pid *my_pid;
+ REF struct task *parent,*leader;
+ struct task_weakref *parent_ref;
+ process = FORTASK(process,_this_group).tg_leader;
+ my_pid  = FORTASK(process,_this_pid);
+ if unlikely(!my_pid) {
+  info[0] = info[1] = info[2] = info[3] = 0;
+  return;
+ }
+ info[0] = thread_pid_view(my_pid,my_pid->tp_ns);
+ /* The process's parent. */
+ parent_ref = FORTASK(process,_this_group).tg_process.h_parent;
+ parent     = parent_ref ? task_weakref_lock(parent_ref) : NULL;
+ if (!parent)
+  info[1] = 1; /* Adopted by init. */
+ else {
+  /* A terminating parent will no longer be around to wait() for us. */
+  info[1] = TASK_ISTERMINATING(FORTASK(parent,_this_group).tg_leader)
+          ? 1 : procinfo_view(parent,my_pid->tp_ns);
+  task_decref(parent);
+ }
+ /* The process group and session. */
+ leader  = task_get_group(process);
+ info[2] = procinfo_view(leader,my_pid->tp_ns);
+ task_decref(leader);
+ leader  = task_get_session(process);
+ info[3] = procinfo_view(leader,my_pid->tp_ns);
+ task_decref(leader);
+}
 
- FIELD(pi_hz)
-  return HZ;
+/* Return the PROCINFO region of the calling VM, allocating it if necessary. */
+PRIVATE ATTR_RETNONNULL REF struct vm_region *KCALL procinfo_lookup(void) {
+ REF struct vm_region *result;
+ u32 info[4];
+ result = ATOMIC_READ(PERVM(vm_procinfo));
+ if (!result) {
+  REF struct vm_region *EXCEPT_VAR new_region;
+  new_region = procinfo_alloc();
+  TRY {
+   procinfo_gather(THIS_TASK,info);
+   procinfo_write(new_region,info,true);
+  } EXCEPT (EXCEPT_EXECUTE_HANDLER) {
+   vm_region_decref(new_region);
+   error_rethrow();
+  }
+  result = ATOMIC_CMPXCH_VAL(PERVM(vm_procinfo),NULL,new_region);
+  if unlikely(result) {
+   /* Another thread allocated the region before we did. */
+   vm_region_decref(new_region);
+  } else {
+   result = new_region;
+  }
+ }
+ vm_region_incref(result);
+ return result;
+}
 
- FIELD(pi_time)
-  return jiffies32[0];
- case offsetof(struct ushare_procinfo,pi_time) + 4:
-  return jiffies32[1];
+PUBLIC void KCALL
+ushare_procinfo_update(struct task *__restrict process) {
+ REF struct vm *EXCEPT_VAR vm;
+ struct vm_region *region;
+ u32 info[4];
+ process = FORTASK(process,_this_group).tg_leader;
+ vm = task_getvm(process);
+ TRY {
+  region = ATOMIC_READ(FORVM(vm,vm_procinfo));
+  if (region) {
+   procinfo_gather(process,info);
+   procinfo_write(region,info,false);
+  }
+ } FINALLY {
+  vm_decref(vm);
+ }
+}
+
+DEFINE_PERVM_CLONE(procinfo_vmclone);
+PRIVATE ATTR_USED void KCALL
+procinfo_vmclone(struct vm *__restrict new_vm) {
+ struct vm_region *old_region;
+ REF struct vm_region *new_region;
+ struct vm_node *iter;
+ old_region = PERVM(vm_procinfo);
+ if (!old_region) return;
+ /* The new VM belongs to a different process, so it needs its own per-process page.
+  * Replace the region in all nodes that were copied from ours. The page's contents
+  * will be filled in by `procinfo_startup()' once the new process starts running,
+  * and all of its nodes only get mapped at that point. */
+ new_region = procinfo_alloc();
+ FORVM(new_vm,vm_procinfo) = new_region; /* Inherit reference. */
+ for (iter = new_vm->vm_byaddr; iter; iter = iter->vn_byaddr.le_next) {
+  if (iter->vn_region != old_region) continue;
+  vm_region_incref_range(new_region,iter->vn_start,VM_NODE_SIZE(iter));
+  vm_region_decref_range(old_region,iter->vn_start,VM_NODE_SIZE(iter));
+  vm_region_incref(new_region);
+  iter->vn_region = new_region;
+  vm_region_decref(old_region);
+ }
+}
+
+DEFINE_PERTASK_STARTUP(procinfo_startup);
+PRIVATE ATTR_USED void KCALL procinfo_startup(u32 flags) {
+ struct vm_region *region;
+ u32 info[4];
+ /* Fill in the per-process page of a new process created by fork(). */
+ if (flags & (CLONE_VM|CLONE_THREAD)) return;
+ region = PERVM(vm_procinfo);
+ if (!region) return;
+ procinfo_gather(THIS_TASK,info);
+ procinfo_write(region,info,true);
+}
+
+
+#ifndef CONFIG_NO_VIO
+PRIVATE u32 KCALL
+procctl_readl(void *UNUSED(closure), uintptr_t addr) {
+ assert(PREEMPTION_ENABLED());
+
+#define FIELD(x) case offsetof(struct ushare_procctl,x):
+ switch (addr) {
+
+ FIELD(pc_tid)
+  return posix_gettid();
 
 #ifndef CONFIG_NO_TASKSTAT
- FIELD(pi_thread.t_start)
+ FIELD(pc_thread.t_start)
   return THIS_STAT.ts_started32[0];
- case offsetof(struct ushare_procinfo,pi_thread.t_start) + 4:
+ case offsetof(struct ushare_procctl,pc_thread.t_start) + 4:
   return THIS_STAT.ts_started32[1];
- FIELD(pi_thread.t_hswitch)
+ FIELD(pc_thread.t_hswitch)
   return THIS_STAT.ts_hswitch;
- FIELD(pi_thread.t_uswitch)
+ FIELD(pc_thread.t_uswitch)
   return THIS_STAT.ts_uswitch;
- FIELD(pi_thread.t_hyield)
+ FIELD(pc_thread.t_hyield)
   return THIS_STAT.ts_hyield;
- FIELD(pi_thread.t_uyield)
+ FIELD(pc_thread.t_uyield)
   return THIS_STAT.ts_uyield;
- FIELD(pi_thread.t_sleep)
+ FIELD(pc_thread.t_sleep)
   return THIS_STAT.ts_sleep;
- FIELD(pi_thread.t_xrpc)
+ FIELD(pc_thread.t_xrpc)
   return THIS_STAT.ts_xrpc;
- FIELD(pi_thread.t_qrpc)
+ FIELD(pc_thread.t_qrpc)
   return THIS_STAT.ts_qrpc;
 #endif
 
- FIELD(pi_rand)
+ {
+  u64 value;
+ FIELD(pc_thread.t_utime)
+ case offsetof(struct ushare_procctl,pc_thread.t_utime) + 4:
+  cputime_sync();
+  value = cputime_to_nsec(THIS_CPUTIME.tc_user);
+  goto return_value;
+ FIELD(pc_thread.t_stime)
+ case offsetof(struct ushare_procctl,pc_thread.t_stime) + 4:
+  cputime_sync();
+  value = cputime_to_nsec(THIS_CPUTIME.tc_system);
+  goto return_value;
+ FIELD(pc_thread.t_irqtime)
+ case offsetof(struct ushare_procctl,pc_thread.t_irqtime) + 4:
+  value = cputime_to_nsec(THIS_CPUTIME.tc_irq);
+  goto return_value;
+ FIELD(pc_thread.t_waittime)
+ case offsetof(struct ushare_procctl,pc_thread.t_waittime) + 4:
+  value = cputime_to_nsec(THIS_CPUTIME.tc_wait);
+return_value:
+  /* NOTE: The two halves are read individually, meaning that
+   *       user-space may observe a carry between them. */
+  return (addr & 4) ? (u32)(value >> 32) : (u32)value;
+ }
+
+ FIELD(pc_rand)
   return rand();
 
  {
-  PRIVATE u32 procinfo_counter = 0;
- FIELD(pi_counter)
-  return ATOMIC_FETCHINC(procinfo_counter);
+  PRIVATE u32 procctl_counter = 0;
+ FIELD(pc_counter)
+  return ATOMIC_FETCHINC(procctl_counter);
  }
 
  default: break;
@@ -107,18 +353,18 @@ procinfo_readl(void *UNUSED(closure), uintptr_t addr) {
 }
 
 PRIVATE void KCALL
-procinfo_writel(void *UNUSED(closure), uintptr_t addr, u32 value) {
-#define FIELD(x) case offsetof(struct ushare_procinfo,x):
+procctl_writel(void *UNUSED(closure), uintptr_t addr, u32 value) {
+#define FIELD(x) case offsetof(struct ushare_procctl,x):
  switch (addr) {
 
  {
   struct exception_info *info;
- FIELD(pi_exit)
- FIELD(pi_exit_group)
+ FIELD(pc_exit)
+ FIELD(pc_exit_group)
   info = error_info();
   memset(info->e_error.e_pointers,0,sizeof(info->e_error.e_pointers));
   info->e_error.e_code = E_EXIT_THREAD;
-  if (addr == offsetof(struct ushare_procinfo,pi_exit_group))
+  if (addr == offsetof(struct ushare_procctl,pc_exit_group))
       info->e_error.e_code = E_EXIT_PROCESS;
   info->e_error.e_flag = ERR_FNORMAL;
   info->e_error.e_exit.e_status = __W_EXITCODE(value,0);
@@ -131,12 +377,12 @@ procinfo_writel(void *UNUSED(closure), uintptr_t addr, u32 value) {
 #undef FIELD
  error_throw(E_NOT_IMPLEMENTED);
 }
-PRIVATE struct vio_ops ushare_procinfo_ops = {
-    .v_readl  = &procinfo_readl,
-    .v_writel = &procinfo_writel,
+PRIVATE struct vio_ops ushare_procctl_ops = {
+    .v_readl  = &procctl_readl,
+    .v_writel = &procctl_writel,
 };
-PRIVATE struct vm_region ushare_procinfo_region = 
-    VM_REGION_INIT_VIO(ushare_procinfo_region,1,&ushare_procinfo_ops,NULL);
+PRIVATE struct vm_region ushare_procctl_region = 
+    VM_REGION_INIT_VIO(ushare_procctl_region,1,&ushare_procctl_ops,NULL);
 #endif /* !CONFIG_NO_VIO */
 
 
@@ -234,10 +480,13 @@ KCALL ushare_lookup(u32 name) {
  /* arch-independent user-share segments... */
  switch (name) {
 
-#ifndef CONFIG_NO_VIO
  case USHARE_PROCINFO_FNAME:
-  vm_region_incref(&ushare_procinfo_region);
-  return &ushare_procinfo_region;
+  return procinfo_lookup();
+
+#ifndef CONFIG_NO_VIO
+ case USHARE_PROCCTL_FNAME:
+  vm_region_incref(&ushare_procctl_region);
+  return &ushare_procctl_region;
 #endif
 
  case USHARE_STRERROR_FNAME:
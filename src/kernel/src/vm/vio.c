@@ -24,6 +24,7 @@
 #include <kos/types.h>
 #include <kernel/vm.h>
 #include <except.h>
+#include <assert.h>
 
 #ifndef CONFIG_NO_VIO
 DECL_BEGIN
@@ -2438,6 +2439,119 @@ vio_atomic_cmpxchq(struct vio_ops *__restrict ops, void *closure,
 #endif
 
 
+PUBLIC void KCALL
+vio_copyfrom(struct vio_ops *__restrict ops, void *closure,
+             uintptr_t addr, void *__restrict buf,
+             size_t elem_size, size_t num_bytes) {
+ byte_t *dst = (byte_t *)buf;
+ if (!num_bytes) return;
+ if (ops->v_read) {
+  (*ops->v_read)(closure,addr,buf,num_bytes);
+  return;
+ }
+ assert(!(num_bytes % elem_size));
+ switch (elem_size) {
+ case 1:
+  for (; num_bytes; --num_bytes,++addr,++dst)
+      *dst = vio_readb(ops,closure,addr);
+  break;
+ case 2:
+  for (; num_bytes; num_bytes -= 2,addr += 2,dst += 2)
+      ((union word16 *)dst)->w16 = vio_readw(ops,closure,addr);
+  break;
+#if __SIZEOF_POINTER__ >= 8
+ case 8:
+  for (; num_bytes; num_bytes -= 8,addr += 8,dst += 8)
+      ((union word64 *)dst)->w64 = vio_readq(ops,closure,addr);
+  break;
+#endif
+ default:
+  assert(elem_size == 4);
+  for (; num_bytes; num_bytes -= 4,addr += 4,dst += 4)
+      ((union word32 *)dst)->w32 = vio_readl(ops,closure,addr);
+  break;
+ }
+}
+
+PUBLIC void KCALL
+vio_copyto(struct vio_ops *__restrict ops, void *closure,
+           uintptr_t addr, void const *__restrict buf,
+           size_t elem_size, size_t num_bytes) {
+ byte_t const *src = (byte_t const *)buf;
+ if (!num_bytes) return;
+ if (ops->v_write) {
+  (*ops->v_write)(closure,addr,buf,num_bytes);
+  return;
+ }
+ assert(!(num_bytes % elem_size));
+ switch (elem_size) {
+ case 1:
+  for (; num_bytes; --num_bytes,++addr,++src)
+      vio_writeb(ops,closure,addr,*src);
+  break;
+ case 2:
+  for (; num_bytes; num_bytes -= 2,addr += 2,src += 2)
+      vio_writew(ops,closure,addr,((union word16 *)src)->w16);
+  break;
+#if __SIZEOF_POINTER__ >= 8
+ case 8:
+  for (; num_bytes; num_bytes -= 8,addr += 8,src += 8)
+      vio_writeq(ops,closure,addr,((union word64 *)src)->w64);
+  break;
+#endif
+ default:
+  assert(elem_size == 4);
+  for (; num_bytes; num_bytes -= 4,addr += 4,src += 4)
+      vio_writel(ops,closure,addr,((union word32 *)src)->w32);
+  break;
+ }
+}
+
+PUBLIC void KCALL
+vio_fill(struct vio_ops *__restrict ops, void *closure,
+         uintptr_t addr, void const *__restrict pattern,
+         size_t pattern_size, size_t num_bytes) {
+ if (!num_bytes) return;
+ if (ops->v_fill) {
+  (*ops->v_fill)(closure,addr,pattern,pattern_size,num_bytes);
+  return;
+ }
+ assert(!(num_bytes % pattern_size));
+ switch (pattern_size) {
+ {
+  u8 value;
+ case 1:
+  value = *(u8 *)pattern;
+  for (; num_bytes; --num_bytes,++addr)
+      vio_writeb(ops,closure,addr,value);
+ } break;
+ {
+  u16 value;
+ case 2:
+  value = ((union word16 *)pattern)->w16;
+  for (; num_bytes; num_bytes -= 2,addr += 2)
+      vio_writew(ops,closure,addr,value);
+ } break;
+#if __SIZEOF_POINTER__ >= 8
+ {
+  u64 value;
+ case 8:
+  value = ((union word64 *)pattern)->w64;
+  for (; num_bytes; num_bytes -= 8,addr += 8)
+      vio_writeq(ops,closure,addr,value);
+ } break;
+#endif
+ {
+  u32 value;
+ default:
+  assert(pattern_size == 4);
+  value = ((union word32 *)pattern)->w32;
+  for (; num_bytes; num_bytes -= 4,addr += 4)
+      vio_writel(ops,closure,addr,value);
+ } break;
+ }
+}
+
 
 #endif
 
@@ -568,6 +568,8 @@ vm_map_node(struct vm_node *__restrict node) {
 #endif
  if (node->vn_prot & PROT_NOUSER)
      perm &= ~PAGEDIR_MAP_FUSER;
+ /* Map device memory using the memory type requested by the region. */
+ perm |= VM_REGION_PAGEDIR_MEMTYPE(region->vr_flags);
 
  mutex_get(&region->vr_lock);
  TRY {
@@ -782,6 +784,12 @@ done:
 }
 
 #ifndef CONFIG_NO_SMP
+#ifdef __x86_64__
+/* Add CPUs that may still have TLB entries of `self' cached under some PCID. (paging64.c.inl) */
+INTDEF ATTR_NOTHROW void KCALL
+x86_pcid_addcpus(struct vm *__restrict self, kernel_cpuset_t set);
+#endif /* __x86_64__ */
+
 PUBLIC void FCALL
 vm_sync(vm_vpage_t page_index, size_t num_pages) {
  kernel_cpuset_t set = KERNEL_CPUSET_INIT;
@@ -796,6 +804,11 @@ vm_sync(vm_vpage_t page_index, size_t num_pages) {
  for (iter = myvm->vm_tasks;
       iter; iter = iter->t_vmtasks.le_next)
       kernel_cpuset_add(set,iter->t_cpu->cpu_id);
+#ifdef __x86_64__
+ /* Also reach CPUs that aren't running the VM right now, but
+  * could switch back to it without flushing its PCID. */
+ x86_pcid_addcpus(myvm,set);
+#endif /* __x86_64__ */
  atomic_rwlock_endread(&myvm->vm_tasklock);
  /* Send an IPI, requesting page invalidation to all CPUs in the set. */
  KERNEL_CPUSET_FOREACH(set,id) {
@@ -822,6 +835,11 @@ PUBLIC void FCALL vm_syncone(vm_vpage_t page_index) {
  for (iter = myvm->vm_tasks;
       iter; iter = iter->t_vmtasks.le_next)
       kernel_cpuset_add(set,iter->t_cpu->cpu_id);
+#ifdef __x86_64__
+ /* Also reach CPUs that aren't running the VM right now, but
+  * could switch back to it without flushing its PCID. */
+ x86_pcid_addcpus(myvm,set);
+#endif /* __x86_64__ */
  atomic_rwlock_endread(&myvm->vm_tasklock);
  /* Send an IPI, requesting page invalidation to all CPUs in the set. */
  KERNEL_CPUSET_FOREACH(set,id) {
@@ -2055,7 +2073,7 @@ vm_split_before(struct vm *__restrict effective_vm,
  new_node->vn_start       = node->vn_start + split_offset;
  new_node->vn_region      = node->vn_region;
  new_node->vn_prot        = node->vn_prot;
- new_node->vn_flag        = VM_NODE_FNORMAL;
+ new_node->vn_flag        = node->vn_flag & VM_NODE_FNOHUGEPAGE;
  new_node->vn_closure     = node->vn_closure;
  new_node->vn_notify      = node->vn_notify;
  if (new_node->vn_notify) {
@@ -2192,6 +2210,9 @@ vm_merge_before(struct vm *__restrict effective_vm,
  if (self->vn_prot != next->vn_prot) return;
  if (self->vn_notify != next->vn_notify) return;
  if (self->vn_closure != next->vn_closure) return;
+ if ((self->vn_flag & VM_NODE_FNOHUGEPAGE) !=
+     (next->vn_flag & VM_NODE_FNOHUGEPAGE))
+      return; /* Different `madvise()' settings. */
 
  if (self->vn_region == next->vn_region) {
   assertf(self->vn_region->vr_refcnt >= 2,
@@ -2236,7 +2257,7 @@ vm_merge_before(struct vm *__restrict effective_vm,
   if ((self_region->vr_flags & VM_REGION_FDONTMERGE) ||
       (next_region->vr_flags & VM_REGION_FDONTMERGE))
        return; /* Mappings of these regions aren't supposed to be merged. */
-#define VM_REGION_FCOMPAREMASK  (VM_REGION_FMONITOR)
+#define VM_REGION_FCOMPAREMASK  (VM_REGION_FMONITOR|VM_REGION_FMEMTYPE)
 
   if ((self_region->vr_flags & VM_REGION_FCOMPAREMASK) !=
       (next_region->vr_flags & VM_REGION_FCOMPAREMASK))
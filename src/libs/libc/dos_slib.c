@@ -712,12 +712,13 @@ INTDEF size_t LIBCCALL
 libc_dos_fread_s(void *__restrict buf, size_t bufsize,
                  size_t elemsize, size_t elemcount,
                  FILE *__restrict stream) {
+ bool locked;
  size_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return libc_dos_geterrno();
  result = libc_dos_fread_unlocked_s(buf,bufsize,elemsize,elemcount,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -21,10 +21,13 @@
 
 #include "libc.h"
 #include "widechar.h"
+#include "unicode.h"
+#include "malloc.h"
 #include "errno.h"
 #include "unistd.h"
 #include "sync.h"
 #include "rtl.h"
+#include "environ.h"
 #include <kos/sched/mutex.h>
 
 #include <errno.h>
@@ -39,24 +42,568 @@ INTDEF void LIBCCALL libc_env_release(void) { libc_mutex_put(&environ_lock); }
 
 PUBLIC char **environ = NULL;
 INTERN char16_t **w16environ = NULL;
-INTERN char16_t **w32environ = NULL;
+INTERN char32_t **w32environ = NULL;
+
+
+/* Environment index.
+ * Maps the (case-folded) hash of a variable name to its index in `environ'.
+ * Because applications are allowed to modify `environ' (or the vector it
+ * points to) directly, the index keeps a snapshot of the string pointers
+ * it was built from, and is re-built when they no longer match.
+ * NOTE: Changes made to the text of a string that is already part of
+ *       the environment (as allowed by `putenv()') cannot be detected
+ *       when they rename a variable that isn't being looked up. */
+struct env_slot {
+    size_t es_hash;  /* Hash of the variable name (s.a. `env_hash()') */
+    size_t es_index; /* Index into `environ', or `ENV_SLOT_UNUSED' */
+};
+#define ENV_SLOT_UNUSED  ((size_t)-1)
+#define ENV_NOTFOUND     ((size_t)-1)
+#define ENV_MINSLOTS       16
+
+PRIVATE bool             env_valid    = false;/* [lock(environ_lock)] The index is up to date with `env_base'. */
+PRIVATE char           **env_base     = NULL; /* [lock(environ_lock)][valid_if(env_valid)] Value of `environ' when the index was built. */
+PRIVATE size_t           env_count    = 0;    /* [lock(environ_lock)] Number of strings that were indexed. */
+PRIVATE char           **env_shadow   = NULL; /* [lock(environ_lock)][0..env_count|ALLOC(env_shadow_size)][owned]
+                                               * Snapshot of `environ' when the index was built. */
+PRIVATE size_t           env_shadow_size = 0; /* [lock(environ_lock)] Allocated size of `env_shadow' (in pointers). */
+PRIVATE struct env_slot *env_slots    = NULL; /* [lock(environ_lock)][0..env_mask+1][owned] Hash-table of indexed variables. */
+PRIVATE size_t           env_mask     = 0;    /* [lock(environ_lock)] Hash-mask of `env_slots'. */
+PRIVATE uintptr_t        env_version  = 0;    /* [lock(environ_lock)] Incremented whenever a change to the environment is detected. */
+
+/* The environment vector allocated by libc itself.
+ * While `environ' points here, it can be extended using `realloc()'. */
+PRIVATE char           **env_vector   = NULL; /* [lock(environ_lock)][0..1][owned] */
+PRIVATE size_t           env_vector_size = 0; /* [lock(environ_lock)] Allocated size of `env_vector' (in pointers). */
+
+/* Strings allocated by `setenv()' (freed once they are removed from the environment). */
+PRIVATE char           **env_strings  = NULL; /* [lock(environ_lock)][1..1][owned][0..env_strings_count|ALLOC(env_strings_size)][owned] */
+PRIVATE size_t           env_strings_count = 0;
+PRIVATE size_t           env_strings_size = 0;
+
+
+PRIVATE ATTR_PURE size_t LIBCCALL
+env_hash(char const *__restrict name, size_t namelen) {
+ size_t result = 0;
+ for (; namelen; --namelen,++name) {
+  char ch = *name;
+  /* Fold case, so the same index can be used for DOS-mode lookups. */
+  if (ch >= 'a' && ch <= 'z') ch -= 'a'-'A';
+  result = (result << 5) + result + (u8)ch;
+ }
+ return result;
+}
+
+LOCAL bool LIBCCALL
+env_match(char const *__restrict entry, char const *__restrict name,
+          size_t namelen, bool dosmode) {
+ if ((dosmode ? libc_memcasecmp(entry,name,namelen)
+              : libc_memcmp(entry,name,namelen)) != 0)
+      return false;
+ return entry[namelen] == '=';
+}
+
+/* Invalidate the index after a change to the environment was detected. */
+LOCAL void LIBCCALL env_invalidate(void) {
+ env_valid = false;
+ env_base  = NULL;
+ env_count = 0;
+ ++env_version;
+}
+
+/* Check if the environment still matches the index. */
+PRIVATE bool LIBCCALL env_unchanged(void) {
+ char **vector = environ;
+ if (!env_valid || vector != env_base) return false;
+ if (!vector) return true;
+ if (vector[env_count] != NULL) return false;
+ return libc_memcmp(vector,env_shadow,env_count*sizeof(char *)) == 0;
+}
+
+/* (Re-)build the index for the current `environ'.
+ * @param: may_alloc: When false, fail if the index's buffers are too small.
+ *                    The initial buffers are always allocated, since
+ *                    `getenv()' would otherwise never get an index.
+ * @return: true:  The index is now up to date.
+ * @return: false: Failed to allocate the index (`env_base' remains invalid) */
+PRIVATE bool LIBCCALL env_rebuild(bool may_alloc) {
+ char **vector = environ;
+ size_t i,count = 0,mask;
+ if (!env_slots) may_alloc = true;
+ if (vector) while (vector[count]) ++count;
+ mask = ENV_MINSLOTS-1;
+ while (mask < count*2) mask = (mask << 1)|1;
+ if (mask > env_mask || !env_slots) {
+  struct env_slot *new_slots;
+  if (!may_alloc) return false;
+  new_slots = (struct env_slot *)libc_malloc((mask+1)*sizeof(struct env_slot));
+  if unlikely(!new_slots) return false;
+  libc_free(env_slots);
+  env_slots = new_slots;
+  env_mask  = mask;
+ }
+ if (count > env_shadow_size) {
+  char **new_shadow;
+  if (!may_alloc) return false;
+  new_shadow = (char **)libc_realloc(env_shadow,count*sizeof(char *));
+  if unlikely(!new_shadow) return false;
+  env_shadow      = new_shadow;
+  env_shadow_size = count;
+ }
+ libc_memset(env_slots,0xff,(env_mask+1)*sizeof(struct env_slot));
+ for (i = 0; i < count; ++i) {
+  char *entry = vector[i];
+  char *eq = libc_strchr(entry,'=');
+  size_t hash,j;
+  env_shadow[i] = entry;
+  if unlikely(!eq) continue; /* Not a variable. */
+  hash = env_hash(entry,(size_t)(eq-entry));
+  for (j = hash & env_mask;; j = (j+1) & env_mask) {
+   if (env_slots[j].es_index != ENV_SLOT_UNUSED) continue;
+   env_slots[j].es_hash  = hash;
+   env_slots[j].es_index = i;
+   break;
+  }
+ }
+ env_valid = true;
+ env_base  = vector;
+ env_count = count;
+ ++env_version;
+ return true;
+}
+
+/* Make sure that the index matches the current environment. */
+PRIVATE bool LIBCCALL env_validate(bool may_alloc) {
+ if (env_unchanged()) return true;
+ if (env_valid) env_invalidate();
+ return env_rebuild(may_alloc);
+}
+
+/* Search `environ' for the first variable `name' without using the index. */
+PRIVATE size_t LIBCCALL
+env_scan(char const *__restrict name, size_t namelen, bool dosmode) {
+ char **vector = environ; size_t i;
+ if (vector) for (i = 0; vector[i]; ++i) {
+  if (env_match(vector[i],name,namelen,dosmode))
+      return i;
+ }
+ return ENV_NOTFOUND;
+}
+
+/* Lookup the index of the first variable `name' in `environ'.
+ * Caller must be holding `environ_lock'.
+ * @param: may_alloc: When false, don't allocate memory if the index must be re-built.
+ * @return: ENV_NOTFOUND: No such variable. */
+PRIVATE size_t LIBCCALL
+env_find(char const *__restrict name, size_t namelen,
+         bool dosmode, bool may_alloc) {
+ size_t i,hash,result;
+ bool did_rebuild = false;
+ hash = env_hash(name,namelen);
+again:
+ if (!env_valid || environ != env_base)
+     goto rebuild;
+ /* Catch variables having been appended in-place. */
+ if (environ && environ[env_count] != NULL)
+     goto rebuild;
+ result = ENV_NOTFOUND;
+ for (i = hash & env_mask;; i = (i+1) & env_mask) {
+  size_t index = env_slots[i].es_index;
+  char *entry;
+  if (index == ENV_SLOT_UNUSED) break;
+  if (env_slots[i].es_hash != hash) continue;
+  entry = environ[index];
+  /* Make sure the string hasn't been replaced. */
+  if unlikely(entry != env_shadow[index])
+     goto rebuild;
+  /* The same variable may appear more than once (especially
+   * in DOS-mode), in which case the first one is used. */
+  if (index < result && env_match(entry,name,namelen,dosmode))
+      result = index;
+ }
+ if (result != ENV_NOTFOUND) {
+  /* Make sure that the variable wasn't removed by truncating
+   * the vector in-place (e.g. `environ[0] = NULL'). */
+  for (i = 0; i < result; ++i) {
+   if unlikely(!environ[i])
+      goto rebuild;
+  }
+ } else if (!env_unchanged()) {
+  /* If it wasn't found, the environment may have been extended. */
+  goto rebuild;
+ }
+ return result;
+rebuild:
+ /* Only invalidate once. - If a previous re-build already failed, the
+  * index is still invalid, and the wide-character copies of `environ'
+  * were already invalidated back then. */
+ if (env_valid) env_invalidate();
+ if (!did_rebuild && env_rebuild(may_alloc)) {
+  did_rebuild = true;
+  goto again;
+ }
+ return env_scan(name,namelen,dosmode);
+}
+
+
+/* Make `environ' point to `env_vector', which has room for at least `extra' more strings.
+ * @return: * :   The number of strings in `environ'.
+ * @return: (size_t)-1: Failed to allocate memory. */
+PRIVATE size_t LIBCCALL env_reserve(size_t extra) {
+ char **vector = environ; size_t count = 0;
+ if (vector) while (vector[count]) ++count;
+ if (vector != env_vector || count+extra+1 > env_vector_size) {
+  char **new_vector; size_t new_size;
+  new_size = count+extra+1;
+  if (vector == env_vector)
+       new_size += new_size/2; /* Over-allocate when growing our own vector. */
+  if (vector == env_vector) {
+   new_vector = (char **)libc_realloc(env_vector,new_size*sizeof(char *));
+   if unlikely(!new_vector) return (size_t)-1;
+  } else {
+   /* Don't free the old vector (we don't own it) */
+   new_vector = (char **)libc_malloc(new_size*sizeof(char *));
+   if unlikely(!new_vector) return (size_t)-1;
+   libc_memcpy(new_vector,vector,count*sizeof(char *));
+   new_vector[count] = NULL;
+   libc_free(env_vector);
+  }
+  env_vector      = new_vector;
+  env_vector_size = new_size;
+  environ         = new_vector;
+ }
+ return count;
+}
+
+/* Free `string' if it was allocated by `setenv()' */
+PRIVATE void LIBCCALL env_release(char *string) {
+ size_t i;
+ for (i = 0; i < env_strings_count; ++i) {
+  if (env_strings[i] != string) continue;
+  env_strings[i] = env_strings[--env_strings_count];
+  libc_free(string);
+  break;
+ }
+}
+
+/* Insert `string' into the environment, replacing an existing definition.
+ * @param: owned: When true, `string' was allocated by libc, and is
+ *                freed once it is removed from the environment.
+ * @return: -1: Failed to allocate memory (`string' isn't inherited) */
+PRIVATE int LIBCCALL
+env_insert(char *__restrict string, size_t namelen,
+           bool owned, bool replace, bool dosmode) {
+ size_t index;
+ if (owned && env_strings_count == env_strings_size) {
+  char **new_strings; size_t new_size;
+  new_size = env_strings_size ? env_strings_size*2 : 8;
+  new_strings = (char **)libc_realloc(env_strings,new_size*sizeof(char *));
+  if unlikely(!new_strings) goto err_nomem;
+  env_strings      = new_strings;
+  env_strings_size = new_size;
+ }
+ index = env_find(string,namelen,dosmode,true);
+ if (index != ENV_NOTFOUND) {
+  char *old_string;
+  if (!replace) {
+   if (owned) libc_free(string);
+   return 0;
+  }
+  old_string = environ[index];
+  environ[index] = string;
+  if (env_valid && environ == env_base)
+      env_shadow[index] = string; /* Update the index in-place. */
+  if (old_string != string)
+      env_release(old_string);
+ } else {
+  index = env_reserve(1);
+  if unlikely(index == (size_t)-1) goto err_nomem;
+  environ[index]   = string;
+  environ[index+1] = NULL;
+  env_invalidate();
+  env_rebuild(true);
+ }
+ if (owned)
+     env_strings[env_strings_count++] = string;
+ return 0;
+err_nomem:
+ libc_seterrno(ENOMEM);
+ return -1;
+}
+
+/* Remove all definitions of `name' from the environment. */
+PRIVATE void LIBCCALL
+env_remove(char const *__restrict name, size_t namelen, bool dosmode) {
+ char **vector = environ,**dst,**src;
+ if (!vector) return;
+ for (src = dst = vector; *src; ++src) {
+  if (env_match(*src,name,namelen,dosmode)) {
+   env_release(*src);
+   continue;
+  }
+  *dst++ = *src;
+ }
+ if (dst == src) return;
+ *dst = NULL;
+ env_invalidate();
+ env_rebuild(true);
+}
+
+LOCAL bool LIBCCALL
+env_checkname(char const *name, size_t *__restrict pnamelen) {
+ size_t namelen;
+ if unlikely(!name) return false;
+ namelen = libc_strlen(name);
+ if unlikely(!namelen || libc_memchr(name,'=',namelen))
+    return false;
+ *pnamelen = namelen;
+ return true;
+}
+
+
+PRIVATE char *LIBCCALL
+env_getenv(char const *name, bool dosmode) {
+ char *result = NULL; size_t namelen,index;
+ if unlikely(!env_checkname(name,&namelen)) return NULL;
+ if unlikely(libc_env_acquire()) return NULL;
+ /* NOTE: Don't allocate memory here. If the index can't be
+  *       re-built in-place, fall back to a linear search. */
+ index = env_find(name,namelen,dosmode,false);
+ if (index != ENV_NOTFOUND)
+     result = environ[index]+namelen+1;
+ libc_env_release();
+ return result;
+}
+
+PRIVATE int LIBCCALL
+env_setenv(char const *name, char const *value,
+           int replace, bool dosmode) {
+ size_t namelen,valuelen; char *string; int result;
+ if unlikely(!env_checkname(name,&namelen)) {
+  libc_seterrno(EINVAL);
+  return -1;
+ }
+ if (!value) value = libc_empty_string;
+ valuelen = libc_strlen(value);
+ string = (char *)libc_malloc((namelen+valuelen+2)*sizeof(char));
+ if unlikely(!string) return -1;
+ libc_memcpy(string,name,namelen*sizeof(char));
+ string[namelen] = '=';
+ libc_memcpy(string+namelen+1,value,(valuelen+1)*sizeof(char));
+ if unlikely(libc_env_acquire()) {
+  libc_free(string);
+  return -1;
+ }
+ result = env_insert(string,namelen,true,replace != 0,dosmode);
+ libc_env_release();
+ if unlikely(result)
+    libc_free(string);
+ return result;
+}
+
+PRIVATE int LIBCCALL
+env_putenv(char *string, bool owned, bool dosmode) {
+ char *eq; int result;
+ if unlikely(!string) goto err_inval;
+ eq = libc_strchr(string,'=');
+ if (!eq) {
+  /* `putenv("NAME")' removes `NAME' (GLibc extension) */
+  if (dosmode) goto err_inval;
+  result = libc_unsetenv(string);
+  if (owned) libc_free(string);
+  return result;
+ }
+ if unlikely(eq == string) goto err_inval;
+ if unlikely(libc_env_acquire()) goto err;
+ if (dosmode && !eq[1]) {
+  /* DOS: `_putenv("NAME=")' removes `NAME' */
+  env_remove(string,(size_t)(eq-string),true);
+  if (owned) libc_free(string);
+  result = 0;
+ } else {
+  result = env_insert(string,(size_t)(eq-string),owned,true,dosmode);
+  if (result && owned) libc_free(string);
+ }
+ libc_env_release();
+ return result;
+err_inval:
+ libc_seterrno(EINVAL);
+err:
+ if (owned) libc_free(string);
+ return -1;
+}
 
 
 INTERN char ***LIBCCALL libc_p_environ(void) { return &environ; }
-CRT_WIDECHAR char16_t **LIBCCALL libc_get_w16environ(void) { return NULL; /* TODO */ }
-CRT_WIDECHAR char32_t **LIBCCALL libc_get_w32environ(void) { return NULL; /* TODO */ }
-CRT_WIDECHAR_EXCEPT ATTR_RETNONNULL char16_t **LIBCCALL libc_Xget_w16environ(void) { libc_error_throw(E_NOT_IMPLEMENTED); }
-CRT_WIDECHAR_EXCEPT ATTR_RETNONNULL char32_t **LIBCCALL libc_Xget_w32environ(void) { libc_error_throw(E_NOT_IMPLEMENTED); }
+INTERN char *LIBCCALL kimpl_libc_getenv(char const *name) { return env_getenv(name,false); }
+INTERN char *LIBCCALL dimpl_libc_getenv(char const *name) { return env_getenv(name,true); }
+INTERN int LIBCCALL kimpl_libc_setenv(char const *name, char const *value, int replace) { return env_setenv(name,value,replace,false); }
+INTERN int LIBCCALL dimpl_libc_setenv(char const *name, char const *value, int replace) { return env_setenv(name,value,replace,true); }
+INTERN int LIBCCALL kimpl_libc_putenv(char *string) { return env_putenv(string,false,false); }
+INTERN int LIBCCALL dimpl_libc_putenv(char *string) { return env_putenv(string,false,true); }
+
+INTERN int LIBCCALL libc_clearenv(void) {
+ size_t i;
+ if unlikely(libc_env_acquire()) return -1;
+ for (i = 0; i < env_strings_count; ++i)
+     libc_free(env_strings[i]);
+ env_strings_count = 0;
+ libc_free(env_vector);
+ env_vector      = NULL;
+ env_vector_size = 0;
+ environ         = NULL;
+ env_invalidate();
+ libc_env_release();
+ return 0;
+}
+
+INTERN int LIBCCALL libc_unsetenv(char const *name) {
+ size_t namelen;
+ if unlikely(!env_checkname(name,&namelen)) {
+  libc_seterrno(EINVAL);
+  return -1;
+ }
+ if unlikely(libc_env_acquire()) return -1;
+ env_remove(name,namelen,false);
+ libc_env_release();
+ return 0;
+}
+
+
+/* Wide-character copies of `environ'.
+ * Lazily (re-)built from `environ' whenever it has changed, such
+ * that `ew_vector[i]' is always the conversion of `environ[i]' */
+struct env_wide {
+    void    **ew_vector;  /* [0..1][owned] Vector of converted strings. */
+    uintptr_t ew_version; /* Value of `env_version' when the vector was built. */
+};
+PRIVATE struct env_wide env_w16 = { NULL, 0 };
+PRIVATE struct env_wide env_w32 = { NULL, 0 };
+
+PRIVATE void LIBCCALL
+env_wide_free(void **vector) {
+ void **iter;
+ if (!vector) return;
+ for (iter = vector; *iter; ++iter)
+     libc_free(*iter);
+ libc_free(vector);
+}
+
+/* Return an up-to-date wide-character environment vector.
+ * Caller must be holding `environ_lock'.
+ * @return: NULL: Failed to allocate memory. */
+PRIVATE void **LIBCCALL
+env_wide_get(struct env_wide *__restrict self,
+             void *(LIBCCALL *convert)(char const *__restrict utf8)) {
+ char **vector; void **result;
+ size_t i,count = 0;
+ env_validate(true);
+ if (self->ew_vector && self->ew_version == env_version)
+     return self->ew_vector;
+ vector = environ;
+ if (vector) while (vector[count]) ++count;
+ result = (void **)libc_malloc((count+1)*sizeof(void *));
+ if unlikely(!result) return NULL;
+ for (i = 0; i < count; ++i) {
+  result[i] = (*convert)(vector[i]);
+  if unlikely(!result[i]) {
+   env_wide_free(result);
+   return NULL;
+  }
+ }
+ result[count] = NULL;
+ env_wide_free(self->ew_vector);
+ self->ew_vector  = result;
+ self->ew_version = env_version;
+ return result;
+}
+
+CRT_WIDECHAR char16_t **LIBCCALL libc_get_w16environ(void) {
+ char16_t **result;
+ if unlikely(libc_env_acquire()) return NULL;
+ result = (char16_t **)env_wide_get(&env_w16,(void *(LIBCCALL *)(char const *__restrict))&libc_utf8to16m);
+ if (result) w16environ = result;
+ libc_env_release();
+ return result;
+}
+CRT_WIDECHAR char32_t **LIBCCALL libc_get_w32environ(void) {
+ char32_t **result;
+ if unlikely(libc_env_acquire()) return NULL;
+ result = (char32_t **)env_wide_get(&env_w32,(void *(LIBCCALL *)(char const *__restrict))&libc_utf8to32m);
+ if (result) w32environ = result;
+ libc_env_release();
+ return result;
+}
+CRT_WIDECHAR_EXCEPT ATTR_RETNONNULL char16_t **LIBCCALL libc_Xget_w16environ(void) {
+ char16_t **result = libc_get_w16environ();
+ if unlikely(!result) libc_error_throw(E_BADALLOC);
+ return result;
+}
+CRT_WIDECHAR_EXCEPT ATTR_RETNONNULL char32_t **LIBCCALL libc_Xget_w32environ(void) {
+ char32_t **result = libc_get_w32environ();
+ if unlikely(!result) libc_error_throw(E_BADALLOC);
+ return result;
+}
+CRT_DOS char16_t ***LIBCCALL libd_p_wenviron(void) {
+ libc_get_w16environ();
+ return &w16environ;
+}
+
+
+PRIVATE char16_t *LIBCCALL
+env_w16getenv(char16_t const *name, bool dosmode) {
+ char buf[UTF_STACK_BUFFER_SIZE];
+ char16_t *result = NULL; char16_t **vector;
+ size_t namelen,index; char *name8;
+ if unlikely(!name) return NULL;
+ name8 = libc_loadutf16(buf,name);
+ if unlikely(!name8) return NULL;
+ if unlikely(!env_checkname(name8,&namelen)) goto done;
+ if unlikely(libc_env_acquire()) goto done;
+ vector = (char16_t **)env_wide_get(&env_w16,(void *(LIBCCALL *)(char const *__restrict))&libc_utf8to16m);
+ if likely(vector) {
+  w16environ = vector;
+  index = env_find(name8,namelen,dosmode,true);
+  if (index != ENV_NOTFOUND)
+      result = libc_w16chr(vector[index],'=')+1;
+ }
+ libc_env_release();
+done:
+ libc_freeutf(buf,name8);
+ return result;
+}
 
+PRIVATE char32_t *LIBCCALL
+env_w32getenv(char32_t const *name, bool dosmode) {
+ char buf[UTF_STACK_BUFFER_SIZE];
+ char32_t *result = NULL; char32_t **vector;
+ size_t namelen,index; char *name8;
+ if unlikely(!name) return NULL;
+ name8 = libc_loadutf32(buf,name);
+ if unlikely(!name8) return NULL;
+ if unlikely(!env_checkname(name8,&namelen)) goto done;
+ if unlikely(libc_env_acquire()) goto done;
+ vector = (char32_t **)env_wide_get(&env_w32,(void *(LIBCCALL *)(char const *__restrict))&libc_utf8to32m);
+ if likely(vector) {
+  w32environ = vector;
+  index = env_find(name8,namelen,dosmode,true);
+  if (index != ENV_NOTFOUND)
+      result = libc_w32chr(vector[index],'=')+1;
+ }
+ libc_env_release();
+done:
+ libc_freeutf(buf,name8);
+ return result;
+}
 
-INTERN char *LIBCCALL kimpl_libc_getenv(char const *name) { return NULL; } /* TODO */
-INTERN char *LIBCCALL dimpl_libc_getenv(char const *name) { return NULL; } /* TODO */
-INTERN int LIBCCALL kimpl_libc_setenv(char const *name, char const *value, int replace) { libc_seterrno(ENOSYS); return -1; } /* TODO */
-INTERN int LIBCCALL dimpl_libc_setenv(char const *name, char const *value, int replace) { libc_seterrno(ENOSYS); return -1; } /* TODO */
-INTERN int LIBCCALL kimpl_libc_putenv(char *string) { libc_seterrno(ENOSYS); return -1; } /* TODO */
-INTERN int LIBCCALL dimpl_libc_putenv(char *string) { libc_seterrno(ENOSYS); return -1; } /* TODO */
-INTERN int LIBCCALL libc_clearenv(void) { libc_seterrno(ENOSYS); return -1; } /* TODO */
-INTERN int LIBCCALL libc_unsetenv(char const *name) { libc_seterrno(ENOSYS); return -1; } /* TODO */
+CRT_WIDECHAR int LIBCCALL libc_w16putenv(char16_t const *string) { char *str = libc_utf16to8m(string); return str ? env_putenv(str,true,LIBC_DOSMODE_ENABLED()) : -1; }
+CRT_WIDECHAR int LIBCCALL libc_w32putenv(char32_t const *string) { char *str = libc_utf32to8m(string); return str ? env_putenv(str,true,LIBC_DOSMODE_ENABLED()) : -1; }
+CRT_WIDECHAR int LIBCCALL libc_dos_w16putenv(char16_t const *string) { char *str = libc_utf16to8m(string); return str ? env_putenv(str,true,!LIBC_DOSMODE_DISABLED()) : -1; }
+CRT_WIDECHAR int LIBCCALL libc_dos_w32putenv(char32_t const *string) { char *str = libc_utf32to8m(string); return str ? env_putenv(str,true,!LIBC_DOSMODE_DISABLED()) : -1; }
+CRT_WIDECHAR char16_t *LIBCCALL libc_w16getenv(char16_t const *name) { return env_w16getenv(name,LIBC_DOSMODE_ENABLED()); }
+CRT_WIDECHAR char32_t *LIBCCALL libc_w32getenv(char32_t const *name) { return env_w32getenv(name,LIBC_DOSMODE_ENABLED()); }
+CRT_WIDECHAR char16_t *LIBCCALL libc_dos_w16getenv(char16_t const *name) { return env_w16getenv(name,!LIBC_DOSMODE_DISABLED()); }
+CRT_WIDECHAR char32_t *LIBCCALL libc_dos_w32getenv(char32_t const *name) { return env_w32getenv(name,!LIBC_DOSMODE_DISABLED()); }
 
 
 INTERN char *LIBCCALL libc_getenv(char const *name) { return LIBC_DOSMODE_ENABLED() ? dimpl_libc_getenv(name) : kimpl_libc_getenv(name); }
@@ -69,6 +616,7 @@ INTERN int LIBCCALL libc_dos_putenv(char *string) { return LIBC_DOSMODE_DISABLED
 INTERN derrno_t LIBCCALL libd_putenv_s(char const *name, char const *value) { return libc_setenv(name,value,1) ? libc_dos_geterrno() : 0; }
 INTERN derrno_t LIBCCALL libd_dos_putenv_s(char const *name, char const *value) { return libc_dos_setenv(name,value,1) ? libc_dos_geterrno() : 0; }
 EXPORT(__p__environ,               libc_p_environ);
+EXPORT(__p__wenviron,              libd_p_wenviron);
 EXPORT(clearenv,                   libc_clearenv);
 EXPORT(unsetenv,                   libc_unsetenv);
 EXPORT(__KSYM(getenv),             libc_getenv);
@@ -79,6 +627,14 @@ EXPORT(__KSYM(putenv_s),           libd_putenv_s);
 EXPORT(__DSYM(_putenv_s),          libd_dos_putenv_s);
 EXPORT(__KSYM(setenv),             libc_setenv);
 EXPORT(__DSYM(setenv),             libc_dos_setenv);
+EXPORT(__KSYMw16(wgetenv),         libc_w16getenv);
+EXPORT(__KSYMw32(wgetenv),         libc_w32getenv);
+EXPORT(__DSYMw16(_wgetenv),        libc_dos_w16getenv);
+EXPORT(__DSYMw32(wgetenv),         libc_dos_w32getenv);
+EXPORT(__KSYMw16(wputenv),         libc_w16putenv);
+EXPORT(__KSYMw32(wputenv),         libc_w32putenv);
+EXPORT(__DSYMw16(_wputenv),        libc_dos_w16putenv);
+EXPORT(__DSYMw32(wputenv),         libc_dos_w32putenv);
 
 EXPORT_STRONG(_environ,environ);
 EXPORT_STRONG(__environ,environ);
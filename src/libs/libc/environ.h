@@ -33,7 +33,7 @@ DECL_BEGIN
 /* ===================================================================================== */
 DATDEF char **environ;
 INTDEF char16_t **w16environ;
-INTDEF char16_t **w32environ;
+INTDEF char32_t **w32environ;
 INTDEF char ***LIBCCALL libc_p_environ(void);
 INTDEF char *LIBCCALL libc_getenv(char const *name);
 INTDEF char16_t **LIBCCALL libc_get_w16environ(void);
@@ -49,6 +49,15 @@ INTDEF int LIBCCALL libc_dos_setenv(char const *name, char const *value, int rep
 INTDEF int LIBCCALL libc_dos_putenv(char *string);
 INTDEF derrno_t LIBCCALL libd_putenv_s(char const *name, char const *value);
 INTDEF derrno_t LIBCCALL libd_dos_putenv_s(char const *name, char const *value);
+INTDEF char16_t ***LIBCCALL libd_p_wenviron(void);
+INTDEF char16_t *LIBCCALL libc_w16getenv(char16_t const *name);
+INTDEF char32_t *LIBCCALL libc_w32getenv(char32_t const *name);
+INTDEF char16_t *LIBCCALL libc_dos_w16getenv(char16_t const *name);
+INTDEF char32_t *LIBCCALL libc_dos_w32getenv(char32_t const *name);
+INTDEF int LIBCCALL libc_w16putenv(char16_t const *string);
+INTDEF int LIBCCALL libc_w32putenv(char32_t const *string);
+INTDEF int LIBCCALL libc_dos_w16putenv(char16_t const *string);
+INTDEF int LIBCCALL libc_dos_w32putenv(char32_t const *string);
 
 
 INTDEF int LIBCCALL libc_env_acquire(void);
@@ -27,8 +27,14 @@
 #include "environ.h"
 #include "widechar.h"
 #include "sched.h"
+#include "malloc.h"
+#include "unicode.h"
 #include <errno.h>
 #include <alloca.h>
+#include <fcntl.h>
+#include <process.h>
+#include <spawn.h>
+#include <bits/waitstatus.h>
 
 DECL_BEGIN
 
@@ -52,8 +58,10 @@ libc_fexecvpeat(char const *file,
                 char *const argv[],
                 char *const envp[],
                 int flags) {
- /* TODO: Search $PATH */
- libc_seterrno(ENOSYS);
+ LIBC_TRY {
+  libc_Xfexecvpeat(file,argv,envp,flags);
+ } LIBC_EXCEPT(libc_except_errno()) {
+ }
  return -1;
 }
 
@@ -80,9 +88,13 @@ libc_fspawnveat(int mode, fd_t dfd,
                 char *const argv[],
                 char *const envp[],
                 int flags) {
- /* TODO */
- libc_seterrno(ENOSYS);
- return -1;
+ pid_t COMPILER_IGNORE_UNINITIALIZED(result);
+ LIBC_TRY {
+  result = libc_Xfspawnveat(mode,dfd,path,argv,envp,flags);
+ } LIBC_EXCEPT(libc_except_errno()) {
+  result = -1;
+ }
+ return result;
 }
 CRT_DOS pid_t LIBCCALL
 libc_fspawnvpeat(int mode,
@@ -90,9 +102,13 @@ libc_fspawnvpeat(int mode,
                  char *const argv[],
                  char *const envp[],
                  int flags) {
- /* TODO: Search $PATH */
- libc_seterrno(ENOSYS);
- return -1;
+ pid_t COMPILER_IGNORE_UNINITIALIZED(result);
+ LIBC_TRY {
+  result = libc_Xfspawnvpeat(mode,file,argv,envp,flags);
+ } LIBC_EXCEPT(libc_except_errno()) {
+  result = -1;
+ }
+ return result;
 }
 
 CRT_WIDECHAR int LIBCCALL libc_w16execv(char16_t const *path, char16_t *const argv[]) { return libc_w16fexecveat(AT_FDCWD,path,argv,libc_get_w16environ(),0); }
@@ -598,13 +614,84 @@ CRT_EXCEPT ATTR_NORETURN void LIBCCALL libc_Xfexecv(int exec_fd, char *const arg
 CRT_EXCEPT ATTR_NORETURN void LIBCCALL libc_Xfexecve(int exec_fd, char *const argv[], char *const envp[]) { Xsys_execveat(exec_fd,libc_empty_string,argv,envp,AT_EMPTY_PATH); }
 CRT_EXCEPT ATTR_NORETURN void LIBCCALL libc_Xfexecvat(fd_t dfd, char const *path, char *const argv[], int flags) { Xsys_execveat(dfd,path,argv,environ,flags); }
 CRT_EXCEPT ATTR_NORETURN void LIBCCALL libc_Xfexecvpat(char const *file, char *const argv[], int flags) { libc_Xfexecvpeat(file,argv,environ,flags); }
+PRIVATE char const libc_default_path[] = "/bin:/usr/bin";
+
+/* exec() `path', and if it isn't in any known executable format,
+ * run it as a shell script using `/bin/sh', like execvp() does
+ * in other implementations when it encounters `ENOEXEC'. */
+PRIVATE ATTR_NORETURN void LIBCCALL
+libc_Xexecvpe_or_sh(char const *path,
+                    char *const argv[],
+                    char *const envp[],
+                    int flags) {
+ char **sh_argv; size_t argc = 0;
+ LIBC_TRY {
+  Xsys_execveat(AT_FDCWD,path,argv,envp,flags);
+ } LIBC_CATCH (E_NOT_EXECUTABLE) {
+  if (error_info()->e_error.e_not_executable.ne_errcode !=
+      ERROR_NOT_EXECUTABLE_BADFORMAT)
+      error_rethrow();
+  error_handled();
+ }
+ /* { "sh", path, argv[1...], NULL } */
+ if (argv[0]) while (argv[++argc]);
+ sh_argv = (char **)alloca((argc+3)*sizeof(char *));
+ sh_argv[0] = (char *)libc_str_sh;
+ sh_argv[1] = (char *)path;
+ sh_argv[2] = NULL;
+ if (argc) libc_memcpy(sh_argv+2,argv+1,argc*sizeof(char *));
+ LIBC_TRY {
+  Xsys_execveat(AT_FDCWD,libc_path_bin_sh,sh_argv,envp,flags);
+ } LIBC_CATCH (E_FILESYSTEM_ERROR) {
+  /* No shell. - Report the original error. */
+  error_handled();
+ }
+ error_throwf(E_NOT_EXECUTABLE,ERROR_NOT_EXECUTABLE_BADFORMAT);
+}
+
 CRT_EXCEPT ATTR_NORETURN void LIBCCALL
 libc_Xfexecvpeat(char const *file,
                  char *const argv[],
                  char *const envp[],
                  int flags) {
- /* TODO: Search $PATH */
- error_throw(E_NOT_IMPLEMENTED);
+ char const *path,*end; char *buf,*dst;
+ size_t filelen; bool access_error = false;
+ char sep = flags & AT_DOSPATH ? ';' : ':';
+ /* Filenames containing a slash aren't searched for. */
+ if (libc_strchr(file,'/') ||
+    ((flags & AT_DOSPATH) && libc_strchr(file,'\\')))
+     libc_Xexecvpe_or_sh(file,argv,envp,flags);
+ path = libc_getenv("PATH");
+ if (!path) path = libc_default_path;
+ filelen = libc_strlen(file);
+ /* No path segment can be longer than $PATH itself. */
+ buf = (char *)alloca((libc_strlen(path)+filelen+2)*sizeof(char));
+ for (;; path = end+1) {
+  end = libc_strchrnul(path,sep);
+  dst = buf;
+  if (end != path) {
+   /* An empty segment refers to the current working directory. */
+   dst = (char *)libc_mempcpy(dst,path,(size_t)(end-path)*sizeof(char));
+   if (dst[-1] != '/') *dst++ = '/';
+  }
+  libc_memcpy(dst,file,(filelen+1)*sizeof(char));
+  LIBC_TRY {
+   libc_Xexecvpe_or_sh(buf,argv,envp,flags);
+  } LIBC_CATCH (E_FILESYSTEM_ERROR) {
+   u16 code = error_info()->e_error.e_filesystem_error.fs_errcode;
+   /* Keep on searching if the file doesn't exist, or can't be accessed. */
+   if (code == ERROR_FS_ACCESS_ERROR)
+       access_error = true;
+   else if (!ERROR_FS_IS_NOT_FOUND(code))
+       error_rethrow();
+   error_handled();
+  }
+  if (!*end) break;
+ }
+ /* Like other implementations, prefer reporting EACCES over ENOENT. */
+ error_throwf(E_FILESYSTEM_ERROR,
+              access_error ? ERROR_FS_ACCESS_ERROR
+                           : ERROR_FS_FILE_NOT_FOUND);
 }
 
 
@@ -657,14 +744,142 @@ CRT_EXCEPT pid_t LIBCCALL libc_Xfspawnv(int mode, int exec_fd, char *const argv[
 CRT_EXCEPT pid_t LIBCCALL libc_Xfspawnve(int mode, int exec_fd, char *const argv[], char *const envp[]) { return libc_Xfspawnveat(mode,exec_fd,libc_empty_string,argv,envp,AT_EMPTY_PATH); }
 CRT_EXCEPT pid_t LIBCCALL libc_Xfspawnvat(int mode, fd_t dfd, char const *path, char *const argv[], int flags) { return libc_Xfspawnveat(mode,dfd,path,argv,environ,flags); }
 CRT_EXCEPT pid_t LIBCCALL libc_Xfspawnvpat(int mode, char const *file, char *const argv[], int flags) { return libc_Xfspawnvpeat(mode,file,argv,environ,flags); }
+
+/* posix_spawn() file action. */
+struct __spawn_action {
+#define SPAWN_ACTION_CLOSE 0 /* close(sa_fd) */
+#define SPAWN_ACTION_DUP2  1 /* dup2(sa_fd,sa_newfd) */
+#define SPAWN_ACTION_OPEN  2 /* dup2(open(sa_path,sa_oflag,sa_mode),sa_fd) */
+    int         sa_type;    /* The type of action (One of `SPAWN_ACTION_*') */
+    fd_t        sa_fd;      /* The file descriptor affected by the action. */
+    fd_t        sa_newfd;   /* [SPAWN_ACTION_DUP2] The target descriptor. */
+    oflag_t     sa_oflag;   /* [SPAWN_ACTION_OPEN] Open flags. */
+    mode_t      sa_mode;    /* [SPAWN_ACTION_OPEN] Open mode. */
+    char       *sa_path;    /* [SPAWN_ACTION_OPEN][1..1][owned] The file to open. */
+};
+
+PRIVATE void LIBCCALL
+libc_spawn_setup(posix_spawn_file_actions_t const *actions,
+                 posix_spawnattr_t const *attr) {
+ if (attr) {
+  if (attr->__flags & POSIX_SPAWN_SETSIGDEF) {
+   struct sigaction act; int sig;
+   libc_memset(&act,0,sizeof(struct sigaction));
+   act.sa_handler = SIG_DFL;
+   for (sig = 1; sig < _NSIG; ++sig) {
+    if (attr->__sd.__val[__sigword(sig)] & __sigmask(sig))
+        Xsys_sigaction(sig,&act,NULL,sizeof(sigset_t));
+   }
+  }
+  if (attr->__flags & POSIX_SPAWN_SETSIGMASK)
+      Xsys_sigprocmask(SIG_SETMASK,&attr->__ss,NULL,sizeof(sigset_t));
+  if (attr->__flags & POSIX_SPAWN_SETPGROUP)
+      Xsys_setpgid(0,attr->__pgrp);
+  /* XXX: `POSIX_SPAWN_RESETIDS', `POSIX_SPAWN_SETSCHEDPARAM'
+   *      and `POSIX_SPAWN_SETSCHEDULER' (KOS has no support
+   *       for user IDs, or scheduler policies, yet) */
+ }
+ if (actions) {
+  struct __spawn_action *iter,*end;
+  end = (iter = actions->__actions)+actions->__used;
+  for (; iter != end; ++iter) {
+   switch (iter->sa_type) {
+   case SPAWN_ACTION_CLOSE:
+    sys_close(iter->sa_fd);
+    break;
+   case SPAWN_ACTION_DUP2:
+    if (iter->sa_fd == iter->sa_newfd) {
+     /* dup2() would be a no-op, but POSIX wants the
+      * descriptor to be inherited by the new process. */
+     syscall_slong_t fdflags;
+     fdflags = Xsys_fcntl(iter->sa_fd,F_GETFD,NULL);
+     if (fdflags & FD_CLOEXEC)
+         Xsys_fcntl(iter->sa_fd,F_SETFD,(void *)(uintptr_t)(fdflags & ~FD_CLOEXEC));
+    } else {
+     Xsys_dup2(iter->sa_fd,iter->sa_newfd);
+    }
+    break;
+   case SPAWN_ACTION_OPEN:
+   {
+    fd_t fd;
+    fd = Xsys_openat(AT_FDCWD,iter->sa_path,iter->sa_oflag,iter->sa_mode);
+    if (fd != iter->sa_fd) {
+     Xsys_dup2(fd,iter->sa_fd);
+     sys_close(fd);
+    }
+   } break;
+   default: break;
+   }
+  }
+ }
+}
+
+/* Spawn a child process using `vfork()', apply `actions' and `attr',
+ * then exec() `file' (searched in $PATH) or `dfd:path' in the child.
+ * If anything goes wrong in the child before the exec() succeeds, the
+ * error is re-thrown in the calling (parent) process, after the child
+ * has been reaped.
+ * This is done in user-space on purpose: vfork() shares the parent's VM,
+ * so no page tables are copied, meaning that a dedicated spawn system call
+ * would only save the one context switch into the child. In exchange, it
+ * would have to re-implement file actions, signal dispositions and $PATH
+ * searching (including the /bin/sh fallback) in the kernel, where they
+ * would run with kernel privileges on user-supplied paths. */
+PRIVATE pid_t LIBCCALL
+libc_Xspawn_impl(fd_t dfd, char const *path, char const *file,
+                 char *const argv[], char *const envp[], int flags,
+                 posix_spawn_file_actions_t const *actions,
+                 posix_spawnattr_t const *attr) {
+ struct exception_data child_error;
+ pid_t child;
+ child_error.e_code = E_OK;
+ COMPILER_WRITE_BARRIER();
+ child = libc_Xvfork();
+ if (child == 0) {
+  /* We're running in the child, using our parent's stack and VM. */
+  LIBC_TRY {
+   libc_spawn_setup(actions,attr);
+   if (file)
+        libc_Xfexecvpeat(file,argv,envp,flags);
+   else Xsys_execveat(dfd,path,argv,envp,flags);
+  } LIBC_EXCEPT(EXCEPT_EXECUTE_HANDLER) {
+   /* The parent is suspended until we exit, so it's safe to pass
+    * the error through its stack (which we're still sharing) */
+   libc_memcpy(&child_error,&error_info()->e_error,
+                sizeof(struct exception_data));
+  }
+  sys_exit_group(127);
+ }
+ COMPILER_READ_BARRIER();
+ if (child_error.e_code != E_OK) {
+  /* The child failed to exec(). - Reap it and re-throw its error. */
+  while (sys_wait4(child,NULL,WEXITED,NULL) == -EINTR);
+  libc_memcpy(&error_info()->e_error,&child_error,
+               sizeof(struct exception_data));
+  error_throw_current();
+ }
+ return child;
+}
+
+PRIVATE pid_t LIBCCALL
+libc_Xspawn_mode(int mode, pid_t child) {
+ int status;
+ if (mode != P_WAIT)
+     return child;
+ /* Wait for the child and return its exit code. */
+ libc_Xwaitpid(child,&status,WEXITED);
+ return __WEXITSTATUS(status);
+}
+
 CRT_EXCEPT pid_t LIBCCALL
 libc_Xfspawnveat(int mode, fd_t dfd,
                  char const *path,
                  char *const argv[],
                  char *const envp[],
                  int flags) {
- /* TODO */
- error_throw(E_NOT_IMPLEMENTED);
+ if (mode == P_OVERLAY)
+     Xsys_execveat(dfd,path,argv,envp,flags);
+ return libc_Xspawn_mode(mode,libc_Xspawn_impl(dfd,path,NULL,argv,envp,flags,NULL,NULL));
 }
 CRT_EXCEPT pid_t LIBCCALL
 libc_Xfspawnvpeat(int mode,
@@ -672,8 +887,9 @@ libc_Xfspawnvpeat(int mode,
                   char *const argv[],
                   char *const envp[],
                   int flags) {
- /* TODO: Search $PATH */
- error_throw(E_NOT_IMPLEMENTED);
+ if (mode == P_OVERLAY)
+     libc_Xfexecvpeat(file,argv,envp,flags);
+ return libc_Xspawn_mode(mode,libc_Xspawn_impl(AT_FDCWD,NULL,file,argv,envp,flags,NULL,NULL));
 }
 
 
@@ -956,6 +1172,61 @@ libc_w32fspawnvpeat(int mode,
 }
 
 
+/* Free a vector returned by `libc_Xutf16to8v()' or `libc_Xutf32to8v()' */
+PRIVATE void LIBCCALL libc_freeutfv(char **vec) {
+ char **iter;
+ if (!vec) return;
+ for (iter = vec; *iter; ++iter)
+     libc_free(*iter);
+ libc_free(vec);
+}
+
+/* Convert a NULL-terminated vector of UTF-16 strings to UTF-8.
+ * The returned vector must be freed using `libc_freeutfv()' */
+PRIVATE ATTR_RETNONNULL char **LIBCCALL
+libc_Xutf16to8v(char16_t *const vec[]) {
+ char **EXCEPT_VAR result; size_t i,count = 0;
+ while (vec[count]) ++count;
+ result = (char **)libc_Xcalloc(count+1,sizeof(char *));
+ LIBC_TRY {
+  for (i = 0; i < count; ++i)
+      result[i] = libc_Xutf16to8m(vec[i]);
+ } LIBC_EXCEPT(EXCEPT_EXECUTE_HANDLER) {
+  libc_freeutfv(result);
+  error_rethrow();
+ }
+ return result;
+}
+
+/* Convert all arguments to UTF-8, then spawn/exec `file'
+ * (searched in $PATH), or `dfd:path' when `file' is NULL. */
+PRIVATE pid_t LIBCCALL
+libc_Xw16spawn_impl(int mode, fd_t dfd,
+                    char16_t const *path,
+                    char16_t const *file,
+                    char16_t *const argv[],
+                    char16_t *const envp[],
+                    int flags) {
+ char buf[UTF_STACK_BUFFER_SIZE];
+ char *EXCEPT_VAR str = libc_Xloadutf16(buf,file ? file : path);
+ char **EXCEPT_VAR argv8 = NULL;
+ char **EXCEPT_VAR envp8 = NULL;
+ pid_t COMPILER_IGNORE_UNINITIALIZED(result);
+ LIBC_TRY {
+  argv8 = libc_Xutf16to8v(argv);
+  if (envp) envp8 = libc_Xutf16to8v(envp);
+  /* The vfork()-ed child has either exec()-ed, or exited by
+   * the time a spawn returns, so it's safe to free these. */
+  result = file ? libc_Xfspawnvpeat(mode,str,argv8,envp8,flags)
+                : libc_Xfspawnveat(mode,dfd,str,argv8,envp8,flags);
+ } LIBC_FINALLY {
+  libc_freeutfv(envp8);
+  libc_freeutfv(argv8);
+  libc_freeutf(buf,str);
+ }
+ return result;
+}
+
 EXPORT(__SYMw16(Xwfexecveat),libc_Xw16fexecveat);
 CRT_WIDECHAR_EXCEPT ATTR_NORETURN void LIBCCALL
 libc_Xw16fexecveat(fd_t dfd,
@@ -963,8 +1234,8 @@ libc_Xw16fexecveat(fd_t dfd,
                    char16_t *const argv[],
                    char16_t *const envp[],
                    int flags) {
- /* TODO */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ libc_Xw16spawn_impl(P_OVERLAY,dfd,path,NULL,argv,envp,flags);
+ __builtin_unreachable();
 }
 EXPORT(__SYMw16(Xwfexecvpeat),libc_Xw16fexecvpeat);
 CRT_WIDECHAR_EXCEPT ATTR_NORETURN void LIBCCALL
@@ -972,8 +1243,8 @@ libc_Xw16fexecvpeat(char16_t const *file,
                     char16_t *const argv[],
                     char16_t *const envp[],
                     int flags) {
- /* TODO */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ libc_Xw16spawn_impl(P_OVERLAY,AT_FDCWD,NULL,file,argv,envp,flags);
+ __builtin_unreachable();
 }
 EXPORT(__SYMw16(Xwfspawnveat),libc_Xw16fspawnveat);
 CRT_WIDECHAR_EXCEPT pid_t LIBCCALL
@@ -982,8 +1253,7 @@ libc_Xw16fspawnveat(int mode, fd_t dfd,
                     char16_t *const argv[],
                     char16_t *const envp[],
                     int flags) {
- /* TODO */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ return libc_Xw16spawn_impl(mode,dfd,path,NULL,argv,envp,flags);
 }
 EXPORT(__SYMw16(Xwfspawnvpeat),libc_Xw16fspawnvpeat);
 CRT_WIDECHAR_EXCEPT pid_t LIBCCALL
@@ -992,19 +1262,64 @@ libc_Xw16fspawnvpeat(int mode,
                      char16_t *const argv[],
                      char16_t *const envp[],
                      int flags) {
- /* TODO: Search $PATH */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ return libc_Xw16spawn_impl(mode,AT_FDCWD,NULL,file,argv,envp,flags);
+}
+
+/* Convert a NULL-terminated vector of UTF-32 strings to UTF-8.
+ * The returned vector must be freed using `libc_freeutfv()' */
+PRIVATE ATTR_RETNONNULL char **LIBCCALL
+libc_Xutf32to8v(char32_t *const vec[]) {
+ char **EXCEPT_VAR result; size_t i,count = 0;
+ while (vec[count]) ++count;
+ result = (char **)libc_Xcalloc(count+1,sizeof(char *));
+ LIBC_TRY {
+  for (i = 0; i < count; ++i)
+      result[i] = libc_Xutf32to8m(vec[i]);
+ } LIBC_EXCEPT(EXCEPT_EXECUTE_HANDLER) {
+  libc_freeutfv(result);
+  error_rethrow();
+ }
+ return result;
+}
+
+/* Convert all arguments to UTF-8, then spawn/exec `file'
+ * (searched in $PATH), or `dfd:path' when `file' is NULL. */
+PRIVATE pid_t LIBCCALL
+libc_Xw32spawn_impl(int mode, fd_t dfd,
+                    char32_t const *path,
+                    char32_t const *file,
+                    char32_t *const argv[],
+                    char32_t *const envp[],
+                    int flags) {
+ char buf[UTF_STACK_BUFFER_SIZE];
+ char *EXCEPT_VAR str = libc_Xloadutf32(buf,file ? file : path);
+ char **EXCEPT_VAR argv8 = NULL;
+ char **EXCEPT_VAR envp8 = NULL;
+ pid_t COMPILER_IGNORE_UNINITIALIZED(result);
+ LIBC_TRY {
+  argv8 = libc_Xutf32to8v(argv);
+  if (envp) envp8 = libc_Xutf32to8v(envp);
+  /* The vfork()-ed child has either exec()-ed, or exited by
+   * the time a spawn returns, so it's safe to free these. */
+  result = file ? libc_Xfspawnvpeat(mode,str,argv8,envp8,flags)
+                : libc_Xfspawnveat(mode,dfd,str,argv8,envp8,flags);
+ } LIBC_FINALLY {
+  libc_freeutfv(envp8);
+  libc_freeutfv(argv8);
+  libc_freeutf(buf,str);
+ }
+ return result;
 }
 
 EXPORT(__SYMw32(Xwfexecveat),libc_Xw32fexecveat);
 CRT_WIDECHAR_EXCEPT ATTR_NORETURN void LIBCCALL
 libc_Xw32fexecveat(fd_t dfd,
-                  char32_t const *path,
-                  char32_t *const argv[],
-                  char32_t *const envp[],
-                  int flags) {
- /* TODO */
- libc_error_throw(E_NOT_IMPLEMENTED);
+                   char32_t const *path,
+                   char32_t *const argv[],
+                   char32_t *const envp[],
+                   int flags) {
+ libc_Xw32spawn_impl(P_OVERLAY,dfd,path,NULL,argv,envp,flags);
+ __builtin_unreachable();
 }
 EXPORT(__SYMw32(Xwfexecvpeat),libc_Xw32fexecvpeat);
 CRT_WIDECHAR_EXCEPT ATTR_NORETURN void LIBCCALL
@@ -1012,8 +1327,8 @@ libc_Xw32fexecvpeat(char32_t const *file,
                     char32_t *const argv[],
                     char32_t *const envp[],
                     int flags) {
- /* TODO: Search $PATH */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ libc_Xw32spawn_impl(P_OVERLAY,AT_FDCWD,NULL,file,argv,envp,flags);
+ __builtin_unreachable();
 }
 EXPORT(__SYMw32(Xwfspawnveat),libc_Xw32fspawnveat);
 CRT_WIDECHAR_EXCEPT pid_t LIBCCALL
@@ -1022,10 +1337,8 @@ libc_Xw32fspawnveat(int mode, fd_t dfd,
                     char32_t *const argv[],
                     char32_t *const envp[],
                     int flags) {
- /* TODO */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ return libc_Xw32spawn_impl(mode,dfd,path,NULL,argv,envp,flags);
 }
-
 EXPORT(__SYMw32(Xwfspawnvpeat),libc_Xw32fspawnvpeat);
 CRT_WIDECHAR_EXCEPT pid_t LIBCCALL
 libc_Xw32fspawnvpeat(int mode,
@@ -1033,11 +1346,222 @@ libc_Xw32fspawnvpeat(int mode,
                      char32_t *const argv[],
                      char32_t *const envp[],
                      int flags) {
- /* TODO: Search $PATH */
- libc_error_throw(E_NOT_IMPLEMENTED);
+ return libc_Xw32spawn_impl(mode,AT_FDCWD,NULL,file,argv,envp,flags);
+}
+
+
+
+
+/* ===================================================================================== */
+/*     POSIX_SPAWN                                                                       */
+/* ===================================================================================== */
+EXPORT(posix_spawn,libc_posix_spawn);
+INTERN int LIBCCALL
+libc_posix_spawn(pid_t *__restrict pid, char const *__restrict path,
+                 posix_spawn_file_actions_t const *file_actions,
+                 posix_spawnattr_t const *__restrict attrp,
+                 char *const argv[], char *const envp[]) {
+ LIBC_TRY {
+  pid_t child;
+  child = libc_Xspawn_impl(AT_FDCWD,path,NULL,argv,envp,0,file_actions,attrp);
+  if (pid) *pid = child;
+ } LIBC_EXCEPT(libc_except_errno()) {
+  return libc_geterrno();
+ }
+ return 0;
 }
 
+EXPORT(posix_spawnp,libc_posix_spawnp);
+INTERN int LIBCCALL
+libc_posix_spawnp(pid_t *pid, char const *file,
+                  posix_spawn_file_actions_t const *file_actions,
+                  posix_spawnattr_t const *attrp,
+                  char *const argv[], char *const envp[]) {
+ LIBC_TRY {
+  pid_t child;
+  child = libc_Xspawn_impl(AT_FDCWD,NULL,file,argv,envp,0,file_actions,attrp);
+  if (pid) *pid = child;
+ } LIBC_EXCEPT(libc_except_errno()) {
+  return libc_geterrno();
+ }
+ return 0;
+}
 
+EXPORT(posix_spawnattr_init,libc_posix_spawnattr_init);
+INTERN int LIBCCALL
+libc_posix_spawnattr_init(posix_spawnattr_t *attr) {
+ libc_memset(attr,0,sizeof(posix_spawnattr_t));
+ return 0;
+}
+EXPORT(posix_spawnattr_destroy,libc_posix_spawnattr_destroy);
+INTERN int LIBCCALL
+libc_posix_spawnattr_destroy(posix_spawnattr_t *UNUSED(attr)) {
+ return 0;
+}
+EXPORT(posix_spawnattr_getsigdefault,libc_posix_spawnattr_getsigdefault);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getsigdefault(posix_spawnattr_t const *__restrict attr,
+                                   sigset_t *__restrict sigdefault) {
+ libc_memcpy(sigdefault,&attr->__sd,sizeof(sigset_t));
+ return 0;
+}
+EXPORT(posix_spawnattr_setsigdefault,libc_posix_spawnattr_setsigdefault);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setsigdefault(posix_spawnattr_t *__restrict attr,
+                                   sigset_t const *__restrict sigdefault) {
+ libc_memcpy(&attr->__sd,sigdefault,sizeof(sigset_t));
+ return 0;
+}
+EXPORT(posix_spawnattr_getsigmask,libc_posix_spawnattr_getsigmask);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getsigmask(posix_spawnattr_t const *__restrict attr,
+                                sigset_t *__restrict sigmask) {
+ libc_memcpy(sigmask,&attr->__ss,sizeof(sigset_t));
+ return 0;
+}
+EXPORT(posix_spawnattr_setsigmask,libc_posix_spawnattr_setsigmask);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setsigmask(posix_spawnattr_t *__restrict attr,
+                                sigset_t const *__restrict sigmask) {
+ libc_memcpy(&attr->__ss,sigmask,sizeof(sigset_t));
+ return 0;
+}
+EXPORT(posix_spawnattr_getflags,libc_posix_spawnattr_getflags);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getflags(posix_spawnattr_t const *__restrict attr,
+                              short int *__restrict flags) {
+ *flags = attr->__flags;
+ return 0;
+}
+EXPORT(posix_spawnattr_setflags,libc_posix_spawnattr_setflags);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setflags(posix_spawnattr_t *attr, short int flags) {
+ if (flags & ~(POSIX_SPAWN_RESETIDS|POSIX_SPAWN_SETPGROUP|
+               POSIX_SPAWN_SETSIGDEF|POSIX_SPAWN_SETSIGMASK|
+               POSIX_SPAWN_SETSCHEDPARAM|POSIX_SPAWN_SETSCHEDULER|
+               POSIX_SPAWN_USEVFORK))
+     return EINVAL;
+ attr->__flags = flags;
+ return 0;
+}
+EXPORT(posix_spawnattr_getpgroup,libc_posix_spawnattr_getpgroup);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getpgroup(posix_spawnattr_t const *__restrict attr,
+                               pid_t *__restrict pgroup) {
+ *pgroup = attr->__pgrp;
+ return 0;
+}
+EXPORT(posix_spawnattr_setpgroup,libc_posix_spawnattr_setpgroup);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setpgroup(posix_spawnattr_t *attr, pid_t pgroup) {
+ attr->__pgrp = pgroup;
+ return 0;
+}
+EXPORT(posix_spawnattr_getschedpolicy,libc_posix_spawnattr_getschedpolicy);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getschedpolicy(posix_spawnattr_t const *__restrict attr,
+                                    int *__restrict schedpolicy) {
+ *schedpolicy = attr->__policy;
+ return 0;
+}
+EXPORT(posix_spawnattr_setschedpolicy,libc_posix_spawnattr_setschedpolicy);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setschedpolicy(posix_spawnattr_t *attr, int schedpolicy) {
+ attr->__policy = schedpolicy;
+ return 0;
+}
+EXPORT(posix_spawnattr_getschedparam,libc_posix_spawnattr_getschedparam);
+INTERN int LIBCCALL
+libc_posix_spawnattr_getschedparam(posix_spawnattr_t const *__restrict attr,
+                                   struct sched_param *__restrict schedparam) {
+ libc_memcpy(schedparam,&attr->__sp,sizeof(struct sched_param));
+ return 0;
+}
+EXPORT(posix_spawnattr_setschedparam,libc_posix_spawnattr_setschedparam);
+INTERN int LIBCCALL
+libc_posix_spawnattr_setschedparam(posix_spawnattr_t *__restrict attr,
+                                   struct sched_param const *__restrict schedparam) {
+ libc_memcpy(&attr->__sp,schedparam,sizeof(struct sched_param));
+ return 0;
+}
+
+EXPORT(posix_spawn_file_actions_init,libc_posix_spawn_file_actions_init);
+INTERN int LIBCCALL
+libc_posix_spawn_file_actions_init(posix_spawn_file_actions_t *file_actions) {
+ libc_memset(file_actions,0,sizeof(posix_spawn_file_actions_t));
+ return 0;
+}
+EXPORT(posix_spawn_file_actions_destroy,libc_posix_spawn_file_actions_destroy);
+INTERN int LIBCCALL
+libc_posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *file_actions) {
+ int i;
+ for (i = 0; i < file_actions->__used; ++i) {
+  if (file_actions->__actions[i].sa_type == SPAWN_ACTION_OPEN)
+      libc_free(file_actions->__actions[i].sa_path);
+ }
+ libc_free(file_actions->__actions);
+ return 0;
+}
+
+/* Append a new action to `file_actions', or return NULL if out of memory. */
+PRIVATE struct __spawn_action *LIBCCALL
+libc_spawn_newaction(posix_spawn_file_actions_t *file_actions) {
+ struct __spawn_action *result;
+ if (file_actions->__used == file_actions->__allocated) {
+  int new_alloc = file_actions->__allocated ? file_actions->__allocated*2 : 4;
+  result = (struct __spawn_action *)libc_realloc(file_actions->__actions,
+                                                 new_alloc*sizeof(struct __spawn_action));
+  if unlikely(!result) return NULL;
+  file_actions->__actions   = result;
+  file_actions->__allocated = new_alloc;
+ }
+ return &file_actions->__actions[file_actions->__used];
+}
+
+EXPORT(posix_spawn_file_actions_addopen,libc_posix_spawn_file_actions_addopen);
+INTERN int LIBCCALL
+libc_posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *__restrict file_actions,
+                                      fd_t fd, char const *__restrict path,
+                                      int oflag, mode_t mode) {
+ struct __spawn_action *action;
+ if (fd < 0) return EBADF;
+ action = libc_spawn_newaction(file_actions);
+ if unlikely(!action) return ENOMEM;
+ action->sa_path = libc_strdup(path);
+ if unlikely(!action->sa_path) return ENOMEM;
+ action->sa_type  = SPAWN_ACTION_OPEN;
+ action->sa_fd    = fd;
+ action->sa_oflag = (oflag_t)oflag;
+ action->sa_mode  = mode;
+ ++file_actions->__used;
+ return 0;
+}
+EXPORT(posix_spawn_file_actions_addclose,libc_posix_spawn_file_actions_addclose);
+INTERN int LIBCCALL
+libc_posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *file_actions, fd_t fd) {
+ struct __spawn_action *action;
+ if (fd < 0) return EBADF;
+ action = libc_spawn_newaction(file_actions);
+ if unlikely(!action) return ENOMEM;
+ action->sa_type = SPAWN_ACTION_CLOSE;
+ action->sa_fd   = fd;
+ ++file_actions->__used;
+ return 0;
+}
+EXPORT(posix_spawn_file_actions_adddup2,libc_posix_spawn_file_actions_adddup2);
+INTERN int LIBCCALL
+libc_posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *file_actions,
+                                      fd_t fd, fd_t newfd) {
+ struct __spawn_action *action;
+ if (fd < 0 || newfd < 0) return EBADF;
+ action = libc_spawn_newaction(file_actions);
+ if unlikely(!action) return ENOMEM;
+ action->sa_type  = SPAWN_ACTION_DUP2;
+ action->sa_fd    = fd;
+ action->sa_newfd = newfd;
+ ++file_actions->__used;
+ return 0;
+}
 
 DECL_END
 
@@ -21,6 +21,7 @@
 
 #include "libc.h"
 #include <kos/types.h>
+#include <spawn.h>
 
 #ifdef __CC__
 DECL_BEGIN
@@ -375,6 +376,32 @@ INTDEF pid_t LIBCCALL libc_Xw32fspawnvpat(int mode, char32_t const *file, char32
 INTDEF pid_t LIBCCALL libc_Xw16fspawnvpeat(int mode, char16_t const *file, char16_t *const argv[], char16_t *const envp[], int flags);
 INTDEF pid_t LIBCCALL libc_Xw32fspawnvpeat(int mode, char32_t const *file, char32_t *const argv[], char32_t *const envp[], int flags);
 
+/* ===================================================================================== */
+/*     POSIX_SPAWN                                                                       */
+/* ===================================================================================== */
+struct sched_param;
+INTDEF int LIBCCALL libc_posix_spawn(pid_t *__restrict pid, char const *__restrict path, posix_spawn_file_actions_t const *file_actions, posix_spawnattr_t const *__restrict attrp, char *const argv[], char *const envp[]);
+INTDEF int LIBCCALL libc_posix_spawnp(pid_t *pid, char const *file, posix_spawn_file_actions_t const *file_actions, posix_spawnattr_t const *attrp, char *const argv[], char *const envp[]);
+INTDEF int LIBCCALL libc_posix_spawnattr_init(posix_spawnattr_t *attr);
+INTDEF int LIBCCALL libc_posix_spawnattr_destroy(posix_spawnattr_t *attr);
+INTDEF int LIBCCALL libc_posix_spawnattr_getsigdefault(posix_spawnattr_t const *__restrict attr, sigset_t *__restrict sigdefault);
+INTDEF int LIBCCALL libc_posix_spawnattr_setsigdefault(posix_spawnattr_t *__restrict attr, sigset_t const *__restrict sigdefault);
+INTDEF int LIBCCALL libc_posix_spawnattr_getsigmask(posix_spawnattr_t const *__restrict attr, sigset_t *__restrict sigmask);
+INTDEF int LIBCCALL libc_posix_spawnattr_setsigmask(posix_spawnattr_t *__restrict attr, sigset_t const *__restrict sigmask);
+INTDEF int LIBCCALL libc_posix_spawnattr_getflags(posix_spawnattr_t const *__restrict attr, short int *__restrict flags);
+INTDEF int LIBCCALL libc_posix_spawnattr_setflags(posix_spawnattr_t *attr, short int flags);
+INTDEF int LIBCCALL libc_posix_spawnattr_getpgroup(posix_spawnattr_t const *__restrict attr, pid_t *__restrict pgroup);
+INTDEF int LIBCCALL libc_posix_spawnattr_setpgroup(posix_spawnattr_t *attr, pid_t pgroup);
+INTDEF int LIBCCALL libc_posix_spawnattr_getschedpolicy(posix_spawnattr_t const *__restrict attr, int *__restrict schedpolicy);
+INTDEF int LIBCCALL libc_posix_spawnattr_setschedpolicy(posix_spawnattr_t *attr, int schedpolicy);
+INTDEF int LIBCCALL libc_posix_spawnattr_getschedparam(posix_spawnattr_t const *__restrict attr, struct sched_param *__restrict schedparam);
+INTDEF int LIBCCALL libc_posix_spawnattr_setschedparam(posix_spawnattr_t *__restrict attr, struct sched_param const *__restrict schedparam);
+INTDEF int LIBCCALL libc_posix_spawn_file_actions_init(posix_spawn_file_actions_t *file_actions);
+INTDEF int LIBCCALL libc_posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *file_actions);
+INTDEF int LIBCCALL libc_posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *__restrict file_actions, fd_t fd, char const *__restrict path, int oflag, mode_t mode);
+INTDEF int LIBCCALL libc_posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *file_actions, fd_t fd);
+INTDEF int LIBCCALL libc_posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *file_actions, fd_t fd, fd_t newfd);
+
 DECL_END
 #endif /* __CC__ */
 
@@ -422,7 +422,6 @@ INTERN char ***LIBCCALL libc_p_initenv(void) { return &libc_current()->ts_proces
 INTERN char **LIBCCALL libc_p_pgmptr(void) { return &libc_current()->ts_process->pe_argv[0]; }
 //TODO: __p___wargv
 //TODO: __p___winitenv
-//TODO: __p__wenviron
 //TODO: __p__wpgmptr
 EXPORT(__p___argc,libc_p_argc);
 EXPORT(__p___argv,libc_p_argv);
@@ -66,6 +66,9 @@ arch_setup_context(struct cpu_context *__restrict context,
 #error "Unsupported architecture"
 #endif
 
+/* Cleared the first time a thread sharing our VM is spawned (and never set again). */
+PUBLIC char __libc_single_threaded = 1;
+
 INTERN pid_t LIBCCALL
 libc_clone(int (LIBCCALL *fn)(void *arg),
            void *child_stack, int flags,
@@ -81,10 +84,22 @@ libc_clone(int (LIBCCALL *fn)(void *arg),
  libc_memset(&child_context,0,sizeof(struct cpu_context));
  /* Do arch-specific initialization of the child's CPU context. */
  arch_setup_context(&child_context,fn,child_stack,arg);
+ /* Stop eliding locks before a second thread can use them. */
+ if (flags & CLONE_VM)
+     __libc_single_threaded = 0;
  /* Create the child process. */
  return Esys_clone(&child_context,flags,ptid,tls,ctid);
 }
 
+INTERN pid_t LIBCCALL
+libc_xclone(struct cpu_context *context, syscall_ulong_t flags,
+            pid_t *parent_tidptr, void *tls_val, pid_t *child_tidptr) {
+ /* Stop eliding locks before a second thread can use them. */
+ if (flags & CLONE_VM)
+     __libc_single_threaded = 0;
+ return Esys_clone(context,flags,parent_tidptr,tls_val,child_tidptr);
+}
+
 
 INTERN int LIBCCALL libc_nice(int inc) { libc_seterrno(ENOSYS); return -1; }
 INTERN pid_t LIBCCALL libc_getpgrp(void) { return libc_getpgid(0); }
@@ -115,7 +130,6 @@ INTERN int LIBCCALL libc_sched_rr_get_interval(pid_t pid, struct timespec32 *t)
 INTERN int LIBCCALL libc_sched_rr_get_interval64(pid_t pid, struct timespec64 *t) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_getrlimit(int resource, struct rlimit *rlimits) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_setrlimit(int resource, struct rlimit const *rlimits) { libc_seterrno(ENOSYS); return -1; }
-INTERN int LIBCCALL libc_getrusage(int who, struct rusage *usage) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_getpriority(int which, id_t who) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_setpriority(int which, id_t who, int prio) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_getrlimit64(int resource, struct rlimit64 *rlimits) { libc_seterrno(ENOSYS); return -1; }
@@ -129,7 +143,8 @@ INTERN char const libc_str_dashc[]        = "-c";
 DEFINE_INTERN_ALIAS(libc_dos_system,libc_system); /* XXX: Own version? */
 INTERN int LIBCCALL libc_system(char const *command) {
  pid_t child,error; int status;
- if ((child = libc_fork()) < 0) return -1; /* XXX: Use vfork()? */
+ /* The child only exec()s, so there's no need to copy our address space. */
+ if ((child = libc_vfork()) < 0) return -1;
  if (child == 0) {
   libc_execl(libc_path_bin_sh,libc_str_sh,libc_str_dashc,command,NULL);
   libc_execl(libc_path_bin_busybox,libc_str_sh,libc_str_dashc,command,NULL);
@@ -152,6 +167,7 @@ EXPORT(getpgrp,                    libc_getpgrp);
 EXPORT(setpgrp,                    libc_setpgrp);
 EXPORT(nice,                       libc_nice);
 EXPORT(clone,                      libc_clone);
+EXPORT(xclone,                     libc_xclone);
 EXPORT(wait,                       libc_wait);
 EXPORT(waitpid,                    libc_waitpid);
 EXPORT(waitid,                     libc_waitid);
@@ -171,7 +187,6 @@ EXPORT(sched_rr_get_interval,      libc_sched_rr_get_interval);
 EXPORT(sched_rr_get_interval64,    libc_sched_rr_get_interval64);
 EXPORT(getrlimit,                  libc_getrlimit);
 EXPORT(setrlimit,                  libc_setrlimit);
-EXPORT(getrusage,                  libc_getrusage);
 EXPORT(getpriority,                libc_getpriority);
 EXPORT(setpriority,                libc_setpriority);
 EXPORT(getrlimit64,                libc_getrlimit64);
@@ -250,10 +265,23 @@ libc_Xclone(int (LIBCCALL *fn)(void *arg),
  libc_memset(&child_context,0,sizeof(struct cpu_context));
  /* Do arch-specific initialization of the child's CPU context. */
  arch_setup_context(&child_context,fn,child_stack,arg);
+ /* Stop eliding locks before a second thread can use them. */
+ if (flags & CLONE_VM)
+     __libc_single_threaded = 0;
  /* Create the child process. */
  return Xsys_clone(&child_context,flags,ptid,tls,ctid);
 }
 
+EXPORT(Xxclone,libc_Xxclone);
+CRT_EXCEPT pid_t LIBCCALL
+libc_Xxclone(struct cpu_context *context, syscall_ulong_t flags,
+             pid_t *parent_tidptr, void *tls_val, pid_t *child_tidptr) {
+ /* Stop eliding locks before a second thread can use them. */
+ if (flags & CLONE_VM)
+     __libc_single_threaded = 0;
+ return Xsys_clone(context,flags,parent_tidptr,tls_val,child_tidptr);
+}
+
 EXPORT(Xsched_getcpu,libc_Xsched_getcpu);
 CRT_EXCEPT cpuid_t LIBCCALL libc_Xsched_getcpu(void) {
  unsigned int result;
@@ -329,12 +357,6 @@ libc_Xsetrlimit(int resource, struct rlimit const *rlimits) {
  libc_error_throw(E_NOT_IMPLEMENTED);
 }
 
-EXPORT(Xgetrusage,libc_Xgetrusage);
-CRT_EXCEPT void LIBCCALL
-libc_Xgetrusage(int who, struct rusage *usage) {
- libc_error_throw(E_NOT_IMPLEMENTED);
-}
-
 EXPORT(Xgetpriority,libc_Xgetpriority);
 CRT_EXCEPT int LIBCCALL
 libc_Xgetpriority(int which, id_t who) {
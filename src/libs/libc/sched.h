@@ -28,6 +28,12 @@ DECL_BEGIN
 /* ===================================================================================== */
 /*     SCHED                                                                             */
 /* ===================================================================================== */
+/* [lock(WRITE_ONCE)] Non-zero while the calling process only consists of a single thread.
+ * Set to ZERO(0) when `clone()' is used to create a thread sharing the VM.
+ * Since only the (then) only thread can clear this flag, locks that were elided
+ * while the flag was set can't have been acquired by any other thread. */
+DATDEF char __libc_single_threaded;
+
 struct rusage;
 struct task_segment;
 struct rlimit;
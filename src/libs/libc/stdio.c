@@ -136,17 +136,21 @@ FileBuffer_SystemClose(FileBuffer *__restrict self) {
 
 PRIVATE DEFINE_ATOMIC_RWLOCK(buffer_ttys_lock);
 PRIVATE WEAK FileBuffer *buffer_ttys = NULL;
-#define buffer_ttys_lock_enter() atomic_rwlock_write(&buffer_ttys_lock)
-#define buffer_ttys_lock_leave() atomic_rwlock_endwrite(&buffer_ttys_lock)
+#define buffer_ttys_lock_enter() (FileBuffer_Locked() ? atomic_rwlock_write(&buffer_ttys_lock) : (void)0)
+#define buffer_ttys_lock_leave() (FileBuffer_Locked() ? atomic_rwlock_endwrite(&buffer_ttys_lock) : (void)0)
 
 PRIVATE DEFINE_ATOMIC_RWLOCK(all_buffers_lock);
 PRIVATE WEAK FileBuffer *all_buffers = NULL;
-#define all_buffers_lock_enter() atomic_rwlock_write(&all_buffers_lock)
-#define all_buffers_lock_leave() atomic_rwlock_endwrite(&all_buffers_lock)
+#define all_buffers_lock_enter() (FileBuffer_Locked() ? atomic_rwlock_write(&all_buffers_lock) : (void)0)
+#define all_buffers_lock_leave() (FileBuffer_Locked() ? atomic_rwlock_endwrite(&all_buffers_lock) : (void)0)
 
 
+/* NOTE: Whether or not a buffer is apart of `buffer_ttys' only changes while its
+ *       `fb_lock' is held (which is the case for the callers of these functions),
+ *       meaning we can check for that without acquiring `buffer_ttys_lock'. */
 CRT_STDIO void LIBCCALL
 FileBuffer_AddChangedTTY(FileBuffer *__restrict self) {
+ if (ATOMIC_READ(self->fb_ttych.le_pself)) return;
  buffer_ttys_lock_enter();
  if (!self->fb_ttych.le_pself) {
   self->fb_ttych.le_pself = &buffer_ttys;
@@ -158,6 +162,7 @@ FileBuffer_AddChangedTTY(FileBuffer *__restrict self) {
 }
 CRT_STDIO void LIBCCALL
 FileBuffer_RemoveChangedTTY(FileBuffer *__restrict self) {
+ if (!ATOMIC_READ(self->fb_ttych.le_pself)) return;
  buffer_ttys_lock_enter();
  if (self->fb_ttych.le_pself) {
   if ((*self->fb_ttych.le_pself = self->fb_ttych.le_next) != NULL)
@@ -791,7 +796,7 @@ again:
  if (self->fb_cnt) {
   /* Simple case: we can read from the active buffer. */
   --self->fb_cnt;
-  return (int)(char)*self->fb_ptr++;
+  return (int)*self->fb_ptr++;
  }
  /* The buffer is empty and must be re-filled. */
  LIBC_TRY {
@@ -1145,12 +1150,13 @@ CRT_STDIO size_t LIBCCALL
 FileBuffer_XRead(FileBuffer *__restrict self,
               void *__restrict buffer,
               size_t bufsize) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = FileBuffer_XReadUnlocked(self,buffer,bufsize);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -1158,88 +1164,96 @@ CRT_STDIO size_t LIBCCALL
 FileBuffer_XWrite(FileBuffer *__restrict self,
                void const *__restrict buffer,
                size_t bufsize) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = FileBuffer_XWriteUnlocked(self,buffer,bufsize);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 CRT_STDIO void LIBCCALL
 FileBuffer_XFlush(FileBuffer *__restrict self) {
- FileBuffer_XLock(self);
+ bool locked;
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   FileBuffer_XFlushUnlocked(self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
 }
 CRT_STDIO void LIBCCALL
 FileBuffer_XSeek(FileBuffer *__restrict self,
               off64_t off, int whence) {
- FileBuffer_XLock(self);
+ bool locked;
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   FileBuffer_XSeekUnlocked(self,off,whence);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
 }
 CRT_STDIO void LIBCCALL
 FileBuffer_XSetvbuf(FileBuffer *__restrict self,
                  char *__restrict buffer,
                  int modes, size_t n) {
- FileBuffer_XLock(self);
+ bool locked;
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   FileBuffer_XSetvbufUnlocked(self,buffer,modes,n);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_XGetc(FileBuffer *__restrict self) {
+ bool locked;
  int COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = FileBuffer_XGetcUnlocked(self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_XUngetc(FileBuffer *__restrict self, int ch) {
+ bool locked;
  int COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = FileBuffer_XUngetcUnlocked(self,ch);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_XFill(FileBuffer *__restrict self) {
+ bool locked;
  int COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = FileBuffer_XFillUnlocked(self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO pos64_t LIBCCALL
 FileBuffer_XTell(FileBuffer *__restrict self) {
+ bool locked;
  pos64_t result;
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  result = FileBuffer_TellUnlocked(self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -1248,12 +1262,13 @@ CRT_STDIO size_t LIBCCALL
 FileBuffer_Read(FileBuffer *__restrict self,
              void *__restrict buffer,
              size_t bufsize) {
+ bool locked;
  size_t result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return 0;
  result = FileBuffer_ReadUnlocked(self,buffer,bufsize);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -1261,41 +1276,45 @@ CRT_STDIO size_t LIBCCALL
 FileBuffer_Write(FileBuffer *__restrict self,
               void const *__restrict buffer,
               size_t bufsize) {
+ bool locked;
  size_t result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return 0;
  result = FileBuffer_WriteUnlocked(self,buffer,bufsize);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_Flush(FileBuffer *__restrict self) {
+ bool locked;
  int result;
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_FlushUnlocked(self);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO off64_t LIBCCALL
 FileBuffer_Tell(FileBuffer *__restrict self) {
+ bool locked;
  off64_t result;
- if (FileBuffer_Lock(self))
+ if (FileBuffer_Lock(self,locked))
      return -1;
  result = (off64_t)FileBuffer_TellUnlocked(self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_Seek(FileBuffer *__restrict self, off64_t off, int whence) {
+ bool locked;
  int result;
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_SeekUnlocked(self,off,whence);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -1304,40 +1323,44 @@ CRT_STDIO int LIBCCALL
 FileBuffer_Setvbuf(FileBuffer *__restrict self,
                 char *__restrict buffer,
                 int modes, size_t n) {
+ bool locked;
  int result;
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_SetvbufUnlocked(self,buffer,modes,n);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_Getc(FileBuffer *__restrict self) {
+ bool locked;
  int result;
  STATIC_ASSERT(EOF == -1);
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_GetcUnlocked(self);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 CRT_STDIO int LIBCCALL
 FileBuffer_Ungetc(FileBuffer *__restrict self, int ch) {
+ bool locked;
  int result;
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_UngetcUnlocked(self,ch);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
 
 CRT_STDIO int LIBCCALL
 FileBuffer_Fill(FileBuffer *__restrict self) {
+ bool locked;
  int result;
- if ((result = FileBuffer_Lock(self)) == 0) {
+ if ((result = FileBuffer_Lock(self,locked)) == 0) {
   result = FileBuffer_FillUnlocked(self);
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
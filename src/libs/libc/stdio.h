@@ -21,6 +21,7 @@
 
 #include "libc.h"
 #include "sync.h"
+#include "sched.h"
 #include <bits/io-file.h>
 #include <bits-generic/io-file.h>
 #include <hybrid/atomic.h>
@@ -188,9 +189,44 @@ __NAMESPACE_STD_USING(FileBuffer)
 #define FILE_BUFSIZ_RELOCATE_THRESHOLD 2048 /* When >= this amount of bytes are unused in the buffer, shrink the buffer. */
 
 #define FileBuffer_HasCookie(self) ((self)->fb_ops.cio_close)
-#define FileBuffer_Lock(self)         libc_mutex_get_timed64(&(self)->fb_lock,NULL)
-#define FileBuffer_XLock(self)  (void)libc_Xmutex_get_timed64(&(self)->fb_lock,NULL)
-#define FileBuffer_Unlock(self)       libc_mutex_put(&(self)->fb_lock)
+
+/* Buffer locks are elided while the process is single-threaded (s.a. `__libc_single_threaded').
+ * Since a thread may be spawned while an elided lock is being "held" (e.g. from
+ * within a `fopencookie()' callback), whether or not the lock was really acquired
+ * is stored in `locked', and must be passed to the matching unlock:
+ * >> bool locked;
+ * >> if (FileBuffer_Lock(self,locked)) return -1;
+ * >> ...
+ * >> FileBuffer_Unlock(self,locked);
+ * NOTE: `flockfile()' & friends always acquire `fb_lock', since the
+ *       user may only release it after having spawned more threads. */
+#define FileBuffer_Locked()            (!__libc_single_threaded)
+#define FileBuffer_Lock(self,locked)   (((locked) = FileBuffer_Locked()) ? libc_mutex_get_timed64(&(self)->fb_lock,NULL) : 0)
+#define FileBuffer_XLock(self,locked)  (((locked) = FileBuffer_Locked()) ? (void)libc_Xmutex_get_timed64(&(self)->fb_lock,NULL) : (void)0)
+#define FileBuffer_Unlock(self,locked) ((locked) ? libc_mutex_put(&(self)->fb_lock) : (void)0)
+
+/* Try to append `ch' to the buffer of `self' without any additional bookkeeping.
+ * This is possible when `ch' directly follows previously written data that hasn't
+ * been flushed yet, there's space left in the buffer, and `ch' doesn't cause a
+ * line-buffered flush. (Otherwise, the caller must use `FileBuffer_XWriteUnlocked()')
+ * NOTE: Changed TTY buffers were already added to `fb_ttych' by that previous write. */
+LOCAL bool LIBCCALL
+FileBuffer_TryPutcUnlocked(FileBuffer *__restrict self, u8 ch) {
+ if (!self->fb_chsz ||
+      self->fb_ptr != self->fb_chng+self->fb_chsz ||
+      self->fb_ptr >= self->fb_base+self->fb_size)
+      return false;
+ if (self->fb_flag & (FILE_BUFFER_FLNIFTTY|FILE_BUFFER_FREADONLY))
+     return false;
+ if ((ch == '\n' || ch == '\r') &&
+     (self->fb_flag & FILE_BUFFER_FLNBUF))
+      return false;
+ *self->fb_ptr++ = ch;
+ ++self->fb_chsz;
+ if (self->fb_cnt)
+   --self->fb_cnt;
+ return true;
+}
 
 /* FileBuffer allocation / destruction. */
 INTDEF int LIBCCALL FileBuffer_Destroy(FileBuffer *__restrict self);
@@ -194,7 +194,9 @@ EXPORT(flockfile,libc_flockfile);
 EXPORT(__DSYM(_lock_file),libc_flockfile); /* DOS Alias */
 CRT_STDIO_API void LIBCCALL
 libc_flockfile(FILE *__restrict self) {
- while (FileBuffer_Lock(self)) {
+ /* NOTE: Explicit locks are never elided, as the caller may
+  *       spawn additional threads before releasing them. */
+ while (libc_mutex_get_timed64(&self->fb_lock,NULL)) {
   if (libc_geterrno() == EINTR) continue;
   /* XXX: What should we do if this fails for a reason other than EINTR? */
  }
@@ -203,7 +205,7 @@ libc_flockfile(FILE *__restrict self) {
 EXPORT(Xflockfile,libc_Xflockfile);
 CRT_STDIO_XAPI void LIBCCALL
 libc_Xflockfile(FILE *__restrict self) {
- FileBuffer_XLock(self);
+ libc_Xmutex_get_timed64(&self->fb_lock,NULL);
 }
 
 EXPORT(Xftrylockfile,libc_ftrylockfile);
@@ -216,7 +218,7 @@ EXPORT(funlockfile,libc_funlockfile);
 EXPORT(__DSYM(_unlock_file),libc_funlockfile); /* DOS Alias */
 CRT_STDIO_API void LIBCCALL
 libc_funlockfile(FILE *__restrict self) {
- FileBuffer_Unlock(self);
+ libc_mutex_put(&self->fb_lock);
 }
 
 
@@ -580,8 +582,9 @@ EXPORT(Xfdreopen,libc_Xfdreopen);
 CRT_STDIO_XAPI ATTR_RETNONNULL FILE *LIBCCALL
 libc_Xfdreopen(fd_t fd, char const *__restrict modes,
                FILE *__restrict self, int mode) {
+ bool locked;
  LIBC_TRY {
-  FileBuffer_XLock(self);
+  FileBuffer_XLock(self,locked);
   LIBC_TRY {
    oflag_t new_mode;
    new_mode = libc_parsemode(modes);
@@ -607,7 +610,7 @@ libc_Xfdreopen(fd_t fd, char const *__restrict modes,
    if ((mode & O_ACCMODE) == O_RDONLY)
         self->fb_flag |= FILE_BUFFER_FREADONLY;
   } LIBC_FINALLY {
-   FileBuffer_Unlock(self);
+   FileBuffer_Unlock(self,locked);
   }
  } LIBC_EXCEPT(EXCEPT_EXECUTE_HANDLER) {
   /* Close the new descriptor on error. */
@@ -1086,16 +1089,32 @@ EXPORT(putc,libc_fputc);
 EXPORT(fputc,libc_fputc);
 CRT_STDIO_API int LIBCCALL
 libc_fputc(int c, FILE *__restrict self) {
- char ch = (char)c;
- return FileBuffer_Write(self,&ch,sizeof(ch)) ? 0 : EOF;
+ bool locked;
+ char ch = (char)c; size_t result;
+ while (FileBuffer_Lock(self,locked))
+    if (libc_geterrno() != EINTR)
+        return EOF;
+ result = FileBuffer_TryPutcUnlocked(self,(u8)ch) ? 1 :
+          FileBuffer_WriteUnlocked(self,&ch,sizeof(ch));
+ FileBuffer_Unlock(self,locked);
+ return result ? (int)(u8)ch : EOF;
 }
 
 EXPORT(Xputc,libc_Xfputc);
 EXPORT(Xfputc,libc_Xfputc);
 CRT_STDIO_XAPI int LIBCCALL
 libc_Xfputc(int c, FILE *__restrict self) {
+ bool locked;
  char ch = (char)c;
- return FileBuffer_XWrite(self,&ch,sizeof(ch)) ? 0 : EOF;
+ size_t COMPILER_IGNORE_UNINITIALIZED(result);
+ FileBuffer_XLock(self,locked);
+ LIBC_TRY {
+  result = FileBuffer_TryPutcUnlocked(self,(u8)ch) ? 1 :
+           FileBuffer_XWriteUnlocked(self,&ch,sizeof(ch));
+ } LIBC_FINALLY {
+  FileBuffer_Unlock(self,locked);
+ }
+ return result ? (int)(u8)ch : EOF;
 }
 
 EXPORT(putc_unlocked,libc_fputc_unlocked);
@@ -1103,7 +1122,9 @@ EXPORT(fputc_unlocked,libc_fputc_unlocked);
 CRT_STDIO_API int LIBCCALL
 libc_fputc_unlocked(int c, FILE *__restrict self) {
  char ch = (char)c;
- return FileBuffer_WriteUnlocked(self,&ch,sizeof(ch)) ? 0 : EOF;
+ if (FileBuffer_TryPutcUnlocked(self,(u8)ch))
+     return (int)(u8)ch;
+ return FileBuffer_WriteUnlocked(self,&ch,sizeof(ch)) ? (int)(u8)ch : EOF;
 }
 
 EXPORT(Xputc_unlocked,libc_Xfputc_unlocked);
@@ -1111,7 +1132,9 @@ EXPORT(Xfputc_unlocked,libc_Xfputc_unlocked);
 CRT_STDIO_XAPI int LIBCCALL
 libc_Xfputc_unlocked(int c, FILE *__restrict self) {
  char ch = (char)c;
- return FileBuffer_XWriteUnlocked(self,&ch,sizeof(ch)) ? 0 : EOF;
+ if (FileBuffer_TryPutcUnlocked(self,(u8)ch))
+     return (int)(u8)ch;
+ return FileBuffer_XWriteUnlocked(self,&ch,sizeof(ch)) ? (int)(u8)ch : EOF;
 }
 
 
@@ -1397,12 +1420,13 @@ CRT_STDIO_API ssize_t LIBCCALL
 libc_getdelim(char **__restrict lineptr,
               size_t *__restrict n, int delimiter,
               FILE *__restrict self) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_getdelim_unlocked(lineptr,n,delimiter,self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -1411,12 +1435,13 @@ CRT_STDIO_XAPI size_t LIBCCALL
 libc_Xgetdelim(char **__restrict lineptr,
                size_t *__restrict n, int delimiter,
                FILE *__restrict self) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = libc_Xgetdelim_unlocked(lineptr,n,delimiter,self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -1574,12 +1599,13 @@ EXPORT(fgets,libc_fgets);
 CRT_STDIO_API char *LIBCCALL
 libc_fgets(char *__restrict s, size_t n,
            FILE *__restrict self) {
+ bool locked;
  char *result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return NULL;
  result = libc_fgets_unlocked(s,n,self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -1587,12 +1613,13 @@ EXPORT(Xfgets,libc_Xfgets);
 CRT_STDIO_XAPI char *LIBCCALL
 libc_Xfgets(char *__restrict s, size_t n,
             FILE *__restrict self) {
+ bool locked;
  char *COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = libc_Xfgets_unlocked(s,n,self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -1693,24 +1720,26 @@ CRT_STDIO_API char *LIBCCALL libc_gets(char *__restrict s) {
 EXPORT(puts,libc_puts);
 CRT_STDIO_API ssize_t LIBCCALL
 libc_puts(char const *__restrict s) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(libc_stdout))
+ while (FileBuffer_Lock(libc_stdout,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_puts_unlocked(s);
- FileBuffer_Unlock(libc_stdout);
+ FileBuffer_Unlock(libc_stdout,locked);
  return result;
 }
 
 EXPORT(Xputs,libc_Xputs);
 CRT_STDIO_XAPI size_t LIBCCALL
 libc_Xputs(char const *__restrict s) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(libc_stdout);
+ FileBuffer_XLock(libc_stdout,locked);
  LIBC_TRY {
   result = libc_Xputs_unlocked(s);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(libc_stdout);
+  FileBuffer_Unlock(libc_stdout,locked);
  }
  return result;
 }
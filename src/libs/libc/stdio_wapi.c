@@ -143,12 +143,13 @@ EXPORT(__SYMw16(getwc),libc_fgetwc16);
 EXPORT(__SYMw16(fgetwc),libc_fgetwc16);
 CRT_W16STDIO_API wint_t LIBCCALL
 libc_fgetwc16(FILE *__restrict stream) {
+ bool locked;
  wint_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return WEOF;
  result = libc_fgetwc16_unlocked(stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -156,12 +157,13 @@ EXPORT(__SYMw32(getwc),libc_fgetwc32);
 EXPORT(__SYMw32(fgetwc),libc_fgetwc32);
 CRT_W32STDIO_API wint_t LIBCCALL
 libc_fgetwc32(FILE *__restrict stream) {
+ bool locked;
  wint_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return WEOF;
  result = libc_fgetwc32_unlocked(stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -169,12 +171,13 @@ EXPORT(__SYMw16(Xgetwc),libc_Xfgetwc16);
 EXPORT(__SYMw16(Xfgetwc),libc_Xfgetwc16);
 CRT_W16STDIO_XAPI wint_t LIBCCALL
 libc_Xfgetwc16(FILE *__restrict stream) {
+ bool locked;
  wint_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xfgetwc16_unlocked(stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -183,12 +186,13 @@ EXPORT(__SYMw32(Xgetwc),libc_Xfgetwc32);
 EXPORT(__SYMw32(Xfgetwc),libc_Xfgetwc32);
 CRT_W32STDIO_XAPI wint_t LIBCCALL
 libc_Xfgetwc32(FILE *__restrict stream) {
+ bool locked;
  wint_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xfgetwc32_unlocked(stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -422,12 +426,13 @@ EXPORT(__SYMw16(putwc),libc_fputwc16);
 EXPORT(__SYMw16(fputwc),libc_fputwc16);
 CRT_W16STDIO_API wint_t LIBCCALL
 libc_fputwc16(char16_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return WEOF;
  result = libc_fputwc16_unlocked(wc,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -435,12 +440,13 @@ EXPORT(__SYMw16(Xputwc),libc_Xfputwc16);
 EXPORT(__SYMw16(Xfputwc),libc_Xfputwc16);
 CRT_W16STDIO_XAPI wint_t LIBCCALL
 libc_Xfputwc16(char16_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xfputwc16_unlocked(wc,stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -551,12 +557,13 @@ EXPORT(__SYMw16(fgetws),libc_fgetws16);
 CRT_W16STDIO_API char16_t *LIBCCALL
 libc_fgetws16(char16_t *__restrict s, size_t n,
               FILE *__restrict self) {
+ bool locked;
  char16_t *result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return NULL;
  result = libc_fgetws16_unlocked(s,n,self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -564,12 +571,13 @@ EXPORT(__SYMw16(Xfgetws),libc_Xfgetws16);
 CRT_W16STDIO_XAPI char16_t *LIBCCALL
 libc_Xfgetws16(char16_t *__restrict s, size_t n,
                FILE *__restrict self) {
+ bool locked;
  char16_t *COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = libc_Xfgetws16_unlocked(s,n,self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -640,12 +648,13 @@ EXPORT(__SYMw32(fgetws),libc_fgetws32);
 CRT_W32STDIO_API char32_t *LIBCCALL
 libc_fgetws32(char32_t *__restrict s, size_t n,
               FILE *__restrict self) {
+ bool locked;
  char32_t *result;
- while (FileBuffer_Lock(self))
+ while (FileBuffer_Lock(self,locked))
     if (libc_geterrno() != EINTR)
         return NULL;
  result = libc_fgetws32_unlocked(s,n,self);
- FileBuffer_Unlock(self);
+ FileBuffer_Unlock(self,locked);
  return result;
 }
 
@@ -653,12 +662,13 @@ EXPORT(__SYMw32(Xfgetws),libc_Xfgetws32);
 CRT_W32STDIO_XAPI char32_t *LIBCCALL
 libc_Xfgetws32(char32_t *__restrict s, size_t n,
                FILE *__restrict self) {
+ bool locked;
  char32_t *COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(self);
+ FileBuffer_XLock(self,locked);
  LIBC_TRY {
   result = libc_Xfgetws32_unlocked(s,n,self);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(self);
+  FileBuffer_Unlock(self,locked);
  }
  return result;
 }
@@ -868,24 +878,26 @@ libc_Xfputws16_unlocked(char16_t const *__restrict ws,
 EXPORT(__SYMw32(fputws),libc_fputws32);
 CRT_W32STDIO_API ssize_t LIBCCALL
 libc_fputws32(char32_t const *__restrict ws, FILE *__restrict stream) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_fputws32_unlocked(ws,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
 EXPORT(__SYMw32(Xfputws),libc_Xfputws32);
 CRT_W32STDIO_XAPI size_t LIBCCALL
 libc_Xfputws32(char32_t const *__restrict ws, FILE *__restrict stream) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xfputws32_unlocked(ws,stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -893,24 +905,26 @@ libc_Xfputws32(char32_t const *__restrict ws, FILE *__restrict stream) {
 EXPORT(__SYMw16(fputws),libc_fputws16);
 CRT_W16STDIO_API ssize_t LIBCCALL
 libc_fputws16(char16_t const *__restrict ws, FILE *__restrict stream) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_fputws16_unlocked(ws,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
 EXPORT(__SYMw16(Xfputws),libc_Xfputws16);
 CRT_W16STDIO_XAPI size_t LIBCCALL
 libc_Xfputws16(char16_t const *__restrict ws, FILE *__restrict stream) {
+ bool locked;
  size_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xfputws16_unlocked(ws,stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -950,12 +964,13 @@ libc_ungetwc32_unlocked(wint_t wc, FILE *__restrict stream) {
 EXPORT(__SYMw32(ungetwc),libc_ungetwc32);
 CRT_W32STDIO_API wint_t LIBCCALL
 libc_ungetwc32(wint_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_ungetwc32_unlocked(wc,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -993,12 +1008,13 @@ libc_Xungetwc32_unlocked(wint_t wc, FILE *__restrict stream) {
 EXPORT(__SYMw32(Xungetwc),libc_Xungetwc32);
 CRT_W32STDIO_XAPI wint_t LIBCCALL
 libc_Xungetwc32(wint_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xungetwc32_unlocked(wc,stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -1037,12 +1053,13 @@ libc_ungetwc16_unlocked(wint_t wc, FILE *__restrict stream) {
 EXPORT(__SYMw16(ungetwc),libc_ungetwc16);
 CRT_W16STDIO_API wint_t LIBCCALL
 libc_ungetwc16(wint_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t result;
- while (FileBuffer_Lock(stream))
+ while (FileBuffer_Lock(stream,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_ungetwc16_unlocked(wc,stream);
- FileBuffer_Unlock(stream);
+ FileBuffer_Unlock(stream,locked);
  return result;
 }
 
@@ -1077,12 +1094,13 @@ libc_Xungetwc16_unlocked(wint_t wc, FILE *__restrict stream) {
 EXPORT(__SYMw16(Xungetwc),libc_Xungetwc16);
 CRT_W16STDIO_XAPI wint_t LIBCCALL
 libc_Xungetwc16(wint_t wc, FILE *__restrict stream) {
+ bool locked;
  wint_t COMPILER_IGNORE_UNINITIALIZED(result);
- FileBuffer_XLock(stream);
+ FileBuffer_XLock(stream,locked);
  LIBC_TRY {
   result = libc_Xungetwc16_unlocked(wc,stream);
  } LIBC_FINALLY {
-  FileBuffer_Unlock(stream);
+  FileBuffer_Unlock(stream,locked);
  }
  return result;
 }
@@ -1127,29 +1145,31 @@ libc_getws32_s(char32_t *__restrict buf, size_t buflen) {
 EXPORT(__SYMw16(_putws),libc_putws16);
 INTDEF ssize_t LIBCCALL
 libc_putws16(char16_t const *__restrict ws) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(libc_stdout))
+ while (FileBuffer_Lock(libc_stdout,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_fputws16_unlocked(ws,libc_stdout);
  if (libc_fputwc16_unlocked('\n',libc_stdout) == WEOF)
      result = EOF-1;
  ++result;
- FileBuffer_Unlock(libc_stdout);
+ FileBuffer_Unlock(libc_stdout,locked);
  return result;
 }
 EXPORT(__SYMw32(putws),libc_putws32);
 INTDEF ssize_t LIBCCALL
 libc_putws32(char32_t const *__restrict ws) {
+ bool locked;
  ssize_t result;
- while (FileBuffer_Lock(libc_stdout))
+ while (FileBuffer_Lock(libc_stdout,locked))
     if (libc_geterrno() != EINTR)
         return -1;
  result = libc_fputws32_unlocked(ws,libc_stdout);
  if (libc_fputwc32_unlocked('\n',libc_stdout) == WEOF)
      result = EOF-1;
  ++result;
- FileBuffer_Unlock(libc_stdout);
+ FileBuffer_Unlock(libc_stdout,locked);
  return result;
 }
 
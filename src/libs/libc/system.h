@@ -32,6 +32,7 @@ struct timespec64;
 struct sigcontext;
 struct sigaction;
 struct rusage;
+struct tms;
 struct pollfd;
 struct pollfutex;
 struct timeval64;
@@ -46,6 +47,7 @@ struct cpu_context;
 struct fpu_context;
 struct sockaddr;
 struct __os_pollinfo;
+struct ioring_params;
 
 
 /* ===================================================================================== */
@@ -111,6 +113,8 @@ INTDEF errno_t LIBCCALL sys_tgkill(pid_t tgid, pid_t pid, int sig);
 INTDEF ssize_t LIBCCALL sys_getcwd(char *buf, size_t bufsize);
 INTDEF errno_t LIBCCALL Esys_waitid(int which, pid_t upid, siginfo_t *infop, int options, struct rusage *ru);
 INTDEF pid_t LIBCCALL sys_wait4(pid_t upid, int *stat_addr, int options, struct rusage *ru);
+INTDEF errno_t LIBCCALL sys_getrusage(int who, struct rusage *ru);
+INTDEF clock_t LIBCCALL sys_times(struct tms *buf);
 INTDEF errno_t LIBCCALL sys_pipe(int pfd[2]);
 INTDEF errno_t LIBCCALL sys_pipe2(int pfd[2], oflag_t flags);
 INTDEF errno_t LIBCCALL sys_mount(char const *dev_name, char const *dir_name, char const *type, unsigned long flags, void const *data);
@@ -118,8 +122,11 @@ INTDEF errno_t LIBCCALL sys_umount2(char const *name, int flags);
 INTDEF errno_t LIBCCALL sys_gettimeofday(struct timeval64 *tv, struct timezone *tz);
 INTDEF errno_t LIBCCALL sys_settimeofday(struct timeval64 const *tv, struct timezone const *tz);
 INTDEF errno_t LIBCCALL sys_nanosleep(struct timespec64 const *rqtp, struct timespec64 *rmtp);
+INTDEF errno_t LIBCCALL sys_clock_gettime(clockid_t clock_id, struct timespec64 *tp);
+INTDEF errno_t LIBCCALL sys_clock_getres(clockid_t clock_id, struct timespec64 *res);
 INTDEF mode_t LIBCCALL sys_umask(mode_t mask);
 INTDEF int LIBCCALL sys_mprotect(void *start, size_t len, int prot);
+INTDEF errno_t LIBCCALL sys_madvise(void *start, size_t len, int advice);
 INTDEF errno_t LIBCCALL sys_swapon(char const *specialfile, int flags);
 INTDEF errno_t LIBCCALL sys_swapoff(char const *specialfile);
 INTDEF syscall_slong_t LIBCCALL Esys_futex(u32 *uaddr, int op, u32 val, struct timespec64 const *utime, u32 *uaddr2, u32 val3);
@@ -184,6 +191,9 @@ INTDEF errno_t LIBCCALL sys_xunwind_except(struct exception_info *except_info, s
 INTDEF errno_t LIBCCALL sys_xunwind(struct cpu_context *ccontext, struct fpu_context *fcontext, sigset_t *signal_set, size_t sigset_size);
 INTDEF ssize_t LIBCCALL sys_xaddr2line(void *abs_pc, struct dl_addr2line *buf, size_t bufsize);
 INTDEF ssize_t LIBCCALL Esys_xppoll(struct __os_pollinfo *info, struct timespec64 const *rel_timeout, sigset_t const *signal_set, size_t sigset_size);
+INTDEF fd_t LIBCCALL Esys_xioring_setup(struct ioring_params const *params, oflag_t flags);
+INTDEF int LIBCCALL Esys_xioring_enter(fd_t ring, unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+INTDEF int LIBCCALL Esys_xioring_register(fd_t ring, unsigned int opcode, void *arg, unsigned int nr_args);
 
 
 
@@ -242,6 +252,7 @@ INTDEF void LIBCCALL Xsys_tgkill(pid_t tgid, pid_t pid, int sig);
 INTDEF size_t LIBCCALL Xsys_getcwd(char *buf, size_t bufsize);
 INTDEF errno_t LIBCCALL Xsys_waitid(int which, pid_t upid, siginfo_t *infop, int options, struct rusage *ru);
 INTDEF pid_t LIBCCALL Xsys_wait4(pid_t upid, int *stat_addr, int options, struct rusage *ru);
+INTDEF void LIBCCALL Xsys_getrusage(int who, struct rusage *ru);
 INTDEF void LIBCCALL Xsys_pipe(int pfd[2]);
 INTDEF void LIBCCALL Xsys_pipe2(int pfd[2], oflag_t flags);
 INTDEF void LIBCCALL Xsys_mount(char const *dev_name, char const *dir_name, char const *type, unsigned long flags, void const *data);
@@ -304,6 +315,9 @@ INTDEF errno_t LIBCCALL Xsys_xunwind(struct cpu_context *ccontext, struct fpu_co
 INTDEF ssize_t LIBCCALL Xsys_xaddr2line(void *abs_pc, struct dl_addr2line *buf, size_t bufsize);
 INTDEF size_t LIBCCALL Xsys_xppoll(struct __os_pollinfo *info, struct timespec64 const *rel_timeout, sigset_t const *signal_set, size_t sigset_size);
 INTDEF void LIBCCALL Xsys_xnosignal(int mode);
+INTDEF fd_t LIBCCALL Xsys_xioring_setup(struct ioring_params const *params, oflag_t flags);
+INTDEF unsigned int LIBCCALL Xsys_xioring_enter(fd_t ring, unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+INTDEF void LIBCCALL Xsys_xioring_register(fd_t ring, unsigned int opcode, void *arg, unsigned int nr_args);
 
 /* Networking functions. */
 INTDEF fd_t LIBCCALL sys_socket(int domain, int type, int protocol);
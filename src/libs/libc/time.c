@@ -36,25 +36,17 @@
 
 DECL_BEGIN
 
-PRIVATE clock_t clock_start = -1;
 INTERN clock_t LIBCCALL libc_clock(void) {
- struct timeval64 now; clock_t result;
- /* Really hacky implementation... */
- if (libc_gettimeofday64(&now,NULL)) return -1;
- result = (now.tv_usec*(CLOCKS_PER_SEC/USEC_PER_SEC)+
-           now.tv_sec*CLOCKS_PER_SEC);
- if (clock_start < 0) clock_start = result;
- return result-clock_start;
+ struct timespec64 now;
+ /* The CPU time used by the process (user + system). */
+ if (libc_clock_gettime64(CLOCK_PROCESS_CPUTIME_ID,&now)) return -1;
+ return (clock_t)(now.tv_sec*CLOCKS_PER_SEC+
+                  now.tv_nsec/(NSEC_PER_SEC/CLOCKS_PER_SEC));
 }
 INTERN clock_t LIBCCALL
 libc_times(struct tms *__restrict buffer) {
- /* This isn't right either... */
- clock_t clock_now  = libc_clock();
- buffer->tms_stime  = clock_now/2;
- buffer->tms_utime  = clock_now/2;
- buffer->tms_cutime = 0;
- buffer->tms_cstime = 0;
- return clock_now;
+ /* NOTE: The kernel measures clock ticks in `CLOCKS_PER_SEC'. */
+ return sys_times(buffer);
 }
 
 INTERN clock_t LIBCCALL libc_dos_clock(void) {
@@ -62,13 +54,12 @@ INTERN clock_t LIBCCALL libc_dos_clock(void) {
 }
 INTERN clock_t LIBCCALL
 libc_dos_times(struct tms *__restrict buffer) {
- /* This isn't right either... */
- clock_t clock_now = libc_dos_clock();
- buffer->tms_stime = clock_now/2;
- buffer->tms_utime = clock_now/2;
- buffer->tms_cutime = 0;
- buffer->tms_cstime = 0;
- return clock_now;
+ clock_t result = libc_times(buffer);
+ buffer->tms_utime  /= (CLOCKS_PER_SEC/__DOS_CLOCKS_PER_SEC);
+ buffer->tms_stime  /= (CLOCKS_PER_SEC/__DOS_CLOCKS_PER_SEC);
+ buffer->tms_cutime /= (CLOCKS_PER_SEC/__DOS_CLOCKS_PER_SEC);
+ buffer->tms_cstime /= (CLOCKS_PER_SEC/__DOS_CLOCKS_PER_SEC);
+ return result/(CLOCKS_PER_SEC/__DOS_CLOCKS_PER_SEC);
 }
 
 
@@ -592,20 +583,6 @@ libc_clock_getcpuclockid(pid_t pid, clockid_t *clock_id) {
  libc_seterrno(ENOSYS);
  return -1;
 }
-EXPORT(clock_getres64,libc_clock_getres64);
-CRT_CLOCK int LIBCCALL
-libc_clock_getres64(clockid_t clock_id,
-                    struct timespec64 *res) {
- libc_seterrno(ENOSYS);
- return -1;
-}
-EXPORT(clock_gettime64,libc_clock_gettime64);
-CRT_CLOCK int LIBCCALL
-libc_clock_gettime64(clockid_t clock_id,
-                     struct timespec64 *tp) {
- libc_seterrno(ENOSYS);
- return -1;
-}
 EXPORT(clock_settime64,libc_clock_settime64);
 CRT_CLOCK int LIBCCALL
 libc_clock_settime64(clockid_t clock_id,
@@ -97,9 +97,6 @@ INTERN int LIBCCALL libc_posix_fallocate64(fd_t fd, pos64_t offset, pos64_t len)
 INTERN int LIBCCALL libc_lockf64(fd_t fd, int cmd, pos64_t len) { libc_seterrno(ENOSYS); return -1; }
 INTERN ssize_t LIBCCALL libc_readahead(fd_t fd, pos64_t offset, size_t count) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_sync_file_range(fd_t fd, pos64_t offset, pos64_t count, unsigned int flags) { libc_seterrno(ENOSYS); return -1; }
-INTERN ssize_t LIBCCALL libc_vmsplice(int fdout, struct iovec const *iov, size_t count, unsigned int flags) { libc_seterrno(ENOSYS); return -1; }
-INTERN ssize_t LIBCCALL libc_splice(int fdin, pos64_t *offin, int fdout, pos64_t *offout, size_t len, unsigned int flags) { libc_seterrno(ENOSYS); return -1; }
-INTERN ssize_t LIBCCALL libc_tee(int fdin, int fdout, size_t len, unsigned int flags) { libc_seterrno(ENOSYS); return -1; }
 INTERN int LIBCCALL libc_posix_fadvise(fd_t fd, pos32_t offset, pos32_t len, int advise) { return libc_posix_fadvise64(fd,(pos64_t)offset,(pos64_t)len,advise); }
 INTERN int LIBCCALL libc_posix_fallocate(fd_t fd, pos32_t offset, pos32_t len) { return libc_posix_fallocate64(fd,(pos64_t)offset,(pos64_t)len); }
 INTERN int LIBCCALL libc_lockf(fd_t fd, int cmd, pos32_t len) { return libc_lockf64(fd,cmd,(pos64_t)len); }
@@ -353,9 +350,6 @@ EXPORT(lockf64,                    libc_lockf64);
 EXPORT(fallocate,                  libc_fallocate);
 EXPORT(readahead,                  libc_readahead);
 EXPORT(sync_file_range,            libc_sync_file_range);
-EXPORT(vmsplice,                   libc_vmsplice);
-EXPORT(splice,                     libc_splice);
-EXPORT(tee,                        libc_tee);
 EXPORT(name_to_handle_at,          libc_name_to_handle_at);
 EXPORT(open_by_handle_at,          libc_open_by_handle_at);
 EXPORT(getumask,                   libc_getumask);
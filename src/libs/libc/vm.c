@@ -95,13 +95,6 @@ libc_munlockall(void) {
  libc_seterrno(ENOSYS); return -1;
 }
 
-EXPORT(madvise,libc_madvise);
-INTERN int LIBCCALL
-libc_madvise(void *addr, size_t len, int advice) {
- libc_seterrno(ENOSYS);
- return -1;
-}
-
 EXPORT(mincore,libc_mincore);
 INTERN int LIBCCALL
 libc_mincore(void *start, size_t len, unsigned char *vec) {
@@ -112,8 +105,11 @@ libc_mincore(void *start, size_t len, unsigned char *vec) {
 EXPORT(posix_madvise,libc_posix_madvise);
 INTERN int LIBCCALL
 libc_posix_madvise(void *addr, size_t len, int advice) {
- libc_seterrno(ENOSYS);
- return -1;
+ /* `POSIX_MADV_DONTNEED' is only a hint (unlike `MADV_DONTNEED', it
+  *  mustn't discard any data), meaning that it's OK to ignore it. */
+ if (advice == POSIX_MADV_DONTNEED) return 0;
+ /* Unlike `madvise()', this one returns the error, rather than setting `errno'. */
+ return -sys_madvise(addr,len,advice);
 }
 
 EXPORT(remap_file_pages,libc_remap_file_pages);
@@ -318,12 +314,6 @@ libc_Xmunlockall(void) {
  libc_error_throw(E_NOT_IMPLEMENTED);
 }
 
-EXPORT(Xmadvise,libc_Xmadvise);
-CRT_EXCEPT void LIBCCALL
-libc_Xmadvise(void *addr, size_t len, int advice) {
- libc_error_throw(E_NOT_IMPLEMENTED);
-}
-
 EXPORT(Xmincore,libc_Xmincore);
 CRT_EXCEPT void LIBCCALL
 libc_Xmincore(void *start, size_t len, unsigned char *vec) {
@@ -333,7 +323,8 @@ libc_Xmincore(void *start, size_t len, unsigned char *vec) {
 EXPORT(Xposix_madvise,libc_Xposix_madvise);
 CRT_EXCEPT void LIBCCALL
 libc_Xposix_madvise(void *addr, size_t len, int advice) {
- libc_error_throw(E_NOT_IMPLEMENTED);
+ if (advice == POSIX_MADV_DONTNEED) return;
+ libc_Xmadvise(addr,len,advice);
 }
 
 EXPORT(Xremap_file_pages,libc_Xremap_file_pages);